@@ -2,7 +2,12 @@
 #define WINDOWS_H_
 
 /*
-float hann256[256] = {
+ * Tablas de solo lectura. Son static para que cada modulo que las incluye (processor.c, qidx.c) tenga su copia
+ * y se puedan enlazar juntos.
+ */
+
+/*
+static const float hann256[256] = {
 		0,0.0001517740110641985,0.0006070039028550078,0.001365413307105989,0.002426541796467785,0.003789745164032132,0.005454195814427021,
 		0.007418883266246734,0.009682614765511133,0.0122440160097817,0.01510153198249525,0.01825342789700846,0.02169779024977958,0.02543252798204937,
 		0.02945537374931423,0.03376388529782209,0.03835544694725534,0.04322727117869957,0.04837640032693558,0.0537997083760261,0.05949390285710776,
@@ -40,7 +45,7 @@ float hann256[256] = {
 
 */
 
-float hann512[512] = {  0.00000f,  0.00004f,  0.00015f,  0.00034f,  0.00060f,  0.00094f,  0.00136f,  0.00185f,  0.00242f,  0.00306f,  0.00377f,  0.00457f,  0.00543f,  0.00637f,  0.00739f,  0.00848f,  0.00964f,  0.01088f,  0.01220f,  0.01358f,
+static const float hann512[512] = {  0.00000f,  0.00004f,  0.00015f,  0.00034f,  0.00060f,  0.00094f,  0.00136f,  0.00185f,  0.00242f,  0.00306f,  0.00377f,  0.00457f,  0.00543f,  0.00637f,  0.00739f,  0.00848f,  0.00964f,  0.01088f,  0.01220f,  0.01358f,
 		   0.01504f,  0.01658f,  0.01818f,  0.01986f,  0.02161f,  0.02344f,  0.02533f,  0.02730f,  0.02934f,  0.03145f,  0.03363f,  0.03589f,  0.03821f,  0.04060f,  0.04306f,  0.04559f,  0.04819f,  0.05086f,  0.05359f,  0.05640f,
 		   0.05927f,  0.06220f,  0.06521f,  0.06827f,  0.07141f,  0.07461f,  0.07787f,  0.08120f,  0.08459f,  0.08804f,  0.09155f,  0.09513f,  0.09877f,  0.10247f,  0.10623f,  0.11004f,  0.11392f,  0.11786f,  0.12185f,  0.12590f,
 		   0.13001f,  0.13417f,  0.13839f,  0.14266f,  0.14699f,  0.15137f,  0.15580f,  0.16029f,  0.16483f,  0.16941f,  0.17405f,  0.17874f,  0.18347f,  0.18826f,  0.19309f,  0.19796f,  0.20288f,  0.20785f,  0.21286f,  0.21792f,
@@ -76,7 +76,7 @@ void ifft(complex_num * input, complex_num * output)
 *****************************************************************************************/
 
 
-void window(complex_num * v, float * window, int length)
+void window(complex_num * v, const float * window, int length)
 {
 	int i;
 
@@ -35,6 +35,6 @@ void ifft(complex_num * input, complex_num * output);
 *****************************************************************************************/
 void fft_init();
 
-void window(complex_num * v, float * window, int size);
+void window(complex_num * v, const float * window, int size);
 
 #endif
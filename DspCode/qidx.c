@@ -0,0 +1,541 @@
+/*
+ * Motor de calculo del indicador de calidad (Qidx) del BSS. Ver qidx.h
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <pj/os.h>
+
+#include "qidx.h"
+#include "dsp_windows.h"
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#	include <intrin.h>
+#	include <emmintrin.h>
+#	define QIDX_HAS_SSE2 1
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && defined(__SSE2__)
+#	include <cpuid.h>
+#	include <emmintrin.h>
+#	define QIDX_HAS_SSE2 1
+#else
+#	define QIDX_HAS_SSE2 0
+#endif
+
+#define FS (8000.0f)
+
+#define QIDX_HALF			(QIDX_BLOCK_SIZE/2)		/* Puntos de la FFT compleja */
+#define QIDX_LOG2_HALF		(8)
+
+/* Banda del cepstrum donde se busca el tono. Igual que en processor.c */
+#define CEPS_TONE_IDX_MAX	((int) (FS/80))
+#define CEPS_TONE_IDX_MIN	((int) (FS/300))
+#define CEPS_TONE_IDX_COUNT	(CEPS_TONE_IDX_MAX - CEPS_TONE_IDX_MIN)
+
+/* Indices del cepstrum que hay que calcular. Se incluye uno a cada lado para la media alrededor del maximo */
+#define CEPS_FIRST			(CEPS_TONE_IDX_MIN - 1)
+#define CEPS_LAST			(CEPS_TONE_IDX_MAX)
+#define CEPS_LEN			(CEPS_LAST - CEPS_FIRST + 1)
+
+static int Initialized = 0;						/* Se lee y escribe dentro de la seccion critica de pjlib */
+static qidx_impl_t Best = QIDX_IMPL_SCALAR;		/* Mejor implementacion de la CPU */
+
+static unsigned short brev[QIDX_HALF];			/* Inversion de bits para la FFT de 256 puntos */
+static float tw_re[QIDX_HALF];					/* Giros de la FFT de 256 puntos. Los de la etapa de */
+static float tw_im[QIDX_HALF];					/* mariposas de tamano 2*h estan seguidos a partir de h-1 */
+static float split_re[QIDX_HALF+1];				/* Giros para separar la FFT real de 512 puntos */
+static float split_im[QIDX_HALF+1];
+
+/*
+ * Nucleos vectorizables
+ */
+typedef float (*window_power_fn)(const float * x, const float * win, float * xr, float * xi);
+typedef void (*log_abs_fn)(const float * re, const float * im, float * out, int n);
+typedef void (*cfft_fn)(float * re, float * im);
+
+typedef struct qidx_kernels
+{
+	window_power_fn window_power;
+	log_abs_fn log_abs;
+	cfft_fn cfft;
+} qidx_kernels_t;
+
+/*
+ * Reordena por inversion de bits, paso previo de la FFT
+ */
+static void bit_reverse(float * re, float * im)
+{
+	int i, j;
+
+	for (i = 0; i < QIDX_HALF; i++)
+	{
+		j = brev[i];
+		if (j > i)
+		{
+			float t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+}
+
+/*
+ * Etapas de la FFT con mariposas de tamano 2*h, desde h = first hasta h < last
+ */
+static void cfft_stages_scalar(float * re, float * im, int first, int last)
+{
+	int i, j, h;
+
+	for (h = first; h < last; h <<= 1)
+	{
+		const float * wr = &tw_re[h-1];
+		const float * wi = &tw_im[h-1];
+
+		for (i = 0; i < QIDX_HALF; i += 2*h)
+		{
+			for (j = 0; j < h; j++)
+			{
+				int a = i + j;
+				int b = a + h;
+				float tr = re[b]*wr[j] - im[b]*wi[j];
+				float ti = re[b]*wi[j] + im[b]*wr[j];
+
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+}
+
+/*
+ * FFT compleja de QIDX_HALF puntos, in situ, radix 2. Parte real e imaginaria en arrays separados.
+ */
+static void cfft_scalar(float * re, float * im)
+{
+	bit_reverse(re, im);
+	cfft_stages_scalar(re, im, 1, QIDX_HALF);
+}
+
+/*
+ * Aplica la ventana separando pares e impares como parte real e imaginaria de la FFT de 256 puntos.
+ * Retorna la potencia del bloque sin ventana.
+ */
+static float window_power_scalar(const float * x, const float * win, float * xr, float * xi)
+{
+	int i;
+	float power = 0.0f;
+
+	for (i = 0; i < QIDX_HALF; i++)
+	{
+		float x0 = x[2*i];
+		float x1 = x[2*i+1];
+
+		power += x0*x0 + x1*x1;
+		xr[i] = x0 * win[2*i];
+		xi[i] = x1 * win[2*i+1];
+	}
+
+	return power;
+}
+
+/*
+ * out[i] = log(abs(re[i] + j*im[i]))
+ */
+static void log_abs_scalar(const float * re, const float * im, float * out, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		out[i] = 0.5f * logf(re[i]*re[i] + im[i]*im[i]);
+	}
+}
+
+#if QIDX_HAS_SSE2
+
+static float window_power_sse2(const float * x, const float * win, float * xr, float * xi)
+{
+	int i;
+	float acc[4];
+	__m128 vpow = _mm_setzero_ps();
+
+	for (i = 0; i < QIDX_HALF; i += 4)
+	{
+		__m128 a = _mm_loadu_ps(&x[2*i]);			/* x0 x1 x2 x3 */
+		__m128 b = _mm_loadu_ps(&x[2*i+4]);			/* x4 x5 x6 x7 */
+		__m128 wa = _mm_loadu_ps(&win[2*i]);
+		__m128 wb = _mm_loadu_ps(&win[2*i+4]);
+		__m128 ya = _mm_mul_ps(a, wa);
+		__m128 yb = _mm_mul_ps(b, wb);
+
+		vpow = _mm_add_ps(vpow, _mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)));
+
+		_mm_storeu_ps(&xr[i], _mm_shuffle_ps(ya, yb, _MM_SHUFFLE(2,0,2,0)));
+		_mm_storeu_ps(&xi[i], _mm_shuffle_ps(ya, yb, _MM_SHUFFLE(3,1,3,1)));
+	}
+
+	_mm_storeu_ps(acc, vpow);
+	return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+/*
+ * Logaritmo neperiano de 4 floats positivos. Aproximacion polinomica de Cephes (logf),
+ * con error relativo del orden de 1e-7.
+ */
+static __m128 log_ps_sse2(__m128 x)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 sqrthf = _mm_set1_ps(0.707106781186547524f);
+	__m128i emm0;
+	__m128 e, mask, tmp, z, y;
+
+	x = _mm_max_ps(x, _mm_set1_ps(1.17549435e-38f));		/* Evita log(0) y desnormales */
+
+	emm0 = _mm_srli_epi32(_mm_castps_si128(x), 23);
+	x = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(~0x7f800000)));
+	x = _mm_or_ps(x, half);								/* Mantisa en [0.5, 1) */
+
+	emm0 = _mm_sub_epi32(emm0, _mm_set1_epi32(0x7f));
+	e = _mm_add_ps(_mm_cvtepi32_ps(emm0), one);
+
+	mask = _mm_cmplt_ps(x, sqrthf);
+	tmp = _mm_and_ps(x, mask);
+	x = _mm_sub_ps(x, one);
+	e = _mm_sub_ps(e, _mm_and_ps(one, mask));
+	x = _mm_add_ps(x, tmp);
+
+	z = _mm_mul_ps(x, x);
+
+	y = _mm_set1_ps(7.0376836292E-2f);
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.1514610310E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.1676998740E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.2420140846E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.4249322787E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.6668057665E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(2.0000714765E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-2.4999993993E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(3.3333331174E-1f));
+	y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+
+	y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+	y = _mm_sub_ps(y, _mm_mul_ps(z, half));
+
+	x = _mm_add_ps(x, y);
+	x = _mm_add_ps(x, _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+
+	return x;
+}
+
+static void log_abs_sse2(const float * re, const float * im, float * out, int n)
+{
+	int i;
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		__m128 r = _mm_loadu_ps(&re[i]);
+		__m128 m = _mm_loadu_ps(&im[i]);
+		__m128 p = _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m));
+		_mm_storeu_ps(&out[i], _mm_mul_ps(half, log_ps_sse2(p)));
+	}
+
+	log_abs_scalar(&re[i], &im[i], &out[i], n - i);
+}
+
+static void cfft_sse2(float * re, float * im)
+{
+	int i, j, h;
+
+	bit_reverse(re, im);
+
+	/* Las dos primeras etapas (h = 1, 2) no llenan un registro */
+	cfft_stages_scalar(re, im, 1, 4);
+
+	for (h = 4; h < QIDX_HALF; h <<= 1)
+	{
+		const float * wr = &tw_re[h-1];
+		const float * wi = &tw_im[h-1];
+
+		for (i = 0; i < QIDX_HALF; i += 2*h)
+		{
+			for (j = 0; j < h; j += 4)
+			{
+				float * ra = &re[i+j];
+				float * ia = &im[i+j];
+				float * rb = ra + h;
+				float * ib = ia + h;
+				__m128 vwr = _mm_loadu_ps(&wr[j]);
+				__m128 vwi = _mm_loadu_ps(&wi[j]);
+				__m128 vrb = _mm_loadu_ps(rb);
+				__m128 vib = _mm_loadu_ps(ib);
+				__m128 vra = _mm_loadu_ps(ra);
+				__m128 via = _mm_loadu_ps(ia);
+				__m128 tr = _mm_sub_ps(_mm_mul_ps(vrb, vwr), _mm_mul_ps(vib, vwi));
+				__m128 ti = _mm_add_ps(_mm_mul_ps(vrb, vwi), _mm_mul_ps(vib, vwr));
+
+				_mm_storeu_ps(rb, _mm_sub_ps(vra, tr));
+				_mm_storeu_ps(ib, _mm_sub_ps(via, ti));
+				_mm_storeu_ps(ra, _mm_add_ps(vra, tr));
+				_mm_storeu_ps(ia, _mm_add_ps(via, ti));
+			}
+		}
+	}
+}
+
+static int cpu_has_sse2(void)
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	unsigned int a, b, c, d;
+	if (!__get_cpuid(1, &a, &b, &c, &d)) return 0;
+	return (d & bit_SSE2) != 0;
+#endif
+}
+
+#endif /* QIDX_HAS_SSE2 */
+
+/* Nucleos de cada implementacion, por qidx_impl_t. Son constantes: cada sesion guarda el indice del suyo */
+static const qidx_kernels_t Kernels[] =
+{
+	{ window_power_scalar, log_abs_scalar, cfft_scalar },		/* QIDX_IMPL_AUTO, no se usa */
+	{ window_power_scalar, log_abs_scalar, cfft_scalar },
+#if QIDX_HAS_SSE2
+	{ window_power_sse2, log_abs_sse2, cfft_sse2 },
+#else
+	{ window_power_scalar, log_abs_scalar, cfft_scalar },
+#endif
+};
+
+/*
+ * Obtiene el bin k (0..QIDX_HALF) de la FFT real de QIDX_BLOCK_SIZE puntos a partir de la FFT
+ * compleja zr/zi de las muestras pares (parte real) e impares (parte imaginaria).
+ */
+static void split_bin(const float * zr, const float * zi, int k, float * xr, float * xi)
+{
+	int k1 = k & (QIDX_HALF-1);
+	int k2 = (QIDX_HALF - k) & (QIDX_HALF-1);
+	float c = split_re[k];
+	float s = split_im[k];
+	float ar = zr[k1] + zr[k2];
+	float ai = zi[k1] - zi[k2];
+	float br = zr[k1] - zr[k2];
+	float bi = zi[k1] + zi[k2];
+
+	*xr = 0.5f * (ar + c*bi - s*br);
+	*xi = 0.5f * (ai - c*br - s*bi);
+}
+
+qidx_impl_t qidx_global_init(void)
+{
+	int i, h;
+	const double PI = 3.14159265358979323846;
+	qidx_impl_t best;
+
+	pj_enter_critical_section();
+
+	if (!Initialized)
+	{
+		for (i = 0; i < QIDX_HALF; i++)
+		{
+			int j, r = 0, v = i;
+			for (j = 0; j < QIDX_LOG2_HALF; j++)
+			{
+				r = (r << 1) | (v & 1);
+				v >>= 1;
+			}
+			brev[i] = (unsigned short) r;
+		}
+
+		for (h = 1; h < QIDX_HALF; h <<= 1)
+		{
+			for (i = 0; i < h; i++)
+			{
+				tw_re[h-1+i] = (float) cos(PI * i / h);
+				tw_im[h-1+i] = (float) -sin(PI * i / h);
+			}
+		}
+
+		for (i = 0; i <= QIDX_HALF; i++)
+		{
+			split_re[i] = (float) cos(2.0 * PI * i / QIDX_BLOCK_SIZE);
+			split_im[i] = (float) sin(2.0 * PI * i / QIDX_BLOCK_SIZE);
+		}
+
+		Best = QIDX_IMPL_SCALAR;
+#if QIDX_HAS_SSE2
+		if (cpu_has_sse2()) Best = QIDX_IMPL_SSE2;
+#endif
+
+		Initialized = 1;
+	}
+	best = Best;
+
+	pj_leave_critical_section();
+
+	return best;
+}
+
+qidx_impl_t qidx_init_impl(qidx_data_t * data, int instance_id, qidx_impl_t impl)
+{
+	/* Best ya no cambia despues de qidx_global_init(), que se llama antes de crear las sesiones */
+	if (impl == QIDX_IMPL_AUTO || impl > Best)
+		impl = Best;
+
+	data->initiated = 1;
+	data->instance_id = instance_id;
+	data->impl = impl;
+	data->blockPos = 0;
+
+	data->lastCepsFreq = 0.0f;
+	data->lastCepsFreqSt = 0.0f;
+	data->quality = 0.0f;
+	data->power = 0.0f;
+	data->sample_max = 0.0f;
+
+	data->fproc = 0;
+
+	return impl;
+}
+
+void qidx_init(qidx_data_t * data, int instance_id)
+{
+	qidx_init_impl(data, instance_id, QIDX_IMPL_AUTO);
+}
+
+void qidx_process_block(qidx_data_t * data)
+{
+	/* Los dos buffers de trabajo de la sesion se reutilizan en cada etapa */
+	const qidx_kernels_t * k = &Kernels[data->impl];
+	float * wa = data->wa;
+	float * wb = data->wb;
+	float * ceps = data->wa;			/* El espectro de wa ya no hace falta cuando se calcula el cepstrum */
+	float power, cepsFreq, cepsFreqSt, cepsFreqSnr, quality;
+	float ceps_noise, maxCeps;
+	int i, cepsFreqIdx;
+
+	/* Ventana y FFT real del bloque: wa = pares | impares */
+	power = k->window_power(data->block, hann512, wa, wa + QIDX_HALF);
+	data->power = power;
+	k->cfft(wa, wa + QIDX_HALF);
+
+	/* Espectro de 0 a FS/2: wb = real[0..256] | imag[0..256] */
+	for (i = 0; i <= QIDX_HALF; i++)
+	{
+		split_bin(wa, wa + QIDX_HALF, i, &wb[i], &wb[QIDX_HALF + 1 + i]);
+	}
+
+	/* Logaritmo del modulo. Es real y par, asi que se completa por simetria */
+	k->log_abs(wb, wb + QIDX_HALF + 1, wa, QIDX_HALF + 1);
+	for (i = 1; i < QIDX_HALF; i++)
+	{
+		wa[QIDX_BLOCK_SIZE - i] = wa[i];
+	}
+
+	/* Cepstrum. La IFFT de una secuencia real y par es la FFT real escalada por 1/N */
+	for (i = 0; i < QIDX_HALF; i++)
+	{
+		wb[i] = wa[2*i];
+		wb[QIDX_HALF + i] = wa[2*i+1];
+	}
+	k->cfft(wb, wb + QIDX_HALF);
+
+	for (i = 0; i < CEPS_LEN; i++)
+	{
+		float cr, ci;
+		split_bin(wb, wb + QIDX_HALF, CEPS_FIRST + i, &cr, &ci);
+		ceps[i] = (float) fabs(cr * (1.0f / QIDX_BLOCK_SIZE));
+	}
+
+	/* Extraction of frequency as maximum of cepstrum on interest band */
+	cepsFreqIdx = CEPS_TONE_IDX_MIN;
+	maxCeps = ceps[CEPS_TONE_IDX_MIN - CEPS_FIRST];
+	ceps_noise = 0.0f;
+	for (i = CEPS_TONE_IDX_MIN; i < CEPS_TONE_IDX_MAX; i++)
+	{
+		float c = ceps[i - CEPS_FIRST];
+		ceps_noise += c;
+		if (c > maxCeps)
+		{
+			maxCeps = c;
+			cepsFreqIdx = i;
+		}
+	}
+	ceps_noise /= CEPS_TONE_IDX_COUNT;
+	cepsFreq = FS/cepsFreqIdx;
+
+	/* Extraction of a measure of the variation of frequency between blocks */
+	cepsFreqSt = 0.7f*(1-(float)fabs((cepsFreq-data->lastCepsFreq)/220.0f))+(0.3f*data->lastCepsFreqSt);
+	data->lastCepsFreqSt = cepsFreqSt;
+	data->lastCepsFreq = cepsFreq;
+
+	/* cepsSNR as mean hold around frequency minus mean of all band */
+	cepsFreqSnr = (ceps[cepsFreqIdx - 1 - CEPS_FIRST] + ceps[cepsFreqIdx - CEPS_FIRST] + ceps[cepsFreqIdx + 1 - CEPS_FIRST]) / 3
+		- ceps_noise;
+
+	/* calculus of quality as the product of cepsSNR and frequency variation */
+	quality = 35.0f * cepsFreqSnr * cepsFreqSt - 1.0f;
+
+	if (power < 5000.0)
+		quality = 0.0f;
+
+	if (quality != quality) /* NAN will not happen with real signals, since it is never all zeros */
+		quality = data->quality;
+	else if (quality > 5.0f)
+		quality = 5.0;
+	else if (quality < 0.0f)
+		quality = 0.0;
+
+	if (quality > data->quality)
+		data->quality = quality*0.25f + data->quality*0.75f;
+	else
+		data->quality = quality*0.005f + data->quality*0.995f;
+
+	data->fproc = 1;
+
+	/* El siguiente bloque empieza con la segunda mitad de este */
+	memcpy(data->block, data->block + (QIDX_BLOCK_SIZE - QIDX_BLOCK_OVERLAP), QIDX_BLOCK_OVERLAP * sizeof(float));
+	data->blockPos = QIDX_BLOCK_OVERLAP;
+}
+
+int qidx_process(qidx_data_t * data, const float * v, int count)
+{
+	int i;
+
+	if (!data->initiated)
+		return -1;
+
+	if (data->instance_id > 0)
+	{
+		data->instance_id--;
+		return 1;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		float abs_sample = v[i] > 0 ? v[i] : -v[i];
+		if (abs_sample > data->sample_max) data->sample_max = abs_sample;
+
+		data->block[data->blockPos++] = v[i];
+		if (data->blockPos == QIDX_BLOCK_SIZE)
+		{
+			qidx_process_block(data);
+		}
+	}
+
+	return 0;
+}
+
+int qidx_quality_indicator(const qidx_data_t * data)
+{
+	return (int) (data->quality*10.0f + 0.5f);	// x10 y redondeo para tener valores de 0 a 50
+}
+
+float qidx_quality_indicator_float(const qidx_data_t * data)
+{
+	return data->quality;
+}
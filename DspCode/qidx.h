@@ -0,0 +1,110 @@
+#ifndef QIDX_H_
+#define QIDX_H_
+
+/*
+ * Motor de calculo del indicador de calidad (Qidx) del BSS.
+ *
+ * Hace el mismo calculo que processor.c (cepstrum sobre bloques de 512 muestras con
+ * solape de 256 y ventana de Hann) pero:
+ *  - Usa una FFT de entrada real (FFT compleja de 256 puntos y separacion de espectros),
+ *    tanto para el espectro como para el cepstrum.
+ *  - Solo calcula el cepstrum en la banda de interes (FS/300 .. FS/80).
+ *  - No reserva memoria ni usa arrays grandes en la pila. El estado por sesion son las
+ *    512 muestras del bloque en curso y los dos buffers de trabajo de la FFT.
+ *  - El modulo y el logaritmo del espectro tienen version escalar y SSE2. La version
+ *    se elige en tiempo de ejecucion al inicializar cada sesion.
+ *
+ * Los resultados coinciden con los de quality_indicator() salvo errores de redondeo.
+ */
+
+#define QIDX_BLOCK_SIZE		(512)
+#define QIDX_BLOCK_OVERLAP	(QIDX_BLOCK_SIZE/2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+	/*
+	 * Tipos de implementacion de los nucleos vectorizables
+	 */
+	typedef enum qidx_impl
+	{
+		QIDX_IMPL_AUTO = 0,		/* La mejor disponible en la CPU */
+		QIDX_IMPL_SCALAR,
+		QIDX_IMPL_SSE2
+	} qidx_impl_t;
+
+	/*
+	 * Estado del calculo para una señal.
+	 */
+	typedef struct qidx_data
+	{
+		int initiated;
+		int instance_id;
+		qidx_impl_t impl;					/* Implementacion de los nucleos que usa esta sesion */
+
+		float block[QIDX_BLOCK_SIZE];		/* Muestras del bloque en curso */
+		int blockPos;						/* Numero de muestras en block */
+
+		float wa[QIDX_BLOCK_SIZE];			/* Buffers de trabajo de qidx_process_block(). Estan aqui */
+		float wb[QIDX_BLOCK_SIZE + 2];		/* y no en la pila de los hilos de RTP */
+
+		float lastCepsFreq;
+		float lastCepsFreqSt;
+		float quality;
+		float power;						/* Potencia del ultimo bloque procesado */
+		float sample_max;
+
+		char fproc;							/* Indica que se ha procesado al menos un bloque */
+	} qidx_data_t;
+
+	/*
+	 * Inicializa las tablas comunes (giros de la FFT, inversion de bits) y detecta la mejor implementacion
+	 * de la CPU. Hay que llamarla una vez, despues de pj_init() y antes de qidx_init(). Las tablas solo se
+	 * calculan en la primera llamada; las siguientes no cambian nada.
+	 * Retorna la mejor implementacion disponible.
+	 */
+	qidx_impl_t qidx_global_init(void);
+
+	/*
+	 * Inicializacion de la estructura de datos, con la mejor implementacion disponible.
+	 * Las primeras instance_id llamadas a qidx_process() son descartadas para repartir la carga de la CPU
+	 * entre las diferentes instancias.
+	 */
+	void qidx_init(qidx_data_t * data, int instance_id);
+
+	/*
+	 * Como qidx_init() pero con la implementacion impl. Si no esta disponible en la CPU se usa la escalar.
+	 * La implementacion es de cada sesion, asi que no afecta a las que ya estan en marcha.
+	 * Retorna la implementacion que usara la sesion.
+	 */
+	qidx_impl_t qidx_init_impl(qidx_data_t * data, int instance_id, qidx_impl_t impl);
+
+	/*
+	 * Procesa count muestras nuevas. Cada vez que se completa un bloque se calcula el indicador.
+	 * Retorna 0 si no hay error, 1 si las muestras se han descartado por instance_id y -1 si la estructura
+	 * no esta inicializada.
+	 */
+	int qidx_process(qidx_data_t * data, const float * v, int count);
+
+	/*
+	 * Calcula el indicador sobre el bloque completo de data y desplaza el bloque QIDX_BLOCK_OVERLAP muestras.
+	 * Lo usa qidx_process(). Se exporta para quien acumula las muestras por su cuenta.
+	 */
+	void qidx_process_block(qidx_data_t * data);
+
+	/*
+	 * Indicador de calidad actual en numero entero (0 - 50)
+	 */
+	int qidx_quality_indicator(const qidx_data_t * data);
+
+	/*
+	 * Indicador de calidad actual en numero flotante (0.0f - 5.0f)
+	 */
+	float qidx_quality_indicator_float(const qidx_data_t * data);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif /* QIDX_H_ */
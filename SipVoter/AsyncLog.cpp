@@ -0,0 +1,753 @@
+/**
+ * @file AsyncLog.cpp
+ * @brief Escritura asincrona del log de pjsua en CORESIP.dll
+ *
+ *	Implementa la clase 'AsyncLog'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include "Global.h"
+#include "Exceptions.h"
+#include "AsyncLog.h"
+
+#include <limits.h>
+
+/** Decoracion de fecha y hora, que pone AsyncLog en lugar de pj_log */
+#define TIME_DECOR	(PJ_LOG_HAS_DAY_NAME | PJ_LOG_HAS_YEAR | PJ_LOG_HAS_MONTH | PJ_LOG_HAS_DAY_OF_MON | \
+					 PJ_LOG_HAS_TIME | PJ_LOG_HAS_MICRO_SEC)
+
+/** Espacio que ocupa en el buffer un mensaje de 'len' bytes */
+#define RECORD_SIZE(len)	((unsigned)(sizeof(Record) + (len) + 7) & ~7U)
+
+std::atomic<int> AsyncLog::_Async(0);
+std::atomic<unsigned> AsyncLog::_Written(0);
+std::atomic<unsigned> AsyncLog::_Dropped(0);
+std::atomic<unsigned> AsyncLog::_Suppressed(0);
+
+AsyncLog::Ring * AsyncLog::_Rings[AsyncLog::MAX_RINGS];
+std::atomic<unsigned> AsyncLog::_NRings(0);
+AsyncLog::Ring * AsyncLog::_FreeRings = NULL;
+std::mutex AsyncLog::_RingsLock;
+thread_local AsyncLog::Owner AsyncLog::_Owner = { NULL };
+unsigned AsyncLog::_RingSize = 0;
+unsigned AsyncLog::_RepeatMax = 0;
+
+pj_pool_t * AsyncLog::_Pool = NULL;
+pj_thread_t * AsyncLog::_Thread = NULL;
+std::atomic<bool> AsyncLog::_Run(false);
+
+std::mutex AsyncLog::_OutLock;
+FILE * AsyncLog::_File = NULL;
+char AsyncLog::_FileName[256];
+void (*AsyncLog::_Cb)(int level, const char * data, int len) = NULL;
+int AsyncLog::_ConsoleLevel = 0;
+std::atomic<int> AsyncLog::_MaxLevel(0);
+unsigned AsyncLog::_Decor = 0;
+char * AsyncLog::_Line = NULL;
+char * AsyncLog::_Batch = NULL;
+unsigned AsyncLog::_BatchLen = 0;
+unsigned AsyncLog::_DroppedReported = 0;
+
+/**
+ * Init.	...
+ * Arranca el thread de escritura. A partir de aqui Write() deja los mensajes en los buffers.
+ * @param	ring_kb		Tamano del buffer de cada thread, en KB. Se redondea a potencia de 2.
+ * @param	repeat_max	Mensajes parecidos por segundo y thread que se escriben. 0 sin limite.
+ * @return	nada.
+ */
+void AsyncLog::Init(unsigned ring_kb, unsigned repeat_max)
+{
+	if (_Thread != NULL)
+	{
+		return;
+	}
+
+	if (_Line == NULL)
+	{
+		//Se usan tambien despues de End(), asi que no salen del pool
+		_Line = new char[LINE_SIZE];
+		_Batch = new char[BATCH_SIZE];
+	}
+
+	if (ring_kb < 8) ring_kb = 8;
+	if (ring_kb > 1024) ring_kb = 1024;
+	_RingSize = 1;
+	while (_RingSize < ring_kb * 1024) _RingSize <<= 1;
+	_RepeatMax = repeat_max;
+
+	_Pool = pjsua_pool_create("AsyncLog", 512, 512);
+	if (_Pool == NULL)
+	{
+		throw PJLibException(__FILE__, PJ_ENOMEM).Msg("ERROR creando pool del log");
+	}
+
+	_Run = true;
+	_Async = 1;
+
+	pj_status_t st = pj_thread_create(_Pool, "AsyncLog", &FlushThread, NULL, 0, 0, &_Thread);
+	if (st != PJ_SUCCESS)
+	{
+		_Async = 0;
+		_Thread = NULL;
+		pj_pool_release(_Pool);
+		_Pool = NULL;
+	}
+	PJ_CHECK_STATUS(st, ("ERROR creando thread del log"));
+}
+
+/**
+ * Configure.	...
+ * Se queda con la salida de la configuracion de log de pjsua (fichero, callback, nivel de consola
+ * y decoracion de la hora) y la cambia para que pjsua pase todos los mensajes a Write().
+ * Sin Init() no hace nada.
+ * @param	logCfg	Configuracion que se va a pasar a pjsua_init o pjsua_reconfigure_logging.
+ * @return	PJ_SUCCESS o el error al abrir el fichero.
+ */
+pj_status_t AsyncLog::Configure(pjsua_logging_config * logCfg)
+{
+	if (!_Async)
+	{
+		return PJ_SUCCESS;
+	}
+
+	std::lock_guard<std::mutex> lock(_OutLock);
+
+	_Cb = logCfg->cb;
+	_ConsoleLevel = (int) logCfg->console_level;
+	_Decor = logCfg->decor;
+
+	if (logCfg->log_filename.slen > 0)
+	{
+		char name[sizeof(_FileName)];
+		pj_ansi_snprintf(name, sizeof(name), "%.*s", (int) logCfg->log_filename.slen, logCfg->log_filename.ptr);
+
+		if (_File == NULL || strcmp(name, _FileName) != 0)
+		{
+			FlushBatch();
+			if (_File != NULL)
+			{
+				fclose(_File);
+			}
+			_File = fopen(name, "wb");
+			if (_File == NULL)
+			{
+				_MaxLevel.store(_ConsoleLevel);
+				return pj_get_os_error();
+			}
+			pj_ansi_strcpy(_FileName, name);
+		}
+	}
+	else if (_File != NULL)
+	{
+		FlushBatch();
+		fclose(_File);
+		_File = NULL;
+	}
+
+	//Sin fichero solo se escribe hasta el nivel de consola, como en pjsua
+	_MaxLevel.store(_File != NULL ? INT_MAX : _ConsoleLevel);
+
+	logCfg->cb = &AsyncLog::Write;
+	logCfg->log_filename.slen = 0;
+	logCfg->decor &= ~TIME_DECOR;
+	logCfg->console_level = logCfg->level;
+
+	return PJ_SUCCESS;
+}
+
+/**
+ * End.	...
+ * Para el thread de escritura tras escribir lo que quede en los buffers. Hay que llamarla antes de
+ * pjsua_destroy. El fichero sigue abierto para lo que se escriba despues.
+ * @return	nada.
+ */
+void AsyncLog::End()
+{
+	if (_Thread == NULL)
+	{
+		return;
+	}
+
+	//Los threads que esten dejando un mensaje lo terminan, y los siguientes ya escriben directamente
+	_Async.store(0);
+	unsigned n = _NRings.load();
+	for (unsigned i = 0; i < n; i++)
+	{
+		while (_Rings[i]->busy.load())
+		{
+			pj_thread_sleep(0);
+		}
+	}
+
+	_Run = false;
+	pj_thread_join(_Thread);
+	pj_thread_destroy(_Thread);
+	_Thread = NULL;
+
+	pj_pool_release(_Pool);
+	_Pool = NULL;
+}
+
+/**
+ * Active.	...
+ * @return	PJ_TRUE si los mensajes se escriben desde el thread de escritura.
+ */
+pj_bool_t AsyncLog::Active()
+{
+	return _Async.load() ? PJ_TRUE : PJ_FALSE;
+}
+
+/**
+ * GetStats.	...
+ * @param	stats	Mensajes escritos, descartados por falta de espacio y suprimidos por repetidos.
+ * @return	nada.
+ */
+void AsyncLog::GetStats(CORESIP_LogStats * stats)
+{
+	stats->Written = _Written.load(std::memory_order_relaxed);
+	stats->Dropped = _Dropped.load(std::memory_order_relaxed);
+	stats->Suppressed = _Suppressed.load(std::memory_order_relaxed);
+}
+
+/**
+ * Write.	...
+ * Callback de log de pjsua. Se llama desde el thread que genera el mensaje, con el log de ese
+ * thread suspendido por pj_log.
+ * @param	level	Nivel del mensaje.
+ * @param	data	Mensaje formateado por pj_log, sin la hora.
+ * @param	len		Longitud del mensaje.
+ * @return	nada.
+ */
+void AsyncLog::Write(int level, const char * data, int len)
+{
+	pj_time_val now;
+
+	if (len <= 0 || level > _MaxLevel.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	pj_gettimeofday(&now);
+
+	if (_Async.load(std::memory_order_acquire))
+	{
+		Ring * r = GetRing();
+		if (r != NULL)
+		{
+			r->busy.store(1);
+			if (_Async.load())
+			{
+				if (!Repeated(r, level, now, data, (unsigned) len))
+				{
+					Push(r, level, now, data, (unsigned) len);
+				}
+				r->busy.store(0, std::memory_order_release);
+				return;
+			}
+			r->busy.store(0, std::memory_order_release);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(_OutLock);
+	Output(level, now, data, (unsigned) len);
+	FlushBatch();
+}
+
+/**
+ * ~Owner.	...
+ * Fin del thread. Su buffer pasa a la lista de libres. Los suprimidos pendientes los notifica el thread de
+ * escritura o, si el buffer se reutiliza antes, el thread que lo reutiliza.
+ */
+AsyncLog::Owner::~Owner()
+{
+	if (ring != NULL)
+	{
+		std::lock_guard<std::mutex> lock(_RingsLock);
+		ring->next = _FreeRings;
+		_FreeRings = ring;
+		ring = NULL;
+	}
+}
+
+/**
+ * GetRing.	...
+ * Buffer del thread actual. La primera vez que el thread escribe en el log se le da uno libre o se crea.
+ * @return	El buffer, o NULL si no quedan y el thread tiene que escribir directamente.
+ */
+AsyncLog::Ring * AsyncLog::GetRing()
+{
+	Ring * r = _Owner.ring;
+	if (r != NULL)
+	{
+		return r;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_RingsLock);
+		if (_FreeRings != NULL)
+		{
+			r = _FreeRings;
+			_FreeRings = r->next;
+		}
+	}
+	if (r != NULL)
+	{
+		//Los mensajes repetidos se limitan por thread: se notifica lo suprimido al anterior y se empieza de cero
+		std::lock_guard<std::mutex> lock(r->pat_lock);
+		pj_time_val now;
+		pj_gettimeofday(&now);
+		for (unsigned i = 0; i < MAX_PATTERNS; i++)
+		{
+			Summary(r, &r->pat[i], now);
+			r->pat[i].used = false;
+		}
+		r->pat_next = 0;
+
+		_Owner.ring = r;
+		return r;
+	}
+
+	if (_NRings.load(std::memory_order_relaxed) >= MAX_RINGS)
+	{
+		return NULL;
+	}
+
+	r = new Ring;
+	r->size = _RingSize;
+	r->mask = _RingSize - 1;
+	r->buf = new char[_RingSize];
+	r->wr.store(0);
+	r->rd.store(0);
+	r->busy.store(0);
+	memset(r->pat, 0, sizeof(r->pat));
+	r->pat_next = 0;
+	r->next = NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(_RingsLock);
+		unsigned n = _NRings.load(std::memory_order_relaxed);
+		if (n < MAX_RINGS)
+		{
+			_Rings[n] = r;
+			_NRings.store(n + 1, std::memory_order_release);
+		}
+		else
+		{
+			delete [] r->buf;
+			delete r;
+			return NULL;
+		}
+	}
+
+	_Owner.ring = r;
+	return r;
+}
+
+/**
+ * Push.	...
+ * Productor. Deja un mensaje en el buffer del thread. Si no cabe se descarta.
+ * @return	true si se ha guardado.
+ */
+bool AsyncLog::Push(Ring * r, int level, const pj_time_val & t, const char * data, unsigned len)
+{
+	//Un mensaje no ocupa mas de la mitad del buffer
+	if (RECORD_SIZE(len) > r->size / 2)
+	{
+		len = r->size / 2 - sizeof(Record) - 8;
+	}
+	unsigned need = RECORD_SIZE(len);
+
+	unsigned wr = r->wr.load(std::memory_order_relaxed);
+	unsigned space = r->size - (wr - r->rd.load(std::memory_order_acquire));
+	unsigned room = r->size - (wr & r->mask);
+	unsigned skip = room < need ? room : 0;
+
+	if (skip + need > space)
+	{
+		_Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	if (skip > 0)
+	{
+		//No cabe hasta el final: se marca y se sigue al principio
+		if (room >= sizeof(Record))
+		{
+			((Record *) (r->buf + (wr & r->mask)))->len = WRAP;
+		}
+		wr += skip;
+	}
+
+	Record * rec = (Record *) (r->buf + (wr & r->mask));
+	rec->len = len;
+	rec->level = level;
+	rec->t = t;
+	memcpy(rec + 1, data, len);
+
+	r->wr.store(wr + need, std::memory_order_release);
+	return true;
+}
+
+/**
+ * Repeated.	...
+ * Productor. Cuenta el mensaje entre los parecidos (iguales salvo en los digitos) del segundo en
+ * curso y notifica los suprimidos de los segundos ya terminados. Con pat_lock, que solo coge ademas
+ * el thread de escritura cada FLUSH_MS.
+ * @return	true si el mensaje se suprime.
+ */
+bool AsyncLog::Repeated(Ring * r, int level, const pj_time_val & t, const char * data, unsigned len)
+{
+	if (_RepeatMax == 0)
+	{
+		return false;
+	}
+
+	pj_uint32_t now_ms = (pj_uint32_t) (t.sec * 1000 + t.msec);
+	pj_uint32_t hash = 2166136261U;
+	for (unsigned i = 0; i < len; i++)
+	{
+		char c = data[i];
+		if (c >= '0' && c <= '9') continue;
+		hash = (hash ^ (pj_uint8_t) c) * 16777619U;
+	}
+
+	std::lock_guard<std::mutex> lock(r->pat_lock);
+
+	Pattern * p = NULL;
+	for (unsigned i = 0; i < MAX_PATTERNS; i++)
+	{
+		Pattern * q = &r->pat[i];
+		if (!q->used) continue;
+
+		if (now_ms - q->t0_ms >= 1000)
+		{
+			Summary(r, q, t);
+			q->t0_ms = now_ms;
+			q->count = 0;
+		}
+		if (q->hash == hash)
+		{
+			p = q;
+		}
+	}
+
+	if (p == NULL)
+	{
+		p = &r->pat[r->pat_next];
+		r->pat_next = (r->pat_next + 1) % MAX_PATTERNS;
+		Summary(r, p, t);
+
+		p->used = true;
+		p->hash = hash;
+		p->t0_ms = now_ms;
+		p->count = 1;
+		p->suppressed = 0;
+		p->level = level;
+		unsigned n = 0;
+		while (n < len && n < sizeof(p->sample) - 1 && data[n] != '\r' && data[n] != '\n')
+		{
+			p->sample[n] = data[n];
+			n++;
+		}
+		p->sample[n] = '\0';
+		return false;
+	}
+
+	if (p->count >= _RepeatMax)
+	{
+		p->suppressed++;
+		_Suppressed.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	p->count++;
+	return false;
+}
+
+/**
+ * Summary.	...
+ * Productor. Escribe cuantos mensajes parecidos a 'p' se han suprimido, si hay alguno. Con pat_lock.
+ * @return	nada.
+ */
+void AsyncLog::Summary(Ring * r, Pattern * p, const pj_time_val & t)
+{
+	if (p->suppressed == 0)
+	{
+		return;
+	}
+
+	char buf[128];
+	int len = FormatSummary(p, buf, sizeof(buf));
+	if (len > 0)
+	{
+		Push(r, p->level, t, buf, (unsigned) len);
+	}
+	p->suppressed = 0;
+}
+
+/**
+ * FormatSummary.	...
+ * Texto que notifica los mensajes parecidos a 'p' suprimidos.
+ * @return	Longitud del texto, recortado a 'size' - 1.
+ */
+int AsyncLog::FormatSummary(Pattern * p, char * buf, unsigned size)
+{
+	int len = pj_ansi_snprintf(buf, size, "%s... (%u mensajes parecidos suprimidos)%s",
+		p->sample, p->suppressed, (_Decor & PJ_LOG_HAS_NEWLINE) ? "\n" : "");
+	return len < (int) size ? len : (int) size - 1;
+}
+
+/**
+ * FlushSummaries.	...
+ * Consumidor. Escribe los suprimidos de los segundos ya terminados de los threads que no han vuelto a
+ * escribir, o que ya no existen. Con _OutLock cogido.
+ * @return	nada.
+ */
+void AsyncLog::FlushSummaries()
+{
+	if (_RepeatMax == 0)
+	{
+		return;
+	}
+
+	pj_time_val now;
+	pj_gettimeofday(&now);
+	pj_uint32_t now_ms = (pj_uint32_t) (now.sec * 1000 + now.msec);
+
+	unsigned n = _NRings.load(std::memory_order_acquire);
+	for (unsigned i = 0; i < n; i++)
+	{
+		std::lock_guard<std::mutex> lock(_Rings[i]->pat_lock);
+
+		for (unsigned j = 0; j < MAX_PATTERNS; j++)
+		{
+			Pattern * p = &_Rings[i]->pat[j];
+			if (p->used && p->suppressed > 0 && now_ms - p->t0_ms >= 1000)
+			{
+				char buf[128];
+				int len = FormatSummary(p, buf, sizeof(buf));
+				if (len > 0)
+				{
+					Output(p->level, now, buf, (unsigned) len);
+				}
+				p->suppressed = 0;
+			}
+		}
+	}
+}
+
+/**
+ * Peek.	...
+ * Consumidor. Siguiente mensaje del buffer a partir de 'pos', saltando el final del buffer.
+ * @return	El mensaje, o NULL si se ha llegado a 'end'.
+ */
+const AsyncLog::Record * AsyncLog::Peek(Ring * r, unsigned & pos, unsigned end)
+{
+	while (pos != end)
+	{
+		unsigned off = pos & r->mask;
+		unsigned room = r->size - off;
+		const Record * rec = (const Record *) (r->buf + off);
+
+		if (room < sizeof(Record) || rec->len == WRAP)
+		{
+			pos += room;
+			continue;
+		}
+		return rec;
+	}
+	return NULL;
+}
+
+/**
+ * FlushThread.	...
+ * Thread de escritura.
+ * @return	0.
+ */
+int AsyncLog::FlushThread(void * proc)
+{
+	PJ_UNUSED_ARG(proc);
+
+	while (_Run.load())
+	{
+		pj_thread_sleep(FLUSH_MS);
+		Flush();
+	}
+	Flush();
+
+	return 0;
+}
+
+/**
+ * Flush.	...
+ * Consumidor. Escribe, por orden de hora, los mensajes que hay en los buffers al empezar.
+ * @return	nada.
+ */
+void AsyncLog::Flush()
+{
+	unsigned pos[MAX_RINGS], end[MAX_RINGS];
+	unsigned n = _NRings.load(std::memory_order_acquire);
+
+	for (unsigned i = 0; i < n; i++)
+	{
+		pos[i] = _Rings[i]->rd.load(std::memory_order_relaxed);
+		end[i] = _Rings[i]->wr.load(std::memory_order_acquire);
+	}
+
+	std::lock_guard<std::mutex> lock(_OutLock);
+
+	for (;;)
+	{
+		int best = -1;
+		const Record * best_rec = NULL;
+
+		for (unsigned i = 0; i < n; i++)
+		{
+			const Record * rec = Peek(_Rings[i], pos[i], end[i]);
+			if (rec != NULL && (best_rec == NULL || PJ_TIME_VAL_LT(rec->t, best_rec->t)))
+			{
+				best = (int) i;
+				best_rec = rec;
+			}
+		}
+		if (best_rec == NULL)
+		{
+			break;
+		}
+
+		Output(best_rec->level, best_rec->t, (const char *) (best_rec + 1), best_rec->len);
+		pos[best] += RECORD_SIZE(best_rec->len);
+		_Rings[best]->rd.store(pos[best], std::memory_order_release);
+	}
+
+	for (unsigned i = 0; i < n; i++)
+	{
+		_Rings[i]->rd.store(pos[i], std::memory_order_release);
+	}
+
+	unsigned dropped = _Dropped.load(std::memory_order_relaxed);
+	if (dropped != _DroppedReported)
+	{
+		pj_time_val now;
+		char buf[128];
+
+		pj_gettimeofday(&now);
+		int len = pj_ansi_snprintf(buf, sizeof(buf), "%s%u mensajes de log descartados por falta de espacio%s",
+			(_Decor & PJ_LOG_HAS_SENDER) ? "       AsyncLog " : "", dropped - _DroppedReported,
+			(_Decor & PJ_LOG_HAS_NEWLINE) ? "\n" : "");
+		if (len > 0 && len < (int) sizeof(buf))
+		{
+			Output(2, now, buf, (unsigned) len);
+		}
+		_DroppedReported = dropped;
+	}
+
+	FlushSummaries();
+	FlushBatch();
+}
+
+/**
+ * Output.	...
+ * Escribe un mensaje con la hora delante en el fichero y, segun su nivel, en la consola o en el
+ * callback de la aplicacion, como lo haria pjsua. Con _OutLock cogido.
+ * @return	nada.
+ */
+void AsyncLog::Output(int level, const pj_time_val & t, const char * data, unsigned len)
+{
+	char * pre = _Line;
+
+	if (_Decor & TIME_DECOR)
+	{
+		static const char *wdays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+		pj_parsed_time ptime;
+
+		pj_time_decode(&t, &ptime);
+		if (_Decor & PJ_LOG_HAS_DAY_NAME)
+		{
+			pj_ansi_strcpy(pre, wdays[ptime.wday]);
+			pre += 3;
+		}
+		if (_Decor & PJ_LOG_HAS_YEAR)
+		{
+			*pre++ = ' ';
+			pre += pj_utoa(ptime.year, pre);
+		}
+		if (_Decor & PJ_LOG_HAS_MONTH)
+		{
+			*pre++ = '-';
+			pre += pj_utoa_pad(ptime.mon + 1, pre, 2, '0');
+		}
+		if (_Decor & PJ_LOG_HAS_DAY_OF_MON)
+		{
+			*pre++ = '-';
+			pre += pj_utoa_pad(ptime.day, pre, 2, '0');
+		}
+		if (_Decor & PJ_LOG_HAS_TIME)
+		{
+			*pre++ = ' ';
+			pre += pj_utoa_pad(ptime.hour, pre, 2, '0');
+			*pre++ = ':';
+			pre += pj_utoa_pad(ptime.min, pre, 2, '0');
+			*pre++ = ':';
+			pre += pj_utoa_pad(ptime.sec, pre, 2, '0');
+		}
+		if (_Decor & PJ_LOG_HAS_MICRO_SEC)
+		{
+			*pre++ = '.';
+			pre += pj_utoa_pad(ptime.msec, pre, 3, '0');
+		}
+	}
+
+	unsigned max = LINE_SIZE - 1 - (unsigned) (pre - _Line);
+	if (len > max) len = max;
+	memcpy(pre, data, len);
+	pre += len;
+	*pre = '\0';
+	len = (unsigned) (pre - _Line);
+
+	if (_File != NULL)
+	{
+		if (_BatchLen + len > BATCH_SIZE)
+		{
+			FlushBatch();
+		}
+		memcpy(_Batch + _BatchLen, _Line, len);
+		_BatchLen += len;
+	}
+	else if (level > _ConsoleLevel)
+	{
+		return;
+	}
+
+	if (level <= _ConsoleLevel)
+	{
+		if (_Cb != NULL)
+		{
+			_Cb(level, _Line, (int) len);
+		}
+		else
+		{
+			fwrite(_Line, 1, len, stdout);
+		}
+	}
+
+	_Written.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * FlushBatch.	...
+ * Escribe en el fichero lo acumulado por Output(). Con _OutLock cogido.
+ * @return	nada.
+ */
+void AsyncLog::FlushBatch()
+{
+	if (_File != NULL && _BatchLen > 0)
+	{
+		fwrite(_Batch, 1, _BatchLen, _File);
+		fflush(_File);
+	}
+	_BatchLen = 0;
+}
+
+/*@}*/
@@ -0,0 +1,147 @@
+/**
+ * @file AsyncLog.h
+ * @brief Escritura asincrona del log de pjsua en CORESIP.dll
+ *
+ *	Implementa la clase 'AsyncLog'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_ASYNCLOG_H__
+#define __CORESIP_ASYNCLOG_H__
+
+#include <atomic>
+#include <mutex>
+
+/**
+ * AsyncLog.
+ * Saca la escritura del log de los threads de pjsip y de media. Cada thread que escribe en el log
+ * deja los mensajes, ya formateados por pj_log, en su propio buffer circular (un productor y un
+ * consumidor, sin mutex) junto con la hora a la que se generaron. Un thread propio los recoge
+ * periodicamente, los ordena por hora, les pone la hora delante y los escribe de una vez en el
+ * fichero, o los pasa al callback de log de la aplicacion.
+ *
+ * Si el buffer de un thread se llena los mensajes se descartan y se cuentan. Los mensajes que se
+ * repiten mucho (iguales salvo en los numeros) se limitan por thread a un numero por segundo, y se
+ * escribe cuantos se han suprimido: el propio thread cuando vuelve a escribir, o el thread de
+ * escritura si ha pasado el segundo y el thread no ha vuelto a escribir.
+ *
+ * Cuando un thread termina su buffer pasa a una lista de libres, y lo reutiliza el siguiente thread
+ * que escriba en el log. El thread de escritura sigue vaciandolo mientras tanto.
+ *
+ * Tras End() los mensajes se escriben directamente desde el thread que los genera.
+ */
+class AsyncLog
+{
+public:
+	static void Init(unsigned ring_kb, unsigned repeat_max);
+	static pj_status_t Configure(pjsua_logging_config * logCfg);
+	static void End();
+	static pj_bool_t Active();
+	static void GetStats(CORESIP_LogStats * stats);
+
+	static void Write(int level, const char * data, int len);
+
+private:
+	static const unsigned MAX_RINGS = 128;			//Threads con buffer propio. El resto escribe directamente
+	static const unsigned MAX_PATTERNS = 8;			//Mensajes repetidos que se siguen por thread
+	static const unsigned FLUSH_MS = 50;			//Periodo del thread de escritura
+	static const unsigned BATCH_SIZE = 64 * 1024;	//Bytes que se acumulan antes de escribir en el fichero
+	static const unsigned LINE_SIZE = PJ_LOG_MAX_SIZE + 64;
+
+	/** Cabecera de cada mensaje en el buffer. Le sigue el texto, y todo se alinea a 8 bytes */
+	struct Record
+	{
+		pj_uint32_t len;							//Longitud del texto. WRAP indica que se sigue al principio del buffer
+		int level;
+		pj_time_val t;
+	};
+	static const pj_uint32_t WRAP = 0xFFFFFFFF;
+
+	/** Mensaje que se repite, para limitarlo */
+	struct Pattern
+	{
+		bool used;
+		pj_uint32_t hash;							//Hash del texto sin los digitos
+		pj_uint32_t t0_ms;							//Inicio del segundo en curso
+		unsigned count;								//Mensajes escritos en el segundo en curso
+		unsigned suppressed;						//Mensajes suprimidos pendientes de notificar
+		int level;
+		char sample[48];							//Principio del primer mensaje, para la notificacion
+	};
+
+	/** Buffer de un thread */
+	struct Ring
+	{
+		char * buf;
+		unsigned size;
+		unsigned mask;
+		std::atomic<unsigned> wr;					//Posicion de escritura. La publica el thread que genera el log
+		std::atomic<unsigned> rd;					//Hasta donde ha leido el thread de escritura
+		std::atomic<int> busy;						//El thread esta escribiendo en el buffer. Lo espera End()
+
+		//Estado del thread que genera el log. El thread de escritura solo lo usa para notificar suprimidos
+		std::mutex pat_lock;
+		Pattern pat[MAX_PATTERNS];
+		unsigned pat_next;
+
+		Ring * next;								//Lista de libres, con _RingsLock
+	};
+
+	/** Buffer del thread actual. Al terminar el thread lo devuelve a la lista de libres */
+	struct Owner
+	{
+		Ring * ring;
+		~Owner();
+	};
+
+	static std::atomic<int> _Async;
+	static std::atomic<unsigned> _Written;
+	static std::atomic<unsigned> _Dropped;
+	static std::atomic<unsigned> _Suppressed;
+
+	//Los buffers no se liberan nunca: un thread puede estar usando el suyo mientras se para el log.
+	//Los de los threads que terminan se reutilizan
+	static Ring * _Rings[MAX_RINGS];
+	static std::atomic<unsigned> _NRings;
+	static Ring * _FreeRings;
+	static std::mutex _RingsLock;
+	static thread_local Owner _Owner;
+	static unsigned _RingSize;
+	static unsigned _RepeatMax;
+
+	static pj_pool_t * _Pool;
+	static pj_thread_t * _Thread;
+	static std::atomic<bool> _Run;
+
+	//Salida. Protegida por _OutLock
+	static std::mutex _OutLock;
+	static FILE * _File;
+	static char _FileName[256];
+	static void (*_Cb)(int level, const char * data, int len);
+	static int _ConsoleLevel;
+	static std::atomic<int> _MaxLevel;				//Nivel hasta el que se escribe. Se cambia con _OutLock
+	static unsigned _Decor;							//Decoracion original. La hora la pone AsyncLog
+	static char * _Line;
+	static char * _Batch;
+	static unsigned _BatchLen;
+	static unsigned _DroppedReported;
+
+	static Ring * GetRing();
+	static bool Push(Ring * r, int level, const pj_time_val & t, const char * data, unsigned len);
+	static bool Repeated(Ring * r, int level, const pj_time_val & t, const char * data, unsigned len);
+	static void Summary(Ring * r, Pattern * p, const pj_time_val & t);
+	static int FormatSummary(Pattern * p, char * buf, unsigned size);
+	static void FlushSummaries();
+	static const Record * Peek(Ring * r, unsigned & pos, unsigned end);
+
+	static int FlushThread(void * proc);
+	static void Flush();
+	static void Output(int level, const pj_time_val & t, const char * data, unsigned len);
+	static void FlushBatch();
+};
+
+#endif
+
+/*@}*/
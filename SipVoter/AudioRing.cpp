@@ -0,0 +1,215 @@
+/**
+ * @file AudioRing.cpp
+ * @brief Buffer circular de audio sin bloqueos para un productor y un consumidor en CORESIP.dll
+ *
+ *	Implementa la clase 'AudioRing'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include "Global.h"
+#include "Exceptions.h"
+#include "AudioRing.h"
+
+/**
+ * AudioRing.	...
+ * Constructor. Reserva el buffer del pool.
+ * @param	pool			Pool de donde se reserva el buffer.
+ * @param	min_capacity	Numero minimo de muestras. Se redondea a la siguiente potencia de 2.
+ * @return	nada.
+ */
+AudioRing::AudioRing(pj_pool_t *pool, unsigned min_capacity)
+{
+	capacity = 1;
+	while (capacity < min_capacity) capacity <<= 1;
+	mask = capacity - 1;
+
+	buf = (pj_int16_t *) pj_pool_zalloc(pool, capacity * sizeof(pj_int16_t));
+	if (buf == NULL)
+	{
+		throw PJLibException(__FILE__, PJ_ENOMEM).Msg("ERROR Creando buffer circular");
+	}
+
+	wr.store(0);
+	rd_free.store(0);
+	restart_gen.store(0);
+	restart_pos.store(0);
+	restart_delay.store(0);
+	rd = 0;
+	zero_until = 0;
+	last_gen = 0;
+}
+
+/**
+ * ~AudioRing.	...
+ * Destructor. El buffer se libera con el pool.
+ * @return	nada.
+ */
+AudioRing::~AudioRing()
+{
+}
+
+/**
+ * Space.	...
+ * Productor. Muestras que se pueden escribir sin pisar las que el consumidor no ha liberado.
+ * @return	Numero de muestras.
+ */
+unsigned AudioRing::Space()
+{
+	return capacity - (wr.load(std::memory_order_relaxed) - rd_free.load(std::memory_order_acquire));
+}
+
+/**
+ * Copy.	...
+ * Copia muestras al buffer a partir de una posicion, en uno o dos tramos. Si samples es NULL escribe silencio.
+ * @return	nada.
+ */
+void AudioRing::Copy(unsigned pos, const pj_int16_t *samples, unsigned count)
+{
+	unsigned idx = pos & mask;
+	unsigned n1 = capacity - idx;
+	if (n1 > count) n1 = count;
+
+	if (samples != NULL)
+	{
+		pj_memcpy(buf + idx, samples, n1 * sizeof(pj_int16_t));
+		pj_memcpy(buf, samples + n1, (count - n1) * sizeof(pj_int16_t));
+	}
+	else
+	{
+		pj_bzero(buf + idx, n1 * sizeof(pj_int16_t));
+		pj_bzero(buf, (count - n1) * sizeof(pj_int16_t));
+	}
+}
+
+/**
+ * Write.	...
+ * Productor. Anade muestras al final.
+ * @param	samples		Muestras.
+ * @param	count		Numero de muestras.
+ * @return	PJ_FALSE si no caben. En ese caso no se escribe nada.
+ */
+pj_bool_t AudioRing::Write(const pj_int16_t *samples, unsigned count)
+{
+	if (count > Space()) return PJ_FALSE;
+
+	unsigned pos = wr.load(std::memory_order_relaxed);
+	Copy(pos, samples, count);
+	wr.store(pos + count, std::memory_order_release);
+	return PJ_TRUE;
+}
+
+/**
+ * WriteZeros.	...
+ * Productor. Anade silencio al final.
+ * @param	count		Numero de muestras.
+ * @return	PJ_FALSE si no caben. En ese caso no se escribe nada.
+ */
+pj_bool_t AudioRing::WriteZeros(unsigned count)
+{
+	return Write(NULL, count);
+}
+
+/**
+ * Restart.	...
+ * Productor. Descarta lo pendiente de leer y hace que el consumidor lea 'delay' muestras de silencio
+ * antes de lo que se escriba a partir de ahora. Coste constante, el silencio no se escribe.
+ * Cada llamada es un reinicio nuevo aunque la posicion y el retardo coincidan con el anterior.
+ * @param	delay		Retardo en muestras.
+ * @return	nada.
+ */
+void AudioRing::Restart(pj_uint32_t delay)
+{
+	unsigned gen = restart_gen.load(std::memory_order_relaxed);
+
+	restart_gen.store(gen + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	restart_pos.store(wr.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	restart_delay.store(delay, std::memory_order_relaxed);
+	restart_gen.store(gen + 2, std::memory_order_release);
+}
+
+/**
+ * Sync.	...
+ * Consumidor. Atiende el ultimo Restart() del productor. Si el productor lo esta escribiendo en ese
+ * momento se deja para la siguiente llamada.
+ * @return	nada.
+ */
+void AudioRing::Sync()
+{
+	unsigned gen = restart_gen.load(std::memory_order_acquire);
+	if (gen == last_gen || (gen & 1)) return;
+
+	unsigned pos = restart_pos.load(std::memory_order_relaxed);
+	pj_uint32_t delay = restart_delay.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (restart_gen.load(std::memory_order_relaxed) != gen) return;
+	last_gen = gen;
+
+	zero_until = pos;
+	rd = pos - delay;
+	rd_free.store(pos, std::memory_order_release);
+}
+
+/**
+ * GetLen.	...
+ * Consumidor. Muestras pendientes de leer, incluido el silencio del retardo.
+ * @return	Numero de muestras.
+ */
+unsigned AudioRing::GetLen()
+{
+	Sync();
+	return wr.load(std::memory_order_acquire) - rd;
+}
+
+/**
+ * Read.	...
+ * Consumidor. Lee muestras del principio.
+ * @param	samples		Buffer donde se copian.
+ * @param	count		Numero de muestras.
+ * @return	PJ_FALSE si no hay suficientes. En ese caso no se lee nada.
+ */
+pj_bool_t AudioRing::Read(pj_int16_t *samples, unsigned count)
+{
+	Sync();
+	if (wr.load(std::memory_order_acquire) - rd < count) return PJ_FALSE;
+
+	//Primero el silencio del retardo, si queda
+	unsigned nzero = 0;
+	if ((int) (zero_until - rd) > 0)
+	{
+		nzero = zero_until - rd;
+		if (nzero > count) nzero = count;
+		pj_bzero(samples, nzero * sizeof(pj_int16_t));
+		rd += nzero;
+	}
+
+	unsigned n = count - nzero;
+	if (n > 0)
+	{
+		unsigned idx = rd & mask;
+		unsigned n1 = capacity - idx;
+		if (n1 > n) n1 = n;
+		pj_memcpy(samples + nzero, buf + idx, n1 * sizeof(pj_int16_t));
+		pj_memcpy(samples + nzero + n1, buf, (n - n1) * sizeof(pj_int16_t));
+		rd += n;
+	}
+
+	if ((int) (rd - zero_until) >= 0) rd_free.store(rd, std::memory_order_release);
+	return PJ_TRUE;
+}
+
+/**
+ * Reset.	...
+ * Consumidor. Descarta todo lo pendiente de leer.
+ * @return	nada.
+ */
+void AudioRing::Reset()
+{
+	Sync();
+	rd = wr.load(std::memory_order_acquire);
+	rd_free.store(rd, std::memory_order_release);
+}
+
+/*@}*/
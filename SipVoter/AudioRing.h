@@ -0,0 +1,66 @@
+/**
+ * @file AudioRing.h
+ * @brief Buffer circular de audio sin bloqueos para un productor y un consumidor en CORESIP.dll
+ *
+ *	Implementa la clase 'AudioRing'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_AUDIORING_H__
+#define __CORESIP_AUDIORING_H__
+
+#include <atomic>
+
+/**
+ * AudioRing.
+ * Buffer circular de muestras de 16 bits para un unico productor y un unico consumidor, sin mutex.
+ * Los indices de escritura y lectura crecen siempre y se enmascaran al acceder al buffer, asi que
+ * la capacidad es potencia de 2.
+ * El retardo se aplica con Restart(): el consumidor empieza a leer 'delay' muestras antes de la
+ * posicion de escritura y esas muestras se leen como silencio sin haberlas escrito.
+ *
+ * Productor: Write, WriteZeros y Restart.
+ * Consumidor: GetLen, Read y Reset.
+ */
+class AudioRing
+{
+public:
+	AudioRing(pj_pool_t *pool, unsigned min_capacity);
+	~AudioRing();
+
+	pj_bool_t Write(const pj_int16_t *samples, unsigned count);
+	pj_bool_t WriteZeros(unsigned count);
+	void Restart(pj_uint32_t delay);
+
+	unsigned GetLen();
+	pj_bool_t Read(pj_int16_t *samples, unsigned count);
+	void Reset();
+
+private:
+	pj_int16_t *buf;
+	unsigned capacity;
+	unsigned mask;
+
+	std::atomic<unsigned> wr;						//Posicion de escritura. La publica el productor
+	std::atomic<unsigned> rd_free;					//Hasta donde ha liberado el buffer el consumidor
+
+	//Ultimo Restart() del productor. restart_gen es impar mientras se escriben la posicion y el retardo
+	std::atomic<unsigned> restart_gen;
+	std::atomic<unsigned> restart_pos;
+	std::atomic<pj_uint32_t> restart_delay;
+
+	//Estado privado del consumidor
+	unsigned rd;									//Posicion de lectura
+	unsigned zero_until;							//Las posiciones anteriores a esta se leen como silencio
+	unsigned last_gen;								//Ultimo Restart() atendido
+
+	unsigned Space();
+	void Sync();
+	void Copy(unsigned pos, const pj_int16_t *samples, unsigned count);
+};
+
+#endif
+
+/*@}*/
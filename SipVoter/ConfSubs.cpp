@@ -401,7 +401,7 @@ void ConfSubs::conf_on_client_refresh(pjsip_evsub *sub)
 pjsip_evsub_user ConfSubs::_ConfSrvCb = 
 {
 	&ConfSubs::OnConfSrvStateChanged,  
-	NULL,
+	&ConfSubs::OnConfSrvTsxChanged,
 	NULL,
 	NULL,
 	NULL,
@@ -417,4 +417,13 @@ void ConfSubs::OnConfSrvStateChanged(pjsip_evsub *sub, pjsip_event *event)
 		ExtraParamAccId::Del_subMod(sub);
 		pjsip_evsub_set_user_data(sub, NULL);		
 	} 
+}
+
+void ConfSubs::OnConfSrvTsxChanged(pjsip_evsub *sub, pjsip_transaction *tsx, pjsip_event *event)
+{
+	if (tsx->role == PJSIP_ROLE_UAS && pjsip_method_cmp(&tsx->method, &pjsip_subscribe_method) == 0)
+	{
+		//Un re-SUBSCRIBE puede cambiar el contact remoto, que es la clave de la subscripcion en el account
+		ExtraParamAccId::Refresh_subMod(sub);
+	}
 }
\ No newline at end of file
@@ -6,7 +6,7 @@ En este modulo se implementa la clase que gestina una subscripcion al evento de
 */
 
 #include "Global.h"
-#include "exceptions.h"
+#include "Exceptions.h"
 
 typedef void (*ConfSubs_callback)(void *confsubs);
 
@@ -26,6 +26,7 @@ public:
 	/*Funciones referentes a cuando funciona como servidor de subscripcion*/
 	static pjsip_evsub_user _ConfSrvCb;	
 	static void OnConfSrvStateChanged(pjsip_evsub *sub, pjsip_event *event);
+	static void OnConfSrvTsxChanged(pjsip_evsub *sub, pjsip_transaction *tsx, pjsip_event *event);
 
 private:
 	
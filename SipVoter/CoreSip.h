@@ -444,6 +444,19 @@ typedef struct CORESIP_ConfInfo
 
 } CORESIP_ConfInfo;
 
+typedef struct CORESIP_SndRxStats
+{
+	CORESIP_SndDevType SrcType;		//Tipo de dispositivo del emisor
+	unsigned Received;				//Tramas recibidas, incluidas las repetidas
+	unsigned Lost;					//Tramas que faltan en la secuencia
+	unsigned Duplicated;			//Tramas repetidas. Se descartan
+	unsigned Reordered;				//Tramas que llegan tras otras posteriores, a tiempo de reproducirse
+	unsigned Late;					//Tramas que llegan tras otras posteriores, demasiado tarde. Se descartan
+	unsigned Restarts;				//Saltos de secuencia tomados como un nuevo arranque del emisor
+	unsigned Unsequenced;			//Tramas en el formato original, sin secuencia
+	float JitterMs;					//Jitter entre llegadas (RFC 3550)
+} CORESIP_SndRxStats;
+
 typedef struct CORESIP_Callbacks
 {
 	void * UserData;
@@ -527,6 +540,11 @@ typedef struct CORESIP_Config
 
 	unsigned TimeToDiscardRdInfo;		//Tiempo durante el cual no se envia RdInfo al Nodebox tras un PTT OFF. //UNIFETM: Este campo falta en ETM. inicializarlo a 0
 
+	unsigned RtpRxBatch;		//Con valor distinto de 0, el RTP recibido se lee en bloques de varios paquetes por llamada al sistema (recvmmsg, solo Linux). //UNIFETM: Este campo falta en ETM. inicializarlo a 0
+
+	void (*SndRxStatsCb)(int sndRxPort, const char * id, const CORESIP_SndRxStats * stats);
+								//Estadisticas periodicas del audio remoto de cada emisor con trafico. Va al final, fuera de Cb, para no mover los campos anteriores. //UNIFETM: Este campo falta en ETM. inicializarlo a NULL
+
 } CORESIP_Config;
 
 typedef struct CORESIP_Impairments
@@ -537,6 +555,21 @@ typedef struct CORESIP_Impairments
 	int LatMax;
 } CORESIP_Impairments;
 
+typedef struct CORESIP_LogStats
+{
+	unsigned Written;		//Mensajes de log escritos
+	unsigned Dropped;		//Mensajes descartados por estar lleno el buffer de log del thread que los genera
+	unsigned Suppressed;	//Mensajes descartados por repetirse demasiado
+} CORESIP_LogStats;
+
+typedef struct CORESIP_WavStats
+{
+	unsigned Frames;		//Tramas entregadas al mezclador (reproductor) o recibidas de el (grabador)
+	unsigned Underruns;		//Tramas que el reproductor aun no habia leido del fichero. Se entrega silencio
+	unsigned Overruns;		//Tramas que el grabador descarta por tener lleno el buffer de escritura
+	unsigned MaxIoUs;		//Lectura o escritura del fichero mas lenta
+} CORESIP_WavStats;
+
 /*Callback para recibir notificaciones por la subscripcion de presencia*/
 /*	dst_uri: uri del destino cuyo estado de presencia ha cambiado.
  *	subscription_status: vale 0 la subscripcion al evento no ha tenido exito. 
@@ -555,6 +588,7 @@ extern "C" {
 	CORESIP_API int	CORESIP_SetSipPort(int port, CORESIP_Error * error);
 
 	CORESIP_API int	CORESIP_SetLogLevel(unsigned level, CORESIP_Error * error);
+	CORESIP_API int	CORESIP_GetLogStats(CORESIP_LogStats * stats, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_SetParams(const CORESIP_Params * info, CORESIP_Error * error);
 
 	CORESIP_API int	CORESIP_CreateAccount(const char * acc, int defaultAcc, int * accId, CORESIP_Error * error);
@@ -567,15 +601,18 @@ extern "C" {
 
 	CORESIP_API int	CORESIP_CreateWavPlayer(const char * file, unsigned loop, int * wavPlayer, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_DestroyWavPlayer(int wavPlayer, CORESIP_Error * error);
+	CORESIP_API int	CORESIP_GetWavPlayerStats(int wavPlayer, CORESIP_WavStats * stats, CORESIP_Error * error);
 	
 	CORESIP_API int	CORESIP_CreateWavRecorder(const char * file, int * wavRecorder, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_DestroyWavRecorder(int wavRecorder, CORESIP_Error * error);
+	CORESIP_API int	CORESIP_GetWavRecorderStats(int wavRecorder, CORESIP_WavStats * stats, CORESIP_Error * error);
 
 	CORESIP_API int	CORESIP_CreateRdRxPort(const CORESIP_RdRxPortInfo * info, const char * localIp, int * rdRxPort, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_DestroyRdRxPort(int rdRxPort, CORESIP_Error * error);
 
 	CORESIP_API int	CORESIP_CreateSndRxPort(const char * id, int * sndRxPort, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_DestroySndRxPort(int sndRxPort, CORESIP_Error * error);
+	CORESIP_API int	CORESIP_GetSndRxStats(int sndRxPort, CORESIP_SndRxStats stats[CORESIP_SND_MAX_IN_DEVICES], CORESIP_Error * error);
 
 	CORESIP_API int	CORESIP_BridgeLink(int src, int dst, int on, CORESIP_Error * error);
 
@@ -591,6 +628,9 @@ extern "C" {
 	CORESIP_API int	CORESIP_CallHold(int call, int hold, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_CallTransfer(int call, int dstCall, const char * dst, const char *display_name, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_CallPtt(int call, const CORESIP_PttInfo * info, CORESIP_Error * error);
+	/*Aplica el mismo PTT a varias llamadas. Un call id repetido en calls se trata una sola vez, asi que
+	  count puede superar max_calls si hay repetidos. Un call id no valido hace fallar toda la llamada*/
+	CORESIP_API int	CORESIP_GroupPtt(const int * calls, int count, const CORESIP_PttInfo * info, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_CallConference(int call, int conf, CORESIP_Error * error);
 	CORESIP_API int	CORESIP_CallSendConfInfo(int call, const CORESIP_ConfInfo * info, CORESIP_Error * error);
 	CORESIP_API int CORESIP_SendConfInfoFromAcc(int accId, const CORESIP_ConfInfo * info, CORESIP_Error * error);
@@ -601,6 +641,7 @@ extern "C" {
 
 	CORESIP_API int	CORESIP_SendOptionsMsg(const char * dst, char * callid, int isRadio, CORESIP_Error * error);
 	CORESIP_API int CORESIP_SendOptionsMsgProxy(const char * dst, char * callid, int isRadio, CORESIP_Error * error);
+	CORESIP_API int CORESIP_SendOptionsMsgList(const char ** dst, char ** callid, int count, int isRadio, CORESIP_Error * error);
 
 	//CORESIP_API int	CORESIP_CallAddToBss(int call, void * bssGroup, CORESIP_Error * error);
 	//CORESIP_API int	CORESIP_CallRemoveFromBss(int call, void * bssGroup, CORESIP_Error * error);
@@ -393,6 +393,11 @@ void DlgSubs::OnDlgSrvTsxChanged(pjsip_evsub *sub, pjsip_transaction *tsx, pjsip
 {
 	pjsip_evsub_state state = pjsip_evsub_get_state(sub);
 	PJ_LOG(5, ("SipAgent.cpp", "OnDlgSrvTsxChanged %s sub %p", pjsip_evsub_get_state_name(sub), sub));
+	if (tsx->role == PJSIP_ROLE_UAS && pjsip_method_cmp(&tsx->method, &pjsip_subscribe_method) == 0)
+	{
+		//Un re-SUBSCRIBE puede cambiar el contact remoto, que es la clave de la subscripcion en el account
+		ExtraParamAccId::Refresh_subMod(sub);
+	}
 	if (tsx->state == PJSIP_TSX_STATE_TERMINATED && (tsx->role == PJSIP_ROLE_UAS) && (pjsip_method_cmp(&tsx->method, &pjsip_subscribe_method) == 0)
 		&& state != PJSIP_EVSUB_STATE_NULL && state != PJSIP_EVSUB_STATE_SENT)
 	{
@@ -6,7 +6,7 @@ En este modulo se implementa la clase que gestiona una subscripcion al evento de
 */
 
 #include "Global.h"
-#include "exceptions.h"
+#include "Exceptions.h"
 #include "dlgsub.h"
 
 typedef void (*DlgSubs_callback)(void *dlgsubs);
@@ -14,6 +14,9 @@
 #include "ExtraParamAccId.h"
 #include "wg67subscription.h"
 #include "WavPlayerToRemote.h"
+#include "AsyncLog.h"
+#include "OptionsFast.h"
+#include <vector>
 
 #define Try\
 	pj_thread_desc desc;\
@@ -157,6 +160,25 @@ CORESIP_API int CORESIP_SetLogLevel(unsigned level, CORESIP_Error * error)
 	return ret;
 }
 
+/**
+ *	Estadisticas del log asincrono. @ref AsyncLog::GetStats
+ *	@param	stats	Puntero @ref CORESIP_LogStats donde se devuelven los contadores.
+ *	@param	error	Puntero @ref CORESIP_Error a la estructura de Error. 
+ *	@return			Codigo de Error
+ */
+CORESIP_API int CORESIP_GetLogStats(CORESIP_LogStats * stats, CORESIP_Error * error)
+{
+	int ret = CORESIP_OK;
+
+	Try
+	{
+		AsyncLog::GetStats(stats);
+	}
+	catch_all;
+
+	return ret;
+}
+
 /**
  *	Establece los Parametros del Modulo. @ref SipAgent::SetParams
  *	@param	info	Puntero @ref CORESIP_Params a la estructura de parametros. 
@@ -350,6 +372,27 @@ CORESIP_API int CORESIP_DestroyWavPlayer(int wavPlayer, CORESIP_Error * error)
 	return ret;
 }
 
+/**
+ *	GetWavPlayerStats	Estadisticas de la lectura del fichero de un Reproductor WAV. @ref SipAgent::GetWavPlayerStats
+ *	@param	wavPlayer	Identificador del Reproductor.
+ *	@param	stats		Puntero @ref CORESIP_WavStats donde se devuelven los contadores.
+ *	@param	error		Puntero @ref CORESIP_Error a la Estructura de error
+ *	@return				Codigo de Error
+ */
+CORESIP_API int CORESIP_GetWavPlayerStats(int wavPlayer, CORESIP_WavStats * stats, CORESIP_Error * error)
+{
+	int ret = CORESIP_OK;
+
+	Try
+	{
+		pj_assert((wavPlayer & CORESIP_ID_TYPE_MASK) == CORESIP_WAVPLAYER_ID);
+		SipAgent::GetWavPlayerStats(wavPlayer & CORESIP_ID_MASK, stats);
+	}
+	catch_all;
+
+	return ret;
+}
+
 /**
  *	CreateWavRecorder	Crea un 'grabador' en formato WAV. @ref SipAgent::CreateWavRecorder
  *	@param	file		Puntero al path del fichero, donde guardar el sonido.
@@ -391,6 +434,27 @@ CORESIP_API int CORESIP_DestroyWavRecorder(int wavRecorder, CORESIP_Error * erro
 	return ret;
 }
 
+/**
+ *	GetWavRecorderStats	Estadisticas de la escritura del fichero de un 'grabador' WAV. @ref SipAgent::GetWavRecorderStats
+ *	@param	wavRecorder	Identificador del Grabador.
+ *	@param	stats		Puntero @ref CORESIP_WavStats donde se devuelven los contadores.
+ *	@param	error		Puntero @ref CORESIP_Error a la Estructura de error
+ *	@return				Codigo de Error
+ */
+CORESIP_API int CORESIP_GetWavRecorderStats(int wavRecorder, CORESIP_WavStats * stats, CORESIP_Error * error)
+{
+	int ret = CORESIP_OK;
+
+	Try
+	{
+		pj_assert((wavRecorder & CORESIP_ID_TYPE_MASK) == CORESIP_WAVRECORDER_ID);
+		SipAgent::GetWavRecorderStats(wavRecorder & CORESIP_ID_MASK, stats);
+	}
+	catch_all;
+
+	return ret;
+}
+
 
 /**
  *	CreateRedRxPort		Crea un 'PORT' @ref RdRxPort de Recepcion Radio. @ref SipAgent::CreateRdRxPort
@@ -473,6 +537,27 @@ CORESIP_API int CORESIP_DestroySndRxPort(int sndRxPort, CORESIP_Error * error)
 	return ret;
 }
 
+/**
+ *	GetSndRxStats		Estadisticas del audio recibido por un puerto @ref SoundRxPort. @ref SipAgent::GetSndRxStats
+ *	@param	sndRxPort	Identificador del puerto.
+ *	@param	stats		Array de CORESIP_SND_MAX_IN_DEVICES estructuras @ref CORESIP_SndRxStats, una por tipo de emisor.
+ *	@param	error		Puntero a la Estructura de error
+ *	@return				Codigo de Error
+ */
+CORESIP_API int CORESIP_GetSndRxStats(int sndRxPort, CORESIP_SndRxStats stats[CORESIP_SND_MAX_IN_DEVICES], CORESIP_Error * error)
+{
+	int ret = CORESIP_OK;
+
+	Try
+	{
+		pj_assert((sndRxPort & CORESIP_ID_TYPE_MASK) == CORESIP_SNDRXPORT_ID);
+		SipAgent::GetSndRxStats(sndRxPort & CORESIP_ID_MASK, stats);
+	}
+	catch_all;
+
+	return ret;
+}
+
 /**
  *	BridgeLink			Configura un enlace de conferencia. @ref SipAgent::BridgeLink
  *	@param	src			Tipo e Identificador de Puerto Origen. @ref CORESIP_ID_TYPE_MASK, @ref CORESIP_ID_MASK
@@ -758,6 +843,44 @@ CORESIP_API int CORESIP_CallPtt(int call, const CORESIP_PttInfo * info, CORESIP_
 	return ret;
 }
 
+/**
+ *	GroupPtt
+ *  Aplica el mismo estado de PTT a varias llamadas en una sola pasada, por ejemplo a todos los transmisores de una
+ *	frecuencia. Los paquetes con el cambio se envian seguidos, sin esperar al tick de cada llamada.
+ *	Una llamada repetida en la lista se trata una sola vez.
+ *	@param	calls		Lista de identificadores de llamada
+ *	@param	count		Numero de llamadas
+ *	@param	info		Puntero a la Informacion asociada al PTT
+ *	@param	error		Puntero a la Estructura de error
+ *	@return				Codigo de Error
+ */
+CORESIP_API int CORESIP_GroupPtt(const int * calls, int count, const CORESIP_PttInfo * info, CORESIP_Error * error)
+{
+	int ret = CORESIP_OK;
+
+	Try
+	{
+		if (calls == NULL || count <= 0 || info == NULL)
+		{
+			throw PJLibException(__FILE__, PJ_EINVAL).Msg("CORESIP_GroupPtt: Parametros no validos");
+		}
+
+		std::vector<pjsua_call_id> ids(count);
+		for (int i = 0; i < count; i++)
+		{
+			if ((calls[i] & CORESIP_ID_TYPE_MASK) != CORESIP_CALL_ID)
+			{
+				throw PJLibException(__FILE__, PJ_EINVAL).Msg("CORESIP_GroupPtt:", "Invalid call id 0x%X", calls[i]);
+			}
+			ids[i] = calls[i] & CORESIP_ID_MASK;
+		}
+		SipCall::GroupPtt(&ids[0], count, info);
+	}
+	catch_all;
+
+	return ret;
+}
+
 /**
  *	CallSendInfo
  *	@param	call		Identificador de llamada
@@ -956,6 +1079,35 @@ CORESIP_API int CORESIP_SendOptionsMsgProxy(const char * dst, char * callid, int
 	return ret;
 }
 
+/**
+ *	CORESIP_SendOptionsMsgList
+ *  Envia OPTIONS a una lista de destinos, sin pasar por el proxy. Los mensajes se generan con una sola plantilla.
+ *	@param	dst			Lista de uris donde enviar OPTIONS
+ *  @param	callid		Lista de buffers de CORESIP_MAX_CALLID_LENGTH caracteres con el callid de cada uno.
+ *						Queda vacio si la uri no es valida.
+ *	@param	count		Numero de destinos
+ *  @param	isRadio		Si tiene valor distinto de cero el agente se identifica como radio. Si es cero, como telefonia.
+ *						Sirve principalmente para poner radio.01 o phone.01 en la cabecera WG67-version
+ *	@param	error		Puntero a la Estructura de error
+ *	@return				Codigo de Error
+ */
+CORESIP_API int CORESIP_SendOptionsMsgList(const char ** dst, char ** callid, int count, int isRadio, CORESIP_Error * error)
+{
+	int ret = CORESIP_OK;
+
+	Try
+	{
+		if (count < 0 || (count > 0 && (dst == NULL || callid == NULL)))
+		{
+			throw PJLibException(__FILE__, PJ_EINVAL).Msg("CORESIP_SendOptionsMsgList: Parametros no validos");
+		}
+		OptionsFast::SendOptionsList(dst, callid, (unsigned) count, isRadio);
+	}
+	catch_all;
+
+	return ret;
+}
+
 /**
  *	CreateWG67Subscription
  *	@param	dst						Puntero a ...
@@ -6,17 +6,30 @@
 #include "ExtraParamAccId.h"
 #include "dlgsub.h"
 
+#define SUBMOD_HASH_SIZE	1023		//Filas de las tablas hash de las subscripciones activas
+
 ExtraParamAccId::ExtraParamAccId()
 {
 	rdAccount = PJ_FALSE;
 	TipoGrsFlags = CORESIP_CALL_NINGUNO;	
-	_Pool = pjsua_pool_create(NULL, 64, 32);
+	//El bloque inicial es el de las filas de las tres tablas hash, mas sus cabeceras y el mutex. Las entradas se piden
+	//de una en una al pool y se reciclan en _subModfree y _DeletedsubModlist, asi que solo crece con el maximo de subscripciones
+	_Pool = pjsua_pool_create(NULL,
+		(2 * (SUBMOD_HASH_SIZE + 1) + MAX_DeletedsubModlist_size) * sizeof(pj_hash_entry *) + 512, 4096);
 	if (_Pool == NULL)
 	{
 		throw PJLibException(__FILE__, PJ_ENOMEM).Msg("ExtraParamAccId: No hay suficiente memoria");
 		return;
 	}
 
+	pj_list_init(&_subModlist);
+	pj_list_init(&_subModfree);
+	pj_list_init(&_DeletedsubModlist);
+	_DeletedsubModcount = 0;
+	_subModHash = pj_hash_create(_Pool, SUBMOD_HASH_SIZE);
+	_subModKeyHash = pj_hash_create(_Pool, SUBMOD_HASH_SIZE);
+	_DeletedsubModHash = pj_hash_create(_Pool, MAX_DeletedsubModlist_size);
+
 	_subModlist_mutex = NULL;
 	pj_status_t st = pj_mutex_create_simple(_Pool, NULL, &_subModlist_mutex); 
 	if (st != PJ_SUCCESS)
@@ -38,6 +51,161 @@ ExtraParamAccId::~ExtraParamAccId()
 	}
 }
 
+/**
+ * MakeSubModKey: Obtiene la clave "user@host" de la uri del contact de una subscripcion, con el host en minusculas
+ * como lo compara pjsip_uri_cmp. Las uris que no son sip, o demasiado largas, tienen todas la clave vacia.
+ * @param	uri		Uri
+ * @param	key		Buffer de SUBMOD_KEY_SIZE caracteres
+ * @return	Longitud de la clave
+ */
+unsigned ExtraParamAccId::MakeSubModKey(pjsip_uri *uri, char *key)
+{
+	pjsip_uri *inner = (pjsip_uri *) pjsip_uri_get_uri(uri);
+	if (!PJSIP_URI_SCHEME_IS_SIP(inner) && !PJSIP_URI_SCHEME_IS_SIPS(inner)) return 0;
+
+	pjsip_sip_uri *url = (pjsip_sip_uri *) inner;
+	if (url->user.slen + 1 + url->host.slen > SUBMOD_KEY_SIZE) return 0;
+
+	pj_memcpy(key, url->user.ptr, url->user.slen);
+	key[url->user.slen] = '@';
+	for (int i = 0; i < url->host.slen; i++)
+	{
+		key[url->user.slen + 1 + i] = (char) pj_tolower(url->host.ptr[i]);
+	}
+	return (unsigned) (url->user.slen + 1 + url->host.slen);
+}
+
+/**
+ * GetSubModKey: Obtiene la clave del contact remoto actual del dialogo de una subscripcion
+ * @param	sub		Subscripcion
+ * @param	key		Buffer de SUBMOD_KEY_SIZE caracteres
+ * @return	Longitud de la clave
+ */
+unsigned ExtraParamAccId::GetSubModKey(pjsip_evsub *sub, char *key)
+{
+	unsigned keylen = 0;
+	pjsip_dialog* dlg = pjsip_evsub_get_dlg(sub);
+	if (dlg != NULL)
+	{
+		pjsip_dlg_inc_lock(dlg);
+		if (dlg->remote.contact != NULL) keylen = MakeSubModKey(dlg->remote.contact->uri, key);
+		pjsip_dlg_dec_lock(dlg);
+	}
+	return keylen;
+}
+
+/**
+ * MakeDeletedKey: Obtiene la clave "user@host;tag" de la lista de subscripciones borradas
+ * @param	remote_uri	Uri del from
+ * @param	remote_from_tag	Tag del from
+ * @param	key		Buffer de DELETED_KEY_SIZE caracteres
+ * @param	keylen	Longitud de la clave
+ * @return	PJ_FALSE si la uri no es sip o alguno de los campos es demasiado largo para la lista
+ */
+pj_bool_t ExtraParamAccId::MakeDeletedKey(pjsip_uri *remote_uri, pj_str_t *remote_from_tag, char *key, unsigned *keylen)
+{
+	pjsip_uri *inner = (pjsip_uri *) pjsip_uri_get_uri(remote_uri);
+	if (!PJSIP_URI_SCHEME_IS_SIP(inner) && !PJSIP_URI_SCHEME_IS_SIPS(inner)) return PJ_FALSE;
+
+	pjsip_sip_uri *from_uri = (pjsip_sip_uri *) inner;
+	if ((from_uri->user.slen > CORESIP_MAX_USER_ID_LENGTH - 1) ||
+		(from_uri->host.slen > CORESIP_MAX_URI_LENGTH - 1) ||
+		(remote_from_tag->slen > CORESIP_MAX_TAG_LENGTH - 1))
+	{
+		return PJ_FALSE;
+	}
+
+	char *p = key;
+	pj_memcpy(p, from_uri->user.ptr, from_uri->user.slen);
+	p += from_uri->user.slen;
+	*p++ = '@';
+	pj_memcpy(p, from_uri->host.ptr, from_uri->host.slen);
+	p += from_uri->host.slen;
+	*p++ = ';';
+	pj_memcpy(p, remote_from_tag->ptr, remote_from_tag->slen);
+	p += remote_from_tag->slen;
+	*keylen = (unsigned) (p - key);
+
+	return PJ_TRUE;
+}
+
+/**
+ * LinkSubModKey: Agrega una entrada al final de las de su clave en _subModKeyHash.
+ * Se llama con _subModlist_mutex cogido.
+ * @param	e	Entrada
+ */
+void ExtraParamAccId::LinkSubModKey(sub_entry *e)
+{
+	e->key_next = NULL;
+	sub_entry *last = (sub_entry *) pj_hash_get(_subModKeyHash, e->key, e->keylen, NULL);
+	if (last == NULL)
+	{
+		pj_hash_set_np(_subModKeyHash, e->key, e->keylen, 0, e->key_hbuf, e);
+	}
+	else
+	{
+		while (last->key_next != NULL) last = last->key_next;
+		last->key_next = e;
+	}
+}
+
+/**
+ * UnlinkSubModKey: Quita una entrada de las de su clave en _subModKeyHash.
+ * Se llama con _subModlist_mutex cogido.
+ * @param	e	Entrada
+ */
+void ExtraParamAccId::UnlinkSubModKey(sub_entry *e)
+{
+	sub_entry *first = (sub_entry *) pj_hash_get(_subModKeyHash, e->key, e->keylen, NULL);
+	if (first == e)
+	{
+		//La tabla guarda el puntero a la clave de la primera entrada. Si hay mas con la misma clave, pasa a la siguiente
+		pj_hash_set_np(_subModKeyHash, e->key, e->keylen, 0, NULL, NULL);
+		if (e->key_next != NULL)
+		{
+			pj_hash_set_np(_subModKeyHash, e->key_next->key, e->keylen, 0, e->key_next->key_hbuf, e->key_next);
+		}
+	}
+	else
+	{
+		while (first != NULL && first->key_next != e) first = first->key_next;
+		if (first != NULL) first->key_next = e->key_next;
+	}
+
+	e->key_next = NULL;
+}
+
+/**
+ * UnlinkSubMod: Quita una entrada de _subModlist y de los indices y la pasa a la lista de libres.
+ * Se llama con _subModlist_mutex cogido.
+ * @param	e	Entrada
+ */
+void ExtraParamAccId::UnlinkSubMod(sub_entry *e)
+{
+	pj_hash_set_np(_subModHash, &e->sub, sizeof(e->sub), 0, NULL, NULL);
+	UnlinkSubModKey(e);
+
+	e->sub = NULL;
+	pj_list_erase(e);
+	pj_list_push_back(&_subModfree, e);
+}
+
+/**
+ * FindDeleted: Busca en la lista de subscripciones borradas y marca la entrada como usada la ultima.
+ * Se llama con _subModlist_mutex cogido.
+ * @return	La entrada o NULL
+ */
+ExtraParamAccId::deleted_entry * ExtraParamAccId::FindDeleted(const char *key, unsigned keylen)
+{
+	deleted_entry *e = (deleted_entry *) pj_hash_get(_DeletedsubModHash, key, keylen, NULL);
+	if (e != NULL)
+	{
+		pj_list_erase(e);
+		pj_list_push_back(&_DeletedsubModlist, e);
+	}
+	return e;
+}
+
 /**
  * Add_subMod: Agrega a la lista de subscripciones correspondientes a un account
  * @param	sub	Subscripcion que agrega
@@ -61,9 +229,41 @@ int ExtraParamAccId::Add_subMod(pjsip_evsub *sub)
 	ExtraParamAccId *extraParamAccCfg = (ExtraParamAccId *) pjsua_acc_get_user_data(accid);
 	if (extraParamAccCfg != NULL)
 	{
+		//La clave es el contact remoto, que es el que se compara en Get_subMod. Si cambia la actualiza Refresh_subMod
+		char key[SUBMOD_KEY_SIZE];
+		unsigned keylen = GetSubModKey(sub, key);
+
 		pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
-		extraParamAccCfg->_subModlist.remove(sub);		//Lo quito por si ya estuviera y me aseguro de que solo hay uno
-		extraParamAccCfg->_subModlist.push_back(sub);	//Agrego el nuevo elemento
+
+		//Lo quito por si ya estuviera y me aseguro de que solo hay uno
+		sub_entry *e = (sub_entry *) pj_hash_get(extraParamAccCfg->_subModHash, &sub, sizeof(sub), NULL);
+		if (e != NULL) extraParamAccCfg->UnlinkSubMod(e);
+
+		if (!pj_list_empty(&extraParamAccCfg->_subModfree))
+		{
+			e = extraParamAccCfg->_subModfree.next;
+			pj_list_erase(e);
+		}
+		else
+		{
+			e = (sub_entry *) pj_pool_alloc(extraParamAccCfg->_Pool, sizeof(sub_entry));
+		}
+
+		if (e != NULL)
+		{
+			e->sub = sub;
+			e->keylen = keylen;
+			pj_memcpy(e->key, key, keylen);
+
+			//Agrego el nuevo elemento, al final de la lista y de las de su clave
+			pj_list_push_back(&extraParamAccCfg->_subModlist, e);
+			pj_hash_set_np(extraParamAccCfg->_subModHash, &e->sub, sizeof(e->sub), 0, e->sub_hbuf, e);
+			extraParamAccCfg->LinkSubModKey(e);
+		}
+		else
+		{
+			PJ_LOG(3, ("ExtraParamAccId", "ERROR: Add_subMod No hay memoria"));
+		}
 		pj_mutex_unlock(extraParamAccCfg->_subModlist_mutex);
 	}
 	return 0;
@@ -93,12 +293,43 @@ int ExtraParamAccId::Del_subMod(pjsip_evsub *sub)
 	if (extraParamAccCfg != NULL)
 	{
 		pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
-		extraParamAccCfg->_subModlist.remove(sub);				//Lo quitamos de la lista de subscripciones activas
+		sub_entry *e = (sub_entry *) pj_hash_get(extraParamAccCfg->_subModHash, &sub, sizeof(sub), NULL);
+		if (e != NULL) extraParamAccCfg->UnlinkSubMod(e);		//Lo quitamos de la lista de subscripciones activas
 		pj_mutex_unlock(extraParamAccCfg->_subModlist_mutex);
 	}
 	return 0;
 }
 
+/**
+ * Refresh_subMod: Actualiza la clave de una subscripcion si ha cambiado el contact remoto de su dialogo,
+ * por ejemplo por un re-SUBSCRIBE con otro Contact. Se llama en cada cambio de estado de las transacciones
+ * SUBSCRIBE que recibe la subscripcion.
+ * @param	sub	Subscripcion
+ */
+void ExtraParamAccId::Refresh_subMod(pjsip_evsub *sub)
+{
+	subs_user_data *sub_user_data = (subs_user_data *) pjsip_evsub_get_user_data(sub);
+	if (sub_user_data == NULL || sub_user_data->accid == PJSUA_INVALID_ID) return;
+
+	ExtraParamAccId *extraParamAccCfg = (ExtraParamAccId *) pjsua_acc_get_user_data(sub_user_data->accid);
+	if (extraParamAccCfg == NULL) return;
+
+	char key[SUBMOD_KEY_SIZE];
+	unsigned keylen = GetSubModKey(sub, key);
+
+	pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
+	sub_entry *e = (sub_entry *) pj_hash_get(extraParamAccCfg->_subModHash, &sub, sizeof(sub), NULL);
+	if (e != NULL && (e->keylen != keylen || pj_memcmp(e->key, key, keylen) != 0))
+	{
+		//Pasa al final de las de la nueva clave
+		extraParamAccCfg->UnlinkSubModKey(e);
+		e->keylen = keylen;
+		pj_memcpy(e->key, key, keylen);
+		extraParamAccCfg->LinkSubModKey(e);
+	}
+	pj_mutex_unlock(extraParamAccCfg->_subModlist_mutex);
+}
+
 /**
  * Get_subMod: Retorna el objeto pjsip_evsub para un contact concreto y un tipo de evento 
  * @param	accid	Account id			Account id
@@ -117,12 +348,15 @@ pjsip_evsub * ExtraParamAccId::Get_subMod(pjsua_acc_id accid, pjsip_uri *remote_
 	ExtraParamAccId *extraParamAccCfg = (ExtraParamAccId *) pjsua_acc_get_user_data(accid);
 	if (extraParamAccCfg == NULL) return ret;
 
+	//Solo pueden coincidir las subscripciones cuyo contact tiene el mismo usuario y host
+	char key[SUBMOD_KEY_SIZE];
+	unsigned keylen = MakeSubModKey(remote_uri, key);
+
 	pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
-	std::list<pjsip_evsub *, std::allocator<pjsip_evsub *>>::iterator it;
-	it = extraParamAccCfg->_subModlist.begin();
-	for (it = extraParamAccCfg->_subModlist.begin(); it != extraParamAccCfg->_subModlist.end(); it++)
+	sub_entry *e = (sub_entry *) pj_hash_get(extraParamAccCfg->_subModKeyHash, key, keylen, NULL);
+	for ( ; e != NULL; e = e->key_next)
 	{
-		pjsip_evsub *sub = *it;
+		pjsip_evsub *sub = e->sub;
 
 		if (sub)
 		{
@@ -168,61 +402,41 @@ int ExtraParamAccId::Add_DeletedsubModlist(pjsua_acc_id accid, pjsip_uri *remote
 	ExtraParamAccId *extraParamAccCfg = (ExtraParamAccId *) pjsua_acc_get_user_data(accid);
 	if (extraParamAccCfg != NULL)
 	{
-		pj_bool_t agregar_a_DeletedsubModlist = PJ_TRUE;
-		from_user_subs *fuser = (from_user_subs *) malloc(sizeof(from_user_subs));
-		if (fuser == NULL)
-		{
-			PJ_LOG(3, ("ExtraParamAccId", "ERROR: Add_DeletedsubModlist No hay memoria"));
-			agregar_a_DeletedsubModlist = PJ_FALSE;
-		}
-		else
+		char key[DELETED_KEY_SIZE];
+		unsigned keylen;
+		if (!MakeDeletedKey(remote_uri, remote_from_tag, key, &keylen)) return 0;
+
+		pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
+		if (extraParamAccCfg->FindDeleted(key, keylen) == NULL)
 		{
-			pjsip_sip_uri * from_uri = (pjsip_sip_uri*)pjsip_uri_get_uri(remote_uri);
-			if (from_uri == NULL) agregar_a_DeletedsubModlist = PJ_FALSE;
+			deleted_entry *e;
+			if (extraParamAccCfg->_DeletedsubModcount == MAX_DeletedsubModlist_size)
+			{
+				//La lista est llena. Reutilizamos el elemento usado hace mas tiempo
+				e = extraParamAccCfg->_DeletedsubModlist.next;
+				pj_list_erase(e);
+				pj_hash_set_np(extraParamAccCfg->_DeletedsubModHash, e->key, e->keylen, 0, NULL, NULL);
+			}
 			else
 			{
-				if (IsInDeletedList(accid, remote_uri, remote_from_tag))
-				{
-					//Ya esta en la lista de borrados. No lo agregamos
-					agregar_a_DeletedsubModlist = PJ_FALSE;
-				}
-				else if ((from_uri->user.slen > ((sizeof(fuser->user)/sizeof(char)) - 1)) ||
-					(from_uri->host.slen > ((sizeof(fuser->host)/sizeof(char)) - 1)) ||
-					(remote_from_tag->slen > ((sizeof(fuser->tag)/sizeof(char)) - 1)))
-				{
-					agregar_a_DeletedsubModlist = PJ_FALSE;
-				}
-				else
-				{
-					strncpy(fuser->user, from_uri->user.ptr, from_uri->user.slen);
-					fuser->user[from_uri->user.slen] = '\0';
-					strncpy(fuser->host, from_uri->host.ptr, from_uri->host.slen);
-					fuser->user[from_uri->host.slen] = '\0';
-					strncpy(fuser->tag, remote_from_tag->ptr, remote_from_tag->slen);
-					fuser->user[remote_from_tag->slen] = '\0';
-				}
+				e = (deleted_entry *) pj_pool_alloc(extraParamAccCfg->_Pool, sizeof(deleted_entry));
+				if (e != NULL) extraParamAccCfg->_DeletedsubModcount++;
 			}
-		}
 
-		if (agregar_a_DeletedsubModlist)
-		{
-			//Lo ponemos en la lista de subscripciones borradas
-			pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
-			if (extraParamAccCfg->_DeletedsubModlist.size() == MAX_DeletedsubModlist_size)
+			if (e != NULL)
 			{
-				//La lista est llena. Quitamos el elemento mas antiguo
-				from_user_subs *fuser_tmp = extraParamAccCfg->_DeletedsubModlist.front();
-				free(fuser_tmp);
-				extraParamAccCfg->_DeletedsubModlist.pop_front();
+				//Agregamos un nuevo elemento a la lista de los borrados
+				pj_memcpy(e->key, key, keylen);
+				e->keylen = keylen;
+				pj_list_push_back(&extraParamAccCfg->_DeletedsubModlist, e);
+				pj_hash_set_np(extraParamAccCfg->_DeletedsubModHash, e->key, e->keylen, 0, e->hbuf, e);
+			}
+			else
+			{
+				PJ_LOG(3, ("ExtraParamAccId", "ERROR: Add_DeletedsubModlist No hay memoria"));
 			}
-			//Agregamos un nuevo elemento a la lista de los borrados
-			extraParamAccCfg->_DeletedsubModlist.push_back(fuser);	
-			pj_mutex_unlock(extraParamAccCfg->_subModlist_mutex);
-		}
-		else if (fuser != NULL)
-		{
-			free(fuser);
 		}
+		pj_mutex_unlock(extraParamAccCfg->_subModlist_mutex);
 	}
 	return 0;
 }
@@ -247,26 +461,12 @@ pj_bool_t ExtraParamAccId::IsInDeletedList(pjsua_acc_id accid, pjsip_uri *remote
 	ExtraParamAccId *extraParamAccCfg = (ExtraParamAccId *) pjsua_acc_get_user_data(accid);
 	if (extraParamAccCfg == NULL) return ret;
 
-	pjsip_sip_uri * from_uri = (pjsip_sip_uri*)pjsip_uri_get_uri(remote_uri);
-	if (from_uri == NULL) return ret;
+	char key[DELETED_KEY_SIZE];
+	unsigned keylen;
+	if (!MakeDeletedKey(remote_uri, remote_from_tag, key, &keylen)) return ret;
 
 	pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
-	std::list<from_user_subs *, std::allocator<from_user_subs *>>::iterator it;
-	it = extraParamAccCfg->_DeletedsubModlist.begin();
-	for (it = extraParamAccCfg->_DeletedsubModlist.begin(); it != extraParamAccCfg->_DeletedsubModlist.end(); it++)
-	{
-		from_user_subs *fuser = *it;
-		if (fuser)
-		{
-			if ((strncmp(fuser->user, from_uri->user.ptr, from_uri->user.slen) == 0) &&
-				(strncmp(fuser->host, from_uri->host.ptr, from_uri->host.slen) == 0) &&
-				(strncmp(fuser->tag, remote_from_tag->ptr, remote_from_tag->slen) == 0))
-			{
-				ret = PJ_TRUE;
-				break;
-			}
-		}
-	}
+	if (extraParamAccCfg->FindDeleted(key, keylen) != NULL) ret = PJ_TRUE;
 	pj_mutex_unlock(extraParamAccCfg->_subModlist_mutex);
 
 	return ret;
@@ -290,11 +490,10 @@ void ExtraParamAccId::SendConfInfoFromAcc(pjsua_acc_id accid, const CORESIP_Conf
 	if (extraParamAccCfg == NULL) return;
 
 	pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
-	std::list<pjsip_evsub *, std::allocator<pjsip_evsub *>>::iterator it;
-	it = extraParamAccCfg->_subModlist.begin();
-	for (it = extraParamAccCfg->_subModlist.begin(); it != extraParamAccCfg->_subModlist.end(); it++)
+	sub_entry *e;
+	for (e = extraParamAccCfg->_subModlist.next; e != &extraParamAccCfg->_subModlist; e = e->next)
 	{
-		pjsip_evsub *confsub = *it;
+		pjsip_evsub *confsub = e->sub;
 		if (confsub)
 		{
 			pjsip_event_hdr *eventhdr = (pjsip_event_hdr *) pjsip_evsub_get_event_hdr(confsub);		
@@ -355,11 +554,10 @@ void ExtraParamAccId::SendDialogNotifyFromAcc(pjsua_call_id call_id, pj_bool_t w
 	if (extraParamAccCfg == NULL) return;
 
 	pj_mutex_lock(extraParamAccCfg->_subModlist_mutex);
-	std::list<pjsip_evsub *, std::allocator<pjsip_evsub *>>::iterator it;
-	it = extraParamAccCfg->_subModlist.begin();
-	for (it = extraParamAccCfg->_subModlist.begin(); it != extraParamAccCfg->_subModlist.end(); it++)
+	sub_entry *e;
+	for (e = extraParamAccCfg->_subModlist.next; e != &extraParamAccCfg->_subModlist; e = e->next)
 	{
-		pjsip_evsub *dlgsub = *it;
+		pjsip_evsub *dlgsub = e->sub;
 		if (dlgsub)
 		{
 			pjsip_event_hdr *eventhdr = (pjsip_event_hdr *) pjsip_evsub_get_event_hdr(dlgsub);		
@@ -7,36 +7,55 @@
 #define __EXTRAPARAMACCID_H__
 
 #include "Global.h"
-#include "exceptions.h"
-#include <list>
+#include "Exceptions.h"
 
 /*Estructura que define parametros extra de un account ID.*/
 class ExtraParamAccId
 {
 private:
 
-	struct from_user_subs
+	static const int SUBMOD_KEY_SIZE = CORESIP_MAX_USER_ID_LENGTH + CORESIP_MAX_URI_LENGTH;
+	static const int DELETED_KEY_SIZE = CORESIP_MAX_USER_ID_LENGTH + CORESIP_MAX_URI_LENGTH + CORESIP_MAX_TAG_LENGTH;
+
+	//Subscripcion activa. Se indexa por el puntero al modulo y por "user@host" del contact remoto
+	struct sub_entry
+	{
+		PJ_DECL_LIST_MEMBER(struct sub_entry);	//En _subModlist, en el orden en que se agregan, o en _subModfree
+		pj_hash_entry_buf sub_hbuf;				//Nodo en _subModHash
+		pj_hash_entry_buf key_hbuf;				//Nodo en _subModKeyHash, si es la primera subscripcion con su clave
+		sub_entry *key_next;					//Siguiente subscripcion con la misma clave
+		pjsip_evsub *sub;
+		unsigned keylen;
+		char key[SUBMOD_KEY_SIZE];
+	};
+
+	//Usuario que ha solicitado subscripcion y ha sido borrado. La clave es "user@host;tag" del from
+	struct deleted_entry
 	{
-		char user[CORESIP_MAX_USER_ID_LENGTH];
-		char host[CORESIP_MAX_URI_LENGTH];
-		char tag[CORESIP_MAX_TAG_LENGTH];
+		PJ_DECL_LIST_MEMBER(struct deleted_entry);	//En _DeletedsubModlist, del usado hace mas tiempo al mas reciente
+		pj_hash_entry_buf hbuf;					//Nodo en _DeletedsubModHash
+		unsigned keylen;
+		char key[DELETED_KEY_SIZE];
 	};
 
-	pj_pool_t *_Pool;		
-	pjsip_evsub * _ConfSrvEvSub;		//Modulo para la la subscripcion al evento de converencia fuera de un dialogo INV
-	std::list<pjsip_evsub *, std::allocator<pjsip_evsub *>> _subModlist;
-										//Contiene los punteros a los modulos de subscripcion 
+	pj_pool_t *_Pool;						//Tambien guarda las entradas de las listas
+	pjsip_evsub * _ConfSrvEvSub;			//Modulo para la la subscripcion al evento de converencia fuera de un dialogo INV
+	sub_entry _subModlist;					//Contiene los modulos de subscripcion 
 										//correspondiente a un account del agente
+	sub_entry _subModfree;					//Entradas libres
+	pj_hash_table_t *_subModHash;			//Entradas de _subModlist por puntero al modulo
+	pj_hash_table_t *_subModKeyHash;		//Primera entrada de _subModlist de cada contact remoto
 
-	std::list<from_user_subs *, std::allocator<from_user_subs *>> _DeletedsubModlist;
-										//Contiene los punteros a los usuarios incluyendo su tag que han solicitado 
+	deleted_entry _DeletedsubModlist;		//Contiene los usuarios incluyendo su tag que han solicitado 
 										//subscripcion y han sido borrados,
 										//correspondientes a un account del agente. 
 										//Sirve para cuando se recibe tarde un reintento de peticion de subscripcion 
 										//con el mismo from pero que ya ha sido borrado de la lista _subModlist
+	pj_hash_table_t *_DeletedsubModHash;	//Entradas de _DeletedsubModlist por clave
+	unsigned _DeletedsubModcount;
 	static const size_t MAX_DeletedsubModlist_size = 64;
 										//Maxima cantidad de elementos de la lista _DeletedsubModlist. 
-										//Si se alcanza esta cantidad entonces se elimina el elemento mas antiguo
+										//Si se alcanza esta cantidad entonces se reutiliza el usado hace mas tiempo
 
 	pj_mutex_t *_subModlist_mutex;
 
@@ -60,11 +79,22 @@ public:
 
 	static int Add_subMod(pjsip_evsub *conf);
 	static int Del_subMod(pjsip_evsub *conf);
+	static void Refresh_subMod(pjsip_evsub *sub);
 	static pjsip_evsub * Get_subMod(pjsua_acc_id accid, pjsip_uri *remote_uri, pj_str_t *event_type);	
 	static int Add_DeletedsubModlist(pjsua_acc_id accid, pjsip_uri *remote_uri, pj_str_t *remote_from_tag);
 	static pj_bool_t IsInDeletedList(pjsua_acc_id accid, pjsip_uri *remote_uri, pj_str_t *remote_from_tag);
 	static void SendConfInfoFromAcc(pjsua_acc_id accid, const CORESIP_ConfInfo * conf);
 	static void SendDialogNotifyFromAcc(pjsua_call_id call_id, pj_bool_t with_body);
+
+private:
+
+	static unsigned MakeSubModKey(pjsip_uri *uri, char *key);
+	static unsigned GetSubModKey(pjsip_evsub *sub, char *key);
+	static pj_bool_t MakeDeletedKey(pjsip_uri *remote_uri, pj_str_t *remote_from_tag, char *key, unsigned *keylen);
+	void LinkSubModKey(sub_entry *e);
+	void UnlinkSubModKey(sub_entry *e);
+	void UnlinkSubMod(sub_entry *e);
+	deleted_entry * FindDeleted(const char *key, unsigned keylen);
 };
 
 #endif
\ No newline at end of file
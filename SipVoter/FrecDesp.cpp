@@ -16,6 +16,7 @@
 #define STRCMP(A,B) strcmp(A,B)
 //#define STRCMP(A,B) strncmp(A, B, 5)	//Se considera del mismo grupo todas las radios que coincidan los 5 primeros caracteres
 										//Sirve para probar climax antes de implementarlos en el NODEBOX
+										//Si se usa, GroupHash tambien debe limitarse a esos 5 caracteres
 
 const float FrecDesp::OFFSET_THRESHOLD = 1.0;
 
@@ -28,36 +29,14 @@ FrecDesp::FrecDesp()
 {
 	for (int i = 0; i < MAX_GROUPS; i++)
 	{
-		groups[i].RdFr[0] = 0;
-		for (int j = 0; j < MAX_SESSIONS; j++)
-		{
-			groups[i].sessions[j].sess_callid = PJSUA_INVALID_ID;
-			groups[i].sessions[j].pSipcall = NULL;
-			groups[i].sessions[j].TdTxIP = INVALID_TIME_DELAY;
-			groups[i].sessions[j].Tj1 = INVALID_TIME_DELAY;
-			groups[i].sessions[j].Tj1_count = 0;
-			groups[i].sessions[j].Tn1_count = 0;
-			groups[i].sessions[j].cld_absoluto = PJ_FALSE;
-			groups[i].sessions[j].Bss_value = 0;
-			groups[i].sessions[j].Bss_type = 0;
-			groups[i].sessions[j].squ_status = PJ_FALSE;
-			groups[i].sessions[j].selected = PJ_FALSE;
-			groups[i].sessions[j].Tred = 0;
-			groups[i].sessions[j]._MetodoClimax = Relative;
-			groups[i].sessions[j].Bss_selected_method[0] = '\0';
-			groups[i].sessions[j].Tid_orig = 0;
-			groups[i].sessions[j].cld_prev = INVALID_CLD_PREV;
-			groups[i].sessions[j].Flags = CORESIP_CALL_RD_RXONLY;
-			groups[i].sessions[j].in_window_timer = PJ_FALSE;			
-		}
-		groups[i].nsessions = 0;
-		groups[i].nsessions_rx_only = 0;
-		groups[i].nsessions_tx_only = 0;
-		groups[i].mcast_seq = 0;
-		groups[i]._RdSendTo = NULL;
-		groups[i].SelectedUri[0] = '\0';
-		groups[i].SelectedUriPttId = 0;
+		groups[i] = NULL;
+	}
+	for (int i = 0; i < GROUP_HASH_SIZE; i++)
+	{
+		group_hash[i] = -1;
 	}
+	nslots.store(0, std::memory_order_relaxed);
+	free_slot = -1;
 	ngroups = 0;
 	NTP_synchronized = PJ_FALSE;
 
@@ -96,6 +75,20 @@ FrecDesp::~FrecDesp()
 		ntp_check_thread = NULL;
 	}
 
+	int n = nslots.load(std::memory_order_relaxed);
+	for (int i = 0; i < n; i++)
+	{
+		int nsess = groups[i]->nsess_slots.load(std::memory_order_relaxed);
+		for (int j = 0; j < nsess; j++)
+		{
+			delete groups[i]->sessions[j];
+		}
+		pj_mutex_destroy(groups[i]->grp_mutex);
+		delete groups[i];
+		groups[i] = NULL;
+	}
+	nslots.store(0, std::memory_order_relaxed);
+
 	if (_Pool)
 	{
 		pj_pool_release(_Pool);
@@ -103,6 +96,208 @@ FrecDesp::~FrecDesp()
 
 }
 
+/**
+ * InitGroup.	...
+ * Deja un grupo vacio, sin sesiones reservadas.
+ * @param	g		Puntero al grupo
+ * @return	nada.
+ */
+void FrecDesp::InitGroup(stgrupo *g)
+{
+	g->RdFr[0] = 0;
+	g->Zona[0] = 0;
+	g->next = -1;
+	for (int j = 0; j < MAX_SESSIONS; j++)
+	{
+		g->sessions[j] = NULL;
+	}
+	g->nsess_slots.store(0, std::memory_order_relaxed);
+	g->nsessions = 0;
+	g->nsessions_rx_only = 0;
+	g->nsessions_tx_only = 0;
+	g->mcast_seq = 0;
+	g->_RdSendTo = NULL;
+	g->SelectedUri[0] = '\0';
+	g->SelectedUriPttId = 0;
+}
+
+/**
+ * InitSession.	...
+ * Deja libre una sesion de un grupo.
+ * @param	sess	Puntero a la sesion
+ * @return	nada.
+ */
+void FrecDesp::InitSession(stgrupo::stsess *sess)
+{
+	sess->sess_callid = PJSUA_INVALID_ID;
+	sess->pSipcall = NULL;
+	sess->TdTxIP = INVALID_TIME_DELAY;
+	sess->Tj1 = INVALID_TIME_DELAY;
+	sess->Tj1_count = 0;
+	sess->Tn1_count = 0;
+	sess->cld_absoluto = PJ_FALSE;
+	sess->Bss_value = 0;
+	sess->Bss_type = 0;
+	sess->squ_status = PJ_FALSE;
+	sess->selected = PJ_FALSE;
+	sess->Tred = 0;
+	sess->_MetodoClimax = Relative;
+	sess->Bss_selected_method[0] = '\0';
+	sess->Tid_orig = 0;
+	sess->cld_prev = INVALID_CLD_PREV;
+	sess->Flags = CORESIP_CALL_RD_RXONLY;
+	sess->in_window_timer = PJ_FALSE;
+}
+
+/**
+ * NewSession.	...
+ * Reserva una sesion mas en un grupo que tiene todas las suyas ocupadas. Las sesiones reservadas no se liberan
+ * hasta que se destruye el objeto, asi los indices de sesion que tienen las llamadas siempre apuntan a memoria
+ * valida. Se llama con fd_mutex y grp_mutex del grupo tomados.
+ * @param	index_group		Indice del grupo
+ * @return	Indice de la sesion. -1 si el grupo ya tiene MAX_SESSIONS.
+ */
+int FrecDesp::NewSession(int index_group)
+{
+	stgrupo *g = groups[index_group];
+	int j = g->nsess_slots.load(std::memory_order_relaxed);
+	if (j >= MAX_SESSIONS)
+	{
+		return -1;
+	}
+
+	g->sessions[j] = new stgrupo::stsess;
+	InitSession(g->sessions[j]);
+	//Los que comprueban el indice sin grp_mutex ven la sesion ya creada
+	g->nsess_slots.store(j + 1, std::memory_order_release);
+	return j;
+}
+
+/**
+ * GroupHash.	...
+ * Calcula la entrada de la tabla hash de grupos que corresponde a una frecuencia y una zona.
+ * Debe ser coherente con STRCMP: dos grupos iguales segun STRCMP deben dar la misma entrada.
+ * @param	rdfr		Identificador de la Frecuencia
+ * @param	zona		Identificador de la Zona
+ * @return	Entrada de la tabla hash.
+ */
+unsigned int FrecDesp::GroupHash(const char *rdfr, const char *zona)
+{
+	//FNV-1a sobre la frecuencia y la zona
+	unsigned int h = 2166136261u;
+	for (const char *p = rdfr; *p; p++)
+	{
+		h ^= (unsigned char) *p;
+		h *= 16777619u;
+	}
+	h ^= 0xFF;		//Separador, para que ("AB","C") y ("A","BC") no coincidan
+	h *= 16777619u;
+	for (const char *p = zona; *p; p++)
+	{
+		h ^= (unsigned char) *p;
+		h *= 16777619u;
+	}
+	return h & (GROUP_HASH_SIZE - 1);
+}
+
+/**
+ * FindGroup.	...
+ * Busca el grupo de una frecuencia y zona. Se llama con fd_mutex tomado.
+ * @param	rdfr		Identificador de la Frecuencia
+ * @param	zona		Identificador de la Zona
+ * @return	Indice del grupo. -1 si no existe.
+ */
+int FrecDesp::FindGroup(const char *rdfr, const char *zona)
+{
+	for (int i = group_hash[GroupHash(rdfr, zona)]; i >= 0; i = groups[i]->next)
+	{
+		if (STRCMP(groups[i]->RdFr, rdfr) == 0 && STRCMP(groups[i]->Zona, zona) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * NewGroup.	...
+ * Ocupa un grupo para una frecuencia y zona y lo anade a la tabla hash. Se reutilizan los grupos
+ * que se han quedado vacios y solo se reserva memoria para uno nuevo si no hay ninguno libre.
+ * Los grupos reservados no se liberan hasta que se destruye el objeto, asi los indices de grupo
+ * que tienen las sesiones siempre apuntan a memoria valida. Se llama con fd_mutex tomado.
+ * @param	rdfr		Identificador de la Frecuencia
+ * @param	zona		Identificador de la Zona
+ * @return	Indice del grupo. -1 si no hay grupos libres.
+ */
+int FrecDesp::NewGroup(const char *rdfr, const char *zona)
+{
+	int i;
+
+	if (free_slot >= 0)
+	{
+		i = free_slot;
+		free_slot = groups[i]->next;
+	}
+	else if (nslots.load(std::memory_order_relaxed) < MAX_GROUPS)
+	{
+		i = nslots.load(std::memory_order_relaxed);
+		groups[i] = new stgrupo;
+		if (pj_mutex_create_simple(_Pool, "grp_mutex", &groups[i]->grp_mutex) != PJ_SUCCESS)
+		{
+			delete groups[i];
+			groups[i] = NULL;
+			return -1;
+		}
+		InitGroup(groups[i]);
+		//Los que comprueban el indice sin fd_mutex ven el grupo ya creado
+		nslots.store(i + 1, std::memory_order_release);
+	}
+	else
+	{
+		return -1;
+	}
+
+	pj_mutex_lock(groups[i]->grp_mutex);
+	strcpy(groups[i]->RdFr, rdfr);
+	strcpy(groups[i]->Zona, zona);
+	groups[i]->mcast_seq = 0;
+	groups[i]->_RdSendTo = NULL;
+	groups[i]->SelectedUri[0] = '\0';
+	groups[i]->SelectedUriPttId = 0;
+	pj_mutex_unlock(groups[i]->grp_mutex);
+
+	unsigned int h = GroupHash(rdfr, zona);
+	groups[i]->next = group_hash[h];
+	group_hash[h] = i;
+
+	return i;
+}
+
+/**
+ * FreeGroup.	...
+ * Saca de la tabla hash un grupo que se ha quedado vacio y lo deja en la lista de libres.
+ * Se llama con fd_mutex tomado.
+ * @param	index_group		Indice del grupo
+ * @return	nada.
+ */
+void FrecDesp::FreeGroup(int index_group)
+{
+	int *link = &group_hash[GroupHash(groups[index_group]->RdFr, groups[index_group]->Zona)];
+	while (*link >= 0 && *link != index_group)
+	{
+		link = &groups[*link]->next;
+	}
+	if (*link == index_group)
+	{
+		*link = groups[index_group]->next;
+	}
+
+	groups[index_group]->RdFr[0] = 0;
+	groups[index_group]->Zona[0] = 0;
+	groups[index_group]->next = free_slot;
+	free_slot = index_group;
+}
+
 /**
  * AddToGroup.	...
  * Agrega el call id de una sesion a un grupo. Si no existe un grupo con esa frecuencia, lo crea.
@@ -134,20 +329,17 @@ int FrecDesp::AddToGroup(char *rdfr, pjsua_call_id call_id, SipCall *psipcall, c
 
 	pj_mutex_lock(fd_mutex);
 	//Se comprueba si ya existe un grupo con esos identificadores de zona y frecuencia que tiene ese call_id y session
-	for (i = 0; i < MAX_GROUPS; i++)
+	i = FindGroup(rdfr, zona);
+	if (i >= 0)
 	{
-		if (STRCMP(groups[i].RdFr, rdfr) == 0 && STRCMP(groups[i].Zona, zona) == 0)
+		found_fr = true;
+		for (j = 0; j < groups[i]->nsess_slots.load(std::memory_order_relaxed); j++)
 		{
-			found_fr = true;
-			for (j = 0; j < MAX_SESSIONS; j++)
+			if (groups[i]->sessions[j]->sess_callid == call_id)
 			{
-				if (groups[i].sessions[j].sess_callid == call_id)
-				{
-					found_cid = true;
-					break;
-				}
+				found_cid = true;
+				break;
 			}
-			break;
 		}
 	}
 
@@ -158,77 +350,75 @@ int FrecDesp::AddToGroup(char *rdfr, pjsua_call_id call_id, SipCall *psipcall, c
 		{
 			//No se ha encontrado un grupo con los identificadores de frecuencia y zona.
 			//Entonces se crea
-			for (i = 0; i < MAX_GROUPS; i++)
+			if (strlen(rdfr) >= sizeof(groups[0]->RdFr) || strlen(zona) >= sizeof(groups[0]->Zona))
 			{
-				if (strlen(groups[i].RdFr) == 0 || strlen(groups[i].Zona) == 0)
-				{	
-					if (strlen(rdfr) < sizeof(groups[i].RdFr) && strlen(zona) < sizeof(groups[i].Zona))
-					{
-						strcpy(groups[i].RdFr, rdfr);
-						strcpy(groups[i].Zona, zona);
-						groups[i].mcast_seq = 0;
-						groups[i]._RdSendTo = NULL;
-						groups[i].SelectedUri[0] = '\0';
-						groups[i].SelectedUriPttId = 0;
-						ngroups_aux++;
-					}
-					else
-					{
-						PJ_LOG(3,(__FILE__, "ERROR: Identificador de frecuencia o de grupo demasiado largo \n"));
-						ret = -1;   //Cadena de rdfr demasiado larga
-					}
-					break;
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Identificador de frecuencia o de grupo demasiado largo \n"));
+				ret = -1;   //Cadena de rdfr demasiado larga
 			}
-			if (i == MAX_GROUPS) 
+			else
 			{
-				PJ_LOG(3,(__FILE__, "ERROR: Sobrepasado en numero de grupos \n"));
-				ret = -1;   //No hay ning�n grupo libre
+				i = NewGroup(rdfr, zona);
+				if (i < 0)
+				{
+					PJ_LOG(3,(__FILE__, "ERROR: Sobrepasado en numero de grupos \n"));
+					ret = -1;   //No hay ning�n grupo libre
+				}
+				else
+				{
+					ngroups_aux++;
+				}
 			}
 		}
 
 		//Se a�ade el call_id al grupo
 		if (ret == 0)
 		{
-			for (j = 0; j < MAX_SESSIONS; j++)
+			pj_mutex_lock(groups[i]->grp_mutex);
+			for (j = 0; j < groups[i]->nsess_slots.load(std::memory_order_relaxed); j++)
+			{
+				if (groups[i]->sessions[j]->sess_callid == PJSUA_INVALID_ID) break;
+			}
+			if (j == groups[i]->nsess_slots.load(std::memory_order_relaxed))
+			{
+				//Todas las sesiones reservadas estan ocupadas. Se reserva una mas
+				j = NewSession(i);
+			}
+			if (j >= 0)
 			{
-				if (groups[i].sessions[j].sess_callid == PJSUA_INVALID_ID)
+				groups[i]->sessions[j]->sess_callid = call_id;
+				groups[i]->sessions[j]->Flags = flags;
+				groups[i]->sessions[j]->pSipcall = psipcall;
+				groups[i]->sessions[j]->TdTxIP = INVALID_TIME_DELAY;
+				groups[i]->sessions[j]->Tj1 = INVALID_TIME_DELAY;
+				groups[i]->sessions[j]->Tj1_count = 0;
+				groups[i]->sessions[j]->Tn1_count = 0;
+				groups[i]->sessions[j]->cld_absoluto = PJ_FALSE;
+				groups[i]->sessions[j]->Bss_value = 0;
+				groups[i]->sessions[j]->Bss_type = 0;
+				groups[i]->sessions[j]->Tred = 0;
+				groups[i]->sessions[j]->squ_status = PJ_FALSE;
+				groups[i]->sessions[j]->selected = PJ_FALSE;
+				groups[i]->sessions[j]->_MetodoClimax = metCld;
+				groups[i]->sessions[j]->Tid_orig = 0;
+				groups[i]->sessions[j]->cld_prev = INVALID_CLD_PREV;		
+				groups[i]->sessions[j]->in_window_timer = PJ_FALSE; 
+				if (Bss_selected_method)
 				{
-					groups[i].sessions[j].sess_callid = call_id;
-					groups[i].sessions[j].Flags = flags;
-					groups[i].sessions[j].pSipcall = psipcall;
-					groups[i].sessions[j].TdTxIP = INVALID_TIME_DELAY;
-					groups[i].sessions[j].Tj1 = INVALID_TIME_DELAY;
-					groups[i].sessions[j].Tj1_count = 0;
-					groups[i].sessions[j].Tn1_count = 0;
-					groups[i].sessions[j].cld_absoluto = PJ_FALSE;
-					groups[i].sessions[j].Bss_value = 0;
-					groups[i].sessions[j].Bss_type = 0;
-					groups[i].sessions[j].Tred = 0;
-					groups[i].sessions[j].squ_status = PJ_FALSE;
-					groups[i].sessions[j].selected = PJ_FALSE;
-					groups[i].sessions[j]._MetodoClimax = metCld;
-					groups[i].sessions[j].Tid_orig = 0;
-					groups[i].sessions[j].cld_prev = INVALID_CLD_PREV;		
-					groups[i].sessions[j].in_window_timer = PJ_FALSE; 
-					if (Bss_selected_method)
-					{
-						strncpy(groups[i].sessions[j].Bss_selected_method, Bss_selected_method, 
-							sizeof(groups[i].sessions[j].Bss_selected_method)-1);
-						groups[i].sessions[j].Bss_selected_method[sizeof(groups[i].sessions[j].Bss_selected_method)-1] = '\0';
-					}
-					groups[i].nsessions++;
-					ret = groups[i].nsessions;
+					strncpy(groups[i]->sessions[j]->Bss_selected_method, Bss_selected_method, 
+						sizeof(groups[i]->sessions[j]->Bss_selected_method)-1);
+					groups[i]->sessions[j]->Bss_selected_method[sizeof(groups[i]->sessions[j]->Bss_selected_method)-1] = '\0';
+				}
+				groups[i]->nsessions++;
+				ret = groups[i]->nsessions;
 
-					if (flags & CORESIP_CALL_RD_RXONLY) groups[i].nsessions_rx_only++;
-					else if (flags & CORESIP_CALL_RD_TXONLY) groups[i].nsessions_tx_only++;
+				if (flags & CORESIP_CALL_RD_RXONLY) groups[i]->nsessions_rx_only++;
+				else if (flags & CORESIP_CALL_RD_TXONLY) groups[i]->nsessions_tx_only++;
 
-					psipcall->_Index_group = i;
-					psipcall->_Index_sess = j;
-					break;
-				}
+				psipcall->_Index_group = i;
+				psipcall->_Index_sess = j;
 			}
-			if (j == MAX_SESSIONS) 
+			pj_mutex_unlock(groups[i]->grp_mutex);
+			if (j < 0) 
 			{
 				PJ_LOG(3,(__FILE__, "ERROR: Sobrepasado en numero de sesiones en un grupo \n"));
 				ret = -1;	//No hay sesiones libres para el grupo
@@ -267,62 +457,65 @@ int FrecDesp::RemFromGroup(int index_group, int index_sess)
 {
 	int ret = 0;
 
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS)
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire))
 	{
 		//PJ_LOG(3,(__FILE__, "ERROR: FrecDesp::RemFromGroup index_group (%d) o index_sess (%d) son erroneos \n", index_group, index_sess));
 		return -1;
 	}	
 
 	pj_mutex_lock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
 
-	if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+	if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 	{
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		pj_mutex_unlock(fd_mutex);
 		return -1;
 	}
 
-	if ((groups[index_group].sessions[index_sess].Flags & CORESIP_CALL_RD_RXONLY) && (groups[index_group].nsessions_rx_only > 0))
-		groups[index_group].nsessions_rx_only--;
-	else if ((groups[index_group].sessions[index_sess].Flags & CORESIP_CALL_RD_TXONLY) && (groups[index_group].nsessions_tx_only > 0))
-		groups[index_group].nsessions_tx_only--;
-
-	groups[index_group].sessions[index_sess].sess_callid = PJSUA_INVALID_ID;
-	groups[index_group].sessions[index_sess].pSipcall = NULL;
-	groups[index_group].sessions[index_sess].TdTxIP = INVALID_TIME_DELAY;
-	groups[index_group].sessions[index_sess].Tj1 = INVALID_TIME_DELAY;
-	groups[index_group].sessions[index_sess].Tj1_count = 0;
-	groups[index_group].sessions[index_sess].Tn1_count = 0;
-	groups[index_group].sessions[index_sess].cld_absoluto = PJ_FALSE;
-	groups[index_group].sessions[index_sess].Bss_value = 0;
-	groups[index_group].sessions[index_sess].Bss_type = 0;
-	groups[index_group].sessions[index_sess].Tred = 0;
-	groups[index_group].sessions[index_sess].squ_status = PJ_FALSE;
-	groups[index_group].sessions[index_sess].selected = PJ_FALSE;
-	groups[index_group].sessions[index_sess]._MetodoClimax = Relative;
-	groups[index_group].sessions[index_sess].Bss_selected_method[0] = '\0';
-	groups[index_group].sessions[index_sess].Tid_orig = 0;
-	groups[index_group].sessions[index_sess].cld_prev = INVALID_CLD_PREV;
-	groups[index_group].sessions[index_sess].in_window_timer = PJ_FALSE;
-
-	if (groups[index_group].nsessions > 0) groups[index_group].nsessions--;
-	ret = groups[index_group].nsessions;
-
-	if (groups[index_group].nsessions == 0)
+	if ((groups[index_group]->sessions[index_sess]->Flags & CORESIP_CALL_RD_RXONLY) && (groups[index_group]->nsessions_rx_only > 0))
+		groups[index_group]->nsessions_rx_only--;
+	else if ((groups[index_group]->sessions[index_sess]->Flags & CORESIP_CALL_RD_TXONLY) && (groups[index_group]->nsessions_tx_only > 0))
+		groups[index_group]->nsessions_tx_only--;
+
+	groups[index_group]->sessions[index_sess]->sess_callid = PJSUA_INVALID_ID;
+	groups[index_group]->sessions[index_sess]->pSipcall = NULL;
+	groups[index_group]->sessions[index_sess]->TdTxIP = INVALID_TIME_DELAY;
+	groups[index_group]->sessions[index_sess]->Tj1 = INVALID_TIME_DELAY;
+	groups[index_group]->sessions[index_sess]->Tj1_count = 0;
+	groups[index_group]->sessions[index_sess]->Tn1_count = 0;
+	groups[index_group]->sessions[index_sess]->cld_absoluto = PJ_FALSE;
+	groups[index_group]->sessions[index_sess]->Bss_value = 0;
+	groups[index_group]->sessions[index_sess]->Bss_type = 0;
+	groups[index_group]->sessions[index_sess]->Tred = 0;
+	groups[index_group]->sessions[index_sess]->squ_status = PJ_FALSE;
+	groups[index_group]->sessions[index_sess]->selected = PJ_FALSE;
+	groups[index_group]->sessions[index_sess]->_MetodoClimax = Relative;
+	groups[index_group]->sessions[index_sess]->Bss_selected_method[0] = '\0';
+	groups[index_group]->sessions[index_sess]->Tid_orig = 0;
+	groups[index_group]->sessions[index_sess]->cld_prev = INVALID_CLD_PREV;
+	groups[index_group]->sessions[index_sess]->in_window_timer = PJ_FALSE;
+
+	if (groups[index_group]->nsessions > 0) groups[index_group]->nsessions--;
+	ret = groups[index_group]->nsessions;
+
+	if (groups[index_group]->nsessions == 0)
 	{
 		//El grupo se queda vac�o. Lo eliminamos
-		groups[index_group].RdFr[0] = 0;
-		groups[index_group].Zona[0] = 0;
-		groups[index_group].mcast_seq = 0;
-		groups[index_group].nsessions_rx_only = 0;
-		groups[index_group].nsessions_tx_only = 0;
-		groups[index_group]._RdSendTo = NULL;
-		groups[index_group].SelectedUri[0] = '\0';
-		groups[index_group].SelectedUriPttId = 0;
+		FreeGroup(index_group);
+		groups[index_group]->mcast_seq = 0;
+		groups[index_group]->nsessions_rx_only = 0;
+		groups[index_group]->nsessions_tx_only = 0;
+		groups[index_group]->_RdSendTo = NULL;
+		groups[index_group]->SelectedUri[0] = '\0';
+		groups[index_group]->SelectedUriPttId = 0;
 		if (ngroups > 0) ngroups--;
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		pj_mutex_unlock(fd_mutex);
 	}
 	else
 	{
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		pj_mutex_unlock(fd_mutex);
 		UpdateGroupClimaxParams(index_group);
 	}	
@@ -342,17 +535,17 @@ int FrecDesp::GetSessionsCountInGroup(int index_group, int *nsessions_rx_only, i
 {
 	int ret;
 
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		PJ_LOG(3,(__FILE__, "ERROR: FrecDesp::GetSessionsCountInGroup index_group (%d) es erroneo \n", index_group));
 		return -1;
 	}
 
-	pj_mutex_lock(fd_mutex);
-	ret = groups[index_group].nsessions;
-	if (nsessions_rx_only != NULL) *nsessions_rx_only = groups[index_group].nsessions_rx_only;
-	if (nsessions_tx_only != NULL) *nsessions_tx_only = groups[index_group].nsessions_tx_only;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	ret = groups[index_group]->nsessions;
+	if (nsessions_rx_only != NULL) *nsessions_rx_only = groups[index_group]->nsessions_rx_only;
+	if (nsessions_tx_only != NULL) *nsessions_tx_only = groups[index_group]->nsessions_tx_only;
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -368,29 +561,29 @@ int FrecDesp::UpdateGroupClimaxParams(int index_group)
 	int j;
 	int ret = 0;
 
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 	
-	pj_mutex_lock(fd_mutex);
-	for (j = 0; j < MAX_SESSIONS; j++)
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	for (j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 	{
-		if (groups[index_group].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-		if (!pjsua_call_is_active(groups[index_group].sessions[j].sess_callid)) continue;
-		if (!pjsua_call_has_media(groups[index_group].sessions[j].sess_callid)) continue;
+		if (groups[index_group]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+		if (!pjsua_call_is_active(groups[index_group]->sessions[j]->sess_callid)) continue;
+		if (!pjsua_call_has_media(groups[index_group]->sessions[j]->sess_callid)) continue;
 
 		pj_bool_t NTP_sync;			
-		if (groups[index_group].sessions[j]._MetodoClimax == Absolute && NTP_synchronized == PJ_TRUE) NTP_sync = PJ_TRUE;
+		if (groups[index_group]->sessions[j]->_MetodoClimax == Absolute && NTP_synchronized == PJ_TRUE) NTP_sync = PJ_TRUE;
 		else NTP_sync = PJ_FALSE;
-		pjmedia_session *ses = pjsua_call_get_media_session(groups[index_group].sessions[j].sess_callid);
+		pjmedia_session *ses = pjsua_call_get_media_session(groups[index_group]->sessions[j]->sess_callid);
 		if (ses != NULL)
 		{
 			pjmedia_session_set_climax_param(ses, NTP_sync);
 			ret++;
 		}
 	}
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 	
 	return ret;
 }
@@ -406,26 +599,28 @@ int FrecDesp::UpdateGroupClimaxParamsAllGroups()
 	int ret = 0;
 
 	pj_mutex_lock(fd_mutex);
-	for (i = 0; i < MAX_GROUPS; i++)
+	for (i = 0; i < nslots.load(std::memory_order_relaxed); i++)
 	{
-		if (strlen(groups[i].RdFr) > 0)
+		pj_mutex_lock(groups[i]->grp_mutex);
+		if (strlen(groups[i]->RdFr) > 0)
 		{
-			for (j = 0; j < MAX_SESSIONS; j++)
+			for (j = 0; j < groups[i]->nsess_slots.load(std::memory_order_relaxed); j++)
 			{
-				if (groups[i].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-				if (!pjsua_call_is_active(groups[i].sessions[j].sess_callid)) continue;
-				if (!pjsua_call_has_media(groups[i].sessions[j].sess_callid)) continue;
+				if (groups[i]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+				if (!pjsua_call_is_active(groups[i]->sessions[j]->sess_callid)) continue;
+				if (!pjsua_call_has_media(groups[i]->sessions[j]->sess_callid)) continue;
 
 				pj_bool_t NTP_sync;			
-				if (groups[i].sessions[j]._MetodoClimax == Absolute && NTP_synchronized == PJ_TRUE) NTP_sync = PJ_TRUE;
+				if (groups[i]->sessions[j]->_MetodoClimax == Absolute && NTP_synchronized == PJ_TRUE) NTP_sync = PJ_TRUE;
 				else NTP_sync = PJ_FALSE;
-				pjmedia_session *ses = pjsua_call_get_media_session(groups[i].sessions[j].sess_callid);
+				pjmedia_session *ses = pjsua_call_get_media_session(groups[i]->sessions[j]->sess_callid);
 				if (ses != NULL)
 				{
 					pjmedia_session_set_climax_param(ses, NTP_sync);
 				}
 			}
 		}		
+		pj_mutex_unlock(groups[i]->grp_mutex);
 	}
 	pj_mutex_unlock(fd_mutex);
 
@@ -437,13 +632,13 @@ int FrecDesp::UpdateGroupClimaxParamsAllGroups()
  * Asigna el time delay calculado a partir del MAM recibido a la sesion correspondiente dentro de un grupo. 
  * @param	index_group		Indice del grupo
  * @param   index_sess		Indice de la sesion
- * @param   ext_value		Puntero donde comienza el value del TLV
+ * @param   mam				MAM recibido, decodificado
  * @param   request_MAM     Retorna si el bit NMR est� a 1 y por tanto hay que enviar un RMM en el siguiente paquete RTP
  * @return	Numero de time delays asignadas a la sesion. -1 su hay error.
  */
-int FrecDesp::SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int index_group, int index_sess, pj_uint8_t *ext_value, pj_bool_t *request_MAM)
+int FrecDesp::SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int index_group, int index_sess, const pjmedia_rtp_ed137_mam *mam, pj_bool_t *request_MAM)
 {
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		PJ_LOG(3,(__FILE__, "ERROR: FrecDesp::SetTimeDelay index_group (%d) o index_sess (%d) son erroneos \n", index_group, index_sess));
 		return -1;
@@ -451,18 +646,8 @@ int FrecDesp::SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int
 
 	pj_uint32_t TQG, T1, NMR, T2, Tsd, Tj1, Tid, T4;
 
-	TQG = (pj_uint32_t) *ext_value;
-	TQG >>= 7;
-	TQG &= 0x1;
-
-	T1 = (pj_uint32_t) *ext_value;
-	T1 &= 0x7F;
-	T1 <<= 8;
-	ext_value++;
-	T1 |= (pj_uint32_t) *ext_value;
-	ext_value++;
-	T1 <<= 8;
-	T1 |= (pj_uint32_t) *ext_value;
+	TQG = (pj_uint32_t) mam->tqg;
+	T1 = mam->t1;
 
 	pj_uint32_t last_T1 = 0;
 	pjmedia_stream_get_last_T1(stream, &last_T1);
@@ -473,37 +658,17 @@ int FrecDesp::SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int
 		return -1;
 	}
 
-	ext_value++;
-	NMR = (pj_uint32_t) ((*ext_value >> 7) & 0x01);
-	T2 = (pj_uint32_t) (*ext_value & 0x7F);
-	ext_value++;
-	T2 <<= 8;
-	T2 |= (pj_uint32_t) *ext_value;
-	ext_value++;
-	T2 <<= 8;
-	T2 |= (pj_uint32_t) *ext_value;
-		
-	ext_value++;
-	Tsd = (pj_uint32_t) *ext_value;
-	ext_value++;
-	Tsd <<= 8;
-	Tsd |= (pj_uint32_t) *ext_value;
-
-	ext_value++;
-	Tj1 = (pj_uint32_t) *ext_value;
-	ext_value++;
-	Tj1 <<= 8;
-	Tj1 |= (pj_uint32_t) *ext_value;
-
-	ext_value++;
-	Tid = (pj_uint32_t) *ext_value;
-	ext_value++;
-	Tid <<= 8;
-	Tid |= (pj_uint32_t) *ext_value;	
+	NMR = (pj_uint32_t) mam->nmr;
+	T2 = mam->t2;
+	Tsd = (pj_uint32_t) mam->tsd;
+	Tj1 = (pj_uint32_t) mam->tj1;
+	Tid = (pj_uint32_t) mam->tid;
 
-	FILETIME SystemTimeAsFileTime;
 	unsigned long long ullT4, ullT4_seg;			
 
+#ifdef _WIN32
+	FILETIME SystemTimeAsFileTime;
+
 	GetSystemTimeAsFileTime(&SystemTimeAsFileTime);  	
 		
 	//ullT4 en unidades de 100ns. En formato FILETIME. Desde 0 horas 1/1/1601
@@ -514,6 +679,14 @@ int FrecDesp::SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int
 	//Se le resta el tiempo en unidades de 100ns desde 0 horas 1/1/1601 a 0 horas 1/1/1900
 	//Para convertirlo en NTP timestamp
 	ullT4 -= (unsigned long long) 94354848000000000;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	//ullT4 en unidades de 100ns desde 0 horas 1/1/1900. Son 2208988800 segundos desde 1/1/1900 a 1/1/1970
+	ullT4 = ((unsigned long long) tv.tv_sec + 2208988800ULL) * 10000000 + (unsigned long long) tv.tv_usec * 10;
+#endif
 
 	ullT4_seg = ullT4 / 10000000;   //Timestamp en segundos. Ser�an los 32bits de mayor peso de un NTP timestamp de 64 bits
 	ullT4 -= ullT4_seg * 10000000;  //A ullT4 le restamos la cantidad de segundos pero en unidades de 100ns
@@ -529,7 +702,7 @@ int FrecDesp::SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int
 	pj_uint32_t Tn1 = 0;
 
 	//Calculamos el Time delay en Tx.   
-	CORESIP_CLD_CALCULATE_METHOD NTP_sync = groups[index_group].sessions[index_group]._MetodoClimax;
+	CORESIP_CLD_CALCULATE_METHOD NTP_sync = groups[index_group]->sessions[index_sess]->_MetodoClimax;
 
 	pj_bool_t metodo_absoluto = PJ_FALSE;
 	if (NTP_sync == Absolute && TQG != 0)
@@ -579,176 +752,176 @@ int FrecDesp::SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int
 	}
 	*/
 
-	PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s PTT %d TQG 0x%X T1 0x%X NMR 0x%X T2 0x%X Tsd 0x%X Tj1 0x%X Tid 0x%X, T4 0x%X, T4-T1 %d us, Tred %d us, Absoluto %d", groups[index_group].RdFr, ptttype, TQG, T1, NMR, T2, Tsd, Tj1, Tid, T4, (T4-T1)*125, Tn1*125, metodo_absoluto));
+	PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s PTT %d TQG 0x%X T1 0x%X NMR 0x%X T2 0x%X Tsd 0x%X Tj1 0x%X Tid 0x%X, T4 0x%X, T4-T1 %d us, Tred %d us, Absoluto %d", groups[index_group]->RdFr, ptttype, TQG, T1, NMR, T2, Tsd, Tj1, Tid, T4, (T4-T1)*125, Tn1*125, metodo_absoluto));
 
-	pj_mutex_lock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
 
-	if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+	if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
-	if (!pjsua_call_is_active(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_is_active(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
-	if (!pjsua_call_has_media(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_has_media(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
 
 /*
-	if ((NMR == 0) && (groups[index_group].sessions[index_sess].TdTxIP != INVALID_TIME_DELAY))
+	if ((NMR == 0) && (groups[index_group]->sessions[index_sess]->TdTxIP != INVALID_TIME_DELAY))
 	{
 		//Si NMR es 0 no recalculamos
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return 0;
 	}
 */
 
 
-	/*if (groups[index_group].sessions[index_sess].Tid_orig != Tid)
+	/*if (groups[index_group]->sessions[index_sess]->Tid_orig != Tid)
 	{
-		PJ_LOG(5,(__FILE__, "CLIMAX: Tid DISTINTO Anterior 0x%X Actual 0x%X PTT %d", groups[index_group].sessions[index_sess].Tid_orig, Tid, ptttype));
+		PJ_LOG(5,(__FILE__, "CLIMAX: Tid DISTINTO Anterior 0x%X Actual 0x%X PTT %d", groups[index_group]->sessions[index_sess]->Tid_orig, Tid, ptttype));
 	}*/
 
-	if (groups[index_group].sessions[index_sess].TdTxIP == INVALID_TIME_DELAY)
+	if (groups[index_group]->sessions[index_sess]->TdTxIP == INVALID_TIME_DELAY)
 	{
 		//Es el primer MAM recibido despu�s de que ha sido establecida la sesion
 		//Salvamos el Tid que nos dan
-		groups[index_group].sessions[index_sess].Tid_orig = Tid;
+		groups[index_group]->sessions[index_sess]->Tid_orig = Tid;
 	}
 	else
 	{
-		Tid = groups[index_group].sessions[index_sess].Tid_orig;
+		Tid = groups[index_group]->sessions[index_sess]->Tid_orig;
 	}
 
 	//Filtramos el Tj1
-	groups[index_group].sessions[index_sess].Tj1 = Tj1;
+	groups[index_group]->sessions[index_sess]->Tj1 = Tj1;
 /*
-	if (groups[index_group].sessions[index_sess].Tj1 == INVALID_TIME_DELAY)
+	if (groups[index_group]->sessions[index_sess]->Tj1 == INVALID_TIME_DELAY)
 	{
-		groups[index_group].sessions[index_sess].Tj1 = Tj1;
-		groups[index_group].sessions[index_sess].Tj1_count = 0;
+		groups[index_group]->sessions[index_sess]->Tj1 = Tj1;
+		groups[index_group]->sessions[index_sess]->Tj1_count = 0;
 	}
-	else if (groups[index_group].sessions[index_sess].Tj1 > Tj1)
+	else if (groups[index_group]->sessions[index_sess]->Tj1 > Tj1)
 	{
-		if ((groups[index_group].sessions[index_sess].Tj1 - Tj1) > 96)  //12 ms
+		if ((groups[index_group]->sessions[index_sess]->Tj1 - Tj1) > 96)  //12 ms
 		{
-			if (++groups[index_group].sessions[index_sess].Tj1_count > Tj1_count_MAX)
+			if (++groups[index_group]->sessions[index_sess]->Tj1_count > Tj1_count_MAX)
 			{
-				PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tj1 DISTINTO MAS DE %d VECES  !!!!!!!!!", groups[index_group].RdFr, Tj1_count_MAX));
-				groups[index_group].sessions[index_sess].Tj1 = Tj1;
-				groups[index_group].sessions[index_sess].Tj1_count = 0;
+				PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tj1 DISTINTO MAS DE %d VECES  !!!!!!!!!", groups[index_group]->RdFr, Tj1_count_MAX));
+				groups[index_group]->sessions[index_sess]->Tj1 = Tj1;
+				groups[index_group]->sessions[index_sess]->Tj1_count = 0;
 			}			
 			else
 			{
-				Tj1 = groups[index_group].sessions[index_sess].Tj1;
+				Tj1 = groups[index_group]->sessions[index_sess]->Tj1;
 			}
 		}
 		else
 		{
-			groups[index_group].sessions[index_sess].Tj1 = Tj1;
-			groups[index_group].sessions[index_sess].Tj1_count = 0;
+			groups[index_group]->sessions[index_sess]->Tj1 = Tj1;
+			groups[index_group]->sessions[index_sess]->Tj1_count = 0;
 		}
 	}
-	else if (groups[index_group].sessions[index_sess].Tj1 < Tj1)
+	else if (groups[index_group]->sessions[index_sess]->Tj1 < Tj1)
 	{
-		if ((Tj1 - groups[index_group].sessions[index_sess].Tj1) > 96)	//12 ms
+		if ((Tj1 - groups[index_group]->sessions[index_sess]->Tj1) > 96)	//12 ms
 		{
-			if (++groups[index_group].sessions[index_sess].Tj1_count > Tj1_count_MAX)
+			if (++groups[index_group]->sessions[index_sess]->Tj1_count > Tj1_count_MAX)
 			{
-				PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tj1 DISTINTO MAS DE %d VECES  !!!!!!!!!", groups[index_group].RdFr, Tj1_count_MAX));
-				groups[index_group].sessions[index_sess].Tj1 = Tj1;
-				groups[index_group].sessions[index_sess].Tj1_count = 0;
+				PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tj1 DISTINTO MAS DE %d VECES  !!!!!!!!!", groups[index_group]->RdFr, Tj1_count_MAX));
+				groups[index_group]->sessions[index_sess]->Tj1 = Tj1;
+				groups[index_group]->sessions[index_sess]->Tj1_count = 0;
 			}
 			else
 			{
-				Tj1 = groups[index_group].sessions[index_sess].Tj1;
+				Tj1 = groups[index_group]->sessions[index_sess]->Tj1;
 			}
 		}
 		else
 		{
-			groups[index_group].sessions[index_sess].Tj1 = Tj1;
-			groups[index_group].sessions[index_sess].Tj1_count = 0;
+			groups[index_group]->sessions[index_sess]->Tj1 = Tj1;
+			groups[index_group]->sessions[index_sess]->Tj1_count = 0;
 		}
 	}
 	else
 	{
-		groups[index_group].sessions[index_sess].Tj1_count = 0;
-		groups[index_group].sessions[index_sess].Tj1 = Tj1;
+		groups[index_group]->sessions[index_sess]->Tj1_count = 0;
+		groups[index_group]->sessions[index_sess]->Tj1 = Tj1;
 	}
 */
 
 
 	//Filtramos el Tred	
 	/*
-	if (groups[index_group].sessions[index_sess].TdTxIP == INVALID_TIME_DELAY)
+	if (groups[index_group]->sessions[index_sess]->TdTxIP == INVALID_TIME_DELAY)
 	{
-		groups[index_group].sessions[index_sess].Tred = Tn1;
-		groups[index_group].sessions[index_sess].Tn1_count = 0;
+		groups[index_group]->sessions[index_sess]->Tred = Tn1;
+		groups[index_group]->sessions[index_sess]->Tn1_count = 0;
 	}
-	else if (Tn1 >= groups[index_group].sessions[index_sess].Tred)
+	else if (Tn1 >= groups[index_group]->sessions[index_sess]->Tred)
 	{
-		if ((Tn1 - groups[index_group].sessions[index_sess].Tred) > 160)  //20 ms
+		if ((Tn1 - groups[index_group]->sessions[index_sess]->Tred) > 160)  //20 ms
 		{
-			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tn1-Tn1prev %d us", groups[index_group].RdFr, (Tn1-groups[index_group].sessions[index_sess].Tred)*125));
-			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s SE PASA  !!!!!!!!!!!!", groups[index_group].RdFr));
-			if (++groups[index_group].sessions[index_sess].Tn1_count > Tn1_count_MAX)
+			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tn1-Tn1prev %d us", groups[index_group]->RdFr, (Tn1-groups[index_group]->sessions[index_sess]->Tred)*125));
+			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s SE PASA  !!!!!!!!!!!!", groups[index_group]->RdFr));
+			if (++groups[index_group]->sessions[index_sess]->Tn1_count > Tn1_count_MAX)
 			{
-				PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tn1 DISTINTO MAS DE %d VECES  !!!!!!!!!", groups[index_group].RdFr, Tn1_count_MAX));
-				groups[index_group].sessions[index_sess].Tred = Tn1;
-				groups[index_group].sessions[index_sess].Tn1_count = 0;
+				PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tn1 DISTINTO MAS DE %d VECES  !!!!!!!!!", groups[index_group]->RdFr, Tn1_count_MAX));
+				groups[index_group]->sessions[index_sess]->Tred = Tn1;
+				groups[index_group]->sessions[index_sess]->Tn1_count = 0;
 			}
 			else
 			{
-				Tn1 = groups[index_group].sessions[index_sess].Tred;
+				Tn1 = groups[index_group]->sessions[index_sess]->Tred;
 			}
 		}
 		else
 		{
-			groups[index_group].sessions[index_sess].Tred = Tn1;
-			groups[index_group].sessions[index_sess].Tn1_count = 0;
+			groups[index_group]->sessions[index_sess]->Tred = Tn1;
+			groups[index_group]->sessions[index_sess]->Tn1_count = 0;
 		}
 	}
-	else if (Tn1 < groups[index_group].sessions[index_sess].Tred)
+	else if (Tn1 < groups[index_group]->sessions[index_sess]->Tred)
 	{
-		if ((groups[index_group].sessions[index_sess].Tred - Tn1) > 160)  //20 ms
+		if ((groups[index_group]->sessions[index_sess]->Tred - Tn1) > 160)  //20 ms
 		{
-			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tn1prev-Tn1 %d us", groups[index_group].RdFr, (groups[index_group].sessions[index_sess].Tred-Tn1)*125));
-			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s SE PASA  !!!!!!!!!!!!", groups[index_group].RdFr));
-			if (++groups[index_group].sessions[index_sess].Tn1_count > Tn1_count_MAX)
+			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tn1prev-Tn1 %d us", groups[index_group]->RdFr, (groups[index_group]->sessions[index_sess]->Tred-Tn1)*125));
+			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s SE PASA  !!!!!!!!!!!!", groups[index_group]->RdFr));
+			if (++groups[index_group]->sessions[index_sess]->Tn1_count > Tn1_count_MAX)
 			{
-				PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tn1 DISTINTO MAS DE %d VECES  !!!!!!!!!", groups[index_group].RdFr, Tn1_count_MAX));
-				groups[index_group].sessions[index_sess].Tred = Tn1;
-				groups[index_group].sessions[index_sess].Tn1_count = 0;
+				PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s Tn1 DISTINTO MAS DE %d VECES  !!!!!!!!!", groups[index_group]->RdFr, Tn1_count_MAX));
+				groups[index_group]->sessions[index_sess]->Tred = Tn1;
+				groups[index_group]->sessions[index_sess]->Tn1_count = 0;
 			}
 			else
 			{
-				Tn1 = groups[index_group].sessions[index_sess].Tred;
+				Tn1 = groups[index_group]->sessions[index_sess]->Tred;
 			}
 		}
 		else
 		{
-			groups[index_group].sessions[index_sess].Tred = Tn1;
-			groups[index_group].sessions[index_sess].Tn1_count = 0;
+			groups[index_group]->sessions[index_sess]->Tred = Tn1;
+			groups[index_group]->sessions[index_sess]->Tn1_count = 0;
 		}
 	}	
 	*/
 
-	groups[index_group].sessions[index_sess].Tred = Tn1;
+	groups[index_group]->sessions[index_sess]->Tred = Tn1;
 
-	PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay 2 Fr %s TQG 0x%X T1 0x%X NMR 0x%X T2 0x%X Tsd 0x%X Tj1 0x%X Tid 0x%X, T4 0x%X, T4-T1 %d us, Tred %d us, Absoluto %d", groups[index_group].RdFr, TQG, T1, NMR, T2, Tsd, Tj1, Tid, T4, (T4-T1)*125, Tn1*125, metodo_absoluto));
+	PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay 2 Fr %s TQG 0x%X T1 0x%X NMR 0x%X T2 0x%X Tsd 0x%X Tj1 0x%X Tid 0x%X, T4 0x%X, T4-T1 %d us, Tred %d us, Absoluto %d", groups[index_group]->RdFr, TQG, T1, NMR, T2, Tsd, Tj1, Tid, T4, (T4-T1)*125, Tn1*125, metodo_absoluto));
 	//Se calcula el retardo
 	TdTxIP = Tv1 + Tp1 + Tn1 + Tj1 + Tid;
-	groups[index_group].sessions[index_sess].TdTxIP = TdTxIP;
-	groups[index_group].sessions[index_sess].cld_absoluto = metodo_absoluto;
+	groups[index_group]->sessions[index_sess]->TdTxIP = TdTxIP;
+	groups[index_group]->sessions[index_sess]->cld_absoluto = metodo_absoluto;
 	
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
-	PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s TdTxIP %d us", groups[index_group].RdFr, TdTxIP*125));
+	PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay Fr %s TdTxIP %d us", groups[index_group]->RdFr, TdTxIP*125));
 	
 	return 1;	
 }
@@ -762,57 +935,57 @@ int FrecDesp::SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int
  */
 pj_uint32_t FrecDesp::GetRetToApply(int index_group, int index_sess)  
 {
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return 0;
 	}
 
-	pj_mutex_lock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
 
-	if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+	if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return 0;
 	}
-	if (!pjsua_call_is_active(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_is_active(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return 0;
 	}	
-	if (!pjsua_call_has_media(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_has_media(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return 0;
 	}
 
 	pj_uint32_t ret = 0;
 
 	pj_uint32_t Tred_max = 0;
-	for (int j = 0; j < MAX_SESSIONS; j++)
+	for (int j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 	{
-		if (groups[index_group].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-		if (!pjsua_call_is_active(groups[index_group].sessions[j].sess_callid)) continue;
-		if (!pjsua_call_has_media(groups[index_group].sessions[j].sess_callid)) continue;
+		if (groups[index_group]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+		if (!pjsua_call_is_active(groups[index_group]->sessions[j]->sess_callid)) continue;
+		if (!pjsua_call_has_media(groups[index_group]->sessions[j]->sess_callid)) continue;
 
-		if (groups[index_group].sessions[j].pSipcall != NULL)
+		if (groups[index_group]->sessions[j]->pSipcall != NULL)
 		{
-			CORESIP_CallInfo *_Info = groups[index_group].sessions[j].pSipcall->GetCORESIP_CallInfo();
+			CORESIP_CallInfo *_Info = groups[index_group]->sessions[j]->pSipcall->GetCORESIP_CallInfo();
 			if (!(_Info->Flags & CORESIP_CALL_RD_TXONLY))
 			{
-				if (groups[index_group].sessions[j].TdTxIP != INVALID_TIME_DELAY)
+				if (groups[index_group]->sessions[j]->TdTxIP != INVALID_TIME_DELAY)
 				{
-					if (groups[index_group].sessions[j].Tred > Tred_max)
+					if (groups[index_group]->sessions[j]->Tred > Tred_max)
 					{
-						Tred_max = groups[index_group].sessions[j].Tred;
+						Tred_max = groups[index_group]->sessions[j]->Tred;
 					}
 				}				
 			}
 		}
 	}	
 
-	ret = Tred_max - groups[index_group].sessions[index_sess].Tred;
+	ret = Tred_max - groups[index_group]->sessions[index_sess]->Tred;
 
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -833,41 +1006,41 @@ void FrecDesp::GetQidx(int index_group, int index_sess, pj_uint8_t *qidx, pj_uin
 	*qidx = 0;
 	*qidx_ml = 0;
 
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		PJ_LOG(5,(__FILE__, "ERROR: FrecDesp::GetQidx index_group (%d) o index_sess (%d) son erroneos \n", index_group, index_sess));
 		return;
 	}
 
-	pj_mutex_lock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
 
-	if ((strlen(groups[index_group].RdFr) == 0) ||
-			(strlen(groups[index_group].Zona) == 0))
+	if ((strlen(groups[index_group]->RdFr) == 0) ||
+			(strlen(groups[index_group]->Zona) == 0))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return;
 	}
-	if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+	if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return;
 	}
-	if (!pjsua_call_is_active(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_is_active(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return;
 	}
-	if (!pjsua_call_has_media(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_has_media(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return;
 	}
 
-	*qidx = groups[index_group].sessions[index_sess].Bss_value;
-	*qidx_ml = groups[index_group].sessions[index_sess].Bss_type;
-	*Tred = groups[index_group].sessions[index_sess].Tred;
+	*qidx = groups[index_group]->sessions[index_sess]->Bss_value;
+	*qidx_ml = groups[index_group]->sessions[index_sess]->Bss_type;
+	*Tred = groups[index_group]->sessions[index_sess]->Tred;
 
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 }
 
 /**
@@ -883,31 +1056,31 @@ void FrecDesp::GetQidx(int index_group, int index_sess, pj_uint8_t *qidx, pj_uin
 int FrecDesp::GetLastCld(int index_group, int index_sess, pj_uint8_t *cld)
 {	
 	int ret = 0;
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS || cld == NULL) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire) || cld == NULL) 
 	{
 		return -1;
 	}
 
 	*cld = 0;
-	pj_mutex_lock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
 
-	if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+	if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
-	if (!pjsua_call_is_active(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_is_active(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
-	if (!pjsua_call_has_media(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_has_media(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
 
-	pj_uint32_t cld_prev = groups[index_group].sessions[index_sess].cld_prev;
+	pj_uint32_t cld_prev = groups[index_group]->sessions[index_sess]->cld_prev;
 	if (cld_prev == INVALID_CLD_PREV)
 	{
 		ret = -1;
@@ -917,7 +1090,7 @@ int FrecDesp::GetLastCld(int index_group, int index_sess, pj_uint8_t *cld)
 		ret = 0;
 		*cld = (pj_uint8_t) cld_prev;
 	}
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 	return ret;
 }
 
@@ -943,30 +1116,31 @@ int FrecDesp::GetCLD(pjsua_call_id call_id, pj_uint8_t *cld)
 
 	//Se busca el grupo en el que est� el call_id
 	pj_mutex_lock(fd_mutex);
-	for (i = 0; i < MAX_GROUPS; i++)
+	for (i = 0; i < nslots.load(std::memory_order_relaxed); i++)
 	{
-		if (strlen(groups[i].RdFr) > 0 && strlen(groups[i].Zona) > 0)
+		pj_mutex_lock(groups[i]->grp_mutex);
+		if (strlen(groups[i]->RdFr) > 0 && strlen(groups[i]->Zona) > 0)
 		{
 			max_delay_in_group = 0;
 			valid_sesion_cnt = 0;
-			for (j = 0; j < MAX_SESSIONS; j++)
+			for (j = 0; j < groups[i]->nsess_slots.load(std::memory_order_relaxed); j++)
 			{
-				if (groups[i].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-				if (!pjsua_call_is_active(groups[i].sessions[j].sess_callid)) continue;
-				if (!pjsua_call_has_media(groups[i].sessions[j].sess_callid)) continue;
+				if (groups[i]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+				if (!pjsua_call_is_active(groups[i]->sessions[j]->sess_callid)) continue;
+				if (!pjsua_call_has_media(groups[i]->sessions[j]->sess_callid)) continue;
 
-				if (!(groups[i].sessions[j].Flags & CORESIP_CALL_RD_RXONLY))
+				if (!(groups[i]->sessions[j]->Flags & CORESIP_CALL_RD_RXONLY))
 				{
-					if (groups[i].sessions[j].TdTxIP != INVALID_TIME_DELAY)
+					if (groups[i]->sessions[j]->TdTxIP != INVALID_TIME_DELAY)
 					{
-						if (groups[i].sessions[j].TdTxIP > max_delay_in_group)
+						if (groups[i]->sessions[j]->TdTxIP > max_delay_in_group)
 						{
-							max_delay_in_group = groups[i].sessions[j].TdTxIP;						
+							max_delay_in_group = groups[i]->sessions[j]->TdTxIP;						
 						}
 						valid_sesion_cnt++;
 					}
 
-					if (groups[i].sessions[j].sess_callid == call_id)
+					if (groups[i]->sessions[j]->sess_callid == call_id)
 					{
 						group_index = i;
 						sess_index = j;
@@ -975,6 +1149,7 @@ int FrecDesp::GetCLD(pjsua_call_id call_id, pj_uint8_t *cld)
 			}
 			if (group_index != -1) break;  //Se ha encontrado el grupo donde est� el call_id
 		}
+		pj_mutex_unlock(groups[i]->grp_mutex);
 	}
 
 	if (group_index == -1 || sess_index == -1) 
@@ -983,39 +1158,44 @@ int FrecDesp::GetCLD(pjsua_call_id call_id, pj_uint8_t *cld)
 		return -1;					
 	}
 
-	if (groups[group_index].sessions[sess_index].TdTxIP == INVALID_TIME_DELAY)
+	//Se sale del bucle con el grupo encontrado bloqueado
+
+	if (groups[group_index]->sessions[sess_index]->TdTxIP == INVALID_TIME_DELAY)
 	{		
 		//Todav�a no ha habido c�lculo del retardo retornamos un cld=0 y con error.
+		pj_mutex_unlock(groups[group_index]->grp_mutex);
 		pj_mutex_unlock(fd_mutex);
 		return -1;
 	}
 
-	delay_diff = max_delay_in_group - groups[group_index].sessions[sess_index].TdTxIP;
+	delay_diff = max_delay_in_group - groups[group_index]->sessions[sess_index]->TdTxIP;
 	//Se pasa a unidades de  2 ms. delay_diff * 125 / 1000 / 2 = delay_diff / 4
 	delay_diff /= 16;	//Unidades de 2ms
 
 	//delay_diff += 1;	//Por error de jotron. No se le puede mandar un cld a cero
 		
-	if ((groups[group_index].sessions[sess_index].cld_prev == 0) && (delay_diff <= 1))
+	if ((groups[group_index]->sessions[sess_index]->cld_prev == 0) && (delay_diff <= 1))
 	{
 		//Solo se envía un cld a valor 0
+		pj_mutex_unlock(groups[group_index]->grp_mutex);
 		pj_mutex_unlock(fd_mutex);
 		return -1;
 	}
 	else
 	{
-		groups[group_index].sessions[sess_index].cld_prev = (delay_diff & 0x7F);
+		groups[group_index]->sessions[sess_index]->cld_prev = (delay_diff & 0x7F);
 	}		
 
-	//groups[group_index].sessions[sess_index].cld_prev = (delay_diff & 0x7F);
+	//groups[group_index]->sessions[sess_index]->cld_prev = (delay_diff & 0x7F);
 
-	if (groups[group_index].sessions[sess_index].cld_absoluto)
+	if (groups[group_index]->sessions[sess_index]->cld_absoluto)
 	{
 		*cld |= 0x80;	
 	}
 
 	*cld |= (pj_uint8_t) delay_diff;
 
+	pj_mutex_unlock(groups[group_index]->grp_mutex);
 	pj_mutex_unlock(fd_mutex);
 
 	return 0;
@@ -1036,7 +1216,7 @@ int FrecDesp::SetSquSt(int index_group, int index_sess, pj_bool_t squ_st, int *p
 	pj_bool_t sess_found = PJ_FALSE;
 	int squ_count = -1;
 
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		PJ_LOG(3,(__FILE__, "ERROR: FrecDesp::SetSquSt index_group (%d) o index_sess (%d) son erroneos \n", index_group, index_sess));
 		return -1;
@@ -1044,39 +1224,39 @@ int FrecDesp::SetSquSt(int index_group, int index_sess, pj_bool_t squ_st, int *p
 
 	int sq_air_count = 0;
 
-	pj_mutex_lock(fd_mutex);	
+	pj_mutex_lock(groups[index_group]->grp_mutex);	
 	
-	if (strlen(groups[index_group].RdFr) > 0 && strlen(groups[index_group].Zona) > 0)
+	if (strlen(groups[index_group]->RdFr) > 0 && strlen(groups[index_group]->Zona) > 0)
 	{
-		if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+		if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
-		if (!pjsua_call_is_active(groups[index_group].sessions[index_sess].sess_callid))
+		if (!pjsua_call_is_active(groups[index_group]->sessions[index_sess]->sess_callid))
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
-		if (!pjsua_call_has_media(groups[index_group].sessions[index_sess].sess_callid))
+		if (!pjsua_call_has_media(groups[index_group]->sessions[index_sess]->sess_callid))
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
 
-		groups[index_group].sessions[index_sess].squ_status = squ_st;
+		groups[index_group]->sessions[index_sess]->squ_status = squ_st;
 		squ_count = 0;
 
-		for (j = 0; (j < MAX_SESSIONS); j++)
+		for (j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 		{				
-			if (groups[index_group].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-			if (!pjsua_call_is_active(groups[index_group].sessions[j].sess_callid)) continue;
-			if (!pjsua_call_has_media(groups[index_group].sessions[j].sess_callid)) continue;
+			if (groups[index_group]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+			if (!pjsua_call_is_active(groups[index_group]->sessions[j]->sess_callid)) continue;
+			if (!pjsua_call_has_media(groups[index_group]->sessions[j]->sess_callid)) continue;
 
-			if (groups[index_group].sessions[j].squ_status) 
+			if (groups[index_group]->sessions[j]->squ_status) 
 			{
 				squ_count++;		
-				if (groups[index_group].sessions[j].pSipcall->RdInfo_prev.PttId == 0)
+				if (groups[index_group]->sessions[j]->pSipcall->RdInfo_prev.PttId == 0)
 				{
 					sq_air_count++;
 				}
@@ -1084,7 +1264,7 @@ int FrecDesp::SetSquSt(int index_group, int index_sess, pj_bool_t squ_st, int *p
 		}
 	}
 
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	if (p_sq_air_count != NULL) *p_sq_air_count = sq_air_count;
 
@@ -1102,26 +1282,26 @@ int FrecDesp::ClrAllSquSt(int index_group)
 	int j;
 	int ret = 0;
 
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		PJ_LOG(3,(__FILE__, "ERROR: FrecDesp::ClrAllSquSt index_group (%d) es erroneo", index_group));
 		return -1;
 	}
 	
-	pj_mutex_lock(fd_mutex);	
+	pj_mutex_lock(groups[index_group]->grp_mutex);	
 	
-	if (strlen(groups[index_group].RdFr) > 0 && strlen(groups[index_group].Zona) > 0)
+	if (strlen(groups[index_group]->RdFr) > 0 && strlen(groups[index_group]->Zona) > 0)
 	{
-		for (j = 0; (j < MAX_SESSIONS); j++)
+		for (j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 		{				
-			if (groups[index_group].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-			if (!pjsua_call_is_active(groups[index_group].sessions[j].sess_callid)) continue;
-			if (!pjsua_call_has_media(groups[index_group].sessions[j].sess_callid)) continue;
+			if (groups[index_group]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+			if (!pjsua_call_is_active(groups[index_group]->sessions[j]->sess_callid)) continue;
+			if (!pjsua_call_has_media(groups[index_group]->sessions[j]->sess_callid)) continue;
 
-			groups[index_group].sessions[j].squ_status = PJ_FALSE;
-			if (groups[index_group].sessions[j].pSipcall != NULL)
+			groups[index_group]->sessions[j]->squ_status = PJ_FALSE;
+			if (groups[index_group]->sessions[j]->pSipcall != NULL)
 			{
-				groups[index_group].sessions[j].pSipcall->squ_status = PJ_FALSE;
+				groups[index_group]->sessions[j]->pSipcall->squ_status = PJ_FALSE;
 			}				
 		}
 	}
@@ -1130,7 +1310,7 @@ int FrecDesp::ClrAllSquSt(int index_group)
 		ret = -1;
 	}
 
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -1147,29 +1327,29 @@ int FrecDesp::GetSquCnt(int index_group)
 	pj_bool_t sess_found = PJ_FALSE;
 	int squ_count = 0;
 
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return squ_count;
 	}
 	
-	pj_mutex_lock(fd_mutex);		
+	pj_mutex_lock(groups[index_group]->grp_mutex);		
 
-	if (strlen(groups[index_group].RdFr) > 0 && strlen(groups[index_group].Zona) > 0)
+	if (strlen(groups[index_group]->RdFr) > 0 && strlen(groups[index_group]->Zona) > 0)
 	{		
-		for (j = 0; (j < MAX_SESSIONS); j++)
+		for (j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 		{	
-			if (groups[index_group].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-			if (!pjsua_call_is_active(groups[index_group].sessions[j].sess_callid)) continue;
-			if (!pjsua_call_has_media(groups[index_group].sessions[j].sess_callid)) continue;
+			if (groups[index_group]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+			if (!pjsua_call_is_active(groups[index_group]->sessions[j]->sess_callid)) continue;
+			if (!pjsua_call_has_media(groups[index_group]->sessions[j]->sess_callid)) continue;
 
-			if (groups[index_group].sessions[j].squ_status) 
+			if (groups[index_group]->sessions[j]->squ_status) 
 			{
 				squ_count++;						
 			}					
 		}
 	}
 
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return squ_count;
 }
@@ -1185,22 +1365,22 @@ int FrecDesp::SetInWindow(int index_group, pj_bool_t status)
 {
 	int ret = 0;
 
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 	
-	pj_mutex_lock(fd_mutex);	
+	pj_mutex_lock(groups[index_group]->grp_mutex);	
 	
-	if (strlen(groups[index_group].RdFr) > 0 && strlen(groups[index_group].Zona) > 0)
+	if (strlen(groups[index_group]->RdFr) > 0 && strlen(groups[index_group]->Zona) > 0)
 	{
-		for (int j = 0; (j < MAX_SESSIONS); j++)
+		for (int j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 		{				
-			if (groups[index_group].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-			if (!pjsua_call_is_active(groups[index_group].sessions[j].sess_callid)) continue;
-			if (!pjsua_call_has_media(groups[index_group].sessions[j].sess_callid)) continue;
+			if (groups[index_group]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+			if (!pjsua_call_is_active(groups[index_group]->sessions[j]->sess_callid)) continue;
+			if (!pjsua_call_has_media(groups[index_group]->sessions[j]->sess_callid)) continue;
 
-			groups[index_group].sessions[j].in_window_timer = status;					
+			groups[index_group]->sessions[j]->in_window_timer = status;					
 		}
 	}
 	else
@@ -1208,7 +1388,7 @@ int FrecDesp::SetInWindow(int index_group, pj_bool_t status)
 		ret = -1;
 	}
 
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -1224,22 +1404,22 @@ pj_bool_t FrecDesp::GetInWindow(int index_group, int index_sess)
 {
 	int ret = PJ_FALSE;
 
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return ret;
 	}
 	
-	pj_mutex_lock(fd_mutex);	
+	pj_mutex_lock(groups[index_group]->grp_mutex);	
 	
-	if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+	if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}	
 
-	ret = groups[index_group].sessions[index_sess].in_window_timer;
+	ret = groups[index_group]->sessions[index_sess]->in_window_timer;
 
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -1289,7 +1469,7 @@ int FrecDesp::SetBss(int index_group, int index_sess, pj_uint8_t *ext_value, int
 {
 	pj_uint8_t bss_type, bss_value;
 
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
@@ -1302,32 +1482,32 @@ int FrecDesp::SetBss(int index_group, int index_sess, pj_uint8_t *ext_value, int
 	bss_value &= 0x1F;
 	
 	int ret = 0;
-	pj_mutex_lock(fd_mutex);
-	if (strlen(groups[index_group].RdFr) > 0 && strlen(groups[index_group].Zona) > 0)
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	if (strlen(groups[index_group]->RdFr) > 0 && strlen(groups[index_group]->Zona) > 0)
 	{				
-		if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+		if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
-		if (!pjsua_call_is_active(groups[index_group].sessions[index_sess].sess_callid))
+		if (!pjsua_call_is_active(groups[index_group]->sessions[index_sess]->sess_callid))
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
-		if (!pjsua_call_has_media(groups[index_group].sessions[index_sess].sess_callid))
+		if (!pjsua_call_has_media(groups[index_group]->sessions[index_sess]->sess_callid))
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
 
-		groups[index_group].sessions[index_sess].Bss_type = bss_type;
-		groups[index_group].sessions[index_sess].Bss_value = bss_value;
+		groups[index_group]->sessions[index_sess]->Bss_type = bss_type;
+		groups[index_group]->sessions[index_sess]->Bss_value = bss_value;
 		*BssMethod = (int) bss_type;
 		*BssValue = (int) bss_value;
 		ret = 1;
 	}
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -1344,35 +1524,35 @@ int FrecDesp::SetBss(int index_group, int index_sess, pj_uint8_t *ext_value, int
  */
 int FrecDesp::SetBss(int index_group, int index_sess, pj_uint8_t qidx_method, pj_uint8_t qidx_value)
 {
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 
 	int ret = 0;
-	pj_mutex_lock(fd_mutex);
-	if (strlen(groups[index_group].RdFr) > 0 && strlen(groups[index_group].Zona) > 0)
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	if (strlen(groups[index_group]->RdFr) > 0 && strlen(groups[index_group]->Zona) > 0)
 	{				
-		if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+		if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
-		if (!pjsua_call_is_active(groups[index_group].sessions[index_sess].sess_callid))
+		if (!pjsua_call_is_active(groups[index_group]->sessions[index_sess]->sess_callid))
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
-		if (!pjsua_call_has_media(groups[index_group].sessions[index_sess].sess_callid))
+		if (!pjsua_call_has_media(groups[index_group]->sessions[index_sess]->sess_callid))
 		{
-			pj_mutex_unlock(fd_mutex);
+			pj_mutex_unlock(groups[index_group]->grp_mutex);
 			return -1;
 		}
 
-		groups[index_group].sessions[index_sess].Bss_type = qidx_method;
-		groups[index_group].sessions[index_sess].Bss_value = qidx_value;
+		groups[index_group]->sessions[index_sess]->Bss_type = qidx_method;
+		groups[index_group]->sessions[index_sess]->Bss_value = qidx_value;
 	}
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -1389,32 +1569,32 @@ int FrecDesp::SetBss(int index_group, int index_sess, pj_uint8_t qidx_method, pj
  */
 int FrecDesp::GetBss(int index_group, int index_sess, int *BssMethod, int *BssValue)
 {
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 
-	pj_mutex_lock(fd_mutex);
-	if (groups[index_group].sessions[index_sess].sess_callid == PJSUA_INVALID_ID)
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	if (groups[index_group]->sessions[index_sess]->sess_callid == PJSUA_INVALID_ID)
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
-	if (!pjsua_call_is_active(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_is_active(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
-	if (!pjsua_call_has_media(groups[index_group].sessions[index_sess].sess_callid))
+	if (!pjsua_call_has_media(groups[index_group]->sessions[index_sess]->sess_callid))
 	{
-		pj_mutex_unlock(fd_mutex);
+		pj_mutex_unlock(groups[index_group]->grp_mutex);
 		return -1;
 	}
 
-	*BssMethod = groups[index_group].sessions[index_sess].Bss_type;
-	*BssValue = groups[index_group].sessions[index_sess].Bss_value;
+	*BssMethod = groups[index_group]->sessions[index_sess]->Bss_type;
+	*BssValue = groups[index_group]->sessions[index_sess]->Bss_value;
 
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 	
 	return 0;
 }
@@ -1428,14 +1608,14 @@ int FrecDesp::GetBss(int index_group, int index_sess, int *BssMethod, int *BssVa
  */
 int FrecDesp::Set_group_multicast_socket(int index_group, pj_sockaddr_in *RdSendTo)
 {
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 
-	pj_mutex_lock(fd_mutex);
-	groups[index_group]._RdSendTo = RdSendTo;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	groups[index_group]->_RdSendTo = RdSendTo;
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 	return 0;
 }
 
@@ -1448,15 +1628,15 @@ int FrecDesp::Set_group_multicast_socket(int index_group, pj_sockaddr_in *RdSend
  */
 int FrecDesp::Get_group_multicast_socket(int index_group, pj_sockaddr_in **RdSendTo)
 {
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		*RdSendTo = NULL;
 		return -1;
 	}
 
-	pj_mutex_lock(fd_mutex);
-	*RdSendTo = groups[index_group]._RdSendTo;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	*RdSendTo = groups[index_group]->_RdSendTo;
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 	return 0;
 }
 
@@ -1469,14 +1649,14 @@ int FrecDesp::Get_group_multicast_socket(int index_group, pj_sockaddr_in **RdSen
  */
 int FrecDesp::Set_mcast_seq(int index_group, unsigned mcast_seq)
 {
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 
-	pj_mutex_lock(fd_mutex);
-	groups[index_group].mcast_seq = mcast_seq;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	groups[index_group]->mcast_seq = mcast_seq;
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 	return 0;
 }
 
@@ -1490,15 +1670,15 @@ unsigned FrecDesp::Get_mcast_seq(int index_group)
 {
 	unsigned ret;
 
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return 0;
 	}
 	
-	pj_mutex_lock(fd_mutex);
-	ret = groups[index_group].mcast_seq;
-	groups[index_group].mcast_seq++;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	ret = groups[index_group]->mcast_seq;
+	groups[index_group]->mcast_seq++;
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 
 	return ret;
@@ -1524,29 +1704,29 @@ int FrecDesp::SetBetterSession(SipCall *p_current_sipcall, pj_bool_t in_window,
 	int index_group = p_current_sipcall->_Index_group;
 	int index_sess = p_current_sipcall->_Index_sess;
 
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 	
-	pj_mutex_lock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
 
 	//Tomamos qidx de la sesion actual	
 	int current_Bss_value = p_current_sipcall->GetSyncBss();		
 
 	//Literal del metodo seleccionado del sdp del 200ok
-	char *curBssSelMethod = groups[index_group].sessions[index_sess].Bss_selected_method;
+	char *curBssSelMethod = groups[index_group]->sessions[index_sess]->Bss_selected_method;
 
 	//Guardamos el estado actual de squelch
-	pj_bool_t current_squ_status = groups[index_group].sessions[index_sess].squ_status;
+	pj_bool_t current_squ_status = groups[index_group]->sessions[index_sess]->squ_status;
 	
 	//Si el squelch no esta activado forzamos un bss negativo.
 	if (!current_squ_status) current_Bss_value = -1;	
 
 	if (SipAgent::Coresip_Local_Config._Debug_BSS)
 	{
-		PJ_LOG(3,(__FILE__, "BSS: SetBetterSession current session  FR %s %s qidx %d", groups[index_group].RdFr, 
-			groups[index_group].sessions[index_sess].pSipcall->DstUri, current_Bss_value));
+		PJ_LOG(3,(__FILE__, "BSS: SetBetterSession current session  FR %s %s qidx %d", groups[index_group]->RdFr, 
+			groups[index_group]->sessions[index_sess]->pSipcall->DstUri, current_Bss_value));
 	}
 
 	//Cuenta las sesiones seleccionadas en el grupo
@@ -1555,35 +1735,35 @@ int FrecDesp::SetBetterSession(SipCall *p_current_sipcall, pj_bool_t in_window,
 	int better_index_sess = -1;
 	int better_bss = -1;
 	//Se busca en el resto de sesiones del grupo la que tenga un mejor bss 
-	for (j = 0; j < MAX_SESSIONS; j++)
+	for (j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 	{						
-		if (groups[index_group].sessions[j].sess_callid != PJSUA_INVALID_ID &&
-			groups[index_group].sessions[j].squ_status == PJ_TRUE &&
-			groups[index_group].sessions[j].pSipcall != NULL)
+		if (groups[index_group]->sessions[j]->sess_callid != PJSUA_INVALID_ID &&
+			groups[index_group]->sessions[j]->squ_status == PJ_TRUE &&
+			groups[index_group]->sessions[j]->pSipcall != NULL)
 		{
-			CORESIP_CallFlags call_flags = groups[index_group].sessions[j].Flags;
+			CORESIP_CallFlags call_flags = groups[index_group]->sessions[j]->Flags;
 
 			if (!(call_flags & CORESIP_CALL_RD_TXONLY))
 			{
 				if (j != index_sess)
 				{
-					int bss_sync = groups[index_group].sessions[j].pSipcall->GetSyncBss();										
+					int bss_sync = groups[index_group]->sessions[j]->pSipcall->GetSyncBss();										
 
 					if (strlen(curBssSelMethod) == 0)
 					{
 						//Si la longitud del string del metodo seleccionado de la actual sesion es cero
 						//puede ser porque esa sesion ya se ha eliminado del grupo. Entonces se asigna ese puntero
 						//al array del metodo de la primera sesion valida que se encuentra en el grupo
-						curBssSelMethod = groups[index_group].sessions[j].Bss_selected_method;
+						curBssSelMethod = groups[index_group]->sessions[j]->Bss_selected_method;
 					}
 
 					if (SipAgent::Coresip_Local_Config._Debug_BSS)
 					{
-						PJ_LOG(3,(__FILE__, "BSS: SetBetterSession FR %s %s qidx %d", groups[index_group].RdFr, 
-							groups[index_group].sessions[j].pSipcall->DstUri, bss_sync));
+						PJ_LOG(3,(__FILE__, "BSS: SetBetterSession FR %s %s qidx %d", groups[index_group]->RdFr, 
+							groups[index_group]->sessions[j]->pSipcall->DstUri, bss_sync));
 					}
 
-					if ((strcmp(groups[index_group].sessions[j].Bss_selected_method, curBssSelMethod) == 0) &&
+					if ((strcmp(groups[index_group]->sessions[j]->Bss_selected_method, curBssSelMethod) == 0) &&
 						(bss_sync > better_bss))
 					{
 						better_index_sess = j;
@@ -1591,21 +1771,21 @@ int FrecDesp::SetBetterSession(SipCall *p_current_sipcall, pj_bool_t in_window,
 					}
 				}
 
-				if (groups[index_group].sessions[j].pSipcall->_Sending_Multicast_enabled)
+				if (groups[index_group]->sessions[j]->pSipcall->_Sending_Multicast_enabled)
 					sessions_with_multicast_enabled_count++;	
 			}
 		}
 	}
 		
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 	
 	if (better_bss > current_Bss_value)
 	{
 		//Existe otra sesion en el grupo con mejor bss. Lo seleccionamos.
-		SipCall *p_better_sipcall = groups[index_group].sessions[better_index_sess].pSipcall;
+		SipCall *p_better_sipcall = groups[index_group]->sessions[better_index_sess]->pSipcall;
 
 		if ((!only_selected_in_window) ||
-			(only_selected_in_window && (strcmp(groups[index_group].SelectedUri, p_better_sipcall->DstUri) == 0)))
+			(only_selected_in_window && (strcmp(groups[index_group]->SelectedUri, p_better_sipcall->DstUri) == 0)))
 		{
 			//Si only_selected_in_window es false, quiere decir que se puede seleccionar una sesion que 
 			//no sea la que se haya seleccionado en la ventana
@@ -1622,7 +1802,7 @@ int FrecDesp::SetBetterSession(SipCall *p_current_sipcall, pj_bool_t in_window,
 
 			if (SipAgent::Coresip_Local_Config._Debug_BSS)
 			{
-				PJ_LOG(3,(__FILE__, "BSS: FR %s %s SELECCIONADO", groups[index_group].RdFr, p_better_sipcall->DstUri));
+				PJ_LOG(3,(__FILE__, "BSS: FR %s %s SELECCIONADO", groups[index_group]->RdFr, p_better_sipcall->DstUri));
 			}
 		}
 	}	
@@ -1638,7 +1818,7 @@ int FrecDesp::SetBetterSession(SipCall *p_current_sipcall, pj_bool_t in_window,
 			//Tiene el squelch activado
 
 			if ((!only_selected_in_window) ||
-				(only_selected_in_window && (strcmp(groups[index_group].SelectedUri, p_current_sipcall->DstUri) == 0)))
+				(only_selected_in_window && (strcmp(groups[index_group]->SelectedUri, p_current_sipcall->DstUri) == 0)))
 			{
 				//Si only_selected_in_window es false, quiere decir que se puede seleccionar una sesion que 
 				//no sea la que se haya seleccionado en la ventana
@@ -1655,7 +1835,7 @@ int FrecDesp::SetBetterSession(SipCall *p_current_sipcall, pj_bool_t in_window,
 
 				if (SipAgent::Coresip_Local_Config._Debug_BSS)
 				{
-					PJ_LOG(3,(__FILE__, "BSS: FR %s %s SELECCIONADO", groups[index_group].RdFr, p_current_sipcall->DstUri));
+					PJ_LOG(3,(__FILE__, "BSS: FR %s %s SELECCIONADO", groups[index_group]->RdFr, p_current_sipcall->DstUri));
 				}
 			}
 		}
@@ -1665,68 +1845,68 @@ int FrecDesp::SetBetterSession(SipCall *p_current_sipcall, pj_bool_t in_window,
 
 			if ((!only_selected_in_window) ||
 				(only_selected_in_window && 
-				 (strcmp(groups[index_group].SelectedUri, groups[index_group].sessions[better_index_sess].pSipcall->DstUri) == 0)))
+				 (strcmp(groups[index_group]->SelectedUri, groups[index_group]->sessions[better_index_sess]->pSipcall->DstUri) == 0)))
 			{
 				//Si only_selected_in_window es false, quiere decir que se puede seleccionar una sesion que 
 				//no sea la que se haya seleccionado en la ventana
 				//Si only_selected_in_window es true, entonces solo se puede hacer la seleccion si la sesion
 				//con mejor qidx es la que se haya seleccionado ya en la ventana
 
-				EnableMulticast(groups[index_group].sessions[better_index_sess].pSipcall, PJ_TRUE, PJ_FALSE);
-				SetSelected(groups[index_group].sessions[better_index_sess].pSipcall, PJ_TRUE, PJ_FALSE);
+				EnableMulticast(groups[index_group]->sessions[better_index_sess]->pSipcall, PJ_TRUE, PJ_FALSE);
+				SetSelected(groups[index_group]->sessions[better_index_sess]->pSipcall, PJ_TRUE, PJ_FALSE);
 				if (in_window)
 				{
 					//Solo si estamos en la ventana se puede asignar en el grupo la uri seleccionada
-					SetSelectedUri(groups[index_group].sessions[better_index_sess].pSipcall);
+					SetSelectedUri(groups[index_group]->sessions[better_index_sess]->pSipcall);
 				}
 				if (SipAgent::Coresip_Local_Config._Debug_BSS)
 				{
-					PJ_LOG(3,(__FILE__, "BSS: FR %s %s SELECCIONADO", groups[index_group].RdFr, 
-						groups[index_group].sessions[better_index_sess].pSipcall->DstUri));
+					PJ_LOG(3,(__FILE__, "BSS: FR %s %s SELECCIONADO", groups[index_group]->RdFr, 
+						groups[index_group]->sessions[better_index_sess]->pSipcall->DstUri));
 				}
 			}
 		}
 	}
 
 	//Refrescamos en el nodebox el estado de los canales del grupo
-	for (j = 0; j < MAX_SESSIONS; j++)
+	for (j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 	{
-		if (groups[index_group].sessions[j].sess_callid != PJSUA_INVALID_ID &&
-			groups[index_group].sessions[j].pSipcall != NULL)
+		if (groups[index_group]->sessions[j]->sess_callid != PJSUA_INVALID_ID &&
+			groups[index_group]->sessions[j]->pSipcall != NULL)
 		{
-			CORESIP_CallFlags call_flags = groups[index_group].sessions[j].Flags;
+			CORESIP_CallFlags call_flags = groups[index_group]->sessions[j]->Flags;
 			if (!(call_flags & CORESIP_CALL_RD_TXONLY))
 			{
-				pjmedia_session* ses = pjsua_call_get_media_session(groups[index_group].sessions[j].sess_callid);
+				pjmedia_session* ses = pjsua_call_get_media_session(groups[index_group]->sessions[j]->sess_callid);
 				if (ses != NULL)
 				{
 					void * call = pjmedia_session_get_user_data(ses);
 					if (call)
 					{
-						pj_mutex_lock(groups[index_group].sessions[j].pSipcall->RdInfo_prev_mutex);
-						groups[index_group].sessions[j].pSipcall->RdInfo_prev.rx_selected = groups[index_group].sessions[j].selected;
-						groups[index_group].sessions[j].pSipcall->RdInfo_prev.Squelch = groups[index_group].sessions[j].pSipcall->squ_status;
-						if (groups[index_group].sessions[j].pSipcall->squ_status == 0)
+						pj_mutex_lock(groups[index_group]->sessions[j]->pSipcall->RdInfo_prev_mutex);
+						groups[index_group]->sessions[j]->pSipcall->RdInfo_prev.rx_selected = groups[index_group]->sessions[j]->selected;
+						groups[index_group]->sessions[j]->pSipcall->RdInfo_prev.Squelch = groups[index_group]->sessions[j]->pSipcall->squ_status;
+						if (groups[index_group]->sessions[j]->pSipcall->squ_status == 0)
 						{
-							groups[index_group].sessions[j].pSipcall->RdInfo_prev.rx_qidx = 0;
+							groups[index_group]->sessions[j]->pSipcall->RdInfo_prev.rx_qidx = 0;
 						}
 						CORESIP_RdInfo info_aux;
-						memcpy(&info_aux, &groups[index_group].sessions[j].pSipcall->RdInfo_prev, sizeof(CORESIP_RdInfo));
-						pj_mutex_unlock(groups[index_group].sessions[j].pSipcall->RdInfo_prev_mutex);
+						memcpy(&info_aux, &groups[index_group]->sessions[j]->pSipcall->RdInfo_prev, sizeof(CORESIP_RdInfo));
+						pj_mutex_unlock(groups[index_group]->sessions[j]->pSipcall->RdInfo_prev_mutex);
 
-						if (groups[index_group].sessions[j].pSipcall->Ptt_off_timer.id == 0)
+						if (groups[index_group]->sessions[j]->pSipcall->Ptt_off_timer.id == 0)
 						{
 
 							//Actualizamos los parametros que no se toman en la callback OnRdInfochanged
 							//Esto hay que hacerlo siempre que se llame a RdInfoCb
 							//-->
-							info_aux.rx_selected = SipAgent::_FrecDesp->IsBssSelected(groups[index_group].sessions[j].pSipcall);
+							info_aux.rx_selected = SipAgent::_FrecDesp->IsBssSelected(groups[index_group]->sessions[j]->pSipcall);
 							//<--
 
 							//Solo se envia al nodebox fuera del timer de ptt off
 
 							PJ_LOG(5,(__FILE__, "SetBetterSession: envia nodebox. dst %s PttType %d PttId %d rx_selected %d Squelch %d", 
-							groups[index_group].sessions[j].pSipcall->DstUri, 
+							groups[index_group]->sessions[j]->pSipcall->DstUri, 
 							info_aux.PttType, 
 							info_aux.PttId, 
 							info_aux.rx_selected, 
@@ -1762,50 +1942,50 @@ int FrecDesp::RefressStatus(SipCall *p_current_sipcall)
 
 	int index_group = p_current_sipcall->_Index_group;
 
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 
 	//Refrescamos en el nodebox el estado de los canales del grupo
-	for (j = 0; j < MAX_SESSIONS; j++)
+	for (j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 	{
-		if (groups[index_group].sessions[j].sess_callid != PJSUA_INVALID_ID &&
-			groups[index_group].sessions[j].pSipcall != NULL)
+		if (groups[index_group]->sessions[j]->sess_callid != PJSUA_INVALID_ID &&
+			groups[index_group]->sessions[j]->pSipcall != NULL)
 		{
-			CORESIP_CallFlags call_flags = groups[index_group].sessions[j].Flags;
+			CORESIP_CallFlags call_flags = groups[index_group]->sessions[j]->Flags;
 			if (!(call_flags & CORESIP_CALL_RD_TXONLY))
 			{
-				pjmedia_session* ses = pjsua_call_get_media_session(groups[index_group].sessions[j].sess_callid);
+				pjmedia_session* ses = pjsua_call_get_media_session(groups[index_group]->sessions[j]->sess_callid);
 				if (ses != NULL)
 				{
 					void * call = pjmedia_session_get_user_data(ses);
 					if (call)
 					{
-						pj_mutex_lock(groups[index_group].sessions[j].pSipcall->RdInfo_prev_mutex);
-						groups[index_group].sessions[j].pSipcall->RdInfo_prev.rx_selected = groups[index_group].sessions[j].selected;
-						groups[index_group].sessions[j].pSipcall->RdInfo_prev.Squelch = groups[index_group].sessions[j].pSipcall->squ_status;
-						if (groups[index_group].sessions[j].pSipcall->squ_status == 0)
+						pj_mutex_lock(groups[index_group]->sessions[j]->pSipcall->RdInfo_prev_mutex);
+						groups[index_group]->sessions[j]->pSipcall->RdInfo_prev.rx_selected = groups[index_group]->sessions[j]->selected;
+						groups[index_group]->sessions[j]->pSipcall->RdInfo_prev.Squelch = groups[index_group]->sessions[j]->pSipcall->squ_status;
+						if (groups[index_group]->sessions[j]->pSipcall->squ_status == 0)
 						{
-							groups[index_group].sessions[j].pSipcall->RdInfo_prev.rx_qidx = 0;
+							groups[index_group]->sessions[j]->pSipcall->RdInfo_prev.rx_qidx = 0;
 						}
 						CORESIP_RdInfo info_aux;
-						memcpy(&info_aux, &groups[index_group].sessions[j].pSipcall->RdInfo_prev, sizeof(CORESIP_RdInfo));
-						pj_mutex_unlock(groups[index_group].sessions[j].pSipcall->RdInfo_prev_mutex);
+						memcpy(&info_aux, &groups[index_group]->sessions[j]->pSipcall->RdInfo_prev, sizeof(CORESIP_RdInfo));
+						pj_mutex_unlock(groups[index_group]->sessions[j]->pSipcall->RdInfo_prev_mutex);
 
-						if (groups[index_group].sessions[j].pSipcall->Ptt_off_timer.id == 0)
+						if (groups[index_group]->sessions[j]->pSipcall->Ptt_off_timer.id == 0)
 						{
 
 							//Actualizamos los parametros que no se toman en la callback OnRdInfochanged
 							//Esto hay que hacerlo siempre que se llame a RdInfoCb
 							//-->
-							info_aux.rx_selected = SipAgent::_FrecDesp->IsBssSelected(groups[index_group].sessions[j].pSipcall);
+							info_aux.rx_selected = SipAgent::_FrecDesp->IsBssSelected(groups[index_group]->sessions[j]->pSipcall);
 							//<--
 
 							//Solo se envia al nodebox fuera del timer de ptt off
 
 							PJ_LOG(5,(__FILE__, "RefressStatus: envia nodebox. dst %s PttType %d PttId %d rx_selected %d Squelch %d", 
-							groups[index_group].sessions[j].pSipcall->DstUri, 
+							groups[index_group]->sessions[j]->pSipcall->DstUri, 
 							info_aux.PttType, 
 							info_aux.PttId, 
 							info_aux.rx_selected, 
@@ -1842,7 +2022,7 @@ int FrecDesp::EnableMulticast(SipCall *psipcall, pj_bool_t enable, pj_bool_t all
 	int index_sess = psipcall->_Index_sess;
 	pj_bool_t not_enable;
 
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
@@ -1850,27 +2030,27 @@ int FrecDesp::EnableMulticast(SipCall *psipcall, pj_bool_t enable, pj_bool_t all
 	if (enable) not_enable = PJ_FALSE;
 	else not_enable = PJ_TRUE;
 
-	pj_mutex_lock(fd_mutex);
-	for (int j = 0; (j < MAX_SESSIONS); j++)
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	for (int j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 	{
-		if (groups[index_group].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-		if (!pjsua_call_is_active(groups[index_group].sessions[j].sess_callid)) continue;
-		if (!pjsua_call_has_media(groups[index_group].sessions[j].sess_callid)) continue;
+		if (groups[index_group]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+		if (!pjsua_call_is_active(groups[index_group]->sessions[j]->sess_callid)) continue;
+		if (!pjsua_call_has_media(groups[index_group]->sessions[j]->sess_callid)) continue;
 
-		if (j == index_sess && groups[index_group].sessions[j].pSipcall != NULL && !all)
+		if (j == index_sess && groups[index_group]->sessions[j]->pSipcall != NULL && !all)
 		{
-			groups[index_group].sessions[j].pSipcall->_Sending_Multicast_enabled = enable;
+			groups[index_group]->sessions[j]->pSipcall->_Sending_Multicast_enabled = enable;
 		}
 		else if (!all)
 		{
-			groups[index_group].sessions[j].pSipcall->_Sending_Multicast_enabled = not_enable;
+			groups[index_group]->sessions[j]->pSipcall->_Sending_Multicast_enabled = not_enable;
 		}
 		else
 		{
-			groups[index_group].sessions[j].pSipcall->_Sending_Multicast_enabled = enable;
+			groups[index_group]->sessions[j]->pSipcall->_Sending_Multicast_enabled = enable;
 		}
 	}
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return 0;
 }
@@ -1892,7 +2072,7 @@ int FrecDesp::SetSelected(SipCall *psipcall, pj_bool_t selected, pj_bool_t all)
 	int index_sess = psipcall->_Index_sess;
 	pj_bool_t not_selected;
 
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
@@ -1900,27 +2080,27 @@ int FrecDesp::SetSelected(SipCall *psipcall, pj_bool_t selected, pj_bool_t all)
 	if (selected) not_selected = PJ_FALSE;
 	else not_selected = PJ_TRUE;
 
-	pj_mutex_lock(fd_mutex);
-	for (int j = 0; (j < MAX_SESSIONS); j++)
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	for (int j = 0; j < groups[index_group]->nsess_slots.load(std::memory_order_relaxed); j++)
 	{
-		if (groups[index_group].sessions[j].sess_callid == PJSUA_INVALID_ID) continue;
-		if (!pjsua_call_is_active(groups[index_group].sessions[j].sess_callid)) continue;
-		if (!pjsua_call_has_media(groups[index_group].sessions[j].sess_callid)) continue;
+		if (groups[index_group]->sessions[j]->sess_callid == PJSUA_INVALID_ID) continue;
+		if (!pjsua_call_is_active(groups[index_group]->sessions[j]->sess_callid)) continue;
+		if (!pjsua_call_has_media(groups[index_group]->sessions[j]->sess_callid)) continue;
 
-		if (j == index_sess && groups[index_group].sessions[j].pSipcall != NULL && !all)
+		if (j == index_sess && groups[index_group]->sessions[j]->pSipcall != NULL && !all)
 		{
-			groups[index_group].sessions[j].selected = selected;
+			groups[index_group]->sessions[j]->selected = selected;
 		}
 		else if (!all)
 		{
-			groups[index_group].sessions[j].selected = not_selected;
+			groups[index_group]->sessions[j]->selected = not_selected;
 		}
 		else
 		{
-			groups[index_group].sessions[j].selected = selected;
+			groups[index_group]->sessions[j]->selected = selected;
 		}
 	}
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return 0;
 }
@@ -1936,16 +2116,16 @@ int FrecDesp::SetSelectedUri(SipCall *psipcall)
 	if (psipcall == NULL) return -1;
 
 	int index_group = psipcall->_Index_group;
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 
-	pj_mutex_lock(fd_mutex);
-	strncpy(groups[index_group].SelectedUri, psipcall->DstUri, sizeof(groups[index_group].SelectedUri));
-	groups[index_group].SelectedUri[sizeof(groups[index_group].SelectedUri)-1] = '\0';
-	groups[index_group].SelectedUriPttId = psipcall->RdInfo_prev.PttId;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	strncpy(groups[index_group]->SelectedUri, psipcall->DstUri, sizeof(groups[index_group]->SelectedUri));
+	groups[index_group]->SelectedUri[sizeof(groups[index_group]->SelectedUri)-1] = '\0';
+	groups[index_group]->SelectedUriPttId = psipcall->RdInfo_prev.PttId;
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return 0;
 }
@@ -1963,21 +2143,21 @@ int FrecDesp::GetSelectedUri(SipCall *psipcall, char **selectedUri, unsigned sho
 	if (psipcall == NULL) return -1;
 
 	int index_group = psipcall->_Index_group;
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 
-	pj_mutex_lock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
 	if (selectedUri != NULL)
 	{
-		*selectedUri = groups[index_group].SelectedUri;
+		*selectedUri = groups[index_group]->SelectedUri;
 	}
 	if (selectedUriPttId != NULL)
 	{
-		*selectedUriPttId = groups[index_group].SelectedUriPttId;
+		*selectedUriPttId = groups[index_group]->SelectedUriPttId;
 	}
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return 0;
 }
@@ -1991,15 +2171,15 @@ int FrecDesp::ClrSelectedUri(SipCall *psipcall)
 	if (psipcall == NULL) return -1;
 
 	int index_group = psipcall->_Index_group;
-	if (index_group < 0 || index_group >= MAX_GROUPS) 
+	if (index_group < 0 || index_group >= nslots.load(std::memory_order_acquire)) 
 	{
 		return -1;
 	}
 
-	pj_mutex_lock(fd_mutex);
-	groups[index_group].SelectedUri[0] = '\0';
-	groups[index_group].SelectedUriPttId = 0;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	groups[index_group]->SelectedUri[0] = '\0';
+	groups[index_group]->SelectedUriPttId = 0;
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return 0;
 }
@@ -2018,14 +2198,14 @@ pj_bool_t FrecDesp::IsBssSelected(SipCall *psipcall)
 	int index_sess = psipcall->_Index_sess;
 	pj_bool_t ret;
 	
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return PJ_FALSE;
 	}
 	
-	pj_mutex_lock(fd_mutex);
-	ret = groups[index_group].sessions[index_sess].selected;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	ret = groups[index_group]->sessions[index_sess]->selected;
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -2044,15 +2224,15 @@ pj_bool_t FrecDesp::IsValidTdTxIP(SipCall *psipcall)
 	int index_sess = psipcall->_Index_sess;
 	pj_bool_t ret = PJ_FALSE;
 	
-	if (index_group < 0 || index_sess < 0 || index_group >= MAX_GROUPS || index_sess >= MAX_SESSIONS) 
+	if (index_group < 0 || index_sess < 0 || index_group >= nslots.load(std::memory_order_acquire) || index_sess >= groups[index_group]->nsess_slots.load(std::memory_order_acquire)) 
 	{
 		return ret;
 	}
 	
-	pj_mutex_lock(fd_mutex);
-	if (groups[index_group].sessions[index_sess].TdTxIP != INVALID_TIME_DELAY)
+	pj_mutex_lock(groups[index_group]->grp_mutex);
+	if (groups[index_group]->sessions[index_sess]->TdTxIP != INVALID_TIME_DELAY)
 		ret = PJ_TRUE;
-	pj_mutex_unlock(fd_mutex);
+	pj_mutex_unlock(groups[index_group]->grp_mutex);
 
 	return ret;
 }
@@ -2080,8 +2260,8 @@ int FrecDesp::ConnectNTPd(char *err, int err_size)
 		return -1;
 	}
 
-	pj_inet_aton(&pj_str("127.0.0.1"), &address);
-	sock.sin_family = AF_INET;
+	pj_inet_aton(StrPtr(pj_str("127.0.0.1")), &address);
+	sock.sin_family = pj_AF_INET();
 	sock.sin_addr = address;
 	sock.sin_port = pj_htons(NTP_PORT);
 
@@ -2475,20 +2655,20 @@ int FrecDesp::NTPCheckTh(void *proc)
     rc = pj_thread_register("NTPCheckTh", desc, &this_thread);
     if (rc != PJ_SUCCESS) {
 		PJ_LOG(3,(__FILE__, "...error in pj_thread_register NTPCheckTh!"));
-        return NULL;
+        return 0;
     }
 
     /* Test that pj_thread_this() works */
     this_thread = pj_thread_this();
     if (this_thread == NULL) {
         PJ_LOG(3,(__FILE__, "...error: NTPCheckTh pj_thread_this() returns NULL!"));
-        return NULL;
+        return 0;
     }
 
     /* Test that pj_thread_get_name() works */
     if (pj_thread_get_name(this_thread) == NULL) {
         PJ_LOG(3,(__FILE__, "...error: NTPCheckTh pj_thread_get_name() returns NULL!"));
-        return NULL;
+        return 0;
     }
 
 
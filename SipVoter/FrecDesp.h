@@ -14,13 +14,15 @@
 #include "CoreSip.h"
 #include "SipCall.h"
 
+#include <atomic>
+
 class FrecDesp
 {
 public:
 
 	static const int INVALID_GROUP_INDEX = -1;
 	static const int INVALID_SESS_INDEX = -1;
-	static const int MAX_GROUPS = 1024;   //maximo numero de grupos
+	static const int MAX_GROUPS = 4096;   //maximo numero de grupos. Solo se reserva memoria para los que se usan
 	static const int MAX_SESSIONS = 10;	 //maximo numero de sesiones en un grupo
 
 	static const pj_bool_t IN_WINDOW = PJ_TRUE;	 //Indica que se está en la ventana de decision bss
@@ -36,7 +38,7 @@ public:
 	int SetGroupClimaxFlag(int index_group, pj_bool_t Esgrupoclimax);
 	int GetGroupClimaxFlag(pjsua_call_id call_id, pj_bool_t *Esgrupoclimax);
 	int GetSessionsCountInGroup(int index_group, int *nsessions_rx_only, int *nsessions_tx_only);
-	int SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int index_group, int index_sess, pj_uint8_t *ext_value, pj_bool_t *request_MAM);
+	int SetTimeDelay(pjmedia_stream *stream, CORESIP_PttType ptttype, int index_group, int index_sess, const pjmedia_rtp_ed137_mam *mam, pj_bool_t *request_MAM);
 	pj_uint32_t GetRetToApply(int index_group, int index_sess);
 	int GetCLD(pjsua_call_id call_id, pj_uint8_t *cld);
 	int SetBss(int index_group, int index_sess, pj_uint8_t *ext_value, int *BssMethod, int *BssValue);
@@ -83,11 +85,12 @@ private:
 	pj_thread_t  *ntp_check_thread;
 	static pj_thread_proc NTPCheckTh;
 
-	pj_mutex_t *fd_mutex;
+	pj_mutex_t *fd_mutex;					//Protege la tabla de grupos: alta y baja de grupos y sesiones y busquedas entre grupos
 
 	struct stgrupo
 	{
 		char RdFr[CORESIP_MAX_RS_LENGTH + 1];			//Frecuencia que identifica al grupo.	
+		int next;										//Siguiente grupo de la misma entrada de la tabla hash o de la lista de libres
 		char Zona[CORESIP_MAX_ZONA_LENGTH + 1];			//Frecuencia que identifica al grupo.
 		int nsessions;									//Cantidad total de sesiones
 		int nsessions_tx_only;							//Cantidad de sesiones Tx only
@@ -116,18 +119,38 @@ private:
 			pj_bool_t in_window_timer;		//Indica que estamos en la ventana de decision del bss
 			int PesoRSSIvsNucleo;			//Peso del valor de Qidx del tipo RSSI en el calculo del Qidx final. 0 indica que el calculo es interno (centralizado). 9 que el calculo es solo el RSSI.
 			
-		} sessions[MAX_SESSIONS];
+		};
+		stsess *sessions[MAX_SESSIONS];					//Sesiones reservadas. Se reservan al unirse al grupo una sesion para la
+														//que no hay ninguna libre y no se liberan hasta el destructor
+		std::atomic<int> nsess_slots;					//Numero de sesiones reservadas. Todos los indices por debajo son validos.
+														//Se cambia con fd_mutex y grp_mutex tomados y se lee sin ellos (acquire)
 
 		char SelectedUri[CORESIP_MAX_URI_LENGTH + 1];   //Uri del receptor seleccionado en la ventana BSS
 		unsigned short SelectedUriPttId;				//PTT-Id de la uri seleccionada
+		pj_mutex_t *grp_mutex;				//Protege los datos del grupo y de sus sesiones. Se toma despues de fd_mutex, nunca al reves
 		unsigned mcast_seq;					//N�mero de secuencia que se env�a con el paquete de audio por multicast
 		pj_sockaddr_in *_RdSendTo;			//Direcci�n y puerto multicast donde se env�a. Lo asigna la sesi�n que primero
 											//active el squelch
 
-	} groups[MAX_GROUPS];
+	};
+
+	static const int GROUP_HASH_SIZE = 1024;	//Entradas de la tabla hash de grupos. Potencia de 2
+
+	stgrupo *groups[MAX_GROUPS];			//Grupos reservados. Se reservan al crearlos y no se liberan hasta el destructor
+	std::atomic<int> nslots;				//Numero de grupos reservados. Todos los indices por debajo son validos. Se cambia con
+											//fd_mutex tomado y se lee sin el (acquire) para validar indices de grupo
+	int group_hash[GROUP_HASH_SIZE];		//Primer grupo de cada entrada de la tabla hash de frecuencia y zona
+	int free_slot;							//Primer grupo de la lista de grupos reservados que estan libres
 
 	int ngroups;
 		
+	void InitGroup(stgrupo *g);
+	void InitSession(stgrupo::stsess *sess);
+	int NewSession(int index_group);
+	static unsigned int GroupHash(const char *rdfr, const char *zona);
+	int FindGroup(const char *rdfr, const char *zona);
+	int NewGroup(const char *rdfr, const char *zona);
+	void FreeGroup(int index_group);
 	int UpdateGroupClimaxParams(int index_group);
 	int UpdateGroupClimaxParamsAllGroups();
 	int GetNextLineField(int pos, char *line, char *out, int out_size);
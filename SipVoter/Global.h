@@ -15,6 +15,10 @@
 #include <pjsua-lib/pjsua.h>
 #include <pjsua-lib/pjsua_internal.h>
 
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
 #include "CoreSip.h"
 
 #define SAMPLING_RATE			8000
@@ -33,6 +37,15 @@
 
 #define RESTART_JBUF			((char)0x52)
 
+/**
+ * Puntero a un pj_str_t temporal, para pasar pj_str("...") a las funciones de pjsip que piden un pj_str_t *.
+ * El temporal vive hasta el final de la expresion completa. Sustituye a &pj_str(...), que no es C++ valido.
+ */
+inline pj_str_t *StrPtr(const pj_str_t &s)
+{
+	return const_cast<pj_str_t *>(&s);
+}
+
 #undef CHECK_QIDX_LOGARITHM
 
 #endif
@@ -0,0 +1,153 @@
+/**
+ * @file AudioRingTest.cpp
+ * @brief Prueba de CORESIP: linea de retardo AudioRing (--audio-ring)
+ *
+ *	Con --audio-ring N no abre sesiones: comprueba el retardo de AudioRing, la linea de retardo de climax, y
+ *	pasa N tramas de un thread productor a uno consumidor verificando cada muestra.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "Global.h"
+#include "AudioRing.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define RING_CAPACITY		(4096*2)	//Como p_retbuff de SipCall
+#define RING_DELAY			40			//Retardo de climax de la prueba, en muestras
+
+/**
+ * Datos del thread productor de --audio-ring.
+ */
+struct RingTest
+{
+	AudioRing *ring;
+	unsigned samples;					//Muestras que escribe el productor
+	pj_uint64_t full;					//Escrituras rechazadas por buffer lleno
+	pj_uint64_t cpu_us;
+};
+
+/**
+ * RingWriter.	...
+ * Productor de --audio-ring. Escribe la secuencia 0, 1, 2... en bloques de tamano variable.
+ */
+static int RingWriter(void *arg)
+{
+	RingTest *t = (RingTest *) arg;
+	pj_int16_t block[SAMPLES_PER_FRAME];
+	pj_uint64_t cpu0 = RadioSim::ThreadCpuUs();
+
+	for (unsigned pos = 0, k = 0; pos < t->samples; k++)
+	{
+		unsigned n = SAMPLES_PER_FRAME / 2 + (k * 7) % (SAMPLES_PER_FRAME / 2);
+		if (n > t->samples - pos) n = t->samples - pos;
+		for (unsigned i = 0; i < n; i++) block[i] = (pj_int16_t) (pos + i);
+		if (t->ring->Write(block, n)) pos += n;
+		else
+		{
+			t->full++;
+			pj_thread_sleep(0);
+		}
+	}
+	t->cpu_us = RadioSim::ThreadCpuUs() - cpu0;
+	return 0;
+}
+
+/**
+ * RunAudioRing.	...
+ * AudioRing. Primero, en un solo thread: el retardo se lee como silencio antes del audio, y dos Restart() seguidos
+ * con la misma posicion y retardo se atienden los dos. Despues un productor y un consumidor en threads distintos
+ * se pasan cfg.audio_ring tramas de SAMPLES_PER_FRAME / 2 muestras, como el envio multicast de climax.
+ * @return	0 si todo se lee como se escribio.
+ */
+int RunAudioRing()
+{
+	pj_pool_t *pool = pjsua_pool_create("AudioRing", 4096, 4096);
+	AudioRing ring(pool, RING_CAPACITY);
+	pj_int16_t in[SAMPLES_PER_FRAME], out[2 * SAMPLES_PER_FRAME];
+	int ret = 0;
+
+	for (unsigned i = 0; i < SAMPLES_PER_FRAME; i++) in[i] = (pj_int16_t) (i + 1);
+
+	//Retardo: RING_DELAY de silencio y luego el audio
+	ring.Write(in, SAMPLES_PER_FRAME);
+	ring.Restart(RING_DELAY);
+	ring.Write(in, SAMPLES_PER_FRAME);
+	unsigned len = ring.GetLen();
+	pj_bool_t ok = ring.Read(out, RING_DELAY + SAMPLES_PER_FRAME);
+	for (unsigned i = 0; ok && i < RING_DELAY + SAMPLES_PER_FRAME; i++)
+	{
+		if (out[i] != (i < RING_DELAY ? 0 : in[i - RING_DELAY])) ok = PJ_FALSE;
+	}
+	printf("AudioRing retardo: %u muestras pendientes de %u, %s\n", len, RING_DELAY + SAMPLES_PER_FRAME,
+		ok ? "silencio y audio correctos" : "ERROR en lo leido");
+	if (!ok || len != RING_DELAY + SAMPLES_PER_FRAME) ret = 1;
+
+	//Dos reinicios iguales: el segundo vuelve a dar el silencio del retardo
+	ring.Restart(RING_DELAY);
+	unsigned len1 = ring.GetLen();
+	ring.Read(out, len1);
+	ring.Restart(RING_DELAY);
+	unsigned len2 = ring.GetLen();
+	printf("AudioRing reinicios iguales: %u y %u muestras de silencio (esperadas %u)\n", len1, len2, RING_DELAY);
+	if (len1 != RING_DELAY || len2 != RING_DELAY) ret = 1;
+	ring.Reset();
+
+	//Productor y consumidor
+	RingTest t;
+	t.ring = new AudioRing(pool, RING_CAPACITY);
+	t.samples = cfg.audio_ring * (SAMPLES_PER_FRAME / 2);
+	t.full = 0;
+	t.cpu_us = 0;
+
+	pj_thread_t *th;
+	if (pj_thread_create(pool, "RingWriter", &RingWriter, &t, 0, 0, &th) != PJ_SUCCESS)
+	{
+		delete t.ring;
+		pj_pool_release(pool);
+		return 1;
+	}
+
+	unsigned errors = 0, empty = 0;
+	pj_uint64_t cpu0 = RadioSim::ThreadCpuUs();
+	pj_uint64_t t0 = RadioSim::NowUs();
+	for (unsigned pos = 0; pos < t.samples; )
+	{
+		unsigned n = SAMPLES_PER_FRAME / 2;
+		if (n > t.samples - pos) n = t.samples - pos;
+		if (!t.ring->Read(out, n))
+		{
+			empty++;
+			pj_thread_sleep(0);
+			continue;
+		}
+		for (unsigned i = 0; i < n; i++)
+		{
+			if (out[i] != (pj_int16_t) (pos + i)) errors++;
+		}
+		pos += n;
+	}
+	pj_uint64_t cpu_us = RadioSim::ThreadCpuUs() - cpu0;
+	double wall_s = (RadioSim::NowUs() - t0) / 1e6;
+	pj_thread_join(th);
+	pj_thread_destroy(th);
+
+	printf("AudioRing %u tramas de %u muestras en %.2f s (%.0f tramas/s): %u muestras erroneas. CPU del productor "
+		"%.1f ns/trama (%llu veces lleno), del consumidor %.1f ns/trama (%u veces vacio)\n", cfg.audio_ring,
+		SAMPLES_PER_FRAME / 2, wall_s, cfg.audio_ring / wall_s, errors, t.cpu_us * 1000.0 / cfg.audio_ring,
+		(unsigned long long) t.full, cpu_us * 1000.0 / cfg.audio_ring, empty);
+	if (errors != 0) ret = 1;
+
+	delete t.ring;
+	pj_pool_release(pool);
+	return ret;
+}
+
+/*@}*/
@@ -0,0 +1,152 @@
+/**
+ * @file DecodeTest.cpp
+ * @brief Prueba de CORESIP: coste del codec al decodificar el audio de radio (--decode)
+ *
+ *	Con --decode N no abre sesiones: mide solo el coste del codec por frame al decodificar N frames G.711 de radio
+ *	dos veces, como OnRdRtp y get_frame(), y una sola vez con una copia desde la cache. No pasa por OnDataReceived,
+ *	el stream ni el jitter buffer: el ahorro en el camino de recepcion completo es menor.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "Global.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define DECODE_SAMPLES		(SAMPLES_PER_FRAME_RTP / 2)	//Muestras de cada frame G.711 que recibe OnRdRtp (10 ms)
+#define DECODE_FRAMES		100			//Frames distintos de --decode, 1 s de voz
+
+/**
+ * RunDecode.	...
+ * Decodificacion del audio de radio. Con el codec PCMA de pjmedia y frames de DECODE_SAMPLES muestras de voz:
+ * - Antes: OnRdRtp decodifica cada paquete en un buffer propio para el retardo y el Qidx, y get_frame() lo vuelve a
+ *   decodificar al sacarlo del jitter buffer.
+ * - Ahora: pjmedia_stream_decode_rx_frame() lo decodifica una vez en la cache del stream y get_frame() copia las
+ *   muestras.
+ * Solo mide el trabajo del codec en los dos caminos, llamando al codec directamente con los mismos buffers e indices
+ * de cache. No incluye la recepcion del RTP, el jitter buffer ni el resto de OnRdRtp y get_frame().
+ * @return	0 si las muestras que entrega get_frame() son las mismas en los dos casos.
+ */
+int RunDecode()
+{
+	pjmedia_codec_mgr *mgr = pjmedia_endpt_get_codec_mgr(pjsua_get_pjmedia_endpt());
+	const pjmedia_codec_info *info[1];
+	unsigned count = 1;
+	pj_str_t id;
+	pjmedia_codec *codec = NULL;
+	pjmedia_codec_param param;
+	pj_pool_t *pool = pjsua_pool_create("Decode", 4096, 4096);
+
+	if (pjmedia_codec_mgr_find_codecs_by_id(mgr, pj_cstr(&id, "PCMA/8000"), &count, info, NULL) != PJ_SUCCESS ||
+		pjmedia_codec_mgr_get_default_param(mgr, info[0], &param) != PJ_SUCCESS ||
+		pjmedia_codec_mgr_alloc_codec(mgr, info[0], &codec) != PJ_SUCCESS)
+	{
+		fprintf(stderr, "ERROR: codec PCMA no disponible\n");
+		pj_pool_release(pool);
+		return 1;
+	}
+	param.setting.vad = 0;
+	param.setting.plc = 0;											//Solo el coste de decodificar
+	codec->op->init(codec, pool);
+	codec->op->open(codec, &param);
+
+	//Paquetes codificados de voz
+	DspInput voice;
+	MakeVoice(voice, 120, 20, 9);
+	std::vector<pj_uint8_t> enc(DECODE_FRAMES * DECODE_SAMPLES);
+	std::vector<pj_size_t> enc_size(DECODE_FRAMES);
+	for (unsigned k = 0; k < DECODE_FRAMES; k++)
+	{
+		pj_int16_t pcm[DECODE_SAMPLES];
+		for (unsigned i = 0; i < DECODE_SAMPLES; i++)
+		{
+			pcm[i] = (pj_int16_t) PJ_MAX(-32768.0f, PJ_MIN(32767.0f, voice.samples[k * DECODE_SAMPLES + i]));
+		}
+		pjmedia_frame in, out;
+		pj_bzero(&in, sizeof(in));
+		pj_bzero(&out, sizeof(out));
+		in.type = PJMEDIA_FRAME_TYPE_AUDIO;
+		in.buf = pcm;
+		in.size = sizeof(pcm);
+		out.buf = &enc[k * DECODE_SAMPLES];
+		if (codec->op->encode(codec, &in, DECODE_SAMPLES, &out) != PJ_SUCCESS || out.size != DECODE_SAMPLES)
+		{
+			fprintf(stderr, "ERROR: codificando el frame %u de --decode\n", k);
+			codec->op->close(codec);
+			pjmedia_codec_mgr_dealloc_codec(mgr, codec);
+			pj_pool_release(pool);
+			return 1;
+		}
+		enc_size[k] = out.size;
+	}
+
+	pj_int16_t rdrtp[750];											//Buffer de 1500 bytes de OnRdRtp
+	pj_int16_t *cache = new pj_int16_t[PJMEDIA_STREAM_RX_PCM_CACHE * DECODE_SAMPLES];
+	std::vector<int> cache_seq(PJMEDIA_STREAM_RX_PCM_CACHE, -1);
+	pj_int16_t out_old[DECODE_SAMPLES], out_new[DECODE_SAMPLES];
+	unsigned errors = 0;
+	double ns[2];
+
+	for (unsigned mode = 0; mode < 3; mode++)
+	{
+		pj_uint64_t cpu0 = RadioSim::ThreadCpuUs();
+		unsigned npackets = mode == 2 ? DECODE_FRAMES : cfg.decode;
+
+		for (unsigned seq = 0; seq < npackets; seq++)
+		{
+			unsigned k = seq % DECODE_FRAMES;
+			pjmedia_frame in, out;
+			pj_bzero(&in, sizeof(in));
+			pj_bzero(&out, sizeof(out));
+			in.type = PJMEDIA_FRAME_TYPE_AUDIO;
+			in.buf = &enc[k * DECODE_SAMPLES];
+			in.size = enc_size[k];
+
+			if (mode == 0 || mode == 2)
+			{
+				//OnRdRtp y get_frame() decodifican
+				out.buf = rdrtp;
+				codec->op->decode(codec, &in, sizeof(rdrtp), PJ_FALSE, &out);
+				out.buf = out_old;
+				codec->op->decode(codec, &in, sizeof(out_old), PJ_TRUE, &out);
+			}
+			if (mode == 1 || mode == 2)
+			{
+				//OnRdRtp decodifica en la cache y get_frame() copia
+				unsigned idx = seq % PJMEDIA_STREAM_RX_PCM_CACHE;
+				out.buf = cache + idx * DECODE_SAMPLES;
+				codec->op->decode(codec, &in, DECODE_SAMPLES * sizeof(pj_int16_t), PJ_FALSE, &out);
+				cache_seq[idx] = (int) seq;
+
+				//get_frame() la encuentra en la cache
+				if (cache_seq[idx] == (int) seq)
+				{
+					pj_memcpy(out_new, cache + idx * DECODE_SAMPLES, out.size);
+					cache_seq[idx] = -1;
+				}
+			}
+			if (mode == 2 && pj_memcmp(out_old, out_new, sizeof(out_old)) != 0) errors++;
+		}
+		if (mode < 2) ns[mode] = (RadioSim::ThreadCpuUs() - cpu0) * 1000.0 / PJ_MAX(1u, npackets);
+	}
+
+	printf("Decodificacion PCMA (solo codec) %u frames de %u muestras: dos decodificaciones %.0f ns/frame, una y copia "
+		"%.0f ns/frame (%.0f %% menos). %u frames con muestras distintas\n", cfg.decode, DECODE_SAMPLES,
+		ns[0], ns[1], ns[0] > 0 ? 100.0 * (ns[0] - ns[1]) / ns[0] : 0.0, errors);
+
+	delete[] cache;
+	codec->op->close(codec);
+	pjmedia_codec_mgr_dealloc_codec(mgr, codec);
+	pj_pool_release(pool);
+
+	return errors != 0 ? 1 : 0;
+}
+
+/*@}*/
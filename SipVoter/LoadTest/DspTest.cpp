@@ -0,0 +1,308 @@
+/**
+ * @file DspTest.cpp
+ * @brief Prueba de CORESIP: calculo del Qidx de qidx.c frente a processor.c (--dsp)
+ *
+ *	Con --dsp N no abre sesiones: compara qidx.c, con cada implementacion, con el calculo original de
+ *	processor.c sobre voz con distinto ruido, ruido, silencio, un tono, voz saturada y el fichero de --dsp-wav si se
+ *	indica. Despues mide la CPU de N sesiones con cada calculo y las sesiones que caben en un nucleo.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "Global.h"
+#include "qidx.h"
+#include "processor.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <string>
+
+#define QIDX_PACKET			(SAMPLES_PER_FRAME_RTP / 2)	//Muestras de cada paquete, como en OnRdRtp
+#define DSP_INPUT_S			10			//Duracion de cada senal de --dsp
+#define DSP_MAX_DIFF		1			//Diferencia admitida con processor.c en la escala 0-50, por redondeo
+#define DSP_MAX_DIFF_PCT	1.0			//Paquetes de cada senal en los que se admite una diferencia mayor
+
+/**
+ * Voz sintetica de --dsp: tren de pulsos con el tono variando, por un resonador en el primer formante, con silabas
+ * de 250 ms y ruido blanco anadido.
+ */
+struct VoiceSim
+{
+	double phase;			//Fase del tren de pulsos, en periodos
+	double f0;				//Tono medio
+	double y1, y2;			//Estado del resonador
+	double noise;			//Desviacion del ruido
+	pj_uint32_t seed;
+	unsigned n;				//Muestras generadas
+
+	double Rand()
+	{
+		seed = seed * 1103515245 + 12345;
+		return ((seed >> 8) & 0xFFFF) / 65536.0;
+	}
+
+	void Fill(float *out, unsigned count)
+	{
+		const double PI = 3.14159265358979323846;
+		const double r = 0.95, w = 2 * PI * 700 / SAMPLING_RATE;
+
+		for (unsigned i = 0; i < count; i++, n++)
+		{
+			double t = (double) n / SAMPLING_RATE;
+			double f = f0 * (1 + 0.1 * sin(2 * PI * 3 * t));
+			double env = 0.5 + 0.5 * sin(2 * PI * 2 * t);
+			double x = 0;
+
+			phase += f / SAMPLING_RATE;
+			if (phase >= 1)
+			{
+				phase -= 1;
+				x = 4000 * env;
+			}
+			double y = x + 2 * r * cos(w) * y1 - r * r * y2;
+			y2 = y1;
+			y1 = y;
+
+			double g = Rand() + Rand() + Rand() + Rand() - 2;
+			out[i] = (float) (y + noise * g * 1.73);
+		}
+	}
+};
+
+/**
+ * MakeVoice.	...
+ * Voz sintetica de DSP_INPUT_S segundos con ruido blanco a snr_db dB por debajo de su valor eficaz.
+ */
+void MakeVoice(DspInput &in, double f0, double snr_db, pj_uint32_t seed)
+{
+	VoiceSim v;
+	v.phase = 0;
+	v.f0 = f0;
+	v.y1 = v.y2 = 0;
+	v.noise = 0;
+	v.seed = seed;
+	v.n = 0;
+
+	in.samples.resize(DSP_INPUT_S * SAMPLING_RATE);
+	v.Fill(&in.samples[0], (unsigned) in.samples.size());
+
+	double power = 0;
+	for (size_t i = 0; i < in.samples.size(); i++) power += (double) in.samples[i] * in.samples[i];
+	double noise = sqrt(power / in.samples.size()) / pow(10.0, snr_db / 20) * 1.73;
+	for (size_t i = 0; i < in.samples.size(); i++)
+	{
+		double g = v.Rand() + v.Rand() + v.Rand() + v.Rand() - 2;
+		in.samples[i] += (float) (noise * g);
+	}
+}
+
+/**
+ * LoadWav.	...
+ * Lee un fichero wav de 8 kHz, mono y 16 bits.
+ * @return	PJ_TRUE si lo ha leido.
+ */
+static pj_bool_t LoadWav(const char *file, DspInput &in)
+{
+	pj_pool_t *pool = pjsua_pool_create("DspWav", 4096, 4096);
+	pjmedia_port *port = NULL;
+	pj_bool_t ok = PJ_FALSE;
+
+	if (pjmedia_wav_player_port_create(pool, file, 0, PJMEDIA_FILE_NO_LOOP, 0, &port) == PJ_SUCCESS)
+	{
+		if (port->info.clock_rate == SAMPLING_RATE && port->info.channel_count == 1 && port->info.bits_per_sample == 16)
+		{
+			std::vector<pj_int16_t> buf(port->info.samples_per_frame);
+			pjmedia_frame frame;
+
+			for (;;)
+			{
+				frame.buf = &buf[0];
+				frame.size = port->info.bytes_per_frame;
+				if (pjmedia_port_get_frame(port, &frame) != PJ_SUCCESS || frame.type != PJMEDIA_FRAME_TYPE_AUDIO) break;
+				for (unsigned i = 0; i < frame.size / 2; i++) in.samples.push_back(buf[i]);
+			}
+			in.name = file;
+			ok = in.samples.size() >= QIDX_BLOCK_SIZE;
+		}
+		pjmedia_port_destroy(port);
+	}
+	pj_pool_release(pool);
+	return ok;
+}
+
+/**
+ * RunDsp.	...
+ * Qidx de qidx.c frente a processor.c. Cada senal se pasa en paquetes de QIDX_PACKET muestras, como en OnRdRtp, y en
+ * cada paquete se compara el valor de 0 a 50 de las dos. Se admite una diferencia de DSP_MAX_DIFF por el redondeo en
+ * algun paquete, y mayor en DSP_MAX_DIFF_PCT de ellos: un cambio de redondeo puede mover el maximo del cepstrum
+ * de un bloque, y el filtro del indicador tarda en olvidarlo. Despues mide la CPU de cfg.dsp sesiones durante
+ * DSP_INPUT_S segundos de voz con processor.c y con qidx.c en cada implementacion.
+ * @return	0 si todas las senales coinciden.
+ */
+int RunDsp()
+{
+	std::vector<DspInput> inputs;
+	const double snrs[] = { 30, 20, 10, 5, 0 };
+	int ret = 0;
+
+	for (unsigned i = 0; i < PJ_ARRAY_SIZE(snrs); i++)
+	{
+		DspInput in;
+		char name[32];
+		pj_ansi_snprintf(name, sizeof(name), "voz %.0f dB", snrs[i]);
+		in.name = name;
+		MakeVoice(in, 100 + 20 * i, snrs[i], 1 + i);
+		inputs.push_back(in);
+	}
+	{
+		DspInput in;
+		in.name = "voz saturada";
+		MakeVoice(in, 180, 30, 7);
+		for (size_t i = 0; i < in.samples.size(); i++)
+		{
+			in.samples[i] = (float) PJ_MAX(-32768.0, PJ_MIN(32767.0, in.samples[i] * 20.0));
+		}
+		inputs.push_back(in);
+	}
+	{
+		DspInput in;
+		in.name = "ruido";
+		MakeVoice(in, 120, -60, 8);
+		inputs.push_back(in);
+	}
+	{
+		DspInput in;
+		in.name = "tono 1 kHz";
+		in.samples.resize(DSP_INPUT_S * SAMPLING_RATE);
+		for (size_t i = 0; i < in.samples.size(); i++)
+		{
+			in.samples[i] = (float) (8000 * sin(2 * 3.14159265358979323846 * 1000 * i / SAMPLING_RATE));
+		}
+		inputs.push_back(in);
+	}
+	{
+		DspInput in;
+		in.name = "silencio";
+		in.samples.assign(DSP_INPUT_S * SAMPLING_RATE, 0.0f);
+		inputs.push_back(in);
+	}
+	if (cfg.dsp_wav != NULL)
+	{
+		DspInput in;
+		if (!LoadWav(cfg.dsp_wav, in))
+		{
+			fprintf(stderr, "ERROR: %s no es un wav de 8 kHz, mono y 16 bits\n", cfg.dsp_wav);
+			return 1;
+		}
+		inputs.push_back(in);
+	}
+
+	std::vector<qidx_impl_t> impls;
+	impls.push_back(QIDX_IMPL_SCALAR);
+	if (qidx_global_init() == QIDX_IMPL_SSE2) impls.push_back(QIDX_IMPL_SSE2);
+	const char *impl_name[] = { "auto", "escalar", "SSE2" };
+
+	//Comparacion con processor.c
+	for (size_t k = 0; k < inputs.size(); k++)
+	{
+		const std::vector<float> &s = inputs[k].samples;
+		unsigned npackets = (unsigned) (s.size() / QIDX_PACKET);
+
+		for (size_t m = 0; m < impls.size(); m++)
+		{
+			processor_data_t ref;
+			qidx_data_t data;
+			float buf[QIDX_PACKET];
+			unsigned over = 0;
+			int max_diff = 0, max_ref = 0;
+
+			pj_bzero(&ref, sizeof(ref));
+			processor_init(&ref, 0);
+			qidx_init_impl(&data, 0, impls[m]);
+
+			for (unsigned p = 0; p < npackets; p++)
+			{
+				pj_memcpy(buf, &s[p * QIDX_PACKET], sizeof(buf));
+				process(&ref, buf, QIDX_PACKET);
+				qidx_process(&data, &s[p * QIDX_PACKET], QIDX_PACKET);
+
+				int vr = quality_indicator(&ref);
+				int diff = abs(vr - qidx_quality_indicator(&data));
+				if (diff > DSP_MAX_DIFF) over++;
+				max_diff = PJ_MAX(max_diff, diff);
+				max_ref = PJ_MAX(max_ref, vr);
+			}
+
+			pj_bool_t ok = over * 100.0 <= DSP_MAX_DIFF_PCT * npackets;
+			printf("DSP %-14s %-7s: %u paquetes, Qidx max %d, diferencia max %d, mayor de %d en %u paquetes%s\n",
+				inputs[k].name.c_str(), impl_name[impls[m]], npackets, max_ref, max_diff, DSP_MAX_DIFF, over,
+				ok ? "" : " ERROR");
+			if (!ok) ret = 1;
+		}
+	}
+
+	//Sesiones por nucleo, con las senales de voz
+	unsigned nsessions = cfg.dsp, nvoices = PJ_ARRAY_SIZE(snrs);
+	unsigned npackets = DSP_INPUT_S * SAMPLING_RATE / QIDX_PACKET;
+
+	for (unsigned mode = 0; mode <= impls.size(); mode++)
+	{
+		std::vector<processor_data_t> ref;
+		std::vector<qidx_data_t> data;
+		float buf[QIDX_PACKET];
+		const char *name;
+
+		if (mode == 0)
+		{
+			name = "processor.c";
+			ref.resize(nsessions);
+			for (unsigned i = 0; i < nsessions; i++)
+			{
+				pj_bzero(&ref[i], sizeof(ref[i]));
+				processor_init(&ref[i], 0);
+			}
+		}
+		else
+		{
+			name = impl_name[impls[mode - 1]];
+			data.resize(nsessions);
+			for (unsigned i = 0; i < nsessions; i++) qidx_init_impl(&data[i], 0, impls[mode - 1]);
+		}
+
+		pj_uint64_t cpu0 = RadioSim::ThreadCpuUs();
+		for (unsigned p = 0; p < npackets; p++)
+		{
+			for (unsigned i = 0; i < nsessions; i++)
+			{
+				const float *v = &inputs[i % nvoices].samples[p * QIDX_PACKET];
+				if (mode == 0)
+				{
+					pj_memcpy(buf, v, sizeof(buf));
+					process(&ref[i], buf, QIDX_PACKET);
+					quality_indicator(&ref[i]);
+				}
+				else
+				{
+					qidx_process(&data[i], v, QIDX_PACKET);
+					qidx_quality_indicator(&data[i]);
+				}
+			}
+		}
+		double cpu_s = (RadioSim::ThreadCpuUs() - cpu0) / 1e6;
+
+		printf("DSP CPU %-11s: %u sesiones x %u s en %.3f s de CPU, %.1f us por paquete, %.0f sesiones por nucleo\n",
+			name, nsessions, DSP_INPUT_S, cpu_s, cpu_s * 1e6 / ((double) npackets * nsessions),
+			cpu_s > 0 ? nsessions * DSP_INPUT_S / cpu_s : 0.0);
+	}
+	return ret;
+}
+
+/*@}*/
@@ -0,0 +1,223 @@
+/**
+ * @file FdTest.cpp
+ * @brief Prueba de carga de CORESIP: contencion de los mutex de FrecDesp (--fd-threads)
+ *
+ *	Con --fd-threads N, al final de GroupsTest.cpp: contencion de los mutex de FrecDesp. N threads consultan a la vez
+ *	las sesiones de todos los grupos y otro busca llamadas entre grupos con fd_mutex. Mide el tiempo de cada llamada y
+ *	la espera media respecto de un solo thread.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include <pjsua-lib/pjsua_internal.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "Global.h"
+#include "SipAgent.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+#define FD_MEASURE_MS		2000		//Duracion de cada medida de --fd-threads
+#define FD_BIN_NS			50			//Histograma del tiempo de las llamadas a FrecDesp en pasos de 50 ns
+#define FD_BINS				4000
+
+/**
+ * Sesion de un grupo de FrecDesp para --fd-threads.
+ */
+struct FdSess
+{
+	int group;
+	int sess;
+	pjsua_call_id id;
+};
+
+/**
+ * Datos de cada thread de --fd-threads.
+ */
+struct FdBench
+{
+	const std::vector<FdSess> *sess;
+	unsigned first;				//Sesion por la que empieza, para que cada thread vaya por un grupo
+	pj_bool_t global;			//Busca llamadas con fd_mutex (GetCLD) en lugar de consultar su grupo
+	pj_uint64_t end_us;
+	pj_uint64_t calls;
+	pj_uint64_t sum_ns;
+	pj_uint64_t max_ns;
+	std::vector<unsigned> hist;
+};
+
+/**
+ * NowNs.	...
+ */
+static pj_uint64_t NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (pj_uint64_t) ts.tv_sec * 1000000000 + (pj_uint64_t) ts.tv_nsec;
+}
+
+/**
+ * FdBenchThread.	...
+ * Thread de --fd-threads. Recorre las sesiones hasta end_us. Con global busca cada llamada entre todos los grupos
+ * (fd_mutex y el mutex de cada grupo), y si no consulta el BSS, el Qidx, la ventana y la secuencia multicast de su
+ * grupo, como el RTP de una sesion (solo el mutex del grupo).
+ */
+static int FdBenchThread(void *arg)
+{
+	FdBench *b = (FdBench *) arg;
+	FrecDesp *fd = SipAgent::_FrecDesp;
+	size_t n = b->sess->size();
+
+	for (size_t k = b->first; (k & 63) != 0 || RadioSim::NowUs() < b->end_us; k++)
+	{
+		const FdSess &s = (*b->sess)[k % n];
+		pj_uint64_t t0 = NowNs();
+		if (b->global)
+		{
+			pj_uint8_t cld;
+			fd->GetCLD(s.id, &cld);
+		}
+		else
+		{
+			int method, value;
+			pj_uint8_t qidx, qidx_ml;
+			pj_uint32_t tred;
+			fd->GetBss(s.group, s.sess, &method, &value);
+			fd->GetQidx(s.group, s.sess, &qidx, &qidx_ml, &tred);
+			fd->GetInWindow(s.group, s.sess);
+			fd->Get_mcast_seq(s.group);
+		}
+		pj_uint64_t ns = NowNs() - t0;
+
+		b->calls++;
+		b->sum_ns += ns;
+		if (ns > b->max_ns) b->max_ns = ns;
+		b->hist[PJ_MIN(ns / FD_BIN_NS, (pj_uint64_t) FD_BINS)]++;
+	}
+	return 0;
+}
+
+/**
+ * FdRun.	...
+ * Arranca un thread por cada elemento de b durante FD_MEASURE_MS y espera a que terminen todos.
+ */
+static void FdRun(pj_pool_t *pool, const std::vector<FdSess> &sess, std::vector<FdBench> &b)
+{
+	std::vector<pj_thread_t *> th(b.size(), (pj_thread_t *) NULL);
+	pj_uint64_t end_us = RadioSim::NowUs() + FD_MEASURE_MS * 1000;
+
+	for (unsigned i = 0; i < b.size(); i++)
+	{
+		b[i].sess = &sess;
+		b[i].first = (unsigned) (i * sess.size() / b.size());
+		b[i].end_us = end_us;
+		b[i].calls = b[i].sum_ns = b[i].max_ns = 0;
+		b[i].hist.assign(FD_BINS + 1, 0);
+		pj_thread_create(pool, "FdBench", &FdBenchThread, &b[i], 0, 0, &th[i]);
+	}
+	for (unsigned i = 0; i < th.size(); i++)
+	{
+		if (th[i] == NULL) continue;
+		pj_thread_join(th[i]);
+		pj_thread_destroy(th[i]);
+	}
+}
+
+/**
+ * FdReport.	...
+ * Suma los threads de b del tipo global y escribe sus llamadas por segundo y el tiempo de cada una.
+ * @return	Tiempo medio de una llamada en ns.
+ */
+static double FdReport(const char *name, const std::vector<FdBench> &b, pj_bool_t global, double base_ns)
+{
+	std::vector<unsigned> hist(FD_BINS + 1, 0);
+	pj_uint64_t calls = 0, sum_ns = 0, max_ns = 0;
+	unsigned nthreads = 0;
+
+	for (unsigned i = 0; i < b.size(); i++)
+	{
+		if (b[i].global != global) continue;
+		nthreads++;
+		calls += b[i].calls;
+		sum_ns += b[i].sum_ns;
+		max_ns = PJ_MAX(max_ns, b[i].max_ns);
+		for (unsigned j = 0; j <= FD_BINS; j++) hist[j] += b[i].hist[j];
+	}
+	if (calls == 0) return 0;
+
+	double p[2] = { 0.5, 0.99 }, pv[2] = { 0, 0 };
+	for (unsigned k = 0; k < 2; k++)
+	{
+		pj_uint64_t acc = 0;
+		for (unsigned j = 0; j <= FD_BINS; j++)
+		{
+			acc += hist[j];
+			if (acc >= p[k] * calls)
+			{
+				pv[k] = (j + 1) * FD_BIN_NS / 1000.0;
+				break;
+			}
+		}
+	}
+
+	double mean_ns = (double) sum_ns / calls;
+	printf("  %-20s %2u threads, %8.0f llamadas/s, media %.2f us, p50 %.2f us, p99 %.2f us, max %.1f us",
+		name, nthreads, calls * 1000.0 / FD_MEASURE_MS, mean_ns / 1000, pv[0], pv[1], max_ns / 1000.0);
+	if (base_ns > 0) printf(", espera media %.2f us", PJ_MAX(0.0, mean_ns - base_ns) / 1000);
+	printf("\n");
+	return mean_ns;
+}
+
+/**
+ * RunFdContention.	...
+ * Contencion de los mutex de FrecDesp con las sesiones ya establecidas. Primero un solo thread consulta las sesiones
+ * de sus grupos y despues uno solo busca llamadas con fd_mutex, sin competir con nadie. Despues cfg.fd_threads threads
+ * consultan las sesiones a la vez, empezando cada uno por un grupo distinto, mientras otro busca llamadas. La espera
+ * media es lo que tarda de mas cada llamada respecto de la medida con un solo thread: el tiempo esperando los mutex.
+ */
+int RunFdContention(const std::vector<int> &calls)
+{
+	std::vector<FdSess> sess;
+	for (unsigned i = 0; i < calls.size(); i++)
+	{
+		pjsua_call_id id = CALL_INDEX(calls[i]);
+		SipCall *call = (SipCall *) pjsua_var.calls[id].user_data;
+		if (call == NULL || call->_Index_group < 0 || call->_Index_sess < 0) continue;
+
+		FdSess s = { call->_Index_group, call->_Index_sess, id };
+		sess.push_back(s);
+	}
+	if (sess.empty())
+	{
+		printf("FrecDesp: ninguna sesion en un grupo\n");
+		return 1;
+	}
+
+	pj_pool_t *pool = pjsua_pool_create("FdBench", 1024, 1024);
+	std::vector<FdBench> single(1), global(1), all(cfg.fd_threads + 1);
+
+	single[0].global = PJ_FALSE;
+	global[0].global = PJ_TRUE;
+	for (unsigned i = 0; i < all.size(); i++) all[i].global = (i == cfg.fd_threads);
+
+	FdRun(pool, sess, single);
+	FdRun(pool, sess, global);
+	FdRun(pool, sess, all);
+	pj_pool_release(pool);
+
+	printf("FrecDesp: %u sesiones en %u grupos, %u ms por medida\n", (unsigned) sess.size(), cfg.groups, FD_MEASURE_MS);
+	double base_sess = FdReport("Sesion, solo", single, PJ_FALSE, 0);
+	double base_global = FdReport("Busqueda, solo", global, PJ_TRUE, 0);
+	FdReport("Sesion, a la vez", all, PJ_FALSE, base_sess);
+	FdReport("Busqueda, a la vez", all, PJ_TRUE, base_global);
+
+	return 0;
+}
+
+/*@}*/
@@ -0,0 +1,314 @@
+/**
+ * @file GroupsTest.cpp
+ * @brief Prueba de carga de las sesiones de radio del votador de CORESIP
+ *
+ *	Prueba por defecto. Abre una sesion de radio Rx por cada receptor simulado con RadioSim y mide:
+ *	- CPU por sesion: CPU del proceso menos la de los threads del simulador, dividida por el numero de sesiones.
+ *	- Latencia de la decision BSS: desde que se activa el squelch de un grupo hasta que RdInfoCb indica
+ *	  seleccionada la sesion con mayor qidx. Tambien hasta el primer paquete de audio del grupo.
+ *	- Jitter del envio multicast: desviacion del tiempo entre paquetes del grupo respecto de 10ms.
+ *	- Memoria por grupo: RSS del proceso y memoria de los pools de pjsua antes y despues de abrir las sesiones.
+ *	- Threads: los del proceso antes y despues de abrir las sesiones, y CPU por cada 100 sesiones. Con el envio
+ *	  multicast en McastScheduler las sesiones no anaden threads; antes era uno por sesion.
+ *	- Establecimiento: sesiones por segundo al abrirlas todas seguidas, y tiempo de cada una desde CORESIP_CallMake
+ *	  hasta CONFIRMED. Con --groups 128 --radios 4 se prueban mas de 500 llamadas simultaneas.
+ *	Al final, con las sesiones establecidas, las pruebas de --ptt (PttTest.cpp) y --fd-threads (FdTest.cpp).
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include <pjsua-lib/pjsua_internal.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define EGRESS_PERIOD_US	10000		//El votador envia al multicast cada PTIME/2
+
+/**
+ * OnSquOn.	...
+ * El simulador ha activado el squelch de un grupo.
+ */
+static void OnSquOn(int group, int best_sess, pj_uint64_t t_us)
+{
+	pj_mutex_lock(st.mutex);
+	if (measuring)
+	{
+		if (st.t_squ_on[group] != 0 && !st.decided[group]) st.undecided++;
+		st.bursts++;
+	}
+	st.t_squ_on[group] = t_us;
+	st.best_sess[group] = best_sess;
+	st.decided[group] = PJ_FALSE;
+	pj_mutex_unlock(st.mutex);
+}
+
+/**
+ * OnEgress.	...
+ * Paquete de audio del votador en el multicast de un grupo.
+ */
+static void OnEgress(int group, pj_uint64_t t_us, pj_uint64_t t_squ_on_us, pj_bool_t first, pj_uint64_t t_prev_us)
+{
+	PJ_UNUSED_ARG(group);
+	if (!measuring) return;
+
+	pj_mutex_lock(st.mutex);
+	st.egress_pkts++;
+	if (first)
+	{
+		st.first_egress_ms.push_back((t_us - t_squ_on_us) / 1000.0);
+	}
+	else if (t_prev_us >= t_squ_on_us && t_prev_us != 0)
+	{
+		//Solo entre paquetes de la misma rafaga
+		double d = (double) (t_us - t_prev_us) - EGRESS_PERIOD_US;
+		if (d < 0) d = -d;
+		st.jitter_n++;
+		st.jitter_sum_us += d;
+		if (d > st.jitter_max_us) st.jitter_max_us = d;
+		unsigned bin = (unsigned) (d / 100);
+		st.jitter_hist[bin < JITTER_BINS ? bin : JITTER_BINS]++;
+	}
+	pj_mutex_unlock(st.mutex);
+}
+
+/**
+ * OnPtt.	...
+ * Una radio ha recibido un cambio del tipo de PTT.
+ */
+static void OnPtt(int radio, unsigned ptt_type, pj_uint64_t t_us)
+{
+	pj_mutex_lock(st.mutex);
+	st.radio_ptt[radio] = ptt_type;
+	st.t_radio_ptt[radio] = t_us;
+	pj_mutex_unlock(st.mutex);
+}
+
+/**
+ * JitterPercentile.	...
+ */
+static double JitterPercentile(double p)
+{
+	unsigned total = 0, acc = 0;
+	for (unsigned i = 0; i <= JITTER_BINS; i++) total += st.jitter_hist[i];
+	if (total == 0) return 0;
+	for (unsigned i = 0; i <= JITTER_BINS; i++)
+	{
+		acc += st.jitter_hist[i];
+		if (acc >= p * total) return (i + 1) * 0.1;
+	}
+	return JITTER_BINS * 0.1;
+}
+
+/**
+ * RunGroups.	...
+ * Abre cfg.radios sesiones Rx en cada uno de cfg.groups grupos con las radios de RadioSim, mide durante
+ * cfg.duration_s segundos e informa. Despues, si se indican, las pruebas de PTT y de FrecDesp con las mismas sesiones.
+ * @param	accId	Cuenta del votador.
+ * @return	0 si las pruebas del final no han fallado.
+ */
+int RunGroups(int accId)
+{
+	CORESIP_Error err;
+	std::vector<int> calls;
+	unsigned nsessions = cfg.groups * cfg.radios;
+
+	pj_pool_t *pool = pjsua_pool_create("LoadTest", 512, 512);
+	pj_mutex_create_simple(pool, "LoadTestMtx", &st.mutex);
+	st.call_group.assign(pjsua_call_get_max_count(), -1);
+	st.call_sess.assign(pjsua_call_get_max_count(), -1);
+	st.t_make.assign(pjsua_call_get_max_count(), 0);
+	st.t_confirmed.assign(pjsua_call_get_max_count(), 0);
+	st.t_squ_on.assign(cfg.groups, 0);
+	st.best_sess.assign(cfg.groups, -1);
+	st.decided.assign(cfg.groups, PJ_FALSE);
+	st.decision_ms.reserve(cfg.groups * (cfg.duration_s * 1000 / cfg.burst_period_ms + 2));
+	st.first_egress_ms.reserve(st.decision_ms.capacity());
+	st.radio_ptt.assign(nsessions, 0);
+	st.t_radio_ptt.assign(nsessions, 0);
+
+	/**
+	 * Radios simuladas.
+	 */
+	RadioSimConfig rcfg;
+	rcfg.groups = cfg.groups;
+	rcfg.radios = cfg.radios;
+	rcfg.sip_port = cfg.radio_sip_port;
+	rcfg.rtp_port = cfg.radio_sip_port + 2;
+	rcfg.egress_port = cfg.egress_port;
+	rcfg.voter_rtp_port = cfg.voter_rtp_port;
+	rcfg.burst_on_ms = cfg.burst_on_ms;
+	rcfg.burst_period_ms = cfg.burst_period_ms;
+	rcfg.ka_period_ms = 200;
+	rcfg.ka_multiplier = 10;
+
+	RadioSimEvents rev = { OnSquOn, OnEgress, OnPtt };
+	RadioSim *sim = new RadioSim(&rcfg, &rev);
+	sim->Start();
+
+	pj_uint64_t rss0 = RssBytes();
+	pj_size_t pool0 = pjsua_var.cp.used_size;
+	unsigned threads0 = ThreadCount();
+
+	/**
+	 * Una sesion Rx por receptor. Cada grupo es una frecuencia con su destino multicast.
+	 */
+	printf("Abriendo %u sesiones (%u grupos x %u receptores)...\n", nsessions, cfg.groups, cfg.radios);
+	pj_uint64_t t_setup0 = RadioSim::NowUs();
+	for (unsigned g = 0; g < cfg.groups; g++)
+	{
+		for (unsigned s = 0; s < cfg.radios; s++)
+		{
+			CORESIP_CallInfo info;
+			CORESIP_CallOutInfo out;
+			int call;
+
+			pj_bzero(&info, sizeof(info));
+			info.AccountId = accId;
+			info.Type = CORESIP_CALL_RD;
+			info.Priority = CORESIP_PR_NORMAL;
+			info.Flags = CORESIP_CALL_RD_RXONLY;
+			info.Flags_type = CORESIP_CALL_RD_RXONLY;
+			info.PreferredCodec = 0;
+			info.FrequencyType = Simple;
+			info.CLDCalculateMethod = Relative;
+			info.BssWindows = cfg.bss_window_ms;
+			info.AudioInBssWindow = PJ_TRUE;
+			info.cld_supervision_time = cfg.cld_supervision_s;
+			pj_ansi_strcpy(info.bss_method, "RSSI");
+
+			pj_bzero(&out, sizeof(out));
+			pj_ansi_snprintf(out.DstUri, sizeof(out.DstUri), "<sip:rx-%u-%u@127.0.0.1:%u>", g, s, cfg.radio_sip_port);
+			pj_ansi_snprintf(out.RdFr, sizeof(out.RdFr), "LT%03u.000", g);
+			pj_ansi_strcpy(out.RdMcastAddr, "127.0.0.1");
+			out.RdMcastPort = cfg.egress_port + g;
+
+			pj_uint64_t t_make = RadioSim::NowUs();
+			if (CORESIP_CallMake(&info, &out, &call, &err) != 0)
+			{
+				fprintf(stderr, "ERROR abriendo %s: %s\n", out.DstUri, err.Info);
+				continue;
+			}
+
+			calls.push_back(call);
+			pj_mutex_lock(st.mutex);
+			st.t_make[CALL_INDEX(call)] = t_make;
+			st.call_group[CALL_INDEX(call)] = (int) g;
+			st.call_sess[CALL_INDEX(call)] = (int) s;
+			pj_mutex_unlock(st.mutex);
+		}
+	}
+
+	pj_uint64_t t_setup1 = RadioSim::NowUs();
+
+	//Espera a que se establezcan y a que termine el tiempo de inicio de las sesiones de radio (4.5s)
+	for (int i = 0; i < 600 && st.confirmed < nsessions; i++) pj_thread_sleep(100);
+
+	pj_mutex_lock(st.mutex);
+	std::vector<double> setup_ms;
+	for (unsigned i = 0; i < calls.size(); i++)
+	{
+		unsigned idx = CALL_INDEX(calls[i]);
+		if (st.t_confirmed[idx] != 0) setup_ms.push_back((st.t_confirmed[idx] - st.t_make[idx]) / 1000.0);
+	}
+	double setup_s = st.confirmed ? (st.t_last_confirmed - t_setup0) / 1e6 : 0.0;
+	printf("Establecimiento:        %u sesiones en %.2f s (%.0f sesiones/s, CallMake %.1f ms). p50 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+		st.confirmed, setup_s, setup_s > 0 ? st.confirmed / setup_s : 0.0, (t_setup1 - t_setup0) / 1000.0,
+		Percentile(setup_ms, 0.5), Percentile(setup_ms, 0.99), Percentile(setup_ms, 1.0));
+	pj_mutex_unlock(st.mutex);
+
+	pj_thread_sleep(5000);
+
+	pj_uint64_t rss1 = RssBytes();
+	pj_size_t pool1 = pjsua_var.cp.used_size;
+	unsigned threads1 = ThreadCount();
+	printf("Sesiones establecidas: %u de %u (radios %u). MAM enviados: %u\n", st.confirmed, nsessions, sim->Connected(), sim->MamSent());
+
+	/**
+	 * Medida
+	 */
+	sim->SetBursts(PJ_TRUE);
+	pj_thread_sleep(cfg.burst_period_ms);		//Se descarta el primer periodo
+
+	pj_uint64_t cpu0 = ProcessCpuUs();
+	pj_uint64_t sim_cpu0 = sim->ThreadsCpuUs();
+	pj_uint64_t t0 = RadioSim::NowUs();
+	measuring = PJ_TRUE;
+
+	pj_thread_sleep(cfg.duration_s * 1000);
+
+	measuring = PJ_FALSE;
+	pj_uint64_t t1 = RadioSim::NowUs();
+	pj_uint64_t cpu1 = ProcessCpuUs();
+	pj_uint64_t sim_cpu1 = sim->ThreadsCpuUs();
+	sim->SetBursts(PJ_FALSE);
+
+	/**
+	 * Informe
+	 */
+	double wall_us = (double) (t1 - t0);
+	double voter_cpu_us = (double) (cpu1 - cpu0) - (double) (sim_cpu1 - sim_cpu0);
+	if (voter_cpu_us < 0) voter_cpu_us = 0;
+
+	pj_mutex_lock(st.mutex);
+	printf("\n");
+	printf("Grupos %u, receptores por grupo %u, sesiones %u, ventana BSS %u ms, rafagas %u/%u ms, duracion %u s\n",
+		cfg.groups, cfg.radios, nsessions, cfg.bss_window_ms, cfg.burst_on_ms, cfg.burst_period_ms, cfg.duration_s);
+	printf("CPU votador:            %.2f %% de un nucleo, %.3f %% por sesion (simulador %.2f %%)\n",
+		100.0 * voter_cpu_us / wall_us, 100.0 * voter_cpu_us / wall_us / nsessions,
+		100.0 * (sim_cpu1 - sim_cpu0) / wall_us);
+	printf("Decision BSS:           %u rafagas, %u sin seleccionar la mejor. p50 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+		st.bursts, st.undecided, Percentile(st.decision_ms, 0.5), Percentile(st.decision_ms, 0.99), Percentile(st.decision_ms, 1.0));
+	printf("Primer audio multicast: p50 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+		Percentile(st.first_egress_ms, 0.5), Percentile(st.first_egress_ms, 0.99), Percentile(st.first_egress_ms, 1.0));
+	printf("Jitter multicast:       %u paquetes, medio %.2f ms, p99 %.1f ms, max %.2f ms\n",
+		st.egress_pkts, st.jitter_n ? st.jitter_sum_us / st.jitter_n / 1000.0 : 0.0, JitterPercentile(0.99), st.jitter_max_us / 1000.0);
+	printf("Memoria por grupo:      RSS %.1f KB, pools pjsua %.1f KB\n",
+		(double) (rss1 - rss0) / 1024.0 / cfg.groups, (double) (pool1 - pool0) / 1024.0 / cfg.groups);
+	printf("Threads:                %u sin sesiones, %u con %u sesiones. CPU por 100 sesiones %.2f %% de un nucleo\n",
+		threads0, threads1, nsessions, 100.0 * voter_cpu_us / wall_us / nsessions * 100);
+	printf("Sesiones caidas durante la prueba: %u\n", st.disconnected);
+	pj_mutex_unlock(st.mutex);
+
+	CORESIP_LogStats log;
+	if (CORESIP_GetLogStats(&log, &err) == 0)
+	{
+		printf("Log:                    %u mensajes escritos, %u descartados, %u suprimidos por repetidos\n",
+			log.Written, log.Dropped, log.Suppressed);
+	}
+
+	int ret = 0;
+	if (cfg.ptt > 0)
+	{
+		printf("\n");
+		ret = RunPtt(calls);
+	}
+
+	if (cfg.fd_threads > 0)
+	{
+		printf("\n");
+		if (RunFdContention(calls) != 0) ret = 1;
+	}
+
+	/**
+	 * Fin
+	 */
+	for (unsigned i = 0; i < calls.size(); i++)
+	{
+		CORESIP_CallHangup(calls[i], 0, &err);
+	}
+	pj_thread_sleep(1000);
+
+	delete sim;
+	pj_mutex_destroy(st.mutex);
+	pj_pool_release(pool);
+
+	return ret;
+}
+
+/*@}*/
@@ -0,0 +1,476 @@
+/**
+ * @file LoadTest.cpp
+ * @brief Prueba de carga del votador de CORESIP sin tarjetas de sonido
+ *
+ *	Arranca CORESIP con el dispositivo de sonido nulo y ejecuta una de las pruebas. Cada modo esta en su fichero y
+ *	comparte con este los parametros, las medidas y los callbacks de CORESIP que declara LoadTest.h:
+ *	- GroupsTest.cpp: por defecto, sesiones de radio Rx con RadioSim. Al final, PttTest.cpp con --ptt y FdTest.cpp
+ *	  con --fd-threads.
+ *	- SubsTest.cpp (--subs), OptionsTest.cpp (--options), RemoteAudioTest.cpp (--remote-audio), WavTest.cpp (--wav),
+ *	  McastTest.cpp (--mcast), LogTest.cpp (--log-threads), AudioRingTest.cpp (--audio-ring),
+ *	  RecorderTest.cpp (--recorder), DspTest.cpp (--dsp) y DecodeTest.cpp (--decode): no abren sesiones de radio.
+ *
+ *	Uso: coresip-loadtest [--groups N] [--radios N] [--duration seg] ... (--help)
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Parametros de la prueba.
+ */
+LoadTestConfig cfg = { 8, 4, 20, 200, 1000, 3000, 15060, 20000, 16060, 17000, 2, 1, 0, 0, 16260, 0, 16360, 0, 16460, 0, 0, 100, 0, 16560, 0, 0, 0, 16660, 0,
+	NULL, 0, 0 };
+
+/**
+ * Medidas de GroupsTest.cpp. Las actualizan los callbacks de CORESIP y los threads del simulador.
+ */
+LoadTestStats st;
+
+volatile pj_bool_t measuring = PJ_FALSE;
+volatile unsigned options_ok = 0;	//Respuestas 200 a los OPTIONS del votador. Solo las cuenta el thread de pjsip
+volatile unsigned sndrx_reports = 0;	//Llamadas a SndRxStatsCb
+volatile unsigned log_summaries = 0;	//Notificaciones de mensajes de log suprimidos
+volatile unsigned fin_wav = 0;		//Llamadas a FinWavCb
+
+/**
+ * OnCallState.	...
+ * Cuenta las sesiones establecidas y las que se caen.
+ */
+static void OnCallState(int call, CORESIP_CallInfo *info, CORESIP_CallStateInfo *stateInfo)
+{
+	pj_uint64_t now = RadioSim::NowUs();
+	unsigned idx = CALL_INDEX(call);
+	PJ_UNUSED_ARG(info);
+
+	pj_mutex_lock(st.mutex);
+	if (stateInfo->State == CORESIP_CALL_STATE_CONFIRMED)
+	{
+		st.confirmed++;
+		st.t_last_confirmed = now;
+		if (idx < st.t_confirmed.size() && st.t_confirmed[idx] == 0) st.t_confirmed[idx] = now;
+	}
+	else if (stateInfo->State == CORESIP_CALL_STATE_DISCONNECTED) st.disconnected++;
+	pj_mutex_unlock(st.mutex);
+}
+
+
+/**
+ * OnRdInfo.	...
+ * Decision BSS. Se mide cuando se indica seleccionada la sesion con mayor qidx de la rafaga.
+ */
+static void OnRdInfo(int call, CORESIP_RdInfo *info)
+{
+	pj_uint64_t now = RadioSim::NowUs();
+	unsigned idx = CALL_INDEX(call);
+
+	if (!info->rx_selected || !info->Squelch) return;
+
+	pj_mutex_lock(st.mutex);
+	if (idx < st.call_group.size() && st.call_group[idx] >= 0)
+	{
+		int g = st.call_group[idx];
+		if (!st.decided[g] && st.t_squ_on[g] != 0 && st.best_sess[g] == st.call_sess[idx])
+		{
+			st.decided[g] = PJ_TRUE;
+			if (measuring) st.decision_ms.push_back((now - st.t_squ_on[g]) / 1000.0);
+		}
+	}
+	pj_mutex_unlock(st.mutex);
+}
+
+
+/**
+ * OnOptionsReceive.	...
+ * Respuesta a un OPTIONS enviado por el votador.
+ */
+static void OnOptionsReceive(const char *fromUri, const char *callid, const int statusCode, const char *supported, const char *allow)
+{
+	PJ_UNUSED_ARG(fromUri);
+	PJ_UNUSED_ARG(callid);
+	PJ_UNUSED_ARG(supported);
+	PJ_UNUSED_ARG(allow);
+	if (statusCode == 200) options_ok++;
+}
+
+
+/**
+ * OnLog.	...
+ */
+static void OnLog(int level, const char *data, int len)
+{
+	PJ_UNUSED_ARG(level);
+	if (strstr(data, "parecidos suprimidos") != NULL) log_summaries++;
+	fwrite(data, 1, len, stderr);
+}
+
+
+/**
+ * OnSndRxStats.	...
+ * Cuenta los informes periodicos de audio remoto (SndRxStatsPeriod en coresip.ini).
+ */
+static void OnSndRxStats(int sndRxPort, const char *id, const CORESIP_SndRxStats *stats)
+{
+	PJ_UNUSED_ARG(sndRxPort);
+	PJ_UNUSED_ARG(id);
+	PJ_UNUSED_ARG(stats);
+	sndrx_reports++;
+}
+
+
+/**
+ * OnFinWav.	...
+ * Fin de un reproductor wav sin bucle.
+ */
+static void OnFinWav(int code)
+{
+	PJ_UNUSED_ARG(code);
+	fin_wav++;
+}
+
+
+/**
+ * ProcessCpuUs.	...
+ * @return	CPU (usuario + sistema) consumida por el proceso, en microsegundos.
+ */
+pj_uint64_t ProcessCpuUs()
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return (pj_uint64_t) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+
+/**
+ * RssBytes.	...
+ * @return	Memoria residente del proceso.
+ */
+pj_uint64_t RssBytes()
+{
+	unsigned long size = 0, resident = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f != NULL)
+	{
+		if (fscanf(f, "%lu %lu", &size, &resident) != 2) resident = 0;
+		fclose(f);
+	}
+	return (pj_uint64_t) resident * sysconf(_SC_PAGESIZE);
+}
+
+
+/**
+ * ThreadCount.	...
+ * @return	Threads del proceso.
+ */
+unsigned ThreadCount()
+{
+	unsigned threads = 0;
+	char line[128];
+	FILE *f = fopen("/proc/self/status", "r");
+	if (f != NULL)
+	{
+		while (fgets(line, sizeof(line), f) != NULL)
+		{
+			if (sscanf(line, "Threads: %u", &threads) == 1) break;
+		}
+		fclose(f);
+	}
+	return threads;
+}
+
+
+/**
+ * Percentile.	...
+ */
+double Percentile(std::vector<double> &v, double p)
+{
+	if (v.empty()) return 0;
+	std::sort(v.begin(), v.end());
+	size_t i = (size_t) (p * (v.size() - 1) + 0.5);
+	return v[i];
+}
+
+
+/**
+ * Usage.	...
+ */
+static void Usage()
+{
+	puts("Uso: coresip-loadtest [opciones]\n"
+		"  --groups N          Grupos (frecuencias) climax (8)\n"
+		"  --radios N          Receptores por grupo (4)\n"
+		"  --duration SEG      Duracion de la medida (20)\n"
+		"  --window MS         Ventana de decision BSS (200)\n"
+		"  --burst-on MS       Duracion de cada rafaga de squelch (1000)\n"
+		"  --burst-period MS   Periodo de las rafagas de cada grupo (3000)\n"
+		"  --sip-port P        Puerto SIP del votador (15060). Los RTP empiezan en --rtp-port (20000)\n"
+		"  --radio-port P      Puerto SIP de las radios (16060). El RTP es el siguiente par\n"
+		"  --egress-port P     Puerto del audio multicast del primer grupo (17000)\n"
+		"  --cld SEG           Supervision CLD (RMM/MAM). 0 la desactiva (2)\n"
+		"  --log-level N       Nivel de log de CORESIP (1)\n"
+		"  --rx-batch 0|1      Lectura del RTP en bloques con recvmmsg (0)\n"
+		"  --subs N            Solo mide una rafaga de N subscripciones al evento de dialogo (0)\n"
+		"  --subs-port P       Puerto SIP de los usuarios que se subscriben (16260)\n"
+		"  --options N         Solo mide N OPTIONS recibidos y N enviados por el votador (0)\n"
+		"  --options-port P    Puerto SIP de los equipos que intercambian OPTIONS con el votador (16360)\n"
+		"  --remote-audio N    Solo mide el audio de N puestos remotos en cada formato (0)\n"
+		"  --remote-audio-port P  Puerto del audio de los puestos remotos (16460)\n"
+		"  --ptt N             Al final mide N activaciones y desactivaciones del PTT de cada sesion (0)\n"
+		"  --fd-threads N      Al final mide la contencion de FrecDesp con N threads consultando sesiones (0)\n"
+		"  --wav N             Solo mide N reproductores y N grabadores wav con un disco lento (0)\n"
+		"  --wav-delay MS      Retardo de los accesos lentos al fichero (100)\n"
+		"  --mcast N           Solo comprueba la recepcion multicast de N puertos radio en el mismo puerto (0)\n"
+		"  --mcast-port P      Puerto UDP de los grupos multicast de --mcast (16560)\n"
+		"  --log-threads N     Solo comprueba el log asincrono con N threads que escriben y terminan (0)\n"
+		"  --audio-ring N      Solo comprueba AudioRing y le pasa N tramas entre dos threads (0)\n"
+		"  --recorder N        Solo comprueba los comandos al grabador con el squelch de N frecuencias, hasta 64 (0)\n"
+		"  --recorder-port P   Puerto UDP del grabador simulado de --recorder (16660)\n"
+		"  --dsp N             Solo compara qidx.c con processor.c y mide la CPU del Qidx de N sesiones (0)\n"
+		"  --dsp-wav FICHERO   Anade a --dsp un wav de 8 kHz, mono y 16 bits\n"
+		"  --decode N          Solo mide el coste del codec al decodificar N frames G.711 de radio una y dos veces (0)");
+}
+
+/**
+ * ParseArgs.	...
+ */
+static int ParseArgs(int argc, char *argv[])
+{
+	enum { OPT_GROUPS = 1, OPT_RADIOS, OPT_DURATION, OPT_WINDOW, OPT_BURST_ON, OPT_BURST_PERIOD, OPT_SIP_PORT,
+		OPT_RTP_PORT, OPT_RADIO_PORT, OPT_EGRESS_PORT, OPT_CLD, OPT_LOG_LEVEL, OPT_RX_BATCH, OPT_SUBS, OPT_SUBS_PORT,
+		OPT_OPTIONS, OPT_OPTIONS_PORT, OPT_REMOTE_AUDIO, OPT_REMOTE_AUDIO_PORT, OPT_PTT, OPT_WAV, OPT_WAV_DELAY, OPT_MCAST,
+		OPT_MCAST_PORT, OPT_LOG_THREADS, OPT_AUDIO_RING, OPT_RECORDER, OPT_RECORDER_PORT, OPT_DSP, OPT_DSP_WAV, OPT_FD_THREADS, OPT_DECODE, OPT_HELP };
+	struct pj_getopt_option long_options[] = {
+		{ "groups",			1, 0, OPT_GROUPS },
+		{ "radios",			1, 0, OPT_RADIOS },
+		{ "duration",		1, 0, OPT_DURATION },
+		{ "window",			1, 0, OPT_WINDOW },
+		{ "burst-on",		1, 0, OPT_BURST_ON },
+		{ "burst-period",	1, 0, OPT_BURST_PERIOD },
+		{ "sip-port",		1, 0, OPT_SIP_PORT },
+		{ "rtp-port",		1, 0, OPT_RTP_PORT },
+		{ "radio-port",		1, 0, OPT_RADIO_PORT },
+		{ "egress-port",	1, 0, OPT_EGRESS_PORT },
+		{ "cld",			1, 0, OPT_CLD },
+		{ "log-level",		1, 0, OPT_LOG_LEVEL },
+		{ "rx-batch",		1, 0, OPT_RX_BATCH },
+		{ "subs",			1, 0, OPT_SUBS },
+		{ "subs-port",		1, 0, OPT_SUBS_PORT },
+		{ "options",		1, 0, OPT_OPTIONS },
+		{ "options-port",	1, 0, OPT_OPTIONS_PORT },
+		{ "remote-audio",	1, 0, OPT_REMOTE_AUDIO },
+		{ "remote-audio-port",	1, 0, OPT_REMOTE_AUDIO_PORT },
+		{ "ptt",			1, 0, OPT_PTT },
+		{ "wav",			1, 0, OPT_WAV },
+		{ "wav-delay",		1, 0, OPT_WAV_DELAY },
+		{ "mcast",			1, 0, OPT_MCAST },
+		{ "mcast-port",		1, 0, OPT_MCAST_PORT },
+		{ "log-threads",	1, 0, OPT_LOG_THREADS },
+		{ "audio-ring",		1, 0, OPT_AUDIO_RING },
+		{ "recorder",		1, 0, OPT_RECORDER },
+		{ "recorder-port",	1, 0, OPT_RECORDER_PORT },
+		{ "dsp",			1, 0, OPT_DSP },
+		{ "dsp-wav",		1, 0, OPT_DSP_WAV },
+		{ "fd-threads",		1, 0, OPT_FD_THREADS },
+		{ "decode",			1, 0, OPT_DECODE },
+		{ "help",			0, 0, OPT_HELP },
+		{ NULL, 0, 0, 0 }
+	};
+	int c, option_index;
+
+	pj_optind = 0;
+	while ((c = pj_getopt_long(argc, argv, "", long_options, &option_index)) != -1)
+	{
+		unsigned v = pj_optarg ? (unsigned) atoi(pj_optarg) : 0;
+		switch (c)
+		{
+		case OPT_GROUPS:		cfg.groups = v; break;
+		case OPT_RADIOS:		cfg.radios = v; break;
+		case OPT_DURATION:		cfg.duration_s = v; break;
+		case OPT_WINDOW:		cfg.bss_window_ms = v; break;
+		case OPT_BURST_ON:		cfg.burst_on_ms = v; break;
+		case OPT_BURST_PERIOD:	cfg.burst_period_ms = v; break;
+		case OPT_SIP_PORT:		cfg.voter_sip_port = v; break;
+		case OPT_RTP_PORT:		cfg.voter_rtp_port = v; break;
+		case OPT_RADIO_PORT:	cfg.radio_sip_port = v; break;
+		case OPT_EGRESS_PORT:	cfg.egress_port = v; break;
+		case OPT_CLD:			cfg.cld_supervision_s = v; break;
+		case OPT_LOG_LEVEL:		cfg.log_level = v; break;
+		case OPT_RX_BATCH:		cfg.rtp_rx_batch = v; break;
+		case OPT_SUBS:			cfg.subs = v; break;
+		case OPT_SUBS_PORT:		cfg.subs_port = v; break;
+		case OPT_OPTIONS:		cfg.options = v; break;
+		case OPT_OPTIONS_PORT:	cfg.options_port = v; break;
+		case OPT_REMOTE_AUDIO:	cfg.remote_audio = v; break;
+		case OPT_REMOTE_AUDIO_PORT:	cfg.remote_audio_port = v; break;
+		case OPT_PTT:			cfg.ptt = v; break;
+		case OPT_WAV:			cfg.wav = v; break;
+		case OPT_WAV_DELAY:		cfg.wav_delay_ms = v; break;
+		case OPT_MCAST:			cfg.mcast = v; break;
+		case OPT_MCAST_PORT:	cfg.mcast_port = v; break;
+		case OPT_LOG_THREADS:	cfg.log_threads = v; break;
+		case OPT_AUDIO_RING:	cfg.audio_ring = v; break;
+		case OPT_RECORDER:		cfg.recorder = v; break;
+		case OPT_RECORDER_PORT:	cfg.recorder_port = v; break;
+		case OPT_DSP:			cfg.dsp = v; break;
+		case OPT_DSP_WAV:		cfg.dsp_wav = pj_optarg; break;
+		case OPT_FD_THREADS:	cfg.fd_threads = v; break;
+		case OPT_DECODE:		cfg.decode = v; break;
+		default:
+			Usage();
+			return -1;
+		}
+	}
+
+	if (cfg.groups == 0 || cfg.radios == 0 || cfg.burst_period_ms <= cfg.burst_on_ms)
+	{
+		Usage();
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	CORESIP_Error err;
+	CORESIP_Config ccfg;
+	int accId = -1;
+
+	if (ParseArgs(argc, argv) != 0) return 1;
+
+	unsigned nsessions = cfg.groups * cfg.radios;
+
+	/**
+	 * Votador: sin tarjetas de sonido. El mezclador lo temporiza el dispositivo nulo.
+	 */
+	pj_bzero(&ccfg, sizeof(ccfg));
+	pj_ansi_strcpy(ccfg.HostId, "LoadTest");
+	pj_ansi_strcpy(ccfg.IpAddress, "127.0.0.1");
+	ccfg.Port = cfg.voter_sip_port;
+	ccfg.RtpPorts = cfg.voter_rtp_port;
+	ccfg.Cb.LogCb = OnLog;
+	ccfg.Cb.RdInfoCb = OnRdInfo;
+	ccfg.Cb.CallStateCb = OnCallState;
+	ccfg.Cb.OptionsReceiveCb = OnOptionsReceive;
+	ccfg.SndRxStatsCb = OnSndRxStats;
+	ccfg.Cb.FinWavCb = OnFinWav;
+	pj_ansi_strcpy(ccfg.DefaultCodec, "PCMA");
+	ccfg.DefaultDelayBufPframes = 3;
+	ccfg.DefaultJBufPframes = 4;
+	ccfg.SndSamplingRate = 8000;
+	ccfg.RxLevel = 1;
+	ccfg.TxLevel = 1;
+	ccfg.LogLevel = cfg.log_level;
+	ccfg.TsxTout = 400;
+	ccfg.InvProceedingIaTout = 1000;
+	ccfg.InvProceedingMonitoringTout = 30000;
+	ccfg.InvProceedingDiaTout = 30000;
+	ccfg.InvProceedingRdTout = 1000;
+	ccfg.EchoTail = 100;
+	ccfg.max_calls = nsessions + 4;
+	ccfg.RtpRxBatch = cfg.rtp_rx_batch;
+
+	if (CORESIP_Init(&ccfg, &err) != 0 || CORESIP_Start(&err) != 0)
+	{
+		fprintf(stderr, "ERROR arrancando CORESIP: %s\n", err.Info);
+		return 1;
+	}
+
+	char acc[64];
+	pj_ansi_snprintf(acc, sizeof(acc), "sip:LoadTest@127.0.0.1:%u", cfg.voter_sip_port);
+	if (CORESIP_CreateAccount(acc, 1, &accId, &err) != 0)
+	{
+		fprintf(stderr, "ERROR creando la cuenta: %s\n", err.Info);
+		CORESIP_End();
+		return 1;
+	}
+
+	if (cfg.subs > 0)
+	{
+		int ret = RunSubsBurst();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.options > 0)
+	{
+		int ret = RunOptions();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.remote_audio > 0)
+	{
+		int ret = RunRemoteAudio();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.wav > 0)
+	{
+		int ret = RunWav();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.mcast > 0)
+	{
+		int ret = RunMcast();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.log_threads > 0)
+	{
+		int ret = RunLogThreads();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.audio_ring > 0)
+	{
+		int ret = RunAudioRing();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.recorder > 0)
+	{
+		int ret = RunRecorder();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.dsp > 0)
+	{
+		int ret = RunDsp();
+		CORESIP_End();
+		return ret;
+	}
+
+	if (cfg.decode > 0)
+	{
+		int ret = RunDecode();
+		CORESIP_End();
+		return ret;
+	}
+
+	int ret = RunGroups(accId);
+	CORESIP_End();
+
+	return ret;
+}
+
+/*@}*/
@@ -0,0 +1,137 @@
+/**
+ * @file LoadTest.h
+ * @brief Prueba de carga del votador de CORESIP sin tarjetas de sonido
+ *
+ *	Parametros, medidas y utilidades que comparten LoadTest.cpp y las pruebas de cada modo (GroupsTest.cpp,
+ *	SubsTest.cpp, ...).
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_LOADTEST_H__
+#define __CORESIP_LOADTEST_H__
+
+#include <pjlib.h>
+#include <vector>
+#include <string>
+
+#define JITTER_BINS			1000		//Histograma del jitter en pasos de 100us
+
+#define CALL_INDEX(call)	((call) & 0xFFFF)	//Indice de pjsua de la llamada
+
+/**
+ * Parametros de la prueba.
+ */
+struct LoadTestConfig
+{
+	unsigned groups;
+	unsigned radios;
+	unsigned duration_s;
+	unsigned bss_window_ms;
+	unsigned burst_on_ms;
+	unsigned burst_period_ms;
+	unsigned voter_sip_port;
+	unsigned voter_rtp_port;
+	unsigned radio_sip_port;
+	unsigned egress_port;
+	unsigned cld_supervision_s;
+	unsigned log_level;
+	unsigned rtp_rx_batch;
+	unsigned subs;
+	unsigned subs_port;
+	unsigned options;
+	unsigned options_port;
+	unsigned remote_audio;
+	unsigned remote_audio_port;
+	unsigned ptt;
+	unsigned wav;
+	unsigned wav_delay_ms;
+	unsigned mcast;
+	unsigned mcast_port;
+	unsigned log_threads;
+	unsigned audio_ring;
+	unsigned recorder;
+	unsigned recorder_port;
+	unsigned dsp;
+	const char *dsp_wav;
+	unsigned fd_threads;
+	unsigned decode;
+};
+
+/**
+ * Medidas. Las actualizan los callbacks de CORESIP y los threads del simulador.
+ */
+struct LoadTestStats
+{
+	pj_mutex_t *mutex;
+
+	std::vector<int> call_group;		//Grupo y sesion de cada llamada, por indice de pjsua
+	std::vector<int> call_sess;
+	unsigned confirmed;
+	unsigned disconnected;
+
+	std::vector<pj_uint64_t> t_make;	//Instantes de CORESIP_CallMake y de CONFIRMED de cada llamada, por indice de pjsua
+	std::vector<pj_uint64_t> t_confirmed;
+	pj_uint64_t t_last_confirmed;
+
+	std::vector<pj_uint64_t> t_squ_on;	//Rafaga en curso de cada grupo
+	std::vector<int> best_sess;
+	std::vector<pj_bool_t> decided;
+
+	unsigned bursts;
+	unsigned undecided;					//Rafagas en las que no se selecciono la mejor sesion
+	std::vector<double> decision_ms;
+	std::vector<double> first_egress_ms;
+
+	unsigned egress_pkts;
+	unsigned jitter_n;
+	double jitter_sum_us;
+	double jitter_max_us;
+	unsigned jitter_hist[JITTER_BINS + 1];
+
+	std::vector<unsigned> radio_ptt;	//Tipo de PTT que recibe cada radio y cuando ha cambiado, por indice de radio
+	std::vector<pj_uint64_t> t_radio_ptt;
+};
+
+extern LoadTestConfig cfg;
+extern LoadTestStats st;
+
+extern volatile pj_bool_t measuring;
+extern volatile unsigned options_ok;		//Respuestas 200 a los OPTIONS del votador. Solo las cuenta el thread de pjsip
+extern volatile unsigned sndrx_reports;		//Llamadas a SndRxStatsCb
+extern volatile unsigned log_summaries;		//Notificaciones de mensajes de log suprimidos
+extern volatile unsigned fin_wav;			//Llamadas a FinWavCb
+
+/**
+ * Senal de --dsp.
+ */
+struct DspInput
+{
+	std::string name;
+	std::vector<float> samples;
+};
+
+pj_uint64_t ProcessCpuUs();
+pj_uint64_t RssBytes();
+unsigned ThreadCount();
+double Percentile(std::vector<double> &v, double p);
+void MakeVoice(DspInput &in, double f0, double snr_db, pj_uint32_t seed);
+
+int RunGroups(int accId);
+int RunPtt(const std::vector<int> &calls);
+int RunFdContention(const std::vector<int> &calls);
+int RunSubsBurst();
+int RunOptions();
+int RunRemoteAudio();
+int RunWav();
+int RunMcast();
+int RunLogThreads();
+int RunAudioRing();
+int RunRecorder();
+int RunDsp();
+int RunDecode();
+
+#endif
+
+/*@}*/
@@ -0,0 +1,86 @@
+/**
+ * @file LogTest.cpp
+ * @brief Prueba de CORESIP: log asincrono desde threads que terminan (--log-threads)
+ *
+ *	Con --log-threads N no abre sesiones: N threads, uno tras otro, escriben en el log mensajes parecidos y
+ *	terminan. Comprueba que todos usan el log asincrono, mas de los buffers que admite, y que se notifican los
+ *	suprimidos de cada uno aunque ya no exista.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+
+#define THIS_FILE			"LogTest.cpp"
+#define LOG_MESSAGES		50			//Mensajes parecidos de cada thread de --log-threads. Se suprimen los que pasan
+#define LOG_REPEAT_MAX		10			//de LogRepeatMax, 10 por defecto
+#define LOG_TIMEOUT_US		5000000		//Espera maxima a las notificaciones de suprimidos
+
+/**
+ * LogThread.	...
+ * Thread de --log-threads. Escribe LOG_MESSAGES mensajes parecidos y termina.
+ */
+static int LogThread(void *arg)
+{
+	for (unsigned i = 0; i < LOG_MESSAGES; i++)
+	{
+		PJ_LOG(1,(THIS_FILE, "LogThread %u mensaje %u", (unsigned) (pj_ssize_t) arg, i));
+	}
+	return 0;
+}
+
+/**
+ * RunLogThreads.	...
+ * Log asincrono con threads que terminan. Con cfg.log_threads mayor que el numero de buffers de AsyncLog, si los
+ * de los threads terminados no se reutilizaran los ultimos escribirian directamente y no se suprimiria nada.
+ * @return	0 si se han suprimido los mensajes de todos los threads y se ha notificado cada supresion.
+ */
+int RunLogThreads()
+{
+	CORESIP_LogStats s0, s1;
+	CORESIP_Error err;
+
+	pj_pool_t *pool = pjsua_pool_create("LogThreads", 512, 512);
+	CORESIP_GetLogStats(&s0, &err);
+	unsigned summaries0 = log_summaries;
+
+	pj_uint64_t t0 = RadioSim::NowUs();
+	for (unsigned i = 0; i < cfg.log_threads; i++)
+	{
+		pj_thread_t *th;
+		if (pj_thread_create(pool, "LogThread", &LogThread, (void *) (pj_ssize_t) i, 0, 0, &th) != PJ_SUCCESS)
+		{
+			fprintf(stderr, "ERROR creando el thread de log %u\n", i);
+			pj_pool_release(pool);
+			return 1;
+		}
+		pj_thread_join(th);
+		pj_thread_destroy(th);
+
+		//Todos reutilizan el mismo buffer: se da tiempo al thread de escritura para que no se llene
+		pj_thread_sleep(2);
+	}
+	double threads_ms = (RadioSim::NowUs() - t0) / 1000.0;
+
+	//Los suprimidos los notifica el thread de escritura, al acabar el segundo de cada thread
+	t0 = RadioSim::NowUs();
+	while (log_summaries - summaries0 < cfg.log_threads && RadioSim::NowUs() - t0 < LOG_TIMEOUT_US) pj_thread_sleep(50);
+	CORESIP_GetLogStats(&s1, &err);
+	pj_pool_release(pool);
+
+	unsigned suppressed = s1.Suppressed - s0.Suppressed;
+	unsigned summaries = log_summaries - summaries0;
+	printf("Log de %u threads en %.1f ms: %u mensajes suprimidos de %u esperados, %u notificaciones de %u, descartados %u\n",
+		cfg.log_threads, threads_ms, suppressed, cfg.log_threads * (LOG_MESSAGES - LOG_REPEAT_MAX), summaries,
+		cfg.log_threads, s1.Dropped - s0.Dropped);
+	return (suppressed == cfg.log_threads * (LOG_MESSAGES - LOG_REPEAT_MAX) && summaries == cfg.log_threads) ? 0 : 1;
+}
+
+/*@}*/
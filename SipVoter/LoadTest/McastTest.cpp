@@ -0,0 +1,165 @@
+/**
+ * @file McastTest.cpp
+ * @brief Prueba de CORESIP: recepcion multicast de los puertos radio (--mcast)
+ *
+ *	Con --mcast N no abre sesiones: crea N puertos de recepcion radio, cada uno en su grupo multicast y todos
+ *	en el mismo puerto UDP (con mas de 20 se comparte el puerto entre varios sockets de McastReceiver), y un
+ *	socket ajeno en el mismo puerto con otro grupo. Comprueba que cada socket solo recibe sus grupos.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "Global.h"
+#include "SipAgent.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define MCAST_GROUP			"239.255.18.%u"	//Grupos de los puertos de recepcion radio. El ajeno es el 250
+#define MCAST_FOREIGN		250
+#define MCAST_ROUNDS		16			//Paquetes por grupo. Caben en la cola del RdRxPort, que nadie vacia
+
+/**
+ * McastSocket.	...
+ * Socket UDP en todas las direcciones y el puerto cfg.mcast_port, que envia y recibe multicast por 127.0.0.1.
+ * @param	group	Grupo al que se une, o 0 si solo envia.
+ */
+static pj_sock_t McastSocket(pj_uint32_t group)
+{
+	pj_sock_t s;
+	pj_sockaddr_in addr;
+	pj_in_addr local;
+	pj_str_t host;
+
+	if (pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &s) != PJ_SUCCESS) return PJ_INVALID_SOCKET;
+
+	local = pj_inet_addr(pj_cstr(&host, "127.0.0.1"));
+	pj_sock_setsockopt(s, pj_SOL_IP(), pj_IP_MULTICAST_IF(), &local, sizeof(local));
+	if (group != 0)
+	{
+		int on = 1, bufsize = 1024 * 1024;
+		pj_ip_mreq mreq;
+		mreq.imr_multiaddr.s_addr = group;
+		mreq.imr_interface = local;
+
+		pj_sock_setsockopt(s, pj_SOL_SOCKET(), pj_SO_REUSEADDR(), &on, sizeof(on));
+		pj_sock_setsockopt(s, pj_SOL_SOCKET(), pj_SO_RCVBUF(), &bufsize, sizeof(bufsize));
+		pj_sockaddr_in_init(&addr, NULL, (pj_uint16_t) cfg.mcast_port);
+		if (pj_sock_bind(s, &addr, sizeof(addr)) != PJ_SUCCESS ||
+			pj_sock_setsockopt(s, pj_SOL_IP(), pj_IP_ADD_MEMBERSHIP(), &mreq, sizeof(mreq)) != PJ_SUCCESS)
+		{
+			pj_sock_close(s);
+			return PJ_INVALID_SOCKET;
+		}
+	}
+	return s;
+}
+
+/**
+ * RunMcast.	...
+ * Recepcion multicast radio. Crea cfg.mcast puertos RdRxPort en grupos distintos del mismo puerto UDP y un socket
+ * ajeno en ese puerto con el grupo MCAST_FOREIGN, y envia MCAST_ROUNDS paquetes a cada grupo.
+ * @return	0 si McastReceiver lee exactamente los paquetes de sus grupos, una vez, y el socket ajeno recibe los del suyo.
+ *			El ajeno es un socket normal: recibe tambien los grupos de McastReceiver (IP_MULTICAST_ALL).
+ */
+int RunMcast()
+{
+	CORESIP_RdRxPortInfo info;
+	CORESIP_Error err;
+	char ip[32];
+	int ret = 0;
+
+	pj_bzero(&info, sizeof(info));
+	info.ClkRate = 8000;
+	info.ChannelCount = 1;
+	info.BitsPerSample = 16;
+	info.FrameTime = PTIME;
+	info.Port = cfg.mcast_port;
+
+	std::vector<int> ports(cfg.mcast, -1);
+	for (unsigned i = 0; i < cfg.mcast; i++)
+	{
+		pj_ansi_snprintf(info.Ip, sizeof(info.Ip), MCAST_GROUP, i + 1);
+		if (CORESIP_CreateRdRxPort(&info, "127.0.0.1", &ports[i], &err) != 0)
+		{
+			fprintf(stderr, "ERROR creando el puerto de recepcion radio %s: %s\n", info.Ip, err.Info);
+			ret = 1;
+			break;
+		}
+	}
+
+	pj_str_t host;
+	pj_ansi_snprintf(ip, sizeof(ip), MCAST_GROUP, MCAST_FOREIGN);
+	pj_sock_t foreign = McastSocket(pj_inet_addr(pj_cstr(&host, ip)).s_addr);
+	pj_sock_t tx = McastSocket(0);
+	if (foreign == PJ_INVALID_SOCKET || tx == PJ_INVALID_SOCKET)
+	{
+		fprintf(stderr, "ERROR abriendo los sockets multicast del puerto %u\n", cfg.mcast_port);
+		ret = 1;
+	}
+
+	unsigned received0, unmatched0, received1, unmatched1;
+	SipAgent::_McastReceiver->GetStats(&received0, &unmatched0);
+
+	std::vector<char> pkt(info.FrameTime * info.ClkRate * info.BitsPerSample / 8 / 1000 + sizeof(unsigned), 0);
+	unsigned sent = 0;
+	for (unsigned r = 0; ret == 0 && r < MCAST_ROUNDS; r++)
+	{
+		for (unsigned i = 0; i <= cfg.mcast; i++)
+		{
+			pj_sockaddr_in to;
+			pj_ansi_snprintf(ip, sizeof(ip), MCAST_GROUP, i < cfg.mcast ? i + 1 : MCAST_FOREIGN);
+			pj_sockaddr_in_init(&to, pj_cstr(&host, ip), (pj_uint16_t) cfg.mcast_port);
+			pj_memcpy(&pkt[pkt.size() - sizeof(unsigned)], &r, sizeof(unsigned));
+			pkt[0] = (char) (i < cfg.mcast ? 0 : MCAST_FOREIGN);
+
+			pj_ssize_t len = (pj_ssize_t) pkt.size();
+			if (pj_sock_sendto(tx, &pkt[0], &len, 0, &to, sizeof(to)) == PJ_SUCCESS && i < cfg.mcast) sent++;
+		}
+		pj_thread_sleep(1);
+	}
+	pj_thread_sleep(200);
+
+	SipAgent::_McastReceiver->GetStats(&received1, &unmatched1);
+
+	unsigned own = 0, others = 0;
+	while (ret == 0)
+	{
+		pj_fd_set_t rset;
+		pj_time_val tout = { 0, 0 };
+		PJ_FD_ZERO(&rset);
+		PJ_FD_SET(foreign, &rset);
+		if (pj_sock_select((int) foreign + 1, &rset, NULL, NULL, &tout) <= 0) break;
+
+		//El grupo de destino no llega con recv: los paquetes del ajeno llevan su grupo en el primer byte
+		char buf[1500];
+		pj_ssize_t len = sizeof(buf);
+		if (pj_sock_recv(foreign, buf, &len, 0) != PJ_SUCCESS) break;
+		if (len > 0 && buf[0] == (char) MCAST_FOREIGN) own++;
+		else others++;
+	}
+
+	printf("Recepcion multicast de %u puertos en el puerto %u: enviados %u, leidos %u, de otros grupos %u. "
+		"Socket ajeno: %u de su grupo, %u de otros\n", cfg.mcast, cfg.mcast_port, sent, received1 - received0,
+		unmatched1 - unmatched0, own, others);
+	if (ret == 0 && (received1 - received0 != sent || unmatched1 != unmatched0 || own != MCAST_ROUNDS))
+	{
+		ret = 1;
+	}
+
+	if (tx != PJ_INVALID_SOCKET) pj_sock_close(tx);
+	if (foreign != PJ_INVALID_SOCKET) pj_sock_close(foreign);
+	for (unsigned i = 0; i < cfg.mcast; i++)
+	{
+		if (ports[i] >= 0) CORESIP_DestroyRdRxPort(ports[i], &err);
+	}
+	return ret;
+}
+
+/*@}*/
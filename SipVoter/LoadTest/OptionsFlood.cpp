@@ -0,0 +1,286 @@
+/**
+ * @file OptionsFlood.cpp
+ * @brief Trafico de OPTIONS de supervision para las pruebas de carga de CORESIP
+ *
+ *	Implementa la clase 'OptionsFlood'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "RadioSim.h"
+#include "OptionsFlood.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define THIS_FILE			"OptionsFlood.cpp"
+
+#define MAX_SIP_MSG			4000
+#define ROUND_TIMEOUT_US	30000000		//Se abandona la ronda si no se han contestado todos en este tiempo
+
+/**
+ * OptionsFlood.	...
+ * Constructor. El socket y el thread de recepcion se abren con Start().
+ * @param	n			OPTIONS por ronda.
+ * @param	port		Puerto SIP de los equipos simulados.
+ * @param	voter_port	Puerto SIP del votador.
+ * @param	window		Maximo de OPTIONS enviados sin respuesta.
+ */
+OptionsFlood::OptionsFlood(unsigned n, unsigned port, unsigned voter_port, unsigned window)
+{
+	_N = n;
+	_Port = port;
+	_VoterPort = voter_port;
+	_Window = window;
+	_Round = 0;
+	_RxThread = NULL;
+	_Run = PJ_FALSE;
+	_Answered = 0;
+	_Probes = 0;
+	_RxCpuUs = 0;
+	_Sock = PJ_INVALID_SOCKET;
+
+	_Pool = pjsua_pool_create("OptionsFlood", 1024, 1024);
+	pj_mutex_create_simple(_Pool, "OptionsFloodMtx", &_Mutex);
+	_TSent.assign(n, 0);
+	_TResp.assign(n, 0);
+}
+
+/**
+ * ~OptionsFlood.	...
+ * Destructor.
+ */
+OptionsFlood::~OptionsFlood()
+{
+	Stop();
+	pj_mutex_destroy(_Mutex);
+	pj_pool_release(_Pool);
+}
+
+/**
+ * Start.	...
+ * Abre el socket de los equipos y arranca el thread de recepcion.
+ */
+pj_status_t OptionsFlood::Start()
+{
+	pj_sockaddr_in addr;
+
+	pj_status_t st = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &_Sock);
+	if (st != PJ_SUCCESS) return st;
+
+	int bufsize = 4 * 1024 * 1024;
+	pj_sock_setsockopt(_Sock, pj_SOL_SOCKET(), pj_SO_RCVBUF(), &bufsize, sizeof(bufsize));
+
+	pj_str_t host;
+	pj_sockaddr_in_init(&addr, pj_cstr(&host, "127.0.0.1"), (pj_uint16_t) _Port);
+	st = pj_sock_bind(_Sock, &addr, sizeof(addr));
+	if (st != PJ_SUCCESS)
+	{
+		PJ_LOG(1,(THIS_FILE, "ERROR: no se puede abrir el puerto UDP %u", _Port));
+		pj_sock_close(_Sock);
+		_Sock = PJ_INVALID_SOCKET;
+		return st;
+	}
+
+	_Run = PJ_TRUE;
+	return pj_thread_create(_Pool, "OptionsFloodRx", &RxTh, this, 0, 0, &_RxThread);
+}
+
+/**
+ * Stop.	...
+ * Para el thread y cierra el socket.
+ */
+void OptionsFlood::Stop()
+{
+	if (_RxThread != NULL)
+	{
+		_Run = PJ_FALSE;
+		pj_thread_join(_RxThread);
+		pj_thread_destroy(_RxThread);
+		_RxThread = NULL;
+	}
+	if (_Sock != PJ_INVALID_SOCKET)
+	{
+		pj_sock_close(_Sock);
+		_Sock = PJ_INVALID_SOCKET;
+	}
+}
+
+/**
+ * Probes.	...
+ * @return	Numero de OPTIONS del votador contestados.
+ */
+unsigned OptionsFlood::Probes()
+{
+	return _Probes;
+}
+
+/**
+ * RxCpuUs.	...
+ * @return	CPU consumida por el thread de recepcion, para descontarla de la del proceso.
+ */
+pj_uint64_t OptionsFlood::RxCpuUs()
+{
+	return _RxCpuUs;
+}
+
+/**
+ * SendOptions.	...
+ * Envia el OPTIONS de la ronda en curso de un equipo.
+ */
+void OptionsFlood::SendOptions(unsigned i)
+{
+	char msg[MAX_SIP_MSG];
+	pj_sockaddr_in voter;
+
+	int n = pj_ansi_snprintf(msg, sizeof(msg),
+		"OPTIONS sip:LoadTest@127.0.0.1:%u SIP/2.0\r\n"
+		"Via: SIP/2.0/UDP 127.0.0.1:%u;rport;branch=z9hG4bK-of%u-%u\r\n"
+		"Max-Forwards: 70\r\n"
+		"From: <sip:opt-%u@127.0.0.1:%u>;tag=of%u-%u\r\n"
+		"To: <sip:LoadTest@127.0.0.1:%u>\r\n"
+		"Call-ID: of%u-%u@127.0.0.1\r\n"
+		"CSeq: 1 OPTIONS\r\n"
+		"WG67-Version: radio.01\r\n"
+		"Accept: application/sdp\r\n"
+		"Content-Length: 0\r\n"
+		"\r\n",
+		_VoterPort,
+		_Port, _Round, i,
+		i, _Port, _Round, i,
+		_VoterPort,
+		_Round, i);
+
+	pj_str_t host;
+	pj_sockaddr_in_init(&voter, pj_cstr(&host, "127.0.0.1"), (pj_uint16_t) _VoterPort);
+	pj_ssize_t size = n;
+	pj_sock_sendto(_Sock, msg, &size, 0, &voter, sizeof(voter));
+}
+
+/**
+ * Round.	...
+ * Envia _N OPTIONS, con como mucho _Window sin contestar, y espera las respuestas.
+ * @param	latency_ms	Tiempo hasta el 200 de cada OPTIONS contestado.
+ * @return	Duracion de la ronda en segundos.
+ */
+double OptionsFlood::Round(std::vector<double> &latency_ms)
+{
+	pj_mutex_lock(_Mutex);
+	_Round++;
+	_Answered = 0;
+	for (unsigned i = 0; i < _N; i++) _TSent[i] = _TResp[i] = 0;
+	pj_mutex_unlock(_Mutex);
+
+	pj_uint64_t t0 = RadioSim::NowUs();
+	for (unsigned i = 0; i < _N; i++)
+	{
+		while (i - _Answered >= _Window && RadioSim::NowUs() - t0 < ROUND_TIMEOUT_US) pj_thread_sleep(0);
+
+		pj_mutex_lock(_Mutex);
+		_TSent[i] = RadioSim::NowUs();
+		pj_mutex_unlock(_Mutex);
+		SendOptions(i);
+	}
+	while (_Answered < _N && RadioSim::NowUs() - t0 < ROUND_TIMEOUT_US) pj_thread_sleep(1);
+	pj_uint64_t t1 = RadioSim::NowUs();
+
+	pj_mutex_lock(_Mutex);
+	latency_ms.clear();
+	for (unsigned i = 0; i < _N; i++)
+	{
+		if (_TResp[i] != 0) latency_ms.push_back((_TResp[i] - _TSent[i]) / 1000.0);
+	}
+	pj_mutex_unlock(_Mutex);
+
+	return (t1 - t0) / 1e6;
+}
+
+/**
+ * OnSip.	...
+ * Respuestas a los OPTIONS de la ronda y OPTIONS del votador.
+ */
+void OptionsFlood::OnSip(char *msg, int len, const pj_sockaddr_in *from)
+{
+	char via[512], from_hdr[512], to[512], callid[256], cseq[64], resp[MAX_SIP_MSG];
+	unsigned round, i, code;
+
+	msg[len] = '\0';
+	if (!RadioSim::GetHeader(msg, "Call-ID", callid, sizeof(callid)) || !RadioSim::GetHeader(msg, "CSeq", cseq, sizeof(cseq)))
+	{
+		return;
+	}
+
+	if (sscanf(msg, "SIP/2.0 %u", &code) == 1)
+	{
+		if (code != 200 || sscanf(callid, "Call-ID: of%u-%u@", &round, &i) != 2) return;
+
+		pj_mutex_lock(_Mutex);
+		if (round == _Round && i < _N && _TResp[i] == 0)
+		{
+			_TResp[i] = RadioSim::NowUs();
+			_Answered++;
+		}
+		pj_mutex_unlock(_Mutex);
+		return;
+	}
+
+	if (strncmp(msg, "OPTIONS ", 8) != 0) return;
+	if (!RadioSim::GetHeader(msg, "Via", via, sizeof(via)) || !RadioSim::GetHeader(msg, "From", from_hdr, sizeof(from_hdr)) ||
+		!RadioSim::GetHeader(msg, "To", to, sizeof(to)))
+	{
+		return;
+	}
+
+	int n = pj_ansi_snprintf(resp, sizeof(resp),
+		"SIP/2.0 200 OK\r\n"
+		"%s;received=127.0.0.1\r\n"
+		"%s\r\n"
+		"%s;tag=lt\r\n"
+		"%s\r\n"
+		"%s\r\n"
+		"Allow: INVITE, ACK, CANCEL, BYE, OPTIONS\r\n"
+		"Content-Length: 0\r\n"
+		"\r\n",
+		via, from_hdr, to, callid, cseq);
+
+	pj_ssize_t size = n;
+	pj_sock_sendto(_Sock, resp, &size, 0, from, sizeof(*from));
+	_Probes++;
+}
+
+/**
+ * RxTh.	...
+ * Thread de recepcion.
+ */
+int OptionsFlood::RxTh(void *proc)
+{
+	OptionsFlood *wp = (OptionsFlood *) proc;
+	char buf[MAX_SIP_MSG + 1];
+	pj_uint64_t cpu0 = RadioSim::ThreadCpuUs();
+
+	while (wp->_Run)
+	{
+		pj_fd_set_t rset;
+		pj_time_val tv = {0, 50};
+
+		PJ_FD_ZERO(&rset);
+		PJ_FD_SET(wp->_Sock, &rset);
+		if (pj_sock_select(FD_SETSIZE, &rset, NULL, NULL, &tv) <= 0) continue;
+
+		pj_sockaddr_in from;
+		int fromlen = sizeof(from);
+		pj_ssize_t size = MAX_SIP_MSG;
+		if (pj_sock_recvfrom(wp->_Sock, buf, &size, 0, &from, &fromlen) == PJ_SUCCESS && size > 0)
+		{
+			wp->OnSip(buf, (int) size, &from);
+		}
+		wp->_RxCpuUs = RadioSim::ThreadCpuUs() - cpu0;
+	}
+
+	return 0;
+}
+
+/*@}*/
@@ -0,0 +1,64 @@
+/**
+ * @file OptionsFlood.h
+ * @brief Trafico de OPTIONS de supervision para las pruebas de carga de CORESIP
+ *
+ *	Implementa la clase 'OptionsFlood'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_OPTIONSFLOOD_H__
+#define __CORESIP_OPTIONSFLOOD_H__
+
+#include <pjlib.h>
+#include <vector>
+
+/**
+ * OptionsFlood.
+ * Simula los equipos que supervisan al votador y a los que supervisa el votador, todos desde un unico puerto UDP
+ * en 127.0.0.1:
+ * - Round() envia n OPTIONS al usuario del votador, con como mucho una ventana sin contestar, y mide el tiempo
+ *   hasta cada 200.
+ * - Contesta 200 a los OPTIONS que envia el votador (a cualquier usuario) y los cuenta.
+ */
+class OptionsFlood
+{
+public:
+	OptionsFlood(unsigned n, unsigned port, unsigned voter_port, unsigned window);
+	~OptionsFlood();
+
+	pj_status_t Start();
+	void Stop();
+
+	double Round(std::vector<double> &latency_ms);
+	unsigned Probes();
+	pj_uint64_t RxCpuUs();
+
+private:
+	unsigned _N;
+	unsigned _Port;
+	unsigned _VoterPort;
+	unsigned _Window;						//Maximo de OPTIONS sin respuesta
+	unsigned _Round;
+
+	pj_pool_t *_Pool;
+	pj_sock_t _Sock;
+	pj_thread_t *_RxThread;
+	volatile pj_bool_t _Run;
+
+	pj_mutex_t *_Mutex;
+	std::vector<pj_uint64_t> _TSent;		//Instante de envio de cada OPTIONS de la ronda en curso
+	std::vector<pj_uint64_t> _TResp;		//Instante del 200
+	volatile unsigned _Answered;
+	volatile unsigned _Probes;				//OPTIONS del votador contestados
+	volatile pj_uint64_t _RxCpuUs;
+
+	static int RxTh(void *proc);
+	void OnSip(char *msg, int len, const pj_sockaddr_in *from);
+	void SendOptions(unsigned i);
+};
+
+#endif
+
+/*@}*/
@@ -0,0 +1,114 @@
+/**
+ * @file OptionsTest.cpp
+ * @brief Prueba de carga de CORESIP: OPTIONS de supervision (--options)
+ *
+ *	Con --options N no abre sesiones: mide N OPTIONS al usuario del votador contestados por pjsua y por la
+ *	plantilla de OptionsFast, y N OPTIONS enviados por el votador uno a uno y con CORESIP_SendOptionsMsgList.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "OptionsFlood.h"
+#include "OptionsFast.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define OPTIONS_TIMEOUT_US	30000000	//Espera maxima a las respuestas a los OPTIONS del votador
+#define OPTIONS_WINDOW		256			//OPTIONS sin contestar, y destinos de cada lista del votador
+
+/**
+ * RunOptions.	...
+ * OPTIONS de supervision. Primero cfg.options OPTIONS al usuario del votador, contestados por mod-pjsua-options y
+ * por la plantilla de OptionsFast. Despues el votador envia cfg.options OPTIONS con CORESIP_SendOptionsMsg, uno a
+ * uno, y con CORESIP_SendOptionsMsgList. La CPU del votador es la del proceso menos la de los threads del simulador.
+ * @return	0 si se han contestado todos los OPTIONS.
+ */
+int RunOptions()
+{
+	static const char *rx_names[] = { "pjsua", "Plantilla" };
+	static const char *tx_names[] = { "Uno a uno", "Lista" };
+	std::vector<double> latency_ms;
+	CORESIP_Error err;
+	int ret = 0;
+
+	OptionsFlood *flood = new OptionsFlood(cfg.options, cfg.options_port, cfg.voter_sip_port, OPTIONS_WINDOW);
+	if (flood->Start() != PJ_SUCCESS)
+	{
+		delete flood;
+		return 1;
+	}
+
+	printf("%u OPTIONS recibidos por el votador\n", cfg.options);
+	for (unsigned r = 0; r < PJ_ARRAY_SIZE(rx_names); r++)
+	{
+		OptionsFast::Enable(r == 1 ? PJ_TRUE : PJ_FALSE);
+
+		pj_uint64_t cpu0 = ProcessCpuUs();
+		pj_uint64_t sim0 = RadioSim::ThreadCpuUs() + flood->RxCpuUs();
+		double wall_s = flood->Round(latency_ms);
+		double cpu_s = ((double) (ProcessCpuUs() - cpu0) - (double) (RadioSim::ThreadCpuUs() + flood->RxCpuUs() - sim0)) / 1e6;
+
+		printf("%-10s %u de %u contestados en %.2f s (%.0f OPTIONS/s, CPU votador %.2f s, %.0f OPTIONS/s por nucleo). p50 %.2f ms, p99 %.2f ms\n",
+			rx_names[r], (unsigned) latency_ms.size(), cfg.options, wall_s, wall_s > 0 ? latency_ms.size() / wall_s : 0.0,
+			cpu_s, cpu_s > 0 ? latency_ms.size() / cpu_s : 0.0, Percentile(latency_ms, 0.5), Percentile(latency_ms, 0.99));
+		if (latency_ms.size() != cfg.options) ret = 1;
+	}
+	OptionsFast::Enable(PJ_TRUE);
+
+	std::vector<std::vector<char> > target_buf(cfg.options, std::vector<char>(64));
+	std::vector<std::vector<char> > callid_buf(cfg.options, std::vector<char>(CORESIP_MAX_CALLID_LENGTH));
+	std::vector<const char *> targets(cfg.options);
+	std::vector<char *> callids(cfg.options);
+	for (unsigned i = 0; i < cfg.options; i++)
+	{
+		pj_ansi_snprintf(&target_buf[i][0], 64, "<sip:opt-%u@127.0.0.1:%u>", i, cfg.options_port);
+		targets[i] = &target_buf[i][0];
+		callids[i] = &callid_buf[i][0];
+	}
+
+	printf("%u OPTIONS enviados por el votador\n", cfg.options);
+	for (unsigned r = 0; r < PJ_ARRAY_SIZE(tx_names); r++)
+	{
+		unsigned ok0 = options_ok;
+		unsigned probes0 = flood->Probes();
+
+		//Se envian en listas de OPTIONS_WINDOW destinos, esperando las respuestas de cada una
+		pj_uint64_t send_us = 0;
+		pj_uint64_t t0 = RadioSim::NowUs();
+		for (unsigned i = 0; i < cfg.options; i += OPTIONS_WINDOW)
+		{
+			unsigned n = PJ_MIN(OPTIONS_WINDOW, cfg.options - i);
+			pj_uint64_t send0 = RadioSim::ThreadCpuUs();
+			if (r == 0)
+			{
+				for (unsigned j = i; j < i + n; j++) CORESIP_SendOptionsMsg(targets[j], callids[j], 1, &err);
+			}
+			else
+			{
+				CORESIP_SendOptionsMsgList(&targets[i], &callids[i], (int) n, 1, &err);
+			}
+			send_us += RadioSim::ThreadCpuUs() - send0;
+
+			while (options_ok - ok0 < i + n && RadioSim::NowUs() - t0 < OPTIONS_TIMEOUT_US) pj_thread_sleep(0);
+		}
+		double send_s = send_us / 1e6;
+		double wall_s = (RadioSim::NowUs() - t0) / 1e6;
+
+		printf("%-10s envio %.1f ms de CPU (%.0f OPTIONS/s). %u contestados, %u respuestas en %.2f s\n",
+			tx_names[r], send_s * 1000.0, send_s > 0 ? cfg.options / send_s : 0.0, flood->Probes() - probes0,
+			options_ok - ok0, wall_s);
+		if (options_ok - ok0 != cfg.options) ret = 1;
+	}
+
+	delete flood;
+	return ret;
+}
+
+/*@}*/
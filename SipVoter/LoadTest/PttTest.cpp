@@ -0,0 +1,174 @@
+/**
+ * @file PttTest.cpp
+ * @brief Prueba de carga de CORESIP: cambios de PTT de las sesiones de radio (--ptt)
+ *
+ *	Con --ptt N, al final de GroupsTest.cpp: tiempo desde CORESIP_CallPtt hasta que la radio recibe el paquete con el
+ *	nuevo tipo de PTT, en N activaciones y N desactivaciones por sesion, en instantes aleatorios respecto del tick de
+ *	20ms. Y desfase entre las radios de un grupo al cambiar el PTT de todas con CORESIP_CallPtt y con CORESIP_GroupPtt.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define PTT_TIMEOUT_US		500000		//Espera maxima al paquete con el cambio de PTT
+
+/**
+ * CallRadio.	...
+ * @return	Indice en el simulador de la radio de una llamada.
+ */
+static int CallRadio(int call)
+{
+	unsigned idx = CALL_INDEX(call);
+	pj_mutex_lock(st.mutex);
+	int radio = st.call_group[idx] * (int) cfg.radios + st.call_sess[idx];
+	pj_mutex_unlock(st.mutex);
+	return radio;
+}
+
+/**
+ * WaitPtt.	...
+ * Espera a que todas las radios reciban el tipo de PTT (activo o no) despues de t0.
+ * @param	t_first		Instante en el que lo recibe la primera.
+ * @param	t_last		Instante en el que lo recibe la ultima.
+ * @return	PJ_FALSE si alguna no lo ha recibido en PTT_TIMEOUT_US.
+ */
+static pj_bool_t WaitPtt(const std::vector<int> &radios, unsigned on, pj_uint64_t t0, pj_uint64_t *t_first, pj_uint64_t *t_last)
+{
+	while (RadioSim::NowUs() - t0 < PTT_TIMEOUT_US)
+	{
+		unsigned n = 0;
+		*t_first = ~(pj_uint64_t) 0;
+		*t_last = 0;
+
+		pj_mutex_lock(st.mutex);
+		for (unsigned i = 0; i < radios.size(); i++)
+		{
+			int r = radios[i];
+			if ((st.radio_ptt[r] != 0 ? 1U : 0U) != on || st.t_radio_ptt[r] < t0) break;
+			n++;
+			*t_first = PJ_MIN(*t_first, st.t_radio_ptt[r]);
+			*t_last = PJ_MAX(*t_last, st.t_radio_ptt[r]);
+		}
+		pj_mutex_unlock(st.mutex);
+
+		if (n == radios.size()) return PJ_TRUE;
+		pj_thread_sleep(0);
+	}
+	return PJ_FALSE;
+}
+
+/**
+ * RunPtt.	...
+ * Activa y desactiva cfg.ptt veces el PTT de cada sesion, de una en una, y mide desde CORESIP_CallPtt hasta que la
+ * radio recibe el paquete con el nuevo tipo de PTT. Despues activa y desactiva a la vez todas las sesiones de cada
+ * grupo, como los transmisores de una frecuencia, llamando a CORESIP_CallPtt para cada una y con CORESIP_GroupPtt,
+ * y mide el desfase entre la primera y la ultima radio. Entre cambios espera un tiempo aleatorio de hasta un tick.
+ */
+int RunPtt(const std::vector<int> &calls)
+{
+	static const char *names[] = { "OFF", "ON" };
+	static const char *modes[] = { "CallPtt", "GroupPtt" };
+	std::vector<double> latency_ms[2], api_ms;
+	unsigned lost = 0;
+	CORESIP_Error err;
+
+	for (unsigned n = 0; n < 2 * cfg.ptt; n++)
+	{
+		CORESIP_PttInfo info;
+		pj_bzero(&info, sizeof(info));
+		info.PttType = (n % 2) == 0 ? CORESIP_PTT_NORMAL : CORESIP_PTT_OFF;
+		info.PttId = info.PttType == CORESIP_PTT_OFF ? 0 : 1;
+		unsigned on = info.PttType != CORESIP_PTT_OFF ? 1 : 0;
+
+		for (unsigned i = 0; i < calls.size(); i++)
+		{
+			std::vector<int> radio(1, CallRadio(calls[i]));
+			pj_thread_sleep(pj_rand() % 20);
+
+			pj_uint64_t t0 = RadioSim::NowUs();
+			if (CORESIP_CallPtt(calls[i], &info, &err) != 0)
+			{
+				lost++;
+				continue;
+			}
+			api_ms.push_back((RadioSim::NowUs() - t0) / 1000.0);
+
+			pj_uint64_t t_first, t_last;
+			if (WaitPtt(radio, on, t0, &t_first, &t_last)) latency_ms[on].push_back((t_last - t0) / 1000.0);
+			else lost++;
+		}
+	}
+
+	printf("PTT hasta la radio:     CORESIP_CallPtt p50 %.3f ms, p99 %.3f ms. %u cambios sin llegar\n",
+		Percentile(api_ms, 0.5), Percentile(api_ms, 0.99), lost);
+	for (unsigned on = 2; on-- > 0;)
+	{
+		printf("                        PTT %-3s %u cambios. p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", names[on],
+			(unsigned) latency_ms[on].size(), Percentile(latency_ms[on], 0.5), Percentile(latency_ms[on], 0.99),
+			Percentile(latency_ms[on], 1.0));
+	}
+
+	std::vector<std::vector<int> > group_calls(cfg.groups), group_radios(cfg.groups);
+	for (unsigned i = 0; i < calls.size(); i++)
+	{
+		int radio = CallRadio(calls[i]);
+		group_calls[radio / cfg.radios].push_back(calls[i]);
+		group_radios[radio / cfg.radios].push_back(radio);
+	}
+
+	printf("Desfase entre %u transmisores de un grupo:\n", cfg.radios);
+	for (unsigned m = 0; m < 2; m++)
+	{
+		std::vector<double> skew_ms, group_api_ms;
+		unsigned group_lost = 0;
+
+		for (unsigned n = 0; n < 2 * cfg.ptt; n++)
+		{
+			CORESIP_PttInfo info;
+			pj_bzero(&info, sizeof(info));
+			info.PttType = (n % 2) == 0 ? CORESIP_PTT_NORMAL : CORESIP_PTT_OFF;
+			info.PttId = info.PttType == CORESIP_PTT_OFF ? 0 : 1;
+			unsigned on = info.PttType != CORESIP_PTT_OFF ? 1 : 0;
+
+			for (unsigned g = 0; g < cfg.groups; g++)
+			{
+				if (group_calls[g].empty()) continue;
+				pj_thread_sleep(pj_rand() % 20);
+
+				pj_uint64_t t0 = RadioSim::NowUs();
+				if (m == 0)
+				{
+					for (unsigned i = 0; i < group_calls[g].size(); i++) CORESIP_CallPtt(group_calls[g][i], &info, &err);
+				}
+				else
+				{
+					CORESIP_GroupPtt(&group_calls[g][0], (int) group_calls[g].size(), &info, &err);
+				}
+				group_api_ms.push_back((RadioSim::NowUs() - t0) / 1000.0);
+
+				pj_uint64_t t_first, t_last;
+				if (WaitPtt(group_radios[g], on, t0, &t_first, &t_last)) skew_ms.push_back((t_last - t_first) / 1000.0);
+				else group_lost++;
+			}
+		}
+
+		printf("  %-9s %u cambios, %u sin llegar. Llamadas a CORESIP %.3f ms. Desfase p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+			modes[m], (unsigned) skew_ms.size(), group_lost, Percentile(group_api_ms, 0.5), Percentile(skew_ms, 0.5),
+			Percentile(skew_ms, 0.99), Percentile(skew_ms, 1.0));
+		lost += group_lost;
+	}
+
+	return lost == 0 ? 0 : 1;
+}
+
+/*@}*/
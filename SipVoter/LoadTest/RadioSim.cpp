@@ -0,0 +1,700 @@
+/**
+ * @file RadioSim.cpp
+ * @brief Simulador de radios ED-137 para las pruebas de carga de CORESIP
+ *
+ *	Implementa la clase 'RadioSim'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjmedia.h>
+#include <pjmedia/alaw_ulaw.h>
+#include <pjsua-lib/pjsua.h>
+#include "RadioSim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+#define THIS_FILE			"RadioSim.cpp"
+
+#define PTIME_MS			20
+#define SAMPLES_PER_PKT		160
+#define PT_PCMA				8
+#define PT_R2S				123
+
+#define MAX_SIP_MSG			4000
+#define MAX_RTP_PKT			1500
+
+/**
+ * NowUs.	...
+ * Reloj monotono comun para todas las medidas.
+ * @return	Microsegundos.
+ */
+pj_uint64_t RadioSim::NowUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (pj_uint64_t) ts.tv_sec * 1000000 + (pj_uint64_t) ts.tv_nsec / 1000;
+}
+
+/**
+ * ThreadCpuUs.	...
+ * @return	Tiempo de CPU consumido por el thread que llama, en microsegundos.
+ */
+pj_uint64_t RadioSim::ThreadCpuUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (pj_uint64_t) ts.tv_sec * 1000000 + (pj_uint64_t) ts.tv_nsec / 1000;
+}
+
+/**
+ * ClimaxTime.	...
+ * Tiempo en el formato de los TLV de climax: timestamp NTP con los 10 bits de menor peso de los segundos,
+ * en unidades de 125us y truncado a 23 bits. Igual que GetTimeClimax() de stream.c.
+ * @return	Tiempo.
+ */
+pj_uint32_t RadioSim::ClimaxTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+
+	unsigned long long t = ((unsigned long long) tv.tv_sec + 2208988800ULL) * 10000000 + (unsigned long long) tv.tv_usec * 10;
+	unsigned long long seg = t / 10000000;
+	t -= seg * 10000000;
+	seg &= 0x3FF;
+	t = seg * 10000000 + t;
+	t /= 1250;
+	return (pj_uint32_t) (t & 0x7FFFFF);
+}
+
+/**
+ * Bind.	...
+ * Crea un socket UDP en 127.0.0.1:port.
+ */
+static pj_sock_t Bind(unsigned port)
+{
+	pj_sock_t s;
+	pj_sockaddr_in addr;
+
+	pj_status_t st = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &s);
+	if (st != PJ_SUCCESS) return PJ_INVALID_SOCKET;
+
+	int bufsize = 4 * 1024 * 1024;
+	pj_sock_setsockopt(s, pj_SOL_SOCKET(), pj_SO_RCVBUF(), &bufsize, sizeof(bufsize));
+
+	pj_str_t host;
+	pj_sockaddr_in_init(&addr, pj_cstr(&host, "127.0.0.1"), (pj_uint16_t) port);
+	st = pj_sock_bind(s, &addr, sizeof(addr));
+	if (st != PJ_SUCCESS)
+	{
+		PJ_LOG(1,(THIS_FILE, "ERROR: no se puede abrir el puerto UDP %u", port));
+		pj_sock_close(s);
+		return PJ_INVALID_SOCKET;
+	}
+	return s;
+}
+
+/**
+ * RadioSim.	...
+ * Constructor. Abre los sockets. Los threads se arrancan con Start().
+ * @param	cfg		Parametros.
+ * @param	ev		Funciones a las que se llama con las medidas.
+ */
+RadioSim::RadioSim(const RadioSimConfig *cfg, const RadioSimEvents *ev)
+{
+	pj_memcpy(&_Cfg, cfg, sizeof(_Cfg));
+	pj_memcpy(&_Ev, ev, sizeof(_Ev));
+
+	_RxThread = NULL;
+	_TxThread = NULL;
+	_Run = PJ_FALSE;
+	_Bursts = PJ_FALSE;
+	_MamSent = 0;
+	_RxCpuUs = 0;
+	_TxCpuUs = 0;
+
+	unsigned nradios = _Cfg.groups * _Cfg.radios;
+
+	_Pool = pjsua_pool_create("RadioSim", 4096, 4096);
+	_Radios = (Radio *) pj_pool_zalloc(_Pool, nradios * sizeof(Radio));
+	_Groups = (RadioSimGroup *) pj_pool_zalloc(_Pool, _Cfg.groups * sizeof(RadioSimGroup));
+
+	//El votador usa dos puertos (RTP y RTCP) por llamada
+	_NVoterPorts = 2 * nradios + 2;
+	_RadioByVoterPort = (int *) pj_pool_alloc(_Pool, _NVoterPorts * sizeof(int));
+	for (unsigned i = 0; i < _NVoterPorts; i++) _RadioByVoterPort[i] = -1;
+
+	for (unsigned i = 0; i < nradios; i++)
+	{
+		Radio *r = &_Radios[i];
+		r->group = i / _Cfg.radios;
+		r->sess = i % _Cfg.radios;
+		r->ssrc = pj_rand();
+		r->seq = (pj_uint16_t) pj_rand();
+		r->ts = pj_rand();
+	}
+
+	pj_mutex_create_simple(_Pool, "RadioSimMtx", &_Mutex);
+
+	_SipSock = Bind(_Cfg.sip_port);
+	_RtpSock = Bind(_Cfg.rtp_port);
+	for (unsigned g = 0; g < _Cfg.groups; g++)
+	{
+		_Groups[g].egress_sock = Bind(_Cfg.egress_port + g);
+		_Groups[g].best_sess = -1;
+	}
+}
+
+/**
+ * ~RadioSim.	...
+ * Destructor.
+ */
+RadioSim::~RadioSim()
+{
+	Stop();
+
+	if (_SipSock != PJ_INVALID_SOCKET) pj_sock_close(_SipSock);
+	if (_RtpSock != PJ_INVALID_SOCKET) pj_sock_close(_RtpSock);
+	for (unsigned g = 0; g < _Cfg.groups; g++)
+	{
+		if (_Groups[g].egress_sock != PJ_INVALID_SOCKET) pj_sock_close(_Groups[g].egress_sock);
+	}
+
+	pj_mutex_destroy(_Mutex);
+	pj_pool_release(_Pool);
+}
+
+/**
+ * Start.	...
+ * Arranca el thread de recepcion (SIP, RTP y audio de los grupos) y el de envio RTP.
+ */
+void RadioSim::Start()
+{
+	_Run = PJ_TRUE;
+	pj_thread_create(_Pool, "RadioSimRx", &RxTh, this, 0, 0, &_RxThread);
+	pj_thread_create(_Pool, "RadioSimTx", &TxTh, this, 0, 0, &_TxThread);
+}
+
+/**
+ * Stop.	...
+ * Para los threads.
+ */
+void RadioSim::Stop()
+{
+	if (!_Run) return;
+	_Run = PJ_FALSE;
+	if (_RxThread != NULL)
+	{
+		pj_thread_join(_RxThread);
+		pj_thread_destroy(_RxThread);
+		_RxThread = NULL;
+	}
+	if (_TxThread != NULL)
+	{
+		pj_thread_join(_TxThread);
+		pj_thread_destroy(_TxThread);
+		_TxThread = NULL;
+	}
+}
+
+/**
+ * SetBursts.	...
+ * Activa o desactiva las rafagas de squelch.
+ */
+void RadioSim::SetBursts(pj_bool_t on)
+{
+	_Bursts = on;
+}
+
+/**
+ * Connected.	...
+ * @return	Numero de radios con sesion establecida.
+ */
+unsigned RadioSim::Connected()
+{
+	unsigned n = 0;
+	pj_mutex_lock(_Mutex);
+	for (unsigned i = 0; i < _Cfg.groups * _Cfg.radios; i++)
+	{
+		if (_Radios[i].connected) n++;
+	}
+	pj_mutex_unlock(_Mutex);
+	return n;
+}
+
+/**
+ * MamSent.	...
+ * @return	Numero de MAM enviados.
+ */
+unsigned RadioSim::MamSent()
+{
+	return _MamSent;
+}
+
+/**
+ * ThreadsCpuUs.	...
+ * @return	CPU consumida por los threads del simulador, para descontarla de la del proceso.
+ */
+pj_uint64_t RadioSim::ThreadsCpuUs()
+{
+	return _RxCpuUs + _TxCpuUs;
+}
+
+/**
+ * GetHeader.	...
+ * Busca una cabecera en un mensaje SIP y copia la linea completa, incluido el nombre.
+ * @return	PJ_TRUE si la encuentra.
+ */
+pj_bool_t RadioSim::GetHeader(const char *msg, const char *name, char *line, int size)
+{
+	int nlen = (int) strlen(name);
+	const char *p = strstr(msg, "\r\n");
+	const char *end = strstr(msg, "\r\n\r\n");
+
+	while (p != NULL && p < end)
+	{
+		p += 2;
+		if (pj_ansi_strnicmp(p, name, nlen) == 0 && p[nlen] == ':')
+		{
+			const char *eol = strstr(p, "\r\n");
+			int len = (int) (eol - p);
+			if (len >= size) len = size - 1;
+			pj_memcpy(line, p, len);
+			line[len] = '\0';
+			return PJ_TRUE;
+		}
+		p = strstr(p, "\r\n");
+	}
+	return PJ_FALSE;
+}
+
+/**
+ * OnSip.	...
+ * Atiende un mensaje SIP del votador.
+ */
+void RadioSim::OnSip(char *msg, int len, const pj_sockaddr_in *from)
+{
+	char method[16], user[64], via[512], from_hdr[512], to[512], callid[256], cseq[64];
+	char resp[MAX_SIP_MSG], sdp[1024];
+	int g = -1, s = -1;
+
+	msg[len] = '\0';
+	if (sscanf(msg, "%15s sip:%63[^@]", method, user) != 2) return;		//Las respuestas no se tratan
+	if (strcmp(method, "ACK") == 0) return;
+
+	if (!GetHeader(msg, "Via", via, sizeof(via)) || !GetHeader(msg, "From", from_hdr, sizeof(from_hdr)) ||
+		!GetHeader(msg, "To", to, sizeof(to)) || !GetHeader(msg, "Call-ID", callid, sizeof(callid)) ||
+		!GetHeader(msg, "CSeq", cseq, sizeof(cseq)))
+	{
+		return;
+	}
+
+	sscanf(user, "rx-%d-%d", &g, &s);
+	Radio *r = (g >= 0 && g < (int) _Cfg.groups && s >= 0 && s < (int) _Cfg.radios) ? &_Radios[g * _Cfg.radios + s] : NULL;
+
+	sdp[0] = '\0';
+	int code = 200;
+
+	if (strcmp(method, "INVITE") == 0)
+	{
+		char ip[32] = "";
+		unsigned port = 0;
+		const char *body = strstr(msg, "\r\n\r\n");
+		const char *c = body ? strstr(body, "c=IN IP4 ") : NULL;
+		const char *m = body ? strstr(body, "m=audio ") : NULL;
+		if (c) sscanf(c, "c=IN IP4 %31[0-9.]", ip);
+		if (m) sscanf(m, "m=audio %u", &port);
+
+		if (r == NULL || ip[0] == '\0' || port == 0)
+		{
+			code = 404;
+		}
+		else
+		{
+			pj_mutex_lock(_Mutex);
+			pj_str_t host = pj_str(ip);
+			pj_sockaddr_in_init(&r->voter_rtp, &host, (pj_uint16_t) port);
+			pj_ansi_strncpy(r->call_id, callid, sizeof(r->call_id));
+			if (port >= _Cfg.voter_rtp_port && port - _Cfg.voter_rtp_port < _NVoterPorts)
+			{
+				_RadioByVoterPort[port - _Cfg.voter_rtp_port] = (int) (r - _Radios);
+			}
+			r->squ = PJ_FALSE;
+			r->mam_pending = PJ_FALSE;
+			r->connected = PJ_TRUE;
+			pj_mutex_unlock(_Mutex);
+
+			pj_ansi_snprintf(sdp, sizeof(sdp),
+				"v=0\r\n"
+				"o=- %u 1 IN IP4 127.0.0.1\r\n"
+				"s=RadioSim\r\n"
+				"c=IN IP4 127.0.0.1\r\n"
+				"t=0 0\r\n"
+				"m=audio %u RTP/AVP %d %d\r\n"
+				"a=rtpmap:%d PCMA/8000\r\n"
+				"a=rtpmap:%d R2S/8000\r\n"
+				"a=type:Radio-Rxonly\r\n"
+				"a=txrxmode:Rx\r\n"
+				"a=ptt-id:%d\r\n"
+				"a=R2S-KeepAlivePeriod:%u\r\n"
+				"a=R2S-KeepAliveMultiplier:%u\r\n"
+				"a=bss:RSSI\r\n",
+				r->ssrc, _Cfg.rtp_port, PT_PCMA, PT_R2S, PT_PCMA, PT_R2S, s + 1,
+				_Cfg.ka_period_ms, _Cfg.ka_multiplier);
+		}
+	}
+	else if (strcmp(method, "BYE") == 0 || strcmp(method, "CANCEL") == 0)
+	{
+		if (r != NULL)
+		{
+			pj_mutex_lock(_Mutex);
+			r->connected = PJ_FALSE;
+			r->squ = PJ_FALSE;
+			pj_mutex_unlock(_Mutex);
+		}
+	}
+	else if (strcmp(method, "OPTIONS") != 0)
+	{
+		code = 501;
+	}
+
+	//El To de la respuesta lleva tag si no lo tenia
+	if (strstr(to, "tag=") == NULL)
+	{
+		pj_ansi_snprintf(to + strlen(to), sizeof(to) - strlen(to), ";tag=%s", user);
+	}
+
+	int n = pj_ansi_snprintf(resp, sizeof(resp),
+		"SIP/2.0 %d %s\r\n"
+		"%s;received=127.0.0.1\r\n"
+		"%s\r\n"
+		"%s\r\n"
+		"%s\r\n"
+		"%s\r\n"
+		"Contact: <sip:%s@127.0.0.1:%u>\r\n"
+		"%s"
+		"Content-Length: %d\r\n"
+		"\r\n"
+		"%s",
+		code, code == 200 ? "OK" : "Error",
+		via, from_hdr, to, callid, cseq,
+		user, _Cfg.sip_port,
+		sdp[0] ? "Content-Type: application/sdp\r\n" : "",
+		(int) strlen(sdp), sdp);
+
+	pj_ssize_t size = n;
+	pj_sock_sendto(_SipSock, resp, &size, 0, from, sizeof(*from));
+}
+
+/**
+ * OnRtp.	...
+ * Atiende un paquete RTP del votador. Solo interesan los cambios de PTT y los RMM.
+ */
+void RadioSim::OnRtp(const pj_uint8_t *pkt, int len, const pj_sockaddr_in *from)
+{
+	if (len < 12 || (pkt[0] & 0x10) == 0) return;		//Sin extension de cabecera
+
+	unsigned port = pj_ntohs(from->sin_port);
+	if (port < _Cfg.voter_rtp_port || port - _Cfg.voter_rtp_port >= _NVoterPorts) return;
+	int idx = _RadioByVoterPort[port - _Cfg.voter_rtp_port];
+	if (idx < 0) return;
+
+	int off = 12 + (pkt[0] & 0x0F) * 4;
+	if (len < off + 4) return;
+	const pj_uint8_t *ext = pkt + off;
+	int ext_words = (ext[2] << 8) | ext[3];
+	const pj_uint8_t *d = ext + 4;
+	if (ext_words < 1 || len < off + 4 + ext_words * 4) return;
+
+	Radio *r = &_Radios[idx];
+	unsigned ptt = d[0] >> 5;
+	if (ptt != r->rx_ptt)
+	{
+		r->rx_ptt = ptt;
+		if (_Ev.Ptt) _Ev.Ptt(idx, ptt, NowUs());
+	}
+
+	if (ext_words < 2) return;
+
+	//RMM: TLV tipo 4 longitud 3 tras las dos primeras palabras de la extension ED-137
+	if ((d[1] & 0x01) && d[2] == 0x43)
+	{
+		pj_mutex_lock(_Mutex);
+		r->mam_TQG = (d[3] >> 7) & 0x1;
+		r->mam_T1 = ((pj_uint32_t) (d[3] & 0x7F) << 16) | ((pj_uint32_t) d[4] << 8) | d[5];
+		r->mam_rx_us = NowUs();
+		r->mam_pending = PJ_TRUE;
+		pj_mutex_unlock(_Mutex);
+	}
+}
+
+/**
+ * OnEgress.	...
+ * Lee un paquete de audio que el votador ha enviado al multicast de un grupo.
+ */
+void RadioSim::OnEgress(int group, pj_uint64_t now)
+{
+	char buf[MAX_RTP_PKT];
+	pj_ssize_t size = sizeof(buf);
+
+	if (pj_sock_recv(_Groups[group].egress_sock, buf, &size, 0) != PJ_SUCCESS) return;
+	if (size <= 1) return;		//RESTART_JBUF
+
+	RadioSimGroup *gr = &_Groups[group];
+	pj_mutex_lock(_Mutex);
+	pj_bool_t first = gr->squ && !gr->first_egress;
+	if (first) gr->first_egress = PJ_TRUE;
+	pj_uint64_t t_on = gr->t_squ_on;
+	pj_uint64_t t_prev = gr->t_last_egress;
+	gr->t_last_egress = now;
+	pj_mutex_unlock(_Mutex);
+
+	if (_Ev.Egress) _Ev.Egress(group, now, t_on, first, t_prev);
+}
+
+/**
+ * SendRtp.	...
+ * Envia un paquete RTP de una radio con la extension de cabecera ED-137. Con audio lleva 20ms de PCMA,
+ * si no es un keepalive R2S sin carga. Si hay un MAM pendiente se envia en este paquete.
+ */
+void RadioSim::SendRtp(Radio *r, pj_bool_t audio)
+{
+	pj_uint8_t pkt[12 + 4 + 16 + SAMPLES_PER_PKT];
+	pj_uint8_t *d;
+	int ext_words = 1;
+
+	pkt[0] = 0x90;								//V=2, X=1
+	pkt[1] = (pj_uint8_t) (audio ? PT_PCMA : PT_R2S);
+	pkt[2] = (pj_uint8_t) (r->seq >> 8);
+	pkt[3] = (pj_uint8_t) r->seq;
+	pkt[4] = (pj_uint8_t) (r->ts >> 24);
+	pkt[5] = (pj_uint8_t) (r->ts >> 16);
+	pkt[6] = (pj_uint8_t) (r->ts >> 8);
+	pkt[7] = (pj_uint8_t) r->ts;
+	pkt[8] = (pj_uint8_t) (r->ssrc >> 24);
+	pkt[9] = (pj_uint8_t) (r->ssrc >> 16);
+	pkt[10] = (pj_uint8_t) (r->ssrc >> 8);
+	pkt[11] = (pj_uint8_t) r->ssrc;
+	r->seq++;
+	r->ts += SAMPLES_PER_PKT;
+
+	d = pkt + 16;
+	pj_bzero(d, 16);
+	d[0] = (pj_uint8_t) (r->squ ? 0x10 : 0x00);	//PTT type 0, SQU, PTT id 0
+
+	if (r->mam_pending)
+	{
+		//MAM: tipo 4 longitud 12. TQG|T1, NMR|T2, Tsd, Tj1, Tid
+		pj_uint32_t T2 = ClimaxTime();
+		pj_uint32_t Tsd = (pj_uint32_t) ((NowUs() - r->mam_rx_us) / 125);
+
+		d[1] = 0x01;
+		d[2] = 0x4C;
+		d[3] = (pj_uint8_t) ((r->mam_TQG << 7) | ((r->mam_T1 >> 16) & 0x7F));
+		d[4] = (pj_uint8_t) (r->mam_T1 >> 8);
+		d[5] = (pj_uint8_t) r->mam_T1;
+		d[6] = (pj_uint8_t) ((T2 >> 16) & 0x7F);
+		d[7] = (pj_uint8_t) (T2 >> 8);
+		d[8] = (pj_uint8_t) T2;
+		d[9] = (pj_uint8_t) (Tsd >> 8);
+		d[10] = (pj_uint8_t) Tsd;
+		ext_words = 4;
+		r->mam_pending = PJ_FALSE;
+		_MamSent++;
+	}
+	else if (r->squ)
+	{
+		//TLV de Qidx: tipo 1 longitud 1, metodo RSSI
+		d[1] = 0x01;
+		d[2] = 0x11;
+		d[3] = (pj_uint8_t) (r->qidx << 3);
+	}
+
+	pkt[12] = 0x01;
+	pkt[13] = 0x67;
+	pkt[14] = 0;
+	pkt[15] = (pj_uint8_t) ext_words;
+
+	int len = 16 + ext_words * 4;
+	if (audio)
+	{
+		//Tono distinto por sesion
+		float w = 2.0f * 3.14159265f * (400.0f + 100.0f * r->sess) / 8000.0f;
+		for (int i = 0; i < SAMPLES_PER_PKT; i++)
+		{
+			pj_int16_t v = (pj_int16_t) (8000.0f * sinf(r->phase));
+			pkt[len + i] = pjmedia_linear2alaw(v);
+			r->phase += w;
+			if (r->phase > 2.0f * 3.14159265f) r->phase -= 2.0f * 3.14159265f;
+		}
+		len += SAMPLES_PER_PKT;
+	}
+
+	pj_ssize_t size = len;
+	pj_sock_sendto(_RtpSock, pkt, &size, 0, &r->voter_rtp, sizeof(r->voter_rtp));
+}
+
+/**
+ * TickBursts.	...
+ * Activa y desactiva el squelch de los grupos. La rafaga de cada grupo esta desplazada dentro del periodo
+ * para repartir la carga.
+ */
+void RadioSim::TickBursts(pj_uint64_t now, pj_uint64_t t0)
+{
+	pj_uint64_t period = (pj_uint64_t) _Cfg.burst_period_ms * 1000;
+	pj_uint64_t on = (pj_uint64_t) _Cfg.burst_on_ms * 1000;
+
+	for (unsigned g = 0; g < _Cfg.groups; g++)
+	{
+		pj_uint64_t offset = period * g / _Cfg.groups;
+		pj_bool_t squ = _Bursts && ((now - t0 + period - offset) % period) < on;
+		RadioSimGroup *gr = &_Groups[g];
+
+		if (squ == gr->squ) continue;
+
+		//Qidx aleatorios distintos entre si (hasta 16 radios), para que la mejor sea unica
+		unsigned qidx_start = pj_rand() % 16;
+		unsigned qidx_step = 2 * (pj_rand() % 8) + 1;
+		int best = -1;
+		unsigned best_qidx = 0;
+		for (unsigned s = 0; s < _Cfg.radios; s++)
+		{
+			Radio *r = &_Radios[g * _Cfg.radios + s];
+			r->squ = squ && r->connected;
+			if (r->squ)
+			{
+				r->qidx = (qidx_start + s * qidx_step) % 16;
+				if (best < 0 || r->qidx > best_qidx)
+				{
+					best = (int) s;
+					best_qidx = r->qidx;
+				}
+			}
+		}
+
+		gr->squ = squ;
+		if (squ)
+		{
+			gr->t_squ_on = now;
+			gr->first_egress = PJ_FALSE;
+			gr->best_sess = best;
+		}
+
+		if (squ && _Ev.SquOn) _Ev.SquOn((int) g, best, now);
+	}
+}
+
+/**
+ * RxTh.	...
+ * Thread de recepcion: SIP, RTP del votador y audio de los grupos.
+ */
+int RadioSim::RxTh(void *proc)
+{
+	RadioSim *wp = (RadioSim *) proc;
+	char buf[MAX_SIP_MSG + 1];
+	pj_uint64_t cpu0 = ThreadCpuUs();
+
+	while (wp->_Run)
+	{
+		pj_fd_set_t rset;
+		pj_time_val tv = {0, 50};
+
+		PJ_FD_ZERO(&rset);
+		PJ_FD_SET(wp->_SipSock, &rset);
+		PJ_FD_SET(wp->_RtpSock, &rset);
+		for (unsigned g = 0; g < wp->_Cfg.groups; g++) PJ_FD_SET(wp->_Groups[g].egress_sock, &rset);
+
+		int n = pj_sock_select(FD_SETSIZE, &rset, NULL, NULL, &tv);
+		if (n > 0)
+		{
+			pj_uint64_t now = NowUs();
+
+			for (unsigned g = 0; g < wp->_Cfg.groups; g++)
+			{
+				if (PJ_FD_ISSET(wp->_Groups[g].egress_sock, &rset)) wp->OnEgress((int) g, now);
+			}
+
+			if (PJ_FD_ISSET(wp->_SipSock, &rset))
+			{
+				pj_sockaddr_in from;
+				int fromlen = sizeof(from);
+				pj_ssize_t size = MAX_SIP_MSG;
+				if (pj_sock_recvfrom(wp->_SipSock, buf, &size, 0, &from, &fromlen) == PJ_SUCCESS && size > 0)
+				{
+					wp->OnSip(buf, (int) size, &from);
+				}
+			}
+
+			if (PJ_FD_ISSET(wp->_RtpSock, &rset))
+			{
+				//Se vacia el socket en cada pasada
+				for (int i = 0; i < 256; i++)
+				{
+					pj_sockaddr_in from;
+					int fromlen = sizeof(from);
+					pj_ssize_t size = MAX_RTP_PKT;
+					if (pj_sock_recvfrom(wp->_RtpSock, buf, &size, MSG_DONTWAIT, &from, &fromlen) != PJ_SUCCESS || size <= 0) break;
+					wp->OnRtp((pj_uint8_t *) buf, (int) size, &from);
+				}
+			}
+		}
+
+		wp->_RxCpuUs = ThreadCpuUs() - cpu0;
+	}
+
+	return 0;
+}
+
+/**
+ * TxTh.	...
+ * Thread de envio. Cada 20ms envia audio de las radios con squelch y, cada ka_period_ms, keepalives de las demas.
+ */
+int RadioSim::TxTh(void *proc)
+{
+	RadioSim *wp = (RadioSim *) proc;
+	pj_uint64_t cpu0 = ThreadCpuUs();
+	pj_uint64_t t0 = NowUs();
+	pj_uint64_t next = t0;
+	unsigned tick = 0;
+	unsigned ka_ticks = wp->_Cfg.ka_period_ms / PTIME_MS;
+	if (ka_ticks == 0) ka_ticks = 1;
+
+	while (wp->_Run)
+	{
+		pj_uint64_t now = NowUs();
+		if (now < next)
+		{
+			pj_thread_sleep((unsigned) ((next - now) / 1000));
+			continue;
+		}
+		next += PTIME_MS * 1000;
+
+		pj_mutex_lock(wp->_Mutex);
+		wp->TickBursts(now, t0);
+		for (unsigned i = 0; i < wp->_Cfg.groups * wp->_Cfg.radios; i++)
+		{
+			Radio *r = &wp->_Radios[i];
+			if (!r->connected) continue;
+			//Los keepalive de cada radio se reparten entre los ticks del periodo
+			if (r->squ || r->mam_pending || ((tick + i) % ka_ticks) == 0)
+			{
+				wp->SendRtp(r, r->squ);
+			}
+		}
+		pj_mutex_unlock(wp->_Mutex);
+
+		tick++;
+		wp->_TxCpuUs = ThreadCpuUs() - cpu0;
+	}
+
+	return 0;
+}
+
+/*@}*/
@@ -0,0 +1,151 @@
+/**
+ * @file RadioSim.h
+ * @brief Simulador de radios ED-137 para las pruebas de carga de CORESIP
+ *
+ *	Implementa la clase 'RadioSim'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_RADIOSIM_H__
+#define __CORESIP_RADIOSIM_H__
+
+#include <pjlib.h>
+#include <pjmedia.h>
+
+/**
+ * RadioSimGroup.
+ * Estado de cada grupo (frecuencia) en el simulador.
+ */
+struct RadioSimGroup
+{
+	pj_bool_t squ;						//Estado del squelch de las radios del grupo
+	pj_uint64_t t_squ_on;				//Instante (us) en el que se ha activado el squelch
+	int best_sess;						//Sesion con el mayor qidx en la rafaga en curso
+
+	pj_uint64_t t_last_egress;			//Instante (us) del ultimo paquete multicast recibido del grupo
+	pj_bool_t first_egress;				//Ya se ha recibido el primer paquete multicast de la rafaga en curso
+
+	pj_sock_t egress_sock;				//Socket por el que se recibe el audio que envia el votador al grupo
+};
+
+/**
+ * RadioSimConfig.
+ * Parametros del simulador.
+ */
+struct RadioSimConfig
+{
+	unsigned groups;					//Numero de grupos (frecuencias)
+	unsigned radios;					//Receptores por grupo
+	unsigned sip_port;					//Puerto SIP comun de todas las radios
+	unsigned rtp_port;					//Puerto RTP comun de todas las radios
+	unsigned egress_port;				//Puerto de destino del audio del votador del primer grupo. Los demas son consecutivos
+	unsigned voter_rtp_port;			//Primer puerto RTP del votador
+	unsigned burst_on_ms;				//Duracion de cada rafaga de squelch
+	unsigned burst_period_ms;			//Periodo de las rafagas de squelch de cada grupo
+	unsigned ka_period_ms;				//Periodo de los keepalive R2S sin squelch
+	unsigned ka_multiplier;
+};
+
+/**
+ * RadioSimEvents.
+ * Funciones a las que llama el simulador al medir. Se llaman desde los threads del simulador.
+ */
+struct RadioSimEvents
+{
+	void (*SquOn)(int group, int best_sess, pj_uint64_t t_us);
+	void (*Egress)(int group, pj_uint64_t t_us, pj_uint64_t t_squ_on_us, pj_bool_t first, pj_uint64_t t_prev_us);
+	void (*Ptt)(int radio, unsigned ptt_type, pj_uint64_t t_us);
+};
+
+/**
+ * RadioSim.
+ * Simula groups*radios radios ED-137 en modo Rx sobre UDP en 127.0.0.1:
+ *	- Un UAS SIP minimo en un unico puerto, que distingue las radios por el usuario de la uri (rx-<grupo>-<sesion>).
+ *	  Responde 200 al INVITE con el SDP de radio, a BYE y a OPTIONS.
+ *	- Un unico puerto RTP. Las radios se distinguen por el puerto de origen del votador.
+ *	  Con squelch envia cada 20ms audio PCMA con la extension de cabecera ED-137 (SQU y TLV de Qidx). Sin squelch
+ *	  envia keepalives R2S. Contesta a cada RMM con un MAM en el siguiente paquete. Avisa de cada cambio del tipo
+ *	  de PTT en los paquetes del votador.
+ *	- Un socket por grupo que recibe el audio que el votador envia al multicast del grupo.
+ * Las rafagas de squelch de los grupos estan repartidas dentro del periodo. En cada rafaga se activan a la vez
+ * todas las radios del grupo, cada una con un qidx aleatorio.
+ */
+class RadioSim
+{
+public:
+	RadioSim(const RadioSimConfig *cfg, const RadioSimEvents *ev);
+	~RadioSim();
+
+	void Start();
+	void Stop();
+	void SetBursts(pj_bool_t on);
+
+	unsigned Connected();
+	unsigned MamSent();
+	pj_uint64_t ThreadsCpuUs();
+
+	static pj_uint64_t NowUs();
+	static pj_uint64_t ThreadCpuUs();
+	static pj_bool_t GetHeader(const char *msg, const char *name, char *line, int size);
+
+private:
+	struct Radio
+	{
+		int group;
+		int sess;
+		pj_bool_t connected;
+		pj_sockaddr_in voter_rtp;
+		char call_id[128];
+
+		pj_uint16_t seq;
+		pj_uint32_t ts;
+		pj_uint32_t ssrc;
+		pj_bool_t squ;
+		unsigned qidx;
+		float phase;
+
+		pj_bool_t mam_pending;			//Se ha recibido un RMM y hay que enviar el MAM
+		pj_uint32_t mam_T1;
+		pj_uint32_t mam_TQG;
+		pj_uint64_t mam_rx_us;			//Instante en el que se recibio el RMM, para calcular Tsd
+
+		unsigned rx_ptt;				//Tipo de PTT del ultimo paquete del votador. Solo lo usa el thread de recepcion
+	};
+
+	RadioSimConfig _Cfg;
+	RadioSimEvents _Ev;
+	pj_pool_t *_Pool;
+	Radio *_Radios;
+	RadioSimGroup *_Groups;
+	int *_RadioByVoterPort;				//Indice de la radio segun el puerto RTP del votador
+	unsigned _NVoterPorts;
+
+	pj_sock_t _SipSock;
+	pj_sock_t _RtpSock;
+
+	pj_thread_t *_RxThread;
+	pj_thread_t *_TxThread;
+	volatile pj_bool_t _Run;
+	volatile pj_bool_t _Bursts;
+	volatile unsigned _MamSent;
+
+	pj_mutex_t *_Mutex;					//Protege el estado de las radios entre el thread de recepcion y el de envio
+	volatile pj_uint64_t _RxCpuUs;
+	volatile pj_uint64_t _TxCpuUs;
+
+	static int RxTh(void *proc);
+	static int TxTh(void *proc);
+	static pj_uint32_t ClimaxTime();
+
+	void OnSip(char *msg, int len, const pj_sockaddr_in *from);
+	void OnRtp(const pj_uint8_t *pkt, int len, const pj_sockaddr_in *from);
+	void OnEgress(int group, pj_uint64_t now);
+	void SendRtp(Radio *r, pj_bool_t audio);
+	void TickBursts(pj_uint64_t now, pj_uint64_t t0);
+};
+
+#endif
+
+/*@}*/
@@ -0,0 +1,227 @@
+/**
+ * @file RecorderTest.cpp
+ * @brief Prueba de CORESIP: comandos de squelch al grabador (--recorder)
+ *
+ *	Con --recorder N no abre sesiones: un RecordPort de radio envia la activacion y desactivacion del squelch
+ *	de N frecuencias a un grabador simulado en UDP, que pierde un comando y contesta tarde a otro. Comprueba que
+ *	el grabador recibe cada comando una vez, salvo el de la respuesta tardia, y que ninguna respuesta se atribuye
+ *	a otro comando.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "Global.h"
+#include "SipAgent.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#define REC_LATE_MS			3500		//Respuesta tardia del grabador simulado. Pasa del timeout de RecordPort (3 s)
+#define REC_TIMEOUT_US		30000000	//Espera maxima a que RecordPort no tenga comandos pendientes
+
+/**
+ * Grabador simulado de --recorder. Contesta G,E00,0 a todo, salvo que pierde el primer envio de 'drop' y
+ * contesta el primero de 'late' pasados REC_LATE_MS.
+ */
+struct RecorderSim
+{
+	pj_sock_t sock;
+	volatile pj_bool_t run;
+	volatile pj_bool_t session;			//Contestado el inicio de sesion de radio
+	volatile unsigned answered;			//Comandos contestados, sin los de sesion
+	char drop[64];
+	char late[64];
+	std::vector<std::string> commands;	//Comandos contestados, en orden. Se leen cuando el thread ha terminado
+};
+
+/**
+ * RecorderThread.	...
+ * Thread del grabador simulado. Ignora los mensajes de media.
+ */
+static int RecorderThread(void *arg)
+{
+	RecorderSim *sim = (RecorderSim *) arg;
+	pj_bool_t dropped = PJ_FALSE, delayed = PJ_FALSE;
+
+	while (sim->run)
+	{
+		pj_fd_set_t rset;
+		pj_time_val tout = { 0, 100 };
+		PJ_FD_ZERO(&rset);
+		PJ_FD_SET(sim->sock, &rset);
+		if (pj_sock_select((int) sim->sock + 1, &rset, NULL, NULL, &tout) <= 0) continue;
+
+		char buf[RecordPort::MAX_COMMAND_LEN + 1];
+		pj_ssize_t len = RecordPort::MAX_COMMAND_LEN;
+		pj_sockaddr_in from;
+		int fromlen = sizeof(from);
+		if (pj_sock_recvfrom(sim->sock, buf, &len, 0, &from, &fromlen) != PJ_SUCCESS || len <= 0) continue;
+		buf[len] = '\0';
+
+		if (strncmp(buf, "V,MMM,", 6) == 0) continue;
+		if (!dropped && strcmp(buf, sim->drop) == 0)
+		{
+			dropped = PJ_TRUE;
+			continue;
+		}
+		if (!delayed && strcmp(buf, sim->late) == 0)
+		{
+			delayed = PJ_TRUE;
+			pj_thread_sleep(REC_LATE_MS);
+		}
+
+		pj_ssize_t rlen = 7;
+		pj_sock_sendto(sim->sock, "G,E00,0", &rlen, 0, &from, fromlen);
+
+		sim->commands.push_back(buf);
+		if (strncmp(buf, "V,G00,", 6) == 0) sim->session = PJ_TRUE;
+		else if (strncmp(buf, "V,G02,", 6) == 0 || strncmp(buf, "V,G03,", 6) == 0) sim->answered++;
+	}
+	return 0;
+}
+
+/**
+ * RecorderIdle.	...
+ * @return	PJ_TRUE si el RecordPort no tiene comandos en cola ni pendientes de respuesta.
+ */
+static pj_bool_t RecorderIdle(RecordPort *rec)
+{
+	RecordPort::REC_COMMAND_STATS s;
+	rec->GetCommandStats(&s);
+	return (s.queued == 0 && s.in_flight == 0);
+}
+
+/**
+ * RunRecorder.	...
+ * Comandos al grabador. Activa y desactiva el squelch de cfg.recorder frecuencias en un RecordPort de radio
+ * conectado al grabador simulado. Este pierde el primer envio de la activacion de la frecuencia cfg.recorder / 2
+ * y contesta tarde, despues del timeout, a la de cfg.recorder / 4, por lo que RecordPort la reenvia y recibe
+ * dos respuestas.
+ * @return	0 si el grabador ha recibido una vez cada comando, y dos el de la respuesta tardia, la respuesta
+ *			sobrante se ha ignorado y no ha quedado ninguna sin comando.
+ */
+int RunRecorder()
+{
+	RecorderSim sim;
+	pj_sockaddr_in addr;
+	pj_str_t host;
+	int ret = 0;
+
+	if (cfg.recorder < 4 || cfg.recorder > 64)
+	{
+		fprintf(stderr, "ERROR: --recorder admite de 4 a 64 frecuencias\n");
+		return 1;
+	}
+
+	sim.run = PJ_TRUE;
+	sim.session = PJ_FALSE;
+	sim.answered = 0;
+	pj_ansi_snprintf(sim.drop, sizeof(sim.drop), "V,G02,LoadTest-RAD,F%03u", cfg.recorder / 2);
+	pj_ansi_snprintf(sim.late, sizeof(sim.late), "V,G02,LoadTest-RAD,F%03u", cfg.recorder / 4);
+
+	pj_sockaddr_in_init(&addr, pj_cstr(&host, "127.0.0.1"), (pj_uint16_t) cfg.recorder_port);
+	if (pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &sim.sock) != PJ_SUCCESS) return 1;
+	if (pj_sock_bind(sim.sock, &addr, sizeof(addr)) != PJ_SUCCESS)
+	{
+		fprintf(stderr, "ERROR enlazando el grabador simulado al puerto %u\n", cfg.recorder_port);
+		pj_sock_close(sim.sock);
+		return 1;
+	}
+
+	pj_pool_t *pool = pjsua_pool_create("Recorder", 512, 512);
+	pj_thread_t *th;
+	if (pj_thread_create(pool, "RecorderSim", &RecorderThread, &sim, 0, 0, &th) != PJ_SUCCESS)
+	{
+		pj_sock_close(sim.sock);
+		pj_pool_release(pool);
+		return 1;
+	}
+
+	RecordPort *rec = NULL;
+	try
+	{
+		rec = new RecordPort(RecordPort::RAD_RESOURCE, "127.0.0.1", "127.0.0.1", cfg.recorder_port, "LoadTest");
+	}
+	catch (...)
+	{
+		fprintf(stderr, "ERROR creando el RecordPort\n");
+		ret = 1;
+	}
+
+	//Inicio de sesion
+	pj_uint64_t t0 = RadioSim::NowUs();
+	while (ret == 0 && !(sim.session && RecorderIdle(rec)))
+	{
+		if (RadioSim::NowUs() - t0 > REC_TIMEOUT_US)
+		{
+			fprintf(stderr, "ERROR: el RecordPort no abre sesion con el grabador simulado\n");
+			ret = 1;
+		}
+		pj_thread_sleep(20);
+	}
+
+	RecordPort::REC_COMMAND_STATS s0, s1;
+	double wall_s = 0;
+	if (ret == 0)
+	{
+		rec->GetCommandStats(&s0);
+
+		char freq[16], res[16];
+		t0 = RadioSim::NowUs();
+		for (unsigned i = 0; i < 2 * cfg.recorder; i++)
+		{
+			pj_ansi_snprintf(freq, sizeof(freq), "F%03u", i % cfg.recorder);
+			pj_ansi_snprintf(res, sizeof(res), "RX%03u", i % cfg.recorder);
+			rec->RecSQU(i < cfg.recorder, freq, res, "RSSI", 0);
+		}
+
+		//Un comando por cada cambio de squelch, y otro envio del de la respuesta tardia
+		while (!(sim.answered >= 2 * cfg.recorder + 1 && RecorderIdle(rec)) && RadioSim::NowUs() - t0 < REC_TIMEOUT_US)
+		{
+			pj_thread_sleep(20);
+		}
+		wall_s = (RadioSim::NowUs() - t0) / 1e6;
+		pj_thread_sleep(200);
+		rec->GetCommandStats(&s1);
+	}
+
+	if (rec != NULL) delete rec;
+	sim.run = PJ_FALSE;
+	pj_thread_join(th);
+	pj_thread_destroy(th);
+	pj_sock_close(sim.sock);
+	pj_pool_release(pool);
+	if (ret != 0) return ret;
+
+	unsigned missing = 0, repeated = 0;
+	for (unsigned i = 0; i < 2 * cfg.recorder; i++)
+	{
+		char cmd[64];
+		pj_ansi_snprintf(cmd, sizeof(cmd), "V,%s,LoadTest-RAD,F%03u", i < cfg.recorder ? "G02" : "G03", i % cfg.recorder);
+		unsigned n = (unsigned) std::count(sim.commands.begin(), sim.commands.end(), std::string(cmd));
+		unsigned expected = (strcmp(cmd, sim.late) == 0) ? 2 : 1;
+		if (n < expected) missing++;
+		else if (n > expected) repeated++;
+	}
+
+	printf("Grabador: %u cambios de squelch en %.2f s. Comandos sin recibir %u, repetidos %u. Envios %u, reenvios %u, "
+		"timeouts %u, respuestas tardias %u (esperada 1), sin comando %u\n", 2 * cfg.recorder, wall_s, missing, repeated,
+		s1.sent - s0.sent, s1.retries - s0.retries, s1.timeouts - s0.timeouts, s1.late - s0.late,
+		s1.unmatched - s0.unmatched);
+	if (missing != 0 || repeated != 0 || s1.retries - s0.retries != 2 || s1.timeouts != s0.timeouts ||
+		s1.late - s0.late != 1 || s1.unmatched != s0.unmatched)
+	{
+		ret = 1;
+	}
+	return ret;
+}
+
+/*@}*/
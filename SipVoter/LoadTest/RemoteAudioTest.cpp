@@ -0,0 +1,208 @@
+/**
+ * @file RemoteAudioTest.cpp
+ * @brief Prueba de carga de CORESIP: audio de los puestos remotos (--remote-audio)
+ *
+ *	Con --remote-audio N no abre sesiones: envia al votador audio de N puestos remotos en cada formato de
+ *	RemoteAudio y mide los bytes y la CPU del votador por trama. Despues envia una secuencia con perdidas,
+ *	repetidas y desordenadas conocidas y comprueba las estadisticas de CORESIP_GetSndRxStats.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "Global.h"
+#include "RemoteAudio.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+#define REMOTE_AUDIO_GROUP	"239.255.17.1"	//Grupo multicast del audio de los puestos remotos
+#define REMOTE_AUDIO_ROUNDS	2000		//Tramas por puesto en cada formato
+
+/**
+ * SumSndRxStats.	...
+ * Suma las estadisticas de un tipo de emisor de todos los puertos. El jitter es el maximo.
+ */
+static void SumSndRxStats(const std::vector<int> &ports, CORESIP_SndDevType type, CORESIP_SndRxStats *sum)
+{
+	CORESIP_SndRxStats stats[CORESIP_SND_MAX_IN_DEVICES];
+	CORESIP_Error err;
+
+	pj_bzero(sum, sizeof(*sum));
+	for (unsigned i = 0; i < ports.size(); i++)
+	{
+		if (CORESIP_GetSndRxStats(ports[i], stats, &err) != 0) continue;
+
+		sum->Received += stats[type].Received;
+		sum->Lost += stats[type].Lost;
+		sum->Duplicated += stats[type].Duplicated;
+		sum->Reordered += stats[type].Reordered;
+		sum->Late += stats[type].Late;
+		sum->Restarts += stats[type].Restarts;
+		sum->Unsequenced += stats[type].Unsequenced;
+		sum->JitterMs = PJ_MAX(sum->JitterMs, stats[type].JitterMs);
+	}
+}
+
+/**
+ * SendImpaired.	...
+ * Envia la trama seq de la secuencia de prueba de un puesto, en formato compacto G.711 A. Se envia una por
+ * milisegundo, y asi avanza el Ts, para que el jitter medido sea el del envio y no el de ir mas rapido que PTIME.
+ */
+static void SendImpaired(pj_sock_t sock, const pj_sockaddr_in *to, pj_uint32_t src_id, pj_uint32_t seq)
+{
+	pj_uint32_t buf[(sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME) / 4];
+	RemoteCompactHdr *hdr = (RemoteCompactHdr *) buf;
+
+	hdr->Magic = REMOTE_COMPACT_MAGIC;
+	hdr->Version = REMOTE_COMPACT_VERSION;
+	hdr->Pt = REMOTE_AUDIO_PCMA;
+	hdr->SrcType = CORESIP_SND_ALUMN_MHP;
+	hdr->SrcId = pj_htonl(src_id);
+	hdr->Seq = pj_htonl(seq);
+	hdr->Ts = pj_htonl(seq * (SAMPLING_RATE / 1000));
+	pj_memset(hdr + 1, 0xD5, SAMPLES_PER_FRAME);
+
+	pj_ssize_t size = sizeof(buf);
+	pj_sock_sendto(sock, buf, &size, 0, to, sizeof(*to));
+}
+
+/**
+ * RunRemoteAudio.	...
+ * Audio de los puestos remotos. Crea cfg.remote_audio puertos SoundRxPort y les envia desde este thread, en cada
+ * formato, REMOTE_AUDIO_ROUNDS tramas por puerto con RemoteAudioTx, una de cada puerto por milisegundo. La CPU del
+ * votador es la del proceso menos la de este thread y menos la que consume sin audio en el mismo tiempo.
+ * Despues, por cada 100 tramas de cada puerto, se pierde la 10, se repite la 30, se intercambian la 50 y la 51 y
+ * la 70 se envia tras la 76, mas alla del buffer de 3 tramas.
+ * @return	0 si han llegado todas las tramas y las estadisticas son las esperadas.
+ */
+int RunRemoteAudio()
+{
+	static const char *names[] = { "Original", "L16", "G.711 A" };
+	static const unsigned formats[] = { REMOTE_AUDIO_LEGACY, REMOTE_AUDIO_L16, REMOTE_AUDIO_PCMA };
+	static const unsigned sizes[] = { sizeof(RemotePayload), sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME * 2,
+		sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME };
+	CORESIP_Error err;
+	char name[64];
+	int ret = 0;
+
+	std::vector<int> ports(cfg.remote_audio, -1);
+	for (unsigned i = 0; i < cfg.remote_audio; i++)
+	{
+		pj_ansi_snprintf(name, sizeof(name), "puesto-%u", i);
+		if (CORESIP_CreateSndRxPort(name, &ports[i], &err) != 0)
+		{
+			fprintf(stderr, "ERROR creando el puerto %s: %s\n", name, err.Info);
+			return 1;
+		}
+	}
+	if (CORESIP_ReceiveFromRemote("127.0.0.1", REMOTE_AUDIO_GROUP, cfg.remote_audio_port, &err) != 0)
+	{
+		fprintf(stderr, "ERROR recibiendo el audio remoto: %s\n", err.Info);
+		return 1;
+	}
+
+	pj_sock_t sock;
+	pj_sockaddr_in to;
+	if (pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &sock) != PJ_SUCCESS) return 1;
+	pj_str_t host;
+	pj_sockaddr_in_init(&to, pj_cstr(&host, "127.0.0.1"), (pj_uint16_t) cfg.remote_audio_port);
+
+	pj_int16_t pcm[SAMPLES_PER_FRAME];
+	for (unsigned i = 0; i < SAMPLES_PER_FRAME; i++) pcm[i] = (pj_int16_t) ((i % 40) * 800 - 16000);
+
+	std::vector<RemoteAudioTx> tx(cfg.remote_audio);
+	unsigned frames = cfg.remote_audio * REMOTE_AUDIO_ROUNDS;
+
+	//CPU del votador sin audio, por segundo
+	pj_uint64_t idle0 = ProcessCpuUs();
+	pj_uint64_t t_idle = RadioSim::NowUs();
+	for (unsigned r = 0; r < REMOTE_AUDIO_ROUNDS; r++) pj_thread_sleep(1);
+	double idle_us_s = (double) (ProcessCpuUs() - idle0) / ((RadioSim::NowUs() - t_idle) / 1e6);
+
+	printf("Audio de %u puestos remotos, %u tramas por formato. Sin audio el votador consume %.1f ms/s\n",
+		cfg.remote_audio, frames, idle_us_s / 1000.0);
+	for (unsigned f = 0; f < PJ_ARRAY_SIZE(formats); f++)
+	{
+		for (unsigned i = 0; i < cfg.remote_audio; i++)
+		{
+			pj_ansi_snprintf(name, sizeof(name), "puesto-%u", i);
+			tx[i].Init(name, CORESIP_SND_INSTRUCTOR_MHP, formats[f]);
+		}
+
+		CORESIP_SndRxStats s0, s1;
+		SumSndRxStats(ports, CORESIP_SND_INSTRUCTOR_MHP, &s0);
+
+		pj_uint64_t cpu0 = ProcessCpuUs();
+		pj_uint64_t self0 = RadioSim::ThreadCpuUs();
+		pj_uint64_t t0 = RadioSim::NowUs();
+		for (unsigned r = 0; r < REMOTE_AUDIO_ROUNDS; r++)
+		{
+			for (unsigned i = 0; i < cfg.remote_audio; i++) tx[i].Send(sock, &to, pcm);
+			pj_thread_sleep(1);
+		}
+		pj_thread_sleep(100);
+		pj_uint64_t self_us = RadioSim::ThreadCpuUs() - self0;
+		double wall_s = (RadioSim::NowUs() - t0) / 1e6;
+		double cpu_us = (double) (ProcessCpuUs() - cpu0) - (double) self_us - idle_us_s * wall_s;
+
+		SumSndRxStats(ports, CORESIP_SND_INSTRUCTOR_MHP, &s1);
+
+		printf("%-9s %3u bytes/trama (%.0f kbit/s por puesto). Envio %.2f us/trama, votador %.2f us/trama en %.2f s. "
+			"Recibidas %u, perdidas %u\n",
+			names[f], sizes[f], sizes[f] * 8 * (1000.0 / PTIME) / 1000.0, (double) self_us / frames, cpu_us / frames, wall_s,
+			s1.Received - s0.Received, s1.Lost - s0.Lost);
+		if (s1.Received - s0.Received != frames) ret = 1;
+	}
+
+	//Secuencia con incidencias conocidas
+	std::vector<pj_uint32_t> order;
+	for (pj_uint32_t k = 0; k < REMOTE_AUDIO_ROUNDS; k++)
+	{
+		switch (k % 100)
+		{
+		case 10: break;
+		case 30: order.push_back(k); order.push_back(k); break;
+		case 50: order.push_back(k + 1); order.push_back(k); break;
+		case 51: break;
+		case 70: break;
+		case 76: order.push_back(k); order.push_back(k - 6); break;
+		default: order.push_back(k); break;
+		}
+	}
+	for (unsigned n = 0; n < order.size(); n++)
+	{
+		for (unsigned i = 0; i < cfg.remote_audio; i++)
+		{
+			pj_ansi_snprintf(name, sizeof(name), "puesto-%u", i);
+			SendImpaired(sock, &to, RemoteAudio::SrcId(name), order[n]);
+		}
+		pj_thread_sleep(1);
+	}
+	pj_thread_sleep(100);
+
+	CORESIP_SndRxStats s;
+	unsigned each = cfg.remote_audio * REMOTE_AUDIO_ROUNDS / 100;
+	SumSndRxStats(ports, CORESIP_SND_ALUMN_MHP, &s);
+	printf("Incidencias: recibidas %u de %u, perdidas %u, repetidas %u, desordenadas %u, tardias %u (esperadas %u de cada). "
+		"Jitter max %.2f ms\n", s.Received, (unsigned) order.size() * cfg.remote_audio, s.Lost, s.Duplicated, s.Reordered,
+		s.Late, each, s.JitterMs);
+	printf("SndRxStatsCb: %u informes\n", sndrx_reports);
+	if (s.Received != order.size() * cfg.remote_audio || s.Lost != each || s.Duplicated != each || s.Reordered != each ||
+		s.Late != each)
+	{
+		ret = 1;
+	}
+
+	pj_sock_close(sock);
+	for (unsigned i = 0; i < cfg.remote_audio; i++) CORESIP_DestroySndRxPort(ports[i], &err);
+	return ret;
+}
+
+/*@}*/
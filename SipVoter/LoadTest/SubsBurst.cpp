@@ -0,0 +1,327 @@
+/**
+ * @file SubsBurst.cpp
+ * @brief Rafaga de subscripciones al evento de dialogo para las pruebas de carga de CORESIP
+ *
+ *	Implementa la clase 'SubsBurst'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "RadioSim.h"
+#include "SubsBurst.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define THIS_FILE			"SubsBurst.cpp"
+
+#define MAX_SIP_MSG			4000
+#define ROUND_TIMEOUT_US	30000000		//Se abandona la ronda si no se han contestado todos en este tiempo
+
+/**
+ * SubsBurst.	...
+ * Constructor. Abre el socket. El thread de recepcion se arranca con Start().
+ * @param	n			Numero de usuarios.
+ * @param	port		Puerto SIP de los usuarios.
+ * @param	voter_port	Puerto SIP del votador.
+ * @param	window		Maximo de SUBSCRIBE enviados sin respuesta.
+ */
+SubsBurst::SubsBurst(unsigned n, unsigned port, unsigned voter_port, unsigned window)
+{
+	_N = n;
+	_Port = port;
+	_VoterPort = voter_port;
+	_Window = window;
+	_Round = 0;
+	_InDialog = PJ_FALSE;
+	_RxThread = NULL;
+	_Run = PJ_FALSE;
+	_Answered = 0;
+	_Notifies = 0;
+	_Sock = PJ_INVALID_SOCKET;
+
+	_Pool = pjsua_pool_create("SubsBurst", 1024, 1024);
+	pj_mutex_create_simple(_Pool, "SubsBurstMtx", &_Mutex);
+	_TSent.assign(n, 0);
+	_TResp.assign(n, 0);
+	_DlgRound.assign(n, 0);
+	_ToTag.assign(n, std::string());
+}
+
+/**
+ * ~SubsBurst.	...
+ * Destructor.
+ */
+SubsBurst::~SubsBurst()
+{
+	Stop();
+	pj_mutex_destroy(_Mutex);
+	pj_pool_release(_Pool);
+}
+
+/**
+ * Start.	...
+ * Abre el socket de los usuarios y arranca el thread de recepcion.
+ */
+pj_status_t SubsBurst::Start()
+{
+	pj_sockaddr_in addr;
+
+	pj_status_t st = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &_Sock);
+	if (st != PJ_SUCCESS) return st;
+
+	int bufsize = 4 * 1024 * 1024;
+	pj_sock_setsockopt(_Sock, pj_SOL_SOCKET(), pj_SO_RCVBUF(), &bufsize, sizeof(bufsize));
+
+	pj_str_t host;
+	pj_sockaddr_in_init(&addr, pj_cstr(&host, "127.0.0.1"), (pj_uint16_t) _Port);
+	st = pj_sock_bind(_Sock, &addr, sizeof(addr));
+	if (st != PJ_SUCCESS)
+	{
+		PJ_LOG(1,(THIS_FILE, "ERROR: no se puede abrir el puerto UDP %u", _Port));
+		pj_sock_close(_Sock);
+		_Sock = PJ_INVALID_SOCKET;
+		return st;
+	}
+
+	_Run = PJ_TRUE;
+	return pj_thread_create(_Pool, "SubsBurstRx", &RxTh, this, 0, 0, &_RxThread);
+}
+
+/**
+ * Stop.	...
+ * Para el thread y cierra el socket.
+ */
+void SubsBurst::Stop()
+{
+	if (_RxThread != NULL)
+	{
+		_Run = PJ_FALSE;
+		pj_thread_join(_RxThread);
+		pj_thread_destroy(_RxThread);
+		_RxThread = NULL;
+	}
+	if (_Sock != PJ_INVALID_SOCKET)
+	{
+		pj_sock_close(_Sock);
+		_Sock = PJ_INVALID_SOCKET;
+	}
+}
+
+/**
+ * Notifies.	...
+ * @return	Numero de NOTIFY recibidos.
+ */
+unsigned SubsBurst::Notifies()
+{
+	return _Notifies;
+}
+
+/**
+ * SendSubscribe.	...
+ * Envia el SUBSCRIBE de la ronda en curso de un usuario. Fuera de dialogo, Call-ID y tag son nuevos en cada ronda.
+ * En las rondas de ContactRound() va dentro del ultimo dialogo, con CSeq mayor y el contact sub-<i>-b.
+ */
+void SubsBurst::SendSubscribe(unsigned i)
+{
+	char msg[MAX_SIP_MSG];
+	char to_tag[300] = "";
+	pj_sockaddr_in voter;
+	unsigned call_round = _Round, cseq = 1;
+
+	if (_InDialog)
+	{
+		call_round = _DlgRound[i];
+		cseq = _Round + 1;
+		pj_ansi_snprintf(to_tag, sizeof(to_tag), ";tag=%s", _ToTag[i].c_str());
+	}
+
+	int n = pj_ansi_snprintf(msg, sizeof(msg),
+		"SUBSCRIBE sip:LoadTest@127.0.0.1:%u SIP/2.0\r\n"
+		"Via: SIP/2.0/UDP 127.0.0.1:%u;rport;branch=z9hG4bK-sb%u-%u\r\n"
+		"Max-Forwards: 70\r\n"
+		"From: <sip:sub-%u@127.0.0.1:%u>;tag=sb%u-%u\r\n"
+		"To: <sip:LoadTest@127.0.0.1:%u>%s\r\n"
+		"Call-ID: sb%u-%u@127.0.0.1\r\n"
+		"CSeq: %u SUBSCRIBE\r\n"
+		"Contact: <sip:sub-%u%s@127.0.0.1:%u>\r\n"
+		"Event: dialog\r\n"
+		"Accept: application/dialog-info+xml\r\n"
+		"Expires: 3600\r\n"
+		"Content-Length: 0\r\n"
+		"\r\n",
+		_VoterPort,
+		_Port, _Round, i,
+		i, _Port, call_round, i,
+		_VoterPort, to_tag,
+		call_round, i,
+		cseq,
+		i, _InDialog ? "-b" : "", _Port);
+
+	pj_str_t host;
+	pj_sockaddr_in_init(&voter, pj_cstr(&host, "127.0.0.1"), (pj_uint16_t) _VoterPort);
+	pj_ssize_t size = n;
+	pj_sock_sendto(_Sock, msg, &size, 0, &voter, sizeof(voter));
+}
+
+/**
+ * Round.	...
+ * Envia un SUBSCRIBE fuera de dialogo por usuario y espera las respuestas.
+ * @param	latency_ms	Tiempo hasta la respuesta final de cada SUBSCRIBE contestado.
+ * @return	Duracion de la ronda en segundos.
+ */
+double SubsBurst::Round(std::vector<double> &latency_ms)
+{
+	return RunRound(PJ_FALSE, latency_ms);
+}
+
+/**
+ * ContactRound.	...
+ * Envia un re-SUBSCRIBE con el contact sub-<i>-b dentro del ultimo dialogo de cada usuario y espera las respuestas.
+ * @param	latency_ms	Tiempo hasta la respuesta final de cada SUBSCRIBE contestado.
+ * @return	Duracion de la ronda en segundos.
+ */
+double SubsBurst::ContactRound(std::vector<double> &latency_ms)
+{
+	return RunRound(PJ_TRUE, latency_ms);
+}
+
+/**
+ * RunRound.	...
+ * Envia un SUBSCRIBE por usuario, con como mucho _Window sin contestar, y espera las respuestas.
+ * @param	in_dialog	Los SUBSCRIBE van dentro del ultimo dialogo de cada usuario.
+ * @param	latency_ms	Tiempo hasta la respuesta final de cada SUBSCRIBE contestado.
+ * @return	Duracion de la ronda en segundos.
+ */
+double SubsBurst::RunRound(pj_bool_t in_dialog, std::vector<double> &latency_ms)
+{
+	pj_mutex_lock(_Mutex);
+	_Round++;
+	_InDialog = in_dialog;
+	_Answered = 0;
+	for (unsigned i = 0; i < _N; i++) _TSent[i] = _TResp[i] = 0;
+	pj_mutex_unlock(_Mutex);
+
+	pj_uint64_t t0 = RadioSim::NowUs();
+	for (unsigned i = 0; i < _N; i++)
+	{
+		while (i - _Answered >= _Window && RadioSim::NowUs() - t0 < ROUND_TIMEOUT_US) pj_thread_sleep(1);
+
+		pj_mutex_lock(_Mutex);
+		_TSent[i] = RadioSim::NowUs();
+		pj_mutex_unlock(_Mutex);
+		SendSubscribe(i);
+	}
+	while (_Answered < _N && RadioSim::NowUs() - t0 < ROUND_TIMEOUT_US) pj_thread_sleep(1);
+	pj_uint64_t t1 = RadioSim::NowUs();
+
+	pj_mutex_lock(_Mutex);
+	latency_ms.clear();
+	for (unsigned i = 0; i < _N; i++)
+	{
+		if (_TResp[i] != 0) latency_ms.push_back((_TResp[i] - _TSent[i]) / 1000.0);
+	}
+	pj_mutex_unlock(_Mutex);
+
+	return (t1 - t0) / 1e6;
+}
+
+/**
+ * OnSip.	...
+ * Respuestas a los SUBSCRIBE y NOTIFY del votador.
+ */
+void SubsBurst::OnSip(char *msg, int len, const pj_sockaddr_in *from)
+{
+	char via[512], from_hdr[512], to[512], callid[256], cseq[64], resp[MAX_SIP_MSG];
+	unsigned round, i, code, cseq_num;
+
+	msg[len] = '\0';
+	if (!RadioSim::GetHeader(msg, "Call-ID", callid, sizeof(callid)) || !RadioSim::GetHeader(msg, "CSeq", cseq, sizeof(cseq)))
+	{
+		return;
+	}
+
+	if (sscanf(msg, "SIP/2.0 %u", &code) == 1)
+	{
+		//Solo cuentan las respuestas finales al SUBSCRIBE de la ronda en curso
+		if (code < 200 || strstr(cseq, "SUBSCRIBE") == NULL) return;
+		if (sscanf(callid, "Call-ID: sb%u-%u@", &round, &i) != 2) return;
+		if (sscanf(cseq, "CSeq: %u", &cseq_num) != 1) return;
+
+		pj_mutex_lock(_Mutex);
+		if (i < _N && _TSent[i] != 0 && _TResp[i] == 0 &&
+			(_InDialog ? (round == _DlgRound[i] && cseq_num == _Round + 1) : (round == _Round && cseq_num == 1)))
+		{
+			_TResp[i] = RadioSim::NowUs();
+			_Answered++;
+
+			//El dialogo que ha creado este SUBSCRIBE es el que usa ContactRound()
+			const char *tag = RadioSim::GetHeader(msg, "To", to, sizeof(to)) ? strstr(to, ";tag=") : NULL;
+			if (!_InDialog && code / 100 == 2 && tag != NULL)
+			{
+				tag += 5;
+				_DlgRound[i] = round;
+				_ToTag[i].assign(tag, strcspn(tag, ";> \t"));
+			}
+		}
+		pj_mutex_unlock(_Mutex);
+		return;
+	}
+
+	if (strncmp(msg, "NOTIFY ", 7) != 0) return;
+	if (!RadioSim::GetHeader(msg, "Via", via, sizeof(via)) || !RadioSim::GetHeader(msg, "From", from_hdr, sizeof(from_hdr)) ||
+		!RadioSim::GetHeader(msg, "To", to, sizeof(to)))
+	{
+		return;
+	}
+	_Notifies++;
+
+	int n = pj_ansi_snprintf(resp, sizeof(resp),
+		"SIP/2.0 200 OK\r\n"
+		"%s;received=127.0.0.1\r\n"
+		"%s\r\n"
+		"%s\r\n"
+		"%s\r\n"
+		"%s\r\n"
+		"Content-Length: 0\r\n"
+		"\r\n",
+		via, from_hdr, to, callid, cseq);
+
+	pj_ssize_t size = n;
+	pj_sock_sendto(_Sock, resp, &size, 0, from, sizeof(*from));
+}
+
+/**
+ * RxTh.	...
+ * Thread de recepcion.
+ */
+int SubsBurst::RxTh(void *proc)
+{
+	SubsBurst *wp = (SubsBurst *) proc;
+	char buf[MAX_SIP_MSG + 1];
+
+	while (wp->_Run)
+	{
+		pj_fd_set_t rset;
+		pj_time_val tv = {0, 50};
+
+		PJ_FD_ZERO(&rset);
+		PJ_FD_SET(wp->_Sock, &rset);
+		if (pj_sock_select(FD_SETSIZE, &rset, NULL, NULL, &tv) <= 0) continue;
+
+		pj_sockaddr_in from;
+		int fromlen = sizeof(from);
+		pj_ssize_t size = MAX_SIP_MSG;
+		if (pj_sock_recvfrom(wp->_Sock, buf, &size, 0, &from, &fromlen) == PJ_SUCCESS && size > 0)
+		{
+			wp->OnSip(buf, (int) size, &from);
+		}
+	}
+
+	return 0;
+}
+
+/*@}*/
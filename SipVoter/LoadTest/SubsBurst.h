@@ -0,0 +1,70 @@
+/**
+ * @file SubsBurst.h
+ * @brief Rafaga de subscripciones al evento de dialogo para las pruebas de carga de CORESIP
+ *
+ *	Implementa la clase 'SubsBurst'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_SUBSBURST_H__
+#define __CORESIP_SUBSBURST_H__
+
+#include <pjlib.h>
+#include <vector>
+#include <string>
+
+/**
+ * SubsBurst.
+ * Simula n usuarios que se subscriben al evento de dialogo del votador desde un unico puerto UDP en 127.0.0.1,
+ * cada uno con su uri (sub-<i>) y su contact. Contesta 200 a los NOTIFY.
+ * Cada ronda envia un SUBSCRIBE fuera de dialogo por usuario, con Call-ID y tag nuevos, como los que llegan tras
+ * caer el proxy. En la primera ronda se dan de alta las subscripciones; en las siguientes cada SUBSCRIBE sustituye
+ * a la subscripcion anterior del mismo usuario.
+ * ContactRound() envia en cambio un re-SUBSCRIBE dentro del ultimo dialogo de cada usuario, con el contact
+ * sub-<i>-b, como un usuario que ha cambiado de direccion.
+ */
+class SubsBurst
+{
+public:
+	SubsBurst(unsigned n, unsigned port, unsigned voter_port, unsigned window);
+	~SubsBurst();
+
+	pj_status_t Start();
+	void Stop();
+
+	double Round(std::vector<double> &latency_ms);
+	double ContactRound(std::vector<double> &latency_ms);
+	unsigned Notifies();
+
+private:
+	unsigned _N;
+	unsigned _Port;
+	unsigned _VoterPort;
+	unsigned _Window;						//Maximo de SUBSCRIBE sin respuesta
+	unsigned _Round;
+
+	pj_pool_t *_Pool;
+	pj_sock_t _Sock;
+	pj_thread_t *_RxThread;
+	volatile pj_bool_t _Run;
+
+	pj_mutex_t *_Mutex;
+	std::vector<pj_uint64_t> _TSent;		//Instante de envio de cada SUBSCRIBE de la ronda en curso
+	std::vector<pj_uint64_t> _TResp;		//Instante de la respuesta final
+	std::vector<unsigned> _DlgRound;		//Ronda del SUBSCRIBE que ha creado el dialogo de cada usuario (Call-ID y tag)
+	std::vector<std::string> _ToTag;		//Tag del votador en ese dialogo
+	pj_bool_t _InDialog;					//La ronda en curso es de ContactRound()
+	volatile unsigned _Answered;
+	volatile unsigned _Notifies;
+
+	static int RxTh(void *proc);
+	void OnSip(char *msg, int len, const pj_sockaddr_in *from);
+	double RunRound(pj_bool_t in_dialog, std::vector<double> &latency_ms);
+	void SendSubscribe(unsigned i);
+};
+
+#endif
+
+/*@}*/
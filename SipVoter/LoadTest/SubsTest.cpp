@@ -0,0 +1,125 @@
+/**
+ * @file SubsTest.cpp
+ * @brief Prueba de carga de CORESIP: rafaga de subscripciones al evento de dialogo (--subs)
+ *
+ *	Con --subs N no abre sesiones de radio: mide una rafaga de N subscripciones entrantes al evento de dialogo,
+ *	primero el alta y despues la misma rafaga con Call-ID y tag nuevos, como los refrescos tras caer el proxy.
+ *	Al final cada usuario cambia de contact con un re-SUBSCRIBE y se comprueba que Get_subMod encuentra su
+ *	subscripcion por el contact nuevo y no por el antiguo.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "SubsBurst.h"
+#include "Global.h"
+#include "ExtraParamAccId.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define NOTIFY_TIMEOUT_US	60000000	//Espera maxima a los NOTIFY de cada ronda de subscripciones
+
+/**
+ * CountSubsByContact.	...
+ * Cuenta los usuarios cuya subscripcion al evento de dialogo encuentra Get_subMod con el contact sub-<i><suffix>.
+ */
+static unsigned CountSubsByContact(const char *suffix)
+{
+	pj_str_t event;
+	pj_cstr(&event, "dialog");
+	pj_pool_t *pool = pjsua_pool_create("SubsTest", 512, 512);
+	unsigned found = 0;
+
+	//La cuenta a la que van los SUBSCRIBE, como la busca SipAgent::OnRxRequest
+	char voter[64];
+	int vlen = pj_ansi_snprintf(voter, sizeof(voter), "sip:LoadTest@127.0.0.1:%u", cfg.voter_sip_port);
+	pjsip_uri *voter_uri = pjsip_parse_uri(pool, voter, vlen, 0);
+	pjsua_acc_id accid = voter_uri != NULL ? pjsua_acc_find_for_incoming_by_uri(voter_uri) : PJSUA_INVALID_ID;
+
+	for (unsigned i = 0; i < cfg.subs; i++)
+	{
+		char uri[128];
+		int len = pj_ansi_snprintf(uri, sizeof(uri), "<sip:sub-%u%s@127.0.0.1:%u>", i, suffix, cfg.subs_port);
+		pjsip_uri *contact = pjsip_parse_uri(pool, uri, len, PJSIP_PARSE_URI_AS_NAMEADDR);		//Como el From de OnRxRequest
+		if (contact != NULL && accid != PJSUA_INVALID_ID && ExtraParamAccId::Get_subMod(accid, contact, &event) != NULL) found++;
+	}
+
+	pj_pool_release(pool);
+	return found;
+}
+
+/**
+ * RunSubsBurst.	...
+ * Rafaga de subscripciones al evento de dialogo: alta de cfg.subs usuarios, despues refresco de todos y por ultimo
+ * un re-SUBSCRIBE de cada uno con otro contact.
+ * @return	0 si se han contestado todos los SUBSCRIBE y las subscripciones se encuentran por el contact nuevo.
+ */
+int RunSubsBurst()
+{
+	static const char *names[] = { "Alta", "Refresco" };
+	std::vector<double> latency_ms;
+	int ret = 0;
+
+	SubsBurst *burst = new SubsBurst(cfg.subs, cfg.subs_port, cfg.voter_sip_port, 64);
+	if (burst->Start() != PJ_SUCCESS)
+	{
+		delete burst;
+		return 1;
+	}
+
+	printf("Rafaga de %u subscripciones al evento de dialogo\n", cfg.subs);
+	for (unsigned r = 0; r < PJ_ARRAY_SIZE(names); r++)
+	{
+		pj_uint64_t cpu0 = ProcessCpuUs();
+		double wall_s = burst->Round(latency_ms);
+		double cpu_s = (ProcessCpuUs() - cpu0) / 1e6;
+
+		printf("%-9s %u de %u contestadas en %.2f s (%.0f SUBSCRIBE/s, CPU %.2f s). p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+			names[r], (unsigned) latency_ms.size(), cfg.subs, wall_s, wall_s > 0 ? latency_ms.size() / wall_s : 0.0, cpu_s,
+			Percentile(latency_ms, 0.5), Percentile(latency_ms, 0.99), Percentile(latency_ms, 1.0));
+		if (latency_ms.size() != cfg.subs) ret = 1;
+
+		//El votador envia el NOTIFY al terminar la transaccion del SUBSCRIBE. Se espera a que lleguen todos para que
+		//la siguiente ronda sustituya a subscripciones ya establecidas
+		pj_uint64_t t0 = RadioSim::NowUs();
+		while (burst->Notifies() < (r + 1) * cfg.subs && RadioSim::NowUs() - t0 < NOTIFY_TIMEOUT_US) pj_thread_sleep(100);
+		printf("          %u NOTIFY en %.1f s\n", burst->Notifies() - r * cfg.subs, (RadioSim::NowUs() - t0) / 1e6);
+	}
+
+	//Cambio de contact dentro del dialogo. Get_subMod tiene que encontrar la subscripcion por el nuevo
+	{
+		pj_uint64_t cpu0 = ProcessCpuUs();
+		double wall_s = burst->ContactRound(latency_ms);
+		double cpu_s = (ProcessCpuUs() - cpu0) / 1e6;
+
+		printf("%-9s %u de %u contestadas en %.2f s (%.0f SUBSCRIBE/s, CPU %.2f s). p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+			"Contact", (unsigned) latency_ms.size(), cfg.subs, wall_s, wall_s > 0 ? latency_ms.size() / wall_s : 0.0, cpu_s,
+			Percentile(latency_ms, 0.5), Percentile(latency_ms, 0.99), Percentile(latency_ms, 1.0));
+		if (latency_ms.size() != cfg.subs) ret = 1;
+
+		unsigned found_new = CountSubsByContact("-b");
+		unsigned found_old = CountSubsByContact("");
+		printf("          %u de %u encontradas por el contact nuevo, %u por el antiguo%s\n", found_new, cfg.subs, found_old,
+			(found_new == cfg.subs && found_old == 0) ? "" : " ERROR");
+		if (found_new != cfg.subs || found_old != 0) ret = 1;
+	}
+
+	CORESIP_LogStats log;
+	CORESIP_Error err;
+	if (CORESIP_GetLogStats(&log, &err) == 0)
+	{
+		printf("Log:                      %u mensajes escritos, %u descartados, %u suprimidos por repetidos\n",
+			log.Written, log.Dropped, log.Suppressed);
+	}
+
+	delete burst;
+	return ret;
+}
+
+/*@}*/
@@ -0,0 +1,216 @@
+/**
+ * @file WavTest.cpp
+ * @brief Prueba de carga de CORESIP: reproductores y grabadores wav con un disco lento (--wav)
+ *
+ *	Con --wav N no abre sesiones: reproduce N ficheros wav hacia N grabadores con un disco simulado que a
+ *	ratos tarda --wav-delay ms en cada acceso, y mide el tiempo entre ticks del mezclador y los underruns y overruns,
+ *	accediendo a los ficheros desde el mezclador y desde los threads de WavPlayer y WavRecorder.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include <pjlib.h>
+#include <pjsua-lib/pjsua.h>
+#include "CoreSip.h"
+#include "RadioSim.h"
+#include "Global.h"
+#include "WavIo.h"
+#include "LoadTest.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+
+#define WAV_FILE_S			10			//Duracion del fichero que se reproduce en bucle
+#define WAV_MEASURE_S		5			//Duracion de la medida de cada caso
+#define WAV_DELAY_EVERY		10			//Accesos al fichero entre retardos
+#define WAV_EOF_TIMEOUT_US	5000000		//Espera maxima a FinWavCb del fichero corto
+
+/**
+ * Puerto de medida del tick del mezclador. Sin emisores conectados, el mezclador le entrega una trama vacia
+ * en cada tick.
+ */
+static struct WavProbe
+{
+	pjmedia_port port;
+	pj_mutex_t *mutex;
+	pj_uint64_t t_last;
+	std::vector<double> gap_ms;			//Tiempo entre ticks consecutivos
+} probe;
+
+/**
+ * ProbePutFrame.	...
+ */
+static pj_status_t ProbePutFrame(pjmedia_port *port, const pjmedia_frame *frame)
+{
+	PJ_UNUSED_ARG(port);
+	PJ_UNUSED_ARG(frame);
+
+	pj_uint64_t now = RadioSim::NowUs();
+	pj_mutex_lock(probe.mutex);
+	if (probe.t_last != 0) probe.gap_ms.push_back((now - probe.t_last) / 1000.0);
+	probe.t_last = now;
+	pj_mutex_unlock(probe.mutex);
+	return PJ_SUCCESS;
+}
+
+/**
+ * MakeWav.	...
+ * Escribe un fichero wav de 8 kHz con un tono de 500 Hz.
+ */
+static pj_status_t MakeWav(pj_pool_t *pool, const char *path, unsigned seconds)
+{
+	pjmedia_port *port;
+	pj_int16_t pcm[SAMPLES_PER_FRAME];
+	pjmedia_frame frame;
+
+	pj_status_t st = pjmedia_wav_writer_port_create(pool, path, SAMPLING_RATE, CHANNEL_COUNT, SAMPLES_PER_FRAME, BITS_PER_SAMPLE,
+		PJMEDIA_FILE_WRITE_PCM, 0, &port);
+	if (st != PJ_SUCCESS) return st;
+
+	for (unsigned i = 0; i < SAMPLES_PER_FRAME; i++) pcm[i] = (pj_int16_t) ((i % 16) < 8 ? 8000 : -8000);
+	pj_bzero(&frame, sizeof(frame));
+	frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	frame.buf = pcm;
+	frame.size = sizeof(pcm);
+	for (unsigned n = 0; n < seconds * 1000 / PTIME; n++) pjmedia_port_put_frame(port, &frame);
+
+	return pjmedia_port_destroy(port);
+}
+
+/**
+ * RunWav.	...
+ * Reproductores y grabadores wav con un disco lento: uno de cada WAV_DELAY_EVERY accesos al fichero de cada uno
+ * tarda cfg.wav_delay_ms mas. Con cfg.wav reproductores en bucle, cada uno enlazado a un grabador, mide durante
+ * WAV_MEASURE_S el tiempo entre ticks del mezclador, primero accediendo al fichero desde el mezclador y despues
+ * desde el thread de cada uno. Al final de cada caso, sin retardos, reproduce un fichero corto sin bucle y espera
+ * FinWavCb.
+ * @return	0 si con threads no hay underruns ni overruns, ningun tick se retrasa la mitad de cfg.wav_delay_ms, y se ha
+ *			avisado el fin de los ficheros.
+ */
+int RunWav()
+{
+	static const char *names[] = { "Mezclador", "Thread" };
+	CORESIP_Error err;
+	char loop_file[64], short_file[64], rec_file[64];
+	int ret = 0;
+
+	pj_pool_t *pool = pjsua_pool_create("LoadTestWav", 1024, 1024);
+	pj_ansi_snprintf(loop_file, sizeof(loop_file), "/tmp/coresip-loadtest-%d-loop.wav", (int) getpid());
+	pj_ansi_snprintf(short_file, sizeof(short_file), "/tmp/coresip-loadtest-%d-short.wav", (int) getpid());
+	if (MakeWav(pool, loop_file, WAV_FILE_S) != PJ_SUCCESS || MakeWav(pool, short_file, 1) != PJ_SUCCESS)
+	{
+		fprintf(stderr, "ERROR escribiendo los ficheros wav en /tmp\n");
+		pj_pool_release(pool);
+		return 1;
+	}
+
+	pjsua_conf_port_id probe_slot;
+	pj_mutex_create_simple(pool, "WavProbeMtx", &probe.mutex);
+	pj_str_t name;
+	pjmedia_port_info_init(&probe.port.info, pj_cstr(&name, "PROBE"), PJMEDIA_PORT_SIGNATURE('P', 'R', 'O', 'B'),
+		SAMPLING_RATE, CHANNEL_COUNT, BITS_PER_SAMPLE, SAMPLES_PER_FRAME);
+	probe.port.put_frame = &ProbePutFrame;
+	probe.gap_ms.reserve(WAV_MEASURE_S * 1000 / PTIME * 2);
+	if (pjsua_conf_add_port(pool, &probe.port, &probe_slot) != PJ_SUCCESS)
+	{
+		pj_pool_release(pool);
+		return 1;
+	}
+
+	printf("%u reproductores y %u grabadores wav, %u ms de retardo en 1 de cada %u accesos al fichero, %u s\n",
+		cfg.wav, cfg.wav, cfg.wav_delay_ms, WAV_DELAY_EVERY, WAV_MEASURE_S);
+	WavIo::SetTestDelay(cfg.wav_delay_ms, WAV_DELAY_EVERY);
+	for (unsigned m = 0; m < PJ_ARRAY_SIZE(names); m++)
+	{
+		WavIo::Enable(m == 1 ? PJ_TRUE : PJ_FALSE);
+
+		std::vector<int> players(cfg.wav, -1), recorders(cfg.wav, -1);
+		for (unsigned i = 0; i < cfg.wav; i++)
+		{
+			pj_ansi_snprintf(rec_file, sizeof(rec_file), "/tmp/coresip-loadtest-%d-rec%u.wav", (int) getpid(), i);
+			if (CORESIP_CreateWavPlayer(loop_file, 1, &players[i], &err) != 0 ||
+				CORESIP_CreateWavRecorder(rec_file, &recorders[i], &err) != 0 ||
+				CORESIP_BridgeLink(players[i], recorders[i], 1, &err) != 0)
+			{
+				fprintf(stderr, "ERROR creando el reproductor o el grabador %u: %s\n", i, err.Info);
+				ret = 1;
+				break;
+			}
+		}
+
+		pj_mutex_lock(probe.mutex);
+		probe.gap_ms.clear();
+		probe.t_last = 0;
+		pj_mutex_unlock(probe.mutex);
+
+		pj_thread_sleep(WAV_MEASURE_S * 1000);
+
+		std::vector<double> gap_ms;
+		pj_mutex_lock(probe.mutex);
+		gap_ms = probe.gap_ms;
+		pj_mutex_unlock(probe.mutex);
+
+		CORESIP_WavStats s, play = { 0, 0, 0, 0 }, rec = { 0, 0, 0, 0 };
+		for (unsigned i = 0; i < cfg.wav; i++)
+		{
+			if (players[i] != -1 && CORESIP_GetWavPlayerStats(players[i], &s, &err) == 0)
+			{
+				play.Frames += s.Frames;
+				play.Underruns += s.Underruns;
+				play.MaxIoUs = PJ_MAX(play.MaxIoUs, s.MaxIoUs);
+			}
+			if (recorders[i] != -1 && CORESIP_GetWavRecorderStats(recorders[i], &s, &err) == 0)
+			{
+				rec.Frames += s.Frames;
+				rec.Overruns += s.Overruns;
+				rec.MaxIoUs = PJ_MAX(rec.MaxIoUs, s.MaxIoUs);
+			}
+		}
+
+		//Fin de fichero: un reproductor sin bucle hacia el primer grabador, ya sin retardos
+		WavIo::SetTestDelay(0, 0);
+		unsigned fin0 = fin_wav;
+		int short_player = -1;
+		pj_uint64_t t_eof = 0;
+		if (cfg.wav > 0 && recorders[0] != -1 && CORESIP_CreateWavPlayer(short_file, 0, &short_player, &err) == 0 &&
+			CORESIP_BridgeLink(short_player, recorders[0], 1, &err) == 0)
+		{
+			pj_uint64_t t0 = RadioSim::NowUs();
+			while (fin_wav == fin0 && RadioSim::NowUs() - t0 < WAV_EOF_TIMEOUT_US) pj_thread_sleep(10);
+			if (fin_wav != fin0) t_eof = RadioSim::NowUs() - t0;
+		}
+		WavIo::SetTestDelay(cfg.wav_delay_ms, WAV_DELAY_EVERY);
+
+		for (unsigned i = 0; i < cfg.wav; i++)
+		{
+			if (players[i] != -1) CORESIP_DestroyWavPlayer(players[i], &err);
+			if (recorders[i] != -1) CORESIP_DestroyWavRecorder(recorders[i], &err);
+			pj_ansi_snprintf(rec_file, sizeof(rec_file), "/tmp/coresip-loadtest-%d-rec%u.wav", (int) getpid(), i);
+			unlink(rec_file);
+		}
+
+		double max_gap = Percentile(gap_ms, 1.0);
+		printf("%-9s ticks %u de %u, entre ticks p50 %.1f ms, p99 %.1f ms, max %.1f ms. Reproductores %u tramas, %u underruns, "
+			"lectura max %.1f ms. Grabadores %u tramas, %u overruns, escritura max %.1f ms. Fin de fichero %s%.0f ms\n",
+			names[m], (unsigned) gap_ms.size(), WAV_MEASURE_S * 1000 / PTIME, Percentile(gap_ms, 0.5), Percentile(gap_ms, 0.99),
+			max_gap, play.Frames, play.Underruns, play.MaxIoUs / 1000.0, rec.Frames, rec.Overruns, rec.MaxIoUs / 1000.0,
+			t_eof != 0 ? "a los " : "NO AVISADO ", t_eof / 1000.0);
+
+		if (t_eof == 0) ret = 1;
+		if (m == 1 && (play.Underruns != 0 || rec.Overruns != 0 || max_gap >= PTIME + cfg.wav_delay_ms / 2.0)) ret = 1;
+	}
+	WavIo::SetTestDelay(0, 0);
+	WavIo::Enable(PJ_TRUE);
+
+	pjsua_conf_remove_port(probe_slot);
+	pj_mutex_destroy(probe.mutex);
+	unlink(loop_file);
+	unlink(short_file);
+	pj_pool_release(pool);
+	return ret;
+}
+
+/*@}*/
@@ -0,0 +1,474 @@
+/**
+ * @file McastReceiver.cpp
+ * @brief Recepcion multicast del audio de radio en CORESIP.dll
+ *
+ *	Implementa la clase 'McastReceiver'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include "Global.h"
+#include "Exceptions.h"
+#include "Guard.h"
+#include "RdRxPort.h"
+#include "McastReceiver.h"
+
+#ifdef _WIN32
+#include <mswsock.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+#define POLL_MS			100		//Espera maxima del thread, para ver los sockets nuevos
+#define MAX_BATCH		32		//Paquetes que se leen de un socket en cada despertar
+#define MAX_PKT_SIZE	1500
+
+#if defined(__linux__) && !defined(IP_MULTICAST_ALL)
+#define IP_MULTICAST_ALL	49
+#endif
+
+#ifdef _WIN32
+static LPFN_WSARECVMSG WSARecvMsgFn = NULL;
+#endif
+
+/**
+ * RecvDst.	...
+ * Lee un paquete sin bloquear y obtiene la direccion a la que iba dirigido.
+ * @param	sock	Socket, con IP_PKTINFO activado.
+ * @param	buf		Buffer para el paquete.
+ * @param	len		Tamano del buffer.
+ * @param	dst		Direccion de destino, en orden de red. 0 si no se conoce.
+ * @return	Tamano del paquete, o -1 si no hay ninguno.
+ */
+static int RecvDst(pj_sock_t sock, char * buf, int len, pj_uint32_t * dst)
+{
+	*dst = 0;
+
+#ifdef _WIN32
+	char ctrl[WSA_CMSG_SPACE(sizeof(IN_PKTINFO))];
+	WSABUF wbuf;
+	WSAMSG msg;
+	DWORD size = 0;
+
+	wbuf.buf = buf;
+	wbuf.len = len;
+	pj_bzero(&msg, sizeof(msg));
+	msg.lpBuffers = &wbuf;
+	msg.dwBufferCount = 1;
+	msg.Control.buf = ctrl;
+	msg.Control.len = sizeof(ctrl);
+
+	if (WSARecvMsgFn == NULL || WSARecvMsgFn((SOCKET) sock, &msg, &size, NULL, NULL) != 0)
+	{
+		return -1;
+	}
+	for (WSACMSGHDR * c = WSA_CMSG_FIRSTHDR(&msg); c != NULL; c = WSA_CMSG_NXTHDR(&msg, c))
+	{
+		if (c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_PKTINFO)
+		{
+			*dst = ((IN_PKTINFO *) WSA_CMSG_DATA(c))->ipi_addr.s_addr;
+		}
+	}
+	return (int) size;
+#else
+	char ctrl[CMSG_SPACE(sizeof(struct in_pktinfo))];
+	struct iovec iov;
+	struct msghdr msg;
+
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	pj_bzero(&msg, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctrl;
+	msg.msg_controllen = sizeof(ctrl);
+
+	ssize_t size = recvmsg(sock, &msg, MSG_DONTWAIT);
+	if (size < 0)
+	{
+		return -1;
+	}
+	for (struct cmsghdr * c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c))
+	{
+		if (c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_PKTINFO)
+		{
+			*dst = ((struct in_pktinfo *) CMSG_DATA(c))->ipi_addr.s_addr;
+		}
+	}
+	return (int) size;
+#endif
+}
+
+/**
+ * McastReceiver.	...
+ * Constructor. Crea el thread de recepcion.
+ * @return	nada.
+ */
+McastReceiver::McastReceiver()
+{
+	_NSockets = 0;
+	_Received = 0;
+	_Unmatched = 0;
+	_Lock = NULL;
+	_Thread = NULL;
+	_ThreadRun = PJ_FALSE;
+
+	_Pool = pjsua_pool_create(NULL, 512, 512);
+
+	pj_status_t st = pj_lock_create_simple_mutex(_Pool, "McastRxLock", &_Lock);
+	PJ_CHECK_STATUS(st, ("ERROR creando seccion critica McastRxLock"));
+
+	_ThreadRun = PJ_TRUE;
+	st = pj_thread_create(_Pool, "McastRxTh", &McastRxTh, this, 0, 0, &_Thread);
+	PJ_CHECK_STATUS(st, ("ERROR creando thread McastRxTh"));
+}
+
+/**
+ * ~McastReceiver.	...
+ * Destructor. Los puertos ya se han dado de baja.
+ * @return	nada.
+ */
+McastReceiver::~McastReceiver()
+{
+	if (_Thread != NULL)
+	{
+		_ThreadRun = PJ_FALSE;
+		pj_thread_join(_Thread);
+		pj_thread_destroy(_Thread);
+		_Thread = NULL;
+	}
+
+	for (int i = 0; i < _NSockets; i++)
+	{
+		pj_sock_close(_Sockets[i].sock);
+	}
+	_NSockets = 0;
+
+	if (_Lock != NULL)
+	{
+		pj_lock_destroy(_Lock);
+		_Lock = NULL;
+	}
+
+	if (_Pool)
+	{
+		pj_pool_release(_Pool);
+		_Pool = NULL;
+	}
+}
+
+/**
+ * Join.	...
+ * Da de alta un puerto para que reciba el audio enviado a un grupo multicast. Usa un socket ya
+ * abierto para la misma direccion local y puerto si admite el grupo.
+ * @param	port		Puerto de recepcion radio.
+ * @param	localIp		Direccion local por la que se recibe.
+ * @param	mcastIp		Grupo multicast.
+ * @param	mcastPort	Puerto UDP.
+ * @return	nada. Lanza una excepcion si no se puede recibir.
+ */
+void McastReceiver::Join(RdRxPort * port, const char * localIp, const char * mcastIp, unsigned mcastPort)
+{
+	pj_sockaddr_in addr, mcastAddr;
+	pj_str_t str;
+	pj_sockaddr_in_init(&addr, pj_cstr(&str, localIp), (pj_uint16_t)mcastPort);
+	pj_sockaddr_in_init(&mcastAddr, pj_cstr(&str, mcastIp), (pj_uint16_t)mcastPort);
+
+	pj_uint32_t local = addr.sin_addr.s_addr;
+	pj_uint32_t group = mcastAddr.sin_addr.s_addr;
+
+	Guard lock(_Lock);
+
+	Socket * s = NULL;
+	for (int i = 0; i < _NSockets && s == NULL; i++)
+	{
+		Socket * t = &_Sockets[i];
+		if (t->local != local || t->port != (pj_uint16_t)mcastPort || t->nmembers >= MAX_MEMBERS)
+		{
+			continue;
+		}
+		if (AddMembership(t, group))
+		{
+			s = t;
+		}
+	}
+
+	if (s == NULL)
+	{
+		if (_NSockets >= MAX_SOCKETS)
+		{
+			throw PJLibException(__FILE__, PJ_ETOOMANY).Msg("ERROR McastReceiver::Join. No caben mas sockets");
+		}
+
+		s = OpenSocket(local, (pj_uint16_t)mcastPort);
+		if (!AddMembership(s, group))
+		{
+			pj_status_t st = pj_get_netos_error();
+			pj_sock_close(s->sock);
+			throw PJLibException(__FILE__, st).Msg("ERROR aadiendo socket a multicast para puerto de recepcion multicast radio",
+				"[Mcast=%s][Port=%d]", mcastIp, mcastPort);
+		}
+		_NSockets++;
+	}
+
+	s->members[s->nmembers].group = group;
+	s->members[s->nmembers].port = port;
+	s->nmembers++;
+
+	PJ_LOG(5,(__FILE__, "BSS: McastReceiver::Join Mcast %s Port %d Local %s, socket %d de %d, %d puertos",
+		mcastIp, mcastPort, localIp, (int)(s - _Sockets) + 1, _NSockets, s->nmembers));
+}
+
+/**
+ * Leave.	...
+ * Da de baja un puerto. Al retornar se garantiza que el thread ya no le entrega paquetes.
+ * @param	port	Puerto de recepcion radio.
+ * @return	nada.
+ */
+void McastReceiver::Leave(RdRxPort * port)
+{
+	Guard lock(_Lock);
+
+	for (int i = 0; i < _NSockets; i++)
+	{
+		Socket * s = &_Sockets[i];
+
+		for (int j = 0; j < s->nmembers; )
+		{
+			if (s->members[j].port != port)
+			{
+				j++;
+				continue;
+			}
+
+			pj_uint32_t group = s->members[j].group;
+			s->members[j] = s->members[--s->nmembers];
+
+			bool used = false;
+			for (int k = 0; k < s->nmembers; k++)
+			{
+				if (s->members[k].group == group) used = true;
+			}
+			if (!used)
+			{
+				DropMembership(s, group);
+			}
+		}
+
+		if (s->nmembers == 0)
+		{
+			pj_sock_close(s->sock);
+			_Sockets[i] = _Sockets[--_NSockets];
+			i--;
+		}
+	}
+}
+
+/**
+ * GetStats.	...
+ * @param	received	Paquetes leidos de todos los sockets.
+ * @param	unmatched	Paquetes leidos de un grupo al que no esta unido ningun puerto del socket.
+ * @return	nada.
+ */
+void McastReceiver::GetStats(unsigned * received, unsigned * unmatched)
+{
+	Guard lock(_Lock);
+
+	*received = _Received;
+	*unmatched = _Unmatched;
+}
+
+/**
+ * AddMembership.	...
+ * Une el socket al grupo, si no lo estaba ya por otro puerto.
+ * @return	true si el socket recibe el grupo.
+ */
+bool McastReceiver::AddMembership(Socket * s, pj_uint32_t group)
+{
+	for (int i = 0; i < s->nmembers; i++)
+	{
+		if (s->members[i].group == group) return true;
+	}
+
+	pj_ip_mreq mreq;
+	mreq.imr_multiaddr.s_addr = group;
+	mreq.imr_interface.s_addr = s->local;
+
+	return pj_sock_setsockopt(s->sock, pj_SOL_IP(), pj_IP_ADD_MEMBERSHIP(), (void *)&mreq, sizeof(mreq)) == PJ_SUCCESS;
+}
+
+/**
+ * DropMembership.	...
+ * Saca el socket del grupo.
+ * @return	nada.
+ */
+void McastReceiver::DropMembership(Socket * s, pj_uint32_t group)
+{
+	pj_ip_mreq mreq;
+	mreq.imr_multiaddr.s_addr = group;
+	mreq.imr_interface.s_addr = s->local;
+
+	pj_sock_setsockopt(s->sock, pj_SOL_IP(), pj_IP_DROP_MEMBERSHIP(), (void *)&mreq, sizeof(mreq));
+}
+
+/**
+ * OpenSocket.	...
+ * Abre un socket no bloqueante con IP_PKTINFO en la siguiente posicion libre de la lista, sin contarlo
+ * todavia. En Windows se enlaza a la direccion local, y en el resto a todas: Linux no entrega el
+ * multicast a los sockets enlazados a una direccion unicast. Por eso en Linux se desactiva
+ * IP_MULTICAST_ALL: si no, el socket recibe tambien los grupos a los que se unen otros sockets del
+ * mismo puerto, de este proceso o de otros.
+ * @return	El socket. Lanza una excepcion si hay error.
+ */
+McastReceiver::Socket * McastReceiver::OpenSocket(pj_uint32_t local, pj_uint16_t port)
+{
+	Socket * s = &_Sockets[_NSockets];
+	pj_sockaddr_in addr;
+	pj_status_t st;
+
+	pj_bzero(s, sizeof(Socket));
+	s->local = local;
+	s->port = port;
+
+	st = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &s->sock);
+	PJ_CHECK_STATUS(st, ("ERROR creando socket para puerto de recepcion multicast radio"));
+
+	int on = 1;
+	pj_sock_setsockopt(s->sock, pj_SOL_SOCKET(), pj_SO_REUSEADDR(), (void *)&on, sizeof(on));
+	st = pj_sock_setsockopt(s->sock, pj_SOL_IP(), IP_PKTINFO, (void *)&on, sizeof(on));
+#ifdef __linux__
+	if (st == PJ_SUCCESS)
+	{
+		int off = 0;
+		st = pj_sock_setsockopt(s->sock, pj_SOL_IP(), IP_MULTICAST_ALL, (void *)&off, sizeof(off));
+	}
+#endif
+	if (st == PJ_SUCCESS)
+	{
+#ifdef _WIN32
+		u_long nb = 1;
+		if (ioctlsocket((SOCKET) s->sock, FIONBIO, &nb) != 0) st = pj_get_netos_error();
+#else
+		int nb = 1;
+		if (ioctl(s->sock, FIONBIO, &nb) != 0) st = pj_get_netos_error();
+#endif
+	}
+#ifdef _WIN32
+	if (st == PJ_SUCCESS && WSARecvMsgFn == NULL)
+	{
+		GUID guid = WSAID_WSARECVMSG;
+		DWORD bytes = 0;
+		if (WSAIoctl((SOCKET) s->sock, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid),
+			&WSARecvMsgFn, sizeof(WSARecvMsgFn), &bytes, NULL, NULL) != 0)
+		{
+			st = pj_get_netos_error();
+		}
+	}
+#endif
+	if (st == PJ_SUCCESS)
+	{
+		pj_sockaddr_in_init(&addr, NULL, port);
+#ifdef _WIN32
+		addr.sin_addr.s_addr = local;
+#endif
+		st = pj_sock_bind(s->sock, &addr, sizeof(addr));
+	}
+	if (st != PJ_SUCCESS)
+	{
+		pj_sock_close(s->sock);
+		PJ_CHECK_STATUS(st, ("ERROR enlazando socket para puerto de recepcion multicast radio", "[Port=%d]", port));
+	}
+
+	return s;
+}
+
+/**
+ * Drain.	...
+ * Lee los paquetes que haya en el socket y los entrega a los puertos de su grupo. Con _Lock cogido.
+ * @return	nada.
+ */
+void McastReceiver::Drain(Socket * s)
+{
+	char buf[MAX_PKT_SIZE];
+	pj_uint32_t dst;
+
+	for (int n = 0; n < MAX_BATCH; n++)
+	{
+		int size = RecvDst(s->sock, buf, sizeof(buf), &dst);
+		if (size < 0)
+		{
+			break;
+		}
+
+		bool matched = false;
+		for (int i = 0; i < s->nmembers; i++)
+		{
+			if (s->members[i].group == dst)
+			{
+				s->members[i].port->Deliver(buf, (pj_size_t)size);
+				matched = true;
+			}
+		}
+		_Received++;
+		if (!matched) _Unmatched++;
+	}
+}
+
+/**
+ * McastRxTh.	...
+ * Thread de recepcion. Espera en todos los sockets y vacia los que tienen paquetes.
+ * @param	proc	Puntero al objeto McastReceiver.
+ * @return	0.
+ */
+int McastReceiver::McastRxTh(void *proc)
+{
+	McastReceiver * pThis = (McastReceiver *) proc;
+
+	while (pThis->_ThreadRun)
+	{
+		pj_fd_set_t rset;
+		pj_sock_t maxfd = 0;
+		int nsock;
+
+		PJ_FD_ZERO(&rset);
+		pj_lock_acquire(pThis->_Lock);
+		nsock = pThis->_NSockets;
+		for (int i = 0; i < nsock; i++)
+		{
+			PJ_FD_SET(pThis->_Sockets[i].sock, &rset);
+			if (pThis->_Sockets[i].sock > maxfd) maxfd = pThis->_Sockets[i].sock;
+		}
+		pj_lock_release(pThis->_Lock);
+
+		if (nsock == 0)
+		{
+			pj_thread_sleep(POLL_MS);
+			continue;
+		}
+
+		pj_time_val tout = {0, POLL_MS};
+		if (pj_sock_select((int)maxfd + 1, &rset, NULL, NULL, &tout) <= 0)
+		{
+			continue;
+		}
+
+		//Los sockets se pueden haber cerrado mientras tanto: solo se leen los que siguen en la lista
+		pj_lock_acquire(pThis->_Lock);
+		for (int i = 0; i < pThis->_NSockets; i++)
+		{
+			if (PJ_FD_ISSET(pThis->_Sockets[i].sock, &rset))
+			{
+				pThis->Drain(&pThis->_Sockets[i]);
+			}
+		}
+		pj_lock_release(pThis->_Lock);
+	}
+
+	return 0;
+}
+
+/*@}*/
@@ -0,0 +1,77 @@
+/**
+ * @file McastReceiver.h
+ * @brief Recepcion multicast del audio de radio en CORESIP.dll
+ *
+ *	Implementa la clase 'McastReceiver'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_MCASTRECEIVER_H__
+#define __CORESIP_MCASTRECEIVER_H__
+
+class RdRxPort;
+
+/**
+ * McastReceiver.
+ * Recibe el audio multicast de todos los puertos de recepcion radio (RdRxPort) con un socket por
+ * direccion local y puerto, en lugar de un socket por puerto registrado en el ioqueue de pjsip.
+ * Cada socket se une a los grupos de los puertos que lo usan y los paquetes se reparten por la
+ * direccion de destino, que se obtiene con IP_PKTINFO. Un unico thread espera en todos los
+ * sockets y, en cada despertar, lee todos los paquetes que haya en cada uno.
+ * Si un socket no admite mas grupos (IP_ADD_MEMBERSHIP falla) se abre otro para el mismo puerto.
+ * En Linux los sockets se enlazan a todas las direcciones con IP_MULTICAST_ALL desactivado, para que
+ * cada uno reciba solo los grupos a los que se ha unido y no los de otros sockets del mismo puerto.
+ */
+class McastReceiver
+{
+public:
+	static const int MAX_SOCKETS = CORESIP_MAX_RDRX_PORTS;	//Maximo numero de sockets abiertos
+	static const int MAX_MEMBERS = 20;						//Puertos por socket. Linux admite 20 grupos por socket por defecto
+
+	McastReceiver();
+	~McastReceiver();
+
+	void Join(RdRxPort * port, const char * localIp, const char * mcastIp, unsigned mcastPort);
+	void Leave(RdRxPort * port);
+	void GetStats(unsigned * received, unsigned * unmatched);
+
+private:
+	/** Puerto que recibe por un socket, y grupo al que se envia su audio */
+	struct Member
+	{
+		pj_uint32_t group;						//Direccion multicast, en orden de red
+		RdRxPort * port;
+	};
+
+	/** Socket compartido */
+	struct Socket
+	{
+		pj_sock_t sock;
+		pj_uint32_t local;						//Direccion local, en orden de red
+		pj_uint16_t port;
+		int nmembers;
+		Member members[MAX_MEMBERS];
+	};
+
+	pj_pool_t * _Pool;
+	pj_lock_t * _Lock;							//Protege la lista de sockets. El thread lo coge mientras reparte
+	Socket _Sockets[MAX_SOCKETS];				//Lista compacta de sockets abiertos
+	int _NSockets;
+	unsigned _Received;							//Paquetes leidos, con _Lock
+	unsigned _Unmatched;						//Paquetes de grupos sin ningun puerto del socket
+
+	pj_thread_t * _Thread;
+	pj_bool_t _ThreadRun;
+	static pj_thread_proc McastRxTh;
+
+	bool AddMembership(Socket * s, pj_uint32_t group);
+	void DropMembership(Socket * s, pj_uint32_t group);
+	Socket * OpenSocket(pj_uint32_t local, pj_uint16_t port);
+	void Drain(Socket * s);
+};
+
+#endif
+
+/*@}*/
@@ -0,0 +1,272 @@
+/**
+ * @file McastScheduler.cpp
+ * @brief Planificador del envio multicast del audio de radio en CORESIP.dll
+ *
+ *	Implementa la clase 'McastScheduler'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include "Global.h"
+#include "Exceptions.h"
+#include "SipAgent.h"
+#include "McastScheduler.h"
+
+/**
+ * McastScheduler.	...
+ * Constructor. Crea el thread unico de envio multicast.
+ * @return	nada.
+ */
+McastScheduler::McastScheduler()
+{
+	nsessions = 0;
+	for (int i = 0; i < MAX_SESSIONS; i++) sessions[i] = NULL;
+	nround = 0;
+	in_round = PJ_FALSE;
+	round_waiters = 0;
+	sched_mutex = NULL;
+	sched_sem = NULL;
+	round_sem = NULL;
+	sched_thread = NULL;
+	sched_thread_run = PJ_FALSE;
+	last_tick_ms = 0;
+
+	_Pool = pjsua_pool_create(NULL, 512, 512);
+
+	pj_status_t st = pj_mutex_create_simple(_Pool, "McastSchedMtx", &sched_mutex);
+	PJ_CHECK_STATUS(st, ("ERROR creando mutex McastSchedMtx"));
+
+	st = pj_sem_create(_Pool, "McastSchedSem", 0, MAX_SESSIONS * 10, &sched_sem);
+	PJ_CHECK_STATUS(st, ("ERROR creando semaforo McastSchedSem"));
+
+	st = pj_sem_create(_Pool, "McastRoundSem", 0, MAX_SESSIONS, &round_sem);
+	PJ_CHECK_STATUS(st, ("ERROR creando semaforo McastRoundSem"));
+
+	sched_thread_run = PJ_TRUE;
+	st = pj_thread_create(_Pool, "McastSchedTh", &McastSchedTh, this, 0, 0, &sched_thread);
+	PJ_CHECK_STATUS(st, ("ERROR creando thread McastSchedTh"));
+}
+
+/**
+ * ~McastScheduler.	...
+ * Destructor.
+ * @return	nada.
+ */
+McastScheduler::~McastScheduler()
+{
+	if (sched_thread != NULL)
+	{
+		sched_thread_run = PJ_FALSE;
+		pj_sem_post(sched_sem);
+		pj_thread_join(sched_thread);
+		pj_thread_destroy(sched_thread);
+		sched_thread = NULL;
+	}
+
+	if (sched_sem != NULL)
+	{
+		pj_sem_destroy(sched_sem);
+		sched_sem = NULL;
+	}
+
+	if (round_sem != NULL)
+	{
+		pj_sem_destroy(round_sem);
+		round_sem = NULL;
+	}
+
+	if (sched_mutex != NULL)
+	{
+		pj_mutex_destroy(sched_mutex);
+		sched_mutex = NULL;
+	}
+
+	if (_Pool)
+	{
+		pj_pool_release(_Pool);
+		_Pool = NULL;
+	}
+}
+
+/**
+ * Add.	...
+ * Registra una sesion de radio para que el thread atienda su buffer de salida multicast.
+ * @param	psipcall	Puntero del objeto SipCall.
+ * @return	0 si no hay error. -1 si la lista esta llena.
+ */
+int McastScheduler::Add(SipCall *psipcall)
+{
+	int ret = -1;
+
+	pj_mutex_lock(sched_mutex);
+	for (int i = 0; i < nsessions; i++)
+	{
+		if (sessions[i] == psipcall)
+		{
+			pj_mutex_unlock(sched_mutex);
+			return 0;
+		}
+	}
+	if (nsessions < MAX_SESSIONS)
+	{
+		sessions[nsessions++] = psipcall;
+		ret = 0;
+	}
+	pj_mutex_unlock(sched_mutex);
+
+	if (ret != 0)
+	{
+		PJ_LOG(3,(__FILE__, "ERROR: McastScheduler::Add. No caben mas sesiones"));
+	}
+
+	return ret;
+}
+
+/**
+ * Remove.	...
+ * Quita una sesion de la lista. Al retornar se garantiza que el thread ya no la esta atendiendo:
+ * si esta en la vuelta en curso se espera en round_sem a que termine.
+ * @param	psipcall	Puntero del objeto SipCall.
+ * @return	0 si no hay error. -1 si no estaba registrada.
+ */
+int McastScheduler::Remove(SipCall *psipcall)
+{
+	int ret = -1;
+
+	pj_mutex_lock(sched_mutex);
+	for (int i = 0; i < nsessions; i++)
+	{
+		if (sessions[i] == psipcall)
+		{
+			//Se mantiene la lista compacta moviendo el ultimo al hueco
+			sessions[i] = sessions[nsessions-1];
+			sessions[nsessions-1] = NULL;
+			nsessions--;
+			ret = 0;
+			break;
+		}
+	}
+
+	//Desde el propio thread no se espera: la sesion ya no se atiende tras volver de ella
+	if (pj_thread_this() != sched_thread)
+	{
+		for (int i = 0; in_round && i < nround; i++)
+		{
+			if (round[i] == psipcall)
+			{
+				round_waiters++;
+				pj_mutex_unlock(sched_mutex);
+				pj_sem_wait(round_sem);
+				pj_mutex_lock(sched_mutex);
+				i = -1;
+			}
+		}
+	}
+	pj_mutex_unlock(sched_mutex);
+
+	return ret;
+}
+
+/**
+ * Signal.	...
+ * Despierta al thread. Se llama cuando alguna sesion deja audio nuevo en su buffer de salida
+ * o cuando cambia su modo de envio.
+ * @return	nada.
+ */
+void McastScheduler::Signal()
+{
+	pj_sem_post(sched_sem);
+}
+
+/**
+ * McastSchedTh.	...
+ * Thread de envio. Espera al semaforo. Mientras alguna sesion se atiende por reloj la espera
+ * vence, como mucho, en el siguiente tick de PTIME/2.
+ * @param	proc	Puntero al objeto McastScheduler.
+ * @return	0.
+ */
+int McastScheduler::McastSchedTh(void *proc)
+{
+	McastScheduler *wp = (McastScheduler *)proc;
+	pj_bool_t clocked = PJ_FALSE;
+	pj_timestamp t_start, t_now;
+
+	pj_thread_desc desc;
+    pj_thread_t *this_thread;
+	pj_status_t rc;
+
+	pj_bzero(desc, sizeof(desc));
+
+    rc = pj_thread_register("McastSchedTh", desc, &this_thread);
+    if (rc != PJ_SUCCESS) {
+		PJ_LOG(3,(__FILE__, "...error in pj_thread_register McastSchedTh!"));
+        return 0;
+    }
+
+    /* Test that pj_thread_this() works */
+    this_thread = pj_thread_this();
+    if (this_thread == NULL) {
+        PJ_LOG(3,(__FILE__, "...error: McastSchedTh pj_thread_this() returns NULL!"));
+        return 0;
+    }
+
+    /* Test that pj_thread_get_name() works */
+    if (pj_thread_get_name(this_thread) == NULL) {
+        PJ_LOG(3,(__FILE__, "...error: McastSchedTh pj_thread_get_name() returns NULL!"));
+        return 0;
+    }
+
+	pj_get_timestamp(&t_start);
+
+	while (wp->sched_thread_run)
+	{
+		if (!clocked)
+		{
+			pj_sem_wait(wp->sched_sem);
+		}
+		else
+		{
+			pj_get_timestamp(&t_now);
+			pj_uint32_t elapsed = pj_elapsed_msec(&t_start, &t_now) - wp->last_tick_ms;
+			if (elapsed < (PTIME/2)) pj_sem_wait_for(wp->sched_sem, (PTIME/2) - elapsed);
+		}
+		if (!wp->sched_thread_run) break;
+
+		pj_bool_t tick = PJ_FALSE;
+		pj_get_timestamp(&t_now);
+		pj_uint32_t now_ms = pj_elapsed_msec(&t_start, &t_now);
+		if ((now_ms - wp->last_tick_ms) >= (PTIME/2))
+		{
+			tick = PJ_TRUE;
+			wp->last_tick_ms = now_ms;
+		}
+
+		clocked = PJ_FALSE;
+		pj_mutex_lock(wp->sched_mutex);
+		wp->nround = wp->nsessions;
+		pj_memcpy(wp->round, wp->sessions, wp->nsessions * sizeof(SipCall *));
+		wp->in_round = PJ_TRUE;
+		pj_mutex_unlock(wp->sched_mutex);
+
+		for (int i = 0; i < wp->nround; i++)
+		{
+			if (wp->round[i]->Out_circbuff_Process(tick))
+			{
+				clocked = PJ_TRUE;
+			}
+		}
+
+		pj_mutex_lock(wp->sched_mutex);
+		wp->in_round = PJ_FALSE;
+		for (; wp->round_waiters > 0; wp->round_waiters--)
+		{
+			pj_sem_post(wp->round_sem);
+		}
+		pj_mutex_unlock(wp->sched_mutex);
+	}
+
+	return 0;
+}
+
+/*@}*/
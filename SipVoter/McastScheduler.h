@@ -0,0 +1,59 @@
+/**
+ * @file McastScheduler.h
+ * @brief Planificador del envio multicast del audio de radio en CORESIP.dll
+ *
+ *	Implementa la clase 'McastScheduler'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_MCASTSCHEDULER_H__
+#define __CORESIP_MCASTSCHEDULER_H__
+
+class SipCall;
+
+/**
+ * McastScheduler.
+ * Un unico thread que atiende el envio multicast de todas las sesiones de radio,
+ * en lugar de un thread por sesion. Cada vuelta copia la lista compacta de sesiones
+ * registradas y, ya sin sched_mutex, envia los paquetes que cada una tenga preparados.
+ * Asi una sesion lenta no bloquea el alta y la baja de las demas.
+ */
+class McastScheduler
+{
+public:
+	static const int MAX_SESSIONS = PJSUA_MAX_CALLS;	//Maximo numero de sesiones registradas
+
+	McastScheduler();
+	~McastScheduler();
+
+	int Add(SipCall *psipcall);
+	int Remove(SipCall *psipcall);
+	void Signal();
+
+private:
+	pj_pool_t * _Pool;
+	pj_mutex_t *sched_mutex;				//Protege la lista de sesiones y la vuelta del thread
+	pj_sem_t *sched_sem;					//Despierta al thread cuando hay audio nuevo en alguna sesion
+	pj_sem_t *round_sem;					//El thread lo seala al acabar cada vuelta, una vez por cada Remove que espera
+
+	SipCall *sessions[MAX_SESSIONS];		//Lista compacta de sesiones registradas
+	int nsessions;
+
+	//Copia de la lista que atiende el thread en la vuelta en curso. Remove espera a que termine
+	//la vuelta si la sesion esta en ella
+	SipCall *round[MAX_SESSIONS];
+	int nround;
+	pj_bool_t in_round;
+	int round_waiters;						//Llamadas a Remove esperando en round_sem
+
+	pj_thread_t *sched_thread;
+	pj_bool_t sched_thread_run;
+	static pj_thread_proc McastSchedTh;
+	pj_uint32_t last_tick_ms;				//Instante del ultimo tick de PTIME/2 en ms
+};
+
+#endif
+
+/*@}*/
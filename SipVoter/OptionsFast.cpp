@@ -0,0 +1,478 @@
+/**
+ * @file OptionsFast.cpp
+ * @brief Respuesta y envio rapidos de los OPTIONS de supervision en CORESIP.dll
+ *
+ *	Implementa la clase 'OptionsFast'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include "Global.h"
+#include "Exceptions.h"
+#include "SipAgent.h"
+#include "SipCall.h"
+#include "ExtraParamAccId.h"
+#include "OptionsFast.h"
+
+#define THIS_FILE			"OptionsFast.cpp"
+
+#define PARSE_POOL_SIZE		4096			//Memoria en la pila para el parser de la uri de cada destino
+
+/**
+ * _Mod: Modulo que recibe los OPTIONS antes que la capa de transacciones.
+ * El de log de pjsua (PJSIP_MOD_PRIORITY_TRANSPORT_LAYER-1) los sigue viendo antes.
+ */
+pjsip_module OptionsFast::_Mod =
+{
+	NULL, NULL,									/* prev, next.			*/
+	{ const_cast<char *>("mod-coresip-options"), 19 },	/* Name.				*/
+	-1,											/* Id					*/
+	PJSIP_MOD_PRIORITY_TSX_LAYER - 1,			/* Priority				*/
+	NULL,										/* load()				*/
+	NULL,										/* start()				*/
+	NULL,										/* stop()				*/
+	NULL,										/* unload()				*/
+	&OptionsFast::OnRxRequest,					/* on_rx_request()		*/
+	NULL,										/* on_rx_response()		*/
+	NULL,										/* on_tx_request.		*/
+	NULL,										/* on_tx_response()		*/
+	NULL,										/* on_tsx_state()		*/
+};
+
+pj_bool_t OptionsFast::_Registered = PJ_FALSE;
+volatile pj_bool_t OptionsFast::_Enabled = PJ_FALSE;
+pjsip_transport * OptionsFast::_Transport = NULL;
+OptionsFast::Tail OptionsFast::_TailRadio;
+OptionsFast::Tail OptionsFast::_TailTelef;
+std::atomic<unsigned> OptionsFast::_Answered(0);
+
+/**
+ * Init.	...
+ * Genera las plantillas de la respuesta y registra el modulo. Se llama con los modulos de pjsua y CORESIP ya
+ * inicializados, para que las capacidades del endpoint (Allow, Supported, Allow-Events) esten completas.
+ * @param	tid		Transporte SIP UDP del agente. Por el se envian los OPTIONS de SendOptionsList.
+ */
+void OptionsFast::Init(pjsua_transport_id tid)
+{
+	pj_status_t st = RenderTail(&_TailRadio, &SipCall::gWG67VersionRadioValue);
+	PJ_CHECK_STATUS(st, ("ERROR generando la respuesta a OPTIONS"));
+	st = RenderTail(&_TailTelef, &SipCall::gWG67VersionTelefValue);
+	PJ_CHECK_STATUS(st, ("ERROR generando la respuesta a OPTIONS"));
+
+	_Transport = pjsua_var.tpdata[tid].data.tp;
+	_Answered = 0;
+
+	st = pjsip_endpt_register_module(pjsua_var.endpt, &_Mod);
+	PJ_CHECK_STATUS(st, ("ERROR registrando modulo OPTIONS"));
+	_Registered = PJ_TRUE;
+	_Enabled = PJ_TRUE;
+}
+
+/**
+ * End.	...
+ * Quita el modulo. Los OPTIONS vuelven a contestarse por mod-pjsua-options.
+ */
+void OptionsFast::End()
+{
+	_Enabled = PJ_FALSE;
+	if (_Registered)
+	{
+		pjsip_endpt_unregister_module(pjsua_var.endpt, &_Mod);
+		_Registered = PJ_FALSE;
+	}
+	_Transport = NULL;
+}
+
+/**
+ * Enable.	...
+ * Activa o desactiva la respuesta rapida sin quitar el modulo.
+ */
+void OptionsFast::Enable(pj_bool_t on)
+{
+	_Enabled = on && _Registered;
+}
+
+/**
+ * Answered.	...
+ * @return	Numero de OPTIONS contestados por la plantilla.
+ */
+unsigned OptionsFast::Answered()
+{
+	return _Answered;
+}
+
+/**
+ * RenderTail.	...
+ * Imprime las cabeceras y el cuerpo que options_on_rx_request de pjsua pone en la respuesta 200, y la cabecera
+ * WG67-Version que pondria SipCall::OnTxRequest. El SDP lleva la direccion de un transporte de media, como el de pjsua.
+ * @param	tail	Plantilla.
+ * @param	wg67	Valor de WG67-Version.
+ * @return	PJ_SUCCESS, o PJ_ETOOBIG si no cabe en la plantilla.
+ */
+pj_status_t OptionsFast::RenderTail(Tail * tail, const pj_str_t * wg67)
+{
+	static const pjsip_hdr_e caps[] = { PJSIP_H_ALLOW, PJSIP_H_ACCEPT, PJSIP_H_SUPPORTED };
+	char body[MAX_TAIL];
+	int body_len = 0, len;
+	char * p = tail->buf;
+	char * end = tail->buf + sizeof(tail->buf);
+
+	for (unsigned i = 0; i < PJ_ARRAY_SIZE(caps); i++)
+	{
+		const pjsip_hdr * hdr = pjsip_endpt_get_capability(pjsua_var.endpt, caps[i], NULL);
+		if (hdr == NULL) continue;
+		if ((len = pjsip_hdr_print_on((void *) hdr, p, end - p - 2)) < 0) return PJ_ETOOBIG;
+		p += len;
+		*p++ = '\r'; *p++ = '\n';
+	}
+
+	const pjsip_hdr * allow_events = pjsip_evsub_get_allow_events_hdr(NULL);
+	if (allow_events != NULL)
+	{
+		if ((len = pjsip_hdr_print_on((void *) allow_events, p, end - p - 2)) < 0) return PJ_ETOOBIG;
+		p += len;
+		*p++ = '\r'; *p++ = '\n';
+	}
+
+	if (pjsua_var.ua_cfg.user_agent.slen)
+	{
+		len = pj_ansi_snprintf(p, end - p, "User-Agent: %.*s\r\n", (int) pjsua_var.ua_cfg.user_agent.slen, pjsua_var.ua_cfg.user_agent.ptr);
+		if (len < 0 || len >= end - p) return PJ_ETOOBIG;
+		p += len;
+	}
+
+	len = pj_ansi_snprintf(p, end - p, "%.*s: %.*s\r\n", (int) SipCall::gWG67VersionName.slen, SipCall::gWG67VersionName.ptr,
+		(int) wg67->slen, wg67->ptr);
+	if (len < 0 || len >= end - p) return PJ_ETOOBIG;
+	p += len;
+
+	pjmedia_transport * med_tp = pjsua_media_transport_sample();
+	if (med_tp != NULL)
+	{
+		pjmedia_transport_info tpinfo;
+		pjmedia_sdp_session * sdp;
+
+		pj_pool_t * pool = pjsua_pool_create("OptionsFast", 1024, 1024);
+		if (pool == NULL) return PJ_ENOMEM;
+
+		pjmedia_transport_info_init(&tpinfo);
+		pjmedia_transport_get_info(med_tp, &tpinfo);
+		if (pjmedia_endpt_create_sdp(pjsua_var.med_endpt, pool, 1, &tpinfo.sock_info, &sdp) == PJ_SUCCESS)
+		{
+			if (pj_app_cbs.on_create_sdp) pj_app_cbs.on_create_sdp(NULL, PJSUA_INVALID_ID, sdp, NULL);
+			body_len = pjmedia_sdp_print(sdp, body, sizeof(body));
+		}
+		pj_pool_release(pool);
+		if (body_len < 0) return PJ_ETOOBIG;
+	}
+
+	if (body_len > 0)
+	{
+		len = pj_ansi_snprintf(p, end - p, "Content-Type: application/sdp\r\nContent-Length: %5d\r\n\r\n", body_len);
+	}
+	else
+	{
+		len = pj_ansi_snprintf(p, end - p, "Content-Length:  0\r\n\r\n");
+	}
+	if (len < 0 || len + body_len > end - p) return PJ_ETOOBIG;
+	p += len;
+	pj_memcpy(p, body, body_len);
+	p += body_len;
+
+	tail->len = (unsigned) (p - tail->buf);
+	return PJ_SUCCESS;
+}
+
+/**
+ * IsRadioAccount.	...
+ * Igual que SipCall::OnTxRequest para las respuestas: el agente es de radio, o lo es el account del To.
+ */
+pj_bool_t OptionsFast::IsRadioAccount(pjsip_rx_data * rdata)
+{
+	if (SipAgent::IsRadio || SipAgent::_Radio_UA) return PJ_TRUE;
+	if (!SipAgent::_HaveRdAcc) return PJ_FALSE;
+
+	pjsua_acc_id acc_id = pjsua_acc_find_for_incoming_by_uri(rdata->msg_info.to->uri);
+	if (acc_id == PJSUA_INVALID_ID) return PJ_FALSE;
+
+	ExtraParamAccId * extraParamAccCfg = (ExtraParamAccId *) pjsua_acc_get_user_data(acc_id);
+	return (extraParamAccCfg != NULL && extraParamAccCfg->rdAccount) ? PJ_TRUE : PJ_FALSE;
+}
+
+/**
+ * PrintHdr.	...
+ * Imprime una cabecera seguida de CRLF.
+ * @return	PJ_FALSE si no cabe.
+ */
+static pj_bool_t PrintHdr(void * hdr, char ** p, char * end)
+{
+	int len = pjsip_hdr_print_on(hdr, *p, end - *p - 2);
+	if (len < 0) return PJ_FALSE;
+	*p += len;
+	*(*p)++ = '\r';
+	*(*p)++ = '\n';
+	return PJ_TRUE;
+}
+
+/**
+ * OnRxRequest:	Callback. Se invoca antes que la capa de transacciones para cada peticion recibida.
+ *				Contesta con la plantilla los OPTIONS que mod-pjsua-options contestaria con 200.
+ * @param	rdata		Puntero 'pjsip_rx_data' a los datos recibidos.
+ * @return	PJ_TRUE si se ha contestado. PJ_FALSE para que siga por el camino normal.
+ */
+pj_bool_t OptionsFast::OnRxRequest(pjsip_rx_data * rdata)
+{
+	char buf[PJSIP_MAX_PKT_LEN];
+	pjsip_msg * msg = rdata->msg_info.msg;
+	pjsip_via_hdr * via = rdata->msg_info.via;
+	pjsip_to_hdr * to = rdata->msg_info.to;
+
+	if (!_Enabled) return PJ_FALSE;
+	if (msg->line.req.method.id != PJSIP_OPTIONS_METHOD) return PJ_FALSE;
+	if (rdata->tp_info.transport->key.type != PJSIP_TRANSPORT_UDP) return PJ_FALSE;
+	if (pjsua_var.thread_quit_flag) return PJ_FALSE;
+
+	//Solo fuera de dialogo, y sin maddr, que obliga a resolver el destino de la respuesta
+	if (to->tag.slen != 0 || via->maddr_param.slen != 0) return PJ_FALSE;
+
+	//Mismas comprobaciones que options_on_rx_request. Los 404 los sigue contestando pjsua
+	if (!PJSIP_URI_SCHEME_IS_SIP(to->uri) && !PJSIP_URI_SCHEME_IS_SIPS(to->uri)) return PJ_FALSE;
+	pjsip_sip_uri * sip_uri = (pjsip_sip_uri *) pjsip_uri_get_uri(to->uri);
+	if (sip_uri->user.slen == 0) return PJ_FALSE;
+
+	pjsua_acc_id acc_id = pjsua_acc_find_for_incoming(rdata);
+	if (!pjsua_acc_is_valid(acc_id)) return PJ_FALSE;
+	if (acc_id == pjsua_var.default_acc && pj_stricmp(&pjsua_var.acc[acc_id].user_part, &sip_uri->user) != 0) return PJ_FALSE;
+
+	const Tail * tail = IsRadioAccount(rdata) ? &_TailRadio : &_TailTelef;
+
+	/**
+	 * Cabeceras de la peticion, en el orden de pjsip_endpt_create_response. El tag del To es el branch del Via.
+	 */
+	char * p = buf;
+	char * end = buf + sizeof(buf) - tail->len;
+	pj_bool_t ok = PJ_TRUE;
+
+	pj_memcpy(p, "SIP/2.0 200 OK\r\n", 16);
+	p += 16;
+
+	for (pjsip_hdr * hdr = msg->hdr.next; ok && hdr != &msg->hdr; hdr = hdr->next)
+	{
+		if (hdr->type == PJSIP_H_VIA) ok = PrintHdr(hdr, &p, end);
+	}
+	for (pjsip_hdr * hdr = msg->hdr.next; ok && hdr != &msg->hdr; hdr = hdr->next)
+	{
+		if (hdr->type == PJSIP_H_RECORD_ROUTE) ok = PrintHdr(hdr, &p, end);
+	}
+	ok = ok && PrintHdr(rdata->msg_info.cid, &p, end) && PrintHdr(rdata->msg_info.from, &p, end);
+	if (ok)
+	{
+		to->tag = via->branch_param;
+		ok = PrintHdr(to, &p, end);
+		to->tag.slen = 0;
+	}
+	ok = ok && PrintHdr(rdata->msg_info.cseq, &p, end);
+	if (!ok) return PJ_FALSE;
+
+	pj_memcpy(p, tail->buf, tail->len);
+	p += tail->len;
+
+	/**
+	 * Destino segun RFC 3261 18.2.2 y RFC 3581, como pjsip_get_response_addr: con rport la direccion y el puerto
+	 * de origen, y si no la direccion de origen (received) y el puerto del sent-by.
+	 */
+	pj_sockaddr_in dst;
+	pj_memcpy(&dst, &rdata->pkt_info.src_addr, sizeof(dst));
+	if (via->rport_param < 0)
+	{
+		dst.sin_port = pj_htons((pj_uint16_t) (via->sent_by.port ? via->sent_by.port : 5060));
+	}
+
+	//Se envia sin pasar por el ioqueue del transporte. Si el socket no lo acepta se deja a pjsua, que lo encola
+	pj_ssize_t size = p - buf;
+	pj_sock_t sock = pjsip_udp_transport_get_socket(rdata->tp_info.transport);
+	if (pj_sock_sendto(sock, buf, &size, 0, &dst, sizeof(dst)) != PJ_SUCCESS) return PJ_FALSE;
+
+	_Answered++;
+
+	if (pjsua_var.log_cfg.msg_logging)
+	{
+		char info[64];
+		pj_ansi_snprintf(info, sizeof(info), "Response msg 200/OPTIONS/cseq=%d", rdata->msg_info.cseq->cseq);
+		LogTx(info, buf, (int) (p - buf), &dst);
+	}
+
+	return PJ_TRUE;
+}
+
+/**
+ * SendOptionsList.	...
+ * Envia OPTIONS a varios destinos desde el account por defecto, sin pasar por el proxy. Es lo mismo que llamar a
+ * SipCall::SendOptionsMsg para cada uno, pero las cabeceras comunes se preparan una vez y cada mensaje se imprime
+ * directamente en un buffer y se envia por el socket del transporte SIP.
+ * Los Call-ID son un identificador unico de la lista seguido del indice del destino.
+ * @param	targets		Uris a las que se envia OPTIONS.
+ * @param	callids		Buffers de CORESIP_MAX_CALLID_LENGTH caracteres para el callid de cada destino. Se deja vacio
+ *						si la uri del destino no es valida.
+ * @param	count		Numero de destinos.
+ * @param	isRadio		Si tiene valor distinto de cero el agente se identifica como radio (WG67-Version radio.01).
+ */
+void OptionsFast::SendOptionsList(const char ** targets, char ** callids, unsigned count, int isRadio)
+{
+	char guid_buf[PJ_GUID_MAX_LENGTH];
+	char from[CORESIP_MAX_URI_LENGTH + 16];
+	char head[128];
+	char tail[64];
+	char buf[PJSIP_MAX_PKT_LEN];
+	pj_str_t guid;
+
+	pjsua_acc_id acc_id = pjsua_acc_get_default();
+	if (!pjsua_acc_is_valid(acc_id)) return;
+
+	if (_Transport == NULL)
+	{
+		//No se ha inicializado. Se envian uno a uno
+		for (unsigned i = 0; i < count; i++) SipCall::SendOptionsMsg(targets[i], callids[i], isRadio);
+		return;
+	}
+
+	/**
+	 * Partes comunes: sent-by del Via, From con el id del account, WG67-Version y Content-Length.
+	 */
+	int head_len = pj_ansi_snprintf(head, sizeof(head), "SIP/2.0/UDP %.*s:%d;rport;branch=" PJSIP_RFC3261_BRANCH_ID "Pj",
+		(int) _Transport->local_name.host.slen, _Transport->local_name.host.ptr, _Transport->local_name.port);
+
+	int from_len;
+	{
+		char pool_buf[PARSE_POOL_SIZE];
+		pj_pool_t * pool = pj_pool_create_on_buf("OptionsList", pool_buf, sizeof(pool_buf));
+		pj_str_t id;
+		pj_strdup_with_null(pool, &id, &pjsua_var.acc[acc_id].cfg.id);
+		pjsip_uri * uri = pjsip_parse_uri(pool, id.ptr, id.slen, PJSIP_PARSE_URI_AS_NAMEADDR);
+		from_len = uri ? pjsip_uri_print(PJSIP_URI_IN_FROMTO_HDR, uri, from, sizeof(from)) : -1;
+	}
+	if (from_len <= 0)
+	{
+		PJ_CHECK_STATUS(PJSIP_EINVALIDURI, ("ERROR creando mensajes OPTIONS. El id del account no es valido"));
+	}
+
+	const pj_str_t * wg67 = isRadio ? &SipCall::gWG67VersionRadioValue : &SipCall::gWG67VersionTelefValue;
+	int tail_len = pj_ansi_snprintf(tail, sizeof(tail), "%.*s: %.*s\r\nContent-Length:  0\r\n\r\n",
+		(int) SipCall::gWG67VersionName.slen, SipCall::gWG67VersionName.ptr, (int) wg67->slen, wg67->ptr);
+
+	guid.ptr = guid_buf;
+	pj_generate_unique_string(&guid);
+
+	pj_sock_t sock = pjsip_udp_transport_get_socket(_Transport);
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		char pool_buf[PARSE_POOL_SIZE];
+		char req_uri[CORESIP_MAX_URI_LENGTH + 1];
+		char to_uri[CORESIP_MAX_URI_LENGTH + 1];
+		pj_str_t target = pj_str(const_cast<char *>(targets[i]));
+		pj_str_t target_dup;
+		pj_in_addr addr;
+
+		/*Se crea un string duplicado para el parse, ya que se ha visto que
+		pjsip_parse_uri puede modificar el parametro de entrada*/
+		pj_pool_t * pool = pj_pool_create_on_buf("OptionsList", pool_buf, sizeof(pool_buf));
+		pjsip_uri * uri = NULL;
+		if (target.slen < CORESIP_MAX_URI_LENGTH)
+		{
+			pj_strdup_with_null(pool, &target_dup, &target);
+			uri = pjsip_parse_uri(pool, target_dup.ptr, target_dup.slen, PJSIP_PARSE_URI_AS_NAMEADDR);
+		}
+		if (uri == NULL || (!PJSIP_URI_SCHEME_IS_SIP(uri) && !PJSIP_URI_SCHEME_IS_SIPS(uri)))
+		{
+			PJ_LOG(3,(THIS_FILE, "ERROR: La URI a la que se intenta enviar OPTIONS no es valida: %s", targets[i]));
+			callids[i][0] = '\0';
+			continue;
+		}
+
+		/**
+		 * Solo se envian aqui los destinos que son una direccion IPv4 por UDP. El resto necesitan resolver
+		 * el destino (DNS, maddr) o un transporte orientado a conexion.
+		 */
+		pjsip_sip_uri * sip_uri = (pjsip_sip_uri *) pjsip_uri_get_uri(uri);
+		pj_str_t udp = pj_str(const_cast<char *>("udp"));
+		if (PJSIP_URI_SCHEME_IS_SIPS(uri) || sip_uri->maddr_param.slen != 0 ||
+			(sip_uri->transport_param.slen != 0 && pj_stricmp(&sip_uri->transport_param, &udp) != 0) ||
+			!pj_inet_aton(&sip_uri->host, &addr))
+		{
+			SipCall::SendOptionsMsg(targets[i], callids[i], isRadio);
+			continue;
+		}
+
+		int req_len = pjsip_uri_print(PJSIP_URI_IN_REQ_URI, sip_uri, req_uri, sizeof(req_uri));
+		int to_len = pjsip_uri_print(PJSIP_URI_IN_FROMTO_HDR, uri, to_uri, sizeof(to_uri));
+		if (req_len <= 0 || to_len <= 0)
+		{
+			SipCall::SendOptionsMsg(targets[i], callids[i], isRadio);
+			continue;
+		}
+
+		int cid_len = pj_ansi_snprintf(callids[i], CORESIP_MAX_CALLID_LENGTH, "%.*s-%u", (int) guid.slen, guid.ptr, i);
+		int cseq = pj_rand() & 0xFFFF;
+
+		int len = pj_ansi_snprintf(buf, sizeof(buf),
+			"OPTIONS %.*s SIP/2.0\r\n"
+			"Via: %.*s%.*s\r\n"
+			"Max-Forwards: %d\r\n"
+			"From: %.*s;tag=%x.%.*s\r\n"
+			"To: %.*s\r\n"
+			"Call-ID: %.*s\r\n"
+			"CSeq: %d OPTIONS\r\n"
+			"%.*s",
+			req_len, req_uri,
+			head_len, head, cid_len, callids[i],
+			PJSIP_MAX_FORWARDS_VALUE,
+			from_len, from, i, 8, guid.ptr,
+			to_len, to_uri,
+			cid_len, callids[i],
+			cseq,
+			tail_len, tail);
+		if (len < 0 || len >= (int) sizeof(buf))
+		{
+			SipCall::SendOptionsMsg(targets[i], callids[i], isRadio);
+			continue;
+		}
+
+		pj_sockaddr_in dst;
+		pj_sockaddr_in_init(&dst, NULL, (pj_uint16_t) (sip_uri->port ? sip_uri->port : 5060));
+		dst.sin_addr = addr;
+
+		pj_ssize_t size = len;
+		if (pj_sock_sendto(sock, buf, &size, 0, &dst, sizeof(dst)) != PJ_SUCCESS)
+		{
+			//Socket lleno. Este se envia por pjsip, que lo encola
+			SipCall::SendOptionsMsg(targets[i], callids[i], isRadio);
+			continue;
+		}
+
+		if (pjsua_var.log_cfg.msg_logging)
+		{
+			char info[64];
+			pj_ansi_snprintf(info, sizeof(info), "Request msg OPTIONS/cseq=%d", cseq);
+			LogTx(info, buf, len, &dst);
+		}
+	}
+}
+
+/**
+ * LogTx.	...
+ * Traza del mensaje enviado, con el formato del log de mensajes de pjsua.
+ */
+void OptionsFast::LogTx(const char * info, const char * buf, int len, const pj_sockaddr_in * dst)
+{
+	char addr[PJ_INET_ADDRSTRLEN];
+
+	pj_inet_ntop(pj_AF_INET(), &dst->sin_addr, addr, sizeof(addr));
+	PJ_LOG(4,(THIS_FILE, "TX %d bytes %s (fast) to UDP %s:%d:\n"
+		"%.*s\n"
+		"--end msg--",
+		len, info, addr, pj_ntohs(dst->sin_port), len, buf));
+}
+
+/*@}*/
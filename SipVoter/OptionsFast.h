@@ -0,0 +1,68 @@
+/**
+ * @file OptionsFast.h
+ * @brief Respuesta y envio rapidos de los OPTIONS de supervision en CORESIP.dll
+ *
+ *	Implementa la clase 'OptionsFast'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_OPTIONSFAST_H__
+#define __CORESIP_OPTIONSFAST_H__
+
+#include <atomic>
+
+/**
+ * OptionsFast.
+ * Las radios, pasarelas y puestos se supervisan continuamente con OPTIONS. Esta clase los atiende sin pasar por
+ * la capa de transacciones ni crear un tx_data:
+ *
+ * - Un modulo con prioridad mayor que la capa de transacciones contesta 200 a los OPTIONS fuera de dialogo
+ *   recibidos por UDP dirigidos a un usuario del agente. La respuesta se copia de una plantilla generada en
+ *   Init() con las cabeceras fijas (Allow, Accept, Supported, Allow-Events, User-Agent, WG67-Version) y el SDP
+ *   que pondria mod-pjsua-options. Solo se imprimen las Via, Record-Route, Call-ID, From, To y CSeq de la
+ *   peticion, y se envia directamente por el socket del transporte SIP.
+ *   El resto de casos (404, TCP, maddr, respuesta que no cabe) siguen por el camino normal de pjsua.
+ *
+ * - SendOptionsList() envia OPTIONS a muchos destinos con una sola plantilla, en lugar de un tx_data, una
+ *   resolucion y un envio sin estado por destino. Las respuestas llegan por OnRxResponse igual que antes.
+ *   Los destinos que no son una direccion IPv4 por UDP se envian con SipCall::SendOptionsMsg.
+ */
+class OptionsFast
+{
+public:
+	static void Init(pjsua_transport_id tid);
+	static void End();
+	static void Enable(pj_bool_t on);
+	static unsigned Answered();
+
+	static void SendOptionsList(const char ** targets, char ** callids, unsigned count, int isRadio);
+
+private:
+	static const unsigned MAX_TAIL = 1024;					//Cabeceras fijas y cuerpo de la respuesta
+
+	/** Parte fija de la respuesta, tras el CSeq */
+	struct Tail
+	{
+		char buf[MAX_TAIL];
+		unsigned len;
+	};
+
+	static pjsip_module _Mod;
+	static pj_bool_t _Registered;
+	static volatile pj_bool_t _Enabled;
+	static pjsip_transport * _Transport;				//Transporte SIP UDP del agente
+	static Tail _TailRadio;
+	static Tail _TailTelef;
+	static std::atomic<unsigned> _Answered;
+
+	static pj_bool_t OnRxRequest(pjsip_rx_data * rdata);
+	static pj_status_t RenderTail(Tail * tail, const pj_str_t * wg67);
+	static pj_bool_t IsRadioAccount(pjsip_rx_data * rdata);
+	static void LogTx(const char * info, const char * buf, int len, const pj_sockaddr_in * dst);
+};
+
+#endif
+
+/*@}*/
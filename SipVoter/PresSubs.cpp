@@ -4,7 +4,7 @@
 
 #include "Global.h"
 #include "PresSubs.h"
-#include "exceptions.h"
+#include "Exceptions.h"
 #include "SipCall.h"
 
 #undef THIS_FILE
@@ -16,7 +16,7 @@ public:
 
 private:	
 	static pjsip_evsub_user presence_callback; 
-	static enum subs_status
+	enum subs_status
 	{
 		TERMINADA=0,
 		ACTIVADA,
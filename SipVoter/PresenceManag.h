@@ -4,6 +4,7 @@
 
 #include "Global.h"
 #include "PresSubs.h"
+#include "SubsTable.h"
 
 class PresenceManag
 {
@@ -20,17 +21,8 @@ private:
 
 	static const int MAX_SUBSCRIPTIONS = 1024;
 
-	struct st_subscrip
-	{
-		char *dst;		//Destino que se monitoriza en la subscripcion
-		char *user;		//Usuario de la uri de destino. Tanto user como domain nos servir para identificar la subscripcion en 
-						//este array. 
-		char *domain;	//Dominio de la uri de destino.
-		PresSubs *subs;	//Objeto que gestiona la subscripcion
-
-	} subscriptions[MAX_SUBSCRIPTIONS];
-
-	int subs_count;		//Nmero de subscripciones aadidas al array subcriptions
+	SubsTable subscriptions;	//Subscripciones por usuario y dominio de la uri de destino. Tanto user como domain nos servir 
+								//para identificar la subscripcion.
 	
 	pj_pool_t * _Pool;
 
@@ -1,11 +1,13 @@
 #include "Global.h"
 #include "RdRxPort.h"
 #include "Exceptions.h"
-#include "Guard.h"
+#include "SipAgent.h"
+#include "McastReceiver.h"
 
 /*En este puerto se recibe el audio procedente del NBOX por multicast.
-Se crea un socket para recibir el audio. Cada vez que se recibe audio se almacena en un buffer 
-jitter _Jbuf, y en la funcion GetFrame se extraen los datos de ese _Jbuf para el puerto.*/
+El audio lo recibe McastReceiver, que comparte el socket entre todos los puertos, y lo deja en la cola
+_RxSlots con Deliver. En la funcion GetFrame se pasa la cola al buffer jitter _Jbuf y se extraen los
+datos de ese _Jbuf para el puerto.*/
 
 RdRxPort::RdRxPort(unsigned clkRate, unsigned channelCount, unsigned bitsPerSample, unsigned frameTime, 
 							unsigned rClkRate, unsigned rChannelCount, unsigned rBitsPerSample, unsigned rFrameTime,
@@ -15,10 +17,14 @@ RdRxPort::RdRxPort(unsigned clkRate, unsigned channelCount, unsigned bitsPerSamp
 
 	_Pool = pjsua_pool_create(NULL, 512, 512);
 	_RemoteSamplesPerFrame = rClkRate * rChannelCount * rFrameTime / 1000;
-	_Sock = PJ_INVALID_SOCKET;
+	_RemoteFrameSize = _RemoteSamplesPerFrame * (rBitsPerSample / 8);
+	_RxSlotSize = (2 * sizeof(pj_uint32_t) + _RemoteFrameSize + 7) & ~7U;
+	_RxWr.store(0);
+	_RxRd.store(0);
+	_ResetJbuf.store(0);
 
 	unsigned samplesPerFrame = clkRate * channelCount * frameTime / 1000;
-	pjmedia_port_info_init(&info, &(pj_str("RSTR")), PJMEDIA_PORT_SIGNATURE('R', 'S', 'T', 'R'), 
+	pjmedia_port_info_init(&info, StrPtr(pj_str("RSTR")), PJMEDIA_PORT_SIGNATURE('R', 'S', 'T', 'R'), 
 		clkRate, channelCount, bitsPerSample, samplesPerFrame);
 
 	port_data.pdata = this;
@@ -30,8 +36,13 @@ RdRxPort::RdRxPort(unsigned clkRate, unsigned channelCount, unsigned bitsPerSamp
 
 	try
 	{
-		pj_status_t st = pj_lock_create_recursive_mutex(_Pool, NULL, &_Lock);
-		PJ_CHECK_STATUS(st, ("ERROR creando seccion critica para puerto de recepcion multicast radio"));
+		pj_status_t st;
+
+		_RxSlots = (char *) pj_pool_alloc(_Pool, RX_SLOTS * _RxSlotSize);
+		if (_RxSlots == NULL)
+		{
+			throw PJLibException(__FILE__, PJ_ENOMEM).Msg("ERROR creando cola para puerto de recepcion multicast radio");
+		}
 
 		unsigned jb_max = (pjsua_var.media_cfg.jb_max >= (int)rFrameTime) ? 
 			((pjsua_var.media_cfg.jb_max + rFrameTime - 1) / rFrameTime) : gJBufPframes; //(500 / rFrameTime);
@@ -42,7 +53,7 @@ RdRxPort::RdRxPort(unsigned clkRate, unsigned channelCount, unsigned bitsPerSamp
 		unsigned jb_init = (pjsua_var.media_cfg.jb_init >= (int)rFrameTime) ? 
 			(pjsua_var.media_cfg.jb_init / rFrameTime) : 0;
 
-		st = pjmedia_jbuf_create(_Pool, &(pj_str("RSTR")), _RemoteSamplesPerFrame * (rBitsPerSample / 8), rFrameTime, jb_max, &_Jbuf);
+		st = pjmedia_jbuf_create(_Pool, StrPtr(pj_str("RSTR")), _RemoteFrameSize, rFrameTime, jb_max, &_Jbuf);
 		PJ_CHECK_STATUS(st, ("ERROR creando buffer jitter para puerto de recepcion multicast radio"));
 		pjmedia_jbuf_set_adaptive(_Jbuf, jb_init, jb_min_pre, jb_max_pre);
 
@@ -52,38 +63,10 @@ RdRxPort::RdRxPort(unsigned clkRate, unsigned channelCount, unsigned bitsPerSamp
 		st = pjmedia_plc_create(_Pool, rClkRate, _RemoteSamplesPerFrame, 0, &_Plc);
 		PJ_CHECK_STATUS(st, ("ERROR creando plc para puerto de recepcion multicast radio"));
 
-		pj_sockaddr_in addr, mcastAddr;
-		pj_sockaddr_in_init(&addr, &(pj_str(const_cast<char*>(localIp))), (pj_uint16_t)mcastPort);
-		pj_sockaddr_in_init(&mcastAddr, &(pj_str(const_cast<char*>(mcastIp))), (pj_uint16_t)mcastPort);
-
-		/*_Sock. Socket por el que se recibe el audio distribuido por la direccin multicast*/
-
-		st = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &_Sock);
-		PJ_CHECK_STATUS(st, ("ERROR creando socket para puerto de recepcion multicast radio"));
-
-		int on = 1;
-		pj_sock_setsockopt(_Sock, pj_SOL_SOCKET(), SO_REUSEADDR, (void *)&on, sizeof(on));
-
-		st = pj_sock_bind(_Sock, &addr, sizeof(addr));
-		PJ_CHECK_STATUS(st, ("ERROR enlazando socket para puerto de recepcion multicast radio", "[Ip=%s][Port=%d]", localIp, mcastPort));
-
 		PJ_LOG(5,(__FILE__, "BSS: RdRxPort::RdRxPort McastAddr %s Port %d ", localIp, mcastPort));
 
-		struct ip_mreq	mreq;
-		mreq.imr_multiaddr.S_un.S_addr = mcastAddr.sin_addr.s_addr;
-		mreq.imr_interface.S_un.S_addr = addr.sin_addr.s_addr;
-
-		st = pj_sock_setsockopt(_Sock, IPPROTO_IP, pj_IP_ADD_MEMBERSHIP(), (void *)&mreq, sizeof(mreq));
-		PJ_CHECK_STATUS(st, ("ERROR aadiendo socket a multicast para puerto de recepcion multicast radio", "[Mcast=%s][Port=%d]", mcastIp, mcastPort));
-
-		pj_activesock_cb cb = { NULL };
-		cb.on_data_recvfrom = &OnDataReceived;
-
-		st = pj_activesock_create(_Pool, _Sock, pj_SOCK_DGRAM(), NULL, pjsip_endpt_get_ioqueue(pjsua_get_pjsip_endpt()), &cb, this, &_RemoteSock);
-		PJ_CHECK_STATUS(st, ("ERROR creando servidor de lectura para puerto de recepcion multicast radio"));
-
-		st = pj_activesock_start_recvfrom(_RemoteSock, _Pool, (_RemoteSamplesPerFrame * (rBitsPerSample / 8)) + sizeof(unsigned), 0);
-		PJ_CHECK_STATUS(st, ("ERROR iniciando lectura en puerto de recepcion multicast radio"));
+		SipAgent::_McastReceiver->Join(this, localIp, mcastIp, mcastPort);
+		_Joined = true;
 
 		st = pjsua_conf_add_port(_Pool, this, &Slot);
 		PJ_CHECK_STATUS(st, ("ERROR aadiendo al mezclador el puerto de recepcion multicast radio"));
@@ -108,7 +91,7 @@ pj_status_t RdRxPort::GetFrame(pjmedia_port * port, pjmedia_frame * frame)
 	unsigned samples_per_frame = pThis->_RemoteSamplesPerFrame;
 	pj_int16_t * p_out_samp = (pj_int16_t*)frame->buf;							// Las tramas recibidas (en el MCAST) son 16 bit con signo
 
-	Guard lock(pThis->_Lock);
+	pThis->DrainRx();
 
 	for (unsigned samples_count = 0; samples_count < samples_required; samples_count += samples_per_frame) 
 	{
@@ -214,22 +197,20 @@ pj_status_t RdRxPort::PutFrame(pjmedia_port * port, const pjmedia_frame * frame)
 pj_status_t RdRxPort::Reset(pjmedia_port * port)
 {
 	RdRxPort * pThis = reinterpret_cast<RdRxPort*>(port->port_data.pdata);
-	Guard lock(pThis->_Lock);
 
-	return pjmedia_jbuf_reset(pThis->_Jbuf);
+	//El buffer jitter solo lo toca GetFrame
+	pThis->_ResetJbuf.store(1, std::memory_order_release);
+	return PJ_SUCCESS;
 }
 
 pj_status_t RdRxPort::Dispose(pjmedia_port * port) 
 {
 	RdRxPort * pThis = reinterpret_cast<RdRxPort*>(port->port_data.pdata);
 
-	if (pThis->_RemoteSock)
+	if (pThis->_Joined)
 	{
-		pj_activesock_close(pThis->_RemoteSock);
-	}
-	else if (pThis->_Sock != PJ_INVALID_SOCKET)
-	{
-		pj_sock_close(pThis->_Sock);
+		SipAgent::_McastReceiver->Leave(pThis);
+		pThis->_Joined = false;
 	}
 	//if (pThis->_Plc)
 	//{
@@ -238,10 +219,6 @@ pj_status_t RdRxPort::Dispose(pjmedia_port * port)
 	{
 		pjmedia_jbuf_destroy(pThis->_Jbuf);
 	}
-	if (pThis->_Lock)
-	{
-		pj_lock_destroy(pThis->_Lock);
-	}
 	if (pThis->_Pool)
 	{
 		pj_pool_release(pThis->_Pool);
@@ -250,51 +227,75 @@ pj_status_t RdRxPort::Dispose(pjmedia_port * port)
 	return PJ_SUCCESS;
 }
 
-pj_bool_t RdRxPort::OnDataReceived(pj_activesock_t * asock, void * data, pj_size_t size, const pj_sockaddr_t *src_addr, int addr_len, pj_status_t status)
+/**
+ * Deliver.	...
+ * Lo llama el thread de McastReceiver con cada paquete recibido para el grupo del puerto. Lo deja
+ * en la cola sin bloquear. Si la cola esta llena el paquete se descarta.
+ * @param	data	Paquete: audio seguido de la secuencia, o RESTART_JBUF.
+ * @param	size	Tamano del paquete.
+ * @return	nada.
+ */
+void RdRxPort::Deliver(const void * data, pj_size_t size)
 {
-	/*Aqu se reciben los datos de _Socket y se guardan en el buffer jitter _Jbuf, de donde luego se extraen los datos en GetFrame*/
+	pj_uint32_t len;
 
-	RdRxPort * pThis = (RdRxPort*)pj_activesock_get_user_data(asock);
-	
-	if (status == PJ_SUCCESS)
+	if (size == _RemoteFrameSize + sizeof(unsigned))
 	{
-		if (size == ((pThis->_RemoteSamplesPerFrame * (BITS_PER_SAMPLE / 8)) + sizeof(unsigned)))
-		{
-			
-			/*
-			pj_size_t audio_size = size - sizeof(unsigned);
-			unsigned Tn1 = *((unsigned*)((char*)data + audio_size));
-			
-			audio_size = audio_size - sizeof(unsigned);
-			unsigned qidx_ml = *((unsigned*)((char*)data + audio_size));
-			
-			audio_size = audio_size - sizeof(unsigned);
-			unsigned qidx = *((unsigned*)((char*)data + audio_size));
-
-			Tn1 = pj_ntohl(Tn1);
-			qidx_ml = pj_ntohl(qidx_ml);
-			qidx = pj_ntohl(qidx);
-			PJ_LOG(5,(__FILE__, "TRAZA: RdRxPort::OnDataReceived qidx 0x%x, qidx_ml 0x%x, Tn1 0x%x", qidx, qidx_ml, Tn1));
-
-			audio_size = audio_size - sizeof(unsigned);
-			unsigned ext_seq = *((unsigned*)((char*)data + audio_size));
-			*/
+		len = _RemoteFrameSize;
+	}
+	else if (size == 1 && *((const char*)data) == RESTART_JBUF)
+	{
+		len = 0;
+	}
+	else
+	{
+		return;
+	}
+
+	unsigned wr = _RxWr.load(std::memory_order_relaxed);
+	if (wr - _RxRd.load(std::memory_order_acquire) >= RX_SLOTS)
+	{
+		return;
+	}
+
+	pj_uint32_t * slot = (pj_uint32_t *) (_RxSlots + (wr & (RX_SLOTS - 1)) * _RxSlotSize);
+	slot[0] = len;
+	if (len > 0)
+	{
+		slot[1] = *((const pj_uint32_t*)((const char*)data + len));
+		pj_memcpy(slot + 2, data, len);
+	}
+
+	_RxWr.store(wr + 1, std::memory_order_release);
+}
+
+/**
+ * DrainRx.	...
+ * Pasa los paquetes de la cola al buffer jitter. Desde GetFrame.
+ * @return	nada.
+ */
+void RdRxPort::DrainRx()
+{
+	unsigned rd = _RxRd.load(std::memory_order_relaxed);
+	unsigned wr = _RxWr.load(std::memory_order_acquire);
 
-			unsigned ext_seq = *((unsigned*)((char*)data + size - sizeof(unsigned)));
+	if (_ResetJbuf.exchange(0, std::memory_order_acquire))
+	{
+		pjmedia_jbuf_reset(_Jbuf);
+	}
 
-			Guard lock(pThis->_Lock);
-			pjmedia_jbuf_put_frame2(pThis->_Jbuf, data, size - sizeof(unsigned), 0, (int)pj_ntohl(ext_seq), NULL);
-			//pjmedia_jbuf_put_frame2(pThis->_Jbuf, data, audio_size, 0, (int)pj_ntohl(ext_seq), NULL);
+	for (; rd != wr; rd++)
+	{
+		pj_uint32_t * slot = (pj_uint32_t *) (_RxSlots + (rd & (RX_SLOTS - 1)) * _RxSlotSize);
+		if (slot[0] == 0)
+		{
+			pjmedia_jbuf_reset(_Jbuf);
 		}
-		else if (size == 1)
+		else
 		{
-			if (*((char*)data) == RESTART_JBUF)
-			{
-				Guard lock(pThis->_Lock);
-				pjmedia_jbuf_reset(pThis->_Jbuf);
-			}
+			pjmedia_jbuf_put_frame2(_Jbuf, slot + 2, slot[0], 0, (int)pj_ntohl(slot[1]), NULL);
 		}
 	}
 
-	return PJ_TRUE;
-}
\ No newline at end of file
+	_RxRd.store(rd, std::memory_order_release);
+}
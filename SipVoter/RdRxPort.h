@@ -1,6 +1,8 @@
 #ifndef __CORESIP_RDRXPORT_H__
 #define __CORESIP_RDRXPORT_H__
 
+#include <atomic>
+
 class RdRxPort : public pjmedia_port
 {
 public:
@@ -12,15 +14,26 @@ public:
 		const char * localIp, const char * mcastIp, unsigned mcastPort);
 	~RdRxPort();
 
+	void Deliver(const void * data, pj_size_t size);
+
 private:
+	static const unsigned RX_SLOTS = 32;	//Paquetes recibidos pendientes de pasar al buffer jitter. Potencia de 2
+
 	pj_pool_t * _Pool;
-	pj_lock_t * _Lock;
 	pjmedia_jbuf * _Jbuf;
 	pjmedia_plc * _Plc;
 	unsigned _RemoteSamplesPerFrame;
+	unsigned _RemoteFrameSize;
 	char _LastFrameType;
-	pj_sock_t _Sock;
-	pj_activesock_t * _RemoteSock;
+	bool _Joined;
+
+	//Cola de paquetes sin bloqueos. La escribe el thread de McastReceiver y la vacia GetFrame,
+	//que es el unico que usa _Jbuf y _Plc
+	char * _RxSlots;						//RX_SLOTS ranuras de _RxSlotSize bytes: longitud, secuencia y audio
+	unsigned _RxSlotSize;
+	std::atomic<unsigned> _RxWr;
+	std::atomic<unsigned> _RxRd;
+	std::atomic<int> _ResetJbuf;			//Reset pedido fuera de GetFrame
 
 private:
 	static pj_status_t GetFrame(pjmedia_port * port, pjmedia_frame * frame);
@@ -28,7 +41,7 @@ private:
 	static pj_status_t Reset(pjmedia_port * port);
 	static pj_status_t Dispose(pjmedia_port * port);
 
-	static pj_bool_t OnDataReceived(pj_activesock_t * asock, void * data, pj_size_t size, const pj_sockaddr_t *src_addr, int addr_len, pj_status_t status);
+	void DrainRx();
 };
 
 #endif
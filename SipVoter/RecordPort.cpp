@@ -26,7 +26,6 @@ const char *RecordPort::REC_HOLDOFF = "V,T09,";
 const char *RecordPort::REC_RECORD = "V,I01,";
 const char *RecordPort::REC_PAUSE = "V,I02,";
 const char *RecordPort::REC_RESET = "C,H02";
-const char *RecordPort::REC_NOT_MESSAGE = "NOMES";
 
 //Respuestas del grabador
 const char *RecordPort::RESPOK = "G,E00,0";
@@ -51,9 +50,18 @@ int RecordPort::timer_id = 1;
  */
 RecordPort::RecordPort(int resType, const char * TerminalIpAdd, const char * RecIp, unsigned recPort, const char *TerminalId)
 {
-	pj_memset(this, 0, sizeof(RecordPort));	
-
+	//No se pone todo el objeto a cero: las colas de comandos y respuestas ya estan construidas
 	_Pool = NULL;
+	record_mutex = NULL;
+	frequencies_mutex = NULL;
+	mutex = NULL;
+	actions_mutex = NULL;
+	actions_thread_run = 0;
+	sessionControlTh_run = 0;
+	pj_bzero(&_Port, sizeof(_Port));
+	pj_bzero(&recAddr, sizeof(recAddr));
+	pj_bzero(RecTerminalIpAdd, sizeof(RecTerminalIpAdd));
+	pj_bzero(&update_session_timer, sizeof(update_session_timer));
 	_Sock = PJ_INVALID_SOCKET;
 	_SockSt = PJ_INVALID_SOCKET;
 	_RemoteSock = NULL;
@@ -63,9 +71,17 @@ RecordPort::RecordPort(int resType, const char * TerminalIpAdd, const char * Rec
 	Slot = PJSUA_INVALID_ID;
 	ctrlSessEvent = NULL;
 	actions_thread = NULL;
-	actions_sem = NULL;
+	actions_event = NULL;
+	flush_in_flight = PJ_FALSE;
+	cmd_nseq = 0;
+	timer_nseq = 0;
+	timer_tries = 0;
+	expired_nseq = 0;
+	pj_bzero(&cmd_stats, sizeof(cmd_stats));
 	session_thread = NULL;
 	pj_bzero(_RecursoTipoTerminal, sizeof(_RecursoTipoTerminal));
+	pj_bzero(mess_media, sizeof(mess_media));
+	media_prefix_len = 0;
 	nsec_media = 0;
 	SessStatus = RECPORT_SESSION_IDLE;
 	Resource_type = resType;
@@ -104,10 +120,18 @@ RecordPort::RecordPort(int resType, const char * TerminalIpAdd, const char * Rec
 		else
 			strcat(_RecursoTipoTerminal, "-RAD");
 
+		//La cabecera de los mensajes de media "V,MMM,<terminal>," no cambia durante la vida del objeto.
+		//Se deja escrita en mess_media y en cada trama solo se escribe el numero de secuencia detras.
+		pj_assert(sizeof(mess_media) > strlen("V,MMM,") + strlen(_RecursoTipoTerminal) + 1 + 16 + SAMPLES_PER_FRAME);
+		strcpy(mess_media, "V,MMM,");
+		strcat(mess_media, _RecursoTipoTerminal);
+		strcat(mess_media, ",");
+		media_prefix_len = strlen(mess_media);
+
 		pj_status_t st = pj_lock_create_recursive_mutex(_Pool, NULL, &_Lock);
 		PJ_CHECK_STATUS(st, ("ERROR creando seccion critica para puerto de grabacion RecordPort"));
 
-		pjmedia_port_info_init(&_Port.info, &(pj_str("RECP")), PJMEDIA_PORT_SIGNATURE('R', 'E', 'C', 'P'), 
+		pjmedia_port_info_init(&_Port.info, StrPtr(pj_str("RECP")), PJMEDIA_PORT_SIGNATURE('R', 'E', 'C', 'P'), 
 				SAMPLING_RATE, CHANNEL_COUNT, BITS_PER_SAMPLE, SAMPLES_PER_FRAME);
 
 		_Port.port_data.pdata = this;
@@ -151,29 +175,18 @@ RecordPort::RecordPort(int resType, const char * TerminalIpAdd, const char * Rec
 		st = pj_mutex_create_simple(_Pool, "RecActionsMtx", &record_mutex);
 		PJ_CHECK_STATUS(st, ("ERROR creando mutex de conexion puerto audio con grabador"));
 
-		st = pj_sem_create(_Pool, "RecActionsSem", 0, MAX_REC_COMMANDS_QUEUE*2, &actions_sem);
-		PJ_CHECK_STATUS(st, ("ERROR creando semaforo de acciones al grabador"));		
+		st = pj_event_create(_Pool, "RecActionsEvent", false, false, &actions_event);
+		PJ_CHECK_STATUS(st, ("ERROR creando evento de acciones al grabador"));		
 
 		st = pj_mutex_create_simple(_Pool, "RecActionsMtx", &actions_mutex);
 		PJ_CHECK_STATUS(st, ("ERROR creando mutex de acciones sobre el grabador"));
 
-		Rec_Command_queue.iRecw = 0;
-		Rec_Command_queue.iRecr = 0;
-		Rec_Command_queue.RecComHoles = MAX_REC_COMMANDS_QUEUE;
-
-		Rec_RecPau_queue.iRecw = 0;
-		Rec_RecPau_queue.iRecr = 0;
-		Rec_RecPau_queue.RecComHoles = MAX_REC_COMMANDS_QUEUE;
-
 		actions_thread_run = 1;
 		st = pj_thread_create(_Pool, "RecordActionsTh", &RecordActionsTh, this, 0, 0, &actions_thread);
 		PJ_CHECK_STATUS(st, ("ERROR creando thread de lectura del grabador"));
 
 		//Thread lectura mensajes del grabador
 		_Pool = pjsua_pool_create(NULL, 1024, 512);
-		st = pj_sem_create(_Pool, "ReadServiceSem", 0, 1, &sem);
-		PJ_CHECK_STATUS(st, ("ERROR creando semaforo de lectura del grabador"));
-
 		st = pj_mutex_create_simple(_Pool, "ReadServiceMtx", &mutex);
 		PJ_CHECK_STATUS(st, ("ERROR creando mutex del puerto del grabador"));
 
@@ -208,7 +221,7 @@ RecordPort::RecordPort(int resType, const char * TerminalIpAdd, const char * Rec
 		st = pj_thread_create(_Pool, "SessionControl", &SessionControlTh, this, 0, 0, &session_thread);
 		PJ_CHECK_STATUS(st, ("ERROR creando thread de control de sesion del grabador"));
 				
-		pj_sockaddr_in_init(&recAddr, &(pj_str(const_cast<char*>(RecIp))), (pj_uint16_t)recPort);
+		pj_sockaddr_in_init(&recAddr, StrPtr(pj_str(const_cast<char*>(RecIp))), (pj_uint16_t)recPort);
 		
 		//Configura timer para actualizar estado de la sesion de grabacion		
 		st = StartSessionTimer(NO_SESSION_TIMER);
@@ -262,11 +275,11 @@ void RecordPort::Dispose()
 		pj_file_close(sim_rec_tx_fd);
 #endif		
 
-	if (actions_thread != NULL && actions_sem != NULL)
+	if (actions_thread != NULL && actions_event != NULL)
 	{
 		actions_thread_run = 0;
 		Wait_response_timeout_sec = 0;
-		pj_sem_post(actions_sem);
+		pj_event_set(actions_event);
 		st = pj_thread_join(actions_thread);
 		st = pj_thread_destroy(actions_thread);	
 	}
@@ -383,14 +396,12 @@ int RecordPort::SessionControlTh(void *proc)
 		//ha habido un error, como por ejemplo que el grabador se ha reseteado
 		//Se inicia la sesion desde cero
 		pj_mutex_lock(wp->actions_mutex);
-		while (pj_sem_trywait(wp->actions_sem) == PJ_SUCCESS); 
-		wp->Rec_Command_queue.iRecw = 0;
-		wp->Rec_Command_queue.iRecr = 0;
-		wp->Rec_Command_queue.RecComHoles = MAX_REC_COMMANDS_QUEUE;
-		wp->Rec_RecPau_queue.iRecw = 0;
-		wp->Rec_RecPau_queue.iRecr = 0;
-		wp->Rec_RecPau_queue.RecComHoles = MAX_REC_COMMANDS_QUEUE;
+		wp->Rec_Command_queue.clear();
+		wp->Rec_RecPau_queue.clear();
+		wp->cmd_stats.queued = 0;
+		wp->flush_in_flight = PJ_TRUE;		//Los pendientes de respuesta los descarta RecordActionsTh
 		pj_mutex_unlock(wp->actions_mutex);			
+		pj_event_set(wp->actions_event);
 
 		wp->recording_by_rad = 0;
 		wp->recording_by_tel = 0;
@@ -450,7 +461,8 @@ int RecordPort::SessionControlTh(void *proc)
 
 /**
  * RecordActionsTh.	...
- * Tarea que enva los comandos de grabacin y espera la respuesta.
+ * Tarea que enva los comandos de grabacin y procesa las respuestas y los timeouts.
+ * No se bloquea esperando respuesta: se despierta con actions_event y atiende todo lo pendiente.
  * @return	retorno de la tarea.
  */
 int RecordPort::RecordActionsTh(void *proc)
@@ -483,348 +495,567 @@ int RecordPort::RecordActionsTh(void *proc)
         return 0;
     }
 
-	//Mientras haya mensajes a enviar no termina la tarea
 	while (wp->actions_thread_run)
 	{
-		st = pj_sem_wait(wp->actions_sem);
+		st = pj_event_wait(wp->actions_event);
 		if (st != PJ_SUCCESS) break;
-		//PJ_CHECK_STATUS(st, ("ERROR pj_sem_wait(wp->actions_sem)"));
 		if (!wp->actions_thread_run) 
 		{
 			continue;
 		}
 
-		char mess[MAX_COMMAND_LEN];
+		wp->ProcessActions();
+	}
+
+	wp->send_command_timer.id = 0;
+	pjsua_cancel_timer(&wp->send_command_timer);
 
-		st = pj_mutex_lock(wp->actions_mutex);
-		if (st != PJ_SUCCESS)
+	return 0;
+}
+
+/**
+ * ProcessActions.	...
+ * Atiende en orden: el reinicio de sesion, las respuestas recibidas, el timeout del comando pendiente
+ * y el envio del siguiente comando cuando no queda ninguno pendiente de respuesta.
+ * El grabador no devuelve ningun identificador en las respuestas, asi que solo hay un comando en vuelo.
+ * Si se ha reenviado, no se envia el siguiente hasta recibir la respuesta de cada envio o vencer su timeout,
+ * para que una respuesta tardia no se atribuya al comando siguiente. Solo se llama desde RecordActionsTh.
+ * @return	nada.
+ */
+void RecordPort::ProcessActions()
+{
+	//Tras un reinicio de sesion se olvidan los comandos enviados y sus respuestas
+	pj_mutex_lock(actions_mutex);
+	pj_bool_t flush = flush_in_flight;
+	flush_in_flight = PJ_FALSE;
+	pj_mutex_unlock(actions_mutex);
+	if (flush)
+	{
+		Rec_InFlight.clear();
+		pj_mutex_lock(mutex);
+		Rec_Responses.clear();
+		expired_nseq = 0;
+		pj_mutex_unlock(mutex);
+	}
+
+	//Respuestas
+	for (;;)
+	{
+		REC_RESPONSE res;
+		pj_mutex_lock(mutex);
+		bool empty = Rec_Responses.empty();
+		if (!empty)
 		{
-			break;
-			//PJ_CHECK_STATUS(st, ("ERROR pj_mutex_lock(wp->actions_mutex)"));
-		}		
+			res = Rec_Responses.front();
+			Rec_Responses.pop_front();
+		}
+		pj_mutex_unlock(mutex);
+		if (empty) break;
+
+		if (Rec_InFlight.empty())
+		{
+			PJ_LOG(5,(__FILE__, "RecordPort: Respuesta del grabador sin comando pendiente. Se ignora. %s", _RecursoTipoTerminal));
+			pj_mutex_lock(actions_mutex);
+			cmd_stats.unmatched++;
+			pj_mutex_unlock(actions_mutex);
+			continue;
+		}
+
+		REC_COMMAND &front = Rec_InFlight.front();
+		front.replies++;
+
+		if (front.done)
+		{
+			//Respuesta a un envio anterior de un comando ya atendido
+			PJ_LOG(5,(__FILE__, "RecordPort: Respuesta tardia al comando %u. Se ignora. %s", front.nseq, _RecursoTipoTerminal));
+			pj_mutex_lock(actions_mutex);
+			cmd_stats.late++;
+			pj_mutex_unlock(actions_mutex);
+		}
+		else if (res == REC_BAD_RESPONSE && front.tries < TRIES_SENDING_CMD)
+		{
+			ResendCommand();
+		}
+		else
+		{
+			front.done = true;
+			REC_COMMAND cmd = front;
+			CommandDone(&cmd, res);
+		}
 
-		COMMAND_QUEUE *Command_queue;
+		if (Rec_InFlight.front().done && Rec_InFlight.front().replies >= Rec_InFlight.front().tries)
+		{
+			Rec_InFlight.pop_front();
+		}
+	}
 
-		if (wp->Rec_RecPau_queue.RecComHoles < MAX_REC_COMMANDS_QUEUE)
+	//Timeout del comando pendiente
+	pj_mutex_lock(mutex);
+	pj_uint32_t expired = expired_nseq;
+	expired_nseq = 0;
+	pj_mutex_unlock(mutex);
+
+	if (expired != 0 && !Rec_InFlight.empty() && Rec_InFlight.front().nseq == expired)
+	{
+		if (Rec_InFlight.front().done)
 		{
-			//Hay mensajes RECORD/PAUSE en cola. Tienen prioridad
-			Command_queue = &wp->Rec_RecPau_queue;			
+			//Ya no se esperan mas respuestas tardias
+			Rec_InFlight.pop_front();
 		}
-		else if (wp->Rec_Command_queue.RecComHoles < MAX_REC_COMMANDS_QUEUE)
+		else if (Rec_InFlight.front().tries < TRIES_SENDING_CMD)
 		{
-			Command_queue = &wp->Rec_Command_queue;
+			ResendCommand();
 		}
 		else
 		{
-			st = pj_mutex_unlock(wp->actions_mutex);
-			if (st != PJ_SUCCESS) break;
-			//PJ_CHECK_STATUS(st, ("ERROR pj_mutex_unlock en RecordActionsTh"));
+			REC_COMMAND cmd = Rec_InFlight.front();
+			Rec_InFlight.pop_front();
+			pj_mutex_lock(actions_mutex);
+			cmd_stats.timeouts++;
+			pj_mutex_unlock(actions_mutex);
+			CommandDone(&cmd, REC_NO_RESPONSE);
+		}
+	}
+
+	//Comandos nuevos
+	REC_COMMAND cmd;
+	while (actions_thread_run && GetNextCommand(&cmd))
+	{
+		if (!FilterCommand(&cmd))
+		{
+			pj_mutex_lock(actions_mutex);
+			cmd_stats.skipped++;
+			pj_mutex_unlock(actions_mutex);
 			continue;
 		}
 
-		pj_memcpy(mess, Command_queue->queue[Command_queue->iRecr].buf, 
-			Command_queue->queue[Command_queue->iRecr].len);
-		pj_ssize_t messlen = Command_queue->queue[Command_queue->iRecr].len;
-		if (++Command_queue->iRecr == MAX_REC_COMMANDS_QUEUE)
-			Command_queue->iRecr = 0;
-		Command_queue->RecComHoles++;
+		SendCommand(&cmd);
 
-		st = pj_mutex_unlock(wp->actions_mutex);
-		if (st != PJ_SUCCESS) break;
-		//PJ_CHECK_STATUS(st, ("ERROR pj_mutex_unlock en RecordActionsTh"));
+#ifdef DEBUG_GRABACION
+		CommandDone(&cmd, REC_OK_RESPONSE);
+		continue;
+#endif
 
-		REC_RESPONSE res;	
+		//Si el envio ha fallado se reintenta cuando venza el timeout
+		Rec_InFlight.push_back(cmd);
+	}
 
-		if (strncmp(mess, REC_RECORD, strlen(REC_RECORD)) == 0)
-		{			
-			if (wp->Resource_type == TEL_RESOURCE)
+	pj_mutex_lock(actions_mutex);
+	cmd_stats.in_flight = (unsigned) Rec_InFlight.size();
+	if (cmd_stats.in_flight > cmd_stats.in_flight_max) cmd_stats.in_flight_max = cmd_stats.in_flight;
+	pj_mutex_unlock(actions_mutex);
+
+	ArmCommandTimer();
+}
+
+/**
+ * GetNextCommand.	...
+ * Saca de las colas el siguiente comando a enviar, si se puede enviar ya.
+ * Los RECORD y PAUSE tienen prioridad. No se extrae ninguno mientras haya MAX_REC_COMMANDS_IN_FLIGHT
+ * comandos pendientes de respuesta.
+ * @param	cmd		Comando extraido.
+ * @return	true si se ha extraido un comando.
+ */
+bool RecordPort::GetNextCommand(REC_COMMAND *cmd)
+{
+	if (Rec_InFlight.size() >= MAX_REC_COMMANDS_IN_FLIGHT) return false;
+
+	COMMAND_QUEUE *Command_queue = NULL;
+
+	pj_mutex_lock(actions_mutex);
+	if (!Rec_RecPau_queue.empty())
+	{
+		//Hay mensajes RECORD/PAUSE en cola. Tienen prioridad
+		Command_queue = &Rec_RecPau_queue;
+	}
+	else if (!Rec_Command_queue.empty())
+	{
+		Command_queue = &Rec_Command_queue;
+	}
+
+	if (Command_queue != NULL)
+	{
+		*cmd = Command_queue->front();
+		Command_queue->pop_front();
+		cmd_stats.queued--;
+	}
+	pj_mutex_unlock(actions_mutex);
+
+	return (Command_queue != NULL);
+}
+
+/**
+ * FilterCommand.	...
+ * Decide justo antes de enviarlo si el comando sigue siendo necesario, y hace lo que deba preceder a su envio.
+ * @param	cmd		Comando.
+ * @return	false si no hay que enviarlo.
+ */
+bool RecordPort::FilterCommand(const REC_COMMAND *cmd)
+{
+	const char *mess = cmd->buf;
+
+	if (strncmp(mess, REC_RECORD, strlen(REC_RECORD)) == 0)
+	{			
+		if (Resource_type == TEL_RESOURCE)
+		{
+			if (recording_by_tel > 0)
 			{
-				if (wp->recording_by_tel > 0)
-				{
-					continue;
-				}
-				else
-				{
-					int numcalls = SipAgent::NumConfirmedCalls();
-					if (numcalls > 0)
-					{
-						wp->recording_by_tel = 1;
-					}
-					else
-					{
-						//No enviamos la orden de record si no hay llamadas confimadas con media
-						continue;
-					}
-				}
+				return false;
 			}
 			else
 			{
-				if (wp->recording_by_rad > 0)
+				int numcalls = SipAgent::NumConfirmedCalls();
+				if (numcalls > 0)
 				{
-					//Existen otros recursos que ya estn grabando.
-					//No se enva el comando
-					continue;
+					recording_by_tel = 1;
+				}
+				else
+				{
+					//No enviamos la orden de record si no hay llamadas confimadas con media
+					return false;
 				}
-				wp->recording_by_rad = 1;
 			}
 		}
-		else if (strncmp(mess, REC_PAUSE, strlen(REC_PAUSE)) == 0)
+		else
 		{
-			if (wp->Resource_type == TEL_RESOURCE)
+			if (recording_by_rad > 0)
 			{
-				//Si el mensaje es PAUSE comprobamos si podemos enviarlo o no
-				//dependiendo del nmero de llamadas con media
-				int numcalls = SipAgent::NumConfirmedCalls();
-				if (numcalls > 0 || wp->recording_by_tel == 0)
-				{
-					continue;
-				}
-
-				wp->recording_by_tel = 0;
+				//Existen otros recursos que ya estn grabando.
+				//No se enva el comando
+				return false;
 			}
-			else if (wp->Resource_type == RAD_RESOURCE)
-			{	
-				int recording_by_ptt_aux;
-				int recording_by_squ_aux;
-				int recording_by_rad_aux = wp->recording_by_rad;
-
-				wp->GetNumSquPtt(&recording_by_ptt_aux, &recording_by_squ_aux);
-				wp->recording_by_rad = recording_by_ptt_aux + recording_by_squ_aux;
-
-				if (wp->recording_by_rad > 0)
-					//Si hay alguna frecuencia con squelch o ptt activado entonces no mandamos el PAUSE
-					continue;
-				else if (recording_by_rad_aux == 0)
-				{
-					//No hay cambio de estado. No se enva PAUSE. Ya se ha enviado.
-					continue;
-				}
-			}
-			
-			//Se desconectan todos los puertos que estaban conectados con el de grabacion tanto Tx como Rx
-			SipAgent::RecConnectSndPorts(false, wp);
-			wp->ConnectRx(false);
+			recording_by_rad = 1;
 		}
-		else if (strncmp(mess, REC_HOLDON, strlen(REC_HOLDON)) == 0)
+	}
+	else if (strncmp(mess, REC_PAUSE, strlen(REC_PAUSE)) == 0)
+	{
+		if (Resource_type == TEL_RESOURCE)
 		{
-			/*Se ha visto en el grabador de Tenerife que con el comando de aparcar 
-				la grabacin se interrumpe. Por lo tanto si hay ms de 1 llamada confirmada 
-				entonces no lo enviamos porque si no se cortara la grabacion de la voz de la otra llamada. Esto
-				se ha detectado en las transferencias*/
+			//Si el mensaje es PAUSE comprobamos si podemos enviarlo o no
+			//dependiendo del nmero de llamadas con media
 			int numcalls = SipAgent::NumConfirmedCalls();
-			if (numcalls > 1)
+			if (numcalls > 0 || recording_by_tel == 0)
 			{
-				continue;
+				return false;
 			}
+
+			recording_by_tel = 0;
 		}
-		else if (strncmp(mess, REC_PTTON, strlen(REC_PTTON)) == 0)
-		{			
+		else if (Resource_type == RAD_RESOURCE)
+		{	
+			int recording_by_ptt_aux;
+			int recording_by_squ_aux;
+			int recording_by_rad_aux = recording_by_rad;
+
+			GetNumSquPtt(&recording_by_ptt_aux, &recording_by_squ_aux);
+			recording_by_rad = recording_by_ptt_aux + recording_by_squ_aux;
+
+			if (recording_by_rad > 0)
+				//Si hay alguna frecuencia con squelch o ptt activado entonces no mandamos el PAUSE
+				return false;
+			else if (recording_by_rad_aux == 0)
+			{
+				//No hay cambio de estado. No se enva PAUSE. Ya se ha enviado.
+				return false;
+			}
 		}
-		else if (strncmp(mess, SQUELCH_ON, strlen(SQUELCH_ON)) == 0)
+		
+		//Se desconectan todos los puertos que estaban conectados con el de grabacion tanto Tx como Rx
+		SipAgent::RecConnectSndPorts(false, this);
+		ConnectRx(false);
+	}
+	else if (strncmp(mess, REC_HOLDON, strlen(REC_HOLDON)) == 0)
+	{
+		/*Se ha visto en el grabador de Tenerife que con el comando de aparcar 
+			la grabacin se interrumpe. Por lo tanto si hay ms de 1 llamada confirmada 
+			entonces no lo enviamos porque si no se cortara la grabacion de la voz de la otra llamada. Esto
+			se ha detectado en las transferencias*/
+		int numcalls = SipAgent::NumConfirmedCalls();
+		if (numcalls > 1)
 		{
+			return false;
 		}
-		else if (strncmp(mess, REC_PTTOFF, strlen(REC_PTTOFF)) == 0)
-		{
+	}
+	else if (strncmp(mess, REC_PTTON, strlen(REC_PTTON)) == 0)
+	{			
+	}
+	else if (strncmp(mess, SQUELCH_ON, strlen(SQUELCH_ON)) == 0)
+	{
+	}
+	else if (strncmp(mess, REC_PTTOFF, strlen(REC_PTTOFF)) == 0)
+	{
 
-		}
-		else if (strncmp(mess, SQUELCH_OFF, strlen(SQUELCH_OFF)) == 0)
-		{
+	}
+	else if (strncmp(mess, SQUELCH_OFF, strlen(SQUELCH_OFF)) == 0)
+	{
 
-		}
+	}
 
-		pj_thread_sleep(SLEEP_FOR_SIMU);
+	return true;
+}
 
-		res = wp->SendCommand(mess, (pj_ssize_t *) &messlen, &wp->recAddr, sizeof(wp->recAddr), true);
+/**
+ * CommandDone.	...
+ * Procesa la respuesta de un comando, o su falta de respuesta tras TRIES_SENDING_CMD envios.
+ * @param	cmd		Comando.
+ * @param	res		Respuesta.
+ * @return	nada.
+ */
+void RecordPort::CommandDone(const REC_COMMAND *cmd, REC_RESPONSE res)
+{
+	const char *mess = cmd->buf;
 
-		bool update_sesion = false;
+	bool update_sesion = false;
 
-		if (res == REC_NO_RESPONSE)
+	if (res == REC_NO_RESPONSE)
+	{
+		update_sesion = true;
+		PJ_LOG(3,(__FILE__, "ERROR: Recorder does not respond. message sent %s", mess));			
+	}
+	else if ((strncmp(mess, FIN_SES_REC_TERM, strlen(FIN_SES_REC_TERM)) == 0 && Resource_type == TEL_RESOURCE) ||
+		(strncmp(mess, FIN_SES_REC_RAD, strlen(FIN_SES_REC_RAD)) == 0 && Resource_type == RAD_RESOURCE))
+	{
+		if (res == REC_OK_RESPONSE || res == REC_SESSION_CLOSED)
+		{
+			SessStatus = RECPORT_SESSION_CLOSED;
+		}
+		else 
 		{
+			SessStatus = RECPORT_SESSION_ERROR;
+			PJ_LOG(3,(__FILE__, "ERROR: Record Session cannot be finished"));
 			update_sesion = true;
-			PJ_LOG(3,(__FILE__, "ERROR: Recorder does not respond. message sent %s", mess));			
 		}
-		else if ((strncmp(mess, FIN_SES_REC_TERM, strlen(FIN_SES_REC_TERM)) == 0 && wp->Resource_type == TEL_RESOURCE) ||
-			(strncmp(mess, FIN_SES_REC_RAD, strlen(FIN_SES_REC_RAD)) == 0 && wp->Resource_type == RAD_RESOURCE))
+	}
+	else if ((strncmp(mess, INI_SES_REC_TERM, strlen(INI_SES_REC_TERM)) == 0 && Resource_type == TEL_RESOURCE) ||
+		(strncmp(mess, INI_SES_REC_RAD, strlen(INI_SES_REC_RAD)) == 0 && Resource_type == RAD_RESOURCE))
+	{
+		if (res == REC_OK_RESPONSE || res == REC_SESSION_IS_ALREADY_CREATED) SessStatus = RECPORT_SESSION_OPEN;
+		else 
 		{
-			if (res == REC_OK_RESPONSE || res == REC_SESSION_CLOSED)
-			{
-				wp->SessStatus = RECPORT_SESSION_CLOSED;
-			}
-			else 
-			{
-				wp->SessStatus = RECPORT_SESSION_ERROR;
-				PJ_LOG(3,(__FILE__, "ERROR: Record Session cannot be finished"));
-				update_sesion = true;
-			}
+			SessStatus = RECPORT_SESSION_ERROR;
+			PJ_LOG(3,(__FILE__, "ERROR: Record Session cannot be started"));
+			update_sesion = true;
 		}
-		else if ((strncmp(mess, INI_SES_REC_TERM, strlen(INI_SES_REC_TERM)) == 0 && wp->Resource_type == TEL_RESOURCE) ||
-			(strncmp(mess, INI_SES_REC_RAD, strlen(INI_SES_REC_RAD)) == 0 && wp->Resource_type == RAD_RESOURCE))
+	}
+	else if (strncmp(mess, NOTIF_IPADD, strlen(NOTIF_IPADD)) == 0)
+	{
+		if (res == REC_OK_RESPONSE)
 		{
-			if (res == REC_OK_RESPONSE || res == REC_SESSION_IS_ALREADY_CREATED) wp->SessStatus = RECPORT_SESSION_OPEN;
-			else 
-			{
-				wp->SessStatus = RECPORT_SESSION_ERROR;
-				PJ_LOG(3,(__FILE__, "ERROR: Record Session cannot be started"));
-				update_sesion = true;
-			}
+			SessStatus = RECPORT_SESSION_IPSEND;
+		}
+		else
+		{
+			SessStatus = RECPORT_SESSION_ERROR;
+			PJ_LOG(3,(__FILE__, "ERROR: Sending NOTIF_IPADD"));
+		}
+	}
+	else if (strncmp(mess, REMOVE_REC_OBJ, strlen(REMOVE_REC_OBJ)) == 0)
+	{
+		if (res == REC_OK_RESPONSE)
+		{
+			SessStatus = RECPORT_SESSION_IDLE;
 		}
-		else if (strncmp(mess, NOTIF_IPADD, strlen(NOTIF_IPADD)) == 0)
+		else
 		{
-			if (res == REC_OK_RESPONSE)
+			SessStatus = RECPORT_SESSION_ERROR;
+			PJ_LOG(3,(__FILE__, "ERROR: Sending REMOVING RECORD OBJECT"));
+		}
+	}
+	else 
+	{	
+		if (res == REC_SESSION_CLOSED || res == REC_ERROR_INI_SESSION)
+		{
+			update_sesion = true;
+		}
+		else if (strncmp(mess, REC_RECORD, strlen(REC_RECORD)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				wp->SessStatus = RECPORT_SESSION_IPSEND;
+				PJ_LOG(3,(__FILE__, "ERROR: Sending RECORD"));
+				//Ha fallado el comando record. Ponemos la variable a 0 para que cuando se reciba media
+				//en PutFrame vuelva a enviar el RECORD
+				if (Resource_type == TEL_RESOURCE)
+					recording_by_tel = 0;
+				else if (Resource_type == RAD_RESOURCE)
+					recording_by_rad = 0;
 			}
 			else
 			{
-				wp->SessStatus = RECPORT_SESSION_ERROR;
-				PJ_LOG(3,(__FILE__, "ERROR: Sending NOTIF_IPADD"));
+				//Se conectan los puertos de sonido en RX. De llamadas o radios
+				ConnectRx(true);			
 			}
 		}
-		else if (strncmp(mess, REMOVE_REC_OBJ, strlen(REMOVE_REC_OBJ)) == 0)
+		else if (strncmp(mess, REC_PAUSE, strlen(REC_PAUSE)) == 0)
 		{
-			if (res == REC_OK_RESPONSE)
+			if (res != REC_OK_RESPONSE)
 			{
-				wp->SessStatus = RECPORT_SESSION_IDLE;
+				PJ_LOG(3,(__FILE__, "ERROR: Sending PAUSE"));
 			}
 			else
 			{
-				wp->SessStatus = RECPORT_SESSION_ERROR;
-				PJ_LOG(3,(__FILE__, "ERROR: Sending REMOVING RECORD OBJECT"));
+							
 			}
 		}
-		else 
-		{	
-			if (res == REC_SESSION_CLOSED || res == REC_ERROR_INI_SESSION)
-			{
-				update_sesion = true;
-			}
-			else if (strncmp(mess, REC_RECORD, strlen(REC_RECORD)) == 0)
+		else if (strncmp(mess, REC_PTTON, strlen(REC_PTTON)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending RECORD"));
-					//Ha fallado el comando record. Ponemos la variable a 0 para que cuando se reciba media
-					//en PutFrame vuelva a enviar el RECORD
-					if (wp->Resource_type == TEL_RESOURCE)
-						wp->recording_by_tel = 0;
-					else if (wp->Resource_type == RAD_RESOURCE)
-						wp->recording_by_rad = 0;
-				}
-				else
-				{
-					//Se conectan los puertos de sonido en RX. De llamadas o radios
-					wp->ConnectRx(true);			
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending PTT ON"));
 			}
-			else if (strncmp(mess, REC_PAUSE, strlen(REC_PAUSE)) == 0)
+			else
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending PAUSE"));
-				}
-				else
-				{
-								
-				}
+				//Se conectan los puertos de sonido en RX. De llamadas o radios
+				//ConnectRx(true);			
 			}
-			else if (strncmp(mess, REC_PTTON, strlen(REC_PTTON)) == 0)
+		}
+		else if (strncmp(mess, REC_PTTOFF, strlen(REC_PTTOFF)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending PTT ON"));
-				}
-				else
-				{
-					//Se conectan los puertos de sonido en RX. De llamadas o radios
-					//wp->ConnectRx(true);			
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending PTT OFF"));
 			}
-			else if (strncmp(mess, REC_PTTOFF, strlen(REC_PTTOFF)) == 0)
+		}
+		else if (strncmp(mess, SQUELCH_ON, strlen(SQUELCH_ON)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending PTT OFF"));
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending SQUELCH ON"));
 			}
-			else if (strncmp(mess, SQUELCH_ON, strlen(SQUELCH_ON)) == 0)
+			else
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending SQUELCH ON"));
-				}
-				else
-				{
-					//Se conectan los puertos de sonido en RX. De llamadas o radios
-					//wp->ConnectRx(true);
-				}
+				//Se conectan los puertos de sonido en RX. De llamadas o radios
+				//ConnectRx(true);
 			}
-			else if (strncmp(mess, SQUELCH_OFF, strlen(SQUELCH_OFF)) == 0)
+		}
+		else if (strncmp(mess, SQUELCH_OFF, strlen(SQUELCH_OFF)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending SQUELCH OFF"));
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending SQUELCH OFF"));
 			}
-			else if (strncmp(mess, REC_CALLSTART, strlen(REC_CALLSTART)) == 0)
+		}
+		else if (strncmp(mess, REC_CALLSTART, strlen(REC_CALLSTART)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending CallStart"));
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending CallStart"));
 			}
-			else if (strncmp(mess, REC_CALLEND, strlen(REC_CALLEND)) == 0)
+		}
+		else if (strncmp(mess, REC_CALLEND, strlen(REC_CALLEND)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending CallEnd"));
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending CallEnd"));
 			}
-			else if (strncmp(mess, REC_CALLCONNECTED, strlen(REC_CALLCONNECTED)) == 0)
+		}
+		else if (strncmp(mess, REC_CALLCONNECTED, strlen(REC_CALLCONNECTED)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending CallConnected"));
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending CallConnected"));
 			}
-			else if (strncmp(mess, REC_HOLDON, strlen(REC_HOLDON)) == 0)
+		}
+		else if (strncmp(mess, REC_HOLDON, strlen(REC_HOLDON)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending HOLD ON"));
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending HOLD ON"));
 			}
-			else if (strncmp(mess, REC_HOLDOFF, strlen(REC_HOLDOFF)) == 0)
+		}
+		else if (strncmp(mess, REC_HOLDOFF, strlen(REC_HOLDOFF)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending HOLD OFF"));
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending HOLD OFF"));
 			}
-			else if (strncmp(mess, REC_RESET, strlen(REC_RESET)) == 0)
+		}
+		else if (strncmp(mess, REC_RESET, strlen(REC_RESET)) == 0)
+		{
+			if (res != REC_OK_RESPONSE)
 			{
-				if (res != REC_OK_RESPONSE)
-				{
-					PJ_LOG(3,(__FILE__, "ERROR: Sending RECORDER RESET"));
-				}
+				PJ_LOG(3,(__FILE__, "ERROR: Sending RECORDER RESET"));
 			}
 		}
+	}
 
-		if (update_sesion)
-		{
-			//Se fuerza la actualizacin del control de la sesion
-			wp->RecResetSession();			
-		}
-		else
+	if (update_sesion)
+	{
+		//Se fuerza la actualizacin del control de la sesion
+		RecResetSession();			
+	}
+	else
+	{
+		//El servicio de grabacin ha contestado de forma correcta con lo cual
+		//no hace refrescar el timer de cerrar y abrir sesion peridicamente.
+		CancelSessionTimer(); 
+	}
+
+	pj_gettimeofday(&t_last_command);
+}
+
+/**
+ * ResendCommand.	...
+ * Reenvia el comando pendiente de respuesta.
+ * @return	nada.
+ */
+void RecordPort::ResendCommand()
+{
+	PJ_LOG(5,(__FILE__, "RecordPort: Reenviando comando %u sin respuesta. %s", Rec_InFlight.front().nseq, _RecursoTipoTerminal));
+
+	SendCommand(&Rec_InFlight.front());
+
+	pj_mutex_lock(actions_mutex);
+	cmd_stats.retries++;
+	pj_mutex_unlock(actions_mutex);
+}
+
+/**
+ * ArmCommandTimer.	...
+ * Programa send_command_timer para el comando pendiente de respuesta, o lo cancela si no hay ninguno.
+ * El plazo se cuenta desde su ultimo envio.
+ * @return	nada.
+ */
+void RecordPort::ArmCommandTimer()
+{
+	if (Rec_InFlight.empty())
+	{
+		if (timer_nseq != 0)
 		{
-			//El servicio de grabacin ha contestado de forma correcta con lo cual
-			//no hace refrescar el timer de cerrar y abrir sesion peridicamente.
-			wp->CancelSessionTimer(); 
+			send_command_timer.id = 0;
+			pjsua_cancel_timer(&send_command_timer);
+			pj_mutex_lock(mutex);
+			timer_nseq = 0;
+			pj_mutex_unlock(mutex);
 		}
+		return;
+	}
+
+	REC_COMMAND &oldest = Rec_InFlight.front();
+	if (timer_nseq == oldest.nseq && timer_tries == oldest.tries) return;
 
-		pj_gettimeofday(&wp->t_last_command);
+	send_command_timer.id = 0;
+	pjsua_cancel_timer(&send_command_timer);
+
+	pj_time_val delay, now;
+	delay = oldest.t_sent;
+	delay.sec += Wait_response_timeout_sec;
+	pj_gettimeofday(&now);
+	PJ_TIME_VAL_SUB(delay, now);
+	if (delay.sec < 0 || delay.msec < 0)
+	{
+		delay.sec = 0;
+		delay.msec = 0;
 	}
 
-	return 0;
+	pj_mutex_lock(mutex);
+	timer_nseq = oldest.nseq;
+	timer_tries = oldest.tries;
+	pj_mutex_unlock(mutex);
+
+	send_command_timer.id = COM_TIM_ID;
+	send_command_timer.cb = send_command_timer_cb;
+	send_command_timer.user_data = (void *) this;
+	pjsua_schedule_timer(&send_command_timer, &delay);
 }
 
 pj_bool_t RecordPort::OnDataReceived(pj_activesock_t * asock, void * data, pj_size_t size, const pj_sockaddr_t *src_addr, int addr_len, pj_status_t status)
@@ -851,10 +1082,16 @@ pj_bool_t RecordPort::OnDataReceived(pj_activesock_t * asock, void * data, pj_si
 		else
 		{
 			PJ_LOG(5,(__FILE__, "TRAZA: RECORD: OnDataReceived Message Received: %s", mess));
+			REC_RESPONSE res = ParseResp(mess);
 			pj_mutex_lock(wp->mutex);
-			strcpy(wp->message_received, mess);
-			pj_sem_post(wp->sem);
+			//Solo puede haber respuestas de los envios del comando pendiente. Si hay mas se descartan las mas antiguas
+			if (wp->Rec_Responses.size() >= MAX_REC_COMMANDS_IN_FLIGHT * TRIES_SENDING_CMD)
+			{
+				wp->Rec_Responses.pop_front();
+			}
+			wp->Rec_Responses.push_back(res);
 			pj_mutex_unlock(wp->mutex);
+			pj_event_set(wp->actions_event);
 		}
 	}
 
@@ -912,147 +1149,105 @@ int RecordPort::RecResetSession()
 
 /**
  * SendCommand.	...
- * Enva comando al grabador y espera a recibir la respuesta
- * @param mess. Mensaje a enviar.
- * @param len. Longitud del mensaje
- * @param to. Direccin de destino.
- * @param tolen. size de to.
- * @return	REC_RESPONSE.
+ * Enva un comando al grabador. No espera la respuesta.
+ * @param cmd. Comando. Se actualizan el numero de envios y el instante del envio.
+ * @return	pj_status_t.
  */
-REC_RESPONSE RecordPort::SendCommand(char *mess, pj_ssize_t *len, const pj_sockaddr_t *to, int tolen, pj_bool_t espera_respuesta)
+pj_status_t RecordPort::SendCommand(REC_COMMAND *cmd)
 {
 	pj_status_t st = PJ_SUCCESS;
-	int ntries = TRIES_SENDING_CMD;
-	REC_RESPONSE ret = REC_NO_RESPONSE;
-
-	mess[*len] = 0;
+	pj_ssize_t len = cmd->len;
 
 #ifdef DEBUG_GRABACION
-	PJ_LOG(3,(__FILE__, "DEBUG: GRAB137 %s", mess));	
+	PJ_LOG(3,(__FILE__, "DEBUG: GRAB137 %s", cmd->buf));	
 #endif
 
-	PJ_LOG(5,(__FILE__, "RecordPort: Sending message %s", mess));
+	PJ_LOG(5,(__FILE__, "RecordPort: Sending message %u %s", cmd->nseq, cmd->buf));
 
 #ifdef REC_IN_FILE
 	pj_ssize_t mess_len_tx;
-	mess_len_tx = *len;
-	pj_file_write(sim_rec_tx_fd, mess, (pj_ssize_t *) &mess_len_tx);
+	mess_len_tx = cmd->len;
+	pj_file_write(sim_rec_tx_fd, cmd->buf, (pj_ssize_t *) &mess_len_tx);
 	mess_len_tx = 1;
 	pj_file_write(sim_rec_tx_fd, "\n", (pj_ssize_t *) &mess_len_tx);
 #endif
-		
-	do {
-		st = pj_sock_sendto(_Sock, mess, (pj_ssize_t *) len, 0, to, tolen);
-		if (st != PJ_SUCCESS)
-		{
-			char buf[256];
-			pj_strerror(st, buf, sizeof(buf));
-			PJ_LOG(5,(__FILE__, "ERROR: pj_sock_sendto ERROR SOCK %s", buf));
-		}
-		else if (!espera_respuesta)
-		{
-			break;
-		}
-		else
-		{
-			ret = ReadResp();
-			if (ret != REC_NO_RESPONSE && ret != REC_BAD_RESPONSE)
-				break;
-		}
-	} while (--ntries > 0);		
 
-	return ret;
+	cmd->tries++;
+	pj_gettimeofday(&cmd->t_sent);
+
+	st = pj_sock_sendto(_Sock, cmd->buf, &len, 0, &recAddr, sizeof(recAddr));
+	if (st != PJ_SUCCESS)
+	{
+		char buf[256];
+		pj_strerror(st, buf, sizeof(buf));
+		PJ_LOG(5,(__FILE__, "ERROR: pj_sock_sendto ERROR SOCK %s", buf));
+	}
+
+	pj_mutex_lock(actions_mutex);
+	cmd_stats.sent++;
+	pj_mutex_unlock(actions_mutex);
+
+	return st;
 }
 
 /**
- * ReadResp.	...
- * Procesa la respuesta del grabador
+ * ParseResp.	...
+ * Interpreta una respuesta del grabador
+ * @param resp. Respuesta recibida.
  * @return	REC_RESPONSE.
  */
-REC_RESPONSE RecordPort::ReadResp()
+REC_RESPONSE RecordPort::ParseResp(const char *resp)
 {
 	REC_RESPONSE ret = REC_OK_RESPONSE;
-	pj_status_t st = PJ_SUCCESS;
-
-#ifdef DEBUG_GRABACION
-	return ret;
-#endif
-
-	//Esperamos 3000ms (3 seg) a recibir respuesta del Servicio de Grabacion
-	//Configura timer de espera de las respuestas de los mensajes al grabador
-	send_command_timer.id = 0;
-	pjsua_cancel_timer(&send_command_timer);
-	send_command_timer.id = COM_TIM_ID;
-	send_command_timer.cb = send_command_timer_cb;
-	send_command_timer.user_data = (void *) this;
-	pj_time_val	delay;
-	delay.sec = Wait_response_timeout_sec;
-	delay.msec = 0;
-	pjsua_schedule_timer(&send_command_timer, &delay);
 
-	st = pj_sem_wait(sem);
-	send_command_timer.id = 0;
-	pjsua_cancel_timer(&send_command_timer); 
-	
-	if (st != PJ_SUCCESS)
+	if (strcmp(RESPOK, resp) == 0) 
 	{
-		return REC_NO_RESPONSE;
-	}
-
-	pj_mutex_lock(mutex);
-	if (strcmp(REC_NOT_MESSAGE, message_received) == 0) 
-	{
-		PJ_LOG(3,(__FILE__, "ERROR: Record Service does not respond"));
-		ret = REC_NO_RESPONSE;
-	}
-	else if (strcmp(RESPOK, message_received) == 0) 
-	{
-		PJ_LOG(5,(__FILE__, "Message Received from recorder: %s", message_received));
+		PJ_LOG(5,(__FILE__, "Message Received from recorder: %s", resp));
 		ret = REC_OK_RESPONSE;
 	}
-	else if (strcmp(BADDIRIP, message_received) == 0)
+	else if (strcmp(BADDIRIP, resp) == 0)
 	{		
 		ret = REC_IP_INCORRECT;
-		PJ_LOG(3,(__FILE__, "ERROR: IP addres is not set to Record Service. Message Received: %s", message_received));
+		PJ_LOG(3,(__FILE__, "ERROR: IP addres is not set to Record Service. Message Received: %s", resp));
 	}
-	else if (strcmp(NOT_ACTIVE_SESSION, message_received) == 0)
+	else if (strcmp(NOT_ACTIVE_SESSION, resp) == 0)
 	{
 		ret = REC_SESSION_CLOSED;
-		PJ_LOG(3,(__FILE__, "ERROR: There is not active record session. Message Received: %s", message_received));
+		PJ_LOG(3,(__FILE__, "ERROR: There is not active record session. Message Received: %s", resp));
 	}
-	else if (strcmp(OVRFLOW, message_received) == 0)
+	else if (strcmp(OVRFLOW, resp) == 0)
 	{
 		ret = REC_OVERFLOW;
-		PJ_LOG(3,(__FILE__, "ERROR: Media Record: Overflow. Message Received: %s", message_received));
+		PJ_LOG(3,(__FILE__, "ERROR: Media Record: Overflow. Message Received: %s", resp));
 	}	
-	else if (strcmp(SESSION_IS_CREATED, message_received) == 0)
+	else if (strcmp(SESSION_IS_CREATED, resp) == 0)
 	{
 		ret = REC_SESSION_IS_ALREADY_CREATED;
-		PJ_LOG(5,(__FILE__, "ERROR: Session is already created: %s", message_received));
+		PJ_LOG(5,(__FILE__, "ERROR: Session is already created: %s", resp));
 	}
-	else if (strcmp(ERROR_INI_SESSION, message_received) == 0)
+	else if (strcmp(ERROR_INI_SESSION, resp) == 0)
 	{
 		ret = REC_ERROR_INI_SESSION;
-		PJ_LOG(3,(__FILE__, "ERROR: Record Session cannot be started. Message Received: %s", message_received));
+		PJ_LOG(3,(__FILE__, "ERROR: Record Session cannot be started. Message Received: %s", resp));
 	}
-	else if (strcmp(COMMAND_ERROR, message_received) == 0)
+	else if (strcmp(COMMAND_ERROR, resp) == 0)
 	{
 		ret = REC_COMMAND_NO_SUPPORTED;
-		PJ_LOG(3,(__FILE__, "ERROR: Command not supported. Message Received: %s", message_received));
+		PJ_LOG(3,(__FILE__, "ERROR: Command not supported. Message Received: %s", resp));
 	}
 	else
 	{
 		ret = REC_BAD_RESPONSE;
-		PJ_LOG(3,(__FILE__, "ERROR: Unknown. Message Received from Record Service: %s", message_received));
+		PJ_LOG(3,(__FILE__, "ERROR: Unknown. Message Received from Record Service: %s", resp));
 	}
 
-	pj_mutex_unlock(mutex);
 	return ret;
 }
 
 /**
  * Add_Rec_Command_Queue.	...
- * Aade un mensaje a la cola de comandos de grabacin. 
+ * Aade un mensaje a la cola de comandos de grabacin. La cola crece segn haga falta hasta
+ * MAX_REC_COMMANDS_QUEUE_LIMIT comandos.
  * @param	mess		mensaje
  * @param	messlen		longitud
  * @return	0 OK, -1  error.
@@ -1062,31 +1257,75 @@ int RecordPort::Add_Rec_Command_Queue(char *mess, size_t messlen, COMMAND_QUEUE
 	int ret = 0;
 	pj_status_t st = PJ_SUCCESS;
 
+	if (messlen >= MAX_COMMAND_LEN)
+	{
+		PJ_LOG(3,(__FILE__, "ERROR: Record command is too long. %s", _RecursoTipoTerminal));
+		return -1;
+	}
+
 	st = pj_mutex_lock(actions_mutex);
 	PJ_CHECK_STATUS(st, ("ERROR pj_mutex_lock in Add_Red_Command_Queue"));	
 
-	if (Command_queue->RecComHoles > 0)
-	{
-		pj_memcpy(Command_queue->queue[Command_queue->iRecw].buf, mess, messlen);
-		Command_queue->queue[Command_queue->iRecw].len = messlen;
-		if (++Command_queue->iRecw == MAX_REC_COMMANDS_QUEUE)
-			Command_queue->iRecw = 0;
-		Command_queue->RecComHoles--;
-		st = pj_sem_post(actions_sem);
-		PJ_CHECK_STATUS(st, ("ERROR pj_sem_post in Add_Red_Command_Queue"));
+	unsigned queued = (unsigned) (Rec_Command_queue.size() + Rec_RecPau_queue.size());
+	if (queued < MAX_REC_COMMANDS_QUEUE_LIMIT)
+	{
+		REC_COMMAND cmd;
+		pj_memcpy(cmd.buf, mess, messlen);
+		cmd.buf[messlen] = '\0';
+		cmd.len = messlen;
+		if (++cmd_nseq == 0) cmd_nseq = 1;
+		cmd.nseq = cmd_nseq;
+		cmd.tries = 0;
+		cmd.replies = 0;
+		cmd.done = false;
+		pj_bzero(&cmd.t_sent, sizeof(cmd.t_sent));
+		Command_queue->push_back(cmd);
+
+		queued++;
+		cmd_stats.enqueued++;
+		cmd_stats.queued = queued;
+		if (queued > cmd_stats.queued_max)
+		{
+			cmd_stats.queued_max = queued;
+			if ((queued % MAX_REC_COMMANDS_QUEUE) == 0)
+			{
+				PJ_LOG(3,(__FILE__, "WARNING: Record command queue grows to %u commands. %u in flight. %s", 
+					queued, cmd_stats.in_flight, _RecursoTipoTerminal));
+			}
+		}
 	}
 	else
 	{
-		PJ_LOG(3,(__FILE__, "ERROR: Record command queue is full. Recording service is reset"));
+		cmd_stats.dropped++;
+		PJ_LOG(3,(__FILE__, "ERROR: Record command queue is full. Command dropped (%u dropped). %s", cmd_stats.dropped, _RecursoTipoTerminal));
 		ret = -1;
 	}
 
 	st = pj_mutex_unlock(actions_mutex);
 	PJ_CHECK_STATUS(st, ("ERROR pj_mutex_unlock in Add_Red_Command_Queue"));
 
+	if (ret == 0)
+	{
+		st = pj_event_set(actions_event);
+		PJ_CHECK_STATUS(st, ("ERROR pj_event_set in Add_Red_Command_Queue"));
+	}
+
 	return ret;
 }
 
+/**
+ * GetCommandStats.	...
+ * Contadores de la cola de comandos al grabador.
+ * @param	stats		Donde se copian.
+ * @return	nada.
+ */
+void RecordPort::GetCommandStats(REC_COMMAND_STATS *stats)
+{
+	pj_mutex_lock(actions_mutex);
+	*stats = cmd_stats;
+	pj_mutex_unlock(actions_mutex);
+}
+
 /**
  * NofifIp.	...
  * Envia el comando de notificacin IP de la pasarela.
@@ -1645,9 +1884,9 @@ int RecordPort::RecHold(bool on, bool llamante)
 		strcat(mess, _RecursoTipoTerminal);
 		strcat(mess, ",");
 		if (on && llamante) 
-			strncat(mess, "1", 1);
+			strcat(mess, "1");
 		else if (on && !llamante)
-			strncat(mess, "2", 1);
+			strcat(mess, "2");
 
 		ret = Add_Rec_Command_Queue(mess, len_mess, &Rec_Command_queue);
 		if (ret)
@@ -2092,45 +2331,28 @@ pj_status_t RecordPort::PutFrame(pjmedia_port * port, const pjmedia_frame *frame
 		pj_bzero(&pThis->t_last_command, sizeof(pThis->t_last_command));
 	}
 
-	char snsec[16];
-	pj_utoa((unsigned long) pThis->nsec_media, snsec);
-		
-	pThis->mess_media[0] = 0;
-	strcpy(pThis->mess_media, "V,MMM,");
-
-	pj_ssize_t mess_len;
-	mess_len = strlen(pThis->mess_media) + strlen(pThis->_RecursoTipoTerminal) + 1 /* , */ + strlen(snsec) + 1 /* , */ + frame->size/2;
-
-#ifdef REC_IN_FILE
-	pj_ssize_t mess_len_tx = mess_len - frame->size/2;
-#endif
+	pj_uint32_t nsec = pThis->nsec_media++;
 
-	pj_assert(mess_len <= sizeof(pThis->mess_media));
+	//El resto no toca el estado de la sesion. mess_media solo lo usa PutFrame, que se llama siempre
+	//desde el reloj del puente de conferencia, y el socket se cierra despues de quitar el puerto del puente.
+	//Asi el envio no retiene _Lock frente a los threads de comandos.
+	lock.Unlock();
 
-	strcat(pThis->mess_media, pThis->_RecursoTipoTerminal);
-	strcat(pThis->mess_media, ",");
-		
-	strcat(pThis->mess_media, snsec);
-	strcat(pThis->mess_media, ",");
-	pThis->nsec_media++;
+	//Detras de la cabecera fija se escribe el numero de secuencia, la coma y el audio codificado
+	char *seq = &pThis->mess_media[pThis->media_prefix_len];
+	int seq_len = pj_utoa((unsigned long) nsec, seq);
+	seq[seq_len++] = ',';
 
-	char *media_payload = &pThis->mess_media[strlen(pThis->mess_media)];
-	pjmedia_alaw_encode((pj_uint8_t *) media_payload, (const pj_int16_t *) frame->buf, frame->size/2);	
+	char *media_payload = seq + seq_len;
+	pjmedia_alaw_encode((pj_uint8_t *) media_payload, (const pj_int16_t *) frame->buf, frame->size/2);
 
-	/*
-	static pj_uint8_t car = 0;
-	int aux = strlen(pThis->mess_media);
-	for (int i = 0; i < 160; i++)
-	{
-		pThis->mess_media[aux+i] = (char) car;
-	}	
-	car++;
-	*/
+	pj_ssize_t mess_len = (media_payload - pThis->mess_media) + frame->size/2;
+	pj_assert(mess_len <= sizeof(pThis->mess_media));
 
 #ifdef REC_IN_FILE
+	pj_ssize_t mess_len_tx = media_payload - pThis->mess_media;
 	pj_ssize_t ss = frame->size / 2;
 	ret = pj_file_write(pThis->sim_rec_fd, media_payload, (pj_ssize_t *) &ss);
-	//ret = pj_file_write(pThis->sim_rec_fd, frame->buf, (pj_ssize_t *) &frame->size);
 	ret = pj_file_write(pThis->sim_rec_tx_fd, pThis->mess_media, (pj_ssize_t *) &mess_len_tx);
 	mess_len_tx = 1;
 	ret = pj_file_write(pThis->sim_rec_tx_fd, "\n", (pj_ssize_t *) &mess_len_tx);
@@ -2143,9 +2365,6 @@ pj_status_t RecordPort::PutFrame(pjmedia_port * port, const pjmedia_frame *frame
 		pj_strerror(ret, buf, sizeof(buf));
 		PJ_LOG(3,(__FILE__, "ERROR: pj_sock_sendto PutFrame ERROR SOCK %s, %s", buf, pThis->_RecursoTipoTerminal));
 	}
-	else
-	{
-	}
 
 	//pThis->mess_media[30] = 0;
 	//PJ_LOG(5,(__FILE__, "TRAZA: %s", pThis->mess_media));
@@ -2387,13 +2606,15 @@ void RecordPort::send_command_timer_cb(pj_timer_heap_t *th, pj_timer_entry *te)
 	wp->send_command_timer.id = 0;
 	pjsua_cancel_timer(&wp->send_command_timer);
 
+	//El timer ha vencido sin que se haya recibido respuesta al comando pendiente. Lo atiende RecordActionsTh
 	st = pj_mutex_lock(wp->mutex);
 	PJ_CHECK_STATUS(st, ("ERROR pj_mutex_lock en send_command_timer_cb"));
-	strcpy(wp->message_received, REC_NOT_MESSAGE);   //El timer a vencido sin que se haya recibido ningn mensaje del grabador
-	st = pj_sem_post(wp->sem);
-	PJ_CHECK_STATUS(st, ("ERROR pj_sem_post en send_command_timer_cb"));
+	wp->expired_nseq = wp->timer_nseq;
+	wp->timer_nseq = 0;
 	st = pj_mutex_unlock(wp->mutex);
 	PJ_CHECK_STATUS(st, ("ERROR pj_mutex_unlock en send_command_timer_cb"));
+	st = pj_event_set(wp->actions_event);
+	PJ_CHECK_STATUS(st, ("ERROR pj_event_set en send_command_timer_cb"));
 }
 
 /**
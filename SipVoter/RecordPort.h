@@ -11,6 +11,8 @@
 #ifndef __CORESIP_RECORDPORT_H__
 #define __CORESIP_RECORDPORT_H__
 
+#include <deque>
+
 /*Para depurar la grabacin sin necesidad del servicio de grabacin. Se escriben en el LOG los mensajes que se enviarian al 
 servicio de grabacion. No se espera la respuesta*/
 #undef DEBUG_GRABACION
@@ -59,7 +61,11 @@ public:
 	static const int OUTCOM = 1;
 
 	//
-	static const int MAX_REC_COMMANDS_QUEUE = 32;
+	static const int MAX_REC_COMMANDS_QUEUE = 32;			//Cada vez que la cola alcanza un nuevo multiplo de este valor se avisa en el log
+	static const int MAX_REC_COMMANDS_QUEUE_LIMIT = 1024;	//A partir de aqui se descartan los comandos
+	static const int MAX_REC_COMMANDS_IN_FLIGHT = 1;		//Comandos enviados a la vez pendientes de respuesta. Las respuestas del grabador
+															//no llevan identificador: con mas de uno, una respuesta perdida o tardia se
+															//atribuiria a los comandos siguientes
 	static const int MAX_COMMAND_LEN = 512;
 
 	static const long NO_SESSION_TIMER = 15;	//15 sec. Tiempo de reinio de sesion si hay error en la comunicacion con el grabador
@@ -68,6 +74,22 @@ public:
 
 	char _RecursoTipoTerminal[256];
 
+	//Contadores de la cola de comandos al grabador
+	typedef struct {
+		unsigned queued;				//Comandos en cola pendientes de enviar
+		unsigned queued_max;			//Maximo de comandos en cola alcanzado
+		unsigned in_flight;				//Comandos enviados pendientes de respuesta
+		unsigned in_flight_max;			//Maximo de comandos pendientes de respuesta alcanzado
+		pj_uint32_t enqueued;			//Comandos encolados
+		pj_uint32_t sent;				//Envios, incluidas las retransmisiones
+		pj_uint32_t retries;			//Retransmisiones por falta de respuesta o respuesta erronea
+		pj_uint32_t timeouts;			//Comandos sin respuesta tras TRIES_SENDING_CMD envios
+		pj_uint32_t dropped;			//Comandos descartados por estar la cola llena
+		pj_uint32_t skipped;			//Comandos que no ha sido necesario enviar (RECORD o PAUSE redundantes...)
+		pj_uint32_t late;				//Respuestas ignoradas por ser de un envio anterior de un comando ya atendido
+		pj_uint32_t unmatched;			//Respuestas ignoradas por no haber ningun comando pendiente
+	} REC_COMMAND_STATS;
+
 	//Contiene los Slots de telefona o radio que estn conectados a travs de la conferencia pjsua
 	//a los SndPorts (Puertos de sonido altavoces, cascos).
 	//Sern los que se conecten al RecordPort para la grabacin VoIP. 
@@ -95,6 +117,7 @@ public:
 	void Del_SlotsToSndPorts(pjsua_conf_port_id slot);
 	bool IsSlotConnectedToRecord(pjsua_conf_port_id slot);
 	void SetTheOtherRec(RecordPort *TheOtherRec_);
+	void GetCommandStats(REC_COMMAND_STATS *stats);
 	
 	
 private:
@@ -142,7 +165,6 @@ private:
 	static const char *REC_RECORD;
 	static const char *REC_PAUSE;
 	static const char *REC_RESET;
-	static const char *REC_NOT_MESSAGE;
 
 	//Respuestas del grabador
 	static const char *RESPOK;
@@ -165,25 +187,28 @@ private:
 	char RecTerminalIpAdd[32];
 	pj_sockaddr_in recAddr;			//Direccin y puerto del grabador
 		
-	char mess_media[1024];
+	char mess_media[1024];			//Mensaje de media. Empieza siempre por la cabecera fija "V,MMM,<terminal>,"
+	pj_ssize_t media_prefix_len;	//Longitud de la cabecera fija de mess_media
 	pj_uint32_t nsec_media;	
 
-	pj_sem_t *sem;
-	pj_mutex_t *mutex;
+	pj_mutex_t *mutex;							//Protege Rec_Responses, timer_nseq y expired_nseq
 	static const int MAX_MSG_LEN = 7;
-	char message_received[MAX_MSG_LEN+1];
+	std::deque<REC_RESPONSE> Rec_Responses;		//Respuestas recibidas pendientes de procesar por RecordActionsTh
 
 	long Wait_response_timeout_sec;				//Tiempo mximo de espera a las respuestas del servicio de grabacion (seg)
 	pj_thread_t  *actions_thread;
 	static pj_thread_proc RecordActionsTh;
-	pj_sem_t *actions_sem;
-	pj_mutex_t *actions_mutex;
+	pj_event_t *actions_event;					//Despierta a RecordActionsTh: comando nuevo, respuesta o timeout
+	pj_mutex_t *actions_mutex;					//Protege las colas de comandos, flush_in_flight y cmd_stats
 	PJ_ATOMIC_VALUE_TYPE actions_thread_run;
 
 	pj_time_val t_last_command;		//Tiempo en el que se envi el ultimo comando
 
-	pj_timer_entry send_command_timer;
+	pj_timer_entry send_command_timer;			//Timeout del comando de Rec_InFlight
 	int COM_TIM_ID;
+	pj_uint32_t timer_nseq;						//Comando para el que esta programado send_command_timer. 0 ninguno
+	int timer_tries;							//Envios del comando cuando se programo send_command_timer
+	pj_uint32_t expired_nseq;					//Comando cuyo timeout ha vencido, pendiente de procesar. 0 ninguno
 
 	pj_thread_t  *session_thread;
 	static pj_thread_proc SessionControlTh;
@@ -195,17 +220,23 @@ private:
 	static int timer_id;
 		
 	typedef struct {
-		struct {
-			char buf[MAX_COMMAND_LEN];
-			pj_ssize_t len;
-		} queue[MAX_REC_COMMANDS_QUEUE];
-		unsigned int iRecw;
-		unsigned int iRecr;
-		unsigned int RecComHoles;
-	} COMMAND_QUEUE;	
+		char buf[MAX_COMMAND_LEN];
+		pj_ssize_t len;
+		pj_uint32_t nseq;				//Numero de secuencia local. El grabador no lo recibe
+		int tries;						//Envios realizados
+		int replies;					//Respuestas recibidas
+		bool done;						//Ya procesada su respuesta. Sigue en Rec_InFlight hasta recibir la de cada envio o vencer el timeout
+		pj_time_val t_sent;				//Instante del ultimo envio
+	} REC_COMMAND;
+
+	typedef std::deque<REC_COMMAND> COMMAND_QUEUE;
 	
 	COMMAND_QUEUE Rec_Command_queue;	//Cola de mensajes de acciones sobre el grabador, excepto RECORD y PAUSE
 	COMMAND_QUEUE Rec_RecPau_queue;		//Cola de mensajes RECORD y PAUSE. tienen prioridad sobre Rec_Command_queue
+	COMMAND_QUEUE Rec_InFlight;			//Comando enviado pendiente de respuesta. Solo lo usa RecordActionsTh
+	pj_bool_t flush_in_flight;			//RecordActionsTh debe olvidar los comandos pendientes de respuesta
+	pj_uint32_t cmd_nseq;				//Ultimo numero de secuencia asignado
+	REC_COMMAND_STATS cmd_stats;
 
 #ifdef REC_IN_FILE
 	pj_oshandle_t sim_rec_fd;
@@ -216,9 +247,15 @@ private:
 	void Dispose();
 	static pj_status_t PutFrame(pjmedia_port * port, const pjmedia_frame *frame);
 	static pj_status_t Reset(pjmedia_port * port);
-	REC_RESPONSE ReadResp();
-	REC_RESPONSE SendCommand(char *mess, pj_ssize_t *len, const pj_sockaddr_t *to, int tolen, pj_bool_t espera_respuesta);
+	static REC_RESPONSE ParseResp(const char *resp);
+	pj_status_t SendCommand(REC_COMMAND *cmd);
 	int Add_Rec_Command_Queue(char *mess, size_t messlen, COMMAND_QUEUE *Command_queue);
+	void ProcessActions();
+	bool GetNextCommand(REC_COMMAND *cmd);
+	bool FilterCommand(const REC_COMMAND *cmd);
+	void CommandDone(const REC_COMMAND *cmd, REC_RESPONSE res);
+	void ResendCommand();
+	void ArmCommandTimer();
 	int NotifIp(bool wait_end);
 	int ConnectRx(bool on);
 	static void send_command_timer_cb(pj_timer_heap_t *th, pj_timer_entry *te);
@@ -0,0 +1,243 @@
+/**
+ * @file RemoteAudio.cpp
+ * @brief Formato de las tramas de audio que los puestos distribuyen por multicast en CORESIP.dll
+ *
+ *	Implementa las clases 'RemoteAudio' y 'RemoteAudioTx'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include "Global.h"
+#include "SoundRxPort.h"
+#include "RemoteAudio.h"
+#include <pjmedia/alaw_ulaw.h>
+
+#define THIS_FILE			"RemoteAudio.cpp"
+
+RemoteAudio::Slot RemoteAudio::_Slots[RemoteAudio::SLOTS];
+
+/**
+ * SrcId.	...
+ * Identificador numerico de un emisor: FNV-1a de 32 bits de su nombre. El 0 se reserva para las posiciones libres.
+ * @param	name	Nombre del emisor.
+ * @return	Identificador.
+ */
+pj_uint32_t RemoteAudio::SrcId(const char * name)
+{
+	pj_uint32_t h = 2166136261u;
+	for (const unsigned char * p = (const unsigned char *) name; *p; p++)
+	{
+		h ^= *p;
+		h *= 16777619u;
+	}
+	return h != 0 ? h : 1;
+}
+
+/**
+ * Decode.	...
+ * Comprueba y decodifica una trama recibida en cualquiera de los dos formatos.
+ * @param	data	Trama.
+ * @param	size	Tamano de la trama.
+ * @param	fr		Trama decodificada.
+ * @return	PJ_TRUE si es una trama valida.
+ */
+pj_bool_t RemoteAudio::Decode(const void * data, pj_size_t size, RemoteAudioFrame * fr)
+{
+	if (size == sizeof(RemotePayload))
+	{
+		const RemotePayload * pl = (const RemotePayload *) data;
+		if ((unsigned) pl->SrcType >= CORESIP_SND_MAX_IN_DEVICES || pl->Size != sizeof(pl->Data) ||
+			memchr(pl->SrcId, 0, sizeof(pl->SrcId)) == NULL)
+		{
+			return PJ_FALSE;
+		}
+
+		fr->SrcId = SrcId(pl->SrcId);
+		fr->Name = pl->SrcId;
+		fr->SrcType = pl->SrcType;
+		fr->Seq = 0;
+		fr->Ts = 0;
+		pj_memcpy(fr->Samples, pl->Data, sizeof(fr->Samples));
+		return PJ_TRUE;
+	}
+
+	const RemoteCompactHdr * hdr = (const RemoteCompactHdr *) data;
+	if (size < sizeof(RemoteCompactHdr) || hdr->Magic != REMOTE_COMPACT_MAGIC || hdr->Version != REMOTE_COMPACT_VERSION ||
+		hdr->SrcType >= CORESIP_SND_MAX_IN_DEVICES)
+	{
+		return PJ_FALSE;
+	}
+
+	const pj_uint8_t * payload = (const pj_uint8_t *) (hdr + 1);
+	switch (hdr->Pt)
+	{
+	case REMOTE_AUDIO_L16:
+		if (size != sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME * 2) return PJ_FALSE;
+		for (unsigned i = 0; i < SAMPLES_PER_FRAME; i++)
+		{
+			fr->Samples[i] = (pj_int16_t) ((payload[2 * i] << 8) | payload[2 * i + 1]);
+		}
+		break;
+	case REMOTE_AUDIO_PCMA:
+		if (size != sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME) return PJ_FALSE;
+		pjmedia_alaw_decode(fr->Samples, payload, SAMPLES_PER_FRAME);
+		break;
+	default:
+		return PJ_FALSE;
+	}
+
+	fr->SrcId = pj_ntohl(hdr->SrcId);
+	fr->Name = NULL;
+	fr->SrcType = (CORESIP_SndDevType) hdr->SrcType;
+	fr->Seq = pj_ntohl(hdr->Seq);
+	fr->Ts = pj_ntohl(hdr->Ts);
+	return PJ_TRUE;
+}
+
+/**
+ * Rebuild.	...
+ * Rehace la tabla de identificadores con los puertos de recepcion existentes.
+ * @param	ports	SipAgent::_SndRxPorts.
+ * @param	count	Tamano de ports.
+ */
+void RemoteAudio::Rebuild(SoundRxPort ** ports, unsigned count)
+{
+	pj_assert(count * 2 <= SLOTS);
+	pj_bzero(_Slots, sizeof(_Slots));
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		if (ports[i] == NULL) continue;
+
+		pj_uint32_t id = SrcId(ports[i]->Id);
+		unsigned pos = id & (SLOTS - 1);
+		while (_Slots[pos].SrcId != 0 && _Slots[pos].SrcId != id)
+		{
+			pos = (pos + 1) & (SLOTS - 1);
+		}
+
+		if (_Slots[pos].SrcId == id)
+		{
+			PJ_LOG(3,(THIS_FILE, "ERROR: %s y %s tienen el mismo identificador de audio remoto %08x", _Slots[pos].Port->Id, ports[i]->Id, id));
+			continue;
+		}
+		_Slots[pos].SrcId = id;
+		_Slots[pos].Port = ports[i];
+	}
+}
+
+/**
+ * Find.	...
+ * @param	srcId	Identificador del emisor.
+ * @return	Puerto de recepcion del emisor, o NULL si no hay.
+ */
+SoundRxPort * RemoteAudio::Find(pj_uint32_t srcId)
+{
+	unsigned pos = srcId & (SLOTS - 1);
+	while (_Slots[pos].SrcId != 0)
+	{
+		if (_Slots[pos].SrcId == srcId) return _Slots[pos].Port;
+		pos = (pos + 1) & (SLOTS - 1);
+	}
+	return NULL;
+}
+
+/**
+ * RemoteAudioTx.	...
+ * Constructor.
+ */
+RemoteAudioTx::RemoteAudioTx()
+{
+	_Format = REMOTE_AUDIO_LEGACY;
+	_Seq = 0;
+	_Ts = 0;
+	_Sent = PJ_FALSE;
+}
+
+/**
+ * Init.	...
+ * Prepara las tramas de un emisor.
+ * @param	id		Nombre del emisor.
+ * @param	type	Tipo de dispositivo que se indica a los receptores.
+ * @param	format	REMOTE_AUDIO_LEGACY, REMOTE_AUDIO_L16 o REMOTE_AUDIO_PCMA.
+ */
+void RemoteAudioTx::Init(const char * id, CORESIP_SndDevType type, unsigned format)
+{
+	_Format = format;
+	if (_Sent)
+	{
+		pj_timestamp now;
+		pj_get_timestamp(&now);
+		pj_uint32_t gap = (pj_uint32_t) (pj_elapsed_msec64(&_LastSend, &now) * (SAMPLING_RATE / 1000));
+		if (gap > SAMPLES_PER_FRAME) _Ts += gap - SAMPLES_PER_FRAME;
+	}
+
+	pj_bzero(&_Legacy, sizeof(_Legacy));
+	pj_ansi_strncpy(_Legacy.SrcId, id, sizeof(_Legacy.SrcId) - 1);
+	_Legacy.SrcType = type;
+	_Legacy.Size = sizeof(_Legacy.Data);
+
+	RemoteCompactHdr * hdr = (RemoteCompactHdr *) _Compact;
+	hdr->Magic = REMOTE_COMPACT_MAGIC;
+	hdr->Version = REMOTE_COMPACT_VERSION;
+	hdr->Pt = (pj_uint8_t) _Format;
+	hdr->SrcType = (pj_uint8_t) type;
+	hdr->SrcId = pj_htonl(RemoteAudio::SrcId(_Legacy.SrcId));
+}
+
+/**
+ * Send.	...
+ * Envia una trama.
+ * @param	sock	Socket de envio.
+ * @param	to		Destino.
+ * @param	pcm		SAMPLES_PER_FRAME muestras PCM de 16 bits.
+ */
+void RemoteAudioTx::Send(pj_sock_t sock, const pj_sockaddr_in * to, const void * pcm)
+{
+	pj_ssize_t size;
+
+	switch (_Format)
+	{
+	case REMOTE_AUDIO_L16:
+		{
+			RemoteCompactHdr * hdr = (RemoteCompactHdr *) _Compact;
+			pj_uint8_t * payload = (pj_uint8_t *) (hdr + 1);
+			const pj_int16_t * samples = (const pj_int16_t *) pcm;
+
+			hdr->Seq = pj_htonl(_Seq);
+			hdr->Ts = pj_htonl(_Ts);
+			for (unsigned i = 0; i < SAMPLES_PER_FRAME; i++)
+			{
+				payload[2 * i] = (pj_uint8_t) ((pj_uint16_t) samples[i] >> 8);
+				payload[2 * i + 1] = (pj_uint8_t) samples[i];
+			}
+			size = sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME * 2;
+			pj_sock_sendto(sock, _Compact, &size, 0, to, sizeof(*to));
+		}
+		break;
+	case REMOTE_AUDIO_PCMA:
+		{
+			RemoteCompactHdr * hdr = (RemoteCompactHdr *) _Compact;
+
+			hdr->Seq = pj_htonl(_Seq);
+			hdr->Ts = pj_htonl(_Ts);
+			pjmedia_alaw_encode((pj_uint8_t *) (hdr + 1), (const pj_int16_t *) pcm, SAMPLES_PER_FRAME);
+			size = sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME;
+			pj_sock_sendto(sock, _Compact, &size, 0, to, sizeof(*to));
+		}
+		break;
+	default:
+		pj_memcpy(_Legacy.Data, pcm, sizeof(_Legacy.Data));
+		size = sizeof(_Legacy);
+		pj_sock_sendto(sock, &_Legacy, &size, 0, to, sizeof(*to));
+		break;
+	}
+
+	_Seq++;
+	_Ts += SAMPLES_PER_FRAME;
+	_Sent = PJ_TRUE;
+	pj_get_timestamp(&_LastSend);
+}
+
+/*@}*/
@@ -0,0 +1,123 @@
+/**
+ * @file RemoteAudio.h
+ * @brief Formato de las tramas de audio que los puestos distribuyen por multicast en CORESIP.dll
+ *
+ *	Implementa las clases 'RemoteAudio' y 'RemoteAudioTx'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+#ifndef __CORESIP_REMOTEAUDIO_H__
+#define __CORESIP_REMOTEAUDIO_H__
+
+class SoundRxPort;
+
+/**
+ * RemotePayload: Formato original. Se identifica por su tamano y se sigue aceptando en recepcion.
+ * Se envia con RemoteAudioFormat=0 en coresip.ini, para los receptores que solo entienden este formato.
+ */
+struct RemotePayload
+{
+	char SrcId[CORESIP_MAX_USER_ID_LENGTH + 1];
+	CORESIP_SndDevType SrcType;
+	unsigned Size;
+	char Data[SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8)];
+};
+
+/**
+ * Formato de envio (clave RemoteAudioFormat de coresip.ini). En el formato compacto es tambien el campo Pt.
+ */
+#define REMOTE_AUDIO_LEGACY			0			//RemotePayload
+#define REMOTE_AUDIO_L16			1			//Compacto, PCM 16 bits en orden de red
+#define REMOTE_AUDIO_PCMA			2			//Compacto, G.711 ley A
+
+#define REMOTE_COMPACT_MAGIC		0xA5
+#define REMOTE_COMPACT_VERSION		1
+
+/**
+ * RemoteCompactHdr: Cabecera del formato compacto, con los campos en orden de red. Le siguen las muestras de
+ * una trama (SAMPLES_PER_FRAME) en el formato indicado por Pt.
+ */
+struct RemoteCompactHdr
+{
+	pj_uint8_t Magic;				//REMOTE_COMPACT_MAGIC
+	pj_uint8_t Version;				//REMOTE_COMPACT_VERSION
+	pj_uint8_t Pt;					//REMOTE_AUDIO_L16 o REMOTE_AUDIO_PCMA
+	pj_uint8_t SrcType;				//CORESIP_SndDevType
+	pj_uint32_t SrcId;				//RemoteAudio::SrcId() del nombre del emisor
+	pj_uint32_t Seq;				//Se incrementa en cada trama
+	pj_uint32_t Ts;					//En muestras, avanza tambien durante las pausas entre envios
+};
+
+/**
+ * RemoteAudioFrame: Trama recibida en cualquiera de los dos formatos, ya en PCM 16 bits.
+ */
+struct RemoteAudioFrame
+{
+	pj_uint32_t SrcId;
+	const char * Name;				//Nombre del emisor en el formato original, NULL en el compacto
+	CORESIP_SndDevType SrcType;
+	pj_uint32_t Seq;
+	pj_uint32_t Ts;
+	pj_int16_t Samples[SAMPLES_PER_FRAME];
+};
+
+/**
+ * RemoteAudio.
+ * El identificador numerico de un emisor es un hash de 32 bits de su nombre (el id que se pasa a
+ * CORESIP_SendToRemote y a CORESIP_CreateSndRxPort). Emisor y receptor lo calculan cada uno por su lado al
+ * configurarse, de forma que no hace falta un canal de vuelta en el multicast y en cada trama solo viajan 4 bytes.
+ * El receptor guarda sus puertos SoundRxPort en una tabla indexada por ese identificador, que se reconstruye
+ * al crear o destruir un puerto. Tanto Rebuild() como Find() se llaman con SipAgent::_Lock tomado.
+ */
+class RemoteAudio
+{
+public:
+	static pj_uint32_t SrcId(const char * name);
+	static pj_bool_t Decode(const void * data, pj_size_t size, RemoteAudioFrame * fr);
+
+	static void Rebuild(SoundRxPort ** ports, unsigned count);
+	static SoundRxPort * Find(pj_uint32_t srcId);
+
+	/** Tamano maximo de las tramas, para el buffer de recepcion */
+	static const unsigned MAX_FRAME = sizeof(RemotePayload) > sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME * 2 ?
+		sizeof(RemotePayload) : sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME * 2;
+
+private:
+	static const unsigned SLOTS = 128;			//Potencia de 2, al menos el doble de CORESIP_MAX_SOUND_RX_PORTS
+
+	struct Slot
+	{
+		pj_uint32_t SrcId;						//0 si esta libre
+		SoundRxPort * Port;
+	};
+
+	static Slot _Slots[SLOTS];
+};
+
+/**
+ * RemoteAudioTx.
+ * Trama que se envia en cada tick desde un puerto remotado (SoundPort o WavPlayerToRemote), en el formato de la
+ * clave RemoteAudioFormat de coresip.ini. La secuencia sigue entre un Init() y el siguiente (cada PTT), y el
+ * timestamp avanza lo que ha durado la pausa, para que el receptor no lo tome como perdidas ni como jitter.
+ */
+class RemoteAudioTx
+{
+public:
+	RemoteAudioTx();
+	void Init(const char * id, CORESIP_SndDevType type, unsigned format);
+	void Send(pj_sock_t sock, const pj_sockaddr_in * to, const void * pcm);
+
+private:
+	unsigned _Format;
+	pj_uint32_t _Seq;
+	pj_uint32_t _Ts;
+	pj_bool_t _Sent;
+	pj_timestamp _LastSend;
+	RemotePayload _Legacy;
+	pj_uint32_t _Compact[(sizeof(RemoteCompactHdr) + SAMPLES_PER_FRAME * 2) / 4];
+};
+
+#endif
+
+/*@}*/
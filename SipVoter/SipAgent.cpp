@@ -14,14 +14,20 @@
 #include "Exceptions.h"
 #include "SipCall.h"
 #include "Guard.h"
+#include "AsyncLog.h"
+#include "OptionsFast.h"
+#include "RemoteAudio.h"
 #ifdef PJ_USE_ASIO
 #include <pa_asio.h>
 #endif
 #include "wg67subscription.h"
 #include "PresenceManag.h"
 #include "ExtraParamAccId.h"
+#include <vector>
 
+#ifdef _WIN32
 #include <iphlpapi.h>
+#endif
 
 
 /**
@@ -101,6 +107,12 @@ SoundPort * SipAgent::_SndPorts[CORESIP_MAX_SOUND_DEVICES];
  *	SipAgent::_WavPlayers: Lista de Punteros a los Reproductores Wav.
  */
 WavPlayer * SipAgent::_WavPlayers[CORESIP_MAX_WAV_PLAYERS];
+/**
+ *	SipAgent::_WavPlayerEofTimers: Timers con los que se atiende el fin de fichero de cada Reproductor Wav.
+ *	SipAgent::_WavPlayerGen: Generacion del Reproductor de cada posicion, para descartar fines de fichero atrasados.
+ */
+pj_timer_entry SipAgent::_WavPlayerEofTimers[CORESIP_MAX_WAV_PLAYERS];
+unsigned SipAgent::_WavPlayerGen[CORESIP_MAX_WAV_PLAYERS];
 /**
  *	SipAgent::_WavRecorders: Lista de Punteros a los Grabadores Wav.
  */
@@ -123,6 +135,8 @@ RecordPort * SipAgent::_RecordPortRad = NULL;
  *	SipAgent::FrecDesp: Gestor de grupos de climax.
  */
 FrecDesp *	SipAgent::_FrecDesp = NULL;
+McastScheduler *	SipAgent::_McastScheduler = NULL;
+McastReceiver *	SipAgent::_McastReceiver = NULL;
 
 /**
  *	SipAgent::_PresenceManager: Gestor de presencias
@@ -145,10 +159,6 @@ pjmedia_echo_state *SipAgent::_EchoCancellerLCMic = NULL;
 pj_bool_t SipAgent::_AltavozLCActivado = PJ_FALSE;			//Si true, el altavoz LC esta activado reproduciendo audio
 pj_lock_t *SipAgent::_ECLCMic_mutex = NULL;					//Mutex para el cancelador de eco
 
-/**
- *	SipAgent::_SndRxIds: Mapa de acceso por nombre (string) a los punteros a los dispositos de sonido.
- */
-std::map<std::string, SoundRxPort*> SipAgent::_SndRxIds;
 /**
  *	SipAgent::_Sock: pj_sock. Socket asociado al agente.
  */
@@ -157,6 +167,10 @@ pj_sock_t SipAgent::_Sock = PJ_INVALID_SOCKET;
  *	SipAgent::_RemoteSock: Puntero a 'pj_activesock_t ...
  */
 pj_activesock_t * SipAgent::_RemoteSock = NULL;
+/**
+ *	SipAgent::_SndRxStatsTimer: Timer de las estadisticas periodicas del audio remoto (_SndRxStatsCb).
+ */
+pj_timer_entry SipAgent::_SndRxStatsTimer;
 /**
  *	SipAgent::_NumInChannels: ...
  */
@@ -200,6 +214,8 @@ unsigned int SipAgent::uaPort = 0;
 pjsua_transport_id SipAgent::SipTransportId = PJSUA_INVALID_ID;
 
 unsigned SipAgent::_TimeToDiscardRdInfo = 0;	//Tiempo durante el cual no se envia RdInfo al Nodebox tras un PTT OFF
+pj_bool_t SipAgent::_RtpRxBatch = PJ_FALSE;		//Si vale true, los transportes RTP leen varios paquetes por llamada al sistema
+void (*SipAgent::_SndRxStatsCb)(int sndRxPort, const char * id, const CORESIP_SndRxStats * stats) = NULL;	//Estadisticas periodicas del audio remoto
 
 pj_bool_t SipAgent::_HaveRdAcc = PJ_FALSE;		//Si vale true, entonces algun account del agente es de lipo radio GRS
 
@@ -234,6 +250,7 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 	for (unsigned i = 0; i < PJ_ARRAY_SIZE(_WavPlayers); i++)
 	{
 		_WavPlayers[i] = NULL;
+		pj_timer_entry_init(&_WavPlayerEofTimers[i], 0, (void*)(size_t)i, &WavPlayerEofTimerCb);
 	}
 
 	for (unsigned i = 0; i < PJ_ARRAY_SIZE(_RdRxPorts); i++)
@@ -252,6 +269,8 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 	}
 
 	_TimeToDiscardRdInfo = cfg->TimeToDiscardRdInfo;
+	_RtpRxBatch = (cfg->RtpRxBatch != 0) ? PJ_TRUE : PJ_FALSE;
+	_SndRxStatsCb = cfg->SndRxStatsCb;
 	_Radio_UA = cfg->Radio_UA;
 
 	/**
@@ -333,7 +352,8 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 		 * Configuracion del Bloque de Configuracion de 'pjsua'.
 		 * http://www.pjsip.org/docs/latest-1/pjsip/docs/html/structpjsua__config.htm
 		 */		
-		if (cfg->max_calls > PJSUA_MAX_CALLS) uaCfg.max_calls = 30;		
+		//Los slots de llamada libres no consumen sockets: los transportes RTP se crean al usarse (PJSUA_LAZY_MEDIA_TRANSPORT)
+		if (cfg->max_calls > PJSUA_MAX_CALLS) uaCfg.max_calls = PJSUA_MAX_CALLS;
 		else uaCfg.max_calls = cfg->max_calls;
 
 		uaCfg.user_agent = pj_str("U5K-UA/1.0.0");		
@@ -374,6 +394,13 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 			logCfg.log_filename = pj_str(const_cast<char*>("./logs/coresip.txt"));
 		}
 
+		if (Coresip_Local_Config._Log_Async)
+		{
+			AsyncLog::Init(Coresip_Local_Config._Log_Ring_KB, Coresip_Local_Config._Log_Repeat_Max);
+			st = AsyncLog::Configure(&logCfg);
+			PJ_CHECK_STATUS(st, ("ERROR abriendo el fichero de log"));
+		}
+
 		/**
 		 * Configuracion del Bloque MEDIA de 'pjsua'.
 		 * http://www.pjsip.org/docs/latest-1/pjsip/docs/html/structpjsua__media__config.htm#a2c95e5ce554bbee9cc60d0328f508658
@@ -382,6 +409,11 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 		mediaCfg.audio_frame_ptime = PTIME;
 		mediaCfg.channel_count = CHANNEL_COUNT;
 		mediaCfg.max_media_ports = uaCfg.max_calls + 10;
+		//Cada thread de recepcion de RTP con su propio ioqueue (epoll en Linux). Los sockets de cada llamada
+		//siempre los atiende el mismo thread, y se reparten entre ellos al crearse
+		mediaCfg.thread_cnt = Coresip_Local_Config._Media_Workers;
+		mediaCfg.thread_ioqueue = PJ_TRUE;
+		mediaCfg.thread_first_cpu = Coresip_Local_Config._Media_Workers_First_Cpu;
 		mediaCfg.no_vad = PJ_TRUE;
 		mediaCfg.snd_auto_close_time = -1;
 
@@ -420,7 +452,7 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 
 		if (cfg->DefaultCodec[0])
 		{
-			pjsua_codec_set_priority(&(pj_str(const_cast<char*>(cfg->DefaultCodec))), PJMEDIA_CODEC_PRIO_HIGHEST);
+			pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>(cfg->DefaultCodec))), PJMEDIA_CODEC_PRIO_HIGHEST);
 		}
 
 		/**
@@ -452,7 +484,7 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 		{
 			//Se fuerza que los paquetes salgan por el interfaz que utiliza el agente.
 			struct pj_in_addr in_uaIpAdd;
-			pj_inet_aton((const pj_str_t *) &pj_str(const_cast<char*>(cfg->IpAddress)), &in_uaIpAdd);
+			pj_inet_aton((const pj_str_t *) StrPtr(pj_str(const_cast<char*>(cfg->IpAddress))), &in_uaIpAdd);
 			st = pj_sock_setsockopt(sip_socket, pj_SOL_IP(), PJ_IP_MULTICAST_IF, (void *)&in_uaIpAdd, sizeof(in_uaIpAdd));	
 			if (st != PJ_SUCCESS)
 				PJ_LOG(3,(__FILE__, "ERROR: setsockopt, PJ_IP_MULTICAST_IF. El transporte SIP no se puede forzar por el interface %s", cfg->IpAddress));
@@ -461,6 +493,7 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 		/**
 		 * Crea el Transporte para RTP
 		 */
+		if (_RtpRxBatch) transportCfg.options |= PJMEDIA_UDP_BATCH_RX;
 
 		if (cfg->RtpPorts == 0)
 		{
@@ -523,6 +556,14 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 		**/
 		WG67Subscription::Init(NULL, cfg);
 
+		/**
+		 * Respuesta a los OPTIONS con plantilla, sin pasar por la capa de transacciones.
+		 */
+		if (Coresip_Local_Config._Options_Fast)
+		{
+			OptionsFast::Init(SipTransportId);
+		}
+
 		/**
 			* Se crea el puerto pjmedia para la grabacion
 		 */
@@ -543,7 +584,11 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 			_RecordPortRad->SetTheOtherRec(_RecordPortTel);
 		}
 
+		qidx_global_init();						//Tablas comunes del calculo del Qidx, antes de crear cualquier llamada
+
 		_FrecDesp = new FrecDesp;
+		_McastScheduler = new McastScheduler;
+		_McastReceiver = new McastReceiver;
 
 		_PresenceManager = new PresenceManag;	//Se inicializa la gestion de presencias
 		_PresenceManager->SetPresenceSubscriptionCallBack(cfg->Cb.Presence_callback);
@@ -595,6 +640,7 @@ void SipAgent::Init(const CORESIP_Config * cfg)
 	}
 	catch (...)
 	{
+		AsyncLog::End();
 		pjsua_destroy();
 		throw;
 	}
@@ -702,10 +748,13 @@ void SipAgent::Stop()
 		 */
 		Guard lock(_Lock);		
 
-		//for (pjsua_call_id cid = 0; cid < ((pjsua_call_id) PJ_ARRAY_SIZE(pjsua_var.calls)); cid++)
-		for (pjsua_call_id cid = 0; cid < ((pjsua_call_id) pjsua_call_get_max_count()); cid++)
+		//Solo las llamadas en curso
+		unsigned calls_count = PJSUA_MAX_CALLS;
+		pjsua_call_id call_ids[PJSUA_MAX_CALLS];
+		if (pjsua_enum_calls(call_ids, &calls_count) != PJ_SUCCESS) calls_count = 0;
+		for (unsigned i = 0; i < calls_count; i++)
 		{
-			SipCall::Force_Hangup(cid, 0);
+			SipCall::Force_Hangup(call_ids[i], 0);
 		}
 		//pjsua_call_hangup_all();
 
@@ -713,12 +762,12 @@ void SipAgent::Stop()
 		 * Espera a que todas las llamadas se hayan cerrado.
 		 */
 
-		for (int i = 0; i < PJ_ARRAY_SIZE(pjsua_var.calls); ++i) 
+		for (unsigned i = 0; i < calls_count; ++i) 
 		{
-			if (pjsua_var.calls[i].inv != NULL) 
+			if (pjsua_var.calls[call_ids[i]].inv != NULL) 
 			{
 				int cnt=0;
-				while (cnt<10 && pjsua_var.calls[i].inv != NULL)
+				while (cnt<10 && pjsua_var.calls[call_ids[i]].inv != NULL)
 				{
 					pj_thread_sleep(100);
 					cnt++;
@@ -765,6 +814,15 @@ void SipAgent::Stop()
 		/**
 		 * Cierra el Socket Remoto ???
 		 */
+		if (_SndRxStatsTimer.id)
+		{
+			pjsua_cancel_timer(&_SndRxStatsTimer);
+			_SndRxStatsTimer.id = PJ_FALSE;
+		}
+		for (unsigned i = 0; i < PJ_ARRAY_SIZE(_WavPlayerEofTimers); i++)
+		{
+			pjsua_cancel_timer(&_WavPlayerEofTimers[i]);
+		}
 		if (_RemoteSock)
 		{
 			pj_activesock_close(_RemoteSock);
@@ -782,6 +840,13 @@ void SipAgent::Stop()
 			_SndDev = NULL;
 		}
 
+		//Libera el thread de envio multicast antes que FD, que es usado por este
+		if (_McastScheduler)
+		{
+			delete _McastScheduler;
+			_McastScheduler = NULL;
+		}
+
 		//Libera FD
 		if (_FrecDesp)
 		{
@@ -852,6 +917,13 @@ void SipAgent::Stop()
 			}
 		}
 
+		//Cierra los sockets de recepcion multicast, ya sin puertos
+		if (_McastReceiver)
+		{
+			delete _McastReceiver;
+			_McastReceiver = NULL;
+		}
+
 		/**
 		 * Libera los puertos de Recepcion Audio.
 		 */
@@ -867,7 +939,7 @@ void SipAgent::Stop()
 		/**
 		 * Libera la memoria asociada al modulo.
 		 */
-		_SndRxIds.clear();
+		RemoteAudio::Rebuild(_SndRxPorts, PJ_ARRAY_SIZE(_SndRxPorts));
 		memset(_InChannels, 0, sizeof(_InChannels));
 		memset(_OutChannels, 0, sizeof(_OutChannels));
 
@@ -877,10 +949,12 @@ void SipAgent::Stop()
 		}
 
 		WG67Subscription::End();
+		OptionsFast::End();
 
 		lock.Unlock();
 		pj_lock_destroy(_Lock);
 
+		AsyncLog::End();
 		pjsua_destroy();
 	}
 }
@@ -923,13 +997,93 @@ void SipAgent::SetRTPPort(unsigned int port)
 	transportCfg.port = port;
 	transportCfg.bound_addr = pj_str(const_cast<char*>(SipAgent::uaIpAdd));
 	transportCfg.options = PJMEDIA_UDP_NO_SRC_ADDR_CHECKING;
+	if (_RtpRxBatch) transportCfg.options |= PJMEDIA_UDP_BATCH_RX;
 
-	//La siguiente funcion crea los transports para el RTP. Internamente borra los que tuviera creados.
-	//Crea un par de sockets (rtp/rtcp) para cada llamada. Por tanto en total crea pjsua_var.ua_cfg.max_calls*2
+	//La siguiente funcion configura los transports para el RTP. Internamente borra los que tuviera creados.
+	//Cada llamada toma un par de sockets (rtp/rtcp) de un pool al iniciar su media, y solo se abre un par nuevo
+	//si el pool esta vacio. Como maximo se abren pjsua_var.ua_cfg.max_calls*2 sockets a partir de 'port'
 	st = pjsua_media_transports_create(&transportCfg);
 	PJ_CHECK_STATUS(st, ("ERROR creando puertos UDP para RTP", "(%s:%d)", SipAgent::uaIpAdd, port));
 }
 
+/**
+ * GetUsedUdpPorts.		Obtiene la lista de puertos UDP que estan abiertos en el S.O.
+ *						En Windows con GetUdpTable() y en el resto leyendo /proc/net/udp.
+ * @param	nports		Numero de puertos obtenidos.
+ * @return				Array de puertos reservado con malloc. NULL si hay error.
+ */
+static unsigned short *GetUsedUdpPorts(unsigned int *nports)
+{
+	unsigned short *pUdpPorts = NULL;
+	*nports = 0;
+
+#ifdef _WIN32
+	PMIB_UDPTABLE pUdpTable;
+	DWORD dwSize = 0;
+	unsigned short *port_ptr;
+
+	/* Get size required by GetUdpTable() */
+	if (GetUdpTable(NULL, &dwSize, 0) != ERROR_INSUFFICIENT_BUFFER) return NULL;
+
+	pUdpTable = (MIB_UDPTABLE *) malloc (dwSize);	
+	if (pUdpTable == NULL) return NULL;
+
+	/* Get actual data using GetUdpTable() */
+	if (GetUdpTable(pUdpTable, &dwSize, 0) == NO_ERROR && pUdpTable->dwNumEntries > 0) 
+	{
+		pUdpPorts = (unsigned short *) malloc (pUdpTable->dwNumEntries * sizeof(unsigned short));
+		if (pUdpPorts != NULL)
+		{
+			for (unsigned int i = 0; i < pUdpTable->dwNumEntries; i++)
+			{
+				port_ptr = (unsigned short *)&pUdpTable->table[i].dwLocalPort;
+				pUdpPorts[i] = htons(*port_ptr);
+			}
+			*nports = pUdpTable->dwNumEntries;
+		}
+	}
+
+	free(pUdpTable);
+#else
+	FILE *f = fopen("/proc/net/udp", "r");
+	if (f == NULL) return NULL;
+
+	unsigned int max_ports = 256;
+	char line[256];
+
+	pUdpPorts = (unsigned short *) malloc (max_ports * sizeof(unsigned short));
+
+	//La primera linea es la cabecera. El resto: "sl: direccion_local:puerto ..." en hexadecimal
+	if (pUdpPorts != NULL && fgets(line, sizeof(line), f) != NULL)
+	{
+		while (fgets(line, sizeof(line), f) != NULL)
+		{
+			unsigned int sl, addr, used_port;
+			if (sscanf(line, " %u: %x:%x", &sl, &addr, &used_port) != 3) continue;
+
+			if (*nports == max_ports)
+			{
+				unsigned short *aux = (unsigned short *) realloc(pUdpPorts, 2 * max_ports * sizeof(unsigned short));
+				if (aux == NULL) break;
+				pUdpPorts = aux;
+				max_ports *= 2;
+			}
+			pUdpPorts[(*nports)++] = (unsigned short) used_port;
+		}
+	}
+
+	fclose(f);
+
+	if (pUdpPorts != NULL && *nports == 0)
+	{
+		free(pUdpPorts);
+		pUdpPorts = NULL;
+	}
+#endif
+
+	return pUdpPorts;
+}
+
 /**
  * GetRTPPort.				Obtiene el primer puerto RTP/RTCP. Busca un hueco de puertos UDP libres en el S.O. 
  *							para todas las posibles llamadas que pueda utilizar la CORESIP.
@@ -947,132 +1101,81 @@ int SipAgent::GetRTPPort(unsigned int *port)
 	
 	int max_rtp_rtcp_ports = pjsua_call_get_max_count() * 2;			//pjsua_var.ua_cfg.max_calls*2
 	
-	PMIB_UDPTABLE pUdpTable;
-	unsigned short *pUdpPorts;
-	DWORD dwSize = 0;
-	DWORD dwRetVal = 0;
+	unsigned short limite_superior = 64998u;
+	unsigned short puerto_obtenido = -1;
 
-	unsigned short *port_ptr;
+	//Obtenemos todos los puertos que utiliza nuestro sistema operativo, ordenados de menor a mayor
+	//Buscamos un hueco entre puertos utilizados donde podamos utilizar todos los puertos que requerimos. Es decir, max_rtp_rtcp_ports
+	//Empezamos por el puerto mas alto ulilizado de la tabla obtenida y calculamos la diferencia con limite_superior.
+	//Si la diferencia es mayor que la cantidad de puertos requeridos entonces ya tenemos hueco.
+	//Si no hay hueco entonces limite_superior toma el valor del puerto de la tabla que hemos utilizado, as hasta obtener el hueco.	
 
-	/* Get size required by GetUdpTable() */
-	if (GetUdpTable(NULL, &dwSize, 0) == ERROR_INSUFFICIENT_BUFFER) 
+	unsigned int nports = 0;
+	unsigned short *pUdpPorts = GetUsedUdpPorts(&nports);
+
+	if (pUdpPorts != NULL) 
 	{
-		pUdpTable = (MIB_UDPTABLE *) malloc (dwSize);	
-		if (pUdpTable == NULL)
+		//Ordenamos el array de menor puerto a mayor
+		for (unsigned int i = 0; i < nports-1; i++)
 		{
-			PJ_CHECK_STATUS(PJ_ENOMEM, ("ERROR. GetUdpTable retorna con error. No se puede obtener la lista de puertos UDP utilizados"));				
-			ret = -1;
-			return ret;
+			for (unsigned j = i+1; j < nports; j++)
+			{				
+				if (pUdpPorts[i] > pUdpPorts[j])
+				{
+					unsigned short aux = pUdpPorts[i];
+					pUdpPorts[i] = pUdpPorts[j];
+					pUdpPorts[j] = aux;
+				}
+			}
 		}
-	}
-	else
-	{
-		ret = -1;
-	}
 
-	unsigned short limite_superior = 64998u;
-	unsigned short puerto_obtenido = -1;
-
-	if (ret == 0)
-	{
-		/* Get actual data using GetUdpTable() */
-		//Obtenemos todos los puertos que utiliza nuestro sistema operativo, ordenados de menor a mayor
-		//Buscamos un hueco entre puertos utilizados donde podamos utilizar todos los puertos que requerimos. Es decir, max_rtp_rtcp_ports
-		//Empezamos por el puerto mas alto ulilizado de la tabla obtenida y calculamos la diferencia con limite_superior.
-		//Si la diferencia es mayor que la cantidad de puertos requeridos entonces ya tenemos hueco.
-		//Si no hay hueco entonces limite_superior toma el valor del puerto de la tabla que hemos utilizado, as hasta obtener el hueco.	
+		PJ_LOG(5,(__FILE__, "Puertos usados: #############################################"));
+		for (unsigned int i = 0; i < nports; i++)
+		{					
+			PJ_LOG(5,(__FILE__, "Puerto usado: %u", pUdpPorts[i]));
+		}
+		PJ_LOG(5,(__FILE__, "#############################################"));
+		
+		for (int i = (int) nports-1; i >= 0; i--)
+		{			
 
-		if ((dwRetVal = GetUdpTable(pUdpTable, &dwSize, 0)) == NO_ERROR) 
-		{
-			if (pUdpTable->dwNumEntries > 0) 
+			unsigned short nport = pUdpPorts[i];
+			//Le sumanos 2 y nos aseguramos de que es par
+			nport += 2;
+			if ((nport % 2) != 0)
 			{
-				//Guardamos los puertos en un array
-				pUdpPorts = (unsigned short *) malloc (pUdpTable->dwNumEntries * sizeof(unsigned short));
-				if (pUdpPorts == NULL)
-				{
-					PJ_CHECK_STATUS(PJ_ENOMEM, ("ERROR. GetUdpTable retorna con error. No se puede obtener la lista de puertos UDP utilizados"));
-					free(pUdpTable);
-					ret = -1;
-					return ret;
-				}
+				nport += 1;
+			}
+								
+			if (nport < limite_superior)
+			{
+				//El valor tiene que ser menor que el de limite_superior, si no es asi no hacemos nada y tomaremos el siguiente mas bajo de la tabla
 
-				for (unsigned int i = 0; i < pUdpTable->dwNumEntries; i++)
+				if ((limite_superior - nport) > max_rtp_rtcp_ports)
 				{
-					port_ptr = (unsigned short *)&pUdpTable->table[i].dwLocalPort;
-					unsigned short used_port = htons(*port_ptr);
-					pUdpPorts[i] = used_port;
+					//Hemos encontrado un hueco donde caben todos los puertos que necesitamos
+					puerto_obtenido = limite_superior - max_rtp_rtcp_ports;
+					break;
 				}
-
-				//Ordenamos el array de menor puerto a mayor
-				for (unsigned int i = 0; i < pUdpTable->dwNumEntries-1; i++)
+				else
 				{
-					for (unsigned j = i+1; j < pUdpTable->dwNumEntries; j++)
-					{				
-						if (pUdpPorts[i] > pUdpPorts[j])
-						{
-							unsigned short aux = pUdpPorts[i];
-							pUdpPorts[i] = pUdpPorts[j];
-							pUdpPorts[j] = aux;
-						}
-					}
-				}
+					//Si no cabe entonces el limite superior cambia al del valor de la tabla que hemos utilizado
+					limite_superior = pUdpPorts[i];
 
-				PJ_LOG(5,(__FILE__, "Puertos usados: #############################################"));
-				for (unsigned int i = 0; i < pUdpTable->dwNumEntries; i++)
-				{					
-					PJ_LOG(5,(__FILE__, "Puerto usado: %u", pUdpPorts[i]));
-				}
-				PJ_LOG(5,(__FILE__, "#############################################"));
-				
-				for (unsigned int i = pUdpTable->dwNumEntries-1; i >= 0; i--)
-				{			
-
-					unsigned short nport = pUdpPorts[i];
-					//Le sumanos 2 y nos aseguramos de que es par
-					nport += 2;
-					if ((nport % 2) != 0)
+					//Si es impar le restamos 1
+					if ((limite_superior % 2) != 0)
 					{
-						nport += 1;
+						limite_superior -= 1;
 					}
-										
-					if (nport < limite_superior)
-					{
-						//El valor tiene que ser menor que el de limite_superior, si no es asi no hacemos nada y tomaremos el siguiente mas bajo de la tabla
-
-						if ((limite_superior - nport) > max_rtp_rtcp_ports)
-						{
-							//Hemos encontrado un hueco donde caben todos los puertos que necesitamos
-							puerto_obtenido = limite_superior - max_rtp_rtcp_ports;
-							break;
-						}
-						else
-						{
-							//Si no cabe entonces el limite superior cambia al del valor de la tabla que hemos utilizado
-							limite_superior = pUdpPorts[i];
-
-							//Si es impar le restamos 1
-							if ((limite_superior % 2) != 0)
-							{
-								limite_superior -= 1;
-							}
-						}
-					}					
 				}
-
-				free(pUdpPorts);
-
-			}
-			else
-			{
-				ret = -1;
-			}
-		} 
-		else 
-		{
-			ret = -1;
+			}					
 		}
 
-		free(pUdpTable);
+		free(pUdpPorts);
+	}
+	else
+	{
+		ret = -1;
 	}
 
 	if (ret == -1)
@@ -1132,6 +1235,7 @@ void SipAgent::SetLogLevel(unsigned level)
 		logCfg.log_filename = pj_str(const_cast<char*>("./logs/coresip.txt"));
 	}
 
+	AsyncLog::Configure(&logCfg);
 	pjsua_reconfigure_logging(&logCfg);
 }
 
@@ -1301,7 +1405,7 @@ int SipAgent::CreateAccountAndRegisterInProxy(const char * acc, int defaultAcc,
 	pj_strcat(&accCfg.id, &sturi);
 	pj_strcat(&accCfg.id, &stacc);
 	pj_strcat(&accCfg.id, &starr);
-	pj_strcat(&accCfg.id, &pj_str(const_cast<char*>(uaIpAdd)));
+	pj_strcat(&accCfg.id, StrPtr(pj_str(const_cast<char*>(uaIpAdd))));
 	pj_strcat(&accCfg.id, &stpp);
 	pj_strcat(&accCfg.id, &stuaport);
 	pj_strcat(&accCfg.id, &st_mayorque);
@@ -1547,6 +1651,7 @@ int SipAgent::CreateWavPlayer(const char * file, bool loop)
 	/**
 	 * Crea el Reproductor a travs de la clase @ref WavPlayer.
 	 */
+	_WavPlayerGen[id]++;
 	_WavPlayers[id] = new WavPlayer(file, PTIME, loop, OnWavPlayerEof, (void*)(size_t)id);
 
 	if (_WavPlayers[id] == NULL)
@@ -1568,11 +1673,29 @@ void SipAgent::DestroyWavPlayer(int id)
 
 	if (_WavPlayers[id] != NULL)
 	{
+		pjsua_cancel_timer(&_WavPlayerEofTimers[id]);
 		delete _WavPlayers[id];
 		_WavPlayers[id] = NULL;
 	}
 }
 
+/**
+ * GetWavPlayerStats: Estadisticas de la lectura del fichero de un 'Reproductor Wav'
+ * @param	id		Identificador del 'Reproductor Wav'
+ * @param	stats	Contadores.
+ * @return	Nada
+ */
+void SipAgent::GetWavPlayerStats(int id, CORESIP_WavStats * stats)
+{
+	Guard lock(_Lock);
+
+	if (id < 0 || id >= PJ_ARRAY_SIZE(_WavPlayers) || _WavPlayers[id] == NULL)
+	{
+		throw PJLibException(__FILE__, PJ_EINVAL).Msg("GetWavPlayerStats:", "Reproductor wav no valido");
+	}
+	_WavPlayers[id]->GetStats(stats);
+}
+
 /**
  * CreateWavRecorder: Crea un Grabador Wav
  * @param	file	Puntero al Path del fichero donde grabar.
@@ -1623,6 +1746,23 @@ void SipAgent::DestroyWavRecorder(int id)
 	}
 }
 
+/**
+ * GetWavRecorderStats: Estadisticas de la escritura del fichero de un Grabador Wav.
+ * @param	id		Identificador del Grabador
+ * @param	stats	Contadores.
+ * @return	Nada
+ */
+void SipAgent::GetWavRecorderStats(int id, CORESIP_WavStats * stats)
+{
+	Guard lock(_Lock);
+
+	if (id < 0 || id >= PJ_ARRAY_SIZE(_WavRecorders) || _WavRecorders[id] == NULL)
+	{
+		throw PJLibException(__FILE__, PJ_EINVAL).Msg("GetWavRecorderStats:", "Grabador wav no valido");
+	}
+	_WavRecorders[id]->GetStats(stats);
+}
+
 /**
  * CreateRdRxPort: Crea un 'PORT' de Recepcion Radio.
  * @param	info	Puntero a la Informacion del PORT.
@@ -1703,7 +1843,7 @@ int SipAgent::CreateSndRxPort(const char * name)
 		throw PJLibException(__FILE__, PJ_ETOOMANY).Msg("CreateSndRxPort: No se pueden crear mas elementos _SndRxPorts");
 	}
 
-	_SndRxIds[name] = _SndRxPorts[id];
+	RemoteAudio::Rebuild(_SndRxPorts, PJ_ARRAY_SIZE(_SndRxPorts));
 	return id;
 }
 
@@ -1718,10 +1858,74 @@ void SipAgent::DestroySndRxPort(int id)
 
 	if (_SndRxPorts[id] != NULL)
 	{
-		_SndRxIds.erase(_SndRxPorts[id]->Id);
 		delete _SndRxPorts[id];
 		_SndRxPorts[id] = NULL;
+		RemoteAudio::Rebuild(_SndRxPorts, PJ_ARRAY_SIZE(_SndRxPorts));
+	}
+}
+
+/**
+ * GetSndRxStats: Estadisticas del audio recibido por un PORT 'SndRx'
+ * @param	id		Identificador del PORT.
+ * @param	stats	Estadisticas de cada tipo de emisor.
+ * @return	Nada
+ */
+void SipAgent::GetSndRxStats(int id, CORESIP_SndRxStats stats[CORESIP_SND_MAX_IN_DEVICES])
+{
+	Guard lock(_Lock);
+
+	if (id < 0 || id >= PJ_ARRAY_SIZE(_SndRxPorts) || _SndRxPorts[id] == NULL)
+	{
+		throw PJLibException(__FILE__, PJ_EINVAL).Msg("GetSndRxStats:", "Puerto SndRx no valido");
+	}
+	_SndRxPorts[id]->GetStats(stats);
+}
+
+/**
+ * SndRxStatsTimerCb: Pasa a _SndRxStatsCb las estadisticas de los emisores que han enviado audio.
+ * Se recogen con _Lock tomado y se entregan sin el.
+ */
+void SipAgent::SndRxStatsTimerCb(pj_timer_heap_t * th, pj_timer_entry * te)
+{
+	struct Report
+	{
+		int Port;
+		char Id[CORESIP_MAX_USER_ID_LENGTH + 1];
+		CORESIP_SndRxStats Stats;
+	};
+	std::vector<Report> reports;
+
+	PJ_UNUSED_ARG(th);
+	{
+		Guard lock(_Lock);
+
+		for (int i = 0; i < PJ_ARRAY_SIZE(_SndRxPorts); i++)
+		{
+			if (_SndRxPorts[i] == NULL) continue;
+
+			CORESIP_SndRxStats stats[CORESIP_SND_MAX_IN_DEVICES];
+			_SndRxPorts[i]->GetStats(stats);
+			for (int t = 0; t < CORESIP_SND_MAX_IN_DEVICES; t++)
+			{
+				if (stats[t].Received == 0) continue;
+
+				Report r;
+				r.Port = i | CORESIP_SNDRXPORT_ID;
+				pj_ansi_strcpy(r.Id, _SndRxPorts[i]->Id);
+				r.Stats = stats[t];
+				reports.push_back(r);
+			}
+		}
 	}
+
+	for (size_t i = 0; i < reports.size(); i++)
+	{
+		if (_SndRxStatsCb) _SndRxStatsCb(reports[i].Port, reports[i].Id, &reports[i].Stats);
+	}
+
+	pj_time_val delay = { (long) Coresip_Local_Config._Snd_Rx_Stats_Period, 0 };
+	te->id = PJ_TRUE;
+	pjsua_schedule_timer(te, &delay);
 }
 
 /**
@@ -1906,30 +2110,28 @@ int SipAgent::RecConnectSndPorts(bool on, RecordPort *recordport)
 unsigned SipAgent::NumConfirmedCalls()
 {
 	unsigned ret = 0;
-	unsigned call_count = 512;
-	pjsua_call_id ids[512];
-	pj_status_t st = pjsua_enum_calls(ids, &call_count);
-	PJ_CHECK_STATUS(st, ("ERROR enum calls in  SipAgent::RecordTel"));
 
-	for (unsigned i = 0; i < call_count; i++)
+	//Recorre solo la lista de llamadas en curso de pjsua y lee su estado directamente,
+	//sin copiar toda la informacion de cada llamada con pjsua_call_get_info()
+	pj_mutex_lock(pjsua_var.mutex);
+
+	for (pjsua_call *call = pjsua_var.call_used_list.next; call != &pjsua_var.call_used_list; call = call->next)
 	{
-		pjsua_call_info info;
-		st = pjsua_call_get_info(ids[i], &info);
+		if (call->inv == NULL) continue;
 
-		if (st == PJ_SUCCESS)
+		if (call->inv->state == PJSIP_INV_STATE_CONNECTING || call->inv->state == PJSIP_INV_STATE_CONFIRMED) 
 		{
-			if (info.state == PJSIP_INV_STATE_CONNECTING || info.state == PJSIP_INV_STATE_CONFIRMED) 
+			if (call->media_st != PJSUA_CALL_MEDIA_NONE && call->media_st != PJSUA_CALL_MEDIA_ERROR)
 			{
-				if (info.media_status != PJSUA_CALL_MEDIA_NONE && info.media_status != PJSUA_CALL_MEDIA_ERROR)
+				if (call->media_dir != PJMEDIA_DIR_NONE)
 				{
-					if (info.media_dir != PJMEDIA_DIR_NONE)
-					{
-						ret++;
-					}
+					ret++;
 				}
 			}
 		}
 	}
+
+	pj_mutex_unlock(pjsua_var.mutex);
 	return ret;
 }
 
@@ -2425,8 +2627,8 @@ void SipAgent::SendToRemote(int typeDev, int dev, bool on, const char * id, cons
 void SipAgent::ReceiveFromRemote(const char * localIp, const char * mcastIp, unsigned mcastPort)
 {
 	pj_sockaddr_in addr, mcastAddr;
-	pj_sockaddr_in_init(&addr, &(pj_str(const_cast<char*>(localIp))), (pj_uint16_t)mcastPort);
-	pj_sockaddr_in_init(&mcastAddr, &(pj_str(const_cast<char*>(mcastIp))), (pj_uint16_t)mcastPort);
+	pj_sockaddr_in_init(&addr, StrPtr(pj_str(const_cast<char*>(localIp))), (pj_uint16_t)mcastPort);
+	pj_sockaddr_in_init(&mcastAddr, StrPtr(pj_str(const_cast<char*>(mcastIp))), (pj_uint16_t)mcastPort);
 
 	/**
 	 * Crea el socket de recepcion.
@@ -2440,16 +2642,16 @@ void SipAgent::ReceiveFromRemote(const char * localIp, const char * mcastIp, uns
 		/**
 		 * Configura el socket para que sea 'reutizable' y habilita (joint) el grupo Multicast.
 		 */
-		pj_sock_setsockopt(_Sock, pj_SOL_SOCKET(), SO_REUSEADDR, (void *)&on, sizeof(on));
+		pj_sock_setsockopt(_Sock, pj_SOL_SOCKET(), pj_SO_REUSEADDR(), (void *)&on, sizeof(on));
 
 		st = pj_sock_bind(_Sock, &addr, sizeof(addr));
 		PJ_CHECK_STATUS(st, ("ERROR enlazando socket para puerto de recepcion sndDev radio", "[Ip=%s][Port=%d]", localIp, mcastPort));
 
-		struct ip_mreq	mreq;
-		mreq.imr_multiaddr.S_un.S_addr = mcastAddr.sin_addr.s_addr;
-		mreq.imr_interface.S_un.S_addr = addr.sin_addr.s_addr;
+		pj_ip_mreq	mreq;
+		mreq.imr_multiaddr.s_addr = mcastAddr.sin_addr.s_addr;
+		mreq.imr_interface.s_addr = addr.sin_addr.s_addr;
 
-		st = pj_sock_setsockopt(_Sock, IPPROTO_IP, pj_IP_ADD_MEMBERSHIP(), (void *)&mreq, sizeof(mreq));
+		st = pj_sock_setsockopt(_Sock, pj_SOL_IP(), pj_IP_ADD_MEMBERSHIP(), (void *)&mreq, sizeof(mreq));
 		PJ_CHECK_STATUS(st, ("ERROR aadiendo socket a multicast para puerto de recepcion sndDev radio", "[Mcast=%s][Port=%d]", mcastIp, mcastPort));
 
 		/**
@@ -2469,8 +2671,18 @@ void SipAgent::ReceiveFromRemote(const char * localIp, const char * mcastIp, uns
 		 * Activa la Recepcion en el Socket.
 		 */ 
 		unsigned samplesPerFrame = SAMPLING_RATE * CHANNEL_COUNT * PTIME / 1000;
-		st = pj_activesock_start_recvfrom(_RemoteSock, pjsua_var.pool, sizeof(RemotePayload), 0);
+		st = pj_activesock_start_recvfrom(_RemoteSock, pjsua_var.pool, RemoteAudio::MAX_FRAME, 0);
 		PJ_CHECK_STATUS(st, ("ERROR iniciando lectura en puerto de recepcion sndDev radio"));
+
+		/**
+		 * Estadisticas periodicas de los emisores.
+		 */
+		if (_SndRxStatsCb && Coresip_Local_Config._Snd_Rx_Stats_Period > 0 && !_SndRxStatsTimer.id)
+		{
+			pj_time_val delay = { (long) Coresip_Local_Config._Snd_Rx_Stats_Period, 0 };
+			pj_timer_entry_init(&_SndRxStatsTimer, PJ_TRUE, NULL, &SndRxStatsTimerCb);
+			pjsua_schedule_timer(&_SndRxStatsTimer, &delay);
+		}
 	}
 	catch (...)
 	{
@@ -2930,17 +3142,48 @@ pj_bool_t SipAgent::OnRxResponse(pjsip_rx_data *rdata)
 
 /**
  * OnWavPlayerEof: Callback. Se llama al finalizar la reproduccin deun fichero wav
+ * Se llama desde el mezclador, que no debe esperar a que se pare el thread de lectura del reproductor: solo
+ * programa _WavPlayerEofTimers, y FinWavCb y la destruccion se hacen desde el thread de pjsua.
  * @param	port		Puntero 'pj_media_port' al puerto Implicado.
  * @param	userData	Datos de Usuario. Por configuracion del sistema debe corresponder al id del Reproductor
  * @return	Si no hay excepciones, retorna siempre PJ_EEOF.
  */
 pj_status_t SipAgent::OnWavPlayerEof(pjmedia_port *port, void *userData)
 {
-	if (Cb.FinWavCb) Cb.FinWavCb((int)(size_t)userData | CORESIP_WAVPLAYER_ID);
-	DestroyWavPlayer((int)(size_t)userData);
+	int id = (int)(size_t)userData;
+	pj_time_val delay = { 0, 0 };
+
+	PJ_UNUSED_ARG(port);
+	_WavPlayerEofTimers[id].id = (int) _WavPlayerGen[id];
+	pjsua_schedule_timer(&_WavPlayerEofTimers[id], &delay);
 	return PJ_EEOF;
 }
 
+/**
+ * WavPlayerEofTimerCb: Fin de fichero de un Reproductor Wav, fuera del mezclador. Se descarta si el reproductor
+ * ya se ha destruido, o si en su posicion hay otro creado despues.
+ */
+void SipAgent::WavPlayerEofTimerCb(pj_timer_heap_t * th, pj_timer_entry * te)
+{
+	int id = (int)(size_t)te->user_data;
+	WavPlayer * player;
+
+	PJ_UNUSED_ARG(th);
+	{
+		Guard lock(_Lock);
+
+		if (_WavPlayers[id] == NULL || te->id != (int) _WavPlayerGen[id])
+		{
+			return;
+		}
+		player = _WavPlayers[id];
+		_WavPlayers[id] = NULL;
+	}
+
+	if (Cb.FinWavCb) Cb.FinWavCb(id | CORESIP_WAVPLAYER_ID);
+	delete player;
+}
+
 /**
  * OnDataReceived: Callback Recepcion Audio Multicast.
  * @param	asock		Puntero 'pj_activesock' al SOCKET involucrado en el proceso de Recepcion.
@@ -2953,25 +3196,24 @@ pj_status_t SipAgent::OnWavPlayerEof(pjmedia_port *port, void *userData)
  */
 pj_bool_t SipAgent::OnDataReceived(pj_activesock_t * asock, void * data, pj_size_t size, const pj_sockaddr_t *src_addr, int addr_len, pj_status_t status)
 {
+	RemoteAudioFrame fr;
+
 	/**
-	 * Comprueba que no hay error en la recepcion y es una trama del sistema.
+	 * Comprueba que no hay error en la recepcion y es una trama del sistema, en el formato original o en el compacto.
 	 */
-	if ((status == PJ_SUCCESS) && (size == sizeof(RemotePayload)))
+	if ((status == PJ_SUCCESS) && RemoteAudio::Decode(data, size, &fr))
 	{
-		RemotePayload * pl = (RemotePayload*)data;
-		pj_assert(pl->Size == (SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8)));
 		Guard lock(_Lock);
 
 		/**
-		 * Envia la trama a todos los puertos tipo @ref SoundRxPort
+		 * Envia la trama al puerto @ref SoundRxPort del emisor. En el formato original se comprueba ademas el nombre.
 		 */
-		std::map<std::string, SoundRxPort*>::iterator it = _SndRxIds.find(pl->SrcId);
-		if (it != _SndRxIds.end())
+		SoundRxPort * port = RemoteAudio::Find(fr.SrcId);
+		if (port != NULL && (fr.Name == NULL || pj_ansi_strcmp(port->Id, fr.Name) == 0))
 		{
-			//pj_uint16_t *data_uint16 = (pj_uint16_t *) pl->Data;
-			//PJ_LOG(3,(__FILE__, "INCIPALMA: OnDataReceived %d %s", *data_uint16, pl->SrcId));
+			//PJ_LOG(3,(__FILE__, "INCIPALMA: OnDataReceived %d %08x", fr.Samples[0], fr.SrcId));
 
-			it->second->PutFrame(pl->SrcType, pl->Data, pl->Size);
+			port->PutFrame(&fr);
 		}
 	}
 
@@ -3039,7 +3281,7 @@ pj_status_t SipAgent::RecCb(void * userData, pjmedia_frame * frame)
 	/** AGL. Tick Multimedia */
 	if (_wp2r != 0)	
 	{
-		if (_wp2r->Tick()==FALSE)		
+		if (_wp2r->Tick()==PJ_FALSE)		
 		{		
 			DestroyWavPlayer2Remote();			
 		}		
@@ -3253,11 +3495,11 @@ int SipAgent::SendInstantMessage(int acc_id, char *dest_uri, char *text, pj_bool
 	pj_status_t st;
 	if (by_proxy)
 	{
-		st = pjsua_im_send(acc_id, &pj_str(dest_uri), NULL,  &pj_str(text), NULL, NULL);
+		st = pjsua_im_send(acc_id, StrPtr(pj_str(dest_uri)), NULL,  StrPtr(pj_str(text)), NULL, NULL);
 	}
 	else
 	{
-		st = pjsua_im_send_no_proxy(acc_id, &pj_str(dest_uri), NULL,  &pj_str(text), NULL, NULL);
+		st = pjsua_im_send_no_proxy(acc_id, StrPtr(pj_str(dest_uri)), NULL,  StrPtr(pj_str(text)), NULL, NULL);
 	}
 	PJ_CHECK_STATUS(st, ("ERROR: SipAgent::SendInstantMessage: No se puede enviar ", "acc_id=%d dest=%s text %s", acc_id, dest_uri, text));
 	return CORESIP_OK;
@@ -3318,6 +3560,7 @@ void SipAgent::ReadiniFile()
 	char inipath[512];
 	inipath[0] = '\0';
 
+#ifdef _WIN32
 	if(GetCurrentDirectory(sizeof(curdir), curdir) > 0)
 	{
 		strcpy(inipath, curdir);
@@ -3325,8 +3568,74 @@ void SipAgent::ReadiniFile()
 	}
 
 	UINT DBSS = GetPrivateProfileInt("CORESIP", "Debug_BSS", 0, inipath);
+	UINT MediaWorkers = GetPrivateProfileInt("CORESIP", "MediaWorkers", 1, inipath);
+	UINT MediaWorkersAffinity = GetPrivateProfileInt("CORESIP", "MediaWorkersAffinity", 0, inipath);
+	UINT MediaWorkersFirstCpu = GetPrivateProfileInt("CORESIP", "MediaWorkersFirstCpu", 0, inipath);
+	UINT LogAsync = GetPrivateProfileInt("CORESIP", "LogAsync", 1, inipath);
+	UINT LogRingKB = GetPrivateProfileInt("CORESIP", "LogRingKB", 64, inipath);
+	UINT LogRepeatMax = GetPrivateProfileInt("CORESIP", "LogRepeatMax", 10, inipath);
+	UINT OptionsFastPath = GetPrivateProfileInt("CORESIP", "OptionsFastPath", 1, inipath);
+	UINT RemoteAudioFormat = GetPrivateProfileInt("CORESIP", "RemoteAudioFormat", REMOTE_AUDIO_LEGACY, inipath);
+	UINT SndRxStatsPeriod = GetPrivateProfileInt("CORESIP", "SndRxStatsPeriod", 10, inipath);
+#else
+	//Sin GetPrivateProfileInt. Se buscan las claves en la seccion [CORESIP] de ./coresip.ini
+	unsigned int DBSS = 0;
+	unsigned int MediaWorkers = 1;
+	unsigned int MediaWorkersAffinity = 0;
+	unsigned int MediaWorkersFirstCpu = 0;
+	unsigned int LogAsync = 1;
+	unsigned int LogRingKB = 64;
+	unsigned int LogRepeatMax = 10;
+	unsigned int OptionsFastPath = 1;
+	unsigned int RemoteAudioFormat = REMOTE_AUDIO_LEGACY;
+	unsigned int SndRxStatsPeriod = 10;
+	PJ_UNUSED_ARG(curdir);
+	strcpy(inipath, "coresip.ini");
+
+	FILE *f = fopen(inipath, "r");
+	if (f != NULL)
+	{
+		char line[256];
+		pj_bool_t in_section = PJ_FALSE;
+		while (fgets(line, sizeof(line), f) != NULL)
+		{
+			if (line[0] == '[') in_section = (strncmp(line, "[CORESIP]", 9) == 0);
+			else if (in_section)
+			{
+				sscanf(line, " Debug_BSS = %u", &DBSS);
+				sscanf(line, " MediaWorkers = %u", &MediaWorkers);
+				sscanf(line, " MediaWorkersAffinity = %u", &MediaWorkersAffinity);
+				sscanf(line, " MediaWorkersFirstCpu = %u", &MediaWorkersFirstCpu);
+				sscanf(line, " LogAsync = %u", &LogAsync);
+				sscanf(line, " LogRingKB = %u", &LogRingKB);
+				sscanf(line, " LogRepeatMax = %u", &LogRepeatMax);
+				sscanf(line, " OptionsFastPath = %u", &OptionsFastPath);
+				sscanf(line, " RemoteAudioFormat = %u", &RemoteAudioFormat);
+				sscanf(line, " SndRxStatsPeriod = %u", &SndRxStatsPeriod);
+			}
+		}
+		fclose(f);
+	}
+#endif
 	if (DBSS) Coresip_Local_Config._Debug_BSS = PJ_TRUE;
 	else Coresip_Local_Config._Debug_BSS = PJ_FALSE;	
+
+	//Entre 1 y el maximo de threads del endpoint de pjmedia
+	if (MediaWorkers < 1) MediaWorkers = 1;
+	if (MediaWorkers > 16) MediaWorkers = 16;
+	Coresip_Local_Config._Media_Workers = MediaWorkers;
+	Coresip_Local_Config._Media_Workers_First_Cpu = MediaWorkersAffinity ? (int) MediaWorkersFirstCpu : -1;
+
+	Coresip_Local_Config._Log_Async = LogAsync ? PJ_TRUE : PJ_FALSE;
+	Coresip_Local_Config._Log_Ring_KB = LogRingKB;
+	Coresip_Local_Config._Log_Repeat_Max = LogRepeatMax;
+
+	Coresip_Local_Config._Options_Fast = OptionsFastPath ? PJ_TRUE : PJ_FALSE;
+
+	//Por defecto el formato original, que entienden todos los receptores
+	if (RemoteAudioFormat > REMOTE_AUDIO_PCMA) RemoteAudioFormat = REMOTE_AUDIO_LEGACY;
+	Coresip_Local_Config._Remote_Audio_Format = RemoteAudioFormat;
+	Coresip_Local_Config._Snd_Rx_Stats_Period = SndRxStatsPeriod;
 }
 
 /** */
@@ -28,6 +28,8 @@
 #include "SoundRxPort.h"
 #include "RecordPort.h"
 #include "FrecDesp.h"
+#include "McastScheduler.h"
+#include "McastReceiver.h"
 #include "PresenceManag.h"
 #include "SubsManager.h"
 #include "WavPlayerToRemote.h"		/** AGL */
@@ -40,6 +42,14 @@ struct stCoresip_Local_Config
 {
 	//Estructura que contiene los datos obtenido de la configuracion local de la CORESIP obtenida de un fichero de configuracion
 	pj_bool_t _Debug_BSS;						//Indica hay debig para el BSS
+	unsigned _Media_Workers;					//Threads que reciben el RTP, cada uno con su ioqueue
+	int _Media_Workers_First_Cpu;				//CPU del primer thread de RTP, el resto en las siguientes. -1 sin afinidad
+	pj_bool_t _Log_Async;						//El log lo escribe un thread propio (AsyncLog)
+	unsigned _Log_Ring_KB;						//Tamano del buffer de log de cada thread, en KB
+	unsigned _Log_Repeat_Max;					//Mensajes de log parecidos por segundo y thread. 0 sin limite
+	pj_bool_t _Options_Fast;					//Los OPTIONS a los usuarios del agente se contestan con plantilla (OptionsFast)
+	unsigned _Remote_Audio_Format;				//Formato del audio que se envia a los puestos remotos (REMOTE_AUDIO_xxx)
+	unsigned _Snd_Rx_Stats_Period;				//Segundos entre llamadas a SndRxStatsCb. 0 no se llama
 };
 
 class SipAgent
@@ -66,6 +76,8 @@ public:
 	static pjsip_sip_uri *pContacUrl;
 
 	static FrecDesp *_FrecDesp;
+	static McastScheduler *_McastScheduler;				//Thread comun de envio multicast del audio de las radios
+	static McastReceiver *_McastReceiver;				//Thread y sockets comunes de recepcion multicast de los RdRxPort
 	static PresenceManag *_PresenceManager;
 	static SubsManager<ConfSubs> *_ConfManager;			//Objeto para administrar las subscripciones al evento de conferencia
 	static SubsManager<DlgSubs> *_DlgManager;			//Objeto para administrar las subscripciones al evento de dialogo
@@ -77,6 +89,8 @@ public:
 	static pj_lock_t *_ECLCMic_mutex;					//Mutex para el cancelador de eco altavoz LC-Mic
 
 	static unsigned _TimeToDiscardRdInfo;				//Tiempo durante el cual no se envia RdInfo al Nodebox tras un PTT OFF
+	static pj_bool_t _RtpRxBatch;						//Si vale true, los transportes RTP leen varios paquetes por llamada al sistema
+	static void (*_SndRxStatsCb)(int sndRxPort, const char * id, const CORESIP_SndRxStats * stats);	//CORESIP_Config::SndRxStatsCb
 
 	static pj_bool_t _HaveRdAcc;						//Si vale true, entonces algun account del agente es de lipo radio GRS
 
@@ -116,15 +130,18 @@ public:
 
 	static int CreateWavPlayer(const char * file, bool loop);
 	static void DestroyWavPlayer(int id);
+	static void GetWavPlayerStats(int id, CORESIP_WavStats * stats);
 
 	static int CreateWavRecorder(const char * file);
 	static void DestroyWavRecorder(int id);
+	static void GetWavRecorderStats(int id, CORESIP_WavStats * stats);
 
 	static int CreateRdRxPort(const CORESIP_RdRxPortInfo * info, const char * localIp);
 	static void DestroyRdRxPort(int id);
 
 	static int CreateSndRxPort(const char * name);
 	static void DestroySndRxPort(int id);
+	static void GetSndRxStats(int id, CORESIP_SndRxStats stats[CORESIP_SND_MAX_IN_DEVICES]);
 
 	static int RecConnectSndPort(bool on, int dev, RecordPort *recordport);
 	static int RecConnectSndPorts(bool on, RecordPort *recordport);
@@ -184,15 +201,17 @@ private:
 	static unsigned _KeepAliveMultiplier;
 	static SoundPort * _SndPorts[CORESIP_MAX_SOUND_DEVICES];
 	static WavPlayer * _WavPlayers[CORESIP_MAX_WAV_PLAYERS];
+	static pj_timer_entry _WavPlayerEofTimers[CORESIP_MAX_WAV_PLAYERS];	//Fin de fichero de cada reproductor, atendido fuera del mezclador
+	static unsigned _WavPlayerGen[CORESIP_MAX_WAV_PLAYERS];				//Se incrementa al crear cada reproductor
 	static WavRecorder * _WavRecorders[CORESIP_MAX_WAV_RECORDERS];
 	static RdRxPort * _RdRxPorts[CORESIP_MAX_RDRX_PORTS];
 	static SoundRxPort * _SndRxPorts[CORESIP_MAX_SOUND_RX_PORTS];
 	static RecordPort * _RecordPortTel;
 	static RecordPort * _RecordPortRad;
 	
-	static std::map<std::string, SoundRxPort*> _SndRxIds;
 	static pj_sock_t _Sock;
 	static pj_activesock_t * _RemoteSock;
+	static pj_timer_entry _SndRxStatsTimer;
 
 	static WavPlayerToRemote *_wp2r;	/** AGL */
 
@@ -211,8 +230,10 @@ private:
 
 private:
 	static pj_status_t OnWavPlayerEof(pjmedia_port * port, void * userData);
+	static void WavPlayerEofTimerCb(pj_timer_heap_t * th, pj_timer_entry * te);
 	static pj_bool_t OnDataReceived(pj_activesock_t * asock, void * data, pj_size_t size, const pj_sockaddr_t *src_addr, int addr_len, pj_status_t status);		
 	static void ReadiniFile();
+	static void SndRxStatsTimerCb(pj_timer_heap_t * th, pj_timer_entry * te);
 
 #ifdef PJ_USE_ASIO
 	static pj_status_t RecCb(void * userData, pjmedia_frame * frame);
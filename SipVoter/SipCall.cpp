@@ -2,8 +2,10 @@
 #include "SipCall.h"
 #include "Exceptions.h"
 #include "SipAgent.h"
-#include "processor.h"
+#include "qidx.h"
 #include "ExtraParamAccId.h"
+#include <vector>
+#include <algorithm>
 
 static pj_str_t gSubjectHdr = { "Subject", 7 };
 static pj_str_t gPriorityHdr = { "Priority", 8 };
@@ -82,21 +84,21 @@ void SetPreferredCodec(int codec)
 {
 	if (codec==0)
 	{
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("PCMA"))), PJMEDIA_CODEC_PRIO_HIGHEST);
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("PCMU"))), PJMEDIA_CODEC_PRIO_NEXT_HIGHER);
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("G728"))), PJMEDIA_CODEC_PRIO_NORMAL);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("PCMA"))), PJMEDIA_CODEC_PRIO_HIGHEST);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("PCMU"))), PJMEDIA_CODEC_PRIO_NEXT_HIGHER);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("G728"))), PJMEDIA_CODEC_PRIO_NORMAL);
 	}
 	else if (codec==1)
 	{
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("PCMA"))), PJMEDIA_CODEC_PRIO_NEXT_HIGHER);
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("PCMU"))), PJMEDIA_CODEC_PRIO_HIGHEST);
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("G728"))), PJMEDIA_CODEC_PRIO_NORMAL);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("PCMA"))), PJMEDIA_CODEC_PRIO_NEXT_HIGHER);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("PCMU"))), PJMEDIA_CODEC_PRIO_HIGHEST);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("G728"))), PJMEDIA_CODEC_PRIO_NORMAL);
 	}
 	else if (codec==2)
 	{
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("PCMA"))), PJMEDIA_CODEC_PRIO_NEXT_HIGHER);
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("PCMU"))), PJMEDIA_CODEC_PRIO_NORMAL);
-		pjsua_codec_set_priority(&(pj_str(const_cast<char*>("G728"))), PJMEDIA_CODEC_PRIO_HIGHEST);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("PCMA"))), PJMEDIA_CODEC_PRIO_NEXT_HIGHER);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("PCMU"))), PJMEDIA_CODEC_PRIO_NORMAL);
+		pjsua_codec_set_priority(StrPtr(pj_str(const_cast<char*>("G728"))), PJMEDIA_CODEC_PRIO_HIGHEST);
 	}
 	else if (codec == 0xFF)
 	{
@@ -107,7 +109,7 @@ void SetPreferredCodec(int codec)
 /** */
 void SipCall::Wg67VersionSet(pjsip_tx_data *txdata, pj_str_t *valor)
 {
-	if (pjsip_msg_find_hdr_by_name(txdata->msg, &pj_str("WG67-Version"), NULL)==NULL) 
+	if (pjsip_msg_find_hdr_by_name(txdata->msg, StrPtr(pj_str("WG67-Version")), NULL)==NULL) 
 	{
 		pjsip_generic_string_hdr *pWg67version = pjsip_generic_string_hdr_create(txdata->pool, &gWG67VersionName, valor);
 		pj_list_push_back(&txdata->msg->hdr, pWg67version);
@@ -119,7 +121,7 @@ void Wg67ReasonSet(pjsip_tx_data *txdata)
 {
 	//pj_str_t *wg67r;
 
-	if (pjsip_msg_find_hdr_by_name(txdata->msg, &pj_str("Reason"), NULL)==NULL) 
+	if (pjsip_msg_find_hdr_by_name(txdata->msg, StrPtr(pj_str("Reason")), NULL)==NULL) 
 	{
 		//wg67r = getWG67ReasonContent();
 		pjsip_generic_string_hdr *pWg67Reason = pjsip_generic_string_hdr_create(txdata->pool, &gWG67ReasonName, getWG67ReasonContent());
@@ -131,7 +133,7 @@ void Wg67ReasonSet(pjsip_tx_data *txdata)
 /** */
 void Wg67ContactSet(pjsip_tx_data *txdata) 
 {
-	if (pjsip_msg_find_hdr_by_name(txdata->msg, &pj_str("Contact"), NULL)==NULL) 
+	if (pjsip_msg_find_hdr_by_name(txdata->msg, StrPtr(pj_str("Contact")), NULL)==NULL) 
 	{
 		pjsip_contact_hdr *contact = pjsip_contact_hdr_create(txdata->pool);
 		contact->uri = (pjsip_uri*)SipAgent::pContacUrl;
@@ -142,7 +144,7 @@ void Wg67ContactSet(pjsip_tx_data *txdata)
 /** */
 void Wg67AllowSet(pjsip_tx_data *txdata)
 {
-	if (pjsip_msg_find_hdr_by_name(txdata->msg, &pj_str("Allow"), NULL)==NULL) 
+	if (pjsip_msg_find_hdr_by_name(txdata->msg, StrPtr(pj_str("Allow")), NULL)==NULL) 
 	{
 		pjsip_allow_hdr *allow = pjsip_allow_hdr_create(txdata->pool);
 		allow->count=0;
@@ -153,7 +155,7 @@ void Wg67AllowSet(pjsip_tx_data *txdata)
 /** */
 void Wg67SupportedSet(pjsip_tx_data *txdata)
 {
-	if (pjsip_msg_find_hdr_by_name(txdata->msg, &pj_str("Supported"), NULL)==NULL) 
+	if (pjsip_msg_find_hdr_by_name(txdata->msg, StrPtr(pj_str("Supported")), NULL)==NULL) 
 	{
 		pjsip_supported_hdr *supported = pjsip_supported_hdr_create(txdata->pool);
 		supported->count=0;
@@ -164,7 +166,7 @@ void Wg67SupportedSet(pjsip_tx_data *txdata)
 /** */
 void Wg67RadioPrioritySet(pjsip_tx_data *txdata) 
 {
-	if (pjsip_msg_find_hdr_by_name(txdata->msg, &pj_str("Priority"), NULL)==NULL) 
+	if (pjsip_msg_find_hdr_by_name(txdata->msg, StrPtr(pj_str("Priority")), NULL)==NULL) 
 	{
 		pjsip_generic_string_hdr *pPriority = pjsip_generic_string_hdr_create(txdata->pool, &gPriorityHdr, &gPriority[2]);
 		pj_list_push_back(&txdata->msg->hdr, pPriority);
@@ -174,7 +176,7 @@ void Wg67RadioPrioritySet(pjsip_tx_data *txdata)
 /** */
 void Wg67RadioSubjectSet(pjsip_tx_data *txdata) 
 {
-	if (pjsip_msg_find_hdr_by_name(txdata->msg, &pj_str("Subject"), NULL)==NULL) 
+	if (pjsip_msg_find_hdr_by_name(txdata->msg, StrPtr(pj_str("Subject")), NULL)==NULL) 
 	{
 		pjsip_generic_string_hdr *pSubject = pjsip_generic_string_hdr_create(txdata->pool, &gSubjectHdr, &gSubject[5]);
 		pj_list_push_back(&txdata->msg->hdr, pSubject);
@@ -232,20 +234,18 @@ SipCall::SipCall(const CORESIP_CallInfo * info, const CORESIP_CallOutInfo * outI
 	_Id = PJSUA_INVALID_ID;
 	_RdSendSock = PJ_INVALID_SOCKET;
 	Retardo = 0;
-	circ_buff_mutex = NULL;
 	p_retbuff = NULL;
 	squ_event = PJ_FALSE;
 	squ_event_mcast = PJ_FALSE;
 	squoff_event_mcast = PJ_FALSE;
 	waited_rtp_seq = 0;
 	hay_retardo = PJ_FALSE;
-	memset(zerobuf, 0, sizeof(zerobuf));
 	index_bss_rx_w = 0;
 	bss_rx_mutex = NULL;
 	RdInfo_prev_mutex = NULL;
-	sem_out_circbuff = NULL;
-	out_circbuff_thread_run = PJ_FALSE;
-	out_circbuff_thread = NULL;
+	out_circbuff_pending = 0;
+	out_circbuff_registered = PJ_FALSE;
+	out_primer_paquete = PJ_TRUE;
 	wait_sem_out_circbuff = PJ_TRUE;
 	_EnviarQidx = PJ_FALSE;
 	primer_paquete_despues_squelch = PJ_TRUE;
@@ -258,7 +258,7 @@ SipCall::SipCall(const CORESIP_CallInfo * info, const CORESIP_CallOutInfo * outI
 	b_dc[1] = -0.9975f;
 	fFiltroDC_IfRx_ciX = 0.0f;
 	fFiltroDC_IfRx_ciY = 0.0f;
-	processor_init(&PdataQidx, 0);
+	qidx_init(&PdataQidx, 0);
 
 	try
 	{			
@@ -315,7 +315,7 @@ SipCall::SipCall(const CORESIP_CallInfo * info, const CORESIP_CallOutInfo * outI
 
 		if (outInfo->ReferBy[0] != 0)
 		{
-			pjsip_generic_string_hdr_init2(&make_call_params.referBy, &gReferBy, &(pj_str(const_cast<char*>(outInfo->ReferBy))));
+			pjsip_generic_string_hdr_init2(&make_call_params.referBy, &gReferBy, StrPtr(pj_str(const_cast<char*>(outInfo->ReferBy))));
 			pj_list_push_back(&make_call_params.msg_data.hdr_list, &make_call_params.referBy);
 		}
 
@@ -325,7 +325,7 @@ SipCall::SipCall(const CORESIP_CallInfo * info, const CORESIP_CallOutInfo * outI
 				strlen(outInfo->ToTag)+strlen(";early-only")) < (sizeof(make_call_params.repl)/sizeof(char)))
 			{
 				//nos aseguramos que cabe en el array
-				pjsip_generic_string_hdr_init2(&make_call_params.require, &gRequire, &(pj_str("replaces")));
+				pjsip_generic_string_hdr_init2(&make_call_params.require, &gRequire, StrPtr(pj_str("replaces")));
 				pj_list_push_back(&make_call_params.msg_data.hdr_list, &make_call_params.require);	
 
 				strcpy(make_call_params.repl, outInfo->CallIdToReplace);
@@ -380,7 +380,7 @@ SipCall::SipCall(const CORESIP_CallInfo * info, const CORESIP_CallOutInfo * outI
 					PJ_LOG(3,(__FILE__, "ERROR: setsockopt, PJ_IP_MULTICAST_IF. El envio de audio a %s:%d no se puede forzar por el interface %s", 
 						outInfo->RdMcastAddr, outInfo->RdMcastPort, SipAgent::Get_uaIpAdd()));
 						
-				pj_sockaddr_in_init(&_RdSendTo, &(pj_str(const_cast<char*>(outInfo->RdMcastAddr))), (pj_uint16_t)outInfo->RdMcastPort);
+				pj_sockaddr_in_init(&_RdSendTo, StrPtr(pj_str(const_cast<char*>(outInfo->RdMcastAddr))), (pj_uint16_t)outInfo->RdMcastPort);
 			}
 		}
 
@@ -395,13 +395,8 @@ SipCall::SipCall(const CORESIP_CallInfo * info, const CORESIP_CallOutInfo * outI
 
 		if (_Info.Type == CORESIP_CALL_RD)
 		{
-			st = pj_mutex_create_simple(_Pool, "CircBuffMtx", &circ_buff_mutex);
-			PJ_CHECK_STATUS(st, ("ERROR creando mutex para buffer circular"));
-
-			//st = pjmedia_circ_buf_create(_Pool, 16384*8, &p_retbuff);
-			st = pjmedia_circ_buf_create(_Pool, 4096*2, &p_retbuff);
-			PJ_CHECK_STATUS(st, ("ERROR Creando buffer circular"));	
-			pjmedia_circ_buf_reset(p_retbuff);	
+			//Lo escribe el thread de recepcion RTP y lo lee el de SipAgent::_McastScheduler
+			p_retbuff = new AudioRing(_Pool, 4096*2);
 			
 			st = pj_mutex_create_simple(_Pool, "bss_rx_mutex", &bss_rx_mutex);
 			PJ_CHECK_STATUS(st, ("ERROR creando mutex bss_rx_mutex"));
@@ -410,12 +405,11 @@ SipCall::SipCall(const CORESIP_CallInfo * info, const CORESIP_CallOutInfo * outI
 			//es el primero que se activa y si est� en un grupo bss
 			pj_timer_entry_init( &window_timer, 0, (void *) this, window_timer_cb);
 
-			st = pj_sem_create(_Pool, "sem_out_circbuff", 0, 10, &sem_out_circbuff);
-			PJ_CHECK_STATUS(st, ("ERROR creando sem_out_circbuff"));
-
-			out_circbuff_thread_run = PJ_TRUE;
-			st = pj_thread_create(_Pool, "Out_circbuff_Th", &Out_circbuff_Th, this, 0, 0, &out_circbuff_thread);
-			PJ_CHECK_STATUS(st, ("ERROR creando thread out_circbuff_thread"));			
+			//El envio multicast del buffer circular lo hace el thread comun de SipAgent::_McastScheduler
+			if (SipAgent::_McastScheduler != NULL && SipAgent::_McastScheduler->Add(this) == 0)
+			{
+				out_circbuff_registered = PJ_TRUE;
+			}
 		}
 		else
 		{
@@ -432,7 +426,7 @@ SipCall::SipCall(const CORESIP_CallInfo * info, const CORESIP_CallOutInfo * outI
 		if (info->Type != CORESIP_CALL_RD)
 		{
 			SipAgent::RecINVTel();
-			SipAgent::RecCallStart(SipAgent::OUTCOM, info->Priority, &info_acc.acc_uri, &pj_str(const_cast<char*>(outInfo->DstUri)));
+			SipAgent::RecCallStart(SipAgent::OUTCOM, info->Priority, &info_acc.acc_uri, StrPtr(pj_str(const_cast<char*>(outInfo->DstUri))));
 		}
 		else
 		{
@@ -483,8 +477,9 @@ SipCall::SipCall(pjsua_call_id call_id, const CORESIP_CallInfo * info)
 	squ_event_mcast = PJ_FALSE;	
 	squoff_event_mcast = PJ_FALSE;
 	Retardo = 0;
-	out_circbuff_thread = NULL;
-	out_circbuff_thread_run = PJ_FALSE;
+	out_circbuff_pending = 0;
+	out_circbuff_registered = PJ_FALSE;
+	out_primer_paquete = PJ_TRUE;
 	p_retbuff = NULL;
 	wait_sem_out_circbuff = PJ_FALSE;
 	_Sending_Multicast_enabled = PJ_FALSE;
@@ -493,8 +488,6 @@ SipCall::SipCall(pjsua_call_id call_id, const CORESIP_CallInfo * info)
 	pj_timer_entry_init( &Wait_init_timer, 0, NULL, Wait_init_timer_cb);
 	pj_timer_entry_init( &Ptt_off_timer, 0, NULL, Ptt_off_timer_cb);
 	pj_timer_entry_init( &Wait_fin_timer, 0, NULL, Wait_fin_timer_cb);
-	sem_out_circbuff = NULL;
-	circ_buff_mutex = NULL;
 	bss_rx_mutex = NULL;
 	bss_method_type = NINGUNO;
 	pj_status_t st = pj_mutex_create_simple(_Pool, "RdInfo_prev_mutex", &RdInfo_prev_mutex);
@@ -512,7 +505,7 @@ SipCall::SipCall(pjsua_call_id call_id, const CORESIP_CallInfo * info)
 	b_dc[1] = -0.9975f;
 	fFiltroDC_IfRx_ciX = 0.0f;
 	fFiltroDC_IfRx_ciY = 0.0f;
-	processor_init(&PdataQidx, 0);
+	qidx_init(&PdataQidx, 0);
 }
 
 /**
@@ -548,25 +541,17 @@ void SipCall::Dispose()
 	window_timer.id = 0;
 	pjsua_cancel_timer(&window_timer);
 
-	if (out_circbuff_thread != NULL && sem_out_circbuff != NULL)
+	if (out_circbuff_registered)
 	{
-		out_circbuff_thread_run = PJ_FALSE;
-		pj_sem_post(sem_out_circbuff);
-		pj_thread_join(out_circbuff_thread);
-		pj_thread_destroy(out_circbuff_thread);
-		out_circbuff_thread = NULL;		
+		//Al retornar Remove el thread de envio ya no esta atendiendo esta sesion
+		if (SipAgent::_McastScheduler != NULL) SipAgent::_McastScheduler->Remove(this);
+		out_circbuff_registered = PJ_FALSE;
 	}
 
-	if (sem_out_circbuff != NULL)
+	if (p_retbuff != NULL)
 	{
-		pj_sem_destroy(sem_out_circbuff);
-		sem_out_circbuff = NULL;
-	}
-
-	if (circ_buff_mutex != NULL)
-	{
-		pj_mutex_destroy(circ_buff_mutex);
-		circ_buff_mutex = NULL;
+		delete p_retbuff;
+		p_retbuff = NULL;
 	}
 
 	if (_RdSendSock != PJ_INVALID_SOCKET)
@@ -592,7 +577,7 @@ void SipCall::Dispose()
 
 int SipCall::Hacer_la_llamada_saliente()
 {
-	pj_status_t st = pjsua_call_make_call(make_call_params.acc_id, &(pj_str(const_cast<char*>(make_call_params.dst_uri))), 
+	pj_status_t st = pjsua_call_make_call(make_call_params.acc_id, StrPtr(pj_str(const_cast<char*>(make_call_params.dst_uri))), 
 			make_call_params.options, this, &make_call_params.msg_data, &_Id);	
 	if (st != PJ_SUCCESS)
 	{
@@ -944,7 +929,7 @@ void SipCall::Hangup(pjsua_call_id call_id, unsigned code)
 		strcpy(str_reason_val, "SIP;cause=");
 		char str_code[8];
 		pj_utoa((unsigned long) code, str_code);
-		strncat(str_reason_val, str_code, sizeof(str_reason_val) / sizeof(char));
+		strncat(str_reason_val, str_code, (sizeof(str_reason_val) / sizeof(char)) - strlen(str_reason_val) - 1);
 		str_reason_val[(sizeof(str_reason_val) / sizeof(char))-1] = '\0';
 		pj_str_t reason_val = pj_str(str_reason_val);
 		pjsip_generic_string_hdr_init2(&reason_hdr, &reason, &reason_val);
@@ -1195,14 +1180,14 @@ void SipCall::Transfer(pjsua_call_id call_id, pjsua_call_id dest_call_id, const
 
 	/*pj_status_t st = (dest_call_id != PJSUA_INVALID_ID) ?
 	pjsua_call_xfer_replaces(call_id, dest_call_id, 0, NULL) :
-	pjsua_call_xfer(call_id, &(pj_str(const_cast<char*>(dst))), NULL);
+	pjsua_call_xfer(call_id, StrPtr(pj_str(const_cast<char*>(dst))), NULL);
 	PJ_CHECK_STATUS(st, ("ERROR en transferencia de llamada", "[Call=%d][DstCall=%d] [dst=%s]", call_id, dest_call_id, dst));*/
 
 	pj_status_t st;
 	if (dest_call_id != PJSUA_INVALID_ID) 
 		st = pjsua_call_xfer_replaces_dispname(call_id, dest_call_id, (char *) referto_display_name, 0, NULL);
 	else
-		st = pjsua_call_xfer(call_id, &(pj_str(const_cast<char*>(dst))), NULL);
+		st = pjsua_call_xfer(call_id, StrPtr(pj_str(const_cast<char*>(dst))), NULL);
 	PJ_CHECK_STATUS(st, ("ERROR en transferencia de llamada", "[Call=%d][DstCall=%d] [dst=%s]", call_id, dest_call_id, dst));
 }
 
@@ -1211,35 +1196,129 @@ void SipCall::Transfer(pjsua_call_id call_id, pjsua_call_id dest_call_id, const
 */
 void SipCall::Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info)
 {
-	if (call_id<0 || call_id>(int)pjsua_var.ua_cfg.max_calls)
+	GroupPtt(&call_id, 1, info);
+}
+
+/**
+ * GroupPtt.	...
+ * Aplica el mismo estado de PTT a varias llamadas, por ejemplo los transmisores principal y reserva o los
+ * emplazamientos climax de una frecuencia. Se toman los dialogos de todas, en orden de call_id para que dos
+ * llamadas simultaneas no se bloqueen entre si, se actualiza la extension de cabecera de cada stream y despues
+ * se envian seguidos los paquetes con el cambio. El desfase entre transmisores queda en lo que tardan esos envios.
+ * Si alguna llamada falla se aplica a las demas y se lanza la excepcion al final.
+ * @param	call_ids	Llamadas.
+ * @param	count		Numero de llamadas.
+ * @param	info		Estado de PTT.
+ */
+void SipCall::GroupPtt(const pjsua_call_id * call_ids, int count, const CORESIP_PttInfo * info)
+{
+	if (count <= 0)
 	{
-		throw PJLibException(__FILE__, PJ_EINVAL).Msg("Ptt:", "call_id %d no valido", call_id);		
+		throw PJLibException(__FILE__, PJ_EINVAL).Msg("Ptt:", "Numero de llamadas %d no valido", count);
 	}
 
-	pj_uint32_t rtp_ext_info = 0;
-	pj_uint32_t rtp_ext_info_prev = 0;
-	pj_uint8_t cld = 0;
+	std::vector<pjsua_call_id> ids(call_ids, call_ids + count);
+	for (int i = 0; i < count; i++)
+	{
+		if (ids[i]<0 || ids[i]>=(int)pjsua_var.ua_cfg.max_calls)
+		{
+			throw PJLibException(__FILE__, PJ_EINVAL).Msg("Ptt:", "call_id %d no valido", ids[i]);		
+		}
+	}
 
-	pjsua_call * call1;
-	pjsip_dialog * dlg1;
-	pj_status_t status = acquire_call("Ptt()", call_id, &call1, &dlg1);
-	PJ_CHECK_STATUS(status, ("ERROR adquiriendo call", "[Call=%d]", call_id));
+	if (info->PttType == CORESIP_PTT_OFF && info->PttMute)
+	{
+		throw PJLibException(__FILE__, PJ_EINVAL).Msg("Ptt:", "ERROR: Ptt Mute no puede activarse con PTT OFF. call_id %d", ids[0]);
+	}
 
-	SipCall * call = (SipCall*)call1->user_data;
+	//Una llamada repetida se trata una sola vez. Con los call_id ya comprobados quedan como mucho max_calls
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+	std::vector<pjsip_dialog *> dlgs;
+	std::vector<pjmedia_stream *> edges;
+	std::vector<pj_bool_t> forzar_KA;
+	dlgs.reserve(ids.size());
+	edges.reserve(ids.size());
+	forzar_KA.reserve(ids.size());
+
+	pj_status_t status = PJ_SUCCESS;
+	pjsua_call_id status_call = PJSUA_INVALID_ID;
+	const char * status_info = NULL;
 
-	pjsua_call_info call_info;
-	if (pjsua_call_get_info(call_id, &call_info) != PJ_SUCCESS)
+	for (unsigned i = 0; i < ids.size(); i++)
 	{
-		pjsip_dlg_dec_lock(dlg1);
-		throw PJLibException(__FILE__, PJ_EINVAL).Msg("Ptt:", "ERROR: No se puede obtener call_info. call_id %d", call_id);		
-		return;
+		pjsua_call * call1;
+		pjsip_dialog * dlg1;
+		pj_status_t st = acquire_call("Ptt()", ids[i], &call1, &dlg1);
+		if (st != PJ_SUCCESS)
+		{
+			status = st;
+			status_call = ids[i];
+			status_info = "ERROR adquiriendo call";
+			continue;
+		}
+		dlgs.push_back(dlg1);
+
+		pjmedia_stream * stream = NULL;
+		pj_bool_t forzar = PJ_FALSE;
+		st = SetPtt(ids[i], call1, info, &stream, &forzar);
+		if (st != PJ_SUCCESS)
+		{
+			status = st;
+			status_call = ids[i];
+			status_info = "ERROR en Ptt_off_timer";
+		}
+		if (stream != NULL)
+		{
+			edges.push_back(stream);
+			forzar_KA.push_back(forzar);
+		}
 	}
 
-	pjmedia_session* session = pjsua_call_get_media_session(call_id);
+	//El cambio sale ya en un keep-alive fuera del tick, sin esperar al siguiente paquete de audio o keep-alive.
+	//Si el stream no puede enviarlo se fuerza el keep-alive en el siguiente tick
+	for (unsigned i = 0; i < edges.size(); i++)
+	{
+		if (pjmedia_stream_send_KA_packet_now(edges[i]) != PJ_SUCCESS && forzar_KA[i])
+		{
+			pjmedia_stream_force_send_KA_packet(edges[i]);
+		}
+	}
+
+	for (unsigned i = 0; i < dlgs.size(); i++)
+	{
+		pjsip_dlg_dec_lock(dlgs[i]);
+	}
+
+	PJ_CHECK_STATUS(status, (status_info, "[Call=%d]", status_call));
+}
+
+/**
+ * SetPtt.	...
+ * Cambia el estado de PTT de una llamada. Se llama con el dialogo tomado.
+ * @param	call_id		Llamada.
+ * @param	call1		Llamada de pjsua.
+ * @param	info		Estado de PTT.
+ * @param	edge		Stream por el que hay que enviar ya el cambio, o NULL si no hace falta.
+ * @param	forzar_KA	Si el stream no puede enviar el cambio ya, hay que forzar el keep-alive del siguiente tick.
+ * @return	PJ_SUCCESS, o el error al arrancar Ptt_off_timer.
+ */
+pj_status_t SipCall::SetPtt(pjsua_call_id call_id, pjsua_call * call1, const CORESIP_PttInfo * info, pjmedia_stream ** edge, pj_bool_t * forzar_KA)
+{
+	pj_uint32_t rtp_ext_info = 0;
+	pj_uint32_t rtp_ext_info_prev = 0;
+	pj_status_t status = PJ_SUCCESS;
+
+	*edge = NULL;
+	*forzar_KA = PJ_FALSE;
+
+	SipCall * call = (SipCall*)call1->user_data;
+
+	pjmedia_session* session = call1->session;
 	if (session == NULL) 
 	{
-		pjsip_dlg_dec_lock(dlg1);
-		return; 
+		return PJ_SUCCESS; 
 	}
 
 	pjmedia_stream * stream = NULL;
@@ -1255,20 +1334,13 @@ void SipCall::Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info)
 
 	unsigned int PttType_prev = (unsigned int) PJMEDIA_RTP_RD_EX_GET_PTT_TYPE(rtp_ext_info_prev);
 	unsigned int PttMute_prev = (unsigned int) PJMEDIA_RTP_RD_EX_GET_PM(rtp_ext_info_prev);
+	unsigned int Squ_prev = (unsigned int) PJMEDIA_RTP_RD_EX_GET_SQU(rtp_ext_info_prev);
 	unsigned int PttMute = info->PttMute ? 1 : 0;
 
-	if (info->PttType == CORESIP_PTT_OFF && PttMute)
-	{
-		pjsip_dlg_dec_lock(dlg1);
-		throw PJLibException(__FILE__, PJ_EINVAL).Msg("Ptt:", "ERROR: Ptt Mute no puede activarse con PTT OFF. call_id %d", call_id);
-		PttMute = 0;
-		return;
-	}
-
 	PJMEDIA_RTP_RD_EX_SET_PM(rtp_ext_info, PttMute);	
 
 	pj_bool_t rdAccount = PJ_FALSE;				//Indica si acc_id es un account tipo radio GRS
-	ExtraParamAccId *extraParamAccCfg = (ExtraParamAccId *) pjsua_acc_get_user_data(call_info.acc_id);
+	ExtraParamAccId *extraParamAccCfg = (ExtraParamAccId *) pjsua_acc_get_user_data(call1->acc_id);
 	if (extraParamAccCfg != NULL)
 	{
 		rdAccount = extraParamAccCfg->rdAccount;
@@ -1353,7 +1425,7 @@ void SipCall::Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info)
 			if (st != PJ_SUCCESS)
 			{
 				call->Ptt_off_timer.id = 0;
-				PJ_CHECK_STATUS(st, ("ERROR en Ptt_off_timer"));
+				status = st;
 			}
 		}
 		else if (call->Ptt_off_timer.id != 0)
@@ -1366,7 +1438,7 @@ void SipCall::Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info)
 			if (st != PJ_SUCCESS)
 			{
 				call->Ptt_off_timer.id = 0;
-				PJ_CHECK_STATUS(st, ("ERROR en Ptt_off_timer"));
+				status = st;
 			}
 		}			
 	}
@@ -1375,7 +1447,7 @@ void SipCall::Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info)
 	{
 		pjmedia_stream_set_rtp_ext_tx_info(stream, rtp_ext_info);
 
-		pj_bool_t forzar_KA = PJ_FALSE;
+		pj_bool_t forzar = PJ_FALSE;
 
 		if (PttMute_prev != PttMute)
 		{
@@ -1387,7 +1459,7 @@ void SipCall::Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info)
 			else 
 			{
 				//Forzamos el envio de un keep alive si el estado de Ptt Mute cambia en cualquier otro caso
-				forzar_KA = PJ_TRUE;
+				forzar = PJ_TRUE;
 			}
 		}
 
@@ -1397,7 +1469,7 @@ void SipCall::Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info)
 			CORESIP_CallFlags flags = call->_Info.Flags;
 			if ((flags & CORESIP_CALL_RD_RXONLY) && (info->PttType != PttType_prev)) 
 			{
-				forzar_KA = PJ_TRUE;
+				forzar = PJ_TRUE;
 			}
 		}
 
@@ -1408,14 +1480,18 @@ void SipCall::Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info)
 			if (info->PttType != PttType_prev)
 			{
 				//Somos un agente radio y el PTT ha cambiado de estado. Tenemos que enviar un keepalive invemdiatamente
-				forzar_KA = PJ_TRUE;
+				forzar = PJ_TRUE;
 			}
 		}
 
-		if (forzar_KA) pjmedia_stream_force_send_KA_packet(stream);
+		if (info->PttType != PttType_prev || (info->Squ ? 1 : 0) != Squ_prev || forzar)
+		{
+			*edge = stream;
+			*forzar_KA = forzar;
+		}
 	}
 
-	pjsip_dlg_dec_lock(dlg1);
+	return status;
 }
 
 /**
@@ -1566,7 +1642,7 @@ void SipCall::SendInfoMsg(pjsua_call_id call_id, const char * info)
 */
 void SipCall::TransferAnswer(const char * tsxKey, void * txData, void * evSub, unsigned code)
 {
-	pj_status_t st = pjsua_call_transfer_answer(code, &(pj_str(const_cast<char*>(tsxKey))), 
+	pj_status_t st = pjsua_call_transfer_answer(code, StrPtr(pj_str(const_cast<char*>(tsxKey))), 
 		(pjsip_tx_data*)txData, (pjsip_evsub*)evSub);
 	PJ_CHECK_STATUS(st, ("ERROR en respuesta a peticion de transferencia"));
 }
@@ -1764,23 +1840,22 @@ void SipCall::OnRdRtp(void * stream, void * frame, void * codec, unsigned seq, p
 		//assert((sipCall->_Info.Flags & CORESIP_CALL_RD_TXONLY) == 0);
 
 		pj_ssize_t size = 0;
-		char buf[1500];
+		pj_int16_t pcm_buf[SAMPLES_PER_FRAME];
+		char *buf = (char *) pcm_buf;
 
 		if (frame)
 		{
-			pjmedia_codec * cdc = (pjmedia_codec*)codec;
 			pjmedia_frame frame_out;
 
-			frame_out.buf = buf;
-			frame_out.size = sizeof(buf);
+			frame_out.buf = pcm_buf;
+			frame_out.size = sizeof(pcm_buf);
 
-			pj_status_t st = cdc->op->decode(cdc, frame_in, (unsigned)frame_out.size, PJ_FALSE, &frame_out);
+			//El stream guarda las muestras decodificadas y no vuelve a decodificar el frame al sacarlo del jitter buffer.
+			//Si no puede guardarlas decodifica en pcm_buf
+			pj_status_t st = pjmedia_stream_decode_rx_frame((pjmedia_stream*)stream, frame_in, seq, &frame_out);
+			buf = (char *) frame_out.buf;
 			if ((st == PJ_SUCCESS) && (frame_out.size == (SAMPLES_PER_FRAME/2) * sizeof(pj_int16_t)))
 			{
-				int x = PJMEDIA_RTP_RD_EX_GET_X(rtp_ext_info);
-				pj_uint32_t type = PJMEDIA_RTP_RD_EX_GET_TYPE(rtp_ext_info);
-				pj_uint32_t length = PJMEDIA_RTP_RD_EX_GET_LENGTH(rtp_ext_info);
-
 				if (sipCall->squ_event_mcast)
 				{
 					//Es el primer paquete que se recibe despu�s de que el primer squelch del grupo se ha activado
@@ -1806,16 +1881,13 @@ void SipCall::OnRdRtp(void * stream, void * frame, void * codec, unsigned seq, p
 						pj_uint8_t qidx_value_rtp = 0;
 						pj_uint8_t qidx_method_rtp = 0;
 						pj_bool_t qidx_received_by_rtp = PJ_FALSE;
-						if (x && type == 0x1 && length == 1)
+						pjmedia_rtp_ed137_ext ext;
+						pjmedia_rtp_ed137_decode(&ext, PJMEDIA_RTP_ED137_PROFILE, &rtp_ext_info, 1);
+						if (ext.present & PJMEDIA_RTP_ED137_BSS)
 						{
 							//Si recibimos el QIDX por el rtp lo tomamos.
-
-							qidx_value_rtp = (pj_uint8_t) PJMEDIA_RTP_RD_EX_GET_VALUE(rtp_ext_info);
-
-							qidx_method_rtp = qidx_value_rtp;
-							qidx_method_rtp &= 0x7;
-							qidx_value_rtp >>= 3;
-							qidx_value_rtp &= 0x1F;
+							qidx_value_rtp = ext.bss_qidx;
+							qidx_method_rtp = ext.bss_method;
 							qidx_received_by_rtp = PJ_TRUE;		
 						}
 
@@ -1873,9 +1945,11 @@ void SipCall::OnRdRtp(void * stream, void * frame, void * codec, unsigned seq, p
 
 									iir(sipCall->fPdataQidx, sipCall->afMuestrasIfRx, sipCall->b_dc, sipCall->a_dc, &sipCall->fFiltroDC_IfRx_ciX, &sipCall->fFiltroDC_IfRx_ciY, 1, frame_out.size/2);	//Filtro para eliminar la continua							
 							
-									process(&sipCall->PdataQidx, sipCall->afMuestrasIfRx, frame_out.size/2);
+									//El Qidx de cada sesion se calcula aqui, con el paquete que completa el bloque, porque bss_rx
+									//guarda el valor de cada paquete. Agruparlo por grupo obligaria a esperar a las otras sesiones.
+									qidx_process(&sipCall->PdataQidx, sipCall->afMuestrasIfRx, frame_out.size/2);
 
-									centralized_qidx_value = (pj_uint32_t) quality_indicator(&sipCall->PdataQidx);				//Escala 0-50				
+									centralized_qidx_value = (pj_uint32_t) qidx_quality_indicator(&sipCall->PdataQidx);				//Escala 0-50				
 									centralized_qidx_value = (centralized_qidx_value * MAX_QIDX_ESCALE) / MAX_CENTRAL_ESCALE;		//Lo transformamos a escala 0- 15 (RSSI)																
 									calculado_internamente = PJ_TRUE;
 								
@@ -1925,27 +1999,22 @@ void SipCall::OnRdRtp(void * stream, void * frame, void * codec, unsigned seq, p
 						}
 					}
 
-					pj_mutex_lock(sipCall->circ_buff_mutex);
-
 					if (sipCall->squ_event)
 					{
-						//Se a�aden tantos silencios como valor de Retardo
-						pjmedia_circ_buf_reset(sipCall->p_retbuff);
-						while (pj_sem_trywait(sipCall->sem_out_circbuff) == PJ_SUCCESS);
+						//Se descarta lo pendiente y el thread de envio lee tantos silencios como valor de Retardo
+						sipCall->p_retbuff->Restart(sipCall->Retardo);
+						sipCall->out_circbuff_pending = 0;
 						sipCall->wait_sem_out_circbuff = PJ_TRUE;
-						for (pj_uint32_t i = 0; i < sipCall->Retardo; i++)
-						{	
-							pjmedia_circ_buf_write(sipCall->p_retbuff, (pj_int16_t *) sipCall->zerobuf, 1);
-						}						
 					}
 
 					//Se a�ade al buffer circular el frame													
 						
-					pjmedia_circ_buf_write(sipCall->p_retbuff, (pj_int16_t *) buf, frame_out.size/2);
-
-					pj_mutex_unlock(sipCall->circ_buff_mutex);
+					sipCall->p_retbuff->Write((pj_int16_t *) buf, frame_out.size/2);
+					unsigned pending = sipCall->out_circbuff_pending.load();
+					while (pending < MAX_OUT_CIRCBUFF_PENDING &&
+						!sipCall->out_circbuff_pending.compare_exchange_weak(pending, pending + 1));
 
-					pj_sem_post(sipCall->sem_out_circbuff);				
+					if (SipAgent::_McastScheduler) SipAgent::_McastScheduler->Signal();
 				}
 
 				sipCall->squ_event = PJ_FALSE;
@@ -1973,7 +2042,6 @@ void SipCall::OnRdInfoChanged(void * stream, void *ext_type_length, pj_uint32_t
 {		
 	void * session = pjmedia_stream_get_user_data((pjmedia_stream*)stream);
 	void * call = pjmedia_session_get_user_data((pjmedia_session*)session);
-	pjmedia_rtp_ext_hdr *extention_type_length = (pjmedia_rtp_ext_hdr *) ext_type_length;
 
 	if (!call) return;
 
@@ -1993,94 +2061,55 @@ void SipCall::OnRdInfoChanged(void * stream, void *ext_type_length, pj_uint32_t
 	
 	//PJ_LOG(5,(__FILE__, "BSS: SQU info.Squelch %d FR %s %s", info.Squelch, sipCall->_RdFr, sipCall->DstUri));
 
-	pj_bool_t ext_type_WG67;
-	if (extention_type_length != NULL)
-	{
-		if ((extention_type_length->profile_data & 0xFF00) == 0x6700)
-		{
-			//La extension del cabecera es del tipo ED137 EUROCAE WG67
-			ext_type_WG67 = PJ_TRUE;
-		}
-		else
-		{
-			ext_type_WG67 = PJ_FALSE;
-		}
-	}
-	else
+	//La extension de cabecera ya la ha decodificado el stream. Los TLVs solo se decodifican si es
+	//del tipo ED137 EUROCAE WG67
+	pjmedia_rtp_ed137_ext ext;
+	pjmedia_stream_get_rx_rtp_ext((pjmedia_stream*)stream, &ext, NULL);
+
+	if (ext.truncated)
 	{
-		ext_type_WG67 = PJ_FALSE;
+		PJ_LOG(3,(__FILE__, "WARNING: Recibida extension de cabecera RTP erronea. rtp_ext_length %d", rtp_ext_length));
 	}
 
-	int x = PJMEDIA_RTP_RD_EX_GET_X(rtp_ext_info);
-	pj_uint8_t *pextinfo = (pj_uint8_t *) p_rtp_ext_info;
-	pextinfo += 2;		//Se pone el puntero donde comienzan las caracteristicas adicionales
-	pj_int32_t nbytes = (pj_int32_t) (rtp_ext_length * 4);
-	nbytes -= 2;
-
-	while (ext_type_WG67 && x && nbytes > 0)
+	if ((ext.present & PJMEDIA_RTP_ED137_MAM) && sipCall->_Info.cld_supervision_time != 0)
 	{
-		//Se tratan los TLVs	
-		pj_uint32_t type, length;
-		type = *pextinfo >> 4;
-		type &= 0xF;
-		length = *pextinfo;
-		length &= 0xF;
+		//MAM recibido
+		//Si cld_supervision_time es 0, entonces ignoramos el MAM. No queremos supervision de CLD
 
-		if (rtp_ext_length == 1 && length > 1)
-			PJ_LOG(3,(__FILE__, "WARNING: Recibida extension de cabecera RTP erronea. rtp_ext_length %d type %d length %d", rtp_ext_length, type, length));
+		PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay  radio uri %s", sipCall->DstUri));
+		pj_bool_t request_MAM = PJ_FALSE;
+		int ret = SipAgent::_FrecDesp->SetTimeDelay((pjmedia_stream*) stream, info.PttType, sipCall->_Index_group, sipCall->_Index_sess, &ext.mam, &request_MAM);
 
-		pextinfo++;
-		if (--nbytes == 0) break;
+		pj_time_val	delay;
+		sipCall->Check_CLD_timer.id = Check_CLD_timer_IDLE;
+		pjsua_cancel_timer(&sipCall->Check_CLD_timer);
 
-		if (type == 0x4 && length == 12 && sipCall->_Info.cld_supervision_time != 0)
+		if ((ret < 0) && request_MAM)
 		{
-			//MAM recibido
-			//Si cld_supervision_time es 0, entonces ignoramos el MAM. No queremos supervision de CLD
-
-			PJ_LOG(5,(__FILE__, "CLIMAX: SetTimeDelay  radio uri %s", sipCall->DstUri));
-			pj_bool_t request_MAM = PJ_FALSE;
-			int ret = SipAgent::_FrecDesp->SetTimeDelay((pjmedia_stream*) stream, info.PttType, sipCall->_Index_group, sipCall->_Index_sess, pextinfo, &request_MAM);
-
-			pj_time_val	delay;
-			sipCall->Check_CLD_timer.id = Check_CLD_timer_IDLE;
-			pjsua_cancel_timer(&sipCall->Check_CLD_timer);
-
-			if ((ret < 0) && request_MAM)
-			{
-				delay.sec = 0;
-				delay.msec = 3;
-				pj_timer_entry_init( &sipCall->Check_CLD_timer, Check_CLD_timer_SEND_RMM, (void *) sipCall, Check_CLD_timer_cb);
-			}
-			else if (ret < 0)
-			{
-				PJ_LOG(3,(__FILE__, "ERROR: Time Delay cannot be assigned to session %p\n", session));
-				//Se reintentará mandando un nuevo rmm despues del periodo de supervisión del cld				
-				delay.sec = (long) sipCall->_Info.cld_supervision_time;
-				delay.msec = 0;
-				pj_timer_entry_init( &sipCall->Check_CLD_timer, Check_CLD_timer_SEND_RMM, (void *) sipCall, Check_CLD_timer_cb);
-			}			
-			else 
-			{
-				//Forzamos a enviar el CLD cuanto antes
-				delay.sec = 0;
-				delay.msec = 3;
-				pj_timer_entry_init( &sipCall->Check_CLD_timer, Check_CLD_timer_SEND_CLD, (void *) sipCall, Check_CLD_timer_cb);
-			}		
-			pj_status_t st = pjsua_schedule_timer(&sipCall->Check_CLD_timer, &delay);
-			if (st != PJ_SUCCESS)
-			{
-				sipCall->Check_CLD_timer.id = Check_CLD_timer_IDLE;
-				PJ_CHECK_STATUS(st, ("ERROR en Check_CLD_timer"));
-			}
-			
+			delay.sec = 0;
+			delay.msec = 3;
+			pj_timer_entry_init( &sipCall->Check_CLD_timer, Check_CLD_timer_SEND_RMM, (void *) sipCall, Check_CLD_timer_cb);
 		}
-
-		pextinfo += length;
-		nbytes -= length;
-
-		if (nbytes < 0)
+		else if (ret < 0)
+		{
+			PJ_LOG(3,(__FILE__, "ERROR: Time Delay cannot be assigned to session %p\n", session));
+			//Se reintentará mandando un nuevo rmm despues del periodo de supervisión del cld				
+			delay.sec = (long) sipCall->_Info.cld_supervision_time;
+			delay.msec = 0;
+			pj_timer_entry_init( &sipCall->Check_CLD_timer, Check_CLD_timer_SEND_RMM, (void *) sipCall, Check_CLD_timer_cb);
+		}			
+		else 
 		{
-			PJ_LOG(5,(__FILE__, "WARNING: Recibida extension de cabecera RTP erronea. rtp_ext_length %d type %d length %d", rtp_ext_length, type, length));
+			//Forzamos a enviar el CLD cuanto antes
+			delay.sec = 0;
+			delay.msec = 3;
+			pj_timer_entry_init( &sipCall->Check_CLD_timer, Check_CLD_timer_SEND_CLD, (void *) sipCall, Check_CLD_timer_cb);
+		}		
+		pj_status_t st = pjsua_schedule_timer(&sipCall->Check_CLD_timer, &delay);
+		if (st != PJ_SUCCESS)
+		{
+			sipCall->Check_CLD_timer.id = Check_CLD_timer_IDLE;
+			PJ_CHECK_STATUS(st, ("ERROR en Check_CLD_timer"));
 		}
 	}
 
@@ -2285,15 +2314,11 @@ void SipCall::OnRdInfoChanged(void * stream, void *ext_type_length, pj_uint32_t
 			}
 
 			sipCall->squoff_event_mcast = PJ_TRUE;
-			pj_sem_post(sipCall->sem_out_circbuff);		//Al salir del wait de este semaforo con el flag squoff_event_mcast
-														//nos indica que fin de squelch y no esperar con el semaforo sino con el sleep
+			//Con el flag squoff_event_mcast el thread de envio pasa a atender esta sesion cada PTIME/2
+			//en lugar de por cada paquete recibido
+			if (SipAgent::_McastScheduler) SipAgent::_McastScheduler->Signal();
 			//Al desactivarse  el squelch se ponen silencios en buffer circular
-			pj_mutex_lock(sipCall->circ_buff_mutex);
-			for (pj_uint32_t i = 0; i < 6; i++)
-			{						
-				pjmedia_circ_buf_write(sipCall->p_retbuff, (pj_int16_t *) sipCall->zerobuf, size/2);
-			}						
-			pj_mutex_unlock(sipCall->circ_buff_mutex);
+			sipCall->p_retbuff->WriteZeros(6 * (size/2));
 					
 		}		
 
@@ -2385,64 +2410,44 @@ void SipCall::window_timer_cb(pj_timer_heap_t *th, pj_timer_entry *te)
 	}
 }
 
-int SipCall::Out_circbuff_Th(void *proc)
+/**
+ * Out_circbuff_Process.	...
+ * Envia por multicast el audio pendiente en el buffer circular de retardo. Lo llama el thread de
+ * SipAgent::_McastScheduler en cada vuelta. Mientras se espera a los paquetes de la radio se envia un paquete
+ * por cada uno recibido. Tras el fin de squelch se vacia el buffer a razon de un paquete cada PTIME/2.
+ * @param	tick	Indica si ha vencido el periodo de PTIME/2.
+ * @return	PJ_TRUE si la sesion queda atendida por reloj (cada PTIME/2).
+ */
+pj_bool_t SipCall::Out_circbuff_Process(pj_bool_t tick)
 {
-	SipCall *wp = (SipCall *)proc;
-	pj_status_t st = PJ_SUCCESS;
-	pj_bool_t primer_paquete = PJ_TRUE;
-
-	pj_thread_desc desc;
-    pj_thread_t *this_thread;
-	pj_status_t rc;
-
-	pj_bzero(desc, sizeof(desc));
-
-    rc = pj_thread_register("Out_circbuff_Th", desc, &this_thread);
-    if (rc != PJ_SUCCESS) {
-		PJ_LOG(3,(__FILE__, "...error in pj_thread_register Out_circbuff_Th!"));
-        return 0;
-    }
-
-    /* Test that pj_thread_this() works */
-    this_thread = pj_thread_this();
-    if (this_thread == NULL) {
-        PJ_LOG(3,(__FILE__, "...error: Out_circbuff_Th pj_thread_this() returns NULL!"));
-        return 0;
-    }
-
-    /* Test that pj_thread_get_name() works */
-    if (pj_thread_get_name(this_thread) == NULL) {
-        PJ_LOG(3,(__FILE__, "...error: Out_circbuff_Th pj_thread_get_name() returns NULL!"));
-        return 0;
-    }				
-	
-	while (wp->out_circbuff_thread_run)
+	SipCall *wp = this;
+	unsigned npackets;
+
+	if (wp->squoff_event_mcast.exchange(PJ_FALSE))
 	{
-		if (wp->wait_sem_out_circbuff) st = pj_sem_wait(wp->sem_out_circbuff);
-		else pj_thread_sleep(PTIME/2);
-		if (!wp->out_circbuff_thread_run) break;
-		if (wp->squoff_event_mcast) 
-		{
-			wp->squoff_event_mcast = PJ_FALSE;
-			wp->wait_sem_out_circbuff = PJ_FALSE;
-			continue;
-		}	
+		wp->wait_sem_out_circbuff = PJ_FALSE;
+		return PJ_TRUE;
+	}	
 
+	unsigned pending = wp->out_circbuff_pending.exchange(0);
+	if (wp->wait_sem_out_circbuff) npackets = pending;
+	else npackets = tick ? 1 : 0;
+
+	for (unsigned n = 0; n < npackets; n++)
+	{
 		pj_bool_t packet_present = PJ_FALSE;
 		pj_ssize_t size_packet = (pj_ssize_t)((SAMPLES_PER_FRAME/2) * sizeof(pj_int16_t));   //en bytes
 		pj_ssize_t size_packet_x = size_packet + sizeof(unsigned);
 		char buf_out[640];
-	
-		pj_mutex_lock(wp->circ_buff_mutex);	
-		unsigned int cbuf_len = pjmedia_circ_buf_get_len(wp->p_retbuff);
+
+		unsigned int cbuf_len = wp->p_retbuff->GetLen();
 		if (cbuf_len < ((unsigned int) (size_packet/2))) 
 		{				
 			packet_present = PJ_FALSE;
 
-			pjmedia_circ_buf_reset(wp->p_retbuff);
-			pj_mutex_unlock(wp->circ_buff_mutex);
+			wp->p_retbuff->Reset();
 			wp->wait_sem_out_circbuff = PJ_TRUE;
-			
+		
 			if (SipAgent::_FrecDesp->IsBssSelected(wp) && wp->window_timer.id == 0)
 			{
 				//Este es el seleccionado en el bss y no se est� en la ventana de selecci�n
@@ -2458,7 +2463,7 @@ int SipCall::Out_circbuff_Th(void *proc)
 				pj_sock_sendto(wp->_RdSendSock, buf_out, &size_packet, 0, RdsndTo, sizeof(pj_sockaddr_in));
 			}
 
-			continue;
+			break;
 		}
 		else
 		{
@@ -2474,54 +2479,8 @@ int SipCall::Out_circbuff_Th(void *proc)
 		}
 		else
 		{
-#if 0
-			if ((wp->Retardo > 0) && wp->wait_sem_out_circbuff)
-			{
-				pj_uint32_t umbral_l, umbral_h;
-				if (wp->Retardo > size_packet/2) 
-				{
-					umbral_l = wp->Retardo - size_packet/2;
-					umbral_h = wp->Retardo + size_packet/2;
-				}
-				else 
-				{
-					umbral_l = cbuf_len;
-					umbral_h = cbuf_len;
-				}
-
-				if (cbuf_len < umbral_l) 
-				{
-					PJ_LOG(5,(__FILE__, "TRAZA: RETARDO MENOR antes cbuf_len %u Retardo %u\n", cbuf_len, wp->Retardo));
-					//pjmedia_circ_buf_write(wp->p_retbuff, (pj_int16_t *) wp->zerobuf, size_packet/2);
-					while (cbuf_len < wp->Retardo)
-					{
-						pjmedia_circ_buf_write(wp->p_retbuff, (pj_int16_t *) wp->zerobuf, 1);
-						cbuf_len = pjmedia_circ_buf_get_len(wp->p_retbuff);
-					}
-					//cbuf_len = pjmedia_circ_buf_get_len(wp->p_retbuff);
-					PJ_LOG(5,(__FILE__, "TRAZA: RETARDO MENOR despues cbuf_len %u Retardo %u\n", cbuf_len, wp->Retardo));
-				}
-				else if (cbuf_len > umbral_h) 
-				{
-					PJ_LOG(5,(__FILE__, "TRAZA: RETARDO MAYOR antes cbuf_len %u Retardo %u\n", cbuf_len, wp->Retardo));
-					//pjmedia_circ_buf_read(wp->p_retbuff, (pj_int16_t *) wp->zerobuf, size_packet/2);
-					while (cbuf_len > umbral_h)
-					{
-						pj_int16_t nullc;
-						pjmedia_circ_buf_read(wp->p_retbuff, (pj_int16_t *) &nullc, 1);
-						cbuf_len = pjmedia_circ_buf_get_len(wp->p_retbuff);
-					}
-					//cbuf_len = pjmedia_circ_buf_get_len(wp->p_retbuff);
-					PJ_LOG(5,(__FILE__, "TRAZA: RETARDO MAYOR despues cbuf_len %u Retardo %u\n", cbuf_len, wp->Retardo));
-				}
-				else ;
-			}
-#endif
-
-
-			pjmedia_circ_buf_read(wp->p_retbuff, (pj_int16_t *) buf_out, size_packet/2);
-			pj_mutex_unlock(wp->circ_buff_mutex);				
-					
+			wp->p_retbuff->Read((pj_int16_t *) buf_out, size_packet/2);
+				
 			if (wp->_Sending_Multicast_enabled)
 			{
 				unsigned nseq = SipAgent::_FrecDesp->Get_mcast_seq(wp->_Index_group);				
@@ -2536,12 +2495,12 @@ int SipCall::Out_circbuff_Th(void *proc)
 					SipAgent::_FrecDesp->Set_group_multicast_socket(wp->_Index_group, RdsndTo);
 				}
 
-				if (primer_paquete)
+				if (wp->out_primer_paquete)
 				{					
 					char data = RESTART_JBUF;
 					pj_ssize_t siz = 1;
 					pj_sock_sendto(wp->_RdSendSock, &data, &siz, 0, RdsndTo, sizeof(pj_sockaddr_in));
-					primer_paquete = PJ_FALSE;
+					wp->out_primer_paquete = PJ_FALSE;
 				}
 
 				pj_sock_sendto(wp->_RdSendSock, buf_out, &size_packet_x, 0, RdsndTo, sizeof(pj_sockaddr_in));
@@ -2549,13 +2508,9 @@ int SipCall::Out_circbuff_Th(void *proc)
 			}
 			continue;
 		}
-
-		pj_mutex_unlock(wp->circ_buff_mutex);
-
-		continue;
 	}
 
-	return 0;
+	return !wp->wait_sem_out_circbuff;
 }
 
 CORESIP_CallInfo *SipCall::GetCORESIP_CallInfo()
@@ -2763,7 +2718,7 @@ void SipCall::OnCreateSdp(int call_id, void * sdp, void * rdata_arg)
 			{
 			pjmedia_sdp_attr *a_rtpmap= local_sdp->media[0]->attr[j];
 
-			if (a_rtpmap && pj_stricmp(&(pj_str_t(a_rtpmap->name)),&(pj_str("rtpmap")))==0) 
+			if (a_rtpmap && pj_stricmp(&(pj_str_t(a_rtpmap->name)),StrPtr(pj_str("rtpmap")))==0) 
 			{
 			pjmedia_sdp_rtpmap ar;
 			pjmedia_sdp_attr_get_rtpmap(a_rtpmap, &ar);
@@ -2809,61 +2764,61 @@ void SipCall::OnCreateSdp(int call_id, void * sdp, void * rdata_arg)
 				SipAgent::KeepAliveParams(kap, kam);
 
 				//pjmedia_sdp_attr * a = pjmedia_sdp_attr_create(call->_Pool, "type", 
-				//	call->_Coupling ? &(pj_str("coupling")) : &(pj_str("radio")));
+				//	call->_Coupling ? StrPtr(pj_str("coupling")) : StrPtr(pj_str("radio")));
 				//pjmedia_sdp_media_add_attr(local_sdp->media[0], a); 
 				// Plug-Test FAA 05/2011
 				pjmedia_sdp_attr * a = pjmedia_sdp_attr_create(call->_Pool, "type", 
-					//call->_Info.Coupling ? &(pj_str("coupling")) : (call->_Info.Dir == CORESIP_DIR_RECVONLY ? &(pj_str("Radio-Rxonly")) : &(pj_str("radio"))));
-					call->_Info.Flags & CORESIP_CALL_RD_COUPLING ? &(pj_str("coupling")) : (call->_Info.Dir == CORESIP_DIR_RECVONLY ? &(pj_str("Radio-Rxonly")) : &(pj_str("radio"))));
+					//call->_Info.Coupling ? StrPtr(pj_str("coupling")) : (call->_Info.Dir == CORESIP_DIR_RECVONLY ? StrPtr(pj_str("Radio-Rxonly")) : StrPtr(pj_str("radio"))));
+					call->_Info.Flags & CORESIP_CALL_RD_COUPLING ? StrPtr(pj_str("coupling")) : (call->_Info.Dir == CORESIP_DIR_RECVONLY ? StrPtr(pj_str("Radio-Rxonly")) : StrPtr(pj_str("radio"))));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 				// Plug-Test FAA 05/2011
 				a = pjmedia_sdp_attr_create(call->_Pool, "session-type", 
-					(call->_Info.Dir == CORESIP_DIR_RECVONLY ? &(pj_str("Rxonly")) :
-					(call->_Info.Dir == CORESIP_DIR_SENDONLY ? &(pj_str("Txonly")) : &(pj_str("TxRx")))));
+					(call->_Info.Dir == CORESIP_DIR_RECVONLY ? StrPtr(pj_str("Rxonly")) :
+					(call->_Info.Dir == CORESIP_DIR_SENDONLY ? StrPtr(pj_str("Txonly")) : StrPtr(pj_str("TxRx")))));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 
 				// Plug-Test FAA 05/2011
 				// A�adir atributo txrxmode
 				//a = pjmedia_sdp_attr_create(call->_Pool, "txrxmode", 
-				//	(call->_Dir == CORESIP_DIR_RECVONLY ? &(pj_str("Rx")) :
-				//	(call->_Dir == CORESIP_DIR_SENDONLY ? &(pj_str("Tx")) : &(pj_str("TxRx")))));
+				//	(call->_Dir == CORESIP_DIR_RECVONLY ? StrPtr(pj_str("Rx")) :
+				//	(call->_Dir == CORESIP_DIR_SENDONLY ? StrPtr(pj_str("Tx")) : StrPtr(pj_str("TxRx")))));
 				//pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 
-				a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("RSSI")));
+				a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("RSSI")));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 
 				// Plug-Test FAA 05/2011
 				if ((call->_Info.BssMethods & 8) == 8)	// PSD
 				{
-					a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("PSD")));
+					a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("PSD")));
 					pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 				}
 				if ((call->_Info.BssMethods & 4) == 4)	// C/N
 				{
-					a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("C/N")));
+					a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("C/N")));
 					pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 				}
 				if ((call->_Info.BssMethods & 2) == 2)	// AGC
 				{
-					a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("AGC")));
+					a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("AGC")));
 					pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 				}
 
 				// Plug-Test FAA 05/2011
-				a = pjmedia_sdp_attr_create(call->_Pool, "ptt_rep", &(pj_str("0")));
+				a = pjmedia_sdp_attr_create(call->_Pool, "ptt_rep", StrPtr(pj_str("0")));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
-				a = pjmedia_sdp_attr_create(call->_Pool, "sigtime", &(pj_str("1")));
+				a = pjmedia_sdp_attr_create(call->_Pool, "sigtime", StrPtr(pj_str("1")));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 
-				//a = pjmedia_sdp_attr_create(call->_Pool, "interval", &(pj_str("20")));
+				//a = pjmedia_sdp_attr_create(call->_Pool, "interval", StrPtr(pj_str("20")));
 				//pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
-				//a = pjmedia_sdp_attr_create(call->_Pool, "sigtime", &(pj_str("1")));
+				//a = pjmedia_sdp_attr_create(call->_Pool, "sigtime", StrPtr(pj_str("1")));
 				//pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
-				//a = pjmedia_sdp_attr_create(call->_Pool, "ptt_rep", &(pj_str("0")));
+				//a = pjmedia_sdp_attr_create(call->_Pool, "ptt_rep", StrPtr(pj_str("0")));
 				//pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
-				a = pjmedia_sdp_attr_create(call->_Pool, "R2S-KeepAlivePeriod", &(pj_str(kap)));
+				a = pjmedia_sdp_attr_create(call->_Pool, "R2S-KeepAlivePeriod", StrPtr(pj_str(kap)));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
-				a = pjmedia_sdp_attr_create(call->_Pool, "R2S-KeepAliveMultiplier", &(pj_str(kam)));
+				a = pjmedia_sdp_attr_create(call->_Pool, "R2S-KeepAliveMultiplier", StrPtr(pj_str(kam)));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 				if (pj_strlen(&call->_Frequency) > 0)
 				{
@@ -2873,7 +2828,7 @@ void SipCall::OnCreateSdp(int call_id, void * sdp, void * rdata_arg)
 
 				// Plug-Test FAA 05/2011
 				// RTPHE Version
-				a = pjmedia_sdp_attr_create(call->_Pool, "rtphe", &(pj_str("1")));
+				a = pjmedia_sdp_attr_create(call->_Pool, "rtphe", StrPtr(pj_str("1")));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 
 			}
@@ -2882,7 +2837,7 @@ void SipCall::OnCreateSdp(int call_id, void * sdp, void * rdata_arg)
 			else if (call->_Info.Type == CORESIP_CALL_OVR)
 			{
 				char szOvrMembers[CORESIP_MAX_OVR_CALLS_MEMBERS * (CORESIP_MAX_URI_LENGTH + 1)];
-				pjmedia_sdp_attr * a = pjmedia_sdp_attr_create(call->_Pool, "service", &(pj_str("duplex")));
+				pjmedia_sdp_attr * a = pjmedia_sdp_attr_create(call->_Pool, "service", StrPtr(pj_str("duplex")));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 
 				switch (call->_EstablishedOvrCallMembers.MembersCount)
@@ -2920,7 +2875,7 @@ void SipCall::OnCreateSdp(int call_id, void * sdp, void * rdata_arg)
 
 				//				if (call->_EstablishedOvrCallMembers.MembersCount > 0)
 				//				{
-				a = pjmedia_sdp_attr_create(call->_Pool, "sid", &(pj_str(szOvrMembers)));
+				a = pjmedia_sdp_attr_create(call->_Pool, "sid", StrPtr(pj_str(szOvrMembers)));
 				pjmedia_sdp_media_add_attr(local_sdp->media[0], a);
 				//				}
 			}
@@ -2934,7 +2889,7 @@ void SipCall::OnCreateSdp(int call_id, void * sdp, void * rdata_arg)
 		}
 		else if (rdata && !SipAgent::EnableMonitoring)
 		{
-			pjsip_subject_hdr * subject = (pjsip_subject_hdr*)pjsip_msg_find_hdr_by_name(rdata->msg_info.msg, &(pj_str("subject")), NULL);
+			pjsip_subject_hdr * subject = (pjsip_subject_hdr*)pjsip_msg_find_hdr_by_name(rdata->msg_info.msg, StrPtr(pj_str("subject")), NULL);
 			if (subject && (pj_stricmp(&subject->hvalue, &gSubject[CORESIP_CALL_IA]) == 0))
 			{
 				pjmedia_sdp_attr * attr = pjmedia_sdp_media_find_attr2(local_sdp->media[0], "sendrecv", NULL);
@@ -2949,7 +2904,7 @@ void SipCall::OnCreateSdp(int call_id, void * sdp, void * rdata_arg)
 
 	//if (rdata && !_EnableMonitoring)
 	//{
-	//	pjsip_subject_hdr * subject = (pjsip_subject_hdr*)pjsip_msg_find_hdr_by_name(rdata->msg_info.msg, &(pj_str("subject")), NULL);
+	//	pjsip_subject_hdr * subject = (pjsip_subject_hdr*)pjsip_msg_find_hdr_by_name(rdata->msg_info.msg, StrPtr(pj_str("subject")), NULL);
 	//	if (subject && (pj_stricmp(&subject->hvalue, &gSubject[CORESIP_CALL_IA]) == 0))
 	//	{
 	//		pjmedia_sdp_attr * attr = pjmedia_sdp_media_find_attr2(local_sdp->media[0], "sendrecv", NULL);
@@ -3027,9 +2982,9 @@ void SipCall::OnCreateSdp(pj_pool_t *pool, int call_id, void * local_sdp, void *
 			pjmedia_sdp_media_add_attr(sdp->media[0], a);
 
 			SipAgent::KeepAliveParams(kap, kam);
-			a = pjmedia_sdp_attr_create(pool, "R2S-KeepAlivePeriod", &(pj_str(kap)));
+			a = pjmedia_sdp_attr_create(pool, "R2S-KeepAlivePeriod", StrPtr(pj_str(kap)));
 			pjmedia_sdp_media_add_attr(sdp->media[0], a);
-			a = pjmedia_sdp_attr_create(pool, "R2S-KeepAliveMultiplier", &(pj_str(kam)));
+			a = pjmedia_sdp_attr_create(pool, "R2S-KeepAliveMultiplier", StrPtr(pj_str(kam)));
 			pjmedia_sdp_media_add_attr(sdp->media[0], a);
 
 			pj_str_t rtphe = pj_str("1");
@@ -3064,11 +3019,11 @@ void SipCall::OnCreateSdp(pj_pool_t *pool, int call_id, void * local_sdp, void *
 
 				/** AGL 140529 Version Anterior..
 				pjmedia_sdp_attr * a = pjmedia_sdp_attr_create(call->_Pool, "type", 
-				call->_Info.Flags & CORESIP_CALL_RD_COUPLING ? &(pj_str("coupling")) : &(pj_str("radio")));
+				call->_Info.Flags & CORESIP_CALL_RD_COUPLING ? StrPtr(pj_str("coupling")) : StrPtr(pj_str("radio")));
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
 				a = pjmedia_sdp_attr_create(call->_Pool, "session-type", 
-				(call->_Info.Flags & CORESIP_CALL_RD_RXONLY ? &(pj_str("Rxonly")) :
-				(call->_Info.Flags & CORESIP_CALL_RD_TXONLY ? &(pj_str("Txonly")) : &(pj_str("TxRx")))));
+				(call->_Info.Flags & CORESIP_CALL_RD_RXONLY ? StrPtr(pj_str("Rxonly")) :
+				(call->_Info.Flags & CORESIP_CALL_RD_TXONLY ? StrPtr(pj_str("Txonly")) : StrPtr(pj_str("TxRx")))));
 				*/
 
 				/** ED137.. B */
@@ -3086,7 +3041,7 @@ void SipCall::OnCreateSdp(pj_pool_t *pool, int call_id, void * local_sdp, void *
 				fmt->ptr = (char*) pj_pool_alloc(call->_Pool, 8);
 				fmt->slen = pj_utoa(123, fmt->ptr);
 
-				a = pjmedia_sdp_attr_create(call->_Pool, "rtpmap", &(pj_str("123 R2S/8000")));
+				a = pjmedia_sdp_attr_create(call->_Pool, "rtpmap", StrPtr(pj_str("123 R2S/8000")));
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
 
 				pj_str_t txrxmodedata = (call->_Info.Flags & CORESIP_CALL_RD_RXONLY) ? (pj_str("Rx"))  : 
@@ -3095,13 +3050,13 @@ void SipCall::OnCreateSdp(pj_pool_t *pool, int call_id, void * local_sdp, void *
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
 
 				/*No envio el fid en el SDP.*/
-				/*a = pjmedia_sdp_attr_create(call->_Pool, "fid", &(pj_str(call->_RdFr)));
+				/*a = pjmedia_sdp_attr_create(call->_Pool, "fid", StrPtr(pj_str(call->_RdFr)));
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
 				*/
 
-				a = pjmedia_sdp_attr_create(call->_Pool, "R2S-KeepAlivePeriod", &(pj_str(kap)));
+				a = pjmedia_sdp_attr_create(call->_Pool, "R2S-KeepAlivePeriod", StrPtr(pj_str(kap)));
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
-				a = pjmedia_sdp_attr_create(call->_Pool, "R2S-KeepAliveMultiplier", &(pj_str(kam)));
+				a = pjmedia_sdp_attr_create(call->_Pool, "R2S-KeepAliveMultiplier", StrPtr(pj_str(kam)));
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
 
 				if (1) 	
@@ -3110,21 +3065,21 @@ void SipCall::OnCreateSdp(pj_pool_t *pool, int call_id, void * local_sdp, void *
 					{
 						if (call->bss_method_type == RSSI_NUC)
 						{
-							a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("NUCLEO")));
+							a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("NUCLEO")));
 							pjmedia_sdp_media_add_attr(sdp->media[0], a);
 
-							a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("RSSI")));
+							a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("RSSI")));
 							pjmedia_sdp_media_add_attr(sdp->media[0], a);
 						}
 						else if (call->bss_method_type == RSSI)
 						{
-							a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("RSSI")));
+							a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("RSSI")));
 							pjmedia_sdp_media_add_attr(sdp->media[0], a);
 						}
 						else if ((call->bss_method_type == CENTRAL) && (call->_Info.porcentajeRSSI > MIN_porcentajeRSSI))
 						{
 							//Si es CENTRALIZADO y se necesita un porcentaje de valor RSSI
-							a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("RSSI")));
+							a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("RSSI")));
 							pjmedia_sdp_media_add_attr(sdp->media[0], a);
 						}
 					}
@@ -3132,23 +3087,23 @@ void SipCall::OnCreateSdp(pj_pool_t *pool, int call_id, void * local_sdp, void *
 
 				//if (call->_Info.PreferredBss == 2)
 				//{
-				//	a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("AGC")));
+				//	a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("AGC")));
 				//	pjmedia_sdp_media_add_attr(sdp->media[0], a);
 				//}
 				//else if (call->_Info.PreferredBss == 3)
 				//{
-				//	a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("C/N")));
+				//	a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("C/N")));
 				//	pjmedia_sdp_media_add_attr(sdp->media[0], a);
 				//}
 				//else if (call->_Info.PreferredBss == 4)
 				//{
-				//	a = pjmedia_sdp_attr_create(call->_Pool, "bss", &(pj_str("PSD")));
+				//	a = pjmedia_sdp_attr_create(call->_Pool, "bss", StrPtr(pj_str("PSD")));
 				//	pjmedia_sdp_media_add_attr(sdp->media[0], a);
 				//}
 
-				a = pjmedia_sdp_attr_create(call->_Pool, "interval", &(pj_str("20")));
+				a = pjmedia_sdp_attr_create(call->_Pool, "interval", StrPtr(pj_str("20")));
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
-				a = pjmedia_sdp_attr_create(call->_Pool, "sigtime", &(pj_str("1")));
+				a = pjmedia_sdp_attr_create(call->_Pool, "sigtime", StrPtr(pj_str("1")));
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
 
 
@@ -3156,7 +3111,7 @@ void SipCall::OnCreateSdp(pj_pool_t *pool, int call_id, void * local_sdp, void *
 				 * PTT_REP_COUNT en el fichero stream.c de pjmedia. Para ptt_rep=1 PTT_REP_COUNT debe valer 2,
 				 * que es el numero de paquetes rtp con ptt off al finalizar un ptt on
 				 */
-				a = pjmedia_sdp_attr_create(call->_Pool, "ptt_rep", &(pj_str("1")));
+				a = pjmedia_sdp_attr_create(call->_Pool, "ptt_rep", StrPtr(pj_str("1")));
 				pjmedia_sdp_media_add_attr(sdp->media[0], a);
 
 
@@ -3406,7 +3361,7 @@ void SipCall::OnStateChanged(pjsua_call_id call_id, pjsip_event * e)
 								//Todas las sesiones que existan abiertas a la misma uri se cierran
 								if (pj_strcmp(&info.remote_info, &callInfo.remote_info) == 0)
 								{
-									//pjsua_call_hangup(call_ids[i], PJSIP_SC_DECLINE, &(pj_str("Closing zombie session")), NULL);
+									//pjsua_call_hangup(call_ids[i], PJSIP_SC_DECLINE, StrPtr(pj_str("Closing zombie session")), NULL);
 									Hangup(call_ids[i], PJSIP_AC_AMBIGUOUS);
 								}
 							}
@@ -3558,13 +3513,11 @@ void SipCall::EliminarRadSessionDelGrupo(SipCall *call)
 	call->window_timer.id = 0;
 	pjsua_cancel_timer(&call->window_timer);
 
-	if (call->out_circbuff_thread != NULL)
+	if (call->out_circbuff_registered)
 	{
-		call->out_circbuff_thread_run = PJ_FALSE;
-		pj_sem_post(call->sem_out_circbuff);
-		pj_thread_join(call->out_circbuff_thread);
-		pj_thread_destroy(call->out_circbuff_thread);
-		call->out_circbuff_thread = NULL;
+		//Deja de enviar por multicast antes de salir del grupo
+		if (SipAgent::_McastScheduler != NULL) SipAgent::_McastScheduler->Remove(call);
+		call->out_circbuff_registered = PJ_FALSE;
 	}
 
 	if (call->_Index_group < 0 || call->_Index_sess < 0 || 
@@ -3789,22 +3742,22 @@ void SipCall::OnIncommingCall(pjsua_acc_id acc_id, pjsua_call_id call_id,
 						pjmedia_sdp_attr *a;
 						if ((a=pjmedia_sdp_media_find_attr2(rem_sdp->media[i], "type", NULL)) != NULL)
 						{
-							if(!pj_stricmp(&(a->value), &(pj_str("Radio"))))			
+							if(!pj_stricmp(&(a->value), StrPtr(pj_str("Radio"))))			
 				 				info.Flags_type=CORESIP_CALL_RD_TXRX;
-							else if(!pj_stricmp(&(a->value), &(pj_str("Radio-TxRx"))))			
+							else if(!pj_stricmp(&(a->value), StrPtr(pj_str("Radio-TxRx"))))			
 				 				info.Flags_type=CORESIP_CALL_RD_TXRX;
-							else if(!pj_stricmp(&(a->value), &(pj_str("Radio-Idle"))))		
+							else if(!pj_stricmp(&(a->value), StrPtr(pj_str("Radio-Idle"))))		
 				 				info.Flags_type=CORESIP_CALL_RD_IDLE;
-							else if(!pj_stricmp(&(a->value), &(pj_str("Radio-Rxonly"))))			
+							else if(!pj_stricmp(&(a->value), StrPtr(pj_str("Radio-Rxonly"))))			
 				 				info.Flags_type=CORESIP_CALL_RD_RXONLY;
 						}
 
 
 						if ((a=pjmedia_sdp_media_find_attr2(rem_sdp->media[i], "txrxmode", NULL)) != NULL)
 						{
-							if(!pj_stricmp(&(a->value), &(pj_str("Rx"))))			
+							if(!pj_stricmp(&(a->value), StrPtr(pj_str("Rx"))))			
 				 				info.Flags=CORESIP_CALL_RD_RXONLY;
-							else if(!pj_stricmp(&(a->value), &(pj_str("Tx"))))		
+							else if(!pj_stricmp(&(a->value), StrPtr(pj_str("Tx"))))		
 				 				info.Flags=CORESIP_CALL_RD_TXONLY;
 							else
 				 				info.Flags=CORESIP_CALL_NINGUNO;
@@ -3968,7 +3921,7 @@ void SipCall::OnMediaStateChanged(pjsua_call_id call_id)
 
 	if (callInfo.media_status == PJSUA_CALL_MEDIA_ERROR)
 	{
-		pjsua_call_hangup(call_id, PJSIP_SC_INTERNAL_SERVER_ERROR, &(pj_str("SDP negotiation failed")), NULL);
+		pjsua_call_hangup(call_id, PJSIP_SC_INTERNAL_SERVER_ERROR, StrPtr(pj_str("SDP negotiation failed")), NULL);
 	}
 	else if (callInfo.state == PJSIP_INV_STATE_CONFIRMED)
 	{
@@ -4027,7 +3980,7 @@ void SipCall::OnMediaStateChanged(pjsua_call_id call_id)
 						{
 							SipAgent::RecHold(false, true);
 						}
-						else if (callInfo.media_status == CORESIP_MEDIA_REMOTE_HOLD ||
+						else if (callInfo.media_status == PJSUA_CALL_MEDIA_REMOTE_HOLD ||
 							callInfo.media_status == PJSUA_CALL_MEDIA_NONE) 
 						{
 							SipAgent::RecHold(true, false);
@@ -4043,7 +3996,7 @@ void SipCall::OnMediaStateChanged(pjsua_call_id call_id)
 						{
 							SipAgent::RecHold(false, false);
 						}
-						else if (callInfo.media_status == CORESIP_MEDIA_REMOTE_HOLD ||
+						else if (callInfo.media_status == PJSUA_CALL_MEDIA_REMOTE_HOLD ||
 							callInfo.media_status == PJSUA_CALL_MEDIA_NONE) 
 						{
 							SipAgent::RecHold(true, true);
@@ -4650,7 +4603,7 @@ pj_status_t SipCall::OnNegociateSdp(void * inv_arg, void * neg_arg, void * rdata
 	}
 	//else if (rdata)
 	//{
-	//	pjsip_subject_hdr * subject = (pjsip_subject_hdr*)pjsip_msg_find_hdr_by_name(rdata->msg_info.msg, &(pj_str("subject")), NULL);
+	//	pjsip_subject_hdr * subject = (pjsip_subject_hdr*)pjsip_msg_find_hdr_by_name(rdata->msg_info.msg, StrPtr(pj_str("subject")), NULL);
 	//	if (subject)
 	//	{
 	//		is_rd = (pj_stricmp(&subject->hvalue, &gSubject[CORESIP_CALL_RD]) == 0);
@@ -4677,7 +4630,7 @@ pj_status_t SipCall::OnNegociateSdp(void * inv_arg, void * neg_arg, void * rdata
 		char szOvrMembers[CORESIP_MAX_OVR_CALLS_MEMBERS * (CORESIP_MAX_URI_LENGTH + 1)];
 		const pjmedia_sdp_session * loc_sdp;
 		pjmedia_sdp_neg_get_active_local(neg, &loc_sdp);
-		pjmedia_sdp_attr * a = pjmedia_sdp_attr_create(call->_Pool, "service", &(pj_str("duplex")));
+		pjmedia_sdp_attr * a = pjmedia_sdp_attr_create(call->_Pool, "service", StrPtr(pj_str("duplex")));
 		pjmedia_sdp_media_add_attr(loc_sdp->media[0], a);
 
 		switch (call->_EstablishedOvrCallMembers.MembersCount)
@@ -4711,7 +4664,7 @@ pj_status_t SipCall::OnNegociateSdp(void * inv_arg, void * neg_arg, void * rdata
 
 		//if (call->_EstablishedOvrCallMembers.MembersCount > 0)
 		//{
-		a = pjmedia_sdp_attr_create(call->_Pool, "sid", &(pj_str(szOvrMembers)));
+		a = pjmedia_sdp_attr_create(call->_Pool, "sid", StrPtr(pj_str(szOvrMembers)));
 		pjmedia_sdp_media_add_attr(loc_sdp->media[0], a);
 		//		}
 
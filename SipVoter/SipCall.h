@@ -2,8 +2,9 @@
 #define __CORESIP_CALL_H__
 
 #include <atomic>
-#include "processor.h"
+#include "qidx.h"
 #include "IIR_FILT.h"
+#include "AudioRing.h"
 
 enum bss_method_types
 {
@@ -49,6 +50,7 @@ public:
 	static void Hold(pjsua_call_id call_id, bool hold);
 	static void Transfer(pjsua_call_id call_id, pjsua_call_id dst_call_id, const char * dst, const char *display_name);
 	static void Ptt(pjsua_call_id call_id, const CORESIP_PttInfo * info);
+	static void GroupPtt(const pjsua_call_id * call_ids, int count, const CORESIP_PttInfo * info);
 	static void Conference(pjsua_call_id call_id, bool conf);
 	static void SendConfInfo(pjsua_call_id call_id, const CORESIP_ConfInfo * info);
 	static void SendInfoMsg(pjsua_call_id call_id, const char * info);
@@ -100,6 +102,8 @@ public:
 	static pj_str_t gWG67VersionRadioValue;
 	static pj_str_t gWG67VersionTelefValue;
 	static void Wg67VersionSet(pjsip_tx_data *txdata, pj_str_t *valor);
+
+	pj_bool_t Out_circbuff_Process(pj_bool_t tick);		//Lo llama McastScheduler en cada vuelta
 		
 
 private:
@@ -138,8 +142,7 @@ private:
 	pj_sock_t _RdSendSock;
 	pj_sockaddr_in _RdSendTo;		
 	pj_uint32_t Retardo;					//Retardo en n�mero de muestras (125us)
-	pj_mutex_t *circ_buff_mutex;
-	pjmedia_circ_buf *p_retbuff;			//Buffer circular para implementar retardo	
+	AudioRing *p_retbuff;					//Buffer circular para implementar retardo. Sin mutex: un productor (RTP) y un consumidor (envio multicast)
 	
 	pj_bool_t squ_event;					//Indica un evento de squelch on.
 	pj_bool_t squ_event_mcast;				//Se activa con el primer squelch de un grupo
@@ -147,10 +150,9 @@ private:
 
 	pj_bool_t primer_paquete_despues_squelch;
 
-	pj_bool_t squoff_event_mcast;
+	std::atomic<pj_bool_t> squoff_event_mcast;		//Fin de squelch para el thread de SipAgent::_McastScheduler
 	unsigned waited_rtp_seq;				//Numero de secuencia esperado por rtp desde la radio
 	pj_bool_t hay_retardo;					//Indica si hay retardo despu�s de squelch	
-	char zerobuf[256];
 
 	bss_method_types bss_method_type;
 
@@ -166,11 +168,12 @@ private:
 	static void window_timer_cb(pj_timer_heap_t *th, pj_timer_entry *te);
 											//Callback del timer
 
-	pj_sem_t *sem_out_circbuff;
-	pj_thread_t  *out_circbuff_thread;
-	pj_bool_t out_circbuff_thread_run;
-	static pj_thread_proc Out_circbuff_Th;
-	pj_bool_t wait_sem_out_circbuff;		//Indica si tiene que esperar el sem_out_circbuff
+	std::atomic<unsigned> out_circbuff_pending;	//Paquetes escritos en p_retbuff pendientes de enviar por multicast
+	pj_bool_t out_circbuff_registered;		//Indica si la sesion esta registrada en SipAgent::_McastScheduler
+	pj_bool_t out_primer_paquete;			//Indica que antes del primer paquete hay que enviar RESTART_JBUF
+	std::atomic<pj_bool_t> wait_sem_out_circbuff;	//Si true, se envia un paquete por cada uno recibido. Si false, uno cada PTIME/2.
+												//Lo escriben el thread de recepcion RTP y el de SipAgent::_McastScheduler
+	static const unsigned MAX_OUT_CIRCBUFF_PENDING = 10;
 
 	static const int Check_CLD_timer_IDLE = 0;
 	static const int Check_CLD_timer_SEND_CLD = 1;
@@ -191,7 +194,7 @@ private:
 
 	/*** Necesarios para el calculo de Qidx ****/
 	pj_uint8_t last_qidx_value;
-	processor_data PdataQidx;				//Datos para el proceso de calculo del QiDx.
+	qidx_data_t PdataQidx;					//Datos para el proceso de calculo del QiDx.
 	float fPdataQidx[SAMPLES_PER_FRAME*2];
 	float afMuestrasIfRx[SAMPLES_PER_FRAME*2];
 	float a_dc[2];
@@ -231,6 +234,7 @@ private:
 		pj_str_t **p_st_text, pjsip_hdr *res_hdr, pjsip_msg_body **p_body);
 
 	static void EliminarRadSessionDelGrupo(SipCall *call);
+	static pj_status_t SetPtt(pjsua_call_id call_id, pjsua_call * call1, const CORESIP_PttInfo * info, pjmedia_stream ** edge, pj_bool_t * forzar_KA);
 	static int FlushSessions(pj_str_t *dst, pjsua_call_id except_cid, CORESIP_CallType calltype);
 	void IniciaFinSesion();
 	void Dispose();
@@ -49,7 +49,7 @@ SoundPort::SoundPort(CORESIP_SndDevType type, int inDevIndex, int outDevIndex)
 		 * Inicializa la informacion asociada al Puerto _Port. (PSVP ???). Se autoreferencia 
 		 * a la propia clase a traves de _Port.port_data.pdata
 		 */
-		pjmedia_port_info_init(&_Port.info, &(pj_str("PSVP")), PJMEDIA_PORT_SIGNATURE('P', 'S', 'V', 'P'), 
+		pjmedia_port_info_init(&_Port.info, StrPtr(pj_str("PSVP")), PJMEDIA_PORT_SIGNATURE('P', 'S', 'V', 'P'), 
 			SAMPLING_RATE, CHANNEL_COUNT, BITS_PER_SAMPLE, SAMPLES_PER_FRAME);
 
 		_Port.port_data.pdata = this;
@@ -65,7 +65,7 @@ SoundPort::SoundPort(CORESIP_SndDevType type, int inDevIndex, int outDevIndex)
 		 * Inicializa la informacion asociada al Puerto >this> (SNDP). Se autoreferencia 
 		 * a la propia clase a traves de port_data.pdata
 		 */
-		pjmedia_port_info_init(&info, &(pj_str("SNDP")), PJMEDIA_PORT_SIGNATURE('S', 'N', 'D', 'P'), 
+		pjmedia_port_info_init(&info, StrPtr(pj_str("SNDP")), PJMEDIA_PORT_SIGNATURE('S', 'N', 'D', 'P'), 
 			SipAgent::SndSamplingRate, CHANNEL_COUNT, BITS_PER_SAMPLE, 
 			((SipAgent::SndSamplingRate * CHANNEL_COUNT * PTIME) / 1000));
 
@@ -185,7 +185,6 @@ SoundPort::~SoundPort()
  */
 void SoundPort::Remote(bool on, const char * id, const char * ip, unsigned port)
 {
-	static int rPayloadSize = sizeof(_RemotePayload);
 	Guard lock(_Lock);
 
 	if (_RemoteSock != PJ_INVALID_SOCKET)
@@ -196,10 +195,7 @@ void SoundPort::Remote(bool on, const char * id, const char * ip, unsigned port)
 
 	if (on)
 	{
-		contador_paquete = 0;
-
-		pj_ansi_strcpy(_RemotePayload.SrcId, id);
-		_RemotePayload.SrcType = _Type;
+		_RemoteTx.Init(id, _Type, SipAgent::Coresip_Local_Config._Remote_Audio_Format);
 
 		pj_status_t st = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &_RemoteSock);
 		PJ_CHECK_STATUS(st, ("ERROR creando socket para el envio de radio por multicast"));
@@ -214,7 +210,7 @@ void SoundPort::Remote(bool on, const char * id, const char * ip, unsigned port)
 		if (st != PJ_SUCCESS)
 			PJ_LOG(3,(__FILE__, "ERROR: setsockopt, PJ_IP_MULTICAST_IF. El envio de audio a %s:%d no se puede forzar por el interface %s", ip, port, SipAgent::Get_uaIpAdd()));
 
-		pj_sockaddr_in_init(&_RemoteTo, &(pj_str(const_cast<char*>(ip))), (pj_uint16_t)port);
+		pj_sockaddr_in_init(&_RemoteTo, StrPtr(pj_str(const_cast<char*>(ip))), (pj_uint16_t)port);
 	}
 }
 
@@ -393,48 +389,7 @@ void SoundPort::SetInBuf(pjmedia_frame * frame, int offset)
 
 		if (_RemoteSock != PJ_INVALID_SOCKET)
 		{
-			static pj_ssize_t size = sizeof(RemotePayload);
-
-			pj_uint16_t buffer_prueba[SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8) / 2];
-			int nmuetras = SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8) / 2;
-
-			for (int i = 0; i < nmuetras; i++)
-			{
-				buffer_prueba[i] = contador_paquete;
-			}		
-
-			/*Para provocar fallo*/
-			/*
-			if (contador_paquete % 20 == 0 && contador_paquete != 0)
-			{
-				for (int i = 0; i < nmuetras; i++)
-				{
-					buffer_prueba[i] = contador_paquete-1;
-				}
-			}
-			else if (contador_paquete % 30 == 0 && contador_paquete != 0)
-			{
-				buffer_prueba[32] = 17;
-			}
-			*/
-
-			contador_paquete++;
-			if (contador_paquete == 0x100)
-			{
-				contador_paquete = 0;
-			}
-
-			_RemotePayload.Size = SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8);
-
-			if (SipAgent::SndSamplingRate != SAMPLING_RATE)
-			{
-				PJ_LOG(3,(__FILE__, "INCIPALMA: SoundPort::SetInBuf:  SipAgent::SndSamplingRate != SAMPLING_RATE"));
-			}
-
-			//memcpy(_RemotePayload.Data, (SipAgent::SndSamplingRate != SAMPLING_RATE ? _SndIn : _SndInBuf), SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8));
-			memcpy(_RemotePayload.Data, (SipAgent::SndSamplingRate != SAMPLING_RATE ? _SndIn : (void *) buffer_prueba), SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8));
-
-			pj_sock_sendto(_RemoteSock, &_RemotePayload, &size, 0, &_RemoteTo, sizeof(_RemoteTo));
+			_RemoteTx.Send(_RemoteSock, &_RemoteTo, (SipAgent::SndSamplingRate != SAMPLING_RATE ? _SndIn : _SndInBuf));
 		}
 	}
 }
@@ -522,12 +477,7 @@ pj_status_t SoundPort::PutSndFrame(pjmedia_port * port, const pjmedia_frame * fr
 
 		if (pThis->_RemoteSock != PJ_INVALID_SOCKET)
 		{
-			static pj_ssize_t size = sizeof(RemotePayload);
-
-			pThis->_RemotePayload.Size = SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8);
-			memcpy(pThis->_RemotePayload.Data, (SipAgent::SndSamplingRate != SAMPLING_RATE ? pThis->_SndIn : pThis->_SndInBuf), SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8));
-
-			pj_sock_sendto(pThis->_RemoteSock, &pThis->_RemotePayload, &size, 0, &pThis->_RemoteTo, sizeof(pThis->_RemoteTo));
+			pThis->_RemoteTx.Send(pThis->_RemoteSock, &pThis->_RemoteTo, (SipAgent::SndSamplingRate != SAMPLING_RATE ? pThis->_SndIn : pThis->_SndInBuf));
 		}
 	}
 
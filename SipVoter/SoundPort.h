@@ -11,16 +11,7 @@
 #ifndef __CORESIP_SOUNDPORT_H__
 #define __CORESIP_SOUNDPORT_H__
 
-/**
- * RemotePayload: ...
- */
-struct RemotePayload
-{
-	char SrcId[CORESIP_MAX_USER_ID_LENGTH + 1];
-	CORESIP_SndDevType SrcType;
-	unsigned Size;
-	char Data[SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8)];
-};
+#include "RemoteAudio.h"
 
 /**
  * SoundPort: Encapsula y particulariza las funciones de 'pjmedia_port' en esta aplicacin.
@@ -65,9 +56,6 @@ public:
 
 private:
 
-	pj_uint16_t contador_muestra;
-	pj_uint16_t contador_paquete;
-	
 	/**
 	 * Pool de Memoria asociada al objeto.
 	 */
@@ -85,9 +73,9 @@ private:
 	 */
 	pj_sockaddr_in _RemoteTo;
 	/**
-	 * ???
+	 * Trama de audio que se envia a _RemoteTo.
 	 */
-	RemotePayload _RemotePayload;
+	RemoteAudioTx _RemoteTx;
 	/**
 	 * Objeto Puerto PJMEDIA...
 	 */
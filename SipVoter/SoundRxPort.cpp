@@ -22,7 +22,7 @@ SoundRxPort::SoundRxPort(const char * id, unsigned clkRate, unsigned channelCoun
 			st = pjmedia_delay_buf_create(_Pool, NULL, clkRate, samplesPerFrame, channelCount, SipAgent::DefaultDelayBufPframes * frameTime, 0, &_SndInBufs[i]);
 			PJ_CHECK_STATUS(st, ("ERROR creando SoundRxPort::_SndInfBuf"));
 
-			pjmedia_port_info_init(&_Ports[i].info, &(pj_str("SNDP")), PJMEDIA_PORT_SIGNATURE('S', 'N', 'D', 'P'), 
+			pjmedia_port_info_init(&_Ports[i].info, StrPtr(pj_str("SNDP")), PJMEDIA_PORT_SIGNATURE('S', 'N', 'D', 'P'), 
 				clkRate, channelCount, bitsPerSample, samplesPerFrame);
 
 			_Ports[i].port_data.pdata = this;
@@ -70,65 +70,123 @@ void SoundRxPort::Dispose()
 	}
 }
 
-void SoundRxPort::PutFrame(CORESIP_SndDevType type, void * data, unsigned size)
+/**
+ * PutFrame.	...
+ * Contabiliza la trama por su secuencia y la pasa al buffer del tipo de emisor. Las repetidas y las que llegan
+ * demasiado tarde se descartan.
+ */
+void SoundRxPort::PutFrame(const RemoteAudioFrame * fr)
 {
 	Guard lock(_Lock);
 
-	pj_bool_t igual = PJ_TRUE;
-	int muestras_distintas = 0;
-	int muestras_cero = 0;
-	pj_uint16_t valor_no_igual = 0;
+	if (Account(fr))
+	{
+		pjmedia_delay_buf_put(_SndInBufs[fr->SrcType], (pj_int16_t*)fr->Samples);
+	}
+}
 
-	pj_uint16_t *data_uint16 = (pj_uint16_t *) data;
+/**
+ * Account.	...
+ * Estadisticas de recepcion de la trama, solo a partir de la cabecera:
+ * - Perdidas: huecos en la secuencia, que se descuentan si la trama llega despues.
+ * - Repetidas: secuencias ya recibidas entre las ultimas 64.
+ * - Desordenadas: llegan tras otras posteriores pero dentro de la profundidad del buffer. Si no, tardias.
+ * - Jitter entre llegadas como en RFC 3550, con la llegada y el Ts en microsegundos.
+ * Un salto de secuencia fuera de esos margenes se toma como un emisor que ha vuelto a arrancar.
+ * @return	PJ_TRUE si la trama se debe reproducir.
+ */
+pj_bool_t SoundRxPort::Account(const RemoteAudioFrame * fr)
+{
+	static const pj_int32_t MAX_DROPOUT = 3000;		//Tramas, 60 segundos
+	static const pj_int32_t MAX_MISORDER = 64;		//Bits de SeqState::Window
+	static double us_per_tick = 0;
 
-	//PJ_LOG(3,(__FILE__, "INCIPALMA:  %d ", *data_uint16));
+	CORESIP_SndRxStats & st = _Stats[fr->SrcType];
+	SeqState & s = _Seq[fr->SrcType];
 
-	for (unsigned i = 0; i < (size / 2); i++)
+	st.SrcType = fr->SrcType;
+	st.Received++;
+	if (fr->Name != NULL)
 	{
-		if (*data_uint16 == 0)
-		{
-			muestras_cero++;
-		}
-		if (contador_prueba != *data_uint16)
-		{
-			if (igual == PJ_TRUE)
-			{
-				valor_no_igual = *data_uint16;
-				igual = PJ_FALSE;
-			}
-			muestras_distintas++;
-		}		
-		data_uint16++;
-	}	
-
-	if (muestras_cero == size/2)
+		st.Unsequenced++;
+		return PJ_TRUE;
+	}
+
+	if (us_per_tick == 0)
+	{
+		pj_timestamp freq;
+		pj_get_timestamp_freq(&freq);
+		us_per_tick = 1e6 / (double) freq.u64;
+	}
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	double transit = (double) now.u64 * us_per_tick - (double) fr->Ts * (1e6 / SAMPLING_RATE);
+
+	pj_int32_t delta = (pj_int32_t) (fr->Seq - s.MaxSeq);
+	if (!s.Started || delta > MAX_DROPOUT || delta <= -MAX_MISORDER)
+	{
+		if (s.Started) st.Restarts++;
+		s.Started = PJ_TRUE;
+		s.BaseSeq = fr->Seq;
+		s.MaxSeq = fr->Seq;
+		s.Window = 1;
+		s.HaveTransit = PJ_FALSE;
+	}
+	else if (delta > 0)
 	{
-		//Ha habido un PTT nuevo o se ha dado la vuelta al contador. reiniciamos
-		contador_prueba = 1;			//El proximo paquete tendra que llegar con unos
-		contador_ultimo = 0;
-		igual = PJ_TRUE;
+		st.Lost += delta - 1;
+		s.Window = delta >= MAX_MISORDER ? 1 : (s.Window << delta) | 1;
+		s.MaxSeq = fr->Seq;
 	}
-	else if (igual == PJ_FALSE)
-	{		
-		if (valor_no_igual == contador_ultimo && muestras_distintas == size/2)
+	else if ((pj_int32_t) (fr->Seq - s.BaseSeq) < 0)
+	{
+		//Anterior al arranque del emisor, no se habia contado como perdida
+		st.Late++;
+		return PJ_FALSE;
+	}
+	else
+	{
+		pj_uint64_t bit = (pj_uint64_t) 1 << -delta;
+		if (s.Window & bit)
 		{
-			PJ_LOG(3,(__FILE__, "INCIPALMA: FALLO EN MCAST. PAQUETE REPETIDO %d esperado %d desde %s nmuestras erroneas %d", valor_no_igual, contador_prueba, Id, muestras_distintas));
-			contador_prueba = contador_ultimo + 1;
+			st.Duplicated++;
+			return PJ_FALSE;
 		}
-		else
+		s.Window |= bit;
+		st.Lost--;
+		if ((unsigned) -delta >= SipAgent::DefaultDelayBufPframes)
 		{
-			PJ_LOG(3,(__FILE__, "INCIPALMA: FALLO EN MCAST. PAQUETE ERRONEO %d esperado %d desde %s nmuestras erroneas %d", valor_no_igual, contador_prueba, Id, muestras_distintas));
-			contador_ultimo = valor_no_igual;
-			contador_prueba = valor_no_igual + 1;
-		}		
+			st.Late++;
+			return PJ_FALSE;
+		}
+		st.Reordered++;
 	}
-	else
+
+	if (s.HaveTransit)
 	{
-		contador_ultimo = contador_prueba;
-		contador_prueba++;		
+		double d = transit - s.Transit;
+		_JitterUs[fr->SrcType] += ((d < 0 ? -d : d) - _JitterUs[fr->SrcType]) / 16.0;
+		st.JitterMs = (float) (_JitterUs[fr->SrcType] / 1000.0);
 	}
+	s.Transit = transit;
+	s.HaveTransit = PJ_TRUE;
 
-	pjmedia_delay_buf_put(_SndInBufs[type], (pj_int16_t*)data);
+	return PJ_TRUE;
+}
+
+/**
+ * GetStats.	...
+ * @param	stats	Estadisticas de cada tipo de emisor, desde que se creo el puerto.
+ */
+void SoundRxPort::GetStats(CORESIP_SndRxStats stats[CORESIP_SND_MAX_IN_DEVICES])
+{
+	Guard lock(_Lock);
+
+	for (int i = 0; i < CORESIP_SND_MAX_IN_DEVICES; i++)
+	{
+		stats[i] = _Stats[i];
+		stats[i].SrcType = (CORESIP_SndDevType) i;
+	}
 }
 
 pj_status_t SoundRxPort::GetFrame(pjmedia_port * port, pjmedia_frame * frame)
@@ -1,6 +1,8 @@
 #ifndef __CORESIP_SOUNDRXPORT_H__
 #define __CORESIP_SOUNDRXPORT_H__
 
+#include "RemoteAudio.h"
+
 class SoundRxPort
 {
 public:
@@ -11,7 +13,8 @@ public:
 	SoundRxPort(const char * id, unsigned clkRate, unsigned channelCount, unsigned bitsPerSample, unsigned frameTime);
 	~SoundRxPort();
 
-	void PutFrame(CORESIP_SndDevType type, void * data, unsigned size);
+	void PutFrame(const RemoteAudioFrame * fr);
+	void GetStats(CORESIP_SndRxStats stats[CORESIP_SND_MAX_IN_DEVICES]);
 
 private:
 	pj_pool_t * _Pool;
@@ -19,11 +22,24 @@ private:
 	pjmedia_delay_buf * _SndInBufs[CORESIP_SND_MAX_IN_DEVICES];
 	pj_lock_t * _Lock;
 
-	pj_uint16_t contador_prueba;
-	pj_uint16_t contador_ultimo;
+	/** Secuencia recibida de cada tipo de emisor (formato compacto) */
+	struct SeqState
+	{
+		pj_bool_t Started;
+		pj_uint32_t BaseSeq;				//Primera secuencia desde que arranco el emisor
+		pj_uint32_t MaxSeq;					//Mayor secuencia recibida
+		pj_uint64_t Window;					//Bit n: recibida MaxSeq - n
+		pj_bool_t HaveTransit;
+		double Transit;						//Llegada menos Ts de la ultima trama, en us
+	};
+
+	SeqState _Seq[CORESIP_SND_MAX_IN_DEVICES];
+	CORESIP_SndRxStats _Stats[CORESIP_SND_MAX_IN_DEVICES];
+	double _JitterUs[CORESIP_SND_MAX_IN_DEVICES];
 
 private:
 	void Dispose();
+	pj_bool_t Account(const RemoteAudioFrame * fr);
 
 	static pj_status_t GetFrame(pjmedia_port * port, pjmedia_frame * frame);
 	static pj_status_t Reset(pjmedia_port * port);
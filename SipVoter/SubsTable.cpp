@@ -0,0 +1,162 @@
+/**
+ * @file SubsTable.cpp
+ * @brief Tabla de subscripciones indexada por usuario y dominio en CORESIP.dll
+ *
+ *	Implementa la clase 'SubsTable'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include "Global.h"
+#include "SubsTable.h"
+
+#define PARSE_POOL_SIZE		8192		//Memoria en la pila para el parser de la uri
+
+SubsTable::SubsTable()
+{
+	_Pool = NULL;
+	_Hash = NULL;
+	_Free = NULL;
+	_Count = 0;
+	_Max = 0;
+}
+
+/**
+ * Init.	...
+ * Crea la tabla hash.
+ * @param	pool	Pool del gestor. Las entradas se reservan en el y duran lo que dure el pool.
+ * @param	max		Numero maximo de subscripciones.
+ */
+void SubsTable::Init(pj_pool_t * pool, unsigned max)
+{
+	_Pool = pool;
+	_Max = max;
+	_Hash = pj_hash_create(pool, max);
+}
+
+/**
+ * MakeKey.	...
+ * Obtiene la clave "user@domain" de una uri de destino. La uri se analiza con un pool en la pila.
+ * @param	dst		Uri de destino.
+ * @param	key		Buffer de MAX_KEY caracteres para la clave.
+ * @param	len		Longitud de la clave.
+ * @return	PJ_SUCCESS, o error si la uri no es una uri sip valida.
+ */
+pj_status_t SubsTable::MakeKey(const char * dst, char * key, unsigned * len)
+{
+	char buf[PARSE_POOL_SIZE];
+	pj_str_t uri_aux, uri_dup;
+
+	uri_aux.ptr = (char *) dst;
+	uri_aux.slen = strlen(dst);
+	if (uri_aux.slen >= MAX_KEY) return PJ_ETOOBIG;
+
+	/*Se crea un string duplicado para el parse, ya que se ha visto que
+	pjsip_parse_uri puede modificar el parametro de entrada*/
+	pj_pool_t * pool = pj_pool_create_on_buf("SubsTable", buf, sizeof(buf));
+	pj_strdup_with_null(pool, &uri_dup, &uri_aux);
+
+	pjsip_uri * uri = pjsip_parse_uri(pool, uri_dup.ptr, uri_dup.slen, 0);
+	if (uri == NULL) return PJSIP_EINVALIDURI;
+
+	pjsip_uri * inner = (pjsip_uri *) pjsip_uri_get_uri(uri);
+	if (!PJSIP_URI_SCHEME_IS_SIP(inner) && !PJSIP_URI_SCHEME_IS_SIPS(inner)) return PJSIP_EINVALIDSCHEME;
+
+	pjsip_sip_uri * url = (pjsip_sip_uri *) inner;
+	if (url->user.slen + 1 + url->host.slen >= MAX_KEY) return PJ_ETOOBIG;
+
+	pj_memcpy(key, url->user.ptr, url->user.slen);
+	key[url->user.slen] = '@';
+	pj_memcpy(key + url->user.slen + 1, url->host.ptr, url->host.slen);
+	*len = (unsigned) (url->user.slen + 1 + url->host.slen);
+	key[*len] = '\0';
+
+	return PJ_SUCCESS;
+}
+
+/**
+ * Find.	...
+ * @return	El objeto de la subscripcion, o NULL si no esta.
+ */
+void * SubsTable::Find(const char * key, unsigned len)
+{
+	Entry * e = (Entry *) pj_hash_get(_Hash, key, len, NULL);
+	return e ? e->subs : NULL;
+}
+
+/**
+ * Insert.	...
+ * Agrega una subscripcion.
+ * @return	PJ_SUCCESS, PJ_EEXISTS si ya hay una con la misma clave o PJ_ETOOMANY si se ha alcanzado el maximo.
+ */
+pj_status_t SubsTable::Insert(const char * key, unsigned len, void * subs)
+{
+	pj_uint32_t hval = 0;
+
+	if (len >= MAX_KEY) return PJ_ETOOBIG;
+	if (pj_hash_get(_Hash, key, len, &hval) != NULL) return PJ_EEXISTS;
+	if (_Count >= _Max) return PJ_ETOOMANY;
+
+	Entry * e = _Free;
+	if (e != NULL)
+	{
+		_Free = e->next;
+	}
+	else
+	{
+		e = (Entry *) pj_pool_alloc(_Pool, sizeof(Entry));
+		if (e == NULL) return PJ_ENOMEM;
+	}
+
+	pj_memcpy(e->key, key, len);
+	e->key[len] = '\0';
+	e->subs = subs;
+	e->next = NULL;
+
+	//La tabla guarda el puntero a la clave, que por eso esta en la entrada
+	pj_hash_set_np(_Hash, e->key, len, hval, e->hbuf, e);
+	_Count++;
+
+	return PJ_SUCCESS;
+}
+
+/**
+ * Remove.	...
+ * Quita una subscripcion. La entrada queda libre para la siguiente.
+ * @return	El objeto de la subscripcion, o NULL si no estaba.
+ */
+void * SubsTable::Remove(const char * key, unsigned len)
+{
+	pj_uint32_t hval = 0;
+
+	Entry * e = (Entry *) pj_hash_get(_Hash, key, len, &hval);
+	if (e == NULL) return NULL;
+
+	void * subs = e->subs;
+	pj_hash_set_np(_Hash, key, len, hval, NULL, NULL);
+	e->subs = NULL;
+	e->next = _Free;
+	_Free = e;
+	_Count--;
+
+	return subs;
+}
+
+/**
+ * RemoveFirst.	...
+ * Quita una subscripcion cualquiera. Sirve para vaciar la tabla.
+ * @return	El objeto de la subscripcion, o NULL si la tabla esta vacia.
+ */
+void * SubsTable::RemoveFirst()
+{
+	pj_hash_iterator_t it_buf;
+
+	pj_hash_iterator_t * it = pj_hash_first(_Hash, &it_buf);
+	if (it == NULL) return NULL;
+
+	Entry * e = (Entry *) pj_hash_this(_Hash, it);
+	return Remove(e->key, (unsigned) strlen(e->key));
+}
+
+/*@}*/
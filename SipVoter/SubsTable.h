@@ -0,0 +1,56 @@
+/**
+ * @file SubsTable.h
+ * @brief Tabla de subscripciones indexada por usuario y dominio en CORESIP.dll
+ *
+ *	Implementa la clase 'SubsTable'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_SUBSTABLE_H__
+#define __CORESIP_SUBSTABLE_H__
+
+#include "Global.h"
+
+/**
+ * SubsTable.
+ * Subscripciones de SubsManager y PresenceManag. Cada una se identifica por el usuario y el dominio de la uri
+ * de destino, que se guardan juntos ("user@domain") en la propia entrada y se buscan en una tabla hash de pjlib.
+ * Las entradas se toman del pool del gestor al ir haciendo falta y las que se liberan se reutilizan.
+ * No tiene mutex propio: la protege el del gestor.
+ */
+class SubsTable
+{
+public:
+	static const int MAX_KEY = CORESIP_MAX_URI_LENGTH + 1;		//Longitud maxima de la clave y de la uri de destino
+
+	SubsTable();
+	void Init(pj_pool_t * pool, unsigned max);
+
+	static pj_status_t MakeKey(const char * dst, char * key, unsigned * len);
+
+	void * Find(const char * key, unsigned len);
+	pj_status_t Insert(const char * key, unsigned len, void * subs);
+	void * Remove(const char * key, unsigned len);
+	void * RemoveFirst();
+
+private:
+	struct Entry
+	{
+		pj_hash_entry_buf hbuf;					//Nodo de la tabla hash. Insertar no reserva memoria
+		Entry * next;							//Siguiente entrada libre
+		void * subs;							//Objeto que gestiona la subscripcion
+		char key[MAX_KEY];						//"user@domain" de la uri de destino
+	};
+
+	pj_pool_t * _Pool;
+	pj_hash_table_t * _Hash;
+	Entry * _Free;
+	unsigned _Count;
+	unsigned _Max;
+};
+
+#endif
+
+/*@}*/
@@ -0,0 +1,105 @@
+/**
+ * @file WavIo.cpp
+ * @brief Acceso a los ficheros de los reproductores y grabadores wav en CORESIP.dll
+ *
+ *	Implementa la clase 'WavIo'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#include "Global.h"
+#include "WavIo.h"
+
+volatile pj_bool_t WavIo::_Enabled = PJ_TRUE;
+volatile unsigned WavIo::_DelayMs = 0;
+volatile unsigned WavIo::_DelayEvery = 0;
+
+/**
+ * Enable.	...
+ * @param	on	PJ_FALSE para que los reproductores y grabadores que se creen accedan al fichero desde el mezclador.
+ */
+void WavIo::Enable(pj_bool_t on)
+{
+	_Enabled = on;
+}
+
+/**
+ * Enabled.	...
+ * @return	PJ_TRUE si los reproductores y grabadores nuevos deben tener thread de acceso al fichero.
+ */
+pj_bool_t WavIo::Enabled()
+{
+	return _Enabled;
+}
+
+/**
+ * SetTestDelay.	...
+ * Simula un disco lento: uno de cada 'every' accesos al fichero de cada reproductor o grabador tarda 'ms' mas.
+ * @param	ms		Retardo. 0 lo desactiva.
+ * @param	every	Accesos entre retardos.
+ */
+void WavIo::SetTestDelay(unsigned ms, unsigned every)
+{
+	_DelayEvery = every;
+	_DelayMs = ms;
+}
+
+/**
+ * WavIo.	...
+ * Constructor.
+ */
+WavIo::WavIo()
+{
+	Frames.store(0);
+	Underruns.store(0);
+	Overruns.store(0);
+	_MaxIoUs.store(0);
+	_Count = 0;
+	_T0.u64 = 0;
+}
+
+/**
+ * Begin.	...
+ * Se llama antes de cada acceso al fichero, desde el thread que lo hace.
+ */
+void WavIo::Begin()
+{
+	pj_get_timestamp(&_T0);
+}
+
+/**
+ * End.	...
+ * Se llama despues de cada acceso al fichero. Aplica el retardo de SetTestDelay() y actualiza el maximo.
+ */
+void WavIo::End()
+{
+	unsigned ms = _DelayMs;
+	if (ms > 0 && ++_Count >= _DelayEvery)
+	{
+		_Count = 0;
+		pj_thread_sleep(ms);
+	}
+
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	unsigned us = pj_elapsed_usec(&_T0, &now);
+	if (us > _MaxIoUs.load(std::memory_order_relaxed))
+	{
+		_MaxIoUs.store(us, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * GetStats.	...
+ * @param	stats	Tramas, tramas sin audio leido o sin sitio para escribirlas, y acceso mas lento al fichero.
+ */
+void WavIo::GetStats(CORESIP_WavStats * stats)
+{
+	stats->Frames = Frames.load(std::memory_order_relaxed);
+	stats->Underruns = Underruns.load(std::memory_order_relaxed);
+	stats->Overruns = Overruns.load(std::memory_order_relaxed);
+	stats->MaxIoUs = _MaxIoUs.load(std::memory_order_relaxed);
+}
+
+/*@}*/
@@ -0,0 +1,55 @@
+/**
+ * @file WavIo.h
+ * @brief Acceso a los ficheros de los reproductores y grabadores wav en CORESIP.dll
+ *
+ *	Implementa la clase 'WavIo'.
+ *
+ *	@addtogroup CORESIP
+ */
+/*@{*/
+
+#ifndef __CORESIP_WAVIO_H__
+#define __CORESIP_WAVIO_H__
+
+#include <atomic>
+
+/**
+ * WavIo.
+ * WavPlayer y WavRecorder no leen ni escriben el fichero desde el thread del mezclador, que no debe esperar
+ * al disco: cada uno tiene un thread propio que va leyendo por delante, o escribiendo por detras, a traves de
+ * un AudioRing. El mezclador solo copia muestras del buffer o al buffer.
+ * Esta clase recoge lo que comparten: el tiempo de cada acceso al fichero y los contadores de
+ * CORESIP_GetWavPlayerStats y CORESIP_GetWavRecorderStats.
+ *
+ * Enable(PJ_FALSE) hace que los que se creen despues accedan al fichero desde el mezclador, como antes, y
+ * SetTestDelay() alarga algunos accesos. Solo los usan las pruebas de carga.
+ */
+class WavIo
+{
+public:
+	static void Enable(pj_bool_t on);
+	static pj_bool_t Enabled();
+	static void SetTestDelay(unsigned ms, unsigned every);
+
+	WavIo();
+	void Begin();
+	void End();
+	void GetStats(CORESIP_WavStats * stats);
+
+	std::atomic<unsigned> Frames;
+	std::atomic<unsigned> Underruns;
+	std::atomic<unsigned> Overruns;
+
+private:
+	static volatile pj_bool_t _Enabled;
+	static volatile unsigned _DelayMs;
+	static volatile unsigned _DelayEvery;
+
+	pj_timestamp _T0;								//Inicio del acceso en curso
+	unsigned _Count;								//Accesos al fichero
+	std::atomic<unsigned> _MaxIoUs;
+};
+
+#endif
+
+/*@}*/
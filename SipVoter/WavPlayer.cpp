@@ -3,28 +3,54 @@
 #include "Exceptions.h"
 
 WavPlayer::WavPlayer(const char * file, unsigned frameTime, bool loop, pj_status_t (*eofCb)(pjmedia_port *, void*), void * userData)
-: _Pool(NULL), _Port(NULL)
+: _Pool(NULL), _File(NULL), _EofCb(loop ? NULL : eofCb), _UserData(userData), _EofSent(PJ_FALSE),
+  _Ring(NULL), _LowMark(0), _Buf(NULL), _Pending(PJ_FALSE), _Sem(NULL), _Thread(NULL)
 {
+	_FileEof.store(PJ_FALSE);
+	_Wake.store(PJ_FALSE);
+	_Run.store(PJ_FALSE);
+	Slot = PJSUA_INVALID_ID;
+
 	_Pool = pjsua_pool_create(NULL, 4096, 512);
 
 	try
 	{
-		pj_status_t st = pjmedia_wav_player_port_create(_Pool, file, frameTime, loop ? 0 : PJMEDIA_FILE_NO_LOOP, 0, &_Port);
+		pj_status_t st = pjmedia_wav_player_port_create(_Pool, file, frameTime, loop ? 0 : PJMEDIA_FILE_NO_LOOP, 0, &_File);
 		PJ_CHECK_STATUS(st, ("ERROR creando WavPlayer", "[File=%s]", file));
 
-		if (!loop)
+		pj_str_t name;
+		pj_bzero(&_Port, sizeof(_Port));
+		pjmedia_port_info_init(&_Port.info, pj_cstr(&name, "WAVP"), PJMEDIA_PORT_SIGNATURE('W', 'A', 'V', 'P'),
+			_File->info.clock_rate, _File->info.channel_count, 16, _File->info.samples_per_frame);
+		_Port.port_data.pdata = this;
+		_Port.get_frame = &GetFrame;
+
+		if (WavIo::Enabled())
 		{
-			pjmedia_wav_player_set_eof_cb(_Port, userData, eofCb);
+			unsigned prefetch = _File->info.clock_rate * _File->info.channel_count * PREFETCH_MS / 1000;
+			_Ring = new AudioRing(_Pool, prefetch);
+			_LowMark = prefetch / 2;
+			_Buf = (pj_int16_t *) pj_pool_alloc(_Pool, _Port.info.bytes_per_frame);
+
+			//La primera lectura se hace aqui, como hacia pjmedia al abrir el fichero
+			_Run.store(PJ_TRUE);
+			Fill();
+
+			st = pj_sem_create(_Pool, NULL, 0, 1, &_Sem);
+			PJ_CHECK_STATUS(st, ("ERROR creando semaforo de WavPlayer", "[File=%s]", file));
+			st = pj_thread_create(_Pool, "WavPlayerIo", &IoThread, this, 0, 0, &_Thread);
+			PJ_CHECK_STATUS(st, ("ERROR creando thread de lectura de WavPlayer", "[File=%s]", file));
 		}
 
-		st = pjsua_conf_add_port(_Pool, _Port, &Slot);
+		st = pjsua_conf_add_port(_Pool, &_Port, &Slot);
 		PJ_CHECK_STATUS(st, ("ERROR enlazando WavPlayer al mezclador", "[File=%s]", file));
 	}
 	catch (...)
 	{
-		if (_Port)
+		Stop();
+		if (_File)
 		{
-			pjmedia_port_destroy(_Port);
+			pjmedia_port_destroy(_File);
 		}
 		pj_pool_release(_Pool);
 
@@ -35,6 +61,193 @@ WavPlayer::WavPlayer(const char * file, unsigned frameTime, bool loop, pj_status
 WavPlayer::~WavPlayer()
 {
 	pjsua_conf_remove_port(Slot);
-	pjmedia_port_destroy(_Port);
+	Stop();
+	pjmedia_port_destroy(_File);
 	pj_pool_release(_Pool);
 }
+
+/**
+ * GetStats.	...
+ * @param	stats	Tramas entregadas al mezclador, las que no estaban leidas y la lectura mas lenta.
+ */
+void WavPlayer::GetStats(CORESIP_WavStats * stats)
+{
+	_Io.GetStats(stats);
+}
+
+/**
+ * Stop.	...
+ * Para el thread de lectura y libera el buffer.
+ */
+void WavPlayer::Stop()
+{
+	_Run.store(PJ_FALSE);
+	if (_Thread != NULL)
+	{
+		pj_sem_post(_Sem);
+		pj_thread_join(_Thread);
+		pj_thread_destroy(_Thread);
+		_Thread = NULL;
+	}
+	if (_Sem != NULL)
+	{
+		pj_sem_destroy(_Sem);
+		_Sem = NULL;
+	}
+	if (_Ring != NULL)
+	{
+		delete _Ring;
+		_Ring = NULL;
+	}
+}
+
+/**
+ * ReadFile.	...
+ * Lee una trama del fichero.
+ * @param	buf		Buffer de _Port.info.bytes_per_frame bytes.
+ * @return	PJ_SUCCESS, o PJ_EEOF u otro error si no hay mas audio.
+ */
+pj_status_t WavPlayer::ReadFile(void * buf)
+{
+	pjmedia_frame frame;
+
+	frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	frame.buf = buf;
+	frame.size = _Port.info.bytes_per_frame;
+	frame.timestamp.u64 = 0;
+	frame.bit_info = 0;
+
+	_Io.Begin();
+	pj_status_t st = pjmedia_port_get_frame(_File, &frame);
+	_Io.End();
+
+	if (st == PJ_SUCCESS && frame.type != PJMEDIA_FRAME_TYPE_AUDIO)
+	{
+		st = PJ_EEOF;
+	}
+	return st;
+}
+
+/**
+ * Fill.	...
+ * Thread de lectura. Lee tramas del fichero hasta llenar _Ring o llegar al final.
+ * Si una trama no cabe se guarda en _Buf para la siguiente vez.
+ */
+void WavPlayer::Fill()
+{
+	while (_Run.load() && !_FileEof.load())
+	{
+		if (!_Pending)
+		{
+			pj_status_t st = ReadFile(_Buf);
+			if (st != PJ_SUCCESS)
+			{
+				if (st != PJ_EEOF)
+				{
+					PJ_LOG(3,("WavPlayer", "ERROR leyendo %.*s: %d", (int) _File->info.name.slen, _File->info.name.ptr, st));
+				}
+				_FileEof.store(PJ_TRUE);
+				break;
+			}
+			_Pending = PJ_TRUE;
+		}
+		if (!_Ring->Write(_Buf, _Port.info.samples_per_frame))
+		{
+			break;
+		}
+		_Pending = PJ_FALSE;
+	}
+}
+
+/**
+ * Wake.	...
+ * Mezclador. Despierta al thread de lectura si no se ha hecho ya.
+ */
+void WavPlayer::Wake()
+{
+	if (!_Wake.exchange(PJ_TRUE))
+	{
+		pj_sem_post(_Sem);
+	}
+}
+
+/**
+ * IoThread.	...
+ * Thread de lectura. Rellena el buffer cada vez que el mezclador lo despierta.
+ */
+int WavPlayer::IoThread(void * proc)
+{
+	WavPlayer * pThis = reinterpret_cast<WavPlayer*>(proc);
+
+	while (pThis->_Run.load())
+	{
+		pThis->_Wake.store(PJ_FALSE);
+		pThis->Fill();
+		pj_sem_wait(pThis->_Sem);
+	}
+
+	return 0;
+}
+
+/**
+ * Eof.	...
+ * Mezclador. Fin del fichero: se avisa una vez, y hasta que se destruya el reproductor se entregan tramas
+ * vacias. eofCb no debe destruirlo desde aqui: el destructor espera al thread de lectura.
+ */
+pj_status_t WavPlayer::Eof(pjmedia_frame * frame)
+{
+	frame->type = PJMEDIA_FRAME_TYPE_NONE;
+	frame->size = 0;
+
+	if (_EofCb != NULL && !_EofSent)
+	{
+		_EofSent = PJ_TRUE;
+		_EofCb(&_Port, _UserData);
+	}
+	return PJ_EEOF;
+}
+
+/**
+ * GetFrame.	...
+ * Mezclador. Saca una trama del buffer, o la lee del fichero si no hay thread de lectura.
+ */
+pj_status_t WavPlayer::GetFrame(pjmedia_port * port, pjmedia_frame * frame)
+{
+	WavPlayer * pThis = reinterpret_cast<WavPlayer*>(port->port_data.pdata);
+
+	if (pThis->_Ring == NULL)
+	{
+		if (pThis->_EofSent || pThis->ReadFile(frame->buf) != PJ_SUCCESS)
+		{
+			return pThis->Eof(frame);
+		}
+	}
+	else
+	{
+		//_FileEof antes que el buffer: si ya estaba, todo lo leido esta en el buffer
+		pj_bool_t eof = pThis->_FileEof.load();
+
+		if (pThis->_Ring->Read((pj_int16_t *) frame->buf, port->info.samples_per_frame))
+		{
+			if (!eof && pThis->_Ring->GetLen() < pThis->_LowMark)
+			{
+				pThis->Wake();
+			}
+		}
+		else if (eof)
+		{
+			return pThis->Eof(frame);
+		}
+		else
+		{
+			pj_bzero(frame->buf, port->info.bytes_per_frame);
+			pThis->_Io.Underruns++;
+			pThis->Wake();
+		}
+	}
+
+	frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+	frame->size = port->info.bytes_per_frame;
+	pThis->_Io.Frames++;
+	return PJ_SUCCESS;
+}
@@ -1,6 +1,16 @@
 #ifndef __CORESIP_WAVPLAYER_H__
 #define __CORESIP_WAVPLAYER_H__
 
+#include "AudioRing.h"
+#include "WavIo.h"
+
+/**
+ * WavPlayer.
+ * El fichero lo lee un thread propio, que mantiene PREFETCH_MS de audio por delante en _Ring. El mezclador
+ * solo saca tramas del buffer; si esta vacio entrega silencio y cuenta un underrun. Al acabar un fichero sin
+ * bucle se llama a eofCb desde el mezclador, cuando ya se ha reproducido todo lo leido. eofCb no debe destruir
+ * el reproductor desde el mezclador (SipAgent::OnWavPlayerEof lo deja para el thread de pjsua).
+ */
 class WavPlayer
 {
 public:
@@ -10,9 +20,37 @@ public:
 	WavPlayer(const char * file, unsigned frameTime, bool loop, pj_status_t (*eofCb)(pjmedia_port *, void*), void * userData);
 	~WavPlayer();
 
+	void GetStats(CORESIP_WavStats * stats);
+
 private:
+	static const unsigned PREFETCH_MS = 500;
+
 	pj_pool_t * _Pool;
-	pjmedia_port * _Port;
+	pjmedia_port * _File;							//Puerto de pjmedia que lee el fichero
+	pjmedia_port _Port;								//Puerto del mezclador
+	pj_status_t (*_EofCb)(pjmedia_port *, void*);
+	void * _UserData;
+	pj_bool_t _EofSent;
+
+	AudioRing * _Ring;								//NULL si se lee desde el mezclador (WavIo::Enable)
+	unsigned _LowMark;								//Por debajo de estas muestras se despierta al thread
+	pj_int16_t * _Buf;								//Trama leida que no cabia en _Ring
+	pj_bool_t _Pending;
+	std::atomic<pj_bool_t> _FileEof;				//El thread ha leido todo el fichero
+	std::atomic<pj_bool_t> _Wake;
+	std::atomic<pj_bool_t> _Run;
+	pj_sem_t * _Sem;
+	pj_thread_t * _Thread;
+	WavIo _Io;
+
+	pj_status_t ReadFile(void * buf);
+	void Fill();
+	void Wake();
+	void Stop();
+	pj_status_t Eof(pjmedia_frame * frame);
+
+	static int IoThread(void * proc);
+	static pj_status_t GetFrame(pjmedia_port * port, pjmedia_frame * frame);
 };
 
 #endif
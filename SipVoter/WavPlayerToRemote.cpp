@@ -71,9 +71,7 @@ void WavPlayerToRemote::Send2Remote(const char * id, const char * ip, unsigned p
 {
 	if (_RemoteSock == PJ_INVALID_SOCKET)
 	{
-		pj_ansi_strcpy(_RemotePayload.SrcId, id);
-
-		_RemotePayload.SrcType = CORESIP_SND_INSTRUCTOR_MHP;		// Emulo al Instructor...
+		_RemoteTx.Init(id, CORESIP_SND_INSTRUCTOR_MHP, SipAgent::Coresip_Local_Config._Remote_Audio_Format);		// Emulo al Instructor...
 
 		pj_status_t st = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &_RemoteSock);	
 		PJ_CHECK_STATUS(st, ("ERROR creando socket para el envio de radio por unicast"));
@@ -89,7 +87,7 @@ void WavPlayerToRemote::Send2Remote(const char * id, const char * ip, unsigned p
 			PJ_LOG(3,(__FILE__, "ERROR: setsockopt, PJ_IP_MULTICAST_IF. El envio de audio a %s:%d no se puede forzar por el interface %s", 
 				ip, port, SipAgent::Get_uaIpAdd()));
 		
-		pj_sockaddr_in_init(&_RemoteTo, &(pj_str(const_cast<char*>(ip))), (pj_uint16_t)port);
+		pj_sockaddr_in_init(&_RemoteTo, StrPtr(pj_str(const_cast<char*>(ip))), (pj_uint16_t)port);
 
 #ifdef __PJTHREAD__
 		st = pj_thread_create(_thPool, "wav2rem", &Play, this, 0, 0, &thread); 
@@ -137,7 +135,7 @@ int WavPlayerToRemote::Play(void *proc)
 	{
 		/** Espero PTIME */
 		pj_thread_sleep(wp->_frameTime);
-		if (wp->Tick()==FALSE)
+		if (wp->Tick()==PJ_FALSE)
 		{
 			// wp->_eofCb(wp);
 			return 0;
@@ -151,14 +149,14 @@ int WavPlayerToRemote::Play(void *proc)
 void WavPlayerToRemote::TickPlay(const pj_timestamp *ts, void *user_data)
 {
 	WavPlayerToRemote *wp = (WavPlayerToRemote *)user_data;
-	if (wp->Tick()==FALSE)	
+	if (wp->Tick()==PJ_FALSE)	
 	{
 		pjmedia_clock_stop(wp->_clock);
 	}
 }
 
 /**  */
-BOOL WavPlayerToRemote::Tick(void)
+pj_bool_t WavPlayerToRemote::Tick(void)
 {
 	frame.buf = samplebuf;
 	frame.size = SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8);
@@ -166,19 +164,15 @@ BOOL WavPlayerToRemote::Tick(void)
 
 	if (status != PJ_SUCCESS || frame.type == PJMEDIA_FRAME_TYPE_NONE) 
 	{
-		return FALSE;
+		return PJ_FALSE;
 	}
 
 	if (_RemoteSock != PJ_INVALID_SOCKET)
 	{
-		static pj_ssize_t size = sizeof(WavRemotePayload);
-
-		_RemotePayload.Size = SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8);
-		memcpy(_RemotePayload.Data, samplebuf, SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8));
-		pj_sock_sendto(_RemoteSock, &_RemotePayload, &size, 0, &_RemoteTo, sizeof(_RemoteTo));
+		_RemoteTx.Send(_RemoteSock, &_RemoteTo, samplebuf);
 	}
 
-	return TRUE;
+	return PJ_TRUE;
 }
 
 
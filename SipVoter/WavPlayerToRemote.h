@@ -1,13 +1,6 @@
 #pragma once
 
-/** */
-struct WavRemotePayload
-{
-	char SrcId[CORESIP_MAX_USER_ID_LENGTH + 1];
-	CORESIP_SndDevType SrcType;
-	unsigned Size;
-	char Data[SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8)];
-};
+#include "RemoteAudio.h"
 
 class WavPlayerToRemote
 {
@@ -16,7 +9,7 @@ public:
 	~WavPlayerToRemote(void);
 
 	void Send2Remote(const char * id, const char * ip, unsigned port);
-	BOOL Tick(void );
+	pj_bool_t Tick(void );
 
 private:
 	static pj_thread_proc Play;
@@ -36,12 +29,10 @@ private:
 	pj_thread_t  *thread;
 	pjmedia_clock *_clock;
 
-    HANDLE ptrTimerHandle;			/** Temporizador de Windows... */
-
 
 	pj_sock_t _RemoteSock;
 	pj_sockaddr_in _RemoteTo;
-	WavRemotePayload _RemotePayload;
+	RemoteAudioTx _RemoteTx;
 
 	pj_int16_t samplebuf[SAMPLES_PER_FRAME * (BITS_PER_SAMPLE / 8) + 32];
 	pjmedia_frame frame;	
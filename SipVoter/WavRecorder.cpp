@@ -3,24 +3,48 @@
 #include "Exceptions.h"
 
 WavRecorder::WavRecorder(const char * file)
-: _Pool(NULL), _Port(NULL)
+: _Pool(NULL), _File(NULL), _Ring(NULL), _Buf(NULL), _Queued(0), _Sem(NULL), _Thread(NULL)
 {
+	_Wake.store(PJ_FALSE);
+	_Run.store(PJ_FALSE);
+	Slot = PJSUA_INVALID_ID;
+
 	_Pool = pjsua_pool_create(NULL, 4096, 512);
 
 	try
 	{
 		pj_status_t st = pjmedia_wav_writer_port_create(_Pool, file, SAMPLING_RATE, CHANNEL_COUNT, SAMPLES_PER_FRAME, BITS_PER_SAMPLE,
-			PJMEDIA_FILE_WRITE_PCM, 0, &_Port);
+			PJMEDIA_FILE_WRITE_PCM, 0, &_File);
 		PJ_CHECK_STATUS(st, ("ERROR creando WavRecorder", "[File=%s]", file));
 
-		st = pjsua_conf_add_port(_Pool, _Port, &Slot);
+		pj_str_t name;
+		pj_bzero(&_Port, sizeof(_Port));
+		pjmedia_port_info_init(&_Port.info, pj_cstr(&name, "WAVR"), PJMEDIA_PORT_SIGNATURE('W', 'A', 'V', 'R'),
+			SAMPLING_RATE, CHANNEL_COUNT, BITS_PER_SAMPLE, SAMPLES_PER_FRAME);
+		_Port.port_data.pdata = this;
+		_Port.put_frame = &PutFrame;
+
+		if (WavIo::Enabled())
+		{
+			_Ring = new AudioRing(_Pool, SAMPLING_RATE * CHANNEL_COUNT * WRITE_BEHIND_MS / 1000);
+			_Buf = (pj_int16_t *) pj_pool_alloc(_Pool, _Port.info.bytes_per_frame);
+
+			st = pj_sem_create(_Pool, NULL, 0, 1, &_Sem);
+			PJ_CHECK_STATUS(st, ("ERROR creando semaforo de WavRecorder", "[File=%s]", file));
+			_Run.store(PJ_TRUE);
+			st = pj_thread_create(_Pool, "WavRecorderIo", &IoThread, this, 0, 0, &_Thread);
+			PJ_CHECK_STATUS(st, ("ERROR creando thread de escritura de WavRecorder", "[File=%s]", file));
+		}
+
+		st = pjsua_conf_add_port(_Pool, &_Port, &Slot);
 		PJ_CHECK_STATUS(st, ("ERROR enlazando WavRecorder al mezclador", "[File=%s]", file));
 	}
 	catch (...)
 	{
-		if (_Port)
+		Stop();
+		if (_File)
 		{
-			pjmedia_port_destroy(_Port);
+			pjmedia_port_destroy(_File);
 		}
 		pj_pool_release(_Pool);
 
@@ -31,6 +55,129 @@ WavRecorder::WavRecorder(const char * file)
 WavRecorder::~WavRecorder()
 {
 	pjsua_conf_remove_port(Slot);
-	pjmedia_port_destroy(_Port);
+	Stop();
+	pjmedia_port_destroy(_File);
 	pj_pool_release(_Pool);
 }
+
+/**
+ * GetStats.	...
+ * @param	stats	Tramas recibidas del mezclador, las descartadas por tener el buffer lleno y la escritura mas lenta.
+ */
+void WavRecorder::GetStats(CORESIP_WavStats * stats)
+{
+	_Io.GetStats(stats);
+}
+
+/**
+ * Stop.	...
+ * Para el thread de escritura, que antes vacia el buffer, y lo libera.
+ */
+void WavRecorder::Stop()
+{
+	_Run.store(PJ_FALSE);
+	if (_Thread != NULL)
+	{
+		pj_sem_post(_Sem);
+		pj_thread_join(_Thread);
+		pj_thread_destroy(_Thread);
+		_Thread = NULL;
+	}
+	if (_Sem != NULL)
+	{
+		pj_sem_destroy(_Sem);
+		_Sem = NULL;
+	}
+	if (_Ring != NULL)
+	{
+		delete _Ring;
+		_Ring = NULL;
+	}
+}
+
+/**
+ * WriteFile.	...
+ * Escribe una trama en el fichero.
+ */
+pj_status_t WavRecorder::WriteFile(void * buf, pj_size_t size)
+{
+	pjmedia_frame frame;
+
+	frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	frame.buf = buf;
+	frame.size = size;
+	frame.timestamp.u64 = 0;
+	frame.bit_info = 0;
+
+	_Io.Begin();
+	pj_status_t st = pjmedia_port_put_frame(_File, &frame);
+	_Io.End();
+
+	return st;
+}
+
+/**
+ * Flush.	...
+ * Thread de escritura. Escribe en el fichero las tramas que haya en el buffer.
+ */
+void WavRecorder::Flush()
+{
+	while (_Ring->Read(_Buf, _Port.info.samples_per_frame))
+	{
+		pj_status_t st = WriteFile(_Buf, _Port.info.bytes_per_frame);
+		if (st != PJ_SUCCESS)
+		{
+			PJ_LOG(3,("WavRecorder", "ERROR escribiendo %.*s: %d", (int) _File->info.name.slen, _File->info.name.ptr, st));
+		}
+	}
+}
+
+/**
+ * IoThread.	...
+ * Thread de escritura. Vacia el buffer cada vez que el mezclador lo despierta, y una ultima vez al pararlo.
+ */
+int WavRecorder::IoThread(void * proc)
+{
+	WavRecorder * pThis = reinterpret_cast<WavRecorder*>(proc);
+
+	while (pThis->_Run.load())
+	{
+		pThis->_Wake.store(PJ_FALSE);
+		pThis->Flush();
+		pj_sem_wait(pThis->_Sem);
+	}
+	pThis->Flush();
+
+	return 0;
+}
+
+/**
+ * PutFrame.	...
+ * Mezclador. Deja la trama en el buffer, o la escribe en el fichero si no hay thread de escritura.
+ */
+pj_status_t WavRecorder::PutFrame(pjmedia_port * port, const pjmedia_frame * frame)
+{
+	WavRecorder * pThis = reinterpret_cast<WavRecorder*>(port->port_data.pdata);
+
+	if (frame->type != PJMEDIA_FRAME_TYPE_AUDIO || frame->size != port->info.bytes_per_frame)
+	{
+		return PJ_SUCCESS;
+	}
+
+	pThis->_Io.Frames++;
+	if (pThis->_Ring == NULL)
+	{
+		return pThis->WriteFile(frame->buf, frame->size);
+	}
+
+	if (!pThis->_Ring->Write((const pj_int16_t *) frame->buf, port->info.samples_per_frame))
+	{
+		pThis->_Io.Overruns++;
+	}
+	if (++pThis->_Queued >= FLUSH_FRAMES && !pThis->_Wake.exchange(PJ_TRUE))
+	{
+		pThis->_Queued = 0;
+		pj_sem_post(pThis->_Sem);
+	}
+	return PJ_SUCCESS;
+}
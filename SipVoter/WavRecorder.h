@@ -1,6 +1,15 @@
 #ifndef __CORESIP_WAVRECORDER_H__
 #define __CORESIP_WAVRECORDER_H__
 
+#include "AudioRing.h"
+#include "WavIo.h"
+
+/**
+ * WavRecorder.
+ * El mezclador deja las tramas en _Ring y un thread propio las escribe en el fichero cada FLUSH_FRAMES
+ * tramas. Si el buffer esta lleno, porque el disco no da abasto, la trama se descarta y se cuenta un overrun.
+ * Al destruirlo se escribe lo que quede en el buffer antes de cerrar el fichero.
+ */
 class WavRecorder
 {
 public:
@@ -10,9 +19,31 @@ public:
 	WavRecorder(const char * file);
 	~WavRecorder();
 
+	void GetStats(CORESIP_WavStats * stats);
+
 private:
+	static const unsigned WRITE_BEHIND_MS = 1000;
+	static const unsigned FLUSH_FRAMES = 5;
+
 	pj_pool_t * _Pool;
-	pjmedia_port * _Port;
+	pjmedia_port * _File;							//Puerto de pjmedia que escribe el fichero
+	pjmedia_port _Port;								//Puerto del mezclador
+
+	AudioRing * _Ring;								//NULL si se escribe desde el mezclador (WavIo::Enable)
+	pj_int16_t * _Buf;
+	unsigned _Queued;								//Tramas dejadas en _Ring desde que se desperto al thread
+	std::atomic<pj_bool_t> _Wake;
+	std::atomic<pj_bool_t> _Run;
+	pj_sem_t * _Sem;
+	pj_thread_t * _Thread;
+	WavIo _Io;
+
+	pj_status_t WriteFile(void * buf, pj_size_t size);
+	void Flush();
+	void Stop();
+
+	static int IoThread(void * proc);
+	static pj_status_t PutFrame(pjmedia_port * port, const pjmedia_frame * frame);
 };
 
 #endif
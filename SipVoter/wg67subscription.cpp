@@ -1,6 +1,6 @@
 #include "Global.h"
 #include "wg67subscription.h"
-#include "exceptions.h"
+#include "Exceptions.h"
 
 #undef THIS_FILE
 #define THIS_FILE		"wg67subscription.cpp"
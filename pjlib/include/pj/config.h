@@ -539,6 +539,26 @@
 #endif
 
 
+/**
+ * Select the implementation of the timer heap (see @ref PJ_TIMER). When
+ * this is set to zero, timers are kept in a binary heap (timer.c), where
+ * schedule, cancel and each expiration are O(log n). When this is set to
+ * non-zero, timers are kept in a hierarchical timing wheel with 1 ms
+ * resolution (timer_wheel.c), where schedule and cancel are O(1) and the
+ * timers expiring in the same millisecond are collected at once, which is
+ * cheaper for applications that keep thousands of timers and re-arm or
+ * cancel most of them before they expire. Both have the same API, and
+ * pj_timer_entry is the same with both, so only pjlib has to be built
+ * with this setting. CoreSIP enables it from its build (see
+ * SipVoter/Makefile).
+ *
+ * Default: 0
+ */
+#ifndef PJ_TIMER_HEAP_USE_WHEEL
+#   define PJ_TIMER_HEAP_USE_WHEEL	0
+#endif
+
+
 /**
  * Default concurrency setting for sockets/handles registered to ioqueue.
  * This controls whether the ioqueue is allowed to call the key's callback
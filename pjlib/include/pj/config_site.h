@@ -1,8 +1,6 @@
 #define PJ_CONFIG_MAXIMUM_SPEED
 #define PJSUA_MAX_ACC								1024
 
-#define PJMEDIA_AUDIO_DEV_HAS_PORTAUDIO		1
-
 #define PJMEDIA_HAS_SRTP							0
 #define PJMEDIA_DISABLE_RTCP						1
 #define PJMEDIA_HAS_SPEEX_CODEC					0
@@ -10,8 +8,6 @@
 #define PJMEDIA_HAS_GSM_CODEC						0
 #define PJMEDIA_HAS_G722_CODEC					0
 
-#define PJMEDIA_HAS_INTEL_IPP						1
-#define PJMEDIA_HAS_INTEL_IPP_CODEC_G728		1
 #define PJMEDIA_HAS_INTEL_IPP_CODEC_G729		0
 #define PJMEDIA_HAS_INTEL_IPP_CODEC_AMR		0
 #define PJMEDIA_HAS_INTEL_IPP_CODEC_AMRWB		0
@@ -24,6 +20,29 @@
 
 #define PJMEDIA_AUTO_LINK_IPP_LIBS				0
 
+/*
+ * Windows: tarjetas de sonido por PortAudio y codecs IPP.
+ * Linux: compilacion sin interfaz grafica ni tarjetas de sonido. No hay ASIO ni IPP:
+ * el reloj de la conferencia lo da el dispositivo de audio nulo.
+ * Los dispositivos de audio pueden venir ya definidos desde la linea de compilacion (configure).
+ */
+#if defined(_WIN32)
+#	ifndef PJMEDIA_AUDIO_DEV_HAS_PORTAUDIO
+#		define PJMEDIA_AUDIO_DEV_HAS_PORTAUDIO	1
+#	endif
+#	define PJMEDIA_HAS_INTEL_IPP						1
+#	define PJMEDIA_HAS_INTEL_IPP_CODEC_G728		1
+#else
+#	ifndef PJMEDIA_AUDIO_DEV_HAS_PORTAUDIO
+#		define PJMEDIA_AUDIO_DEV_HAS_PORTAUDIO	0
+#	endif
+#	ifndef PJMEDIA_AUDIO_DEV_HAS_NULL_AUDIO
+#		define PJMEDIA_AUDIO_DEV_HAS_NULL_AUDIO	1
+#	endif
+#	define PJMEDIA_HAS_INTEL_IPP						0
+#	define PJMEDIA_HAS_INTEL_IPP_CODEC_G728		0
+#endif
+
 #if PJMEDIA_DISABLE_RTCP
 #	define PJMEDIA_ADVERTISE_RTCP					0
 #else
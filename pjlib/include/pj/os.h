@@ -160,6 +160,18 @@ PJ_DECL(int) pj_thread_get_prio(pj_thread_t *thread);
  */
 PJ_DECL(pj_status_t) pj_thread_set_prio(pj_thread_t *thread,  int prio);
 
+/**
+ * Pin the thread to one CPU, so it is always scheduled on that processor.
+ * Only supported on Linux and Windows.
+ *
+ * @param thread	Thread handle.
+ * @param cpu		Zero based index of the CPU.
+ *
+ * @return		PJ_SUCCESS on success, PJ_ENOTSUP if the platform
+ *			does not support it, or the error code.
+ */
+PJ_DECL(pj_status_t) pj_thread_set_affinity(pj_thread_t *thread, unsigned cpu);
+
 /**
  * Get the lowest priority value available for this thread.
  *
@@ -51,6 +51,15 @@ PJ_BEGIN_DECL
  *
  * ACE is Copyright (C)1993-2006 Douglas C. Schmidt <d.schmidt@vanderbilt.edu>
  *
+ * Alternatively, when #PJ_TIMER_HEAP_USE_WHEEL is enabled, the same API is
+ * implemented by a hierarchical timing wheel with 1 ms resolution: a root
+ * wheel of 256 slots and three more wheels of 64 slots each, so timers up
+ * to about 18 hours away are kept in a slot (the rest wait in an overflow
+ * list). Scheduling and cancelling a timer is O(1), and all timers which
+ * expire in the same millisecond are collected with one list operation.
+ * The wheel runs on the monotonic clock of pj_get_timestamp(), so changes
+ * of the system time don't make its timers expire early or late.
+ *
  * @{
  *
  * \section pj_timer_examples_sec Examples
@@ -117,6 +126,18 @@ struct pj_timer_entry
      * by timer heap when the timer is scheduled.
      */
     pj_time_val _timer_value;
+
+    /**
+     * Links of the entry in its timing wheel slot and its expiration in
+     * wheel ticks, which are updated by the timer heap when
+     * #PJ_TIMER_HEAP_USE_WHEEL is enabled. They are there with both
+     * implementations, so that pjlib can be built with the wheel without
+     * rebuilding the libraries and applications that use it. Application
+     * should not touch these.
+     */
+    struct pj_timer_entry *_next;
+    struct pj_timer_entry **_pprev;
+    pj_uint64_t _tick;
 };
 
 
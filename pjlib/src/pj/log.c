@@ -254,9 +254,19 @@ PJ_DEF(void) pj_log( const char *sender, int level,
      */
     suspend_logging(&saved_level);
 
-    /* Get current date/time. */
-    pj_gettimeofday(&now);
-    pj_time_decode(&now, &ptime);
+    /* Get current date/time, only if it's going to be printed. Writers
+     * that stamp the time themselves (e.g. asynchronously) clear these
+     * decor flags and avoid the cost of decoding the local time here.
+     */
+    if (log_decor & (PJ_LOG_HAS_DAY_NAME | PJ_LOG_HAS_YEAR |
+		     PJ_LOG_HAS_MONTH | PJ_LOG_HAS_DAY_OF_MON |
+		     PJ_LOG_HAS_TIME | PJ_LOG_HAS_MICRO_SEC))
+    {
+	pj_gettimeofday(&now);
+	pj_time_decode(&now, &ptime);
+    } else {
+	pj_bzero(&ptime, sizeof(ptime));
+    }
 
     pre = log_buffer;
     if (log_decor & PJ_LOG_HAS_LEVEL_TEXT) {
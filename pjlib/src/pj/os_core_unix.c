@@ -41,6 +41,7 @@
 
 #include <unistd.h>	    // getpid()
 #include <errno.h>	    // errno
+#include <time.h>	    // clock_gettime()
 
 #include <pthread.h>
 
@@ -97,7 +98,18 @@ struct pj_sem_t
 #if defined(PJ_HAS_EVENT_OBJ) && PJ_HAS_EVENT_OBJ != 0
 struct pj_event_t
 {
-    char		obj_name[PJ_MAX_OBJ_NAME];
+    enum event_state {
+	EV_STATE_OFF,
+	EV_STATE_SET,
+	EV_STATE_PULSED
+    } state;
+
+    pj_mutex_t		mutex;
+    pthread_cond_t	cond;
+
+    pj_bool_t		auto_reset;
+    unsigned		threads_waiting;
+    int			threads_to_release;
 };
 #endif	/* PJ_HAS_EVENT_OBJ */
 
@@ -242,6 +254,16 @@ PJ_DEF(pj_bool_t) pj_thread_is_registered(void)
 #endif
 }
 
+/*
+ * Unregister the calling thread from PJLIB.
+ */
+PJ_DEF(void) pj_thread_unregister(void)
+{
+#if PJ_HAS_THREADS
+    pj_thread_local_set(thread_tls_id, NULL);
+#endif
+}
+
 
 /*
  * Get thread priority value for the thread.
@@ -295,6 +317,33 @@ PJ_DEF(pj_status_t) pj_thread_set_prio(pj_thread_t *thread,  int prio)
 }
 
 
+/*
+ * Pin the thread to one CPU.
+ */
+PJ_DEF(pj_status_t) pj_thread_set_affinity(pj_thread_t *thread, unsigned cpu)
+{
+#if PJ_HAS_THREADS && defined(PJ_LINUX) && PJ_LINUX!=0
+    cpu_set_t cpuset;
+    int rc;
+
+    PJ_ASSERT_RETURN(thread && cpu < CPU_SETSIZE, PJ_EINVAL);
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+
+    rc = pthread_setaffinity_np(thread->thread, sizeof(cpuset), &cpuset);
+    if (rc != 0)
+	return PJ_RETURN_OS_ERROR(rc);
+
+    return PJ_SUCCESS;
+#else
+    PJ_UNUSED_ARG(thread);
+    PJ_UNUSED_ARG(cpu);
+    return PJ_ENOTSUP;
+#endif
+}
+
+
 /*
  * Get the lowest priority value available on this system.
  */
@@ -1587,6 +1636,54 @@ PJ_DEF(pj_status_t) pj_sem_wait(pj_sem_t *sem)
 #endif
 }
 
+/*
+ * pj_sem_wait_for()
+ */
+PJ_DEF(pj_status_t) pj_sem_wait_for(pj_sem_t *sem, unsigned timeout)
+{
+#if PJ_HAS_THREADS
+    struct timespec abstime;
+    int result;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(sem, PJ_EINVAL);
+
+    PJ_LOG(6, (sem->obj_name, "Semaphore: thread %s is waiting", 
+			      pj_thread_this()->obj_name));
+
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    abstime.tv_sec += timeout / 1000;
+    abstime.tv_nsec += (timeout % 1000) * 1000000;
+    if (abstime.tv_nsec >= 1000000000) {
+	abstime.tv_sec++;
+	abstime.tv_nsec -= 1000000000;
+    }
+
+    do {
+	result = sem_timedwait( sem->sem, &abstime );
+    } while (result != 0 && errno == EINTR);
+    
+    if (result == 0) {
+	PJ_LOG(6, (sem->obj_name, "Semaphore acquired by thread %s", 
+				  pj_thread_this()->obj_name));
+    } else {
+	PJ_LOG(6, (sem->obj_name, "Semaphore: thread %s FAILED to acquire", 
+				  pj_thread_this()->obj_name));
+    }
+
+    if (result == 0)
+	return PJ_SUCCESS;
+    else if (errno == ETIMEDOUT)
+	return PJ_ETIMEDOUT;
+    else
+	return PJ_RETURN_OS_ERROR(pj_get_native_os_error());
+#else
+    pj_assert( sem == (pj_sem_t*) 1 );
+    PJ_UNUSED_ARG(timeout);
+    return PJ_SUCCESS;
+#endif
+}
+
 /*
  * pj_sem_trywait()
  */
@@ -1676,13 +1773,61 @@ PJ_DEF(pj_status_t) pj_event_create(pj_pool_t *pool, const char *name,
 				    pj_bool_t manual_reset, pj_bool_t initial,
 				    pj_event_t **ptr_event)
 {
-    pj_assert(!"Not supported!");
-    PJ_UNUSED_ARG(pool);
-    PJ_UNUSED_ARG(name);
-    PJ_UNUSED_ARG(manual_reset);
-    PJ_UNUSED_ARG(initial);
-    PJ_UNUSED_ARG(ptr_event);
-    return PJ_EINVALIDOP;
+    pj_event_t *event;
+    pj_status_t rc;
+
+    PJ_ASSERT_RETURN(pool && ptr_event, PJ_EINVAL);
+
+    event = PJ_POOL_ALLOC_T(pool, pj_event_t);
+
+    rc = init_mutex(&event->mutex, name, PJ_MUTEX_SIMPLE);
+    if (rc != PJ_SUCCESS)
+	return rc;
+
+    rc = pthread_cond_init(&event->cond, NULL);
+    if (rc != 0) {
+	pj_mutex_destroy(&event->mutex);
+	return PJ_RETURN_OS_ERROR(rc);
+    }
+
+    event->auto_reset = !manual_reset;
+    event->threads_waiting = 0;
+
+    if (initial) {
+	event->state = EV_STATE_SET;
+	event->threads_to_release = 1;
+    } else {
+	event->state = EV_STATE_OFF;
+	event->threads_to_release = 0;
+    }
+
+    *ptr_event = event;
+    return PJ_SUCCESS;
+}
+
+/*
+ * Called with the event mutex held, each time a thread is released.
+ */
+static void event_on_one_release(pj_event_t *event)
+{
+    if (event->state == EV_STATE_SET) {
+	if (event->auto_reset) {
+	    event->threads_to_release = 0;
+	    event->state = EV_STATE_OFF;
+	}
+	/* Manual reset event remains set */
+    } else {
+	if (event->auto_reset) {
+	    /* Only release one */
+	    event->threads_to_release = 0;
+	    event->state = EV_STATE_OFF;
+	} else {
+	    event->threads_to_release--;
+	    pj_assert(event->threads_to_release >= 0);
+	    if (event->threads_to_release == 0)
+		event->state = EV_STATE_OFF;
+	}
+    }
 }
 
 /*
@@ -1690,8 +1835,17 @@ PJ_DEF(pj_status_t) pj_event_create(pj_pool_t *pool, const char *name,
  */
 PJ_DEF(pj_status_t) pj_event_wait(pj_event_t *event)
 {
-    PJ_UNUSED_ARG(event);
-    return PJ_EINVALIDOP;
+    PJ_ASSERT_RETURN(event, PJ_EINVAL);
+
+    pthread_mutex_lock(&event->mutex.mutex);
+    event->threads_waiting++;
+    while (event->state == EV_STATE_OFF)
+	pthread_cond_wait(&event->cond, &event->mutex.mutex);
+    event->threads_waiting--;
+    event_on_one_release(event);
+    pthread_mutex_unlock(&event->mutex.mutex);
+
+    return PJ_SUCCESS;
 }
 
 /*
@@ -1699,8 +1853,17 @@ PJ_DEF(pj_status_t) pj_event_wait(pj_event_t *event)
  */
 PJ_DEF(pj_status_t) pj_event_trywait(pj_event_t *event)
 {
-    PJ_UNUSED_ARG(event);
-    return PJ_EINVALIDOP;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(event, PJ_EINVAL);
+
+    pthread_mutex_lock(&event->mutex.mutex);
+    status = (event->state != EV_STATE_OFF) ? PJ_SUCCESS : PJ_ETIMEDOUT;
+    if (status == PJ_SUCCESS)
+	event_on_one_release(event);
+    pthread_mutex_unlock(&event->mutex.mutex);
+
+    return status;
 }
 
 /*
@@ -1708,8 +1871,18 @@ PJ_DEF(pj_status_t) pj_event_trywait(pj_event_t *event)
  */
 PJ_DEF(pj_status_t) pj_event_set(pj_event_t *event)
 {
-    PJ_UNUSED_ARG(event);
-    return PJ_EINVALIDOP;
+    PJ_ASSERT_RETURN(event, PJ_EINVAL);
+
+    pthread_mutex_lock(&event->mutex.mutex);
+    event->threads_to_release = 1;
+    event->state = EV_STATE_SET;
+    if (event->auto_reset)
+	pthread_cond_signal(&event->cond);
+    else
+	pthread_cond_broadcast(&event->cond);
+    pthread_mutex_unlock(&event->mutex.mutex);
+
+    return PJ_SUCCESS;
 }
 
 /*
@@ -1717,8 +1890,21 @@ PJ_DEF(pj_status_t) pj_event_set(pj_event_t *event)
  */
 PJ_DEF(pj_status_t) pj_event_pulse(pj_event_t *event)
 {
-    PJ_UNUSED_ARG(event);
-    return PJ_EINVALIDOP;
+    PJ_ASSERT_RETURN(event, PJ_EINVAL);
+
+    pthread_mutex_lock(&event->mutex.mutex);
+    if (event->threads_waiting) {
+	event->threads_to_release = event->auto_reset ? 1 :
+				    event->threads_waiting;
+	event->state = EV_STATE_PULSED;
+	if (event->threads_to_release == 1)
+	    pthread_cond_signal(&event->cond);
+	else
+	    pthread_cond_broadcast(&event->cond);
+    }
+    pthread_mutex_unlock(&event->mutex.mutex);
+
+    return PJ_SUCCESS;
 }
 
 /*
@@ -1726,8 +1912,14 @@ PJ_DEF(pj_status_t) pj_event_pulse(pj_event_t *event)
  */
 PJ_DEF(pj_status_t) pj_event_reset(pj_event_t *event)
 {
-    PJ_UNUSED_ARG(event);
-    return PJ_EINVALIDOP;
+    PJ_ASSERT_RETURN(event, PJ_EINVAL);
+
+    pthread_mutex_lock(&event->mutex.mutex);
+    event->state = EV_STATE_OFF;
+    event->threads_to_release = 0;
+    pthread_mutex_unlock(&event->mutex.mutex);
+
+    return PJ_SUCCESS;
 }
 
 /*
@@ -1735,8 +1927,12 @@ PJ_DEF(pj_status_t) pj_event_reset(pj_event_t *event)
  */
 PJ_DEF(pj_status_t) pj_event_destroy(pj_event_t *event)
 {
-    PJ_UNUSED_ARG(event);
-    return PJ_EINVALIDOP;
+    PJ_ASSERT_RETURN(event, PJ_EINVAL);
+
+    pj_mutex_destroy(&event->mutex);
+    pthread_cond_destroy(&event->cond);
+
+    return PJ_SUCCESS;
 }
 
 #endif	/* PJ_HAS_EVENT_OBJ */
@@ -303,6 +303,26 @@ PJ_DEF(pj_status_t) pj_thread_set_prio(pj_thread_t *thread,  int prio)
 }
 
 
+/*
+ * Pin the thread to one CPU.
+ */
+PJ_DEF(pj_status_t) pj_thread_set_affinity(pj_thread_t *thread, unsigned cpu)
+{
+#if PJ_HAS_THREADS
+    PJ_ASSERT_RETURN(thread && cpu < sizeof(DWORD_PTR)*8, PJ_EINVAL);
+
+    if (SetThreadAffinityMask(thread->hthread, ((DWORD_PTR)1) << cpu) == 0)
+	return PJ_RETURN_OS_ERROR(GetLastError());
+
+    return PJ_SUCCESS;
+#else
+    PJ_UNUSED_ARG(thread);
+    PJ_UNUSED_ARG(cpu);
+    return PJ_EINVALIDOP;
+#endif
+}
+
+
 /*
  * Get the lowest priority value available on this system.
  */
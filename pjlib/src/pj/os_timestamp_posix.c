@@ -110,6 +110,38 @@ PJ_DEF(pj_status_t) pj_get_timestamp_freq(pj_timestamp *freq)
     return 0;
 }
 
+#elif defined(PJ_LINUX) && PJ_LINUX!=0
+#include <time.h>
+#include <errno.h>
+
+#define USEC_PER_SEC	1000000
+
+/* Monotonic clock, which doesn't jump when the system time is changed.
+ * Same microsecond resolution as the gettimeofday() version below.
+ */
+PJ_DEF(pj_status_t) pj_get_timestamp(pj_timestamp *ts)
+{
+    struct timespec tp;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &tp) != 0) {
+	return PJ_RETURN_OS_ERROR(pj_get_native_os_error());
+    }
+
+    ts->u64 = tp.tv_sec;
+    ts->u64 *= USEC_PER_SEC;
+    ts->u64 += tp.tv_nsec / 1000;
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pj_get_timestamp_freq(pj_timestamp *freq)
+{
+    freq->u32.hi = 0;
+    freq->u32.lo = USEC_PER_SEC;
+
+    return PJ_SUCCESS;
+}
+
 #else
 #include <sys/time.h>
 #include <errno.h>
@@ -35,6 +35,8 @@
 #include <pj/errno.h>
 #include <pj/lock.h>
 
+#if !PJ_TIMER_HEAP_USE_WHEEL
+
 #define HEAP_PARENT(X)	(X == 0 ? 0 : (((X) - 1) / 2))
 #define HEAP_LEFT(X)	(((X)+(X))+1)
 
@@ -552,3 +554,4 @@ PJ_DEF(pj_status_t) pj_timer_heap_earliest_time( pj_timer_heap_t * ht,
     return PJ_SUCCESS;
 }
 
+#endif	/* !PJ_TIMER_HEAP_USE_WHEEL */
@@ -0,0 +1,610 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2009 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Hierarchical timing wheel implementation of the timer heap API, selected
+ * with PJ_TIMER_HEAP_USE_WHEEL.
+ *
+ * Time is counted in ticks of 1 ms of the monotonic clock (pj_get_timestamp())
+ * since the heap was created. An entry expiring at tick T is kept in:
+ *  - the root wheel, slot (T & 255), when T is less than 256 ticks away,
+ *  - the wheel N (0..2), slot ((T >> (8+6*N)) & 63), when T is less than
+ *    2^(14+6*N) ticks away,
+ *  - the overflow list otherwise.
+ * Every time the root wheel wraps, the next slot of the first upper wheel
+ * is moved down ("cascaded"), and so on with the upper wheels. The overflow
+ * list is re-inserted when the last wheel wraps (every 2^26 ms, ~18 hours).
+ *
+ * Entries which expire are moved to the expired list, from where the poll
+ * calls their callbacks outside the lock. Entries scheduled in the past go
+ * to the expired list directly.
+ *
+ * The ticks in which no slot has to be processed are skipped: the poll jumps
+ * to next_tick, so its cost doesn't depend on how long it hasn't been called.
+ *
+ * Unlike the heap, the wheel doesn't follow pj_gettimeofday(), so a step of
+ * the system time doesn't make the entries expire early or late. The
+ * _timer_value of the entries is still given in pj_gettimeofday() time.
+ */
+#include <pj/timer.h>
+#include <pj/pool.h>
+#include <pj/os.h>
+#include <pj/string.h>
+#include <pj/assert.h>
+#include <pj/errno.h>
+#include <pj/lock.h>
+
+#if PJ_TIMER_HEAP_USE_WHEEL
+
+#define ROOT_BITS	8
+#define ROOT_SIZE	(1 << ROOT_BITS)
+#define ROOT_MASK	(ROOT_SIZE - 1)
+#define LVL_BITS	6
+#define LVL_SIZE	(1 << LVL_BITS)
+#define LVL_MASK	(LVL_SIZE - 1)
+#define LVL_CNT		3
+
+/* Bit position of the slot index of wheel N */
+#define LVL_SHIFT(N)	(ROOT_BITS + (N) * LVL_BITS)
+
+/* Ticks covered by the root wheel and the upper wheels */
+#define WHEEL_SPAN	((pj_uint64_t)1 << LVL_SHIFT(LVL_CNT))
+
+#define NO_TICK		((pj_uint64_t)-1)
+
+#define DEFAULT_MAX_TIMED_OUT_PER_POLL  (64)
+
+
+/**
+ * The implementation of timer heap.
+ */
+struct pj_timer_heap_t
+{
+    /** Pool from which the timer heap was allocated. */
+    pj_pool_t *pool;
+
+    /** Number of scheduled entries, including the expired list. */
+    pj_size_t cur_size;
+
+    /** Max timed out entries to process per poll. */
+    unsigned max_entries_per_poll;
+
+    /** Lock object. */
+    pj_lock_t *lock;
+
+    /** Autodelete lock. */
+    pj_bool_t auto_delete_lock;
+
+    /** Last timer id given to an entry. */
+    pj_timer_id_t last_id;
+
+    /** Monotonic time of tick 0, and timestamp counts per tick. */
+    pj_timestamp epoch;
+    pj_uint64_t ts_per_tick;
+
+    /** Next tick to be processed. */
+    pj_uint64_t cur_tick;
+
+    /**
+     * Tick not later than the expiration of every entry in the wheels
+     * nor than the cascade of any occupied slot, or NO_TICK if the wheels
+     * are empty. The ticks before it can be skipped. It's recalculated
+     * when the ticks have passed it.
+     */
+    pj_uint64_t next_tick;
+
+    /** Root wheel, one slot per tick. */
+    pj_timer_entry *root[ROOT_SIZE];
+
+    /** Upper wheels. */
+    pj_timer_entry *lvl[LVL_CNT][LVL_SIZE];
+
+    /** Entries too far in the future for the wheels. */
+    pj_timer_entry *overflow;
+
+    /** Entries which have expired, waiting for their callback. */
+    pj_timer_entry *expired;
+    pj_timer_entry **expired_tail;
+};
+
+
+PJ_INLINE(void) lock_timer_heap( pj_timer_heap_t *ht )
+{
+    if (ht->lock) {
+	pj_lock_acquire(ht->lock);
+    }
+}
+
+PJ_INLINE(void) unlock_timer_heap( pj_timer_heap_t *ht )
+{
+    if (ht->lock) {
+	pj_lock_release(ht->lock);
+    }
+}
+
+/* Current tick of the monotonic clock. With round_up, a time between two
+ * ticks gives the later one, so that entries scheduled from it don't expire
+ * before their delay.
+ */
+static pj_uint64_t get_tick(pj_timer_heap_t *ht, pj_bool_t round_up)
+{
+    pj_timestamp now;
+    pj_uint64_t elapsed, tick;
+
+    pj_get_timestamp(&now);
+    elapsed = now.u64 - ht->epoch.u64;
+    tick = elapsed / ht->ts_per_tick;
+    if (round_up && tick * ht->ts_per_tick != elapsed)
+	++tick;
+    return tick;
+}
+
+PJ_INLINE(void) link_entry(pj_timer_entry **head, pj_timer_entry *entry)
+{
+    entry->_next = *head;
+    if (*head)
+	(*head)->_pprev = &entry->_next;
+    *head = entry;
+    entry->_pprev = head;
+}
+
+PJ_INLINE(void) unlink_entry(pj_timer_heap_t *ht, pj_timer_entry *entry)
+{
+    if (ht->expired_tail == &entry->_next)
+	ht->expired_tail = entry->_pprev;
+
+    *entry->_pprev = entry->_next;
+    if (entry->_next)
+	entry->_next->_pprev = entry->_pprev;
+
+    entry->_next = NULL;
+    entry->_pprev = NULL;
+}
+
+static void append_expired(pj_timer_heap_t *ht, pj_timer_entry *entry)
+{
+    entry->_next = NULL;
+    entry->_pprev = ht->expired_tail;
+    *ht->expired_tail = entry;
+    ht->expired_tail = &entry->_next;
+}
+
+/* Put the entry in the wheel slot for its expiration, which must not be
+ * before cur_tick. Returns the tick at which the slot has to be processed:
+ * the expiration for the root wheel, or the tick at which the slot is
+ * cascaded for the upper wheels and the overflow list.
+ */
+static pj_uint64_t insert_entry(pj_timer_heap_t *ht, pj_timer_entry *entry,
+				pj_uint64_t tick)
+{
+    pj_uint64_t delta = tick - ht->cur_tick;
+    unsigned n;
+
+    if (delta < ROOT_SIZE) {
+	link_entry(&ht->root[tick & ROOT_MASK], entry);
+	return tick;
+    }
+
+    for (n=0; n<LVL_CNT; ++n) {
+	if (delta < ((pj_uint64_t)1 << LVL_SHIFT(n+1))) {
+	    link_entry(&ht->lvl[n][(tick >> LVL_SHIFT(n)) & LVL_MASK], entry);
+	    return (tick >> LVL_SHIFT(n)) << LVL_SHIFT(n);
+	}
+    }
+
+    link_entry(&ht->overflow, entry);
+    return ((ht->cur_tick / WHEEL_SPAN) + 1) * WHEEL_SPAN;
+}
+
+/* Move the entries of a slot down to the lower wheels. */
+static void cascade(pj_timer_heap_t *ht, pj_timer_entry **slot)
+{
+    pj_timer_entry *entry = *slot;
+
+    *slot = NULL;
+    while (entry) {
+	pj_timer_entry *next = entry->_next;
+	insert_entry(ht, entry, entry->_tick);
+	entry = next;
+    }
+}
+
+/* Process cur_tick: cascade the upper wheels when the root wheel wraps,
+ * then move the root slot of the tick to the expired list.
+ */
+static void run_tick(pj_timer_heap_t *ht)
+{
+    unsigned idx = (unsigned)(ht->cur_tick & ROOT_MASK);
+    pj_timer_entry *entry;
+
+    if (idx == 0) {
+	unsigned n;
+
+	for (n=0; n<LVL_CNT; ++n) {
+	    unsigned i = (unsigned)((ht->cur_tick >> LVL_SHIFT(n)) & LVL_MASK);
+	    cascade(ht, &ht->lvl[n][i]);
+	    if (i != 0)
+		break;
+	}
+	if (n == LVL_CNT)
+	    cascade(ht, &ht->overflow);
+    }
+
+    entry = ht->root[idx];
+    if (entry) {
+	ht->root[idx] = NULL;
+	entry->_pprev = ht->expired_tail;
+	*ht->expired_tail = entry;
+	while (entry->_next)
+	    entry = entry->_next;
+	ht->expired_tail = &entry->_next;
+    }
+
+    ++ht->cur_tick;
+}
+
+/* Find a tick not later than any entry in the wheels. It's exact when the
+ * earliest entry is in the root wheel, otherwise it's the start of the
+ * first occupied slot of the upper wheels.
+ */
+static pj_uint64_t earliest_tick(pj_timer_heap_t *ht)
+{
+    pj_uint64_t cur = ht->cur_tick;
+    pj_uint64_t best = NO_TICK;
+    unsigned n, k;
+
+    for (k=0; k<ROOT_SIZE; ++k) {
+	if (ht->root[(cur + k) & ROOT_MASK]) {
+	    best = cur + k;
+	    break;
+	}
+    }
+
+    for (n=0; n<LVL_CNT; ++n) {
+	unsigned shift = LVL_SHIFT(n);
+	pj_uint64_t group = cur >> shift;
+	pj_uint64_t start;
+
+	/* The slot of the current group holds the entries of the group until
+	 * it's cascaded at the start of the group, and after that only those
+	 * of a whole turn later.
+	 */
+	if (ht->lvl[n][group & LVL_MASK]) {
+	    if ((cur & (((pj_uint64_t)1 << shift) - 1)) == 0)
+		start = cur;
+	    else
+		start = (group + LVL_SIZE) << shift;
+	    if (start < best)
+		best = start;
+	}
+
+	for (k=1; k<LVL_SIZE; ++k) {
+	    start = (group + k) << shift;
+	    if (start >= best)
+		break;
+	    if (ht->lvl[n][(group + k) & LVL_MASK]) {
+		best = start;
+		break;
+	    }
+	}
+    }
+
+    if (ht->overflow) {
+	pj_uint64_t start;
+
+	if ((cur & (WHEEL_SPAN - 1)) == 0)
+	    start = cur;
+	else
+	    start = ((cur / WHEEL_SPAN) + 1) * WHEEL_SPAN;
+	if (start < best)
+	    best = start;
+    }
+
+    return best;
+}
+
+/* Process the ticks up to now, and update next_tick. The ticks before
+ * next_tick have nothing to expire or cascade, so they are skipped.
+ */
+static void advance(pj_timer_heap_t *ht, pj_uint64_t now)
+{
+    if (ht->cur_size == 0) {
+	if (now >= ht->cur_tick)
+	    ht->cur_tick = now + 1;
+	ht->next_tick = NO_TICK;
+	return;
+    }
+
+    while (ht->cur_tick <= now) {
+	if (ht->next_tick > now) {
+	    ht->cur_tick = now + 1;
+	    break;
+	}
+	if (ht->next_tick > ht->cur_tick)
+	    ht->cur_tick = ht->next_tick;
+
+	run_tick(ht);
+
+	if (ht->next_tick < ht->cur_tick)
+	    ht->next_tick = earliest_tick(ht);
+    }
+}
+
+
+/*
+ * Calculate memory size required to create a timer heap.
+ */
+PJ_DEF(pj_size_t) pj_timer_heap_mem_size(pj_size_t count)
+{
+    PJ_UNUSED_ARG(count);
+
+    return /* size of the timer heap itself: */
+           sizeof(pj_timer_heap_t) +
+           /* lock, pool etc: */
+           132;
+}
+
+/*
+ * Create a new timer heap.
+ */
+PJ_DEF(pj_status_t) pj_timer_heap_create( pj_pool_t *pool,
+					  pj_size_t size,
+                                          pj_timer_heap_t **p_heap)
+{
+    pj_timer_heap_t *ht;
+    pj_timestamp ts_freq;
+
+    PJ_ASSERT_RETURN(pool && p_heap, PJ_EINVAL);
+
+    /* The wheels don't need to be sized */
+    PJ_UNUSED_ARG(size);
+
+    *p_heap = NULL;
+
+    /* Allocate timer heap data structure from the pool */
+    ht = PJ_POOL_ZALLOC_T(pool, pj_timer_heap_t);
+    if (!ht)
+        return PJ_ENOMEM;
+
+    ht->pool = pool;
+    ht->max_entries_per_poll = DEFAULT_MAX_TIMED_OUT_PER_POLL;
+    ht->expired_tail = &ht->expired;
+    ht->next_tick = NO_TICK;
+
+    /* The timestamp counts at least in microseconds on every platform */
+    pj_get_timestamp_freq(&ts_freq);
+    ht->ts_per_tick = ts_freq.u64 / 1000;
+    if (ht->ts_per_tick == 0)
+	ht->ts_per_tick = 1;
+    pj_get_timestamp(&ht->epoch);
+    ht->cur_tick = 0;
+
+    *p_heap = ht;
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(void) pj_timer_heap_destroy( pj_timer_heap_t *ht )
+{
+    if (ht->lock && ht->auto_delete_lock) {
+        pj_lock_destroy(ht->lock);
+        ht->lock = NULL;
+    }
+}
+
+PJ_DEF(void) pj_timer_heap_set_lock(  pj_timer_heap_t *ht,
+                                      pj_lock_t *lock,
+                                      pj_bool_t auto_del )
+{
+    if (ht->lock && ht->auto_delete_lock)
+        pj_lock_destroy(ht->lock);
+
+    ht->lock = lock;
+    ht->auto_delete_lock = auto_del;
+}
+
+
+PJ_DEF(unsigned) pj_timer_heap_set_max_timed_out_per_poll(pj_timer_heap_t *ht,
+                                                          unsigned count )
+{
+    unsigned old_count = ht->max_entries_per_poll;
+    ht->max_entries_per_poll = count;
+    return old_count;
+}
+
+PJ_DEF(pj_timer_entry*) pj_timer_entry_init( pj_timer_entry *entry,
+                                             int id,
+                                             void *user_data,
+                                             pj_timer_heap_callback *cb )
+{
+    pj_assert(entry && cb);
+
+    entry->_timer_id = -1;
+    entry->_next = NULL;
+    entry->_pprev = NULL;
+    entry->_tick = 0;
+    entry->id = id;
+    entry->user_data = user_data;
+    entry->cb = cb;
+
+    return entry;
+}
+
+PJ_DEF(pj_status_t) pj_timer_heap_schedule( pj_timer_heap_t *ht,
+					    pj_timer_entry *entry,
+					    const pj_time_val *delay)
+{
+    pj_time_val expires;
+    pj_uint64_t now, tick;
+
+    PJ_ASSERT_RETURN(ht && entry && delay, PJ_EINVAL);
+    PJ_ASSERT_RETURN(entry->cb != NULL, PJ_EINVAL);
+
+    /* Prevent same entry from being scheduled more than once */
+    PJ_ASSERT_RETURN(entry->_timer_id < 1, PJ_EINVALIDOP);
+
+    pj_gettimeofday(&expires);
+    PJ_TIME_VAL_ADD(expires, *delay);
+    now = get_tick(ht, PJ_TRUE);
+    tick = now + PJ_TIME_VAL_MSEC(*delay);
+
+    lock_timer_heap(ht);
+
+    if (++ht->last_id < 1)
+	ht->last_id = 1;
+    entry->_timer_id = ht->last_id;
+    entry->_timer_value = expires;
+    entry->_tick = tick;
+
+    /* Nothing pending: the wheels can start from now */
+    if (ht->cur_size == 0 && now > ht->cur_tick)
+	ht->cur_tick = now;
+
+    if (tick < ht->cur_tick) {
+	append_expired(ht, entry);
+    } else {
+	pj_uint64_t due = insert_entry(ht, entry, tick);
+	if (due < ht->next_tick)
+	    ht->next_tick = due;
+    }
+    ++ht->cur_size;
+
+    unlock_timer_heap(ht);
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(int) pj_timer_heap_cancel( pj_timer_heap_t *ht,
+				  pj_timer_entry *entry)
+{
+    int count = 0;
+
+    PJ_ASSERT_RETURN(ht && entry, PJ_EINVAL);
+
+    lock_timer_heap(ht);
+    if (entry->_timer_id > 0 && entry->_pprev != NULL) {
+	unlink_entry(ht, entry);
+	entry->_timer_id = -1;
+	--ht->cur_size;
+	count = 1;
+    }
+    unlock_timer_heap(ht);
+
+    return count;
+}
+
+PJ_DEF(unsigned) pj_timer_heap_poll( pj_timer_heap_t *ht,
+                                     pj_time_val *next_delay )
+{
+    pj_uint64_t now_tick;
+    unsigned count;
+
+    PJ_ASSERT_RETURN(ht, 0);
+
+    if (!ht->cur_size && next_delay) {
+	next_delay->sec = next_delay->msec = PJ_MAXINT32;
+	return 0;
+    }
+
+    count = 0;
+    now_tick = get_tick(ht, PJ_FALSE);
+
+    lock_timer_heap(ht);
+    advance(ht, now_tick);
+
+    while (ht->expired && count < ht->max_entries_per_poll) {
+	pj_timer_entry *node = ht->expired;
+
+	unlink_entry(ht, node);
+	node->_timer_id = -1;
+	--ht->cur_size;
+	++count;
+
+	unlock_timer_heap(ht);
+	if (node->cb)
+	    (*node->cb)(ht, node);
+	lock_timer_heap(ht);
+    }
+
+    if (next_delay) {
+	if (ht->expired) {
+	    next_delay->sec = next_delay->msec = 0;
+	} else {
+	    /* Callbacks may have scheduled new entries */
+	    if (ht->next_tick < ht->cur_tick)
+		ht->next_tick = earliest_tick(ht);
+
+	    if (ht->next_tick == NO_TICK) {
+		next_delay->sec = next_delay->msec = PJ_MAXINT32;
+	    } else if (ht->next_tick <= now_tick) {
+		next_delay->sec = next_delay->msec = 0;
+	    } else {
+		pj_uint64_t delay = ht->next_tick - now_tick;
+		next_delay->sec = (long)(delay / 1000);
+		next_delay->msec = (long)(delay % 1000);
+	    }
+	}
+    }
+    unlock_timer_heap(ht);
+
+    return count;
+}
+
+PJ_DEF(pj_size_t) pj_timer_heap_count( pj_timer_heap_t *ht )
+{
+    PJ_ASSERT_RETURN(ht, 0);
+
+    return ht->cur_size;
+}
+
+PJ_DEF(pj_status_t) pj_timer_heap_earliest_time( pj_timer_heap_t * ht,
+					         pj_time_val *timeval)
+{
+    pj_uint64_t now_tick;
+
+    pj_assert(ht->cur_size != 0);
+    if (ht->cur_size == 0)
+        return PJ_ENOTFOUND;
+
+    pj_gettimeofday(timeval);
+    now_tick = get_tick(ht, PJ_FALSE);
+
+    lock_timer_heap(ht);
+    if (ht->expired) {
+	*timeval = ht->expired->_timer_value;
+    } else {
+	if (ht->next_tick < ht->cur_tick)
+	    ht->next_tick = earliest_tick(ht);
+
+	/* Same distance from now, in pj_gettimeofday() time */
+	if (ht->next_tick > now_tick) {
+	    pj_time_val delay;
+	    pj_uint64_t msec = ht->next_tick - now_tick;
+
+	    delay.sec = (long)(msec / 1000);
+	    delay.msec = (long)(msec % 1000);
+	    PJ_TIME_VAL_ADD(*timeval, delay);
+	}
+    }
+    unlock_timer_heap(ht);
+
+    return PJ_SUCCESS;
+}
+
+#endif	/* PJ_TIMER_HEAP_USE_WHEEL */
@@ -0,0 +1,262 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2009 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+/**
+ * \page page_pjlib_event_test Test: Event Object
+ *
+ * This file provides implementation of \b event_test(). It tests:
+ *  - the initial state and pj_event_trywait(),
+ *  - that pj_event_set() on an auto-reset event releases one waiting
+ *    thread and leaves the event off,
+ *  - that pj_event_set() on a manual-reset event releases every waiting
+ *    thread and keeps the event set until pj_event_reset(),
+ *  - that pj_event_pulse() with no waiting thread does nothing, and with
+ *    waiting threads releases one (auto-reset) or all of them (manual
+ *    reset) and leaves the event off.
+ *
+ * This file is <b>pjlib-test/event.c</b>
+ *
+ * \include pjlib-test/event.c
+ */
+
+#if INCLUDE_EVENT_TEST
+
+#include <pjlib.h>
+
+#define THIS_FILE	"event_test"
+
+#define THREAD_CNT	4
+#define SETTLE_MSEC	100
+#define WAIT_MSEC	2000
+
+static pj_event_t *event;
+static pj_atomic_t *started;
+static pj_atomic_t *released;
+
+static int waiter(void *arg)
+{
+    PJ_UNUSED_ARG(arg);
+
+    pj_atomic_inc(started);
+    pj_event_wait(event);
+    pj_atomic_inc(released);
+    return 0;
+}
+
+/* Wait until the released counter reaches count, or WAIT_MSEC. */
+static pj_atomic_value_t wait_released(pj_atomic_value_t count)
+{
+    unsigned msec;
+
+    for (msec = 0; msec < WAIT_MSEC; msec += 10) {
+	if (pj_atomic_get(released) >= count)
+	    break;
+	pj_thread_sleep(10);
+    }
+    return pj_atomic_get(released);
+}
+
+/* Start THREAD_CNT waiters and give them time to block in the event. */
+static int start_waiters(pj_pool_t *pool, pj_thread_t *threads[])
+{
+    unsigned i, msec;
+
+    pj_atomic_set(started, 0);
+    pj_atomic_set(released, 0);
+
+    for (i = 0; i < THREAD_CNT; ++i) {
+	pj_status_t rc = pj_thread_create(pool, "event_waiter", &waiter,
+					  NULL, 0, 0, &threads[i]);
+	if (rc != PJ_SUCCESS) {
+	    app_perror("...error: pj_thread_create()", rc);
+	    return -1;
+	}
+    }
+
+    for (msec = 0; msec < WAIT_MSEC; msec += 10) {
+	if (pj_atomic_get(started) == THREAD_CNT)
+	    break;
+	pj_thread_sleep(10);
+    }
+    pj_thread_sleep(SETTLE_MSEC);
+
+    return pj_atomic_get(started) == THREAD_CNT ? 0 : -2;
+}
+
+static void join_waiters(pj_thread_t *threads[])
+{
+    unsigned i;
+
+    for (i = 0; i < THREAD_CNT; ++i) {
+	pj_thread_join(threads[i]);
+	pj_thread_destroy(threads[i]);
+    }
+}
+
+static int trywait_test(pj_pool_t *pool)
+{
+    pj_status_t rc;
+
+    PJ_LOG(3,(THIS_FILE, "...trywait"));
+
+    rc = pj_event_create(pool, "event", PJ_FALSE, PJ_TRUE, &event);
+    if (rc != PJ_SUCCESS) {
+	app_perror("...error: pj_event_create()", rc);
+	return -10;
+    }
+    if (pj_event_trywait(event) != PJ_SUCCESS)
+	return -11;
+    if (pj_event_trywait(event) != PJ_ETIMEDOUT)
+	return -12;
+
+    pj_event_pulse(event);
+    if (pj_event_trywait(event) != PJ_ETIMEDOUT)
+	return -13;
+
+    pj_event_set(event);
+    if (pj_event_trywait(event) != PJ_SUCCESS)
+	return -14;
+    pj_event_destroy(event);
+
+    rc = pj_event_create(pool, "event", PJ_TRUE, PJ_FALSE, &event);
+    if (rc != PJ_SUCCESS)
+	return -15;
+    if (pj_event_trywait(event) != PJ_ETIMEDOUT)
+	return -16;
+    pj_event_set(event);
+    if (pj_event_trywait(event) != PJ_SUCCESS ||
+	pj_event_trywait(event) != PJ_SUCCESS)
+    {
+	return -17;
+    }
+    pj_event_reset(event);
+    if (pj_event_trywait(event) != PJ_ETIMEDOUT)
+	return -18;
+    pj_event_destroy(event);
+
+    return 0;
+}
+
+/* Releases the waiters with pj_event_set() or pj_event_pulse() and checks
+ * how many go through each time.
+ */
+static int release_test(pj_pool_t *pool, pj_bool_t manual_reset,
+			pj_bool_t pulse)
+{
+    pj_thread_t *threads[THREAD_CNT];
+    pj_atomic_value_t expected, cnt;
+    pj_status_t rc;
+    int ret = 0;
+
+    PJ_LOG(3,(THIS_FILE, "...%s on %s event", pulse ? "pulse" : "set",
+	      manual_reset ? "manual-reset" : "auto-reset"));
+
+    rc = pj_event_create(pool, "event", manual_reset, PJ_FALSE, &event);
+    if (rc != PJ_SUCCESS) {
+	app_perror("...error: pj_event_create()", rc);
+	return -20;
+    }
+
+    ret = start_waiters(pool, threads);
+    if (ret != 0)
+	return -21;
+
+    if (pulse)
+	pj_event_pulse(event);
+    else
+	pj_event_set(event);
+
+    expected = manual_reset ? THREAD_CNT : 1;
+    wait_released(expected);
+    pj_thread_sleep(SETTLE_MSEC);
+    cnt = pj_atomic_get(released);
+    if (cnt != expected) {
+	PJ_LOG(3,(THIS_FILE, "....error: %ld threads released, expecting %ld",
+		  cnt, expected));
+	ret = -22;
+    }
+
+    /* A set manual-reset event stays set; the others are off again */
+    if (ret == 0 && manual_reset && !pulse) {
+	if (pj_event_trywait(event) != PJ_SUCCESS)
+	    ret = -23;
+	pj_event_reset(event);
+    }
+    if (ret == 0 && pj_event_trywait(event) != PJ_ETIMEDOUT)
+	ret = -24;
+
+    /* Release the remaining waiters one by one */
+    while (cnt < THREAD_CNT) {
+	pj_event_set(event);
+	if (wait_released(cnt + 1) <= cnt) {
+	    PJ_LOG(3,(THIS_FILE, "....error: waiter not released by set"));
+	    if (ret == 0)
+		ret = -25;
+	    break;
+	}
+	cnt = pj_atomic_get(released);
+	if (manual_reset)
+	    pj_event_reset(event);
+    }
+
+    join_waiters(threads);
+    pj_event_destroy(event);
+
+    return ret;
+}
+
+int event_test(void)
+{
+    pj_pool_t *pool;
+    int ret;
+
+    pool = pj_pool_create(mem, NULL, 4000, 4000, NULL);
+
+    if (pj_atomic_create(pool, 0, &started) != PJ_SUCCESS ||
+	pj_atomic_create(pool, 0, &released) != PJ_SUCCESS)
+    {
+	pj_pool_release(pool);
+	return -1;
+    }
+
+    ret = trywait_test(pool);
+    if (ret == 0)
+	ret = release_test(pool, PJ_FALSE, PJ_FALSE);
+    if (ret == 0)
+	ret = release_test(pool, PJ_TRUE, PJ_FALSE);
+    if (ret == 0)
+	ret = release_test(pool, PJ_FALSE, PJ_TRUE);
+    if (ret == 0)
+	ret = release_test(pool, PJ_TRUE, PJ_TRUE);
+
+    pj_atomic_destroy(started);
+    pj_atomic_destroy(released);
+    pj_pool_release(pool);
+
+    return ret;
+}
+
+#else
+/* To prevent warning about "translation unit is empty"
+ * when this test is disabled.
+ */
+int dummy_event_test;
+#endif	/* INCLUDE_EVENT_TEST */
@@ -119,10 +119,18 @@ int test_inner(void)
     DO_TEST( mutex_test() );
 #endif
 
+#if INCLUDE_EVENT_TEST
+    DO_TEST( event_test() );
+#endif
+
 #if INCLUDE_TIMER_TEST
     DO_TEST( timer_test() );
 #endif
 
+#if INCLUDE_TIMER_PERF_TEST
+    DO_TEST( timer_perf_test() );
+#endif
+
 #if INCLUDE_SLEEP_TEST
     DO_TEST( sleep_test() );
 #endif
@@ -0,0 +1,261 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2009 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+/**
+ * \page page_pjlib_timer_perf_test Test: Timer Performance
+ *
+ * This file provides implementation of \b timer_perf_test(). It measures
+ * the timer heap implementation selected with PJ_TIMER_HEAP_USE_WHEEL
+ * with many active timers:
+ *  - scheduling ACTIVE_COUNT long timers (the per call timers),
+ *  - polling with all of them pending,
+ *  - cancelling and re-arming CHANNEL_COUNT short timers, as the squelch
+ *    timers of the radio channels do on each squelch edge, while polling,
+ *  - expiring ACTIVE_COUNT timers which are due within a few msec,
+ *  - cancelling ACTIVE_COUNT timers,
+ *  - expiring CHANNEL_COUNT timers scheduled after the heap has been idle,
+ *    with one poll after a gap longer than all of them.
+ *
+ * This file is <b>pjlib-test/timer_perf.c</b>
+ *
+ * \include pjlib-test/timer_perf.c
+ */
+
+
+#if INCLUDE_TIMER_PERF_TEST
+
+#include <pjlib.h>
+
+#define THIS_FILE	"timer_perf"
+
+#define ACTIVE_COUNT	10000
+#define CHANNEL_COUNT	1000
+#define CHURN_COUNT	200000
+#define CHURN_POLL	16
+#define POLL_COUNT	100000
+#define EXPIRE_MSEC	50
+#define IDLE_MSEC	300
+
+static unsigned expired_cnt;
+static unsigned early_cnt;
+
+static void timer_callback(pj_timer_heap_t *ht, pj_timer_entry *e)
+{
+    pj_time_val now;
+
+    PJ_UNUSED_ARG(ht);
+
+    pj_gettimeofday(&now);
+    if (PJ_TIME_VAL_LT(now, e->_timer_value))
+	++early_cnt;
+    ++expired_cnt;
+}
+
+/* Nanoseconds per operation */
+static unsigned ns_per_op(const pj_timestamp *t1, const pj_timestamp *t2,
+			  unsigned count)
+{
+    pj_uint64_t usec = pj_elapsed_usec(t1, t2);
+    return (unsigned)(usec * 1000 / (count ? count : 1));
+}
+
+int timer_perf_test(void)
+{
+    pj_pool_t *pool;
+    pj_timer_heap_t *ht;
+    pj_timer_entry *active, *channel;
+    pj_timestamp t1, t2;
+    pj_time_val delay, next;
+    unsigned i, t_sched, t_poll, t_churn, t_expire, t_cancel, t_gap;
+    int rc = 0;
+    pj_status_t status;
+
+    pool = pj_pool_create(mem, NULL, 4000, 4000, NULL);
+    if (!pool)
+	return -10;
+
+    active = (pj_timer_entry*)
+	     pj_pool_calloc(pool, ACTIVE_COUNT, sizeof(pj_timer_entry));
+    channel = (pj_timer_entry*)
+	      pj_pool_calloc(pool, CHANNEL_COUNT, sizeof(pj_timer_entry));
+    if (!active || !channel) {
+	rc = -20;
+	goto on_return;
+    }
+
+    for (i=0; i<ACTIVE_COUNT; ++i)
+	pj_timer_entry_init(&active[i], i, NULL, &timer_callback);
+    for (i=0; i<CHANNEL_COUNT; ++i)
+	pj_timer_entry_init(&channel[i], i, NULL, &timer_callback);
+
+    status = pj_timer_heap_create(pool, ACTIVE_COUNT + CHANNEL_COUNT, &ht);
+    if (status != PJ_SUCCESS) {
+	app_perror("...error: unable to create timer heap", status);
+	rc = -30;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "  %s, %d active timers:",
+	      (PJ_TIMER_HEAP_USE_WHEEL ? "timing wheel" : "timer heap"),
+	      ACTIVE_COUNT));
+
+    /* Long timers, 10 to 70 seconds away */
+    pj_get_timestamp(&t1);
+    for (i=0; i<ACTIVE_COUNT; ++i) {
+	delay.sec = 10 + pj_rand() % 60;
+	delay.msec = pj_rand() % 1000;
+	if (pj_timer_heap_schedule(ht, &active[i], &delay) != PJ_SUCCESS) {
+	    rc = -40;
+	    goto on_return;
+	}
+    }
+    pj_get_timestamp(&t2);
+    t_sched = ns_per_op(&t1, &t2, ACTIVE_COUNT);
+
+    /* Poll with nothing due */
+    pj_get_timestamp(&t1);
+    for (i=0; i<POLL_COUNT; ++i)
+	pj_timer_heap_poll(ht, &next);
+    pj_get_timestamp(&t2);
+    t_poll = ns_per_op(&t1, &t2, POLL_COUNT);
+
+    if (next.sec < 9) {
+	PJ_LOG(3,(THIS_FILE, "...error: next delay %d.%03d is too short",
+		  (int)next.sec, (int)next.msec));
+	rc = -50;
+	goto on_return;
+    }
+
+    /* Squelch edges: cancel and re-arm the hang timer of a channel, 20 to
+     * 200 msec away, polling now and then. Some of them will expire.
+     */
+    expired_cnt = early_cnt = 0;
+    pj_get_timestamp(&t1);
+    for (i=0; i<CHURN_COUNT; ++i) {
+	pj_timer_entry *e = &channel[pj_rand() % CHANNEL_COUNT];
+
+	pj_timer_heap_cancel(ht, e);
+	delay.sec = 0;
+	delay.msec = 20 + pj_rand() % 180;
+	pj_timer_heap_schedule(ht, e, &delay);
+
+	if ((i % CHURN_POLL) == 0)
+	    pj_timer_heap_poll(ht, NULL);
+    }
+    pj_get_timestamp(&t2);
+    t_churn = ns_per_op(&t1, &t2, CHURN_COUNT);
+
+    for (i=0; i<CHANNEL_COUNT; ++i)
+	pj_timer_heap_cancel(ht, &channel[i]);
+
+    /* Cancel the long timers */
+    pj_get_timestamp(&t1);
+    for (i=0; i<ACTIVE_COUNT; ++i) {
+	if (pj_timer_heap_cancel(ht, &active[i]) != 1) {
+	    rc = -60;
+	    goto on_return;
+	}
+    }
+    pj_get_timestamp(&t2);
+    t_cancel = ns_per_op(&t1, &t2, ACTIVE_COUNT);
+
+    if (pj_timer_heap_count(ht) != 0) {
+	PJ_LOG(3,(THIS_FILE, "...error: %d timers left after cancel",
+		  (int)pj_timer_heap_count(ht)));
+	rc = -70;
+	goto on_return;
+    }
+
+    /* Short timers, all of them expire in the next EXPIRE_MSEC msec */
+    for (i=0; i<ACTIVE_COUNT; ++i) {
+	delay.sec = 0;
+	delay.msec = pj_rand() % EXPIRE_MSEC;
+	pj_timer_heap_schedule(ht, &active[i], &delay);
+    }
+
+    expired_cnt = early_cnt = 0;
+    t_expire = 0;
+    while (pj_timer_heap_count(ht) > 0) {
+	unsigned cnt;
+
+	pj_get_timestamp(&t1);
+	cnt = pj_timer_heap_poll(ht, NULL);
+	pj_get_timestamp(&t2);
+	if (cnt)
+	    t_expire += pj_elapsed_usec(&t1, &t2);
+    }
+    t_expire = (unsigned)((pj_uint64_t)t_expire * 1000 / ACTIVE_COUNT);
+
+    if (expired_cnt != ACTIVE_COUNT || early_cnt != 0) {
+	PJ_LOG(3,(THIS_FILE, "...error: %d timers expired, %d early",
+		  expired_cnt, early_cnt));
+	rc = -80;
+	goto on_return;
+    }
+
+    /* Idle heap, then timers up to IDLE_MSEC away which are not polled
+     * until all of them are due: the poll has to skip the idle ticks
+     * without missing any of them.
+     */
+    pj_thread_sleep(IDLE_MSEC);
+    for (i=0; i<CHANNEL_COUNT; ++i) {
+	delay.sec = 0;
+	delay.msec = pj_rand() % IDLE_MSEC;
+	pj_timer_heap_schedule(ht, &channel[i], &delay);
+    }
+    pj_thread_sleep(IDLE_MSEC + 20);
+
+    expired_cnt = early_cnt = 0;
+    pj_timer_heap_set_max_timed_out_per_poll(ht, CHANNEL_COUNT);
+    pj_get_timestamp(&t1);
+    pj_timer_heap_poll(ht, NULL);
+    pj_get_timestamp(&t2);
+    t_gap = pj_elapsed_usec(&t1, &t2);
+
+    if (expired_cnt != CHANNEL_COUNT || early_cnt != 0) {
+	PJ_LOG(3,(THIS_FILE, "...error: %d of %d timers expired after the "
+			     "gap, %d early", expired_cnt, CHANNEL_COUNT,
+			     early_cnt));
+	rc = -90;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "  schedule:        %6u ns", t_sched));
+    PJ_LOG(3,(THIS_FILE, "  poll (idle):     %6u ns", t_poll));
+    PJ_LOG(3,(THIS_FILE, "  cancel+schedule: %6u ns (%d channels, "
+			 "poll every %d)", t_churn, CHANNEL_COUNT,
+			 CHURN_POLL));
+    PJ_LOG(3,(THIS_FILE, "  expire:          %6u ns", t_expire));
+    PJ_LOG(3,(THIS_FILE, "  cancel:          %6u ns", t_cancel));
+    PJ_LOG(3,(THIS_FILE, "  poll after gap:  %6u us (%d timers)", t_gap,
+	      CHANNEL_COUNT));
+
+on_return:
+    pj_pool_release(pool);
+    return rc;
+}
+
+#else
+/* To prevent warning about "translation unit is empty"
+ * when this test is disabled.
+ */
+int dummy_timer_perf_test;
+#endif	/* INCLUDE_TIMER_PERF_TEST */
@@ -48,6 +48,7 @@
 #include <pjmedia/rtcp.h>
 #include <pjmedia/rtcp_xr.h>
 #include <pjmedia/rtp.h>
+#include <pjmedia/rtp_ed137.h>
 #include <pjmedia/sdp.h>
 #include <pjmedia/sdp_neg.h>
 #include <pjmedia/session.h>
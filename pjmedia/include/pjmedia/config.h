@@ -60,6 +60,17 @@
 #   define PJMEDIA_CONF_USE_SWITCH_BOARD    0
 #endif
 
+/**
+ * Use SSE2 instructions in the conference bridge for the level adjustment,
+ * mixing and level calculation of the audio frames. It only takes effect
+ * when the compiler generates SSE2 code (x86-64, or x86 with SSE2 enabled).
+ *
+ * Default: 1
+ */
+#ifndef PJMEDIA_CONF_USE_SSE2
+#   define PJMEDIA_CONF_USE_SSE2	    1
+#endif
+
 /*
  * Types of sound stream backends.
  */
@@ -390,6 +401,34 @@
 #endif
 
 
+/**
+ * Specify whether the UDP media transport can read several incoming RTP
+ * packets with one recvmmsg() call, when it is created with the
+ * PJMEDIA_UDP_BATCH_RX option. recvmmsg() is only available on Linux.
+ *
+ * Default: 1 on Linux, 0 otherwise
+ */
+#ifndef PJMEDIA_HAS_UDP_BATCH_RX
+#   if defined(PJ_LINUX) && PJ_LINUX!=0
+#	define PJMEDIA_HAS_UDP_BATCH_RX		1
+#   else
+#	define PJMEDIA_HAS_UDP_BATCH_RX		0
+#   endif
+#endif
+
+
+/**
+ * Maximum number of RTP packets read by one recvmmsg() call in the UDP
+ * media transport. Each transport created with PJMEDIA_UDP_BATCH_RX
+ * allocates this number of PJMEDIA_MAX_MTU sized buffers.
+ *
+ * Default: 8
+ */
+#ifndef PJMEDIA_UDP_RX_BATCH_SIZE
+#   define PJMEDIA_UDP_RX_BATCH_SIZE		8
+#endif
+
+
 /**
  * Specify whether RTCP should be advertised in SDP. This setting would
  * affect whether RTCP candidate will be added in SDP when ICE is used.
@@ -468,6 +507,22 @@
 #endif
 
 
+/**
+ * Number of decoded frames kept by a radio stream (stream with RTP header
+ * extension enabled) so that a frame decoded by the application with
+ * pjmedia_stream_decode_rx_frame() is not decoded again when the stream
+ * gets it from the jitter buffer. Only stateless codecs (PCMU and PCMA)
+ * use it. It must cover the jitter buffer length, in frames.
+ *
+ * Specify zero to disable this feature.
+ *
+ * Default: 64
+ */
+#ifndef PJMEDIA_STREAM_RX_PCM_CACHE
+#   define PJMEDIA_STREAM_RX_PCM_CACHE		64
+#endif
+
+
 /**
  * Specify the maximum duration of silence period in the codec, in msec. 
  * This is useful for example to keep NAT binding open in the firewall
@@ -64,6 +64,29 @@ PJ_DECL(pj_status_t) pjmedia_endpt_create( pj_pool_factory *pf,
 					   unsigned worker_cnt,
 					   pjmedia_endpt **p_endpt);
 
+/**
+ * Create an instance of media endpoint where each worker thread polls its
+ * own internal ioqueue. The sockets of each media transport are registered
+ * to one of these ioqueues (see #pjmedia_endpt_get_transport_ioqueue()),
+ * so the packets of a stream are always received, in order, by the same
+ * thread, while different streams are received in parallel.
+ *
+ * @param pf		Pool factory, which will be used by the media endpoint
+ *			throughout its lifetime.
+ * @param worker_cnt	Number of worker threads and ioqueues, at least one.
+ *			The first ioqueue is also the one returned by
+ *			#pjmedia_endpt_get_ioqueue().
+ * @param first_cpu	If not negative, the worker thread i is pinned to the
+ *			CPU first_cpu+i.
+ * @param p_endpt	Pointer to receive the endpoint instance.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_endpt_create_workers(pj_pool_factory *pf,
+						  unsigned worker_cnt,
+						  int first_cpu,
+						  pjmedia_endpt **p_endpt);
+
 /**
  * Destroy media endpoint instance.
  *
@@ -85,6 +108,18 @@ PJ_DECL(pj_status_t) pjmedia_endpt_destroy(pjmedia_endpt *endpt);
 PJ_DECL(pj_ioqueue_t*) pjmedia_endpt_get_ioqueue(pjmedia_endpt *endpt);
 
 
+/**
+ * Get the ioqueue where a new media transport should register its sockets.
+ * With #pjmedia_endpt_create_workers() the per worker ioqueues are given
+ * in turn, otherwise this is the same as #pjmedia_endpt_get_ioqueue().
+ *
+ * @param endpt		The media endpoint instance.
+ *
+ * @return		The ioqueue instance.
+ */
+PJ_DECL(pj_ioqueue_t*) pjmedia_endpt_get_transport_ioqueue(pjmedia_endpt *endpt);
+
+
 /**
  * Get the number of worker threads on the media endpoint
  *
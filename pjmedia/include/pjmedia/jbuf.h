@@ -293,6 +293,30 @@ PJ_DECL(void) pjmedia_jbuf_get_frame2(pjmedia_jbuf *jb,
 				      pj_uint32_t *bit_info);
 
 
+/**
+ * Get a frame from the jitter buffer. This is the same as
+ * pjmedia_jbuf_get_frame2(), but also returns the sequence number of
+ * the frame, i.e: the \a frame_seq given when the frame was put.
+ *
+ * @param jb		The jitter buffer.
+ * @param frame		Buffer to receive the payload from the jitter buffer.
+ *			@see pjmedia_jbuf_get_frame().    
+ * @param size		Pointer to receive frame size.
+ * @param p_frm_type	Pointer to receive frame type.
+ *			@see pjmedia_jbuf_get_frame().    
+ * @param bit_info	Bit precise info of the frame.
+ * @param seq		Pointer to receive the frame sequence number. It is
+ *			only set when a frame is retrieved from the frame
+ *			list. Can be NULL.
+ */
+PJ_DECL(void) pjmedia_jbuf_get_frame3(pjmedia_jbuf *jb, 
+				      void *frame, 
+				      pj_size_t *size, 
+				      char *p_frm_type,
+				      pj_uint32_t *bit_info,
+				      int *seq);
+
+
 /**
  * Get jitter buffer current state/settings.
  *
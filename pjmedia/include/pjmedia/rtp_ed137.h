@@ -0,0 +1,224 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2009 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __PJMEDIA_RTP_ED137_H__
+#define __PJMEDIA_RTP_ED137_H__
+
+
+/**
+ * @file rtp_ed137.h
+ * @brief ED-137 RTP header extension.
+ */
+
+#include <pjmedia/types.h>
+
+/**
+ * @defgroup PJMEDIA_RTP_ED137 ED-137 RTP Header Extension
+ * @ingroup PJMEDIA_TRANSPORT
+ * @brief Encoder and decoder of the EUROCAE ED-137 radio header extension
+ * @{
+ *
+ * The ED-137 header extension carries, after the 32 bit profile/length
+ * word of RFC 3550, two bytes with the radio signalling (PTT type, squelch,
+ * PTT-ID, PTT mute, ...) followed by a list of TLVs (BSS quality index,
+ * CLIMAX delay, RMM/MAM time delay measurement) padded with zeros up to
+ * a 32 bit boundary.
+ *
+ * #pjmedia_rtp_ed137_decode() parses the whole extension in a single pass
+ * into #pjmedia_rtp_ed137_ext, #pjmedia_rtp_ed137_diff() tells which fields
+ * differ between two decoded extensions without keeping a copy of the
+ * previous extension, and #pjmedia_rtp_ed137_encode() writes an extension
+ * directly in the RTP packet being built.
+ *
+ * The first word of the extension is also kept as it was received, in
+ * #pjmedia_rtp_ed137_ext.info, for the PJMEDIA_RTP_RD_EX_GET_*() macros.
+ */
+
+PJ_BEGIN_DECL
+
+/**
+ * Value of the profile field (host byte order) of the header extensions
+ * sent by pjmedia.
+ */
+#define PJMEDIA_RTP_ED137_PROFILE	0x0167
+
+/**
+ * Check whether the profile field (host byte order) of a header
+ * extension identifies an ED-137 (EUROCAE WG-67) extension.
+ */
+#define PJMEDIA_RTP_ED137_IS_PROFILE(p)	(((p) & 0x00FF) == 0x67)
+
+/**
+ * Maximum length, in 32 bit words and without the profile/length word,
+ * of the extensions written by #pjmedia_rtp_ed137_encode().
+ */
+#define PJMEDIA_RTP_ED137_MAX_WORDS	6
+
+
+/**
+ * TLV types of the ED-137 header extension.
+ */
+typedef enum pjmedia_rtp_ed137_tlv
+{
+    PJMEDIA_RTP_ED137_TLV_BSS	 = 1,	/**< BSS quality index, 1 byte	    */
+    PJMEDIA_RTP_ED137_TLV_CLD	 = 2,	/**< CLIMAX delay, 1 byte	    */
+    PJMEDIA_RTP_ED137_TLV_CLIMAX = 4	/**< RMM (3 bytes) or MAM (12 bytes)*/
+} pjmedia_rtp_ed137_tlv;
+
+
+/**
+ * Fields of #pjmedia_rtp_ed137_ext. They are the bits of the mask returned
+ * by #pjmedia_rtp_ed137_diff(), and the TLV ones also the bits of
+ * #pjmedia_rtp_ed137_ext.present.
+ */
+enum pjmedia_rtp_ed137_field
+{
+    PJMEDIA_RTP_ED137_PTT_TYPE	= 0x0001,   /**< PTT type		    */
+    PJMEDIA_RTP_ED137_SQU	= 0x0002,   /**< Squelch		    */
+    PJMEDIA_RTP_ED137_PTT_ID	= 0x0004,   /**< PTT-ID			    */
+    PJMEDIA_RTP_ED137_PM	= 0x0008,   /**< PTT mute		    */
+    PJMEDIA_RTP_ED137_PTTS	= 0x0010,   /**< PTT summation		    */
+    PJMEDIA_RTP_ED137_RESERVED	= 0x0020,   /**< Reserved bits (SCT)	    */
+    PJMEDIA_RTP_ED137_X		= 0x0040,   /**< TLVs follow		    */
+    PJMEDIA_RTP_ED137_BSS	= 0x0080,   /**< BSS TLV		    */
+    PJMEDIA_RTP_ED137_CLD	= 0x0100,   /**< CLD TLV		    */
+    PJMEDIA_RTP_ED137_RMM	= 0x0200,   /**< RMM TLV		    */
+    PJMEDIA_RTP_ED137_MAM	= 0x0400,   /**< MAM TLV		    */
+    PJMEDIA_RTP_ED137_OTHER	= 0x0800    /**< Length, unknown TLVs	    */
+};
+
+
+/**
+ * Content of the MAM (Measured Answer Message) TLV. Times are in units of
+ * 125 usec.
+ */
+typedef struct pjmedia_rtp_ed137_mam
+{
+    pj_uint8_t	tqg;	    /**< Time quality of the ground station	    */
+    pj_uint32_t	t1;	    /**< T1 of the RMM answered, 23 bits	    */
+    pj_uint8_t	nmr;	    /**< New measurement requested		    */
+    pj_uint32_t	t2;	    /**< Time the RMM arrived at the radio, 23 bits */
+    pj_uint16_t	tsd;	    /**< Tsd, radio system delay		    */
+    pj_uint16_t	tj1;	    /**< Tj1, jitter buffer delay at the radio	    */
+    pj_uint16_t	tid;	    /**< Tid, radio internal delay		    */
+} pjmedia_rtp_ed137_mam;
+
+
+/**
+ * Decoded ED-137 header extension.
+ */
+typedef struct pjmedia_rtp_ed137_ext
+{
+    pj_uint16_t	profile;    /**< Profile field, host byte order.	    */
+    unsigned	words;	    /**< Length in 32 bit words, without the
+				 profile/length word. Zero if the packet
+				 has no extension.			    */
+    pj_uint32_t	info;	    /**< First word as received, for the
+				 PJMEDIA_RTP_RD_EX_GET_*() macros.	    */
+    pj_uint16_t	base;	    /**< First two bytes, network byte order.	    */
+
+    pj_uint8_t	ptt_type;   /**< PTT type, 3 bits.			    */
+    pj_uint8_t	squ;	    /**< Squelch.				    */
+    pj_uint8_t	ptt_id;	    /**< PTT-ID, 6 bits.			    */
+    pj_uint8_t	pm;	    /**< PTT mute.				    */
+    pj_uint8_t	ptts;	    /**< PTT summation.				    */
+    pj_uint8_t	reserved;   /**< Reserved bits, 3 bits. The upper one is
+				 SCT.					    */
+    pj_uint8_t	x;	    /**< TLVs follow.				    */
+
+    unsigned	present;    /**< TLVs decoded, PJMEDIA_RTP_ED137_BSS,
+				 _CLD, _RMM and _MAM bits.		    */
+    pj_uint8_t	bss_qidx;   /**< BSS quality index, 5 bits.		    */
+    pj_uint8_t	bss_method; /**< BSS method, 3 bits.			    */
+    pj_uint8_t	cld;	    /**< CLD value.				    */
+    pj_uint8_t	rmm_tqv;    /**< RMM time quality.			    */
+    pj_uint32_t	rmm_t1;	    /**< RMM T1, 23 bits, 125 usec units.	    */
+    pjmedia_rtp_ed137_mam mam;	/**< MAM content.			    */
+
+    pj_uint32_t	other_hash; /**< Hash of the bytes not decoded (unknown
+				 TLVs), zero if there are none.		    */
+    pj_bool_t	truncated;  /**< The last TLV is longer than the
+				 extension.				    */
+} pjmedia_rtp_ed137_ext;
+
+
+/**
+ * Decode a header extension. The signalling fields are decoded whatever
+ * the profile is, the TLVs only for ED-137 extensions with the X bit set.
+ * Unknown TLVs and TLVs with an unexpected length are not decoded, but
+ * accounted in #pjmedia_rtp_ed137_ext.other_hash.
+ *
+ * @param ext		The decoded extension.
+ * @param profile	Profile field of the extension, host byte order.
+ * @param data		The extension, after the profile/length word.
+ * @param words		Length of the extension in 32 bit words. Zero
+ *			when the packet has no extension.
+ *
+ * @return		PJ_SUCCESS, or PJMEDIA_RTP_EINLEN if the last TLV
+ *			is truncated. The fields before it are decoded
+ *			anyway.
+ */
+PJ_DECL(pj_status_t) pjmedia_rtp_ed137_decode(pjmedia_rtp_ed137_ext *ext,
+					      pj_uint16_t profile,
+					      const void *data,
+					      unsigned words);
+
+/**
+ * Compare two decoded extensions. The signalling fields are compared with
+ * a single XOR of the first two bytes, the TLVs by their decoded values,
+ * and the rest by its hash.
+ *
+ * @param prev		The previous extension.
+ * @param ext		The current extension.
+ *
+ * @return		Mask of the fields that differ, zero if the
+ *			extensions are equal.
+ */
+PJ_DECL(unsigned) pjmedia_rtp_ed137_diff(const pjmedia_rtp_ed137_ext *prev,
+					 const pjmedia_rtp_ed137_ext *ext);
+
+/**
+ * Write a header extension, with the profile/length word made of
+ * #pjmedia_rtp_ed137_ext.profile and the length of the TLVs written. The
+ * signalling fields are taken from the decoded fields, not from
+ * #pjmedia_rtp_ed137_ext.info, and the TLVs in #pjmedia_rtp_ed137_ext.present
+ * are written in the order BSS, CLD, RMM, MAM. The X bit is written as it
+ * is in \a ext.
+ *
+ * @param ext		The extension.
+ * @param buf		Where to write it, usually right after the RTP
+ *			header of the packet being built.
+ * @param size		Size of the buffer.
+ * @param len		On return, the number of bytes written.
+ *
+ * @return		PJ_SUCCESS, or PJ_ETOOSMALL.
+ */
+PJ_DECL(pj_status_t) pjmedia_rtp_ed137_encode(const pjmedia_rtp_ed137_ext *ext,
+					      void *buf, unsigned size,
+					      unsigned *len);
+
+
+PJ_END_DECL
+
+/**
+ * @}
+ */
+
+#endif	/* __PJMEDIA_RTP_ED137_H__ */
@@ -31,6 +31,7 @@
 #include <pjmedia/jbuf.h>
 #include <pjmedia/port.h>
 #include <pjmedia/rtcp.h>
+#include <pjmedia/rtp_ed137.h>
 #include <pjmedia/transport.h>
 #include <pj/sock.h>
 
@@ -162,11 +163,59 @@ PJ_DECL(void) pjmedia_stream_enable_ec(pj_pool_t *pool, pjmedia_stream * stream,
 PJ_DECL(void) pjmedia_stream_set_climax_param(pjmedia_stream * stream, pj_bool_t NTP_synchronized);
 PJ_DECL(void) pjmedia_stream_set_request_MAM(pjmedia_stream * stream);
 PJ_DECL(void) pjmedia_stream_force_send_KA_packet(pjmedia_stream * stream);
+
+/**
+ * Send now, outside the clock tick, an R2S keep-alive with the current
+ * RTP header extension, so that a PTT or squelch change reaches the peer
+ * without waiting for the next frame. The RTP timestamp and sequence stay
+ * continuous. Only for R2S keep-alive streams with the extension enabled.
+ *
+ * @param stream	The media stream.
+ *
+ * @return		PJ_SUCCESS if sent, PJ_EINVALIDOP if the stream
+ *			cannot carry it (use pjmedia_stream_force_send_KA_packet()).
+ */
+PJ_DECL(pj_status_t) pjmedia_stream_send_KA_packet_now(pjmedia_stream * stream);
 PJ_DECL(void) pjmedia_stream_force_set_impairments(pjmedia_stream * stream, int Perdidos, int Duplicados, int LatMin, int LatMax);
 PJ_DECL(void) pjmedia_stream_reset_ext_header(pjmedia_stream * stream);
 PJ_DECL(void) pjmedia_stream_get_last_T1(pjmedia_stream * stream, pj_uint32_t *last_T1);
 PJ_DECL(void) pjmedia_stream_set_rx_only(pjmedia_stream * stream, pj_bool_t rx_only);
 
+/**
+ * Decode a received frame. It is meant to be called from the
+ * pj_app_cbs.on_stream_rtp callback with the frame given there. When the
+ * stream keeps a decoded frame cache (see PJMEDIA_STREAM_RX_PCM_CACHE),
+ * the samples are left in the cache and the stream reuses them instead of
+ * decoding the frame again when it is taken from the jitter buffer.
+ *
+ * @param stream	The stream.
+ * @param frame		Encoded frame, as given to on_stream_rtp.
+ * @param ext_seq	Frame sequence, as given to on_stream_rtp.
+ * @param pcm		On input, buffer and size where to decode the frame
+ *			when it can not be cached. On output, the decoded
+ *			frame. If it is cached, pcm->buf points to the cache,
+ *			and is only valid until the callback returns.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_stream_decode_rx_frame(pjmedia_stream *stream,
+						    const pjmedia_frame *frame,
+						    unsigned ext_seq,
+						    pjmedia_frame *pcm);
+
+/**
+ * Get the last ED-137 header extension received, decoded. It is meant to be
+ * called from the pj_app_cbs.on_stream_rtp_ext_info_changed callback.
+ *
+ * @param stream	The stream.
+ * @param ext		The decoded extension.
+ * @param changed	Optional, the fields (pjmedia_rtp_ed137_field) that
+ *			changed the last time the extension changed.
+ */
+PJ_DECL(void) pjmedia_stream_get_rx_rtp_ext(pjmedia_stream *stream,
+					    pjmedia_rtp_ed137_ext *ext,
+					    unsigned *changed);
+
 /**
 * Get user data of the stream.
 *
@@ -56,7 +56,15 @@ enum pjmedia_transport_udp_options
      * received.
      * Specifying this option will disable this feature.
      */
-    PJMEDIA_UDP_NO_SRC_ADDR_CHECKING = 1
+    PJMEDIA_UDP_NO_SRC_ADDR_CHECKING = 1,
+
+    /**
+     * After each incoming RTP packet reported by the ioqueue, read the
+     * packets already queued in the socket with one recvmmsg() call, up to
+     * PJMEDIA_UDP_RX_BATCH_SIZE packets, instead of one system call per
+     * packet. The option is ignored when PJMEDIA_HAS_UDP_BATCH_RX is zero.
+     */
+    PJMEDIA_UDP_BATCH_RX = 2
 };
 
 
@@ -93,6 +93,17 @@ static FILE *fhnd_rec;
 #define IS_OVERFLOW(s) ((s > MAX_LEVEL) || (s < MIN_LEVEL))
 
 
+/* Use SSE2 for the mixing kernels when the compiler targets it. */
+#if defined(PJMEDIA_CONF_USE_SSE2) && PJMEDIA_CONF_USE_SSE2!=0 && \
+    (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || \
+     defined(__SSE2__))
+#   include <emmintrin.h>
+#   define CONF_HAS_SSE2    1
+#else
+#   define CONF_HAS_SSE2    0
+#endif
+
+
 /*
 * DON'T GET CONFUSED WITH TX/RX!!
 *
@@ -163,6 +174,10 @@ struct conf_port
 
 	int			 mix_adj;	/**< Adjustment level for mix_buf.  */
 	int			 last_mix_adj;	/**< Last adjustment level.	    */
+	unsigned		 mix_cnt;	/**< # of sources in mix_buf in the
+						     current clock tick. The first
+						     source is copied, so mix_buf
+						     is only valid if non-zero.	    */
 	pj_int32_t		*mix_buf;	/**< Total sum of signal.	    */
 
 	/* Tx buffer is a temporary buffer to be used when there's mismatch 
@@ -232,6 +247,9 @@ struct pjmedia_conf
 	char		  master_name_buf[80]; /**< Port0 name buffer.	    */
 	pj_mutex_t		 *mutex;	/**< Conference mutex.		    */
 	struct conf_port	**ports;	/**< Array of ports.		    */
+	SLOT_TYPE		 *active_slots;	/**< Used slots, sorted, port_cnt
+						     entries. The clock iterates
+						     this instead of ports[].	    */
 	unsigned		  clock_rate;	/**< Sampling rate.		    */
 	unsigned		  channel_count;/**< Number of channels (1=mono).   */
 	unsigned		  samples_per_frame;	/**< Samples per frame.	    */
@@ -250,6 +268,292 @@ static pj_status_t destroy_port(pjmedia_port *this_port);
 static pj_status_t destroy_port_pasv(pjmedia_port *this_port);
 
 
+/*
+* Mixing kernels. Each has a scalar version and, when available, an SSE2
+* version. The SSE2 versions process 8 samples per iteration and finish
+* the remaining samples with the scalar code; the results are the same.
+*/
+
+/* Sum of the absolute values of the samples. */
+static pj_int32_t level_sum(const pj_int16_t *buf, unsigned count)
+{
+	pj_int32_t level = 0;
+	unsigned j = 0;
+
+#if CONF_HAS_SSE2
+	__m128i acc = _mm_setzero_si128();
+
+	for (; j+8 <= count; j+=8) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(buf+j));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+		__m128i slo = _mm_srai_epi32(lo, 31);
+		__m128i shi = _mm_srai_epi32(hi, 31);
+
+		acc = _mm_add_epi32(acc, _mm_sub_epi32(_mm_xor_si128(lo, slo), slo));
+		acc = _mm_add_epi32(acc, _mm_sub_epi32(_mm_xor_si128(hi, shi), shi));
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1,0,3,2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2,3,0,1)));
+	level = _mm_cvtsi128_si32(acc);
+#endif
+
+	for (; j<count; ++j) {
+		level += (buf[j]>=0? buf[j] : -buf[j]);
+	}
+
+	return level;
+}
+
+/* Apply level adjustment (adj/NORMAL_LEVEL) to the samples, clipping
+* the signal if it's too loud, and return the sum of the absolute values
+* of the adjusted samples.
+*/
+static pj_int32_t adjust_level(pj_int16_t *buf, unsigned count, unsigned adj)
+{
+	pj_int32_t level = 0;
+	unsigned j = 0;
+
+#if CONF_HAS_SSE2
+	/* adj is at most 255, it fits in a signed 16bit multiplier */
+	if (adj <= 0x7FFF) {
+		__m128i vadj = _mm_set1_epi16((short)adj);
+
+		for (; j+8 <= count; j+=8) {
+			__m128i x = _mm_loadu_si128((const __m128i*)(buf+j));
+			__m128i plo = _mm_mullo_epi16(x, vadj);
+			__m128i phi = _mm_mulhi_epi16(x, vadj);
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(plo, phi), 7);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(plo, phi), 7);
+
+			/* Saturating pack does the clipping */
+			_mm_storeu_si128((__m128i*)(buf+j), _mm_packs_epi32(lo, hi));
+		}
+		level = level_sum(buf, j);
+	}
+#endif
+
+	for (; j<count; ++j) {
+		/* For the level adjustment, we need to store the sample to
+		* a temporary 32bit integer value to avoid overflowing the
+		* 16bit sample storage.
+		*/
+		pj_int32_t itemp;
+
+		itemp = buf[j];
+		/*itemp = itemp * adj / NORMAL_LEVEL;*/
+		/* bad code (signed/unsigned badness):
+		*  itemp = (itemp * conf_port->rx_adj_level) >> 7;
+		*/
+		itemp *= adj;
+		itemp >>= 7;
+
+		/* Clip the signal if it's too loud */
+		if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
+		else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
+
+		buf[j] = (pj_int16_t) itemp;
+		level += (buf[j]>=0? buf[j] : -buf[j]);
+	}
+
+	return level;
+}
+
+/* Add the samples to the mix buffer (or copy them, if it's the first
+* source of the mix), and lower *mix_adj if the mixed signal overflows.
+*/
+static void mix_samples(pj_int32_t *mix_buf, const pj_int16_t *buf,
+			unsigned count, pj_bool_t first, int *mix_adj)
+{
+	pj_int32_t max_val = 0, min_val = 0;
+	unsigned k = 0;
+
+	if (first) {
+		/* A single source can not overflow */
+#if CONF_HAS_SSE2
+		for (; k+8 <= count; k+=8) {
+			__m128i x = _mm_loadu_si128((const __m128i*)(buf+k));
+			_mm_storeu_si128((__m128i*)(mix_buf+k),
+				_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+			_mm_storeu_si128((__m128i*)(mix_buf+k+4),
+				_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+		}
+#endif
+		for (; k<count; ++k)
+			mix_buf[k] = buf[k];
+		return;
+	}
+
+#if CONF_HAS_SSE2
+	{
+		__m128i vmax = _mm_setzero_si128();
+		__m128i vmin = _mm_setzero_si128();
+		__m128i mx, mn, gt, lt;
+		pj_int32_t tmp[4];
+		int n;
+
+		for (; k+8 <= count; k+=8) {
+			__m128i x = _mm_loadu_si128((const __m128i*)(buf+k));
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+			__m128i m0 = _mm_loadu_si128((const __m128i*)(mix_buf+k));
+			__m128i m1 = _mm_loadu_si128((const __m128i*)(mix_buf+k+4));
+
+			m0 = _mm_add_epi32(m0, lo);
+			m1 = _mm_add_epi32(m1, hi);
+			_mm_storeu_si128((__m128i*)(mix_buf+k), m0);
+			_mm_storeu_si128((__m128i*)(mix_buf+k+4), m1);
+
+			/* No _mm_max_epi32()/_mm_min_epi32() in SSE2 */
+			gt = _mm_cmpgt_epi32(m0, m1);
+			mx = _mm_or_si128(_mm_and_si128(gt, m0), _mm_andnot_si128(gt, m1));
+			mn = _mm_or_si128(_mm_and_si128(gt, m1), _mm_andnot_si128(gt, m0));
+			gt = _mm_cmpgt_epi32(mx, vmax);
+			vmax = _mm_or_si128(_mm_and_si128(gt, mx), _mm_andnot_si128(gt, vmax));
+			lt = _mm_cmplt_epi32(mn, vmin);
+			vmin = _mm_or_si128(_mm_and_si128(lt, mn), _mm_andnot_si128(lt, vmin));
+		}
+
+		_mm_storeu_si128((__m128i*)tmp, vmax);
+		for (n=0; n<4; ++n) if (tmp[n] > max_val) max_val = tmp[n];
+		_mm_storeu_si128((__m128i*)tmp, vmin);
+		for (n=0; n<4; ++n) if (tmp[n] < min_val) min_val = tmp[n];
+	}
+#endif
+
+	for (; k<count; ++k) {
+		mix_buf[k] += buf[k];
+		if (mix_buf[k] > max_val) max_val = mix_buf[k];
+		else if (mix_buf[k] < min_val) min_val = mix_buf[k];
+	}
+
+	/* Check if normalization adjustment needed. The adjustment is
+	* NORMAL_LEVEL * MAX_LEVEL / mix_buf[k] for the overflowed sample
+	* with the largest magnitude.
+	*/
+	if (IS_OVERFLOW(max_val)) {
+		int tmp_adj = (MAX_LEVEL<<7) / max_val;
+		if (tmp_adj < *mix_adj)
+			*mix_adj = tmp_adj;
+	}
+	if (IS_OVERFLOW(min_val)) {
+		int tmp_adj = (MAX_LEVEL<<7) / -min_val;
+		if (tmp_adj < *mix_adj)
+			*mix_adj = tmp_adj;
+	}
+}
+
+/* Convert the mixed samples from 32bit to 16bit in the mix buffer itself,
+* applying level adjustment (adj_level/NORMAL_LEVEL) and clipping if
+* adj_level is not NORMAL_LEVEL, and return the sum of the absolute
+* values of the resulting samples.
+*/
+static pj_int32_t mix_to_pcm(pj_int32_t *mix_buf, unsigned count,
+			     pj_int32_t adj_level)
+{
+	pj_int16_t *buf = (pj_int16_t*) mix_buf;
+	pj_int32_t level = 0;
+	unsigned j = 0;
+
+#if CONF_HAS_SSE2
+	/* The 16bit output of each iteration is written below the 32bit
+	* input that has not been read yet.
+	*/
+	if (adj_level != NORMAL_LEVEL) {
+		__m128i vadj = _mm_set1_epi32(adj_level);
+
+		for (; j+8 <= count; j+=8) {
+			__m128i m0 = _mm_loadu_si128((const __m128i*)(mix_buf+j));
+			__m128i m1 = _mm_loadu_si128((const __m128i*)(mix_buf+j+4));
+			__m128i e, o;
+
+			/* 32bit multiplication, low part, in two steps for the
+			* even and odd elements. No _mm_mullo_epi32() in SSE2.
+			*/
+			e = _mm_mul_epu32(m0, vadj);
+			o = _mm_mul_epu32(_mm_srli_si128(m0, 4), vadj);
+			m0 = _mm_unpacklo_epi32(_mm_shuffle_epi32(e, _MM_SHUFFLE(0,0,2,0)),
+						_mm_shuffle_epi32(o, _MM_SHUFFLE(0,0,2,0)));
+			e = _mm_mul_epu32(m1, vadj);
+			o = _mm_mul_epu32(_mm_srli_si128(m1, 4), vadj);
+			m1 = _mm_unpacklo_epi32(_mm_shuffle_epi32(e, _MM_SHUFFLE(0,0,2,0)),
+						_mm_shuffle_epi32(o, _MM_SHUFFLE(0,0,2,0)));
+
+			/* Saturating pack does the clipping */
+			_mm_storeu_si128((__m128i*)(buf+j),
+				_mm_packs_epi32(_mm_srai_epi32(m0, 7),
+						_mm_srai_epi32(m1, 7)));
+		}
+	} else {
+		for (; j+8 <= count; j+=8) {
+			__m128i m0 = _mm_loadu_si128((const __m128i*)(mix_buf+j));
+			__m128i m1 = _mm_loadu_si128((const __m128i*)(mix_buf+j+4));
+
+			/* Plain cast to 16bit: sign extend the low half first so
+			* that the pack does not saturate.
+			*/
+			m0 = _mm_srai_epi32(_mm_slli_epi32(m0, 16), 16);
+			m1 = _mm_srai_epi32(_mm_slli_epi32(m1, 16), 16);
+			_mm_storeu_si128((__m128i*)(buf+j), _mm_packs_epi32(m0, m1));
+		}
+	}
+	level = level_sum(buf, j);
+#endif
+
+	if (adj_level != NORMAL_LEVEL) {
+		for (; j<count; ++j) {
+			pj_int32_t itemp = mix_buf[j];
+
+			/* Adjust the level */
+			/*itemp = itemp * adj_level / NORMAL_LEVEL;*/
+			itemp = (itemp * adj_level) >> 7;
+
+			/* Clip the signal if it's too loud */
+			if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
+			else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
+
+			/* Put back in the buffer. */
+			buf[j] = (pj_int16_t) itemp;
+
+			level += (buf[j]>=0? buf[j] : -buf[j]);
+		}
+	} else {
+		for (; j<count; ++j) {
+			buf[j] = (pj_int16_t) mix_buf[j];
+			level += (buf[j]>=0? buf[j] : -buf[j]);
+		}
+	}
+
+	return level;
+}
+
+/* Add a slot to the sorted list of used slots. */
+static void add_active_slot(pjmedia_conf *conf, SLOT_TYPE slot)
+{
+	unsigned i = conf->port_cnt;
+
+	while (i > 0 && conf->active_slots[i-1] > slot) {
+		conf->active_slots[i] = conf->active_slots[i-1];
+		--i;
+	}
+	conf->active_slots[i] = slot;
+}
+
+/* Remove a slot from the sorted list of used slots. */
+static void remove_active_slot(pjmedia_conf *conf, SLOT_TYPE slot)
+{
+	unsigned i;
+
+	for (i=0; i<conf->port_cnt; ++i) {
+		if (conf->active_slots[i] == slot) {
+			pj_array_erase(conf->active_slots, sizeof(SLOT_TYPE),
+				       conf->port_cnt, i);
+			break;
+		}
+	}
+}
+
+
 /*
 * Create port.
 */
@@ -510,6 +814,7 @@ static pj_status_t create_sound_port( pj_pool_t *pool,
 
 	/* Add the port to the bridge */
 	conf->ports[0] = conf_port;
+	add_active_slot(conf, 0);
 	conf->port_cnt++;
 
 	return PJ_SUCCESS;
@@ -545,6 +850,10 @@ PJ_DEF(pj_status_t) pjmedia_conf_create( pj_pool_t *pool,
 		pj_pool_zalloc(pool, max_ports*sizeof(void*));
 	PJ_ASSERT_RETURN(conf->ports, PJ_ENOMEM);
 
+	conf->active_slots = (SLOT_TYPE*)
+		pj_pool_zalloc(pool, max_ports*sizeof(SLOT_TYPE));
+	PJ_ASSERT_RETURN(conf->active_slots, PJ_ENOMEM);
+
 	conf->options = options;
 	conf->max_ports = max_ports;
 	conf->clock_rate = clock_rate;
@@ -782,6 +1091,7 @@ PJ_DEF(pj_status_t) pjmedia_conf_add_port( pjmedia_conf *conf,
 
 	/* Put the port. */
 	conf->ports[index] = conf_port;
+	add_active_slot(conf, index);
 	conf->port_cnt++;
 
 	/* Done. */
@@ -884,6 +1194,7 @@ PJ_DEF(pj_status_t) pjmedia_conf_add_passive_port( pjmedia_conf *conf,
 
 	/* Put the port. */
 	conf->ports[index] = conf_port;
+	add_active_slot(conf, index);
 	conf->port_cnt++;
 
 	/* Done. */
@@ -1176,6 +1487,7 @@ PJ_DEF(pj_status_t) pjmedia_conf_remove_port( pjmedia_conf *conf,
 
 	/* Remove the port. */
 	conf->ports[port] = NULL;
+	remove_active_slot(conf, port);
 	--conf->port_cnt;
 
 	pj_mutex_unlock(conf->mutex);
@@ -1560,7 +1872,7 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
 										pjmedia_frame_type *frm_type)
 {
 	pj_int16_t *buf;
-	unsigned j, ts;
+	unsigned ts;
 	pj_status_t status;
 	pj_int32_t adj_level;
 	pj_int32_t tx_level;
@@ -1646,32 +1958,16 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
 	adj_level = cport->tx_adj_level * cport->mix_adj;
 	adj_level >>= 7;
 
-	tx_level = 0;
-
-	if (adj_level != NORMAL_LEVEL) {
-		for (j=0; j<conf->samples_per_frame; ++j) {
-			pj_int32_t itemp = cport->mix_buf[j];
-
-			/* Adjust the level */
-			/*itemp = itemp * adj_level / NORMAL_LEVEL;*/
-			itemp = (itemp * adj_level) >> 7;
-
-			/* Clip the signal if it's too loud */
-			if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-			else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-			/* Put back in the buffer. */
-			buf[j] = (pj_int16_t) itemp;
-
-			tx_level += (buf[j]>=0? buf[j] : -buf[j]);
-		}
-	} else {
-		for (j=0; j<conf->samples_per_frame; ++j) {
-			buf[j] = (pj_int16_t) cport->mix_buf[j];
-			tx_level += (buf[j]>=0? buf[j] : -buf[j]);
-		}
+	/* Nobody has actually transmitted to this port in this clock tick
+	* (e.g. all its sources were silent): transmit silence.
+	*/
+	if (cport->mix_cnt == 0) {
+		pj_bzero(cport->mix_buf,
+			conf->samples_per_frame*sizeof(cport->mix_buf[0]));
 	}
 
+	tx_level = mix_to_pcm(cport->mix_buf, conf->samples_per_frame, adj_level);
+
 	tx_level /= conf->samples_per_frame;
 
 	/* Convert level to 8bit complement ulaw */
@@ -1801,8 +2097,9 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 {
 	pjmedia_conf *conf = (pjmedia_conf*) this_port->port_data.pdata;
 	pjmedia_frame_type speaker_frame_type = PJMEDIA_FRAME_TYPE_NONE;
-	unsigned ci, cj, i, j;
+	unsigned ci, cj, i;
 	pj_int16_t *p_in;
+	pj_bool_t silent;
 
 	TRACE_((THIS_FILE, "- clock -"));
 
@@ -1813,39 +2110,27 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 	/* Must lock mutex */
 	pj_mutex_lock(conf->mutex);
 
-	/* Reset port source count. We will only reset port's mix
-	* buffer when we have someone transmitting to it.
+	/* Reset port source count. The mix buffer is not cleared: the first
+	* source mixed to a port in this clock tick overwrites it, and 
+	* write_port() clears it if there was none.
 	*/
-	for (i=0, ci=0; i<conf->max_ports && ci < conf->port_cnt; ++i) {
-		struct conf_port *conf_port = conf->ports[i];
-
-		/* Skip empty slot. */
-		if (!conf_port)
-			continue;
+	for (ci=0; ci < conf->port_cnt; ++ci) {
+		struct conf_port *conf_port = conf->ports[conf->active_slots[ci]];
 
-		++ci;
-
-		/* Reset buffer & auto adjustment level for mixed signal */
+		/* Reset source count & auto adjustment level for mixed signal */
 		conf_port->mix_adj = NORMAL_LEVEL;
-		if (conf_port->transmitter_cnt) {
-			pj_bzero(conf_port->mix_buf,
-				conf->samples_per_frame*sizeof(conf_port->mix_buf[0]));
-		}
+		conf_port->mix_cnt = 0;
 	}
 
 	/* Get frames from all ports, and "mix" the signal 
 	* to mix_buf of all listeners of the port.
 	*/
-	for (i=0, ci=0; i<conf->max_ports && ci<conf->port_cnt; ++i) {
-		struct conf_port *conf_port = conf->ports[i];
+	for (ci=0; ci<conf->port_cnt; ++ci) {
+		struct conf_port *conf_port;
 		pj_int32_t level = 0;
 
-		/* Skip empty port. */
-		if (!conf_port)
-			continue;
-
-		/* Var "ci" is to count how many ports have been visited so far. */
-		++ci;
+		i = conf->active_slots[ci];
+		conf_port = conf->ports[i];
 
 		/* Skip if we're not allowed to receive from this port. */
 		if (conf_port->rx_setting == PJMEDIA_PORT_DISABLE) {
@@ -1907,34 +2192,15 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 		* and calculate the average level at the same time.
 		*/
 		if (conf_port->rx_adj_level != NORMAL_LEVEL) {
-			for (j=0; j<conf->samples_per_frame; ++j) {
-				/* For the level adjustment, we need to store the sample to
-				* a temporary 32bit integer value to avoid overflowing the
-				* 16bit sample storage.
-				*/
-				pj_int32_t itemp;
-
-				itemp = p_in[j];
-				/*itemp = itemp * adj / NORMAL_LEVEL;*/
-				/* bad code (signed/unsigned badness):
-				*  itemp = (itemp * conf_port->rx_adj_level) >> 7;
-				*/
-				itemp *= conf_port->rx_adj_level;
-				itemp >>= 7;
-
-				/* Clip the signal if it's too loud */
-				if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-				else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-				p_in[j] = (pj_int16_t) itemp;
-				level += (p_in[j]>=0? p_in[j] : -p_in[j]);
-			}
+			level = adjust_level(p_in, conf->samples_per_frame,
+				conf_port->rx_adj_level);
 		} else {
-			for (j=0; j<conf->samples_per_frame; ++j) {
-				level += (p_in[j]>=0? p_in[j] : -p_in[j]);
-			}
+			level = level_sum(p_in, conf->samples_per_frame);
 		}
 
+		/* A frame with all samples at zero adds nothing to the mix */
+		silent = (level == 0);
+
 		level /= conf->samples_per_frame;
 
 		/* Convert level to 8bit complement ulaw */
@@ -1949,12 +2215,13 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 		//if (level == 0)
 		//    continue;
 
+		if (silent)
+			continue;
+
 		/* Add the signal to all listeners. */
 		for (cj=0; cj < conf_port->listener_cnt; ++cj) 
 		{
 			struct conf_port *listener;
-			pj_int32_t *mix_buf;
-			unsigned k;
 
 			listener = conf->ports[conf_port->listener_slots[cj]];
 
@@ -1962,41 +2229,26 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 			if (listener->tx_setting != PJMEDIA_PORT_ENABLE)
 				continue;
 
-			mix_buf = listener->mix_buf;
-
 			/* Mixing signals,
 			* and calculate appropriate level adjustment if there is
 			* any overflowed level in the mixed signal.
 			*/
-			for (k=0; k<conf->samples_per_frame; ++k) {
-				mix_buf[k] += p_in[k];
-				/* Check if normalization adjustment needed. */
-				if (IS_OVERFLOW(mix_buf[k])) {
-					/* NORMAL_LEVEL * MAX_LEVEL / mix_buf[k]; */
-					int tmp_adj = (MAX_LEVEL<<7) / mix_buf[k];
-					if (tmp_adj<0) tmp_adj = -tmp_adj;
-
-					if (tmp_adj<listener->mix_adj)
-						listener->mix_adj = tmp_adj;
-
-				} /* if any overflow in the mixed signals */
-			} /* loop mixing signals */
+			mix_samples(listener->mix_buf, p_in, conf->samples_per_frame,
+				listener->mix_cnt == 0, &listener->mix_adj);
+			++listener->mix_cnt;
 		} /* loop the listeners of conf port */
 	} /* loop of all conf ports */
 
 	/* Time for all ports to transmit whetever they have in their
 	* buffer. 
 	*/
-	for (i=0, ci=0; i<conf->max_ports && ci<conf->port_cnt; ++i) {
-		struct conf_port *conf_port = conf->ports[i];
+	for (ci=0; ci<conf->port_cnt; ++ci) {
+		struct conf_port *conf_port;
 		pjmedia_frame_type frm_type;
 		pj_status_t status;
 
-		if (!conf_port)
-			continue;
-
-		/* Var "ci" is to count how many ports have been visited. */
-		++ci;
+		i = conf->active_slots[ci];
+		conf_port = conf->ports[i];
 
 		status = write_port( conf, conf_port, &frame->timestamp,
 			&frm_type);
@@ -61,6 +61,13 @@ static int PJ_THREAD_FUNC worker_proc(void*);
 #define MAX_THREADS	16
 
 
+/** Worker thread and the ioqueue it polls. */
+struct endpt_worker
+{
+    pjmedia_endpt	 *endpt;
+    pj_ioqueue_t	 *ioqueue;
+};
+
 /** Concrete declaration of media endpoint. */
 struct pjmedia_endpt
 {
@@ -85,17 +92,35 @@ struct pjmedia_endpt
     /** IOqueue polling thread, if any. */
     pj_thread_t		 *thread[MAX_THREADS];
 
+    /** Argument of each polling thread. */
+    struct endpt_worker	  worker[MAX_THREADS];
+
+    /** Number of ioqueues owned by the workers, when each worker has its
+     *  own ioqueue (pjmedia_endpt_create_workers()). ioq[0] is also the
+     *  main ioqueue. Zero when all the workers poll the main ioqueue. */
+    unsigned		  ioq_cnt;
+
+    /** Per worker ioqueues. */
+    pj_ioqueue_t	 *ioq[MAX_THREADS];
+
+    /** Next per worker ioqueue to give to a media transport. */
+    unsigned		  ioq_next;
+
     /** To signal polling thread to quit. */
     pj_bool_t		  quit_flag;
 };
 
-/**
- * Initialize and get the instance of media endpoint.
+/*
+ * Create the media endpoint. With per_worker_ioq, each worker thread polls
+ * its own ioqueue, and the thread i is pinned to CPU first_cpu+i when
+ * first_cpu is not negative.
  */
-PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
-					 pj_ioqueue_t *ioqueue,
-					 unsigned worker_cnt,
-					 pjmedia_endpt **p_endpt)
+static pj_status_t create_endpt(pj_pool_factory *pf,
+				pj_ioqueue_t *ioqueue,
+				unsigned worker_cnt,
+				pj_bool_t per_worker_ioq,
+				int first_cpu,
+				pjmedia_endpt **p_endpt)
 {
     pj_pool_t *pool;
     pjmedia_endpt *endpt;
@@ -131,6 +156,20 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
     if (status != PJ_SUCCESS)
 	goto on_error;
 
+    /* Create one ioqueue for each worker, the first one is also the
+     * main ioqueue.
+     */
+    if (per_worker_ioq) {
+	for (i=0; i<worker_cnt; ++i) {
+	    status = pj_ioqueue_create( endpt->pool, PJ_IOQUEUE_MAX_HANDLES,
+					&endpt->ioq[i]);
+	    if (status != PJ_SUCCESS)
+		goto on_error;
+	    ++endpt->ioq_cnt;
+	}
+	endpt->ioqueue = endpt->ioq[0];
+    }
+
     /* Create ioqueue if none is specified. */
     if (endpt->ioqueue == NULL) {
 	
@@ -149,10 +188,28 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
 
     /* Create worker threads if asked. */
     for (i=0; i<worker_cnt; ++i) {
+	endpt->worker[i].endpt = endpt;
+	endpt->worker[i].ioqueue = endpt->ioq_cnt ? endpt->ioq[i] : 
+						    endpt->ioqueue;
+
 	status = pj_thread_create( endpt->pool, "media", &worker_proc,
-				   endpt, 0, 0, &endpt->thread[i]);
+				   &endpt->worker[i], 0, 0, &endpt->thread[i]);
 	if (status != PJ_SUCCESS)
 	    goto on_error;
+
+	if (first_cpu >= 0) {
+	    status = pj_thread_set_affinity(endpt->thread[i], first_cpu + i);
+	    if (status != PJ_SUCCESS) {
+		PJ_PERROR(4,(THIS_FILE, status, 
+			     "Unable to pin media worker %d to CPU %d", 
+			     i, first_cpu + i));
+	    }
+	}
+    }
+
+    if (endpt->ioq_cnt) {
+	PJ_LOG(4,(THIS_FILE, "Media endpoint created with %d workers, "
+			     "one ioqueue each", worker_cnt));
     }
 
 
@@ -172,12 +229,40 @@ on_error:
     if (endpt->ioqueue && endpt->own_ioqueue)
 	pj_ioqueue_destroy(endpt->ioqueue);
 
+    /* Destroy per worker ioqueues */
+    for (i=0; i<endpt->ioq_cnt; ++i)
+	pj_ioqueue_destroy(endpt->ioq[i]);
+
     pjmedia_codec_mgr_destroy(&endpt->codec_mgr);
     pjmedia_aud_subsys_shutdown();
     pj_pool_release(pool);
     return status;
 }
 
+/**
+ * Initialize and get the instance of media endpoint.
+ */
+PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
+					 pj_ioqueue_t *ioqueue,
+					 unsigned worker_cnt,
+					 pjmedia_endpt **p_endpt)
+{
+    return create_endpt(pf, ioqueue, worker_cnt, PJ_FALSE, -1, p_endpt);
+}
+
+/**
+ * Create media endpoint with one ioqueue per worker thread.
+ */
+PJ_DEF(pj_status_t) pjmedia_endpt_create_workers(pj_pool_factory *pf,
+						 unsigned worker_cnt,
+						 int first_cpu,
+						 pjmedia_endpt **p_endpt)
+{
+    PJ_ASSERT_RETURN(worker_cnt > 0, PJ_EINVAL);
+
+    return create_endpt(pf, NULL, worker_cnt, PJ_TRUE, first_cpu, p_endpt);
+}
+
 /**
  * Get the codec manager instance.
  */
@@ -212,6 +297,14 @@ PJ_DEF(pj_status_t) pjmedia_endpt_destroy (pjmedia_endpt *endpt)
 	endpt->ioqueue = NULL;
     }
 
+    /* Destroy per worker ioqueues */
+    for (i=0; i<endpt->ioq_cnt; ++i) {
+	pj_ioqueue_destroy(endpt->ioq[i]);
+	endpt->ioq[i] = NULL;
+    }
+    endpt->ioq_cnt = 0;
+    endpt->ioqueue = NULL;
+
     endpt->pf = NULL;
 
     pjmedia_codec_mgr_destroy(&endpt->codec_mgr);
@@ -231,6 +324,25 @@ PJ_DEF(pj_ioqueue_t*) pjmedia_endpt_get_ioqueue(pjmedia_endpt *endpt)
     return endpt->ioqueue;
 }
 
+/**
+ * Get the ioqueue to register the sockets of a new media transport.
+ */
+PJ_DEF(pj_ioqueue_t*) pjmedia_endpt_get_transport_ioqueue(pjmedia_endpt *endpt)
+{
+    unsigned idx;
+
+    PJ_ASSERT_RETURN(endpt, NULL);
+
+    if (endpt->ioq_cnt < 2)
+	return endpt->ioqueue;
+
+    /* Round-robin. A race between two transports created at the same time
+     * only affects the balance, not the correctness.
+     */
+    idx = endpt->ioq_next++ % endpt->ioq_cnt;
+    return endpt->ioq[idx];
+}
+
 /**
  * Get the number of worker threads in media endpoint.
  */
@@ -259,11 +371,12 @@ PJ_DEF(pj_thread_t*) pjmedia_endpt_get_thread(pjmedia_endpt *endpt,
  */
 static int PJ_THREAD_FUNC worker_proc(void *arg)
 {
-    pjmedia_endpt *endpt = (pjmedia_endpt*) arg;
+    struct endpt_worker *worker = (struct endpt_worker*) arg;
+    pjmedia_endpt *endpt = worker->endpt;
 
     while (!endpt->quit_flag) {
 	pj_time_val timeout = { 0, 500 };
-	pj_ioqueue_poll(endpt->ioqueue, &timeout);
+	pj_ioqueue_poll(worker->ioqueue, &timeout);
     }
 
     return 0;
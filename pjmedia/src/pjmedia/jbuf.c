@@ -258,7 +258,8 @@ static int jb_framelist_origin(const jb_framelist_t *framelist)
 static pj_bool_t jb_framelist_get(jb_framelist_t *framelist,
 				  void *frame, pj_size_t *size,
 				  pjmedia_jb_frame_type *p_type,
-				  pj_uint32_t *bit_info) 
+				  pj_uint32_t *bit_info,
+				  int *seq) 
 {
     if (framelist->size) {
 
@@ -281,6 +282,8 @@ static pj_bool_t jb_framelist_get(jb_framelist_t *framelist,
 		*size   = framelist->content_len[framelist->head];
 	    if (bit_info)
 		*bit_info = framelist->bit_info[framelist->head];
+	    if (seq)
+		*seq = framelist->origin;
 
 	    //pj_bzero(framelist->content + 
 	    //	 framelist->head * framelist->frame_size,
@@ -877,6 +880,19 @@ PJ_DEF(void) pjmedia_jbuf_get_frame2(pjmedia_jbuf *jb,
 				     pj_size_t *size,
 				     char *p_frame_type,
 				     pj_uint32_t *bit_info)
+{
+    pjmedia_jbuf_get_frame3(jb, frame, size, p_frame_type, bit_info, NULL);
+}
+
+/*
+ * Get frame from jitter buffer, along with its sequence number.
+ */
+PJ_DEF(void) pjmedia_jbuf_get_frame3(pjmedia_jbuf *jb, 
+				     void *frame, 
+				     pj_size_t *size,
+				     char *p_frame_type,
+				     pj_uint32_t *bit_info,
+				     int *seq)
 {
     if (jb->jb_status == JB_STATUS_PREFETCHING) {
 
@@ -901,7 +917,7 @@ PJ_DEF(void) pjmedia_jbuf_get_frame2(pjmedia_jbuf *jb,
 
 	/* Try to retrieve a frame from frame list */
 	res = jb_framelist_get(&jb->jb_framelist, frame, size, &ftype, 
-			       bit_info);
+			       bit_info, seq);
 	if (res) {
 	    /* We've successfully retrieved a frame from the frame list, but
 	     * the frame could be a blank frame!
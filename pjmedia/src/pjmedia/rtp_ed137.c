@@ -0,0 +1,290 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2009 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/rtp_ed137.h>
+#include <pjmedia/errno.h>
+#include <pj/assert.h>
+#include <pj/string.h>
+
+
+/* Bits of pjmedia_rtp_ed137_ext.base */
+#define BASE_PTT_TYPE	0xE000
+#define BASE_SQU	0x1000
+#define BASE_PTT_ID	0x0FC0
+#define BASE_PM		0x0020
+#define BASE_PTTS	0x0010
+#define BASE_RESERVED	0x000E
+#define BASE_X		0x0001
+
+/* Length of the TLV values */
+#define BSS_LEN		1
+#define CLD_LEN		1
+#define RMM_LEN		3
+#define MAM_LEN		12
+
+#define HASH_PRIME	16777619
+
+
+/*
+ * Account bytes which are not decoded. Zero bytes (padding) are skipped,
+ * the position of the others is hashed with them.
+ */
+static void hash_bytes(pjmedia_rtp_ed137_ext *ext, const pj_uint8_t *p,
+		       unsigned start, unsigned end)
+{
+    pj_uint32_t h = ext->other_hash;
+
+    for (; start < end; ++start) {
+	if (p[start]) {
+	    h ^= (start << 8) | p[start];
+	    h *= HASH_PRIME;
+	}
+    }
+    ext->other_hash = h;
+}
+
+static pj_uint32_t get_u23(const pj_uint8_t *p)
+{
+    return ((pj_uint32_t)(p[0] & 0x7F) << 16) | ((pj_uint32_t)p[1] << 8) |
+	   p[2];
+}
+
+static pj_uint16_t get_u16(const pj_uint8_t *p)
+{
+    return (pj_uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void put_u23(pj_uint8_t *p, pj_uint8_t flag, pj_uint32_t val)
+{
+    p[0] = (pj_uint8_t)(((flag & 1) << 7) | ((val >> 16) & 0x7F));
+    p[1] = (pj_uint8_t)(val >> 8);
+    p[2] = (pj_uint8_t)val;
+}
+
+static void put_u16(pj_uint8_t *p, pj_uint16_t val)
+{
+    p[0] = (pj_uint8_t)(val >> 8);
+    p[1] = (pj_uint8_t)val;
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_rtp_ed137_decode(pjmedia_rtp_ed137_ext *ext,
+					     pj_uint16_t profile,
+					     const void *data,
+					     unsigned words)
+{
+    const pj_uint8_t *p = (const pj_uint8_t*) data;
+    unsigned len = words * 4;
+    unsigned pos;
+
+    PJ_ASSERT_RETURN(ext && (data || words == 0), PJ_EINVAL);
+
+    pj_bzero(ext, sizeof(*ext));
+    ext->profile = profile;
+    ext->words = words;
+    if (words == 0)
+	return PJ_SUCCESS;
+
+    pj_memcpy(&ext->info, p, sizeof(ext->info));
+    ext->base = get_u16(p);
+    ext->ptt_type = (pj_uint8_t)(p[0] >> 5);
+    ext->squ = (pj_uint8_t)((p[0] >> 4) & 1);
+    ext->ptt_id = (pj_uint8_t)(((p[0] & 0x0F) << 2) | (p[1] >> 6));
+    ext->pm = (pj_uint8_t)((p[1] >> 5) & 1);
+    ext->ptts = (pj_uint8_t)((p[1] >> 4) & 1);
+    ext->reserved = (pj_uint8_t)((p[1] >> 1) & 7);
+    ext->x = (pj_uint8_t)(p[1] & 1);
+
+    if (!ext->x || !PJMEDIA_RTP_ED137_IS_PROFILE(profile)) {
+	hash_bytes(ext, p, 2, len);
+	return PJ_SUCCESS;
+    }
+
+    for (pos = 2; pos < len; ) {
+	unsigned type = p[pos] >> 4;
+	unsigned tlen = p[pos] & 0x0F;
+	const pj_uint8_t *v = p + pos + 1;
+
+	/* Padding */
+	if (p[pos] == 0) {
+	    ++pos;
+	    continue;
+	}
+
+	if (pos + 1 + tlen > len) {
+	    ext->truncated = PJ_TRUE;
+	    hash_bytes(ext, p, pos, len);
+	    return PJMEDIA_RTP_EINLEN;
+	}
+
+	if (type == PJMEDIA_RTP_ED137_TLV_BSS && tlen == BSS_LEN &&
+	    !(ext->present & PJMEDIA_RTP_ED137_BSS))
+	{
+	    ext->present |= PJMEDIA_RTP_ED137_BSS;
+	    ext->bss_qidx = (pj_uint8_t)(v[0] >> 3);
+	    ext->bss_method = (pj_uint8_t)(v[0] & 0x07);
+	}
+	else if (type == PJMEDIA_RTP_ED137_TLV_CLD && tlen == CLD_LEN &&
+		 !(ext->present & PJMEDIA_RTP_ED137_CLD))
+	{
+	    ext->present |= PJMEDIA_RTP_ED137_CLD;
+	    ext->cld = v[0];
+	}
+	else if (type == PJMEDIA_RTP_ED137_TLV_CLIMAX && tlen == RMM_LEN &&
+		 !(ext->present & PJMEDIA_RTP_ED137_RMM))
+	{
+	    ext->present |= PJMEDIA_RTP_ED137_RMM;
+	    ext->rmm_tqv = (pj_uint8_t)(v[0] >> 7);
+	    ext->rmm_t1 = get_u23(v);
+	}
+	else if (type == PJMEDIA_RTP_ED137_TLV_CLIMAX && tlen == MAM_LEN &&
+		 !(ext->present & PJMEDIA_RTP_ED137_MAM))
+	{
+	    ext->present |= PJMEDIA_RTP_ED137_MAM;
+	    ext->mam.tqg = (pj_uint8_t)(v[0] >> 7);
+	    ext->mam.t1 = get_u23(v);
+	    ext->mam.nmr = (pj_uint8_t)(v[3] >> 7);
+	    ext->mam.t2 = get_u23(v + 3);
+	    ext->mam.tsd = get_u16(v + 6);
+	    ext->mam.tj1 = get_u16(v + 8);
+	    ext->mam.tid = get_u16(v + 10);
+	}
+	else {
+	    hash_bytes(ext, p, pos, pos + 1 + tlen);
+	}
+
+	pos += 1 + tlen;
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(unsigned) pjmedia_rtp_ed137_diff(const pjmedia_rtp_ed137_ext *prev,
+					const pjmedia_rtp_ed137_ext *ext)
+{
+    unsigned d = prev->base ^ ext->base;
+    unsigned both = prev->present & ext->present;
+    unsigned changed = prev->present ^ ext->present;
+
+    if (d) {
+	if (d & BASE_PTT_TYPE)	changed |= PJMEDIA_RTP_ED137_PTT_TYPE;
+	if (d & BASE_SQU)	changed |= PJMEDIA_RTP_ED137_SQU;
+	if (d & BASE_PTT_ID)	changed |= PJMEDIA_RTP_ED137_PTT_ID;
+	if (d & BASE_PM)	changed |= PJMEDIA_RTP_ED137_PM;
+	if (d & BASE_PTTS)	changed |= PJMEDIA_RTP_ED137_PTTS;
+	if (d & BASE_RESERVED)	changed |= PJMEDIA_RTP_ED137_RESERVED;
+	if (d & BASE_X)		changed |= PJMEDIA_RTP_ED137_X;
+    }
+
+    if (both) {
+	if ((both & PJMEDIA_RTP_ED137_BSS) &&
+	    (prev->bss_qidx != ext->bss_qidx ||
+	     prev->bss_method != ext->bss_method))
+	{
+	    changed |= PJMEDIA_RTP_ED137_BSS;
+	}
+	if ((both & PJMEDIA_RTP_ED137_CLD) && prev->cld != ext->cld)
+	    changed |= PJMEDIA_RTP_ED137_CLD;
+	if ((both & PJMEDIA_RTP_ED137_RMM) &&
+	    (prev->rmm_tqv != ext->rmm_tqv || prev->rmm_t1 != ext->rmm_t1))
+	{
+	    changed |= PJMEDIA_RTP_ED137_RMM;
+	}
+	if ((both & PJMEDIA_RTP_ED137_MAM) &&
+	    (prev->mam.t1 != ext->mam.t1 || prev->mam.t2 != ext->mam.t2 ||
+	     prev->mam.tqg != ext->mam.tqg || prev->mam.nmr != ext->mam.nmr ||
+	     prev->mam.tsd != ext->mam.tsd || prev->mam.tj1 != ext->mam.tj1 ||
+	     prev->mam.tid != ext->mam.tid))
+	{
+	    changed |= PJMEDIA_RTP_ED137_MAM;
+	}
+    }
+
+    if (prev->words != ext->words || prev->profile != ext->profile ||
+	prev->other_hash != ext->other_hash ||
+	prev->truncated != ext->truncated)
+    {
+	changed |= PJMEDIA_RTP_ED137_OTHER;
+    }
+
+    return changed;
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_rtp_ed137_encode(const pjmedia_rtp_ed137_ext *ext,
+					     void *buf, unsigned size,
+					     unsigned *len)
+{
+    pj_uint8_t *p = (pj_uint8_t*) buf;
+    unsigned need = 2, words, total, pos;
+
+    PJ_ASSERT_RETURN(ext && buf && len, PJ_EINVAL);
+
+    if (ext->present & PJMEDIA_RTP_ED137_BSS)	need += 1 + BSS_LEN;
+    if (ext->present & PJMEDIA_RTP_ED137_CLD)	need += 1 + CLD_LEN;
+    if (ext->present & PJMEDIA_RTP_ED137_RMM)	need += 1 + RMM_LEN;
+    if (ext->present & PJMEDIA_RTP_ED137_MAM)	need += 1 + MAM_LEN;
+
+    words = (need + 3) / 4;
+    total = 4 + words * 4;
+    if (size < total)
+	return PJ_ETOOSMALL;
+
+    /* Profile and length, in network byte order */
+    put_u16(p, ext->profile);
+    put_u16(p + 2, (pj_uint16_t)words);
+
+    p[4] = (pj_uint8_t)(((ext->ptt_type & 7) << 5) | ((ext->squ & 1) << 4) |
+			((ext->ptt_id >> 2) & 0x0F));
+    p[5] = (pj_uint8_t)(((ext->ptt_id & 3) << 6) | ((ext->pm & 1) << 5) |
+			((ext->ptts & 1) << 4) | ((ext->reserved & 7) << 1) |
+			(ext->x & 1));
+    pos = 6;
+
+    if (ext->present & PJMEDIA_RTP_ED137_BSS) {
+	p[pos++] = (PJMEDIA_RTP_ED137_TLV_BSS << 4) | BSS_LEN;
+	p[pos++] = (pj_uint8_t)(((ext->bss_qidx & 0x1F) << 3) |
+				(ext->bss_method & 7));
+    }
+    if (ext->present & PJMEDIA_RTP_ED137_CLD) {
+	p[pos++] = (PJMEDIA_RTP_ED137_TLV_CLD << 4) | CLD_LEN;
+	p[pos++] = ext->cld;
+    }
+    if (ext->present & PJMEDIA_RTP_ED137_RMM) {
+	p[pos++] = (PJMEDIA_RTP_ED137_TLV_CLIMAX << 4) | RMM_LEN;
+	put_u23(p + pos, ext->rmm_tqv, ext->rmm_t1);
+	pos += RMM_LEN;
+    }
+    if (ext->present & PJMEDIA_RTP_ED137_MAM) {
+	p[pos++] = (PJMEDIA_RTP_ED137_TLV_CLIMAX << 4) | MAM_LEN;
+	put_u23(p + pos, ext->mam.tqg, ext->mam.t1);
+	put_u23(p + pos + 3, ext->mam.nmr, ext->mam.t2);
+	put_u16(p + pos + 6, ext->mam.tsd);
+	put_u16(p + pos + 8, ext->mam.tj1);
+	put_u16(p + pos + 10, ext->mam.tid);
+	pos += MAM_LEN;
+    }
+
+    while (pos < total)
+	p[pos++] = 0;
+
+    *len = total;
+    return PJ_SUCCESS;
+}
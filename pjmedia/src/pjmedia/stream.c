@@ -20,6 +20,7 @@
 #include <pjmedia/stream.h>
 #include <pjmedia/errno.h>
 #include <pjmedia/rtp.h>
+#include <pjmedia/rtp_ed137.h>
 #include <pjmedia/rtcp.h>
 #include <pjmedia/jbuf.h>
 #include <pjmedia/echo.h>
@@ -37,6 +38,10 @@
 #include <pj/string.h>	    /* memcpy() */
 #include <pj/lock.h>
 
+#if !defined(PJ_WIN32) || PJ_WIN32==0
+#   include <sys/time.h>	    /* gettimeofday() */
+#endif
+
 #define THIS_FILE			"stream.c"
 #define ERRLEVEL			1
 #define LOGERR_(expr)			stream_perror expr
@@ -127,6 +132,8 @@ struct pjmedia_stream
     pj_uint32_t		     tx_duration;   /**< TX duration in timestamp.  */
 
     pj_mutex_t		    *jb_mutex;
+    pj_mutex_t		    *tx_mutex;	    /**< Serializes put_frame() and
+						 the out-of-tick packets.   */
     pjmedia_jbuf	    *jb;	    /**< Jitter buffer.		    */
     char		     jb_last_frm;   /**< Last frame type from jb    */
     unsigned		     jb_last_frm_cnt;/**< Last JB frame type counter*/
@@ -193,6 +200,7 @@ struct pjmedia_stream
 	 unsigned ka_remote_timeout;
 	 unsigned ka_local_interval;
 	 pj_bool_t ka_received;
+	 pj_bool_t ka_timeout;		//put_frame() llama a on_stream_ka_timeout despues de soltar tx_mutex
 
     pj_timestamp last_frm_ts_sent; /**< Timestamp of last sending packet		    */
 	pj_timestamp last_vf_ts_received;
@@ -200,8 +208,8 @@ struct pjmedia_stream
 	pj_bool_t rtp_ext_enabled;
 	pj_bool_t rtp_ext_received;
 	pj_uint32_t rtp_ext_tx_info;
-	pj_uint32_t last_ext_header[16];	//Guarda la �ltima extensi�n de cabecera recibida
-	pj_uint32_t last_rtp_ext_length;	//Guarda la �ltima longitud de la extensi�n de cabecera recibida
+	pjmedia_rtp_ed137_ext rx_ext;		//Ultima extension de cabecera recibida, decodificada
+	unsigned rx_ext_changed;			//Campos que cambiaron la ultima vez que cambio la extension de cabecera
 	int reenv_info_count;
 
 	pjmedia_echo_state * p_echo;
@@ -219,22 +227,32 @@ struct pjmedia_stream
 	pj_bool_t radio_ua;			//Si vale TRUE entonces somos una radio. Seguramente de un simulador de radio
 	pj_bool_t ka_forced;		//Si vale TRUE entonces la siguiente vez que entre la funcion put_frame_imp se fuerza a enviar un keep_alive
 
+	/* Frames ya decodificados con pjmedia_stream_decode_rx_frame(), para no decodificarlos otra vez en get_frame() */
+	pj_int16_t *rx_pcm_cache;	//PJMEDIA_STREAM_RX_PCM_CACHE frames de rx_pcm_spf muestras. NULL si no se usa
+	int *rx_pcm_seq;			//ext_seq del frame de cada posicion. -1 si esta libre
+	pj_size_t *rx_pcm_size;		//Tamano en bytes del frame de cada posicion
+	unsigned rx_pcm_spf;		//Muestras por frame
+
 	/*Parametros para Impairments (degradas el stream. Necesario para el ETM*/
 	int Perdidos;
 	int Duplicados;
 	int LatMin;
 	int LatMax;
 
+#if defined(PJ_WIN32) && PJ_WIN32!=0
 	HANDLE hTimerQueue;
+#endif
 
 };
 
+#if defined(PJ_WIN32) && PJ_WIN32!=0
 typedef struct _MYDATA {
    HANDLE timer;
    pjmedia_stream *stream;
    void *pkt;
    pj_size_t size;
 } MYDATA;
+#endif
 
 unsigned gJBufPframes = 4;
 
@@ -264,10 +282,12 @@ static void stream_perror(const char *sender, const char *title,
 */
 static unsigned long long GetTimeClimax(void)
 {
-	FILETIME SystemTimeAsFileTime;
 	unsigned long long T1;
 	unsigned long long T1_segundos;
 
+#if defined(PJ_WIN32) && PJ_WIN32!=0
+	FILETIME SystemTimeAsFileTime;
+
 	GetSystemTimeAsFileTime(&SystemTimeAsFileTime);  //Retorna el tiempo en unidades de 100ns
 
 	//T1 en unidades de 100ns. En formato FILETIME. Desde 0 horas 1/1/1601
@@ -278,6 +298,14 @@ static unsigned long long GetTimeClimax(void)
 	//Se le resta el tiempo en unidades de 100ns desde 0 horas 1/1/1601 a 0 horas 1/1/1900
 	//Para convertirlo en NTP timestamp
 	T1 -= (unsigned long long) 94354848000000000;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	//T1 en unidades de 100ns desde 0 horas 1/1/1900. Son 2208988800 segundos desde 1/1/1900 a 1/1/1970
+	T1 = ((unsigned long long) tv.tv_sec + 2208988800ULL) * 10000000 + (unsigned long long) tv.tv_usec * 10;
+#endif
 
 	T1_segundos = T1 / 10000000;   //Timestamp en segundos. Ser�an los 32bits de mayor peso de un NTP timestamp de 64 bits
 	T1 -= T1_segundos * 10000000;  //A T1 le restamos la cantidad de segundos pero en unidades de 100ns
@@ -290,6 +318,66 @@ static unsigned long long GetTimeClimax(void)
 	return T1;
 }
 
+/*
+ * Escribe en buf la extension de cabecera ED137 del siguiente paquete RTP, de audio o
+ * keep-alive, a partir de rtp_ext_tx_info. Si req_MAM, en lugar del TLV pendiente se
+ * envia el RMM que solicita el MAM, y el TLV pendiente sale en el siguiente paquete.
+ * Retorna los bytes escritos.
+ */
+static unsigned put_rtp_ext(pjmedia_stream *stream, pj_uint8_t *buf, unsigned size,
+							pj_bool_t req_MAM, pj_bool_t ka)
+{
+	pjmedia_rtp_ed137_ext ext;
+	pj_uint32_t tx_info = stream->rtp_ext_tx_info;
+	unsigned len = 0;
+	pj_status_t status;
+
+	PJMEDIA_RTP_RD_EX_SET_VF(tx_info, stream->rtp_ext_received);
+	stream->rtp_ext_received = PJ_FALSE;
+
+	pjmedia_rtp_ed137_decode(&ext, PJMEDIA_RTP_ED137_PROFILE, &tx_info, 1);
+
+	if (!ka && stream->radio_ua && ext.ptt_id == 0)
+	{
+		//Somos un agente radio. Si el PTT id es cero, entonces sera una llamada desde el avion
+		//En ese caso el PTT-ID sera cero
+	}
+	else
+	{
+		ext.ptt_id = (pj_uint8_t) stream->pttId;
+	}
+
+	if (req_MAM)
+	{
+		//Se envia el RMM. Type 4, length 3, 1 bit TQV, 23 bits T1
+		pj_uint32_t T1 = (pj_uint32_t) GetTimeClimax();
+
+		ext.x = 1;
+		ext.present = PJMEDIA_RTP_ED137_RMM;
+		ext.rmm_tqv = stream->NTP_synchronized ? 1 : 0;
+		ext.rmm_t1 = T1;
+
+		stream->request_MAM = PJ_FALSE;
+		stream->last_T1 = T1;
+	}
+	else if (ext.x && !(stream->radio_ua && (ext.present & PJMEDIA_RTP_ED137_BSS)))
+	{
+		//Se ha enviado una extension de cabecera con TLV. Se borra para que el siguiente
+		//rtp no lo lleve. Si somos un simulador de radio enviando el qidx no se borra
+		PJMEDIA_RTP_RD_EX_SET_X(stream->rtp_ext_tx_info, 0);			
+		PJMEDIA_RTP_RD_EX_SET_TYPE(stream->rtp_ext_tx_info, 0);
+		PJMEDIA_RTP_RD_EX_SET_LENGTH(stream->rtp_ext_tx_info, 0);
+		PJMEDIA_RTP_RD_EX_SET_CLD(stream->rtp_ext_tx_info, 0);
+	}
+
+	status = pjmedia_rtp_ed137_encode(&ext, buf, size, &len);
+	pj_assert(status == PJ_SUCCESS);
+	PJ_UNUSED_ARG(status);
+
+	return len;
+}
+
+
 /*
  * Send keep-alive packet.
  */
@@ -300,25 +388,7 @@ static void send_keep_alive_packet(pjmedia_stream *stream, int ts_len)
 		pj_status_t status;
 		void *rtphdr;
 		int pkt_len;
-		pj_uint32_t ext_val;
-		pj_bool_t req_MAM = stream->request_MAM;
-
-		/** AGL 140528. Cabercera para ED137A */
-		pj_uint32_t ext_hdr = 0x01006701;	// 0x01006700;
-
-		if (req_MAM)
-		{
-			//Si pedimos MAM tenemos que enviar un length de 2
-			ext_hdr = 0x02006701;
-		}
-		
-		ext_val = stream->rtp_ext_tx_info;
-
-		PJMEDIA_RTP_RD_EX_SET_VF(ext_val, stream->rtp_ext_received);
-		stream->rtp_ext_received = PJ_FALSE;
-		
-		/** PTT-ID para el KA */
-		PJMEDIA_RTP_RD_EX_SET_PTT_ID(ext_val, stream->pttId);
+		unsigned ext_len;
 
 		status = pjmedia_rtp_encode_rtp(&stream->enc->rtp, 123, 0, 1, ts_len, (const void**)&rtphdr, &pkt_len);
 		pj_assert(status == PJ_SUCCESS);
@@ -326,103 +396,10 @@ static void send_keep_alive_packet(pjmedia_stream *stream, int ts_len)
 		stream->enc->rtp.out_hdr.x = 1;
 
 		pj_memcpy(stream->enc->out_pkt, rtphdr, pkt_len);
-		pj_memcpy((char*)stream->enc->out_pkt + pkt_len, &ext_hdr, sizeof(pj_uint32_t));
-		
-		if (!req_MAM)
-		{
-			pj_memcpy((char*)stream->enc->out_pkt + pkt_len + sizeof(pj_uint32_t), &ext_val, sizeof(pj_uint32_t));
-
-			pjmedia_transport_send_rtp(stream->transport, stream->enc->out_pkt, pkt_len + (2 * sizeof(pj_uint32_t)));	
-
-			if (stream->radio_ua && PJMEDIA_RTP_RD_EX_GET_TYPE(stream->rtp_ext_tx_info) == 1)
-			{
-				//Si estamos enviando el qidx, porque somos un simulador de radio, entonces no borramos
-				//la extension de cabecera
-			}
-			else
-			{
-				if (PJMEDIA_RTP_RD_EX_GET_X(ext_val))
-				{
-					//Si no es un request MAM y se ha enviado una extension de cabecera con TLV
-					//Entonces borramos el TLV para que en el siguiente rtp no lo lleve
-					PJMEDIA_RTP_RD_EX_SET_X(stream->rtp_ext_tx_info, 0);			
-					PJMEDIA_RTP_RD_EX_SET_TYPE(stream->rtp_ext_tx_info, 0);
-					PJMEDIA_RTP_RD_EX_SET_LENGTH(stream->rtp_ext_tx_info, 0);
-					PJMEDIA_RTP_RD_EX_SET_CLD(stream->rtp_ext_tx_info, 0);
-				}
-			}
-		}
-		else
-		{
-			unsigned long long T1;
-			pj_uint8_t value = 0;
-			int i;
-			pj_uint8_t buf[4];
-			pj_uint32_t T1_u32;
-
-			T1 = GetTimeClimax();			
+		ext_len = put_rtp_ext(stream, (pj_uint8_t*)stream->enc->out_pkt + pkt_len,
+							  stream->enc->out_pkt_size - pkt_len, stream->request_MAM, PJ_TRUE);
 
-			if (0) //(PJMEDIA_RTP_RD_EX_GET_X(ext_val) == 1)
-			{
-				//Tenemos que enviar la extensi�n de cabecera sencilla m�s el RMM
-				pj_memcpy((char*)stream->enc->out_pkt + pkt_len + sizeof(pj_uint32_t), &ext_val, sizeof(pj_uint32_t));
-
-				ext_val = 0x43000000;		//Type RMM + length
-				T1_u32 = (pj_uint32_t) T1;
-				T1_u32 &= 0x7FFFFF;
-				if (stream->NTP_synchronized) T1_u32 |= 0x800000;
-				ext_val |= T1_u32;
-				
-				for (i = 0; i < 4; i++)
-				{
-					buf[i] = (pj_uint8_t) (ext_val >> (24-i*8));
-				}
-
-				pj_memcpy((char*)stream->enc->out_pkt + pkt_len + 2*sizeof(pj_uint32_t), buf, sizeof(pj_uint32_t));			
-				pjmedia_transport_send_rtp(stream->transport, stream->enc->out_pkt, pkt_len + (3 * sizeof(pj_uint32_t)));
-			}
-			else
-			{		
-				//Se env�a solo el RMM
-				PJMEDIA_RTP_RD_EX_SET_X(ext_val, 1);
-			 
-				//Se env�a mensaje RMM. Type 4, length 3, 1 bit TQV, 23 bits T1 			
-				PJMEDIA_RTP_RD_EX_SET_TYPE(ext_val, 0x4);
-				PJMEDIA_RTP_RD_EX_SET_LENGTH(ext_val, 0x3);						
-
-				//TRC_((THIS_FILE, "TRAZA: Envio T1 %lld (0x%llX)", T1, T1));
-			
-				value = (pj_uint8_t) (T1 >> 16);
-			
-				if (stream->NTP_synchronized) value |= 0x80;  //TQV
-				else value &= ~0x80;
-
-				//TRC_((THIS_FILE, "TRAZA: value %d (0x%X)", value, value));
-			
-				PJMEDIA_RTP_RD_EX_SET_VALUE(ext_val, value);		
-
-				pj_memcpy((char*)stream->enc->out_pkt + pkt_len + sizeof(pj_uint32_t), &ext_val, sizeof(pj_uint32_t));
-
-				ext_val = (pj_uint32_t) T1;
-				ext_val &= (pj_uint32_t) 0xFFFF;
-
-				//TRC_((THIS_FILE, "TRAZA: ext_val %d (0x%X)", ext_val, ext_val));
-
-				ext_val <<= 16;
-						
-				for (i = 0; i < 4; i++)
-				{
-					buf[i] = (pj_uint8_t) (ext_val >> (24-i*8));
-				}
-
-				pj_memcpy((char*)stream->enc->out_pkt + pkt_len + 2*sizeof(pj_uint32_t), buf, sizeof(pj_uint32_t));		
-
-				pjmedia_transport_send_rtp(stream->transport, stream->enc->out_pkt, pkt_len + (3 * sizeof(pj_uint32_t)));
-
-				stream->request_MAM = PJ_FALSE;
-				stream->last_T1 = (pj_uint32_t) T1;
-			}			
-		}				
+		pjmedia_transport_send_rtp(stream->transport, stream->enc->out_pkt, pkt_len + ext_len);
 
 		// Aunque en el ED 137 parte 1 se especifica que el keep-alive deber�a tener ts = 0 
 		// creo que es m�s correcto no cambiar ts ni ssrc
@@ -469,6 +446,51 @@ static void send_keep_alive_packet(pjmedia_stream *stream, int ts_len)
 	stream->ka_forced = PJ_FALSE;		//Se se pone a false esta variable siempre que se envia un keep-alive
 }
 
+/*
+ * Send an R2S keep-alive with the current header extension right now,
+ * outside the clock tick. It carries the timestamp of the last packet sent
+ * (like the packets of one DTMF event) and the next sequence number, so
+ * neither the following audio nor the following keep-alives see a jump:
+ * the regular keep-alive still accounts the whole silence period.
+ * Called with tx_mutex held.
+ */
+static void send_rtp_ext_now(pjmedia_stream *stream)
+{
+	pj_uint32_t pkt[(sizeof(pjmedia_rtp_hdr) + 64) / sizeof(pj_uint32_t)];
+	pj_status_t status;
+	void *rtphdr;
+	int pkt_len;
+	unsigned ext_len;
+
+	status = pjmedia_rtp_encode_rtp(&stream->enc->rtp, 123, 0, 1, 0, (const void**)&rtphdr, &pkt_len);
+	pj_assert(status == PJ_SUCCESS);
+	PJ_UNUSED_ARG(status);
+
+	stream->enc->rtp.out_hdr.x = 1;
+
+	pj_memcpy(pkt, rtphdr, pkt_len);
+	ext_len = put_rtp_ext(stream, (pj_uint8_t*)pkt + pkt_len, sizeof(pkt) - pkt_len,
+						  stream->request_MAM, PJ_TRUE);
+
+	pjmedia_transport_send_rtp(stream->transport, pkt, pkt_len + ext_len);
+
+	stream->ka_forced = PJ_FALSE;
+}
+
+/*
+ * Invalidate all frames in the decoded frame cache.
+ */
+static void rx_pcm_cache_reset(pjmedia_stream *stream)
+{
+    unsigned i;
+
+    if (stream->rx_pcm_cache == NULL)
+	return;
+
+    for (i=0; i<PJMEDIA_STREAM_RX_PCM_CACHE; ++i)
+	stream->rx_pcm_seq[i] = -1;
+}
+
 /*
  * play_callback()
  *
@@ -510,10 +532,11 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 	char frame_type;
 	pj_size_t frame_size;
 	pj_uint32_t bit_info;
+	int frame_seq = -1;
 
 	/* Get frame from jitter buffer. */
-	pjmedia_jbuf_get_frame2(stream->jb, channel->out_pkt, &frame_size,
-			        &frame_type, &bit_info);
+	pjmedia_jbuf_get_frame3(stream->jb, channel->out_pkt, &frame_size,
+			        &frame_type, &bit_info, &frame_seq);
 	
 	if (frame_type == PJMEDIA_JB_MISSING_FRAME) {
 	    
@@ -681,8 +704,28 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 
 	    frame_out.buf = p_out_samp + samples_count;
 	    frame_out.size = frame->size - samples_count*BYTES_PER_SAMPLE;
-	    status = stream->codec->op->decode( stream->codec, &frame_in,
-						frame_out.size, PJ_TRUE, &frame_out);
+
+	    /* Reuse the samples if the frame was already decoded in
+	     * pjmedia_stream_decode_rx_frame().
+	     */
+	    if (stream->rx_pcm_cache && frame_seq >= 0 &&
+		stream->rx_pcm_seq[frame_seq % PJMEDIA_STREAM_RX_PCM_CACHE] == 
+		frame_seq &&
+		stream->rx_pcm_size[frame_seq % PJMEDIA_STREAM_RX_PCM_CACHE] <= 
+		frame_out.size)
+	    {
+		unsigned idx = frame_seq % PJMEDIA_STREAM_RX_PCM_CACHE;
+
+		pj_memcpy(frame_out.buf, 
+			  stream->rx_pcm_cache + idx * stream->rx_pcm_spf,
+			  stream->rx_pcm_size[idx]);
+		stream->rx_pcm_seq[idx] = -1;
+		status = PJ_SUCCESS;
+	    } else {
+		status = stream->codec->op->decode( stream->codec, &frame_in,
+						    frame_out.size, PJ_TRUE, 
+						    &frame_out);
+	    }
 	    if (status != 0) {
 		LOGERR_((port->info.name.ptr, "codec decode() error", 
 			 status));
@@ -1129,6 +1172,7 @@ static void rebuffer(pjmedia_stream *stream,
     }
 }
 
+#if defined(PJ_WIN32) && PJ_WIN32!=0
 VOID CALLBACK TimerRoutine(PVOID lpParam, BOOLEAN TimerOrWaitFired)
 {
    MYDATA *pMyData = (MYDATA *)lpParam;
@@ -1142,6 +1186,27 @@ VOID CALLBACK TimerRoutine(PVOID lpParam, BOOLEAN TimerOrWaitFired)
    }
    free(pMyData);
 }
+#endif
+
+/*
+ * Envia una copia del paquete RTP con 'latency' ms de retardo (impairment de latencia).
+ * La cola de timers solo existe en Windows. En el resto de plataformas se envia sin retardo.
+ */
+static void send_rtp_delayed(pjmedia_stream *stream, const void *pkt, pj_size_t size, int latency)
+{
+#if defined(PJ_WIN32) && PJ_WIN32!=0
+	MYDATA * MyData = (MYDATA *) malloc(size + sizeof(MYDATA));
+	MyData->stream = stream;
+	MyData->size = size;
+	MyData->pkt = &MyData[1];
+			
+	memcpy((void *)&MyData[1], pkt, size);
+	CreateTimerQueueTimer( &MyData->timer, stream->hTimerQueue, TimerRoutine, MyData , latency, 0, WT_EXECUTEONLYONCE);
+#else
+	PJ_UNUSED_ARG(latency);
+	pjmedia_transport_send_rtp(stream->transport, pkt, size);
+#endif
+}
 
 /**
  * put_frame_imp()
@@ -1187,8 +1252,7 @@ static pj_status_t put_frame_imp( pjmedia_port *port, const pjmedia_frame *frame
 			dtx_duration = pj_timestamp_diff32(&stream->last_vf_ts_received, &frame->timestamp);
 			if (dtx_duration > (stream->ka_remote_timeout * stream->port.info.clock_rate) / 1000)
 			{
-				if (pj_app_cbs.on_stream_ka_timeout)
-					pj_app_cbs.on_stream_ka_timeout(stream);
+				stream->ka_timeout = PJ_TRUE;
 				stream->last_vf_ts_received = frame->timestamp;
 			}
 		}
@@ -1510,9 +1574,7 @@ static pj_status_t put_frame_imp( pjmedia_port *port, const pjmedia_frame *frame
 
 	 if (stream->rtp_ext_enabled)   
 	 { 
-		 /** AGL 140528. Cabercera para ED137A */
-		 pj_uint32_t ex_hdr = 0x01006701;		// 0x01006700;
-		 pj_uint32_t ex_val = stream->rtp_ext_tx_info;
+		 unsigned ext_len;
 
 		 if (stream->radio_ua && PJMEDIA_RTP_RD_EX_GET_SQU(stream->rtp_ext_tx_info) != 0)
 		 {
@@ -1524,95 +1586,13 @@ static pj_status_t put_frame_imp( pjmedia_port *port, const pjmedia_frame *frame
 			 //No es un agente radio y el PTT esta activo
 			 stream->PTT_rep_count = (pj_uint32_t) PTT_REP_COUNT;
 		 }
-		 
-		 if ((stream->radio_ua) && (PJMEDIA_RTP_RD_EX_GET_PTT_ID(stream->rtp_ext_tx_info) == 0))
-		 {
-			//Somos un agente radio. Si el PTT id es cero, entonces sera una llamada desde el avion
-			//En ese caso el PTT-ID sera cero
-			PJMEDIA_RTP_RD_EX_SET_PTT_ID(ex_val, 0);
-		 }
-		 else
-		 {
-			PJMEDIA_RTP_RD_EX_SET_PTT_ID(ex_val, stream->pttId);
-		 }
-
-		 PJMEDIA_RTP_RD_EX_SET_VF(ex_val, stream->rtp_ext_received);
-		 stream->rtp_ext_received = PJ_FALSE;
-
-		 if (req_MAM)
-		 {			
-			ex_hdr = 0x02006701;
-		 }
-
-		 pj_memcpy((char*)channel->out_pkt + sizeof(pjmedia_rtp_hdr), &ex_hdr, sizeof(pj_uint32_t));
-
-		 if (!req_MAM)
-		 {		 
-			pj_memcpy((char*)channel->out_pkt + sizeof(pjmedia_rtp_hdr) + sizeof(pj_uint32_t), &ex_val, sizeof(pj_uint32_t));
-
-			if (stream->radio_ua && PJMEDIA_RTP_RD_EX_GET_TYPE(stream->rtp_ext_tx_info) == 1)
-			{
-				//Si estamos enviando el qidx, porque somos un simulador de radio, entonces no borramos
-				//la extension de cabecera
-			}
-			else
-			{
-				if (PJMEDIA_RTP_RD_EX_GET_X(ex_val))
-				{
-					//Si no es un request MAM y se ha enviado una extension de cabecera con TLV
-					//Entonces borramos el TLV para que en el siguiente rtp no lo lleve
-					PJMEDIA_RTP_RD_EX_SET_X(stream->rtp_ext_tx_info, 0);			
-					PJMEDIA_RTP_RD_EX_SET_TYPE(stream->rtp_ext_tx_info, 0);
-					PJMEDIA_RTP_RD_EX_SET_LENGTH(stream->rtp_ext_tx_info, 0);
-					PJMEDIA_RTP_RD_EX_SET_CLD(stream->rtp_ext_tx_info, 0);
-				}
-			}
-		 }
-		 else
-		 {			
-			unsigned long long T1;
-			pj_uint8_t value = 0;
-			int i;
-			pj_uint8_t buf[4];			
-
-			PJMEDIA_RTP_RD_EX_SET_X(ex_val, 1);
-			 
-			//Se env�a mensaje RMM. Type 4, length 3, 1 bit TQV, 23 bits T1 			
-			PJMEDIA_RTP_RD_EX_SET_TYPE(ex_val, 0x4);
-			PJMEDIA_RTP_RD_EX_SET_LENGTH(ex_val, 0x3);
-
-			T1 = GetTimeClimax();			
-
-			//TRC_((THIS_FILE, "TRAZA: Envio T1 cona audio %lld (0x%llX)", T1, T1));
-			
-			value = (pj_uint8_t) (T1 >> 16);
-			
-			if (stream->NTP_synchronized) value |= 0x80;  //TQV
-			else value &= ~0x80;
-
-			//TRC_((THIS_FILE, "TRAZA: value %d (0x%X)", value, value));
-			
-			PJMEDIA_RTP_RD_EX_SET_VALUE(ex_val, value);			
-
-			pj_memcpy((char*)channel->out_pkt + sizeof(pjmedia_rtp_hdr) + sizeof(pj_uint32_t), &ex_val, sizeof(pj_uint32_t));
-
-			ex_val = (pj_uint32_t) T1;
-			ex_val &= (pj_uint32_t) 0xFFFF;
-
-			//TRC_((THIS_FILE, "TRAZA: ext_val %d (0x%X)", ext_val, ext_val));
-
-			ex_val <<= 16;
-						
-			for (i = 0; i < 4; i++)
-			{
-				buf[i] = (pj_uint8_t) (ex_val >> (24-i*8));
-			}
-
-			pj_memcpy((char*)channel->out_pkt + sizeof(pjmedia_rtp_hdr) + 2*sizeof(pj_uint32_t), buf, sizeof(pj_uint32_t));
 
-			stream->request_MAM = PJ_FALSE;
-			stream->last_T1 = (pj_uint32_t) T1;
-		 }
+		 //La longitud de la extension se ha reservado al principio con req_MAM, aunque el keep-alive
+		 //ya haya enviado el RMM
+		 ext_len = put_rtp_ext(stream, (pj_uint8_t*)channel->out_pkt + sizeof(pjmedia_rtp_hdr),
+							   channel->out_pkt_size - sizeof(pjmedia_rtp_hdr), req_MAM, PJ_FALSE);
+		 pj_assert(sizeof(pjmedia_rtp_hdr) + ext_len == rtp_hdr_size);
+		 PJ_UNUSED_ARG(ext_len);
 		 
 		 channel->rtp.out_hdr.x = 1;
 	 }
@@ -1650,14 +1630,7 @@ static pj_status_t put_frame_imp( pjmedia_port *port, const pjmedia_frame *frame
 		if (stream->LatMax)
 		{
 			int latency = stream->LatMax == stream->LatMin? stream->LatMin : stream->LatMin + (pj_rand() % (stream->LatMax - stream->LatMin));
-			void * copia_pkt = malloc(frame_out.size + rtp_hdr_size + sizeof(MYDATA));    
-			MYDATA * MyData = (MYDATA *) copia_pkt;
-			MyData->stream = stream;
-			MyData->size = frame_out.size + rtp_hdr_size;
-			MyData->pkt = &MyData[1];
-			
-			memcpy((void *)&MyData[1], channel->out_pkt, frame_out.size + rtp_hdr_size);
-			CreateTimerQueueTimer( &MyData->timer, stream->hTimerQueue, TimerRoutine, MyData , latency, 0, WT_EXECUTEONLYONCE);			
+			send_rtp_delayed(stream, channel->out_pkt, frame_out.size + rtp_hdr_size, latency);
 		}
 		else
 		{
@@ -1668,14 +1641,7 @@ static pj_status_t put_frame_imp( pjmedia_port *port, const pjmedia_frame *frame
 	else if (stream->LatMax)
 	{
 		int latency = stream->LatMax == stream->LatMin? stream->LatMin : stream->LatMin + (pj_rand() % (stream->LatMax - stream->LatMin));
-		void * copia_pkt = malloc(frame_out.size + rtp_hdr_size + sizeof(MYDATA)); 
-		MYDATA * MyData = (MYDATA *) copia_pkt;
-		MyData->stream = stream;
-		MyData->size = frame_out.size + rtp_hdr_size;
-		MyData->pkt = &MyData[1];
-			
-		memcpy((void *)&MyData[1], channel->out_pkt, frame_out.size + rtp_hdr_size);
-		CreateTimerQueueTimer( &MyData->timer, stream->hTimerQueue, TimerRoutine, MyData , latency, 0, WT_EXECUTEONLYONCE);	
+		send_rtp_delayed(stream, channel->out_pkt, frame_out.size + rtp_hdr_size, latency);
 		enviar_paquete_rtp = PJ_FALSE;
 	}
 
@@ -1700,13 +1666,12 @@ static pj_status_t put_frame_imp( pjmedia_port *port, const pjmedia_frame *frame
 
 
 /**
- * put_frame()
+ * put_frame_unlocked()
  *
- * This callback is called by upstream component when it has PCM frame
- * to transmit. This function encodes the PCM frame, pack it into
- * RTP packet, and transmit to peer.
+ * Body of put_frame(), called with tx_mutex held.
  */
-static pj_status_t put_frame( pjmedia_port *port, const pjmedia_frame *frame )
+static pj_status_t put_frame_unlocked( pjmedia_port *port,
+				       const pjmedia_frame *frame )
 {
     pjmedia_stream *stream = (pjmedia_stream*) port->port_data.pdata;
     pjmedia_frame tmp_zero_frame;
@@ -1811,6 +1776,33 @@ static pj_status_t put_frame( pjmedia_port *port, const pjmedia_frame *frame )
 }
 
 
+/**
+ * put_frame()
+ *
+ * This callback is called by upstream component when it has PCM frame
+ * to transmit. This function encodes the PCM frame, pack it into
+ * RTP packet, and transmit to peer.
+ */
+static pj_status_t put_frame( pjmedia_port *port, const pjmedia_frame *frame )
+{
+    pjmedia_stream *stream = (pjmedia_stream*) port->port_data.pdata;
+    pj_status_t status;
+
+    pj_mutex_lock(stream->tx_mutex);
+    status = put_frame_unlocked(port, frame);
+    pj_mutex_unlock(stream->tx_mutex);
+
+    /* The application may act on the call from the callback */
+    if (stream->ka_timeout) {
+	stream->ka_timeout = PJ_FALSE;
+	if (pj_app_cbs.on_stream_ka_timeout)
+	    pj_app_cbs.on_stream_ka_timeout(stream);
+    }
+
+    return status;
+}
+
+
 static pj_status_t reset( pjmedia_port *port )
 {
 	pjmedia_stream *stream = (pjmedia_stream*) port->port_data.pdata;
@@ -1939,10 +1931,9 @@ static void on_rx_rtp( void *data,
 	pj_uint32_t rtp_ext_info_1st = 0;
 	const void *p_rtp_ext_info = NULL;
 	pj_uint32_t rtp_ext_length = 0;   //Cantidad de palabras de 32 bits de la extensi�n de cabecera
-	pj_uint32_t i = 0;
-	pj_uint32_t *p_rtp_ext_info_aux;
-	pj_bool_t not_equal_ext_header = PJ_FALSE;
 	pjmedia_rtp_ext_hdr ext_type_length;
+	pjmedia_rtp_ed137_ext ext;
+	unsigned changed;
 
     /* Check for errors */
     if (bytes_read < 0) {
@@ -2013,29 +2004,17 @@ static void on_rx_rtp( void *data,
 			 PJMEDIA_RTP_RD_EX_SET_VF(rtp_ext_info, 0);
 		 }
 
-		 p_rtp_ext_info_aux = (pj_uint32_t *) p_rtp_ext_info;
-
-		 if ((rtp_ext_length != 0) && (stream->last_rtp_ext_length != rtp_ext_length))
+		 pjmedia_rtp_ed137_decode(&ext, pj_ntohs(ext_type_length.profile_data), p_rtp_ext_info, rtp_ext_length);
+		 if (rtp_ext_length != 0)
 		 {
-			not_equal_ext_header = PJ_TRUE;
-		 }
-		 else
-		 {
-			 for (i = 0; i < rtp_ext_length; i++)
+			 changed = pjmedia_rtp_ed137_diff(&stream->rx_ext, &ext);
+			 if (changed)
 			 {
-				if (stream->last_ext_header[i] != *p_rtp_ext_info_aux)
-				{
-					not_equal_ext_header = PJ_TRUE;
-					break;
-				}
-				p_rtp_ext_info_aux++;
+				stream->rx_ext_changed = changed;
+				stream->reenv_info_count = 3;
 			 }
 		 }
-
-		 if (not_equal_ext_header)
-		 {
-			stream->reenv_info_count = 3;
-		 }
+		 stream->rx_ext = ext;
 
 		 if (stream->reenv_info_count != 0)
 		 {
@@ -2048,14 +2027,6 @@ static void on_rx_rtp( void *data,
 		 }		 
 	 }
 
-	 stream->last_rtp_ext_length = rtp_ext_length;
-	 p_rtp_ext_info_aux = (pj_uint32_t *) p_rtp_ext_info;
-	 for (i = 0; i < rtp_ext_length; i++)
-	 {
-		stream->last_ext_header[i] = *p_rtp_ext_info_aux;
-		p_rtp_ext_info_aux++;
-	 }
-
     /* Ignore if payloadlen is zero */
     if (payloadlen == 0) {
 		pkt_discarded = PJ_TRUE;
@@ -2086,6 +2057,7 @@ static void on_rx_rtp( void *data,
     if (seq_st.status.flag.restart) {
 		status = pjmedia_jbuf_reset(stream->jb);
 		PJ_LOG(4,(stream->port.info.name.ptr, "Jitter buffer reset"));
+		rx_pcm_cache_reset(stream);
 
 		if (stream->rtp_ext_enabled && pj_app_cbs.on_stream_rtp)
 		{
@@ -2354,8 +2326,12 @@ static pj_status_t create_channel( pj_pool_t *pool,
 
 PJ_DEF(void) pjmedia_stream_set_rtp_ext_tx_info(pjmedia_stream * stream, pj_uint32_t rtp_ext_tx_info)
 {
-	if (stream)
-		stream->rtp_ext_tx_info = rtp_ext_tx_info;
+	if (stream == NULL) return;
+
+	//put_rtp_ext() borra el TLV de rtp_ext_tx_info cuando lo envia
+	pj_mutex_lock(stream->tx_mutex);
+	stream->rtp_ext_tx_info = rtp_ext_tx_info;
+	pj_mutex_unlock(stream->tx_mutex);
 }
 
 PJ_DEF(void) pjmedia_stream_get_rtp_ext_tx_info(pjmedia_stream * stream, pj_uint32_t *rtp_ext_tx_info)
@@ -2364,6 +2340,61 @@ PJ_DEF(void) pjmedia_stream_get_rtp_ext_tx_info(pjmedia_stream * stream, pj_uint
 		*rtp_ext_tx_info = stream->rtp_ext_tx_info;
 }
 
+/*
+ * Decode a received frame, keeping the samples for get_frame().
+ * Called from on_stream_rtp, with jb_mutex held by on_rx_rtp().
+ */
+PJ_DEF(pj_status_t) pjmedia_stream_decode_rx_frame(pjmedia_stream *stream,
+						   const pjmedia_frame *frame,
+						   unsigned ext_seq,
+						   pjmedia_frame *pcm)
+{
+    unsigned idx;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(stream && frame && pcm, PJ_EINVAL);
+
+    if (stream->rx_pcm_cache == NULL) {
+	PJ_ASSERT_RETURN(pcm->buf, PJ_EINVAL);
+	return stream->codec->op->decode(stream->codec, frame, pcm->size,
+					 PJ_FALSE, pcm);
+    }
+
+    idx = ext_seq % PJMEDIA_STREAM_RX_PCM_CACHE;
+    pcm->buf = stream->rx_pcm_cache + idx * stream->rx_pcm_spf;
+
+    if (stream->rx_pcm_seq[idx] == (int)ext_seq) {
+	/* Already decoded */
+	pcm->size = stream->rx_pcm_size[idx];
+	pcm->type = PJMEDIA_FRAME_TYPE_AUDIO;
+	return PJ_SUCCESS;
+    }
+
+    pcm->size = stream->rx_pcm_spf * BYTES_PER_SAMPLE;
+    status = stream->codec->op->decode(stream->codec, frame, pcm->size,
+				       PJ_FALSE, pcm);
+    if (status != PJ_SUCCESS) {
+	stream->rx_pcm_seq[idx] = -1;
+	return status;
+    }
+
+    stream->rx_pcm_seq[idx] = (int)ext_seq;
+    stream->rx_pcm_size[idx] = pcm->size;
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(void) pjmedia_stream_get_rx_rtp_ext(pjmedia_stream *stream,
+					   pjmedia_rtp_ed137_ext *ext,
+					   unsigned *changed)
+{
+	pj_assert(stream && ext);
+
+	*ext = stream->rx_ext;
+	if (changed)
+		*changed = stream->rx_ext_changed;
+}
+
 PJ_DEF(void) pjmedia_stream_get_last_T1(pjmedia_stream * stream, pj_uint32_t *last_T1)
 {
 	if (stream && last_T1)
@@ -2465,6 +2496,12 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     if (status != PJ_SUCCESS)
 	goto err_cleanup;
 
+    /* Create mutex to protect the encoding channel: */
+
+    status = pj_mutex_create_simple(pool, NULL, &stream->tx_mutex);
+    if (status != PJ_SUCCESS)
+	goto err_cleanup;
+
 
     /* Create and initialize codec: */
 
@@ -2666,6 +2703,29 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     if (status != PJ_SUCCESS)
 	goto err_cleanup;
 
+#if PJMEDIA_STREAM_RX_PCM_CACHE > 0
+    /* Decoded frame cache, for radio streams with stateless codecs */
+    if (stream->rtp_ext_enabled &&
+	(info->fmt.pt == PJMEDIA_RTP_PT_PCMU || 
+	 info->fmt.pt == PJMEDIA_RTP_PT_PCMA))
+    {
+	stream->rx_pcm_spf = stream->codec_param.info.frm_ptime *
+			     stream->codec_param.info.clock_rate *
+			     stream->codec_param.info.channel_cnt / 1000;
+	stream->rx_pcm_cache = (pj_int16_t*)
+			       pj_pool_alloc(pool, PJMEDIA_STREAM_RX_PCM_CACHE * 
+						   stream->rx_pcm_spf * 
+						   BYTES_PER_SAMPLE);
+	stream->rx_pcm_seq = (int*)
+			     pj_pool_alloc(pool, PJMEDIA_STREAM_RX_PCM_CACHE *
+						 sizeof(int));
+	stream->rx_pcm_size = (pj_size_t*)
+			      pj_pool_zalloc(pool, PJMEDIA_STREAM_RX_PCM_CACHE *
+						   sizeof(pj_size_t));
+	rx_pcm_cache_reset(stream);
+    }
+#endif
+
 
     /* Create encoder channel: */
 
@@ -2753,7 +2813,9 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     send_keep_alive_packet(stream);
 #endif
 
+#if defined(PJ_WIN32) && PJ_WIN32!=0
 	stream->hTimerQueue = CreateTimerQueue();
+#endif
 
     /* Success! */
     *p_stream = stream;
@@ -2805,7 +2867,7 @@ PJ_DEF(void) pjmedia_stream_set_climax_param(pjmedia_stream * stream, pj_bool_t
 
 	stream->NTP_synchronized = NTP_synchronized;
 
-	stream->last_rtp_ext_length = 0;  //Esto forzara a que se capture la siguiente extensi�n de cabecera
+	stream->rx_ext.words = 0;  //Esto forzara a que se capture la siguiente extensi�n de cabecera
 									
 }
 
@@ -2816,7 +2878,7 @@ PJ_DEF(void) pjmedia_stream_reset_ext_header(pjmedia_stream * stream)
 {
 	pj_assert(stream != NULL);
 
-	stream->last_rtp_ext_length = 0;  //Esto forzara a que se capture la siguiente extensi�n de cabecera
+	stream->rx_ext.words = 0;  //Esto forzara a que se capture la siguiente extensi�n de cabecera
 }
 
 
@@ -2834,6 +2896,23 @@ PJ_DEF(void) pjmedia_stream_force_send_KA_packet(pjmedia_stream * stream)
 	stream->ka_forced = PJ_TRUE;
 }
 
+PJ_DEF(pj_status_t) pjmedia_stream_send_KA_packet_now(pjmedia_stream * stream)
+{
+	PJ_ASSERT_RETURN(stream != NULL, PJ_EINVAL);
+
+	if (stream->ka_type != PJMEDIA_STREAM_KA_R2S || !stream->rtp_ext_enabled ||
+		stream->transport == NULL || (stream->dir & PJMEDIA_DIR_ENCODING) == 0)
+	{
+		return PJ_EINVALIDOP;
+	}
+
+	pj_mutex_lock(stream->tx_mutex);
+	send_rtp_ext_now(stream);
+	pj_mutex_unlock(stream->tx_mutex);
+
+	return PJ_SUCCESS;
+}
+
 PJ_DEF(void) pjmedia_stream_force_set_impairments(pjmedia_stream * stream, int Perdidos, int Duplicados, int LatMin, int LatMax)
 {
 	pj_assert(stream != NULL);
@@ -2859,7 +2938,9 @@ PJ_DEF(pj_status_t) pjmedia_stream_destroy( pjmedia_stream *stream )
     unsigned len;
     PJ_ASSERT_RETURN(stream != NULL, PJ_EINVAL);
 
+#if defined(PJ_WIN32) && PJ_WIN32!=0
 	DeleteTimerQueueEx(stream->hTimerQueue, INVALID_HANDLE_VALUE);  //Se eliminan todos los timers, pero esperamos a que finalizen.
+#endif
 
 #if defined(PJMEDIA_HAS_RTCP_XR) && (PJMEDIA_HAS_RTCP_XR != 0)
     /* Send RTCP XR on stream destroy */
@@ -2938,6 +3019,11 @@ PJ_DEF(pj_status_t) pjmedia_stream_destroy( pjmedia_stream *stream )
 	stream->jb_mutex = NULL;
     }
 
+    if (stream->tx_mutex) {
+	pj_mutex_destroy(stream->tx_mutex);
+	stream->tx_mutex = NULL;
+    }
+
     /* Destroy jitter buffer */
     if (stream->jb)
 	pjmedia_jbuf_destroy(stream->jb);
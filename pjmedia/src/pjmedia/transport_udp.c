@@ -17,6 +17,11 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
  */
+/* recvmmsg() is only declared with _GNU_SOURCE */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
 #include <pjmedia/transport_udp.h>
 #include <pj/addr_resolv.h>
 #include <pj/assert.h>
@@ -27,6 +32,9 @@
 #include <pj/rand.h>
 #include <pj/string.h>
 
+#if PJMEDIA_HAS_UDP_BATCH_RX
+#   include <sys/socket.h>
+#endif
 
 /* Maximum size of incoming RTP packet */
 #define RTP_LEN	    PJMEDIA_MAX_MTU
@@ -46,6 +54,16 @@ typedef struct pending_write
     pj_ioqueue_op_key_t	op_key;
 } pending_write;
 
+#if PJMEDIA_HAS_UDP_BATCH_RX
+/* Buffers of the RTP packets read with one recvmmsg() call */
+typedef struct rx_batch
+{
+    struct mmsghdr	msg[PJMEDIA_UDP_RX_BATCH_SIZE];
+    struct iovec	iov[PJMEDIA_UDP_RX_BATCH_SIZE];
+    pj_sockaddr		src[PJMEDIA_UDP_RX_BATCH_SIZE];
+    char		pkt[PJMEDIA_UDP_RX_BATCH_SIZE][RTP_LEN];
+} rx_batch;
+#endif
 
 struct transport_udp
 {
@@ -79,6 +97,7 @@ struct transport_udp
     unsigned		rtp_src_cnt;	/**< How many pkt from this addr.   */
     int			rtp_addrlen;	/**< Address length.		    */
     char		rtp_pkt[RTP_LEN];/**< Incoming RTP packet buffer    */
+    struct rx_batch    *rtp_rx_batch;	/**< Batched RTP read, or NULL	    */
 
     pj_sock_t		rtcp_sock;	/**< RTCP socket		    */
     pj_sockaddr		rtcp_addr_name;	/**< Published RTCP address.	    */
@@ -283,8 +302,8 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
     /* Sanity check */
     PJ_ASSERT_RETURN(endpt && si && p_tp, PJ_EINVAL);
 
-    /* Get ioqueue instance */
-    ioqueue = pjmedia_endpt_get_ioqueue(endpt);
+    /* Get ioqueue instance. RTP and RTCP are polled by the same worker */
+    ioqueue = pjmedia_endpt_get_transport_ioqueue(endpt);
 
     if (name==NULL)
 	name = "udp%p";
@@ -343,6 +362,23 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
     if (status != PJ_SUCCESS)
 	goto on_error;
 
+#if PJMEDIA_HAS_UDP_BATCH_RX
+    /* Buffers to read the queued RTP packets with one system call */
+    if (options & PJMEDIA_UDP_BATCH_RX) {
+	rx_batch *b;
+
+	b = PJ_POOL_ZALLOC_T(pool, rx_batch);
+	for (i=0; i<PJMEDIA_UDP_RX_BATCH_SIZE; ++i) {
+	    b->iov[i].iov_base = b->pkt[i];
+	    b->iov[i].iov_len = RTP_LEN;
+	    b->msg[i].msg_hdr.msg_name = &b->src[i];
+	    b->msg[i].msg_hdr.msg_iov = &b->iov[i];
+	    b->msg[i].msg_hdr.msg_iovlen = 1;
+	}
+	tp->rtp_rx_batch = b;
+    }
+#endif
+
     pj_ioqueue_op_key_init(&tp->rtp_read_op, sizeof(tp->rtp_read_op));
     for (i=0; i<PJ_ARRAY_SIZE(tp->rtp_pending_write); ++i)
 	pj_ioqueue_op_key_init(&tp->rtp_pending_write[i].op_key, 
@@ -437,100 +473,150 @@ static pj_status_t transport_destroy(pjmedia_transport *tp)
 }
 
 
-/* Notification from ioqueue about incoming RTP packet */
-static void on_rx_rtp( pj_ioqueue_key_t *key, 
-                       pj_ioqueue_op_key_t *op_key, 
-                       pj_ssize_t bytes_read)
+/* Give an incoming RTP packet to the stream. The source address of the
+ * packet is in rtp_src_addr.
+ */
+static void rx_rtp_packet(struct transport_udp *udp,
+			  void *pkt,
+			  pj_ssize_t bytes_read)
 {
-    struct transport_udp *udp;
-    pj_status_t status;
+    void (*cb)(void*,void*,pj_ssize_t);
+    void *user_data;
 
-    PJ_UNUSED_ARG(op_key);
+    cb = udp->rtp_cb;
+    user_data = udp->user_data;
 
-    udp = (struct transport_udp*) pj_ioqueue_get_user_data(key);
+    /* Simulate packet lost on RX direction */
+    if (udp->rx_drop_pct) {
+	if ((pj_rand() % 100) <= (int)udp->rx_drop_pct) {
+	    PJ_LOG(5,(udp->base.name, 
+		      "RX RTP packet dropped because of pkt lost "
+		      "simulation"));
+	    return;
+	}
+    }
 
-    do {
-	void (*cb)(void*,void*,pj_ssize_t);
-	void *user_data;
 
-	cb = udp->rtp_cb;
-	user_data = udp->user_data;
+    if (udp->attached && cb)
+	(*cb)(user_data, pkt, bytes_read);
 
-	/* Simulate packet lost on RX direction */
-	if (udp->rx_drop_pct) {
-	    if ((pj_rand() % 100) <= (int)udp->rx_drop_pct) {
-		PJ_LOG(5,(udp->base.name, 
-			  "RX RTP packet dropped because of pkt lost "
-			  "simulation"));
-		goto read_next_packet;
-	    }
-	}
+    /* See if source address of RTP packet is different than the 
+     * configured address, and switch RTP remote address to 
+     * source packet address after several consecutive packets
+     * have been received.
+     */
+    if (bytes_read>0 && 
+	(udp->options & PJMEDIA_UDP_NO_SRC_ADDR_CHECKING)==0) 
+    {
+	if (pj_sockaddr_cmp(&udp->rem_rtp_addr, &udp->rtp_src_addr) != 0) {
 
+	    udp->rtp_src_cnt++;
 
-	if (udp->attached && cb)
-	    (*cb)(user_data, udp->rtp_pkt, bytes_read);
+	    if (udp->rtp_src_cnt >= PJMEDIA_RTP_NAT_PROBATION_CNT) {
 
-	/* See if source address of RTP packet is different than the 
-	 * configured address, and switch RTP remote address to 
-	 * source packet address after several consecutive packets
-	 * have been received.
-	 */
-	if (bytes_read>0 && 
-	    (udp->options & PJMEDIA_UDP_NO_SRC_ADDR_CHECKING)==0) 
-	{
-	    if (pj_sockaddr_cmp(&udp->rem_rtp_addr, &udp->rtp_src_addr) != 0) {
+		char addr_text[80];
+
+		/* Set remote RTP address to source address */
+		pj_memcpy(&udp->rem_rtp_addr, &udp->rtp_src_addr,
+			  sizeof(pj_sockaddr));
 
-		udp->rtp_src_cnt++;
+		/* Reset counter */
+		udp->rtp_src_cnt = 0;
 
-		if (udp->rtp_src_cnt >= PJMEDIA_RTP_NAT_PROBATION_CNT) {
-		
-		    char addr_text[80];
+		PJ_LOG(4,(udp->base.name,
+			  "Remote RTP address switched to %s",
+			  pj_sockaddr_print(&udp->rtp_src_addr, addr_text,
+					    sizeof(addr_text), 3)));
 
-		    /* Set remote RTP address to source address */
-		    pj_memcpy(&udp->rem_rtp_addr, &udp->rtp_src_addr,
+		/* Also update remote RTCP address if actual RTCP source
+		 * address is not heard yet.
+		 */
+		if (!pj_sockaddr_has_addr(&udp->rtcp_src_addr)) {
+		    pj_uint16_t port;
+
+		    pj_memcpy(&udp->rem_rtcp_addr, &udp->rem_rtp_addr, 
 			      sizeof(pj_sockaddr));
+		    pj_sockaddr_copy_addr(&udp->rem_rtcp_addr,
+					  &udp->rem_rtp_addr);
+		    port = (pj_uint16_t)
+			   (pj_sockaddr_get_port(&udp->rem_rtp_addr)+1);
+		    pj_sockaddr_set_port(&udp->rem_rtcp_addr, port);
 
-		    /* Reset counter */
-		    udp->rtp_src_cnt = 0;
+		    pj_memcpy(&udp->rtcp_src_addr, &udp->rem_rtcp_addr, 
+			      sizeof(pj_sockaddr));
 
 		    PJ_LOG(4,(udp->base.name,
-			      "Remote RTP address switched to %s",
-			      pj_sockaddr_print(&udp->rtp_src_addr, addr_text,
+			      "Remote RTCP address switched to %s",
+			      pj_sockaddr_print(&udp->rtcp_src_addr, 
+						addr_text,
 						sizeof(addr_text), 3)));
 
-		    /* Also update remote RTCP address if actual RTCP source
-		     * address is not heard yet.
-		     */
-		    if (!pj_sockaddr_has_addr(&udp->rtcp_src_addr)) {
-			pj_uint16_t port;
-
-			pj_memcpy(&udp->rem_rtcp_addr, &udp->rem_rtp_addr, 
-				  sizeof(pj_sockaddr));
-			pj_sockaddr_copy_addr(&udp->rem_rtcp_addr,
-					      &udp->rem_rtp_addr);
-			port = (pj_uint16_t)
-			       (pj_sockaddr_get_port(&udp->rem_rtp_addr)+1);
-			pj_sockaddr_set_port(&udp->rem_rtcp_addr, port);
-
-			pj_memcpy(&udp->rtcp_src_addr, &udp->rem_rtcp_addr, 
-				  sizeof(pj_sockaddr));
-
-			PJ_LOG(4,(udp->base.name,
-				  "Remote RTCP address switched to %s",
-				  pj_sockaddr_print(&udp->rtcp_src_addr, 
-						    addr_text,
-						    sizeof(addr_text), 3)));
-
-		    }
 		}
 	    }
 	}
+    }
+}
+
+
+#if PJMEDIA_HAS_UDP_BATCH_RX
+/* Read and process the RTP packets already queued in the socket, with
+ * one recvmmsg() call for up to PJMEDIA_UDP_RX_BATCH_SIZE packets.
+ */
+static void read_rtp_batch(struct transport_udp *udp)
+{
+    rx_batch *b = udp->rtp_rx_batch;
+    int i, cnt;
+
+    do {
+	for (i=0; i<PJMEDIA_UDP_RX_BATCH_SIZE; ++i)
+	    b->msg[i].msg_hdr.msg_namelen = sizeof(b->src[i]);
+
+	cnt = recvmmsg(udp->rtp_sock, b->msg, PJMEDIA_UDP_RX_BATCH_SIZE,
+		       MSG_DONTWAIT, NULL);
+
+	for (i=0; i<cnt; ++i) {
+	    pj_memcpy(&udp->rtp_src_addr, &b->src[i],
+		      b->msg[i].msg_hdr.msg_namelen);
+	    udp->rtp_addrlen = b->msg[i].msg_hdr.msg_namelen;
+
+	    rx_rtp_packet(udp, b->pkt[i], b->msg[i].msg_len);
+	}
+    } while (cnt == PJMEDIA_UDP_RX_BATCH_SIZE);
+}
+#endif
+
+
+/* Notification from ioqueue about incoming RTP packet */
+static void on_rx_rtp( pj_ioqueue_key_t *key, 
+                       pj_ioqueue_op_key_t *op_key, 
+                       pj_ssize_t bytes_read)
+{
+    struct transport_udp *udp;
+    pj_status_t status;
+
+    PJ_UNUSED_ARG(op_key);
+
+    udp = (struct transport_udp*) pj_ioqueue_get_user_data(key);
+
+    do {
+	unsigned flags = 0;
+
+	rx_rtp_packet(udp, udp->rtp_pkt, bytes_read);
+
+#if PJMEDIA_HAS_UDP_BATCH_RX
+	/* Drain the socket. It is then empty, so the next read is
+	 * left pending without trying it first.
+	 */
+	if (udp->rtp_rx_batch && bytes_read > 0) {
+	    read_rtp_batch(udp);
+	    flags = PJ_IOQUEUE_ALWAYS_ASYNC;
+	}
+#endif
 
-read_next_packet:
 	bytes_read = sizeof(udp->rtp_pkt);
 	udp->rtp_addrlen = sizeof(udp->rtp_src_addr);
 	status = pj_ioqueue_recvfrom(udp->rtp_key, &udp->rtp_read_op,
-				     udp->rtp_pkt, &bytes_read, 0,
+				     udp->rtp_pkt, &bytes_read, flags,
 				     &udp->rtp_src_addr, 
 				     &udp->rtp_addrlen);
 
@@ -488,7 +488,7 @@ static pjmedia_port* init_conf_port(unsigned nb_participant,
 
 	/* Create gen_port for source audio */
 	gen_port = create_gen_port(pool, clock_rate, channel_count,
-				   samples_per_frame, 100 / nb_participant);
+				   samples_per_frame, PJ_MAX(1, 100 / nb_participant));
 	if (!gen_port)
 	    return NULL;
 
@@ -597,6 +597,48 @@ static pjmedia_port* conf16_test_init(pj_pool_t *pool,
 			  samples_per_frame, flags, te);
 }
 
+/***************************************************************************/
+/* Benchmark conf with 64 participants, mixing to/from snd dev */
+static pjmedia_port* conf64_test_init(pj_pool_t *pool,
+				      unsigned clock_rate,
+				      unsigned channel_count,
+				      unsigned samples_per_frame,
+				      unsigned flags,
+				      struct test_entry *te)
+{
+    PJ_UNUSED_ARG(flags);
+    return init_conf_port(64, pool, clock_rate, channel_count, 
+			  samples_per_frame, flags, te);
+}
+
+/***************************************************************************/
+/* Benchmark conf with 256 participants, mixing to/from snd dev */
+static pjmedia_port* conf256_test_init(pj_pool_t *pool,
+				      unsigned clock_rate,
+				      unsigned channel_count,
+				      unsigned samples_per_frame,
+				      unsigned flags,
+				      struct test_entry *te)
+{
+    PJ_UNUSED_ARG(flags);
+    return init_conf_port(256, pool, clock_rate, channel_count, 
+			  samples_per_frame, flags, te);
+}
+
+/***************************************************************************/
+/* Benchmark conf with 512 participants, mixing to/from snd dev */
+static pjmedia_port* conf512_test_init(pj_pool_t *pool,
+				      unsigned clock_rate,
+				      unsigned channel_count,
+				      unsigned samples_per_frame,
+				      unsigned flags,
+				      struct test_entry *te)
+{
+    PJ_UNUSED_ARG(flags);
+    return init_conf_port(512, pool, clock_rate, channel_count, 
+			  samples_per_frame, flags, te);
+}
+
 /***************************************************************************/
 /* Up and downsample */
 static pjmedia_port* updown_resample_get(pj_pool_t *pool,
@@ -1727,6 +1769,7 @@ static pjmedia_port* create_stream( pj_pool_t *pool,
 	return NULL;
 
     if (srtp_enabled) {
+#if defined(PJMEDIA_HAS_SRTP) && (PJMEDIA_HAS_SRTP != 0)
 	pjmedia_srtp_setting opt;
 	pjmedia_srtp_crypto crypto;
 	pjmedia_transport *srtp;
@@ -1757,6 +1800,11 @@ static pjmedia_port* create_stream( pj_pool_t *pool,
 	    return NULL;
 
 	sp->transport = srtp;
+#else
+	PJ_UNUSED_ARG(srtp_80);
+	PJ_UNUSED_ARG(srtp_auth);
+	return NULL;
+#endif
     }
 
     /* Create stream */
@@ -2301,6 +2349,9 @@ int mips_test(void)
 	{ "conference bridge with 4 calls", OP_GET_PUT, K8|K16, &conf4_test_init},
 	{ "conference bridge with 8 calls", OP_GET_PUT, K8|K16, &conf8_test_init},
 	{ "conference bridge with 16 calls", OP_GET_PUT, K8|K16, &conf16_test_init},
+	{ "conference bridge with 64 calls", OP_GET_PUT, K8|K16, &conf64_test_init},
+	{ "conference bridge with 256 calls", OP_GET_PUT, K8|K16, &conf256_test_init},
+	{ "conference bridge with 512 calls", OP_GET_PUT, K8|K16, &conf512_test_init},
 	{ "upsample+downsample - linear", OP_GET, K8|K16, &linear_resample},
 	{ "upsample+downsample - small filter", OP_GET, K8|K16, &small_filt_resample},
 	{ "upsample+downsample - large filter", OP_GET, K8|K16, &large_filt_resample},
@@ -0,0 +1,444 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2009 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+/*
+ * Test the ED-137 header extension codec:
+ *  - the signalling fields agree with the PJMEDIA_RTP_RD_EX_GET_*() macros,
+ *  - the RMM is written as the stream used to build it by hand,
+ *  - random extensions survive encode and decode, and the changed mask
+ *    flags exactly the field modified,
+ *  - random bytes are decoded without reading past the extension, and
+ *    what is decoded is encoded again,
+ *  - decode+diff and encode throughput.
+ */
+
+#define THIS_FILE	    "rtp_ed137_test.c"
+
+#define ROUNDTRIP_CNT	    100000
+#define FUZZ_CNT	    200000
+#define FUZZ_MAX_WORDS	    8
+#define PERF_CNT	    1000000
+
+
+static void random_ext(pjmedia_rtp_ed137_ext *ext)
+{
+    pj_bzero(ext, sizeof(*ext));
+    ext->profile = PJMEDIA_RTP_ED137_PROFILE;
+    ext->ptt_type = (pj_uint8_t)(pj_rand() & 7);
+    ext->squ = (pj_uint8_t)(pj_rand() & 1);
+    ext->ptt_id = (pj_uint8_t)(pj_rand() & 0x3F);
+    ext->pm = (pj_uint8_t)(pj_rand() & 1);
+    ext->ptts = (pj_uint8_t)(pj_rand() & 1);
+    ext->reserved = (pj_uint8_t)(pj_rand() & 7);
+    ext->present = pj_rand() & (PJMEDIA_RTP_ED137_BSS | PJMEDIA_RTP_ED137_CLD |
+				PJMEDIA_RTP_ED137_RMM | PJMEDIA_RTP_ED137_MAM);
+    ext->x = (pj_uint8_t)(ext->present ? 1 : 0);
+    ext->bss_qidx = (pj_uint8_t)(pj_rand() & 0x1F);
+    ext->bss_method = (pj_uint8_t)(pj_rand() & 7);
+    ext->cld = (pj_uint8_t)pj_rand();
+    ext->rmm_tqv = (pj_uint8_t)(pj_rand() & 1);
+    ext->rmm_t1 = pj_rand() & 0x7FFFFF;
+    ext->mam.tqg = (pj_uint8_t)(pj_rand() & 1);
+    ext->mam.t1 = pj_rand() & 0x7FFFFF;
+    ext->mam.nmr = (pj_uint8_t)(pj_rand() & 1);
+    ext->mam.t2 = pj_rand() & 0x7FFFFF;
+    ext->mam.tsd = (pj_uint16_t)pj_rand();
+    ext->mam.tj1 = (pj_uint16_t)pj_rand();
+    ext->mam.tid = (pj_uint16_t)pj_rand();
+}
+
+/* Compare what the encoder writes */
+static pj_bool_t same_ext(const pjmedia_rtp_ed137_ext *a,
+			  const pjmedia_rtp_ed137_ext *b)
+{
+    unsigned p = a->present;
+
+    if (a->ptt_type != b->ptt_type || a->squ != b->squ ||
+	a->ptt_id != b->ptt_id || a->pm != b->pm || a->ptts != b->ptts ||
+	a->reserved != b->reserved || a->x != b->x || p != b->present)
+    {
+	return PJ_FALSE;
+    }
+    if ((p & PJMEDIA_RTP_ED137_BSS) &&
+	(a->bss_qidx != b->bss_qidx || a->bss_method != b->bss_method))
+	return PJ_FALSE;
+    if ((p & PJMEDIA_RTP_ED137_CLD) && a->cld != b->cld)
+	return PJ_FALSE;
+    if ((p & PJMEDIA_RTP_ED137_RMM) &&
+	(a->rmm_tqv != b->rmm_tqv || a->rmm_t1 != b->rmm_t1))
+	return PJ_FALSE;
+    if ((p & PJMEDIA_RTP_ED137_MAM) &&
+	(a->mam.tqg != b->mam.tqg || a->mam.t1 != b->mam.t1 ||
+	 a->mam.nmr != b->mam.nmr || a->mam.t2 != b->mam.t2 ||
+	 a->mam.tsd != b->mam.tsd || a->mam.tj1 != b->mam.tj1 ||
+	 a->mam.tid != b->mam.tid))
+	return PJ_FALSE;
+
+    return PJ_TRUE;
+}
+
+static int encode_decode(const pjmedia_rtp_ed137_ext *ext,
+			 pjmedia_rtp_ed137_ext *out)
+{
+    pj_uint8_t buf[4 + PJMEDIA_RTP_ED137_MAX_WORDS * 4];
+    unsigned len;
+    pj_status_t status;
+
+    status = pjmedia_rtp_ed137_encode(ext, buf, sizeof(buf), &len);
+    if (status != PJ_SUCCESS || len < 8 || (len & 3) != 0)
+	return -1;
+
+    if ((unsigned)((buf[2] << 8) | buf[3]) != len / 4 - 1)
+	return -2;
+
+    status = pjmedia_rtp_ed137_decode(out, (pj_uint16_t)((buf[0] << 8) | buf[1]),
+				      buf + 4, len / 4 - 1);
+    if (status != PJ_SUCCESS)
+	return -3;
+
+    return 0;
+}
+
+/* The decoded fields match the bitfield macros used by the application */
+static int macro_test(void)
+{
+    unsigned i;
+
+    for (i=0; i<ROUNDTRIP_CNT; ++i) {
+	pj_uint32_t info = ((pj_uint32_t)pj_rand() << 16) ^ pj_rand();
+	pjmedia_rtp_ed137_ext ext;
+
+	pjmedia_rtp_ed137_decode(&ext, 0, &info, 1);
+
+	if (ext.info != info ||
+	    ext.ptt_type != PJMEDIA_RTP_RD_EX_GET_PTT_TYPE(info) ||
+	    ext.squ != PJMEDIA_RTP_RD_EX_GET_SQU(info) ||
+	    ext.ptt_id != PJMEDIA_RTP_RD_EX_GET_PTT_ID(info) ||
+	    ext.pm != PJMEDIA_RTP_RD_EX_GET_PM(info) ||
+	    ext.ptts != PJMEDIA_RTP_RD_EX_GET_PTTS(info) ||
+	    ext.reserved != PJMEDIA_RTP_RD_EX_GET_RESERVED(info) ||
+	    ext.x != PJMEDIA_RTP_RD_EX_GET_X(info))
+	{
+	    PJ_LOG(3,(THIS_FILE, "  info 0x%08x decoded differently than "
+		      "the macros", info));
+	    return -10;
+	}
+
+	/* The one byte TLVs of the first word */
+	PJMEDIA_RTP_RD_EX_SET_X(info, 1);
+	PJMEDIA_RTP_RD_EX_SET_TYPE(info, PJMEDIA_RTP_ED137_TLV_BSS);
+	PJMEDIA_RTP_RD_EX_SET_LENGTH(info, 1);
+	pjmedia_rtp_ed137_decode(&ext, PJMEDIA_RTP_ED137_PROFILE, &info, 1);
+	if (!(ext.present & PJMEDIA_RTP_ED137_BSS) ||
+	    ext.bss_qidx != PJMEDIA_RTP_RD_EX_GET_BSS_IDX(info) ||
+	    ext.bss_method != PJMEDIA_RTP_RD_EX_GET_BSS_MT(info))
+	{
+	    PJ_LOG(3,(THIS_FILE, "  BSS 0x%08x decoded differently than "
+		      "the macros", info));
+	    return -11;
+	}
+
+	PJMEDIA_RTP_RD_EX_SET_TYPE(info, PJMEDIA_RTP_ED137_TLV_CLD);
+	pjmedia_rtp_ed137_decode(&ext, PJMEDIA_RTP_ED137_PROFILE, &info, 1);
+	if (!(ext.present & PJMEDIA_RTP_ED137_CLD) ||
+	    ext.cld != PJMEDIA_RTP_RD_EX_GET_VALUE(info))
+	{
+	    PJ_LOG(3,(THIS_FILE, "  CLD 0x%08x decoded differently than "
+		      "the macros", info));
+	    return -12;
+	}
+    }
+
+    return 0;
+}
+
+/* The RMM sent with audio and keep-alives */
+static int rmm_test(void)
+{
+    static const pj_uint8_t expected[] = {
+	0x01, 0x67, 0x00, 0x02,
+	0x6D, 0x41, 0x43, 0xD2,
+	0x34, 0x56, 0x00, 0x00
+    };
+    pjmedia_rtp_ed137_ext ext;
+    pj_uint8_t buf[sizeof(expected) + 4];
+    unsigned len;
+
+    pj_bzero(&ext, sizeof(ext));
+    ext.profile = PJMEDIA_RTP_ED137_PROFILE;
+    ext.ptt_type = 3;
+    ext.squ = 0;
+    ext.ptt_id = 0x35;
+    ext.x = 1;
+    ext.present = PJMEDIA_RTP_ED137_RMM;
+    ext.rmm_tqv = 1;
+    ext.rmm_t1 = 0x523456;
+
+    if (pjmedia_rtp_ed137_encode(&ext, buf, sizeof(buf), &len) != PJ_SUCCESS ||
+	len != sizeof(expected) || pj_memcmp(buf, expected, len) != 0)
+    {
+	PJ_LOG(3,(THIS_FILE, "  RMM encoded wrong"));
+	return -20;
+    }
+
+    if (pjmedia_rtp_ed137_encode(&ext, buf, sizeof(expected) - 1,
+				 &len) != PJ_ETOOSMALL)
+    {
+	PJ_LOG(3,(THIS_FILE, "  RMM encoded in a too small buffer"));
+	return -21;
+    }
+
+    return 0;
+}
+
+static int roundtrip_test(void)
+{
+    static const struct {
+	unsigned field;
+	unsigned bits;
+    } base_bits[] = {
+	{ PJMEDIA_RTP_ED137_PTT_TYPE, 3 },
+	{ PJMEDIA_RTP_ED137_SQU, 1 },
+	{ PJMEDIA_RTP_ED137_PTT_ID, 6 },
+	{ PJMEDIA_RTP_ED137_PM, 1 },
+	{ PJMEDIA_RTP_ED137_PTTS, 1 },
+	{ PJMEDIA_RTP_ED137_RESERVED, 3 },
+	{ PJMEDIA_RTP_ED137_X, 1 }
+    };
+    unsigned i;
+
+    for (i=0; i<ROUNDTRIP_CNT; ++i) {
+	pjmedia_rtp_ed137_ext ext, dec, dec2;
+	unsigned f, changed, expected;
+	int rc;
+
+	random_ext(&ext);
+	rc = encode_decode(&ext, &dec);
+	if (rc != 0 || !same_ext(&ext, &dec)) {
+	    PJ_LOG(3,(THIS_FILE, "  roundtrip error %d, TLVs 0x%x", rc,
+		      ext.present));
+	    return -30;
+	}
+	if (pjmedia_rtp_ed137_diff(&dec, &dec) != 0) {
+	    PJ_LOG(3,(THIS_FILE, "  extension differs from itself"));
+	    return -31;
+	}
+
+	/* Change one field */
+	f = pj_rand() % (PJ_ARRAY_SIZE(base_bits) + 4);
+	if (f < PJ_ARRAY_SIZE(base_bits)) {
+	    pj_uint8_t *v;
+
+	    expected = base_bits[f].field;
+	    switch (expected) {
+	    case PJMEDIA_RTP_ED137_PTT_TYPE:	v = &ext.ptt_type; break;
+	    case PJMEDIA_RTP_ED137_SQU:		v = &ext.squ; break;
+	    case PJMEDIA_RTP_ED137_PTT_ID:	v = &ext.ptt_id; break;
+	    case PJMEDIA_RTP_ED137_PM:		v = &ext.pm; break;
+	    case PJMEDIA_RTP_ED137_PTTS:	v = &ext.ptts; break;
+	    case PJMEDIA_RTP_ED137_RESERVED:	v = &ext.reserved; break;
+	    default:				v = &ext.x; break;
+	    }
+	    *v ^= (pj_uint8_t)(1 << (pj_rand() % base_bits[f].bits));
+	    /* Without the X bit the TLVs are not decoded */
+	    if (expected == PJMEDIA_RTP_ED137_X && ext.present)
+		expected |= ext.present;
+	    if (expected == PJMEDIA_RTP_ED137_X)
+		expected |= PJMEDIA_RTP_ED137_OTHER;
+	} else {
+	    static const unsigned tlv[] = {
+		PJMEDIA_RTP_ED137_BSS, PJMEDIA_RTP_ED137_CLD,
+		PJMEDIA_RTP_ED137_RMM, PJMEDIA_RTP_ED137_MAM
+	    };
+	    expected = tlv[f - PJ_ARRAY_SIZE(base_bits)];
+	    if ((ext.present & expected) == 0 || !ext.x)
+		continue;
+	    switch (expected) {
+	    case PJMEDIA_RTP_ED137_BSS:
+		ext.bss_qidx ^= (pj_uint8_t)(1 << (pj_rand() % 5));
+		break;
+	    case PJMEDIA_RTP_ED137_CLD:
+		ext.cld ^= (pj_uint8_t)(1 << (pj_rand() % 8));
+		break;
+	    case PJMEDIA_RTP_ED137_RMM:
+		ext.rmm_t1 ^= 1 << (pj_rand() % 23);
+		break;
+	    default:
+		ext.mam.tj1 ^= (pj_uint16_t)(1 << (pj_rand() % 16));
+		break;
+	    }
+	}
+
+	rc = encode_decode(&ext, &dec2);
+	if (rc != 0) {
+	    PJ_LOG(3,(THIS_FILE, "  roundtrip error %d", rc));
+	    return -32;
+	}
+	changed = pjmedia_rtp_ed137_diff(&dec, &dec2);
+	if ((changed & ~PJMEDIA_RTP_ED137_OTHER) !=
+	    (expected & ~PJMEDIA_RTP_ED137_OTHER))
+	{
+	    PJ_LOG(3,(THIS_FILE, "  changed 0x%x, expected 0x%x, TLVs 0x%x",
+		      changed, expected, ext.present));
+	    return -33;
+	}
+    }
+
+    return 0;
+}
+
+static int fuzz_test(void)
+{
+    pj_uint8_t data[FUZZ_MAX_WORDS * 4];
+    unsigned i, j, truncated = 0, tlvs = 0;
+
+    for (i=0; i<FUZZ_CNT; ++i) {
+	pjmedia_rtp_ed137_ext ext, ext2, dec;
+	pj_uint16_t profile;
+	unsigned words = pj_rand() % (FUZZ_MAX_WORDS + 1);
+	pj_status_t status;
+	int rc;
+
+	/* Mostly ED-137 extensions with TLVs, some zero bytes */
+	profile = (pj_uint16_t)((pj_rand() & 7) ? PJMEDIA_RTP_ED137_PROFILE :
+						  pj_rand());
+	for (j=0; j<words * 4; ++j)
+	    data[j] = (pj_uint8_t)((pj_rand() & 3) ? pj_rand() : 0);
+	if (words && (pj_rand() & 3))
+	    data[1] |= 1;
+
+	/* The extension is at the end of the buffer, so that the decoder
+	 * reading past it shows under a memory checker.
+	 */
+	status = pjmedia_rtp_ed137_decode(&ext, profile,
+					  data + sizeof(data) - words * 4,
+					  words);
+	if ((status == PJ_SUCCESS) == (ext.truncated != 0) ||
+	    ext.words != words)
+	{
+	    PJ_LOG(3,(THIS_FILE, "  fuzz: bad status %d", status));
+	    return -40;
+	}
+	if (ext.truncated)
+	    ++truncated;
+	if (ext.present)
+	    ++tlvs;
+
+	pjmedia_rtp_ed137_decode(&ext2, profile,
+				 data + sizeof(data) - words * 4, words);
+	if (pjmedia_rtp_ed137_diff(&ext, &ext2) != 0) {
+	    PJ_LOG(3,(THIS_FILE, "  fuzz: decode is not repeatable"));
+	    return -41;
+	}
+
+	if (words == 0)
+	    continue;
+
+	/* What was decoded is encoded again */
+	ext.profile = PJMEDIA_RTP_ED137_PROFILE;
+	rc = encode_decode(&ext, &dec);
+	if (rc != 0 || !same_ext(&ext, &dec)) {
+	    PJ_LOG(3,(THIS_FILE, "  fuzz: re-encode error %d", rc));
+	    return -42;
+	}
+    }
+
+    PJ_LOG(3,(THIS_FILE, "  fuzz: %d extensions, %d with TLVs, %d truncated",
+	      FUZZ_CNT, tlvs, truncated));
+    return 0;
+}
+
+static int perf_test(void)
+{
+    enum { PKT_CNT = 64 };
+    pj_uint8_t pkt[PKT_CNT][4 + PJMEDIA_RTP_ED137_MAX_WORDS * 4];
+    unsigned pkt_len[PKT_CNT];
+    pjmedia_rtp_ed137_ext ext[PKT_CNT], prev, cur;
+    pj_timestamp t1, t2;
+    unsigned i, changes = 0, total = 0;
+    pj_uint32_t usec_dec, usec_enc;
+
+    /* Signalling only, as most audio packets, and some with TLVs */
+    for (i=0; i<PKT_CNT; ++i) {
+	random_ext(&ext[i]);
+	if (i % 8) {
+	    ext[i].present = 0;
+	    ext[i].x = 0;
+	}
+	pjmedia_rtp_ed137_encode(&ext[i], pkt[i], sizeof(pkt[i]), &pkt_len[i]);
+    }
+
+    pj_bzero(&prev, sizeof(prev));
+    pj_get_timestamp(&t1);
+    for (i=0; i<PERF_CNT; ++i) {
+	const pj_uint8_t *p = pkt[i % PKT_CNT];
+
+	pjmedia_rtp_ed137_decode(&cur, (pj_uint16_t)((p[0] << 8) | p[1]),
+				 p + 4, pkt_len[i % PKT_CNT] / 4 - 1);
+	if (pjmedia_rtp_ed137_diff(&prev, &cur))
+	    ++changes;
+	prev = cur;
+    }
+    pj_get_timestamp(&t2);
+    usec_dec = pj_elapsed_usec(&t1, &t2);
+
+    pj_get_timestamp(&t1);
+    for (i=0; i<PERF_CNT; ++i) {
+	unsigned len;
+
+	pjmedia_rtp_ed137_encode(&ext[i % PKT_CNT], pkt[i % PKT_CNT],
+				 sizeof(pkt[0]), &len);
+	total += len;
+    }
+    pj_get_timestamp(&t2);
+    usec_enc = pj_elapsed_usec(&t1, &t2);
+
+    PJ_LOG(3,(THIS_FILE, "  decode+diff: %u ns, encode: %u ns "
+	      "(%d changes, %u bytes)",
+	      (unsigned)((pj_uint64_t)usec_dec * 1000 / PERF_CNT),
+	      (unsigned)((pj_uint64_t)usec_enc * 1000 / PERF_CNT),
+	      changes, total));
+
+    return 0;
+}
+
+int rtp_ed137_test(void)
+{
+    int rc;
+
+    rc = macro_test();
+    if (rc != 0)
+	return rc;
+
+    rc = rmm_test();
+    if (rc != 0)
+	return rc;
+
+    rc = roundtrip_test();
+    if (rc != 0)
+	return rc;
+
+    rc = fuzz_test();
+    if (rc != 0)
+	return rc;
+
+    return perf_test();
+}
@@ -0,0 +1,261 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2009 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+/*
+ * Measure the RTP receive throughput of the media endpoint created with
+ * pjmedia_endpt_create_workers() for several number of workers. Each
+ * transport is polled by one worker, and the RTP callback spends some
+ * time on each packet to stand for the work of the stream (jitter buffer,
+ * decoding, ...), so the throughput should grow with the number of
+ * workers up to the number of CPUs.
+ *
+ * Then compare one worker reading one packet per system call with the
+ * PJMEDIA_UDP_BATCH_RX transports, with no work in the callback so that
+ * the cost of the reads shows.
+ */
+
+#define THIS_FILE	    "rx_worker_test.c"
+
+#define TRANSPORT_CNT	    32
+#define SENDER_CNT	    4
+#define BASE_PORT	    42000
+#define PKT_SIZE	    172
+#define DURATION_MSEC	    1000
+#define CB_WORK_LOOP	    2000
+
+struct rx_stat
+{
+    pj_atomic_t	    *rx_cnt;
+    unsigned	     work_loop;
+    volatile int     sink;
+};
+
+struct sender_arg
+{
+    unsigned	     first;
+    unsigned	     cnt;
+    volatile pj_bool_t *quit;
+};
+
+static void on_rx_rtp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    struct rx_stat *stat = (struct rx_stat*) user_data;
+    const pj_uint8_t *p = (const pj_uint8_t*) pkt;
+    int i, acc = 0;
+
+    if (size <= 0)
+	return;
+
+    for (i=0; i<(int)stat->work_loop; ++i)
+	acc += p[i % size] * i;
+    stat->sink = acc;
+
+    pj_atomic_inc(stat->rx_cnt);
+}
+
+static void on_rx_rtcp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    PJ_UNUSED_ARG(user_data);
+    PJ_UNUSED_ARG(pkt);
+    PJ_UNUSED_ARG(size);
+}
+
+static int sender_proc(void *arg)
+{
+    struct sender_arg *sa = (struct sender_arg*) arg;
+    pj_uint8_t pkt[PKT_SIZE];
+    pj_sockaddr_in addr[TRANSPORT_CNT];
+    pj_str_t localhost = pj_str("127.0.0.1");
+    pj_sock_t sock;
+    unsigned i, n = 0;
+
+    if (pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &sock) != PJ_SUCCESS)
+	return -1;
+
+    pj_bzero(pkt, sizeof(pkt));
+    pkt[0] = 0x80;
+    for (i=0; i<sa->cnt; ++i) {
+	pj_sockaddr_in_init(&addr[i], &localhost,
+			    (pj_uint16_t)(BASE_PORT + 2 * (sa->first + i)));
+    }
+
+    while (!*sa->quit) {
+	pj_ssize_t len = sizeof(pkt);
+
+	pkt[1] = (pj_uint8_t) n;
+	pj_sock_sendto(sock, pkt, &len, 0, &addr[n % sa->cnt],
+		       sizeof(pj_sockaddr_in));
+	if ((++n & 63) == 0)
+	    pj_thread_sleep(0);
+    }
+
+    pj_sock_close(sock);
+    return 0;
+}
+
+static int run_workers(unsigned worker_cnt, unsigned options,
+		       unsigned work_loop, unsigned *p_rate)
+{
+    pjmedia_endpt *endpt = NULL;
+    pj_pool_t *pool;
+    pjmedia_transport *tp[TRANSPORT_CNT];
+    pj_thread_t *sender[SENDER_CNT];
+    struct sender_arg sa[SENDER_CNT];
+    struct rx_stat stat;
+    pj_sockaddr_in rem;
+    pj_str_t localhost = pj_str("127.0.0.1");
+    volatile pj_bool_t quit = PJ_FALSE;
+    pj_timestamp t0, t1;
+    pj_uint32_t elapsed;
+    unsigned i, tp_cnt = 0, sender_cnt = 0;
+    int rc = 0;
+    pj_status_t status;
+
+    pool = pj_pool_create(mem, "rxworker", 1000, 1000, NULL);
+    pj_bzero(&stat, sizeof(stat));
+    stat.work_loop = work_loop;
+    pj_bzero(tp, sizeof(tp));
+
+    status = pj_atomic_create(pool, 0, &stat.rx_cnt);
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "Error creating atomic");
+	rc = -10;
+	goto on_return;
+    }
+
+    status = pjmedia_endpt_create_workers(mem, worker_cnt, -1, &endpt);
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "Error creating media endpoint");
+	rc = -20;
+	goto on_return;
+    }
+
+    /* The remote address is never used, nothing is sent back */
+    pj_sockaddr_in_init(&rem, &localhost, (pj_uint16_t)(BASE_PORT - 2));
+
+    for (i=0; i<TRANSPORT_CNT; ++i) {
+	status = pjmedia_transport_udp_create3(endpt, pj_AF_INET(), NULL,
+					       &localhost, BASE_PORT + 2 * i,
+					       options, &tp[i]);
+	if (status != PJ_SUCCESS) {
+	    app_perror(status, "Error creating UDP transport");
+	    rc = -30;
+	    goto on_return;
+	}
+	++tp_cnt;
+
+	status = pjmedia_transport_attach(tp[i], &stat, &rem, NULL,
+					  sizeof(rem), &on_rx_rtp,
+					  &on_rx_rtcp);
+	if (status != PJ_SUCCESS) {
+	    app_perror(status, "Error attaching UDP transport");
+	    rc = -40;
+	    goto on_return;
+	}
+    }
+
+    for (i=0; i<SENDER_CNT; ++i) {
+	sa[i].first = i * (TRANSPORT_CNT / SENDER_CNT);
+	sa[i].cnt = TRANSPORT_CNT / SENDER_CNT;
+	sa[i].quit = &quit;
+	status = pj_thread_create(pool, "rxsender", &sender_proc, &sa[i],
+				  0, 0, &sender[i]);
+	if (status != PJ_SUCCESS) {
+	    app_perror(status, "Error creating sender thread");
+	    rc = -50;
+	    goto on_return;
+	}
+	++sender_cnt;
+    }
+
+    pj_get_timestamp(&t0);
+    pj_atomic_set(stat.rx_cnt, 0);
+    pj_thread_sleep(DURATION_MSEC);
+    i = (unsigned) pj_atomic_get(stat.rx_cnt);
+    pj_get_timestamp(&t1);
+
+    elapsed = pj_elapsed_msec(&t0, &t1);
+    *p_rate = elapsed ? (unsigned)((pj_uint64_t)i * 1000 / elapsed) : 0;
+
+    if (i == 0) {
+	PJ_LOG(3,(THIS_FILE, "  no packet received with %d workers",
+		  worker_cnt));
+	rc = -60;
+    }
+
+on_return:
+    quit = PJ_TRUE;
+    for (i=0; i<sender_cnt; ++i) {
+	pj_thread_join(sender[i]);
+	pj_thread_destroy(sender[i]);
+    }
+    for (i=0; i<tp_cnt; ++i) {
+	pjmedia_transport_detach(tp[i], &stat);
+	pjmedia_transport_close(tp[i]);
+    }
+    if (endpt)
+	pjmedia_endpt_destroy(endpt);
+    if (stat.rx_cnt)
+	pj_atomic_destroy(stat.rx_cnt);
+    pj_pool_release(pool);
+
+    return rc;
+}
+
+int rx_worker_test(void)
+{
+    static const unsigned workers[] = { 1, 2, 4, 8 };
+    unsigned i, rate, rate1 = 0;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  %d transports, %d senders, %d bytes, %d ms:",
+	      TRANSPORT_CNT, SENDER_CNT, PKT_SIZE, DURATION_MSEC));
+
+    for (i=0; i<PJ_ARRAY_SIZE(workers); ++i) {
+	rc = run_workers(workers[i], 0, CB_WORK_LOOP, &rate);
+	if (rc != 0)
+	    return rc;
+
+	if (i == 0)
+	    rate1 = rate;
+
+	PJ_LOG(3,(THIS_FILE, "  %d worker(s): %7u pkt/s (x%d.%02d)",
+		  workers[i], rate,
+		  rate1 ? rate / rate1 : 0,
+		  rate1 ? (rate * 100 / rate1) % 100 : 0));
+    }
+
+#if PJMEDIA_HAS_UDP_BATCH_RX
+    rc = run_workers(1, 0, 0, &rate1);
+    if (rc != 0)
+	return rc;
+
+    rc = run_workers(1, PJMEDIA_UDP_BATCH_RX, 0, &rate);
+    if (rc != 0)
+	return rc;
+
+    PJ_LOG(3,(THIS_FILE, "  1 worker, no callback work: %u pkt/s, "
+	      "batched read (%d pkts): %u pkt/s",
+	      rate1, PJMEDIA_UDP_RX_BATCH_SIZE, rate));
+#endif
+
+    return 0;
+}
@@ -71,6 +71,12 @@ int test_main(void)
 #if HAS_CODEC_VECTOR_TEST
     DO_TEST(codec_test_vectors());
 #endif
+#if HAS_RX_WORKER_TEST
+    DO_TEST(rx_worker_test());
+#endif
+#if HAS_RTP_ED137_TEST
+    DO_TEST(rtp_ed137_test());
+#endif
 
     PJ_LOG(3,(THIS_FILE," "));
 
@@ -27,6 +27,8 @@
 #define HAS_JBUF_TEST		1
 #define HAS_MIPS_TEST		1
 #define HAS_CODEC_VECTOR_TEST	1
+#define HAS_RX_WORKER_TEST	1
+#define HAS_RTP_ED137_TEST	1
 
 int session_test(void);
 int rtp_test(void);
@@ -35,6 +37,8 @@ int jbuf_main(void);
 int sdp_neg_test(void);
 int mips_test(void);
 int codec_test_vectors(void);
+int rx_worker_test(void);
+int rtp_ed137_test(void);
 
 extern pj_pool_factory *mem;
 void app_perror(pj_status_t status, const char *title);
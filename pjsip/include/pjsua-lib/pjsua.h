@@ -2591,6 +2591,21 @@ PJ_DECL(pj_status_t) pjsua_acc_set_transport(pjsua_acc_id acc_id,
 #   define PJSUA_MAX_CALLS	    32
 #endif
 
+/**
+ * Create the UDP media transports on demand. When enabled,
+ * #pjsua_media_transports_create() only stores the configuration, and
+ * each call takes a transport from a pool when its media is initialized,
+ * creating a new one only when the pool is empty. The transport goes back
+ * to the pool when the call is disconnected, so the number of open RTP/RTCP
+ * sockets follows the peak number of simultaneous calls instead of
+ * PJSUA_MAX_CALLS.
+ *
+ * Default: 1
+ */
+#ifndef PJSUA_LAZY_MEDIA_TRANSPORT
+#   define PJSUA_LAZY_MEDIA_TRANSPORT	    1
+#endif
+
 
 
 /**
@@ -3779,6 +3794,25 @@ struct pjsua_media_config
      */
     unsigned		thread_cnt;
 
+    /**
+     * Give each media worker thread its own ioqueue, instead of having
+     * all of them poll the same one. The RTP/RTCP sockets of each call are
+     * then always polled by the same worker, so the packets of a stream
+     * are handled in order while different calls are handled in parallel.
+     * Only used when \a has_ioqueue is set.
+     *
+     * Default: PJ_FALSE
+     */
+    pj_bool_t		thread_ioqueue;
+
+    /**
+     * If not negative, the media worker thread i is pinned to the CPU
+     * thread_first_cpu+i. Only used with \a thread_ioqueue.
+     *
+     * Default: -1
+     */
+    int			thread_first_cpu;
+
     /**
      * Media quality, 0-10, according to this table:
      *   5-10: resampling use large filter,
@@ -4585,7 +4619,8 @@ PJ_DECL(pj_status_t) pjsua_codec_set_param( const pj_str_t *codec_id,
 
 /**
  * Create UDP media transports for all the calls. This function creates
- * one UDP media transport for each call.
+ * one UDP media transport for each call. With PJSUA_LAZY_MEDIA_TRANSPORT
+ * the transports are created later, when the calls need them.
  *
  * @param cfg		Media transport configuration. The "port" field in the
  *			configuration is used as the start port to bind the
@@ -50,6 +50,7 @@ typedef enum pjsua_med_tp_st
  */
 typedef struct pjsua_call
 {
+    PJ_DECL_LIST_MEMBER(struct pjsua_call); /**< Free or used call list.  */
     unsigned		 index;	    /**< Index in pjsua array.		    */
     pjsip_inv_session	*inv;	    /**< The invite session.		    */
     void		*user_data; /**< User/application data.		    */
@@ -90,6 +91,7 @@ typedef struct pjsua_call
 
     char    last_text_buf_[128];    /**< Buffer for last_text.		    */
 	 pjsip_rx_data * incoming_rdata;
+    pj_bool_t		 slot_used; /**< In the list of used call slots.   */
 
 } pjsua_call;
 
@@ -290,7 +292,8 @@ struct pjsua_data
     pjsua_config	 ua_cfg;		/**< UA config.		*/
     unsigned		 call_cnt;		/**< Call counter.	*/
     pjsua_call		 calls[PJSUA_MAX_CALLS];/**< Calls array.	*/
-    pjsua_call_id	 next_call_id;		/**< Next call id to use*/
+    pjsua_call		 call_free_list;	/**< Free slots (FIFO).	*/
+    pjsua_call		 call_used_list;	/**< Calls in progress.	*/
 
     /* Buddy; */
     unsigned		 buddy_cnt;		    /**< Buddy count.	*/
@@ -306,6 +309,10 @@ struct pjsua_data
     pjmedia_conf	*mconf;	    /**< Conference bridge.		*/
     pj_bool_t		 is_mswitch;/**< Are we using audio switchboard
 				         (a.k.a APS-Direct)		*/
+    pj_bool_t		 med_tp_lazy;/**< Transports created on demand	*/
+    pjsua_transport_config med_tp_cfg;/**< Config for on demand transp.	*/
+    unsigned		 med_tp_pool_cnt;/**< Idle transports in the pool.	*/
+    pjmedia_transport	*med_tp_pool[PJSUA_MAX_CALLS];/**< Idle transports.	*/
 
     /* Sound device */
     pjmedia_aud_dev_index cap_dev;  /**< Capture device ID.		*/
@@ -417,6 +424,8 @@ pj_status_t pjsua_media_channel_update(pjsua_call_id call_id,
 				       const pjmedia_sdp_session *local_sdp,
 				       const pjmedia_sdp_session *remote_sdp);
 pj_status_t pjsua_media_channel_deinit(pjsua_call_id call_id);
+void pjsua_media_transport_release(pjsua_call_id call_id);
+pjmedia_transport *pjsua_media_transport_sample(void);
 
 
 /**
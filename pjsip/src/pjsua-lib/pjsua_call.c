@@ -138,6 +138,14 @@ pj_status_t pjsua_call_subsys_init(const pjsua_config *cfg)
 	pjsua_var.ua_cfg.max_calls = PJSUA_MAX_CALLS;
     }
 
+	/* Init the lists of call slots. All the usable slots start free */
+	pj_list_init(&pjsua_var.call_free_list);
+	pj_list_init(&pjsua_var.call_used_list);
+	for (i=0; i<pjsua_var.ua_cfg.max_calls; ++i) {
+		pjsua_var.calls[i].slot_used = PJ_FALSE;
+		pj_list_push_back(&pjsua_var.call_free_list, &pjsua_var.calls[i]);
+	}
+
 	/* Check the route URI's and force loose route if required */
 	for (i=0; i<pjsua_var.ua_cfg.outbound_proxy_cnt; ++i) {
 		status = normalize_route_uri(pjsua_var.pool, 
@@ -202,16 +210,19 @@ PJ_DEF(unsigned) pjsua_call_get_count(void)
 PJ_DEF(pj_status_t) pjsua_enum_calls( pjsua_call_id ids[],
 												 unsigned *count)
 {
-	unsigned i, c;
+	pjsua_call *call;
+	unsigned c;
 
 	PJ_ASSERT_RETURN(ids && *count, PJ_EINVAL);
 
 	PJSUA_LOCK();
 
-	for (i=0, c=0; c<*count && i<pjsua_var.ua_cfg.max_calls; ++i) {
-		if (!pjsua_var.calls[i].inv)
+	/* Only the calls in progress are visited */
+	call = pjsua_var.call_used_list.next;
+	for (c=0; c<*count && call!=&pjsua_var.call_used_list; call=call->next) {
+		if (!call->inv)
 			continue;
-		ids[c] = i;
+		ids[c] = call->index;
 		++c;
 	}
 
@@ -223,47 +234,40 @@ PJ_DEF(pj_status_t) pjsua_enum_calls( pjsua_call_id ids[],
 }
 
 
-/* Allocate one call id */
+/* Allocate one call id.
+ * The free slots are kept in FIFO order, so a released id is reused as late
+ * as possible, as the former round-robin search did. The slot stays in the
+ * free list until the invite session is attached with call_slot_take().
+ */
 static pjsua_call_id alloc_call_id(void)
 {
-	pjsua_call_id cid;
+	if (pj_list_empty(&pjsua_var.call_free_list))
+		return PJSUA_INVALID_ID;
 
-#if 1
-	/* New algorithm: round-robin */
-	if (pjsua_var.next_call_id >= (int)pjsua_var.ua_cfg.max_calls || 
-		pjsua_var.next_call_id < 0)
-	{
-		pjsua_var.next_call_id = 0;
-	}
+	return pjsua_var.call_free_list.next->index;
+}
 
-	for (cid=pjsua_var.next_call_id; 
-		cid<(int)pjsua_var.ua_cfg.max_calls; 
-		++cid) 
-	{
-		if (pjsua_var.calls[cid].inv == NULL) {
-			//++pjsua_var.next_call_id;
-			pjsua_var.next_call_id = cid + 1;
-			return cid;
-		}
-	}
+/* Move the call slot to the list of calls in progress */
+static void call_slot_take(pjsua_call *call)
+{
+	pj_assert(!call->slot_used);
 
-	for (cid=0; cid < pjsua_var.next_call_id; ++cid) {
-		if (pjsua_var.calls[cid].inv == NULL) {
-			//++pjsua_var.next_call_id;
-			pjsua_var.next_call_id = cid + 1;
-			return cid;
-		}
-	}
+	pj_list_erase(call);
+	pj_list_push_back(&pjsua_var.call_used_list, call);
+	call->slot_used = PJ_TRUE;
+	++pjsua_var.call_cnt;
+}
 
-#else
-	/* Old algorithm */
-	for (cid=0; cid<(int)pjsua_var.ua_cfg.max_calls; ++cid) {
-		if (pjsua_var.calls[cid].inv == NULL)
-			return cid;
-	}
-#endif
+/* Give the call slot back to the free list */
+static void call_slot_release(pjsua_call *call)
+{
+	if (!call->slot_used)
+		return;
 
-	return PJSUA_INVALID_ID;
+	pj_list_erase(call);
+	pj_list_push_back(&pjsua_var.call_free_list, call);
+	call->slot_used = PJ_FALSE;
+	--pjsua_var.call_cnt;
 }
 
 /* Get signaling secure level.
@@ -676,7 +680,7 @@ PJ_DEF(pj_status_t) pjsua_call_make_call( pjsua_acc_id acc_id,
 	}
 
 	/* Must increment call counter now */
-	++pjsua_var.call_cnt;
+	call_slot_take(call);
 
 	/* Send initial INVITE: */
 
@@ -718,8 +722,10 @@ on_error:
 
 	if (call_id != -1) 
 	{
+		call_slot_release(&pjsua_var.calls[call_id]);
 		reset_call(call_id);
 		pjsua_media_channel_deinit(call_id);
+		pjsua_media_transport_release(call_id);
 	}
 
 	pj_pool_release(tmp_pool);
@@ -1164,7 +1170,7 @@ pj_bool_t pjsua_call_on_incoming(pjsip_rx_data *rdata)
 	dlg->mod_data[pjsua_var.mod.id] = call;
 	inv->mod_data[pjsua_var.mod.id] = call;
 
-	++pjsua_var.call_cnt;
+	call_slot_take(call);
 
 	///* Check if this request should replace existing call */
 	//if (replaced_dlg) {
@@ -3339,12 +3345,14 @@ static void pjsua_call_on_state_changed(pjsip_inv_session *inv,
 
 		pj_assert(call != NULL);
 
-		if (call)
+		if (call) {
 			pjsua_media_channel_deinit(call->index);
+			pjsua_media_transport_release(call->index);
+		}
 
 		/* Free call */
 		call->inv = NULL;
-		--pjsua_var.call_cnt;
+		call_slot_release(call);
 
 		/* Reset call */
 		reset_call(call->index);
@@ -195,6 +195,8 @@ PJ_DEF(void) pjsua_media_config_default(pjsua_media_config *cfg)
     cfg->max_media_ports = PJSUA_MAX_CONF_PORTS;
     cfg->has_ioqueue = PJ_TRUE;
     cfg->thread_cnt = 1;
+    cfg->thread_ioqueue = PJ_FALSE;
+    cfg->thread_first_cpu = -1;
     cfg->quality = PJSUA_DEFAULT_CODEC_QUALITY;
     cfg->ilbc_mode = PJSUA_DEFAULT_ILBC_MODE;
     cfg->ec_tail_len = PJSUA_DEFAULT_EC_TAIL_LEN;
@@ -297,6 +299,7 @@ static pj_bool_t options_on_rx_request(pjsip_rx_data *rdata)
     pjsip_tx_data *tdata;
     pjsip_response_addr res_addr;
     pjmedia_transport_info tpinfo;
+    pjmedia_transport *med_tp;
     pjmedia_sdp_session *sdp;
     const pjsip_hdr *cap_hdr;
     pj_status_t status;
@@ -404,9 +407,10 @@ static pj_bool_t options_on_rx_request(pjsip_rx_data *rdata)
     }
 
     /* Get media socket info */
-    if (pjsua_var.calls[0].med_tp && st_code == 200) {
+    med_tp = (st_code == 200) ? pjsua_media_transport_sample() : NULL;
+    if (med_tp) {
     pjmedia_transport_info_init(&tpinfo);
-    pjmedia_transport_get_info(pjsua_var.calls[0].med_tp, &tpinfo);
+    pjmedia_transport_get_info(med_tp, &tpinfo);
 
     /* Add SDP body, using call0's RTP address */
     status = pjmedia_endpt_create_sdp(pjsua_var.med_endpt, tdata->pool, 1,
@@ -2527,6 +2531,10 @@ PJ_DEF(void) pjsua_dump(pj_bool_t detail)
 	pjmedia_transport_info tpinfo;
 	char addr_buf[80];
 
+	/* Not created yet with PJSUA_LAZY_MEDIA_TRANSPORT */
+	if (call->med_tp == NULL)
+	    continue;
+
 	/* MSVC complains about tpinfo not being initialized */
 	//pj_bzero(&tpinfo, sizeof(tpinfo));
 
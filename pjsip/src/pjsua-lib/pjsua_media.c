@@ -39,6 +39,8 @@ static pj_uint16_t next_rtp_port;
 static pj_status_t open_snd_dev(pjmedia_aud_param *param);
 /* Close existing sound device */
 static void close_snd_dev(void);
+/* Close the idle media transports */
+static void close_media_transport_pool(void);
 /* Create audio device param */
 static pj_status_t create_aud_param(pjmedia_aud_param *param,
 				    pjmedia_aud_dev_index capture_dev,
@@ -99,11 +101,20 @@ pj_status_t pjsua_media_subsys_init(const pjsua_media_config *cfg)
     }
 
     /* Create media endpoint. */
-    status = pjmedia_endpt_create(&pjsua_var.cp.factory, 
-				  pjsua_var.media_cfg.has_ioqueue? NULL :
+    if (pjsua_var.media_cfg.has_ioqueue && 
+	pjsua_var.media_cfg.thread_ioqueue)
+    {
+	status = pjmedia_endpt_create_workers(&pjsua_var.cp.factory,
+					      pjsua_var.media_cfg.thread_cnt,
+					      pjsua_var.media_cfg.thread_first_cpu,
+					      &pjsua_var.med_endpt);
+    } else {
+	status = pjmedia_endpt_create(&pjsua_var.cp.factory, 
+				      pjsua_var.media_cfg.has_ioqueue? NULL :
 				     pjsip_endpt_get_ioqueue(pjsua_var.endpt),
-				  pjsua_var.media_cfg.thread_cnt,
-				  &pjsua_var.med_endpt);
+				      pjsua_var.media_cfg.thread_cnt,
+				      &pjsua_var.med_endpt);
+    }
     if (status != PJ_SUCCESS) {
 	pjsua_perror(THIS_FILE, 
 		     "Media stack initialization has returned error", 
@@ -623,7 +634,7 @@ pj_status_t pjsua_media_subsys_start(void)
     pj_status_t status;
 
     /* Create media for calls, if none is specified */
-    if (pjsua_var.calls[0].med_tp == NULL) {
+    if (pjsua_var.calls[0].med_tp == NULL && !pjsua_var.med_tp_lazy) {
 	pjsua_transport_config transport_cfg;
 
 	/* Create default transport config */
@@ -692,6 +703,8 @@ pj_status_t pjsua_media_subsys_destroy(void)
 	}
 	pjsua_var.calls[i].med_tp = NULL;
     }
+    close_media_transport_pool();
+    pjsua_var.med_tp_lazy = PJ_FALSE;
 
     /* Destroy media endpoint. */
     if (pjsua_var.med_endpt) {
@@ -745,40 +758,51 @@ pj_status_t pjsua_media_subsys_destroy(void)
 }
 
 
-/* Create normal UDP media transports */
-static pj_status_t create_udp_media_transports(pjsua_transport_config *cfg)
+/* Create one normal UDP media transport */
+static pj_status_t create_udp_media_transport(const pjsua_transport_config *cfg,
+					      pjmedia_transport **p_tp)
 {
-    unsigned i;
     pjmedia_sock_info skinfo;
     pj_status_t status;
 
-    /* Create each media transport */
-    for (i=0; i<pjsua_var.ua_cfg.max_calls; ++i) {
+    status = create_rtp_rtcp_sock(cfg, &skinfo);
+    if (status != PJ_SUCCESS) {
+	pjsua_perror(THIS_FILE, "Unable to create RTP/RTCP socket",
+		     status);
+	return status;
+    }
 
-	status = create_rtp_rtcp_sock(cfg, &skinfo);
-	if (status != PJ_SUCCESS) {
-	    pjsua_perror(THIS_FILE, "Unable to create RTP/RTCP socket",
-		         status);
-	    goto on_error;
-	}
+    status = pjmedia_transport_udp_attach(pjsua_var.med_endpt, NULL,
+					  &skinfo, cfg->options, p_tp);
+    if (status != PJ_SUCCESS) {
+	pjsua_perror(THIS_FILE, "Unable to create media transport",
+		     status);
+	pj_sock_close(skinfo.rtp_sock);
+	pj_sock_close(skinfo.rtcp_sock);
+	return status;
+    }
 
-	status = pjmedia_transport_udp_attach(pjsua_var.med_endpt, NULL,
-					      &skinfo, cfg->options,
-					      &pjsua_var.calls[i].med_tp);
-	if (status != PJ_SUCCESS) {
-	    pjsua_perror(THIS_FILE, "Unable to create media transport",
-		         status);
-	    goto on_error;
-	}
+    pjmedia_transport_simulate_lost(*p_tp, PJMEDIA_DIR_ENCODING,
+				    pjsua_var.media_cfg.tx_drop_pct);
 
-	pjmedia_transport_simulate_lost(pjsua_var.calls[i].med_tp,
-					PJMEDIA_DIR_ENCODING,
-					pjsua_var.media_cfg.tx_drop_pct);
+    pjmedia_transport_simulate_lost(*p_tp, PJMEDIA_DIR_DECODING,
+				    pjsua_var.media_cfg.rx_drop_pct);
 
-	pjmedia_transport_simulate_lost(pjsua_var.calls[i].med_tp,
-					PJMEDIA_DIR_DECODING,
-					pjsua_var.media_cfg.rx_drop_pct);
+    return PJ_SUCCESS;
+}
 
+#if !PJSUA_LAZY_MEDIA_TRANSPORT
+/* Create normal UDP media transports */
+static pj_status_t create_udp_media_transports(pjsua_transport_config *cfg)
+{
+    unsigned i;
+    pj_status_t status;
+
+    /* Create each media transport */
+    for (i=0; i<pjsua_var.ua_cfg.max_calls; ++i) {
+	status = create_udp_media_transport(cfg, &pjsua_var.calls[i].med_tp);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
     }
 
     return PJ_SUCCESS;
@@ -793,6 +817,101 @@ on_error:
 
     return status;
 }
+#endif
+
+/* Close the idle transports of the pool */
+static void close_media_transport_pool(void)
+{
+    while (pjsua_var.med_tp_pool_cnt) {
+	--pjsua_var.med_tp_pool_cnt;
+	pjmedia_transport_close(
+		pjsua_var.med_tp_pool[pjsua_var.med_tp_pool_cnt]);
+	pjsua_var.med_tp_pool[pjsua_var.med_tp_pool_cnt] = NULL;
+    }
+}
+
+/* Give the call a media transport, taken from the pool of idle transports
+ * or created when the pool is empty.
+ */
+static pj_status_t acquire_media_transport(pjsua_call *call)
+{
+    pj_status_t status;
+
+    if (pjsua_var.med_tp_pool_cnt) {
+	--pjsua_var.med_tp_pool_cnt;
+	call->med_tp = pjsua_var.med_tp_pool[pjsua_var.med_tp_pool_cnt];
+	pjsua_var.med_tp_pool[pjsua_var.med_tp_pool_cnt] = NULL;
+    } else {
+	status = create_udp_media_transport(&pjsua_var.med_tp_cfg,
+					    &call->med_tp);
+	if (status != PJ_SUCCESS) {
+	    call->med_tp = NULL;
+	    return status;
+	}
+    }
+
+    call->med_orig = NULL;
+    call->med_tp_auto_del = PJ_TRUE;
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Give the media transport of a disconnected call back to the pool.
+ * The media must have been deinitialized already.
+ */
+void pjsua_media_transport_release(pjsua_call_id call_id)
+{
+    pjsua_call *call = &pjsua_var.calls[call_id];
+
+    if (!pjsua_var.med_tp_lazy || call->med_tp == NULL || 
+	!call->med_tp_auto_del || call->med_tp_st != PJSUA_MED_TP_IDLE ||
+	(call->med_orig && call->med_orig != call->med_tp))
+    {
+	return;
+    }
+
+    pj_assert(pjsua_var.med_tp_pool_cnt < PJ_ARRAY_SIZE(pjsua_var.med_tp_pool));
+    pjsua_var.med_tp_pool[pjsua_var.med_tp_pool_cnt++] = call->med_tp;
+    call->med_tp = NULL;
+    call->med_orig = NULL;
+}
+
+/*
+ * Get any media transport, to describe the local media (e.g. in the SDP
+ * of the OPTIONS response). With on demand transports, an idle one or the
+ * one of a call in progress is used, and one is created into the pool only
+ * when none exists yet.
+ */
+pjmedia_transport *pjsua_media_transport_sample(void)
+{
+    pjmedia_transport *tp = pjsua_var.calls[0].med_tp;
+    pjsua_call *call;
+
+    if (tp || !pjsua_var.med_tp_lazy)
+	return tp;
+
+    PJSUA_LOCK();
+
+    if (pjsua_var.med_tp_pool_cnt) {
+	tp = pjsua_var.med_tp_pool[pjsua_var.med_tp_pool_cnt-1];
+    } else {
+	for (call=pjsua_var.call_used_list.next; 
+	     call!=&pjsua_var.call_used_list && tp==NULL; call=call->next)
+	{
+	    tp = call->med_tp;
+	}
+	if (tp == NULL && 
+	    create_udp_media_transport(&pjsua_var.med_tp_cfg, &tp)==PJ_SUCCESS)
+	{
+	    pjsua_var.med_tp_pool[pjsua_var.med_tp_pool_cnt++] = tp;
+	}
+    }
+
+    PJSUA_UNLOCK();
+
+    return tp;
+}
 
 
 /* This callback is called when ICE negotiation completes */
@@ -1045,11 +1164,24 @@ PJ_DEF(pj_status_t) pjsua_media_transports_create(
     /* Copy config */
     pjsua_transport_config_dup(pjsua_var.pool, &cfg, app_cfg);
 
+    close_media_transport_pool();
+    pjsua_var.med_tp_lazy = PJ_FALSE;
+
     /* Create the transports */
     if (pjsua_var.media_cfg.enable_ice) {
 	status = create_ice_media_transports(&cfg);
     } else {
+#if PJSUA_LAZY_MEDIA_TRANSPORT
+	/* Created on demand by pjsua_media_channel_init(), starting again
+	 * from the configured port.
+	 */
+	pjsua_var.med_tp_cfg = cfg;
+	pjsua_var.med_tp_lazy = PJ_TRUE;
+	next_rtp_port = 0;
+	status = PJ_SUCCESS;
+#else
 	status = create_udp_media_transports(&cfg);
+#endif
     }
 
     /* Set media transport auto_delete to True */
@@ -1073,6 +1205,9 @@ PJ_DEF(pj_status_t) pjsua_media_transports_attach(pjsua_media_transport tp[],
 
     PJ_ASSERT_RETURN(tp && count==pjsua_var.ua_cfg.max_calls, PJ_EINVAL);
 
+    close_media_transport_pool();
+    pjsua_var.med_tp_lazy = PJ_FALSE;
+
     /* Assign the media transports */
     for (i=0; i<pjsua_var.ua_cfg.max_calls; ++i) {
 	if (pjsua_var.calls[i].med_tp != NULL && 
@@ -1107,6 +1242,16 @@ pj_status_t pjsua_media_channel_init(pjsua_call_id call_id,
 
     PJ_UNUSED_ARG(role);
 
+    /* Media transports created on demand */
+    if (call->med_tp == NULL && pjsua_var.med_tp_lazy) {
+	status = acquire_media_transport(call);
+	if (status != PJ_SUCCESS) {
+	    if (sip_err_code)
+		*sip_err_code = PJSIP_SC_INTERNAL_SERVER_ERROR;
+	    return status;
+	}
+    }
+
     /* Return error if media transport has not been created yet
      * (e.g. application is starting)
      */